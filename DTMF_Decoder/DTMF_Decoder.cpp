@@ -56,7 +56,22 @@
 #include "DTMF_Decoder.h" // For APP_NAME
 #include "mvcModel.h"     // For the persistent model of the application
 #include "mvcView.h"      // For drawing the window
+#include "mvcSnapshot.h"  // For mvcSnapshotTest
+#include "mvcHistory.h"   // For mvcHistoryTest
+#include "rtSched.h"      // For the real-time scheduling policy
+#include "numaPlace.h"    // For the NUMA placement layer
+#include "goertzelTune.h" // For the Goertzel autotuner
 #include "audio.h"        // For capturing audio
+#include "audioSim.h"     // For the simulated audio device
+#include "audioRecord.h"  // For recording and replaying the capture buffers
+#include "benchmark.h"    // For the headless benchmarks
+#include "dtmfService.h"  // For the headless decoding service
+#include "dtmfLoadGen.h"  // For the service's load generator
+#include "dtmfPcap.h"     // For the offline pcap reader
+#include "perfCounters.h" // For the runtime performance counters
+#include "logTrace.h"     // For the binary trace logger
+#include "logFile.h"      // For the file log sink
+#include "logFlight.h"    // For the flight recorder
 #include "goertzel.h"     // For goertzel_Stop()
 #include "resource.h"     // For the resource definitions
 #include "version.h"      // For the application's version strings
@@ -139,6 +154,87 @@ int APIENTRY wWinMain(
    /// Initialize Windows Error Reporting
    logWerInit();
 
+   /// Start the performance counters' clock
+   perfCountersInit();
+
+   /// Check the command line for options (like the simulated audio device)
+   br = audioSimParseCommandLine( lpCmdLine )
+     && audioRecordParseCommandLine( lpCmdLine )
+     && benchmarkParseCommandLine( lpCmdLine )
+     && perfCountersParseCommandLine( lpCmdLine )
+     && logTraceParseCommandLine( lpCmdLine )
+     && logFileParseCommandLine( lpCmdLine )
+     && dtmfServiceParseCommandLine( lpCmdLine )
+     && dtmfLoadGenParseCommandLine( lpCmdLine )
+     && dtmfPcapParseCommandLine( lpCmdLine )
+     && rtSchedParseCommandLine( lpCmdLine )
+     && numaPlaceParseCommandLine( lpCmdLine )
+     && goertzelTuneParseCommandLine( lpCmdLine )
+     && mvcViewParseCommandLine( lpCmdLine );
+   if ( !br ) {
+      LOG_FATAL_R( IDS_DTMF_DECODER_FAILED_TO_PARSE_COMMAND_LINE );  // "Failed to parse the command line.  Exiting."
+      return EXIT_FAILURE;
+   }
+
+   /// If `/lockmemory` is on the command line, then lock the working set
+   rtSchedInit();  // Failures are logged as warnings
+
+   /// Find the NUMA nodes the service's streams and workers are placed on
+   if ( !numaPlaceInit() ) {
+      return EXIT_FAILURE;  // numaPlaceInit logged the problem
+   }
+
+   /// If `/benchmark` is on the command line, then run the benchmarks
+   /// headless (no window and no audio device) and end
+   if ( benchmarkIsEnabled() ) {
+      br = benchmarkRun();
+      if ( !br ) {
+         LOG_FATAL_R( IDS_DTMF_DECODER_BENCHMARK_FAILED );  // "The benchmarks failed.  Exiting."
+      }
+
+      while ( logQueueHasEntry() ) {
+         logDequeueAndDisplayMessage();
+      }
+
+      logCleanup();
+      logWerCleanup();
+
+      return br ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
+
+
+   /// If `/trace` is on the command line, then start the trace drain thread
+   logTraceInit();  // Failures are logged as warnings
+
+   /// If `/logfile` is on the command line, then start the log file's writer
+   logFileInit();   // Failures are logged as warnings
+
+   /// If `/service`, `/loadgen` or `/pcap` is on the command line, then run
+   /// it headless (no window and no audio device) and end
+   if ( dtmfServiceIsEnabled() || dtmfLoadGenIsEnabled() || dtmfPcapIsEnabled() ) {
+      if ( dtmfServiceIsEnabled() ) {
+         br = dtmfServiceRun();
+      } else if ( dtmfLoadGenIsEnabled() ) {
+         br = dtmfLoadGenRun();
+      } else {
+         br = dtmfPcapRun();
+      }
+      if ( !br ) {
+         LOG_FATAL_R( IDS_DTMF_DECODER_HEADLESS_FAILED );  // "The headless service, load generator or pcap reader failed.  Exiting."
+      }
+
+      logTraceCleanup();
+
+      while ( logQueueHasEntry() ) {
+         logDequeueAndDisplayMessage();
+      }
+
+      logCleanup();
+      logFileCleanup();
+      logWerCleanup();
+
+      return br ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
 
    /// Set #gbIsRunning to `true`.  Set it to `false` if we need to shutdown.
    /// For example, #gbIsRunning gets set to false by WM_CLOSE.
@@ -275,6 +371,19 @@ int APIENTRY wWinMain(
       return EXIT_FAILURE;
    }
 
+   /// Start the UI tick that redraws the tones the Goertzel threads changed
+   br = mvcViewStartRefresh( ghMainWindow );
+   if ( !br ) {
+      mvcViewCleanup();       // mvcViewStartRefresh logged the problem
+      mvcModelRelease();
+      CoUninitialize();       // Unwind COM
+      audioCleanup();
+      return EXIT_FAILURE;
+   }
+
+   /// If `/counters` is on the command line, then start writing the counters file
+   perfCountersStartDump( ghMainWindow );  // Failures are logged as warnings
+
    ShowWindow( ghMainWindow, nCmdShow );   // It's OK to ignore the result of ShowWindow
 
    LOG_INFO_R( IDS_DTMF_DECODER_APP_RESOURCES_READY );  // "All application resources were successfully initialized"
@@ -305,6 +414,10 @@ int APIENTRY wWinMain(
    br = audioStop();
    WARN_BR_R( IDS_DTMF_DECODER_FAILED_TO_STOP_AUDIO_DEVICE );  // "Failed to stop the audio device"
 
+   /// Write the final counters (the audio threads are done counting)
+   perfCountersWriteFile();
+   perfCountersLog();
+
    /// Cleanup all resources in the reverse order they were created
    br = audioCleanup();
    WARN_BR_R( IDS_DTMF_DECODER_FAILED_TO_CLEANUP_AUDIO );  // "Failed to clean up audio resources."
@@ -315,6 +428,10 @@ int APIENTRY wWinMain(
    br = goertzel_Release();
    WARN_BR_R( IDS_DTMF_DECODER_FAILED_TO_CLEANUP_DFT );  // "Failed to cleanup Goertzel DFT"
 
+   /// The threads that trace are done, so drain the last trace records
+   br = logTraceCleanup();
+   WARN_BR_R( IDS_DTMF_DECODER_FAILED_TO_CLEANUP_TRACE );  // "Failed to cleanup the trace logger."
+
    /// Print any entries in the log queue
    while ( logQueueHasEntry() ) {
       logDequeueAndDisplayMessage();
@@ -334,6 +451,9 @@ int APIENTRY wWinMain(
    br = logCleanup();
    WARN_BR_R( IDS_DTMF_DECODER_FAILED_TO_CLEANUP_LOGS );  // "Failed to cleanup the logs."
 
+   br = logFileCleanup();
+   WARN_BR_R( IDS_DTMF_DECODER_FAILED_TO_CLEANUP_LOG_FILE );  // "Failed to cleanup the log file."
+
    // The log can still be called even after it's been "cleaned up"
    if ( giApplicationReturnValue == EXIT_SUCCESS ) {
       LOG_INFO_R( IDS_DTMF_DECODER_ENDING_SUCCESSFULLY, sswTitle );  // "All %s resources were cleaned up.  Ending program:  SUCCESS."
@@ -404,15 +524,41 @@ LRESULT CALLBACK WndProc( HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam
          switch ( wParam ) {
             case VK_ESCAPE:  /// Exit the app (normally) when ESC is pressed
                // logTest();      // This is a good place to test the logger
+               // logQueueStressTest();  // ...and to stress the log queue
+               // logTraceBenchmark();   // ...and to compare the cost of the loggers
+               // logFileStormTest();    // ...and to flood the log file
+               // logFlightBenchmark();  // ...and to time and render the flight recorder
+               // goertzelBenchmark();  // ...and to benchmark the Goertzel kernels
+               // mvcModelDirtyTest();  // ...and to count the UI updates under a storm of toggles
+               // mvcSnapshotTest();    // ...and to stress the view's snapshots
+               // mvcHistoryTest();     // ...and to stress the spectrogram's history
+               // rtSchedJitterTest();  // ...and to measure the DSP threads' wake jitter
+               // numaPlaceTest();      // ...and to measure the streams' NUMA placement
+               // goertzelSlabTest();   // ...and to churn decoders while decoding
+               // timerWheelTest();     // ...and to run 100,000 digit timers
+               // dtmfEventsTest();     // ...and to time the event API
+               // goertzelTuneTest();   // ...and to check the autotuner's combinations
+               // perfLatencyDump();    // ...and to see the pipeline's latency
+               // perfCountersLog();    // ...and to see the pipeline's counters
                gracefulShutdown();
                break ;
             default:
                break ;
          }
          break ;
+      case WM_TIMER:    /// WM_TIMER - Redraw the tones that changed or write the performance counters file
+         if ( wParam == IDT_VIEW_REFRESH ) {
+            mvcViewRefresh();  // Failures are fatal and mvcViewRefresh handles them
+         } else if ( wParam == IDT_PERF_COUNTERS ) {
+            perfCountersWriteFile();  // Failures are logged as warnings
+         }
+         break;
       case WM_CLOSE:    /// WM_CLOSE - Start the process of closing the application
          gbIsRunning = false;
 
+         KillTimer( hWnd, IDT_VIEW_REFRESH );   // It's OK if the timer was never set
+         KillTimer( hWnd, IDT_PERF_COUNTERS );  // It's OK if the timer was never set
+
          br = DestroyWindow( hWnd );
          if ( !br ) {
             LOG_FATAL_Q( IDS_DTMF_DECODER_FAILED_TO_DESTROY_WINDOW );  // Failed to destroy window
@@ -28,9 +28,6 @@
 #define IDS_GOERTZEL_FAILED_TO_CREATE_DONEDFT_HANDLES 117
 #define IDS_GOERTZEL_FAILED_TO_CREATE_WORK_THREAD 118
 #define IDS_MODEL_FAILED_TO_MALLOC      119
-#define IDS_MODEL_FAILED_TO_INVALIDATE_REGION 120
-#define IDS_MODEL_FAILED_TO_INVALIDATE_COLUMN 121
-#define IDS_MODEL_FAILED_TO_INVALIDATE_ROW 122
 #define IDS_DTMF_DECODER_FAILED_TO_GET_MESSAGE 123
 #define IDS_DTMF_DECODER_FAILED_TO_PAINT 124
 #define IDS_DTMF_DECODER_FAILED_TO_END_PAINT 125
@@ -157,7 +154,7 @@
 #define IDS_AUDIO_FAILED_CLOSING_EVENT  233
 #define IDS_AUDIO_FAILED_TO_RELEASE_CLIENT 234
 #define IDS_AUDIO_FAILED_TO_RELEASE_PROPERTY 235
-#define IDS_LOG_MAXED_OUT_QUEUE         236
+#define IDS_LOG_QUEUE_DROPPED           236
 #define IDS_LOG_TEST_BASIC              237
 #define IDS_LOG_TEST_PARAMETERS         238
 #define IDS_LOG_TEST_PARAMETERS_Q       239
@@ -188,6 +185,187 @@
 #define IDS_AUDIO_FAILED_TO_DRAW_MENU   261
 #define IDS_AUDIO_START_SUCCESSFUL      262
 #define IDS_DTMF_DECODER_FAILED_TO_INITIALIZE_GOERTZEL 263
+#define IDS_GOERTZEL_BENCHMARK_RESULT   264
+#define IDS_GOERTZEL_BENCHMARK_TONE     265
+#define IDS_AUDIO_SIM_ENABLED           266
+#define IDS_AUDIO_SIM_INVALID_CONFIG    267
+#define IDS_AUDIO_SIM_FAILED_TO_OPEN_FILE 268
+#define IDS_AUDIO_SIM_FAILED_TO_READ_FILE 269
+#define IDS_AUDIO_SIM_FAILED_TO_ALLOCATE 270
+#define IDS_AUDIO_SIM_FAILED_TO_CREATE_TIMER 271
+#define IDS_AUDIO_SIM_FAILED_TO_CREATE_THREAD 272
+#define IDS_AUDIO_SIM_TIMER_FAILED      273
+#define IDS_AUDIO_SIM_START_THREAD      274
+#define IDS_AUDIO_SIM_END_THREAD        275
+#define IDS_AUDIO_SIM_STARTED           276
+#define IDS_AUDIO_SIM_THREAD_END_FAILED 277
+#define IDS_AUDIO_SIM_FAILED_TO_CLOSE_HANDLE 278
+#define IDS_AUDIO_SIM_STATISTICS        279
+#define IDS_DTMF_DECODER_FAILED_TO_PARSE_COMMAND_LINE 280
+#define IDS_AUDIO_SIM_FAILED_TO_START_SYNTHESIZER 281
+#define IDS_BENCHMARK_INVALID_FILE      282
+#define IDS_BENCHMARK_ENABLED           283
+#define IDS_BENCHMARK_FAILED_TO_OPEN_FILE 284
+#define IDS_BENCHMARK_FAILED_TO_WRITE_FILE 285
+#define IDS_BENCHMARK_FAILED_TO_START_CORPUS 286
+#define IDS_BENCHMARK_FAILED_TO_ALLOCATE 287
+#define IDS_BENCHMARK_RESULT            288
+#define IDS_BENCHMARK_DONE              289
+#define IDS_DTMF_DECODER_BENCHMARK_FAILED 290
+#define IDS_PERF_LATENCY_SUMMARY        291
+#define IDS_PERF_COUNTERS_INVALID_INTERVAL 292
+#define IDS_PERF_COUNTERS_INVALID_FILE  293
+#define IDS_PERF_COUNTERS_ENABLED       294
+#define IDS_PERF_COUNTERS_FAILED_TO_SET_TIMER 295
+#define IDS_PERF_COUNTERS_OUT_OF_SLOTS  296
+#define IDS_PERF_COUNTERS_FAILED_TO_WRITE_FILE 297
+#define IDS_PERF_COUNTERS_SUMMARY       298
+#define IDS_LOG_QUEUE_STRESS_RESULT     299
+#define IDS_LOG_TRACE_INVALID_FILE      300
+#define IDS_LOG_TRACE_FAILED_TO_OPEN_FILE 301
+#define IDS_LOG_TRACE_FAILED_TO_START_DRAINER 302
+#define IDS_LOG_TRACE_ENABLED           303
+#define IDS_LOG_TRACE_DROPPED           304
+#define IDS_LOG_TRACE_BENCHMARK         305
+#define IDS_LOG_TRACE_BENCHMARK_MESSAGE 306
+#define IDS_AUDIO_TRACE_BUFFER          307
+#define IDS_DTMF_DECODER_FAILED_TO_CLEANUP_TRACE 308
+#define IDS_LOG_FILE_INVALID_OPTION     309
+#define IDS_LOG_FILE_FAILED_TO_OPEN     310
+#define IDS_LOG_FILE_FAILED_TO_START_WRITER 311
+#define IDS_LOG_FILE_ENABLED            312
+#define IDS_LOG_FILE_DROPPED            313
+#define IDS_LOG_FILE_STORM_NOT_RUNNING  314
+#define IDS_LOG_FILE_STORM_RESULT       315
+#define IDS_DTMF_DECODER_FAILED_TO_CLEANUP_LOG_FILE 316
+#define IDS_LOG_FLIGHT_BENCHMARK        317
+#define IDS_DTMF_SERVICE_INVALID_OPTION 318
+#define IDS_DTMF_SERVICE_FAILED_TO_START_WINSOCK 319
+#define IDS_DTMF_SERVICE_FAILED_TO_ALLOCATE 320
+#define IDS_DTMF_SERVICE_FAILED_TO_LISTEN 321
+#define IDS_DTMF_SERVICE_FAILED_TO_START_THREADS 322
+#define IDS_DTMF_SERVICE_FAILED_TO_ACCEPT 323
+#define IDS_DTMF_SERVICE_ENABLED        324
+#define IDS_DTMF_SERVICE_STATS          325
+#define IDS_DTMF_LOADGEN_INVALID_OPTION 326
+#define IDS_DTMF_LOADGEN_FAILED_TO_ALLOCATE 327
+#define IDS_DTMF_LOADGEN_FAILED_TO_CONNECT 328
+#define IDS_DTMF_LOADGEN_FAILED_TO_START_THREADS 329
+#define IDS_DTMF_LOADGEN_FAILED_TO_OPEN_FILE 330
+#define IDS_DTMF_LOADGEN_FAILED_TO_WRITE_FILE 331
+#define IDS_DTMF_LOADGEN_ENABLED        332
+#define IDS_DTMF_LOADGEN_RESULT         333
+#define IDS_DTMF_LOADGEN_CPU            334
+#define IDS_DTMF_LOADGEN_CPU_CLIENT_ONLY 335
+#define IDS_DTMF_LOADGEN_DONE           336
+#define IDS_DTMF_DECODER_HEADLESS_FAILED 337
+#define IDS_DTMF_SHM_INVALID_OPTION     338
+#define IDS_DTMF_SHM_FAILED_TO_CREATE   339
+#define IDS_DTMF_SHM_ENABLED            340
+#define IDS_DTMF_SHM_STATS              341
+#define IDS_DTMF_SHM_FAILED_TO_ATTACH   342
+#define IDS_DTMF_LOADGEN_THROUGHPUT     343
+#define IDS_AUDIO_FORMAT_MULAW          344
+#define IDS_AUDIO_FORMAT_ALAW           345
+#define IDS_BENCHMARK_RESULT_G711       346
+#define IDS_DTMF_PCAP_INVALID_OPTION    347
+#define IDS_DTMF_PCAP_FAILED_TO_OPEN    348
+#define IDS_DTMF_PCAP_FAILED_TO_MAP     349
+#define IDS_DTMF_PCAP_NOT_PCAP          350
+#define IDS_DTMF_PCAP_UNSUPPORTED_LINK  351
+#define IDS_DTMF_PCAP_FAILED_TO_ALLOCATE 352
+#define IDS_DTMF_PCAP_FAILED_TO_START_THREAD 353
+#define IDS_DTMF_PCAP_FAILED_TO_OPEN_RESULTS 354
+#define IDS_DTMF_PCAP_FAILED_TO_WRITE_RESULTS 355
+#define IDS_DTMF_PCAP_STARTED           356
+#define IDS_DTMF_PCAP_TRUNCATED         357
+#define IDS_DTMF_PCAP_TOO_MANY_STREAMS  358
+#define IDS_DTMF_PCAP_DONE              359
+#define IDS_DTMF_PCAP_JITTER            360
+#define IDS_DTMF_PCAP_KEYS              361
+#define IDS_DTMF_PCAP_EVENTS_DROPPED    362
+#define IDS_AUDIO_RECORD_INVALID_CONFIG 363
+#define IDS_AUDIO_RECORD_ENABLED        364
+#define IDS_AUDIO_RECORD_FAILED_TO_OPEN 365
+#define IDS_AUDIO_RECORD_FAILED_TO_ALLOCATE 366
+#define IDS_AUDIO_RECORD_FAILED_TO_START 367
+#define IDS_AUDIO_RECORD_WRITE_FAILED   368
+#define IDS_AUDIO_RECORD_THREAD_END_FAILED 369
+#define IDS_AUDIO_RECORD_STATISTICS     370
+#define IDS_AUDIO_RECORD_NOT_EXACT      371
+#define IDS_AUDIO_RECORD_START_THREAD   372
+#define IDS_AUDIO_RECORD_END_THREAD     373
+#define IDS_AUDIO_REPLAY_ENABLED        374
+#define IDS_AUDIO_REPLAY_FAILED_TO_OPEN 375
+#define IDS_AUDIO_REPLAY_INVALID_FILE   376
+#define IDS_AUDIO_REPLAY_TRUNCATED      377
+#define IDS_AUDIO_REPLAY_NOT_EXACT      378
+#define IDS_AUDIO_REPLAY_FAILED_TO_ALLOCATE 379
+#define IDS_AUDIO_REPLAY_STARTED        380
+#define IDS_AUDIO_REPLAY_FINISHED       381
+#define IDS_AUDIO_REPLAY_FAILED_TO_START 382
+#define IDS_AUDIO_REPLAY_TIMER_FAILED   383
+#define IDS_AUDIO_REPLAY_THREAD_END_FAILED 384
+#define IDS_AUDIO_REPLAY_START_THREAD   385
+#define IDS_AUDIO_REPLAY_END_THREAD     386
+#define IDS_VIEW_FAILED_TO_SET_REFRESH_TIMER 387
+#define IDS_VIEW_FAILED_TO_INVALIDATE   388
+#define IDS_MODEL_DIRTY_TEST_FAILED_TO_START 389
+#define IDS_MODEL_DIRTY_TEST_RESULT     390
+#define IDS_MODEL_DIRTY_TEST_FAILED     391
+#define IDS_SNAPSHOT_TEST_FAILED_TO_START 392
+#define IDS_SNAPSHOT_TEST_RESULT        393
+#define IDS_SNAPSHOT_TEST_FAILED        394
+#define IDS_HISTORY_TEST_FAILED_TO_START 395
+#define IDS_HISTORY_TEST_RESULT         396
+#define IDS_HISTORY_TEST_FAILED         397
+#define IDS_VIEW_FAILED_TO_CREATE_SPECTROGRAM 398
+#define IDS_VIEW_FAILED_TO_UPDATE_SPECTROGRAM 399
+#define IDS_VIEW_FAILED_TO_CREATE_KEYPAD_ATLAS 400
+#define IDS_PERF_COUNTERS_PAINT_SUMMARY 401
+#define IDS_RT_SCHED_DISABLED           402
+#define IDS_RT_SCHED_INVALID_CPUS       403
+#define IDS_RT_SCHED_PINNING            404
+#define IDS_RT_SCHED_FAILED_TO_LOCK_MEMORY 405
+#define IDS_RT_SCHED_LOCKED_MEMORY      406
+#define IDS_RT_SCHED_FAILED_TO_PIN      407
+#define IDS_RT_SCHED_JITTER_FAILED_TO_START 408
+#define IDS_RT_SCHED_JITTER_RESULT      409
+#define IDS_NUMA_PLACE_DISABLED         410
+#define IDS_NUMA_PLACE_FAILED_TO_FIND_NODES 411
+#define IDS_NUMA_PLACE_NODES            412
+#define IDS_NUMA_PLACE_FAILED_TO_PIN    413
+#define IDS_NUMA_PLACE_FAILED_TO_ALLOCATE 414
+#define IDS_NUMA_PLACE_TEST_FAILED_TO_START 415
+#define IDS_NUMA_PLACE_TEST_RESULT      416
+#define IDS_NUMA_PLACE_TEST_REMOTE      417
+#define IDS_GOERTZEL_SLAB_TEST_RESULT   418
+#define IDS_GOERTZEL_SLAB_TEST_FAILED_TO_START 419
+#define IDS_GOERTZEL_SLAB_TEST_FAILED   420
+#define IDS_DTMF_PCAP_ENTRIES           421
+#define IDS_TIMER_WHEEL_TEST_RESULT     422
+#define IDS_TIMER_WHEEL_TEST_FAILED_TO_START 423
+#define IDS_TIMER_WHEEL_TEST_FAILED     424
+#define IDS_DTMF_EVENTS_FAILED_TO_OPEN  425
+#define IDS_DTMF_EVENTS_TEST_RESULT     426
+#define IDS_DTMF_EVENTS_TEST_FAILED_TO_START 427
+#define IDS_DTMF_EVENTS_TEST_FAILED     428
+#define IDS_GOERTZEL_TUNE_DISABLED      429
+#define IDS_GOERTZEL_TUNE_INVALID_FILE  430
+#define IDS_GOERTZEL_TUNE_CACHED        431
+#define IDS_GOERTZEL_TUNE_CANDIDATE     432
+#define IDS_GOERTZEL_TUNE_CHOSE         433
+#define IDS_GOERTZEL_TUNE_OVER_BUDGET   434
+#define IDS_GOERTZEL_TUNE_FAILED_TO_START 435
+#define IDS_GOERTZEL_TUNE_FAILED_TO_WRITE_FILE 436
+#define IDS_GOERTZEL_TUNE_TEST_RESULT   437
+#define IDS_GOERTZEL_TUNE_TEST_FAILED_TO_START 438
+#define IDS_GOERTZEL_TUNE_TEST_FAILED   439
+#define IDS_LOG_FILE_STORM_TIMED_OUT    440
+#define IDS_BENCHMARK_SELF_TESTS_FAILED 441
+#define IDS_VIEW_PAINT_DIRECTWRITE      442
+#define IDS_RT_SCHED_LOCKED_ALL_MEMORY  443
+#define IDS_RT_SCHED_JITTER_WINDOWS_ONLY 444
 #define IDC_PROGRAM_NAME                1000
 #define IDC_VERSION                     1001
 #define IDC_AUTHOR                      1002
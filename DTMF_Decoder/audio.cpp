@@ -33,8 +33,6 @@
 /// | `IAudioClient::GetService`                     | https://learn.microsoft.com/en-us/windows/win32/api/audioclient/nf-audioclient-iaudioclient-getservice                         |
 /// | `IAudioClient::SetEventHandle`                 | https://learn.microsoft.com/en-us/windows/win32/api/audioclient/nf-audioclient-iaudioclient-seteventhandle                     |
 /// | `IAudioClient::Start`                          | https://learn.microsoft.com/en-us/windows/win32/api/audioclient/nf-audioclient-iaudioclient-start                              |
-/// | `AvSetMmThreadCharacteristics`                 | https://learn.microsoft.com/en-us/windows/win32/api/avrt/nf-avrt-avsetmmthreadcharacteristicsa                                 |
-/// | `AvRevertMmThreadCharacteristics`              | https://learn.microsoft.com/en-us/windows/win32/api/avrt/nf-avrt-avrevertmmthreadcharacteristics                               |
 /// | `IAudioCaptureClient::GetBuffer`               | https://learn.microsoft.com/en-us/windows/win32/api/audioclient/nf-audioclient-iaudiocaptureclient-getbuffer                   |
 /// | `IAudioCaptureClient::ReleaseBuffer`           | https://learn.microsoft.com/en-us/windows/win32/api/audioclient/nf-audioclient-iaudiocaptureclient-releasebuffer               |
 /// | `IAudioClient::Stop`                           | https://learn.microsoft.com/en-us/windows/win32/api/audioclient/nf-audioclient-iaudioclient-stop                               |
@@ -76,15 +74,20 @@
 #include <AudioClient.h>  // For the audio API
 #include <Functiondiscoverykeys_devpkey.h>  // For some audio GUIDs
 #include <strsafe.h>      // For sprintf_s
-#include <avrt.h>         // For AvSetMmThreadCharacteristics
 #include <inttypes.h>     // For printf to format fixed-integers
 
 #include "audio.h"        // For yo bad self
+#include "audioSim.h"     // For the simulated audio device
+#include "audioRecord.h"  // For the recorder and the replay source
 #include "mvcModel.h"     // For the model
-#include "goertzel.h"     // For goertzel_compute_dtmf_tones
+#include "mvcSnapshot.h"  // For mvcSnapshotPublish
+#include "goertzel.h"     // For goertzel_compute_dtmf_tones and gGoertzelTuning
 #include "mvcView.h"      // For mvcViewRefreshWindow
-
-#pragma comment(lib, "avrt")  // Link the MMCSS library
+#include "perfLatency.h"  // For the latency instrumentation
+#include "perfCounters.h" // For the runtime performance counters
+#include "logTrace.h"     // For LOG_TRACE_B
+#include "logFlight.h"    // For logFlightReleaseRing
+#include "rtSched.h"      // For the real-time scheduling policy
 
 
 /// The share mode for the audio capture device.  It can be either
@@ -95,6 +98,14 @@
 /// @todo Consider supporting `EXCLUSIVE` audio device access someday (Issue #14)
 static AUDCLNT_SHAREMODE sShareMode = AUDCLNT_SHAREMODE_SHARED;
 
+/// The device position we expect the next buffer to start at.  Used to count
+/// buffers that go backwards as #PERF_COUNTER_OUT_OF_ORDER.
+static UINT64 su64NextFramePosition = 0;
+
+/// The frames captured since the DFT last ran.  The DFT runs once this
+/// reaches the hop (#goertzelTuning_t.uHopMs).
+static size_t sstFramesSinceAnalysis = 0;
+
 static IMMDevice*      spDevice             = NULL; ///< COM object for a multimedia device
 static LPWSTR          spwstrDeviceId       = NULL; ///< Device endpoint ID string `{0.0.1.00000000}.{722038ce-3a4e-4de0-8e7d-bd3fa6865a89}`
 static DWORD           sdwState             =    0; ///< The current device state `ACTIVE`, `DISABLED`, `NOT PRESENT` or `UNPLUGGED`
@@ -127,13 +138,92 @@ static IAudioCaptureClient* spCaptureClient = NULL; ///< The audio capture clien
 enum audio_format_t {
    UNKNOWN_AUDIO_FORMAT=0,  ///< An unknown audio format
    PCM_8,                   ///< 8-bit, linear PCM ranging from 0 to 255 where 0 is min, 127 is silence and 255 is max
-   IEEE_FLOAT_32            ///< 32-bit float values from -1 to +1
+   IEEE_FLOAT_32,           ///< 32-bit float values from -1 to +1
+   G711_ULAW_8,             ///< 8-bit G.711 mu-law (see g711.cpp)
+   G711_ALAW_8              ///< 8-bit G.711 A-law (see g711.cpp)
 };
 
 
 /// The audio format DTMF_Decoder is currently using
 static audio_format_t sAudioFormat = UNKNOWN_AUDIO_FORMAT;
 
+/// `true` if #audioCapture can hand a whole buffer to #pcmEnqueueG711
+/// (mono #PCM_8, #G711_ULAW_8 or #G711_ALAW_8) instead of calling
+/// #processAudioFrame for each frame
+static bool sbWholeBuffers = false;
+
+/// The law #pcmEnqueueG711 expands when #sbWholeBuffers is set
+static g711Law_t sLaw = G711_LINEAR;
+
+
+/// WASAPI's implementation of #audioSource_t.getBuffer
+///
+/// @see https://learn.microsoft.com/en-us/windows/win32/api/audioclient/nf-audioclient-iaudiocaptureclient-getbuffer
+static HRESULT audioWasapiGetBuffer(
+   _Out_       BYTE**  ppData,
+   _Out_       UINT32* pu32FramesToRead,
+   _Out_       DWORD*  pdwFlags,
+   _Out_opt_   UINT64* pu64DevicePosition,
+   _Out_opt_   UINT64* pu64QPCPosition ) {
+   _ASSERTE( spCaptureClient != NULL );
+
+   return spCaptureClient->GetBuffer( ppData, pu32FramesToRead, pdwFlags, pu64DevicePosition, pu64QPCPosition );
+}
+
+
+/// WASAPI's implementation of #audioSource_t.releaseBuffer
+///
+/// @see https://learn.microsoft.com/en-us/windows/win32/api/audioclient/nf-audioclient-iaudiocaptureclient-releasebuffer
+static HRESULT audioWasapiReleaseBuffer( _In_ const UINT32 u32FramesRead ) {
+   _ASSERTE( spCaptureClient != NULL );
+
+   return spCaptureClient->ReleaseBuffer( u32FramesRead );
+}
+
+
+/// The audio source backed by the WASAPI capture client
+static const audioSource_t sWasapiSource = {
+   audioWasapiGetBuffer,
+   audioWasapiReleaseBuffer
+};
+
+
+/// The audio source #audioCapture is reading from:  #sWasapiSource,
+/// #gAudioSimSource or #gAudioReplaySource (or #gAudioRecordSource in front
+/// of one of them).  Set in #audioStart.
+static const audioSource_t* spSource = NULL;
+
+
+/// @return `true` if the audio comes from the simulated device or a replay
+///         instead of WASAPI
+static bool audioIsSoftwareDevice() {
+   return audioSimIsEnabled() || audioReplayIsEnabled();
+}
+
+
+/// Point #audioCapture at an audio source.  If `/record` is on the command
+/// line, put the recorder in front of it.
+///
+/// @param pSource The audio source
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+static BOOL audioSetSource( _In_ const audioSource_t* pSource ) {
+   _ASSERTE( pSource != NULL );
+   _ASSERTE( spMixFormat != NULL );
+
+   if ( !audioRecordIsEnabled() ) {
+      spSource = pSource;
+      return TRUE;
+   }
+
+   if ( !audioRecordStart( pSource, spMixFormat ) ) {
+      return FALSE;
+   }
+
+   spSource = &gAudioRecordSource;
+
+   return TRUE;
+}
+
 
 /// Process the audio frameIndex, converting it into #PCM_8, adding the sample to
 /// #gPcmQueue and monitoring the values (if desired)
@@ -168,6 +258,12 @@ __forceinline static BOOL processAudioFrame(
       case PCM_8:
          ch1Sample = *( pData + ( (size_t) frameIndex * spMixFormat->nBlockAlign ) );
          break;
+      case G711_ULAW_8:
+         ch1Sample = gG711Expand[ G711_ULAW ][ *( pData + ( (size_t) frameIndex * spMixFormat->nBlockAlign ) ) ];
+         break;
+      case G711_ALAW_8:
+         ch1Sample = gG711Expand[ G711_ALAW ][ *( pData + ( (size_t) frameIndex * spMixFormat->nBlockAlign ) ) ];
+         break;
       default:
          _ASSERT_EXPR( FALSE, "Unknown audio format" );
    }
@@ -231,48 +327,108 @@ __forceinline static void audioCapture() {
    UINT32  framesAvailable;
    DWORD   flags;
    UINT64  framePosition;
+   UINT64  qpcPosition;
 
-   _ASSERTE( spCaptureClient != NULL );
+   _ASSERTE( spSource != NULL );
    _ASSERTE( sAudioFormat != UNKNOWN_AUDIO_FORMAT );
 
    // The following block of code is the core logic of DTMF_Decoder
 
-   /// Use GetBuffer to get a bunch of frames of audio from the capture client
-   hr = spCaptureClient->GetBuffer( &pData, &framesAvailable, &flags, &framePosition, NULL );
+   /// Use GetBuffer to get a bunch of frames of audio from the audio source
+   hr = spSource->getBuffer( &pData, &framesAvailable, &flags, &framePosition, &qpcPosition );
    if ( hr == S_OK ) {
       // LOG_TRACE( "I got data!" );
       _ASSERTE( pData != NULL );
 
+      LOG_TRACE_B( IDS_AUDIO_TRACE_BUFFER, framesAvailable, (UINT_PTR) framePosition, flags );  // "Buffer:  Frames: %zu   Position: %zu   Flags: 0x%zx"
+
+      /// Count buffers where the device position went backwards as out of order
+      if ( framePosition < su64NextFramePosition ) {
+         perfCountersAdd( PERF_COUNTER_OUT_OF_ORDER, 1 );
+      }
+      su64NextFramePosition = framePosition + framesAvailable;
+
       if ( flags == 0 ) {
          // Normal processing
-         for ( UINT32 i = 0 ; i < framesAvailable ; i++ ) {
-            processAudioFrame( pData, i );  // Process each audio frameIndex
+         LARGE_INTEGER dspStart;
+         LARGE_INTEGER dspEnd;
+
+         QueryPerformanceCounter( &dspStart );
+
+         /// Start the latency clock from when the newest frame was recorded
+         perfLatencyBeginBuffer( qpcPosition, framesAvailable, spMixFormat->nSamplesPerSec );
+
+         /// Mono 8-bit buffers (linear or G.711) are expanded straight into
+         /// #gPcmQueue.  Everything else is converted a frame at a time.
+         #ifdef MONITOR_PCM_AUDIO
+            const bool bWholeBuffers = false;  // The monitor watches every frame
+         #else
+            const bool bWholeBuffers = sbWholeBuffers;
+         #endif
+
+         if ( bWholeBuffers ) {
+            pcmEnqueueG711( sLaw, pData, framesAvailable );
+         } else {
+            for ( UINT32 i = 0 ; i < framesAvailable ; i++ ) {
+               processAudioFrame( pData, i );  // Process each audio frameIndex
+            }
          }
 
+         perfLatencyStamp( PERF_STAGE_CONVERT );
+
          /// Make sure #gPcmQueue is healthy
          _ASSERTE( _CrtCheckMemory() );
 
-         /// After all of the frames have been queued, compute the DFT
+         /// After all of the frames have been queued, compute the DFT (once
+         /// a hop's worth of frames have arrived since the last time)
          ///
-         /// Note:  This thread will wait, signal 8 DFT threads to run, then
+         /// Note:  This thread will wait, signal the DFT threads to run, then
          ///        will continue after the DFT threads are done
-         br = goertzel_compute_dtmf_tones();
-         CHECK_BR_Q( IDS_AUDIO_FAILED_TO_COMPUTE_DTMF_TONES, 0 );  // "Failed to compute DTMF tones.  Exiting.  Investigate!"
+         const size_t stHopFrames = (size_t) gGoertzelTuning.uHopMs * spMixFormat->nSamplesPerSec / 1000;
+
+         sstFramesSinceAnalysis += framesAvailable;
+
+         if ( sstFramesSinceAnalysis >= stHopFrames ) {
+            sstFramesSinceAnalysis = 0;
+
+            perfLatencyStamp( PERF_STAGE_DFT_DISPATCH );
+
+            br = goertzel_compute_dtmf_tones();
+            CHECK_BR_Q( IDS_AUDIO_FAILED_TO_COMPUTE_DTMF_TONES, 0 );  // "Failed to compute DTMF tones.  Exiting.  Investigate!"
+
+            perfLatencyStamp( PERF_STAGE_DFT_DONE );
+
+            /// All 8 tones are done, so publish them to the view as one snapshot
+            mvcSnapshotPublish( qpcPosition );
+         }
+
+         QueryPerformanceCounter( &dspEnd );
+
+         perfCountersAdd( PERF_COUNTER_BUFFERS, 1 );
+         perfCountersAdd( PERF_COUNTER_FRAMES, framesAvailable );
+         perfCountersAdd( PERF_COUNTER_DSP_TICKS, (UINT64) ( dspEnd.QuadPart - dspStart.QuadPart ) );
+         perfCountersMax( PERF_MAX_FRAMES_PER_BUFFER, framesAvailable );
+         perfCountersMax( PERF_MAX_DSP_TICKS, (UINT64) ( dspEnd.QuadPart - dspStart.QuadPart ) );
+      } else {
+         perfCountersAdd( PERF_COUNTER_GATED_BUFFERS, 1 );
       }
 
       /// Carefully analyze the flags returned by GetBuffer
       if ( flags & AUDCLNT_BUFFERFLAGS_SILENT ) {
          LOG_INFO_R( IDS_AUDIO_BUFFER_SILENT );  // "Buffer flag set: SILENT"
+         perfCountersAdd( PERF_COUNTER_SILENT, 1 );
          // Nothing so see here.  Move along.
          flags &= ~AUDCLNT_BUFFERFLAGS_SILENT;  // Clear AUDCLNT_BUFFERFLAGS_SILENT from flags
       }
       if ( flags & AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY ) {
          LOG_INFO_R( IDS_AUDIO_BUFFER_DISCONTINUOUS );  // "Buffer flag set: DATA_DISCONTINUITY"
+         perfCountersAdd( PERF_COUNTER_DISCONTINUITIES, 1 );
          // Throw these packets out
          flags &= ~AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY;  // Clear AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY from flags
       }
       if ( flags & AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR ) {
          LOG_INFO_R( IDS_AUDIO_BUFFER_TIMESTAMP_MISALIGNED );  // "Buffer flag set: TIMESTAMP_ERROR"
+         perfCountersAdd( PERF_COUNTER_TIMESTAMP_ERRORS, 1 );
          // Throw these packets out
          flags &= ~AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR;  // Clear AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR from flags
       }
@@ -319,7 +475,7 @@ processAudioFrame: Channel 1:  Min: 125   Max: 129
             }
          #endif
 
-         hr = spCaptureClient->ReleaseBuffer( framesAvailable );
+         hr = spSource->releaseBuffer( framesAvailable );
          if ( hr != S_OK ) {
             QUEUE_FATAL( IDS_AUDIO_FAILED_TO_RELEASE_AUDIO_BUFFER );  // "ReleaseBuffer didn't return S_OK.  Exiting.  Investigate!"
          }
@@ -327,8 +483,10 @@ processAudioFrame: Channel 1:  Min: 125   Max: 129
 
    } else if ( hr == AUDCLNT_S_BUFFER_EMPTY ) {
       LOG_INFO_R( IDS_AUDIO_GETBUFFER_EMPTY );  // "GetBuffer returned an empty buffer.  Continue."
+      perfCountersAdd( PERF_COUNTER_EMPTY, 1 );
    } else if ( hr == AUDCLNT_E_OUT_OF_ORDER ) {
       LOG_INFO_R( IDS_AUDIO_GETBUFFER_NOT_SEQUENTIAL );  // "GetBuffer returned out of order data.  Continue."
+      perfCountersAdd( PERF_COUNTER_OUT_OF_ORDER, 1 );
    } else {
       /// If the audio device changes (unplugged, for example) then GetBuffer
       /// will return something unexpected and we should see it here.  If this
@@ -339,6 +497,15 @@ processAudioFrame: Channel 1:  Min: 125   Max: 129
 }
 
 
+/// Release the per-thread logging and performance slots the capture thread
+/// claimed.  Every way out of #audioCaptureThread goes through here.
+static void audioCaptureThreadRelease() {
+   perfCountersReleaseSlot();
+   logTraceReleaseRing();
+   logFlightReleaseRing();
+}
+
+
 /// This thread waits for the audio device to call us back when it has some
 /// data to process.
 ///
@@ -347,25 +514,25 @@ processAudioFrame: Channel 1:  Min: 125   Max: 129
 /// @param Context Not used
 /// @return Return `0` if successful.  `0xFFFF `if there was a problem.
 DWORD WINAPI audioCaptureThread( LPVOID Context ) {
-   LOG_TRACE_R( IDS_AUDIO_START_THREAD );  // "Start capture thread"
+   LOG_TRACE_B( IDS_AUDIO_START_THREAD );  // "Start capture thread"
 
-   HRESULT hr;                  // HRESULT result
-   HANDLE  mmcssHandle = NULL;
+   HRESULT         hr;        // HRESULT result
+   rtSchedThread_t rtThread;  // The thread's scheduling policy
 
    /// Initialize COM for the thread
    hr = CoInitializeEx( NULL, COINIT_MULTITHREADED );
    if ( hr != S_OK ) {
       QUEUE_FATAL( IDS_DTMF_DECODER_FAILED_TO_INITIALIZE_COM );  // "Failed to initialize COM."
+      audioCaptureThreadRelease();
       ExitThread( 0xFFFF );
    }
 
-   /// Set the multimedia class scheduler service, which will set the CPU
-   /// priority for this thread
-   mmcssHandle = AvSetMmThreadCharacteristicsW( L"Capture", &gdwMmcssTaskIndex );
-   if ( mmcssHandle == NULL ) {
+   /// Put the thread under the real-time scheduling policy (MMCSS, which
+   /// will set the CPU priority for this thread, and any pinning)
+   if ( !rtSchedEnter( RT_SCHED_ROLE_CAPTURE, 0, &rtThread ) ) {
       LOG_INFO_R( IDS_AUDIO_FAILED_TO_SET_MMCSS );  // "Failed to set MMCSS on the audio capture thread.  Continuing."
    } else {
-      LOG_TRACE_R( IDS_AUDIO_SET_MMCSS );  // "Set MMCSS on the audio capture thread."
+      LOG_TRACE_B( IDS_AUDIO_SET_MMCSS );  // "Set MMCSS on the audio capture thread."
    }
 
    #ifdef MONITOR_PCM_AUDIO
@@ -389,16 +556,15 @@ DWORD WINAPI audioCaptureThread( LPVOID Context ) {
 
    // Done.  Time to cleanup the thread
 
-   if ( mmcssHandle != NULL ) {
-      if ( !AvRevertMmThreadCharacteristics( mmcssHandle ) ) {
-         LOG_INFO_R( IDS_AUDIO_FAILED_TO_REVERT_MMCSS );  // "Failed to revert MMCSS on the audio capture thread.  Continuing."
-      }
-      mmcssHandle = NULL;
+   if ( !rtSchedLeave( &rtThread ) ) {
+      LOG_INFO_R( IDS_AUDIO_FAILED_TO_REVERT_MMCSS );  // "Failed to revert MMCSS on the audio capture thread.  Continuing."
    }
 
    CoUninitialize();
 
-   LOG_TRACE_R( IDS_AUDIO_END_THREAD );  // "End audio capture thread"
+   LOG_TRACE_B( IDS_AUDIO_END_THREAD );  // "End audio capture thread"
+
+   audioCaptureThreadRelease();
 
    ExitThread( 0 );
 }
@@ -445,6 +611,10 @@ static BOOL audioPrintWaveFormat( _In_ const WAVEFORMATEX* pFmt ) {
          LOG_DEBUG_R( IDS_AUDIO_FORMAT_PCM );      // "Wave format is PCM"
       } else if ( pFmt->wFormatTag == WAVE_FORMAT_IEEE_FLOAT ) {
          LOG_DEBUG_R( IDS_AUDIO_FORMAT_FLOAT );    // "Wave format is IEEE Float"
+      } else if ( pFmt->wFormatTag == WAVE_FORMAT_MULAW ) {
+         LOG_DEBUG_R( IDS_AUDIO_FORMAT_MULAW );    // "Wave format is G.711 mu-law"
+      } else if ( pFmt->wFormatTag == WAVE_FORMAT_ALAW ) {
+         LOG_DEBUG_R( IDS_AUDIO_FORMAT_ALAW );     // "Wave format is G.711 A-law"
       } else {
          LOG_DEBUG_R( IDS_AUDIO_FORMAT_UNKNOWN );  // "Wave format is not recognized"
       }
@@ -489,6 +659,185 @@ BOOL audioInit() {
 }
 
 
+/// Set #sAudioFormat, #sLaw and #sbWholeBuffers from #spMixFormat
+///
+/// @return `TRUE` if successful.  `FALSE` if DTMF_Decoder doesn't support
+///         the format.
+static BOOL audioMatchFormat() {
+   _ASSERTE( spMixFormat != NULL );
+
+   sAudioFormat = UNKNOWN_AUDIO_FORMAT;
+
+   if ( spMixFormat->wFormatTag == WAVE_FORMAT_PCM && spMixFormat->wBitsPerSample == 8 ) {
+      sAudioFormat = PCM_8;
+   } else if ( spMixFormat->wFormatTag == WAVE_FORMAT_IEEE_FLOAT && spMixFormat->wBitsPerSample == 32 ) {
+      sAudioFormat = IEEE_FLOAT_32;
+   } else if ( spMixFormat->wFormatTag == WAVE_FORMAT_EXTENSIBLE ) {
+      WAVEFORMATEXTENSIBLE* pFmtEx = (WAVEFORMATEXTENSIBLE*) spMixFormat;
+
+      if ( pFmtEx->SubFormat == KSDATAFORMAT_SUBTYPE_PCM && pFmtEx->Samples.wValidBitsPerSample == 8 ) {
+         sAudioFormat = PCM_8;
+      } else if ( pFmtEx->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT && pFmtEx->Samples.wValidBitsPerSample == 32 ) {
+         sAudioFormat = IEEE_FLOAT_32;
+      }
+   } else if ( spMixFormat->wFormatTag == WAVE_FORMAT_MULAW && spMixFormat->wBitsPerSample == 8 ) {
+      sAudioFormat = G711_ULAW_8;
+   } else if ( spMixFormat->wFormatTag == WAVE_FORMAT_ALAW && spMixFormat->wBitsPerSample == 8 ) {
+      sAudioFormat = G711_ALAW_8;
+   }
+
+   if ( sAudioFormat == UNKNOWN_AUDIO_FORMAT ) {
+      RETURN_FATAL( IDS_AUDIO_FAILED_TO_MATCH_FORMAT );  // "Failed to match with the audio format"
+   }
+
+   /// Mono 8-bit formats can be expanded a whole buffer at a time
+   sLaw           = ( sAudioFormat == G711_ULAW_8 ) ? G711_ULAW : ( sAudioFormat == G711_ALAW_8 ) ? G711_ALAW : G711_LINEAR;
+   sbWholeBuffers = ( sAudioFormat != IEEE_FLOAT_32 && spMixFormat->nBlockAlign == 1 );
+
+   return TRUE;
+}
+
+
+/// Start a software audio device (the simulated device or a replay) after
+/// its mix format is set:  Start the DFT, the capture thread and then the
+/// device.
+///
+/// @param pSource  The device's audio source
+/// @param pfnStart Starts the device.  It signals the event it's given when
+///                 a buffer is ready.
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+static BOOL audioRunSoftwareDevice(
+   _In_ const audioSource_t* pSource,
+   _In_ BOOL ( *pfnStart )( _In_ const HANDLE hSamplesReadyEvent ) ) {
+
+   BOOL br;  // BOOL result
+
+   _ASSERTE( spMixFormat != NULL );
+   _ASSERTE( sAudioFormat != UNKNOWN_AUDIO_FORMAT );
+
+   LOG_DEBUG_R( IDS_AUDIO_MIX_FORMAT );  // "The mix format follows:"
+   audioPrintWaveFormat( spMixFormat );
+
+   /// - Initialize the DTMF buffer and start the Goertzel DFT threads
+   br = pcmSetQueueSize( (size_t) spMixFormat->nSamplesPerSec / 1000 * SIZE_OF_QUEUE_IN_MS );
+   CHECK_BR_R( IDS_AUDIO_FAILED_PCM_MALLOC );  // "Failed to allocate PCM queue"
+
+   LOG_INFO_R( IDS_AUDIO_QUEUE_SIZE, gstQueueSize, SIZE_OF_QUEUE_IN_MS );  // "Queue size=%zu bytes or %d ms"
+
+   br = goertzel_Start( spMixFormat->nSamplesPerSec );
+   CHECK_BR_R( IDS_AUDIO_FAILED_TO_START_GOERTZEL );  // "Failed to start Goertzel DFT worker threads.  Exiting."
+
+   br = audioSetSource( pSource );
+   if ( !br ) {
+      return FALSE;
+   }
+
+   /// - Start the capture thread, then the device
+   shCaptureThread = CreateThread( NULL, 0, audioCaptureThread, NULL, 0, NULL );
+   if ( shCaptureThread == NULL ) {
+      RETURN_FATAL( IDS_AUDIO_FAILED_TO_CREATE_CAPTURE_THREAD );  // "Failed to create the audio capture thread"
+   }
+
+   br = pfnStart( ghAudioSamplesReadyEvent );
+   CHECK_BR_R( IDS_AUDIO_FAILED_TO_START_CAPTURE_STREAM );  // "Failed to start capturing the audio stream"
+
+   /// - Enable the `End Capture` menu item
+   br = EnableMenuItem( ghMainMenu, IDM_AUDIO_ENDCAPTURE, MF_ENABLED );
+   if ( br == -1 ) {
+      RETURN_FATAL( IDS_AUDIO_FAILED_TO_SET_MENU_STATE );  // "Failed to set menu state.  Exiting."
+   }
+
+   LOG_INFO_R( IDS_AUDIO_START_SUCCESSFUL );  // "The audio capture device has started."
+
+   return TRUE;
+}
+
+
+/// Start the simulated audio device and the audio capture thread.  This is
+/// the #audioSimIsEnabled path through #audioStart.
+///
+/// The simulated device produces mono #PCM_8 frames.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+static BOOL audioStartSimulatedDevice() {
+   _ASSERTE( spMixFormat == NULL );
+
+   /// #### Function
+
+   /// - Make a mix format for the simulated device.  Allocate it with
+   ///   CoTaskMemAlloc, so #audioStop can free it the same way it frees
+   ///   WASAPI's.
+   spMixFormat = (WAVEFORMATEX*) CoTaskMemAlloc( sizeof( WAVEFORMATEX ) );
+   if ( spMixFormat == NULL ) {
+      RETURN_FATAL( IDS_AUDIO_SIM_FAILED_TO_ALLOCATE );  // "Failed to allocate memory for the simulated audio device.  Exiting."
+   }
+
+   ZeroMemory( spMixFormat, sizeof( WAVEFORMATEX ) );
+   spMixFormat->wFormatTag      = WAVE_FORMAT_PCM;
+   spMixFormat->nChannels       = 1;
+   spMixFormat->nSamplesPerSec  = audioSimGetSampleRate();
+   spMixFormat->nAvgBytesPerSec = spMixFormat->nSamplesPerSec;
+   spMixFormat->nBlockAlign     = 1;
+   spMixFormat->wBitsPerSample  = 8;
+
+   sAudioFormat = PCM_8;
+   sLaw         = audioSimGetLaw();
+
+   if ( sLaw == G711_ULAW ) {
+      spMixFormat->wFormatTag = WAVE_FORMAT_MULAW;
+      sAudioFormat            = G711_ULAW_8;
+   } else if ( sLaw == G711_ALAW ) {
+      spMixFormat->wFormatTag = WAVE_FORMAT_ALAW;
+      sAudioFormat            = G711_ALAW_8;
+   }
+
+   sbWholeBuffers = true;
+
+   return audioRunSoftwareDevice( &gAudioSimSource, audioSimStart );
+}
+
+
+/// Start replaying a recording and the audio capture thread.  This is the
+/// #audioReplayIsEnabled path through #audioStart.
+///
+/// The mix format comes from the recording, so the replay goes through the
+/// same conversions the original buffers went through.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+static BOOL audioStartReplay() {
+   BOOL br;  // BOOL result
+
+   _ASSERTE( spMixFormat == NULL );
+
+   /// #### Function
+
+   /// - Open the recording and copy its mix format with CoTaskMemAlloc, so
+   ///   #audioStop can free it the same way it frees WASAPI's
+   const WAVEFORMATEX* pFormat;
+   UINT32              u32FormatBytes;
+
+   br = audioReplayOpen( &pFormat, &u32FormatBytes );
+   if ( !br ) {
+      return FALSE;
+   }
+
+   spMixFormat = (WAVEFORMATEX*) CoTaskMemAlloc( u32FormatBytes );
+   if ( spMixFormat == NULL ) {
+      RETURN_FATAL( IDS_AUDIO_REPLAY_FAILED_TO_ALLOCATE );  // "Failed to allocate memory for the replay.  Exiting."
+   }
+
+   memcpy( spMixFormat, pFormat, u32FormatBytes );
+
+   /// - Match the format just like #audioStart does for WASAPI
+   br = audioMatchFormat();
+   if ( !br ) {
+      return FALSE;
+   }
+
+   return audioRunSoftwareDevice( &gAudioReplaySource, audioReplayStart );
+}
+
+
 /// Start the audio capture thread
 ///
 /// @return `TRUE` if successful.  `FALSE` if there was a problem.
@@ -506,6 +855,23 @@ BOOL audioStart() {
       RETURN_FATAL( IDS_AUDIO_FAILED_TO_SET_MENU_STATE );  // "Failed to set menu state.  Exiting."
    }
 
+   /// Clear the latency histograms from the last run
+   perfLatencyReset();
+
+   /// A new stream starts at device position `0`
+   su64NextFramePosition = 0;
+   sstFramesSinceAnalysis = 0;
+
+   /// If the command line asked for it, use the simulated audio device
+   if ( audioSimIsEnabled() ) {
+      return audioStartSimulatedDevice();
+   }
+
+   /// If the command line asked for it, replay a recording
+   if ( audioReplayIsEnabled() ) {
+      return audioStartReplay();
+   }
+
 
    /// Get IMMDeviceEnumerator from COM (CoCreateInstance)
    IMMDeviceEnumerator* deviceEnumerator = NULL;
@@ -607,28 +973,11 @@ BOOL audioStart() {
    }
 
    /// Determine the audio format
-   sAudioFormat = UNKNOWN_AUDIO_FORMAT;
-
-   if ( spMixFormat->wFormatTag == WAVE_FORMAT_PCM && spMixFormat->wBitsPerSample == 8 ) {
-      sAudioFormat = PCM_8;
-   } else if ( spMixFormat->wFormatTag == WAVE_FORMAT_IEEE_FLOAT && spMixFormat->wBitsPerSample == 32 ) {
-      sAudioFormat = IEEE_FLOAT_32;
-   } else if ( spMixFormat->wFormatTag == WAVE_FORMAT_EXTENSIBLE ) {
-      WAVEFORMATEXTENSIBLE* pFmtEx = (WAVEFORMATEXTENSIBLE*) spMixFormat;
-
-      if ( pFmtEx->SubFormat == KSDATAFORMAT_SUBTYPE_PCM && pFmtEx->Samples.wValidBitsPerSample == 8 ) {
-         sAudioFormat = PCM_8;
-      } else if ( pFmtEx->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT && pFmtEx->Samples.wValidBitsPerSample == 32 ) {
-         sAudioFormat = IEEE_FLOAT_32;
-      }
-   }
-
-   if ( sAudioFormat == UNKNOWN_AUDIO_FORMAT ) {
-      RETURN_FATAL( IDS_AUDIO_FAILED_TO_MATCH_FORMAT );  // "Failed to match with the audio format"
+   br = audioMatchFormat();
+   if ( !br ) {
+      return FALSE;
    }
 
-   _ASSERTE( sAudioFormat != UNKNOWN_AUDIO_FORMAT );
-
    /// Initialize shared mode audio client
    //  Shared mode streams using event-driven buffering must set both periodicity and bufferDuration to 0.
    hr = spAudioClient->Initialize( sShareMode, AUDCLNT_STREAMFLAGS_EVENTCALLBACK
@@ -670,6 +1019,11 @@ BOOL audioStart() {
    hr = spAudioClient->GetService( IID_PPV_ARGS( &spCaptureClient ) );
    CHECK_HR_R( IDS_AUDIO_FAILED_TO_GET_CAPTURE_CLIENT );  // "Failed to get capture client"
 
+   br = audioSetSource( &sWasapiSource );
+   if ( !br ) {
+      return FALSE;
+   }
+
    /// Start the thread
    shCaptureThread = CreateThread( NULL, 0, audioCaptureThread, NULL, 0, NULL );
    if ( shCaptureThread == NULL ) {
@@ -717,12 +1071,17 @@ BOOL audioStop() {
    /// Start by setting #gbIsRunning to `FALSE` -- just to be sure
    gbIsRunning = false;
 
-   _ASSERTE( spAudioClient != NULL );
+   _ASSERTE( spAudioClient != NULL || audioIsSoftwareDevice() );
    _ASSERTE( ghAudioSamplesReadyEvent != NULL );
    _ASSERTE( shCaptureThread != NULL );
 
-   hr = spAudioClient->Stop();
-   CHECK_HR_R( IDS_AUDIO_STOP_FAILED );  // "Stopping the audio stream returned an unexpected value.  Investigate!!"
+   /// The simulated device and the replay are stopped after the capture
+   /// thread ends (below), because the capture thread may still be reading
+   /// their buffers
+   if ( !audioIsSoftwareDevice() ) {
+      hr = spAudioClient->Stop();
+      CHECK_HR_R( IDS_AUDIO_STOP_FAILED );  // "Stopping the audio stream returned an unexpected value.  Investigate!!"
+   }
 
    /// Trigger the audio capture threads to loop...
    /// with #gbIsRunning `== FALSE` causing the loop to terminate
@@ -742,9 +1101,28 @@ BOOL audioStop() {
 
    shCaptureThread = NULL;
 
+   if ( audioSimIsEnabled() ) {
+      br = audioSimStop();
+      CHECK_BR_R( IDS_AUDIO_STOP_FAILED );  // "Stopping the audio stream returned an unexpected value.  Investigate!!"
+   } else if ( audioReplayIsEnabled() ) {
+      br = audioReplayStop();
+      CHECK_BR_R( IDS_AUDIO_STOP_FAILED );  // "Stopping the audio stream returned an unexpected value.  Investigate!!"
+   }
+
+   /// Write the rest of the recording
+   if ( audioRecordIsEnabled() ) {
+      br = audioRecordStop();
+      CHECK_BR_R( IDS_AUDIO_STOP_FAILED );  // "Stopping the audio stream returned an unexpected value.  Investigate!!"
+   }
+
    br = goertzel_Stop();
    WARN_BR_R( IDS_DTMF_DECODER_FAILED_TO_END_DFT_THREADS );  // "Failed to end the Goertzel DFT threads"
 
+   /// Log the pipeline's latency
+   perfLatencyDump();
+
+   spSource = NULL;
+
    SAFE_RELEASE( spCaptureClient );
 
    if ( spAudioClient != NULL ) {
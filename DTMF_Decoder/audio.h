@@ -15,6 +15,29 @@
 #include <Windows.h>  // For BOOL
 
 
+/// A source of audio buffers.  #audioCapture pulls buffers from the current
+/// source the same way it pulls them from `IAudioCaptureClient`, so the
+/// capture loop doesn't care if the audio comes from WASAPI or from a
+/// simulated device.
+///
+/// The members follow the contract of `IAudioCaptureClient::GetBuffer` and
+/// `IAudioCaptureClient::ReleaseBuffer`.
+///
+/// @see https://learn.microsoft.com/en-us/windows/win32/api/audioclient/nf-audioclient-iaudiocaptureclient-getbuffer
+typedef struct {
+   /// Get the next buffer of audio frames
+   HRESULT (*getBuffer)(
+      _Out_       BYTE**  ppData,
+      _Out_       UINT32* pu32FramesToRead,
+      _Out_       DWORD*  pdwFlags,
+      _Out_opt_   UINT64* pu64DevicePosition,
+      _Out_opt_   UINT64* pu64QPCPosition );
+
+   /// Release the buffer returned by #getBuffer
+   HRESULT (*releaseBuffer)( _In_ const UINT32 u32FramesRead );
+} audioSource_t;
+
+
 extern BOOL audioInit();
 extern BOOL audioStart();
 extern BOOL audioStop();
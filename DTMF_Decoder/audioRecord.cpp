@@ -0,0 +1,904 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Record the capture buffers to a file and replay them through the pipeline
+///
+/// The problems we see in the field (bursty buffers, discontinuities, a
+/// device that runs late) can't be reproduced, because #audioCapture
+/// consumes each buffer and throws it away.  With `/record`, every buffer
+/// `GetBuffer` returns -- its raw bytes, frame count, flags, device position
+/// and timestamps -- is appended to a recording (see audioRecord.h).  With
+/// `/replay`, the recording takes the place of the audio device and its
+/// buffers go through exactly the same code they went through the first
+/// time.
+///
+///     DTMF_Decoder.exe /record[:"C:\DTMF_Decoder.drec"]
+///     DTMF_Decoder.exe /replay[:"C:\DTMF_Decoder.drec"] [/replayfast] [/replayexit]
+///
+/// #### The Recorder
+/// The recorder is an #audioSource_t that sits in front of the real source
+/// (WASAPI or the simulated device).  The capture thread can't wait on the
+/// disk, so it copies each buffer into a single-producer/single-consumer
+/// byte ring and returns.  A writer thread wakes up every
+/// #AUDIO_RECORD_WRITE_MS and writes everything in the ring with as few
+/// `WriteFile` calls as it can (like logFile.cpp).  If the ring is full, the
+/// buffer is dropped and counted in the next buffer's
+/// #audioRecordBuffer_t.u32Dropped, so a replay knows the recording isn't
+/// bit-exact.
+///
+/// #### The Replay Source
+/// The recording is mapped into memory and prefetched, so the disk stays out
+/// of the measurements.  #audioCapture gets pointers straight into the
+/// mapping.  At the original pacing, a replay thread releases each buffer
+/// when it arrived the first time (relative to the first buffer), on a
+/// high-resolution waitable timer.  With `/replayfast`, every buffer is
+/// available at once and the pipeline runs as fast as it can.  Either way,
+/// the timestamps are moved to the present (keeping each buffer's original
+/// lag) so the latency instrumentation still works.  When the last buffer
+/// is released, the replay logs how long it took and, with `/replayexit`,
+/// ends the program.
+///
+/// ## File API
+/// | API                     | Link                                                                                                  |
+/// |-------------------------| ------------------------------------------------------------------------------------------------------|
+/// | `CreateFileW`           | https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-createfilew                    |
+/// | `WriteFile`             | https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-writefile                      |
+/// | `GetFileSizeEx`         | https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-getfilesizeex                  |
+/// | `CreateFileMappingW`    | https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-createfilemappingw         |
+/// | `MapViewOfFile`         | https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-mapviewoffile              |
+/// | `PrefetchVirtualMemory` | https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-prefetchvirtualmemory      |
+/// | `UnmapViewOfFile`       | https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-unmapviewoffile            |
+///
+/// ## Threads & Synchronization API
+/// | API                      | Link                                                                                                    |
+/// |--------------------------|---------------------------------------------------------------------------------------------------------|
+/// | `CreateThread`           | https://learn.microsoft.com/en-us/windows/win32/api/processthreadsapi/nf-processthreadsapi-createthread |
+/// | `CreateWaitableTimerExW` | https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-createwaitabletimerexw         |
+/// | `SetWaitableTimer`       | https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-setwaitabletimer               |
+/// | `WaitForMultipleObjects` | https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-waitformultipleobjects         |
+///
+/// @file    audioRecord.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <AudioClient.h>  // For AUDCLNT_S_BUFFER_EMPTY
+#include <malloc.h>       // For _malloc_dbg and _free_dbg
+
+#include "dtmfService.h"  // For dtmfServiceParsePath
+#include "audioSim.h"     // For audioSimIsEnabled
+#include "logTrace.h"     // For LOG_TRACE_B
+#include "logFlight.h"    // For logFlightReleaseRing
+#include "audioRecord.h"  // For yo bad self
+
+
+/// The recording when `/record` or `/replay` doesn't name one
+#define AUDIO_RECORD_DEFAULT_FILE L"DTMF_Decoder.drec"
+
+/// The size of the ring between the capture thread and the writer thread.
+/// Must be a power of 2.  8MB holds 20 seconds of 48kHz stereo float.
+#define AUDIO_RECORD_RING_BYTES   (8 * 1024 * 1024)
+static_assert( ( AUDIO_RECORD_RING_BYTES & ( AUDIO_RECORD_RING_BYTES - 1 ) ) == 0, "AUDIO_RECORD_RING_BYTES must be a power of 2" );
+
+/// How often the writer thread empties the ring (in ms)
+#define AUDIO_RECORD_WRITE_MS     (50)
+
+
+// The recorder
+static bool   sbRecord              = false;  ///< `true` if `/record` is on the command line
+static WCHAR  swsRecordFile[ MAX_PATH ] = AUDIO_RECORD_DEFAULT_FILE;  ///< The recording we're writing
+static volatile bool sbRecording    = false;  ///< `true` while buffers are going into the ring.  The writer clears it if the disk fails.
+static const audioSource_t* spInner = NULL;   ///< The source the recorder sits in front of
+static UINT32 su32BlockAlign        = 0;      ///< Bytes per frame
+static HANDLE shRecordFile          = INVALID_HANDLE_VALUE;  ///< The recording
+static HANDLE shWriterThread        = NULL;   ///< The writer thread
+static HANDLE shWriterStopEvent     = NULL;   ///< Tells the writer thread to do a last write and end
+static BYTE*  spRing                = NULL;   ///< The ring between the capture thread and the writer thread
+static volatile LONG64 sl64Head     = 0;      ///< Bytes the capture thread has put in the ring (only it writes this)
+static volatile LONG64 sl64Tail     = 0;      ///< Bytes the writer thread has written (only it writes this)
+
+// The recorder's statistics.  Each one is written by only one thread.
+static UINT64 su64RecordBuffers     = 0;      ///< Buffers put in the ring
+static UINT64 su64RecordFrames      = 0;      ///< Frames put in the ring
+static UINT64 su64RecordDropped     = 0;      ///< Buffers dropped because the ring was full
+static UINT32 su32DroppedSinceLast  = 0;      ///< Buffers dropped since the last one that went in the ring
+static UINT64 su64RecordFileBytes   = 0;      ///< Bytes written to the recording
+
+// The replay source
+static bool   sbReplay              = false;  ///< `true` if `/replay` is on the command line
+static bool   sbReplayFast          = false;  ///< `true` to replay as fast as possible instead of at the original pacing
+static bool   sbReplayExit          = false;  ///< `true` to end the program when the replay is done
+static WCHAR  swsReplayFile[ MAX_PATH ] = AUDIO_RECORD_DEFAULT_FILE;  ///< The recording we're replaying
+static HANDLE shReplayFile          = INVALID_HANDLE_VALUE;  ///< The recording
+static HANDLE shReplayMapping       = NULL;   ///< The recording's file mapping
+static const BYTE* spView           = NULL;   ///< The recording, mapped into memory
+static size_t sstFirstBuffer        = 0;      ///< Where the first #audioRecordBuffer_t starts in #spView
+static size_t sstCursor             = 0;      ///< Where #audioCapture's next #audioRecordBuffer_t starts in #spView
+static HANDLE shReplayThread        = NULL;   ///< Paces the buffers at their original times
+static HANDLE shReplayTimer         = NULL;   ///< The high-resolution waitable timer that paces the replay
+static HANDLE shReplayStopEvent     = NULL;   ///< Tells #audioReplayThread to end
+static HANDLE shReplayReadyEvent    = NULL;   ///< The samples-ready event we signal (owned by audio.cpp)
+static volatile LONG64 sl64Due      = 0;      ///< Buffers released to #audioCapture (only #audioReplayThread writes this)
+static LONG64 sl64Consumed          = 0;      ///< Buffers #audioCapture is done with
+
+static UINT64 su64ReplayBuffers     = 0;      ///< The number of complete buffers in the recording
+static UINT64 su64ReplayFrames      = 0;      ///< The number of frames in the recording
+static UINT64 su64ReplayMissing     = 0;      ///< Buffers the recorder dropped
+static UINT64 su64FirstArrival      = 0;      ///< When the first buffer arrived (in 100ns units)
+static UINT64 su64LastArrival       = 0;      ///< When the last buffer arrived (in 100ns units)
+static LARGE_INTEGER sFrequency;              ///< Performance counter ticks per second
+static INT64  si64ReplayStartTicks  = 0;      ///< When the replay started (in performance counter ticks)
+
+
+/// Convert performance counter ticks to 100ns units without overflowing
+///
+/// @param i64Ticks The ticks
+/// @return The same time in 100ns units
+static UINT64 audioRecordTicksTo100ns( _In_ const INT64 i64Ticks ) {
+   return (UINT64) ( i64Ticks / sFrequency.QuadPart ) * 10000000
+        + (UINT64) ( i64Ticks % sFrequency.QuadPart ) * 10000000 / (UINT64) sFrequency.QuadPart;
+}
+
+
+/// Convert 100ns units to performance counter ticks without overflowing
+///
+/// @param u64Time The time in 100ns units
+/// @return The same time in performance counter ticks
+static INT64 audioRecord100nsToTicks( _In_ const UINT64 u64Time ) {
+   return (INT64) ( u64Time / 10000000 ) * sFrequency.QuadPart
+        + (INT64) ( u64Time % 10000000 ) * sFrequency.QuadPart / 10000000;
+}
+
+
+/// Look for `/record` and `/replay` (and the replay's options) on the
+/// command line
+///
+/// @param pwszCmdLine The command line passed to #wWinMain
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL audioRecordParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine ) {
+   sbRecord     = false;
+   sbReplay     = false;
+   sbReplayFast = false;
+   sbReplayExit = false;
+
+   if ( pwszCmdLine == NULL ) {
+      return TRUE;
+   }
+
+   WCHAR wsUnused[ 8 ];
+
+   if ( !dtmfServiceParsePath( pwszCmdLine, L"/record", swsRecordFile, _countof( swsRecordFile ), &sbRecord )
+     || !dtmfServiceParsePath( pwszCmdLine, L"/replay", swsReplayFile, _countof( swsReplayFile ), &sbReplay )
+     || !dtmfServiceParsePath( pwszCmdLine, L"/replayfast", wsUnused, _countof( wsUnused ), &sbReplayFast )
+     || !dtmfServiceParsePath( pwszCmdLine, L"/replayexit", wsUnused, _countof( wsUnused ), &sbReplayExit ) ) {
+      RETURN_FATAL( IDS_AUDIO_RECORD_INVALID_CONFIG );  // "The /record or /replay options are not valid.  Exiting."
+   }
+
+   /// The replay takes the place of the audio device, so it can't be used
+   /// with the simulated one
+   if ( sbReplay && audioSimIsEnabled() ) {
+      RETURN_FATAL( IDS_AUDIO_RECORD_INVALID_CONFIG );  // "The /record or /replay options are not valid.  Exiting."
+   }
+
+   if ( sbRecord ) {
+      LOG_INFO_R( IDS_AUDIO_RECORD_ENABLED, swsRecordFile );  // "Recording the capture buffers to [%s]"
+   }
+   if ( sbReplay ) {
+      LOG_INFO_R( IDS_AUDIO_REPLAY_ENABLED, swsReplayFile, sbReplayFast ? L"as fast as possible" : L"at the original pacing" );  // "Replaying the capture buffers in [%s] %s"
+   }
+
+   return TRUE;
+}
+
+
+/// @return `true` if `/record` is on the command line
+bool audioRecordIsEnabled() {
+   return sbRecord;
+}
+
+
+/// @return `true` if `/replay` is on the command line
+bool audioReplayIsEnabled() {
+   return sbReplay;
+}
+
+
+/// Copy bytes into the ring, wrapping around the end.  Called from the
+/// capture thread.
+///
+/// @param l64Position Where to copy them (in bytes since the ring started)
+/// @param pSource     The bytes
+/// @param stBytes     The number of bytes
+static void audioRecordCopyIn(
+   _In_                     const LONG64 l64Position,
+   _In_reads_bytes_( stBytes ) const void* pSource,
+   _In_                     const size_t stBytes ) {
+
+   const size_t stOffset = (size_t) l64Position & ( AUDIO_RECORD_RING_BYTES - 1 );
+   const size_t stFirst  = ( stBytes < AUDIO_RECORD_RING_BYTES - stOffset ) ? stBytes : AUDIO_RECORD_RING_BYTES - stOffset;
+
+   memcpy( spRing + stOffset, pSource, stFirst );
+   memcpy( spRing, (const BYTE*) pSource + stFirst, stBytes - stFirst );
+}
+
+
+/// Write everything in the ring to the recording.  Called from
+/// #audioRecordWriterThread.
+static void audioRecordDrain() {
+   const LONG64 l64Head = sl64Head;  // A volatile read has acquire semantics in MSVC
+   LONG64       l64Tail = sl64Tail;
+
+   while ( l64Tail < l64Head ) {
+      const size_t stOffset = (size_t) l64Tail & ( AUDIO_RECORD_RING_BYTES - 1 );
+      size_t       stBytes  = (size_t) ( l64Head - l64Tail );
+      if ( stBytes > AUDIO_RECORD_RING_BYTES - stOffset ) {
+         stBytes = AUDIO_RECORD_RING_BYTES - stOffset;  // Write up to the end of the ring, then wrap
+      }
+
+      DWORD dwWritten = 0;
+      if ( !WriteFile( shRecordFile, spRing + stOffset, (DWORD) stBytes, &dwWritten, NULL ) || dwWritten != (DWORD) stBytes ) {
+         /// If the disk fails, stop recording and throw away what's left
+         if ( sbRecording ) {
+            sbRecording = false;
+            LOG_WARN_R( IDS_AUDIO_RECORD_WRITE_FAILED, swsRecordFile, GetLastError() );  // "Failed to write the recording [%s].  Error: %u.  Recording stopped."
+         }
+         l64Tail = l64Head;
+         break;
+      }
+
+      l64Tail             += (LONG64) stBytes;
+      su64RecordFileBytes += stBytes;
+   }
+
+   sl64Tail = l64Tail;  // A volatile write has release semantics in MSVC
+}
+
+
+/// The recorder's writer thread.  It empties the ring every
+/// #AUDIO_RECORD_WRITE_MS and once more when it's told to stop.
+///
+/// @param pContext Not used
+/// @return `0` if successful
+static DWORD WINAPI audioRecordWriterThread( _In_ LPVOID pContext ) {
+   UNREFERENCED_PARAMETER( pContext );
+
+   LOG_TRACE_B( IDS_AUDIO_RECORD_START_THREAD );  // "Start recorder thread"
+
+   DWORD dwWaitResult;
+
+   do {
+      dwWaitResult = WaitForSingleObject( shWriterStopEvent, AUDIO_RECORD_WRITE_MS );
+      audioRecordDrain();
+   } while ( dwWaitResult == WAIT_TIMEOUT );
+
+   LOG_TRACE_B( IDS_AUDIO_RECORD_END_THREAD );  // "End recorder thread"
+
+   logTraceReleaseRing();
+   logFlightReleaseRing();
+
+   ExitThread( 0 );
+}
+
+
+/// Start recording the buffers that come from an audio source.  After this,
+/// #audioCapture should read from #gAudioRecordSource.
+///
+/// @param pSource The source to record
+/// @param pFormat The source's mix format
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL audioRecordStart( _In_ const audioSource_t* pSource, _In_ const WAVEFORMATEX* pFormat ) {
+   _ASSERTE( sbRecord );
+   _ASSERTE( pSource != NULL );
+   _ASSERTE( pFormat != NULL );
+   _ASSERTE( shWriterThread == NULL );
+   _ASSERTE( spRing == NULL );
+
+   /// #### Function
+
+   spInner        = pSource;
+   su32BlockAlign = pFormat->nBlockAlign;
+
+   QueryPerformanceFrequency( &sFrequency );  // This never fails on Windows XP or later
+
+   sl64Head             = 0;
+   sl64Tail             = 0;
+   su64RecordBuffers    = 0;
+   su64RecordFrames     = 0;
+   su64RecordDropped    = 0;
+   su32DroppedSinceLast = 0;
+   su64RecordFileBytes  = 0;
+
+   /// - Create the recording and write its header and the mix format.
+   ///   `WAVE_FORMAT_PCM` doesn't have a `cbSize`.
+   shRecordFile = CreateFileW( swsRecordFile, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+   if ( shRecordFile == INVALID_HANDLE_VALUE ) {
+      RETURN_FATAL( IDS_AUDIO_RECORD_FAILED_TO_OPEN, swsRecordFile, GetLastError() );  // "Failed to create the recording [%s].  Error: %u.  Exiting."
+   }
+
+   audioRecordHeader_t header;
+   ZeroMemory( &header, sizeof( header ) );
+
+   FILETIME now;
+   GetSystemTimeAsFileTime( &now );
+
+   header.u32Magic       = AUDIO_RECORD_MAGIC;
+   header.u32Version     = AUDIO_RECORD_VERSION;
+   header.u32FormatBytes = (UINT32) sizeof( WAVEFORMATEX ) + ( ( pFormat->wFormatTag == WAVE_FORMAT_PCM ) ? 0 : pFormat->cbSize );
+   header.u64StartTime   = ( (UINT64) now.dwHighDateTime << 32 ) | now.dwLowDateTime;
+
+   DWORD dwWritten;
+   if ( !WriteFile( shRecordFile, &header, sizeof( header ), &dwWritten, NULL ) || dwWritten != sizeof( header )
+     || !WriteFile( shRecordFile, pFormat, header.u32FormatBytes, &dwWritten, NULL ) || dwWritten != header.u32FormatBytes ) {
+      RETURN_FATAL( IDS_AUDIO_RECORD_FAILED_TO_OPEN, swsRecordFile, GetLastError() );  // "Failed to create the recording [%s].  Error: %u.  Exiting."
+   }
+
+   su64RecordFileBytes = sizeof( header ) + header.u32FormatBytes;
+
+   /// - Allocate the ring and start the writer thread
+   spRing = (BYTE*) _malloc_dbg( AUDIO_RECORD_RING_BYTES, _CLIENT_BLOCK, __FILE__, __LINE__ );
+   if ( spRing == NULL ) {
+      RETURN_FATAL( IDS_AUDIO_RECORD_FAILED_TO_ALLOCATE );  // "Failed to allocate memory for the recorder.  Exiting."
+   }
+
+   shWriterStopEvent = CreateEventExW( NULL, NULL, 0, EVENT_MODIFY_STATE | SYNCHRONIZE );
+   if ( shWriterStopEvent == NULL ) {
+      RETURN_FATAL( IDS_AUDIO_RECORD_FAILED_TO_START );  // "Failed to start the recorder's writer thread.  Exiting."
+   }
+
+   sbRecording = true;
+
+   shWriterThread = CreateThread( NULL, 0, audioRecordWriterThread, NULL, 0, NULL );
+   if ( shWriterThread == NULL ) {
+      sbRecording = false;
+      RETURN_FATAL( IDS_AUDIO_RECORD_FAILED_TO_START );  // "Failed to start the recorder's writer thread.  Exiting."
+   }
+
+   return TRUE;
+}
+
+
+/// Stop recording.  Write what's left in the ring, close the recording and
+/// log the recorder's statistics.  Call this after the capture thread ends.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL audioRecordStop() {
+   BOOL br;  // BOOL result
+
+   sbRecording = false;
+
+   if ( shWriterThread != NULL ) {
+      br = SetEvent( shWriterStopEvent );
+      CHECK_BR_R( IDS_AUDIO_RECORD_THREAD_END_FAILED );  // "Wait for the recorder's writer thread to end failed.  Exiting."
+
+      if ( WaitForSingleObject( shWriterThread, INFINITE ) != WAIT_OBJECT_0 ) {
+         RETURN_FATAL( IDS_AUDIO_RECORD_THREAD_END_FAILED );  // "Wait for the recorder's writer thread to end failed.  Exiting."
+      }
+
+      CloseHandle( shWriterThread );
+      shWriterThread = NULL;
+
+      LOG_INFO_R( IDS_AUDIO_RECORD_STATISTICS, su64RecordBuffers, su64RecordFrames, su64RecordFileBytes, su64RecordDropped );  // "Recorder:  Buffers: %llu   Frames: %llu   Bytes: %llu   Dropped: %llu"
+      if ( su64RecordDropped > 0 ) {
+         LOG_WARN_R( IDS_AUDIO_RECORD_NOT_EXACT, su64RecordDropped );  // "The recorder dropped %llu buffers because the disk couldn't keep up.  The recording is not bit-exact."
+      }
+   }
+
+   if ( shWriterStopEvent != NULL ) {
+      CloseHandle( shWriterStopEvent );
+      shWriterStopEvent = NULL;
+   }
+
+   if ( shRecordFile != INVALID_HANDLE_VALUE ) {
+      CloseHandle( shRecordFile );
+      shRecordFile = INVALID_HANDLE_VALUE;
+   }
+
+   if ( spRing != NULL ) {
+      _free_dbg( spRing, _CLIENT_BLOCK );
+      spRing = NULL;
+   }
+
+   spInner = NULL;
+
+   return TRUE;
+}
+
+
+/// The recorder's version of `IAudioCaptureClient::GetBuffer`.  Get a buffer
+/// from the real source and, if there is one, copy it into the ring.
+/// Called from #audioCapture.
+///
+/// @see https://learn.microsoft.com/en-us/windows/win32/api/audioclient/nf-audioclient-iaudiocaptureclient-getbuffer
+///
+/// @return Whatever the real source returned
+static HRESULT audioRecordGetBuffer(
+   _Out_       BYTE**  ppData,
+   _Out_       UINT32* pu32FramesToRead,
+   _Out_       DWORD*  pdwFlags,
+   _Out_opt_   UINT64* pu64DevicePosition,
+   _Out_opt_   UINT64* pu64QPCPosition ) {
+
+   _ASSERTE( spInner != NULL );
+
+   UINT64 u64DevicePosition = 0;
+   UINT64 u64QPCPosition    = 0;
+
+   const HRESULT hr = spInner->getBuffer( ppData, pu32FramesToRead, pdwFlags, &u64DevicePosition, &u64QPCPosition );
+
+   if ( pu64DevicePosition != NULL ) {
+      *pu64DevicePosition = u64DevicePosition;
+   }
+   if ( pu64QPCPosition != NULL ) {
+      *pu64QPCPosition = u64QPCPosition;
+   }
+
+   if ( hr != S_OK || *pu32FramesToRead == 0 || !sbRecording ) {
+      return hr;
+   }
+
+   _ASSERTE( *ppData != NULL );
+
+   LARGE_INTEGER now;
+   QueryPerformanceCounter( &now );
+
+   audioRecordBuffer_t buffer;
+   buffer.u32Bytes          = *pu32FramesToRead * su32BlockAlign;
+   buffer.u32Frames         = *pu32FramesToRead;
+   buffer.dwFlags           = *pdwFlags;
+   buffer.u32Dropped        = su32DroppedSinceLast;
+   buffer.u64DevicePosition = u64DevicePosition;
+   buffer.u64QPCPosition    = u64QPCPosition;
+   buffer.u64ArrivalTime    = audioRecordTicksTo100ns( now.QuadPart );
+
+   /// If the writer thread is behind, drop the buffer.  The capture thread
+   /// never waits on the disk.
+   const LONG64 l64Head   = sl64Head;  // Only this thread writes it
+   const size_t stNeeded  = sizeof( buffer ) + buffer.u32Bytes;
+   const size_t stFree    = AUDIO_RECORD_RING_BYTES - (size_t) ( l64Head - sl64Tail );
+
+   if ( stNeeded > stFree ) {
+      su64RecordDropped++;
+      su32DroppedSinceLast++;
+      return hr;
+   }
+
+   audioRecordCopyIn( l64Head, &buffer, sizeof( buffer ) );
+   audioRecordCopyIn( l64Head + (LONG64) sizeof( buffer ), *ppData, buffer.u32Bytes );
+
+   sl64Head = l64Head + (LONG64) stNeeded;  // A volatile write has release semantics in MSVC
+
+   su32DroppedSinceLast = 0;
+   su64RecordBuffers++;
+   su64RecordFrames += buffer.u32Frames;
+
+   return hr;
+}
+
+
+/// The recorder's version of `IAudioCaptureClient::ReleaseBuffer`
+///
+/// @return Whatever the real source returned
+static HRESULT audioRecordReleaseBuffer( _In_ const UINT32 u32FramesRead ) {
+   _ASSERTE( spInner != NULL );
+
+   return spInner->releaseBuffer( u32FramesRead );
+}
+
+
+const audioSource_t gAudioRecordSource = {
+   audioRecordGetBuffer,
+   audioRecordReleaseBuffer
+};
+
+
+/// Unmap and close the recording we're replaying
+static void audioReplayClose() {
+   if ( spView != NULL ) {
+      UnmapViewOfFile( spView );
+      spView = NULL;
+   }
+   if ( shReplayMapping != NULL ) {
+      CloseHandle( shReplayMapping );
+      shReplayMapping = NULL;
+   }
+   if ( shReplayFile != INVALID_HANDLE_VALUE ) {
+      CloseHandle( shReplayFile );
+      shReplayFile = INVALID_HANDLE_VALUE;
+   }
+}
+
+
+/// Map the recording into memory, check it and count its buffers.  Call
+/// this before #audioReplayStart, so audio.cpp can set up the pipeline for
+/// the recording's format.
+///
+/// @param ppFormat        Gets the recording's mix format (it points into the mapping)
+/// @param pu32FormatBytes Gets the size of the mix format
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL audioReplayOpen( _Outptr_ const WAVEFORMATEX** ppFormat, _Out_ UINT32* pu32FormatBytes ) {
+   _ASSERTE( sbReplay );
+   _ASSERTE( ppFormat != NULL );
+   _ASSERTE( pu32FormatBytes != NULL );
+   _ASSERTE( spView == NULL );
+
+   *ppFormat        = NULL;
+   *pu32FormatBytes = 0;
+
+   /// #### Function
+
+   /// - Open and map the whole recording.  A 32-bit build can only map what
+   ///   fits in its address space.
+   shReplayFile = CreateFileW( swsReplayFile, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+   if ( shReplayFile == INVALID_HANDLE_VALUE ) {
+      RETURN_FATAL( IDS_AUDIO_REPLAY_FAILED_TO_OPEN, swsReplayFile, GetLastError() );  // "Failed to open the recording [%s].  Error: %u.  Exiting."
+   }
+
+   LARGE_INTEGER fileSize;
+   if ( !GetFileSizeEx( shReplayFile, &fileSize ) || (UINT64) fileSize.QuadPart < sizeof( audioRecordHeader_t ) + sizeof( WAVEFORMATEX )
+     || (UINT64) fileSize.QuadPart > (UINT64) SIZE_MAX ) {
+      audioReplayClose();
+      RETURN_FATAL( IDS_AUDIO_REPLAY_INVALID_FILE, swsReplayFile );  // "[%s] is not a valid recording.  Exiting."
+   }
+
+   const size_t stFileBytes = (size_t) fileSize.QuadPart;
+
+   shReplayMapping = CreateFileMappingW( shReplayFile, NULL, PAGE_READONLY, 0, 0, NULL );
+   if ( shReplayMapping != NULL ) {
+      spView = (const BYTE*) MapViewOfFile( shReplayMapping, FILE_MAP_READ, 0, 0, 0 );
+   }
+   if ( spView == NULL ) {
+      const DWORD dwError = GetLastError();
+      audioReplayClose();
+      RETURN_FATAL( IDS_AUDIO_REPLAY_FAILED_TO_OPEN, swsReplayFile, dwError );  // "Failed to open the recording [%s].  Error: %u.  Exiting."
+   }
+
+   /// - Bring the whole recording into memory now, so the disk doesn't show
+   ///   up in the replay's timing
+   WIN32_MEMORY_RANGE_ENTRY range;
+   range.VirtualAddress = (PVOID) spView;
+   range.NumberOfBytes  = stFileBytes;
+   PrefetchVirtualMemory( GetCurrentProcess(), 1, &range, 0 );  // Just a hint.  If it fails, the pages fault in.
+
+   /// - Check the header and the mix format
+   audioRecordHeader_t header;
+   memcpy( &header, spView, sizeof( header ) );
+
+   if ( header.u32Magic != AUDIO_RECORD_MAGIC || header.u32Version != AUDIO_RECORD_VERSION
+     || header.u32FormatBytes < sizeof( WAVEFORMATEX ) || header.u32FormatBytes > stFileBytes - sizeof( header ) ) {
+      audioReplayClose();
+      RETURN_FATAL( IDS_AUDIO_REPLAY_INVALID_FILE, swsReplayFile );  // "[%s] is not a valid recording.  Exiting."
+   }
+
+   WAVEFORMATEX format;
+   memcpy( &format, spView + sizeof( header ), sizeof( format ) );
+
+   if ( format.nBlockAlign == 0 || format.nSamplesPerSec == 0
+     || ( format.wFormatTag == WAVE_FORMAT_EXTENSIBLE && header.u32FormatBytes < sizeof( WAVEFORMATEXTENSIBLE ) ) ) {
+      audioReplayClose();
+      RETURN_FATAL( IDS_AUDIO_REPLAY_INVALID_FILE, swsReplayFile );  // "[%s] is not a valid recording.  Exiting."
+   }
+
+   sstFirstBuffer = sizeof( header ) + header.u32FormatBytes;
+
+   /// - Walk the buffers.  Every buffer must have frames and the right
+   ///   number of bytes.  A recording that was cut short is replayed up to
+   ///   its last complete buffer.
+   su64ReplayBuffers = 0;
+   su64ReplayFrames  = 0;
+   su64ReplayMissing = 0;
+   su64FirstArrival  = 0;
+   su64LastArrival   = 0;
+
+   size_t stOffset = sstFirstBuffer;
+
+   while ( stOffset < stFileBytes ) {
+      audioRecordBuffer_t buffer;
+
+      if ( stFileBytes - stOffset < sizeof( buffer ) ) {
+         LOG_WARN_R( IDS_AUDIO_REPLAY_TRUNCATED, swsReplayFile, su64ReplayBuffers );  // "The recording [%s] ends with a partial buffer.  Replaying its %llu complete buffers."
+         break;
+      }
+
+      memcpy( &buffer, spView + stOffset, sizeof( buffer ) );
+
+      if ( buffer.u32Frames == 0 || (UINT64) buffer.u32Bytes != (UINT64) buffer.u32Frames * format.nBlockAlign ) {
+         audioReplayClose();
+         RETURN_FATAL( IDS_AUDIO_REPLAY_INVALID_FILE, swsReplayFile );  // "[%s] is not a valid recording.  Exiting."
+      }
+
+      if ( stFileBytes - stOffset - sizeof( buffer ) < buffer.u32Bytes ) {
+         LOG_WARN_R( IDS_AUDIO_REPLAY_TRUNCATED, swsReplayFile, su64ReplayBuffers );  // "The recording [%s] ends with a partial buffer.  Replaying its %llu complete buffers."
+         break;
+      }
+
+      if ( su64ReplayBuffers == 0 ) {
+         su64FirstArrival = buffer.u64ArrivalTime;
+      }
+      su64LastArrival = ( buffer.u64ArrivalTime > su64LastArrival ) ? buffer.u64ArrivalTime : su64LastArrival;
+
+      su64ReplayBuffers++;
+      su64ReplayFrames  += buffer.u32Frames;
+      su64ReplayMissing += buffer.u32Dropped;
+
+      stOffset += sizeof( buffer ) + buffer.u32Bytes;
+   }
+
+   if ( su64ReplayBuffers == 0 ) {
+      audioReplayClose();
+      RETURN_FATAL( IDS_AUDIO_REPLAY_INVALID_FILE, swsReplayFile );  // "[%s] is not a valid recording.  Exiting."
+   }
+
+   if ( su64ReplayMissing > 0 ) {
+      LOG_WARN_R( IDS_AUDIO_REPLAY_NOT_EXACT, swsReplayFile, su64ReplayMissing );  // "The recording [%s] is missing %llu buffers that the recorder dropped.  The replay is not bit-exact."
+   }
+
+   *ppFormat        = (const WAVEFORMATEX*) ( spView + sizeof( header ) );
+   *pu32FormatBytes = header.u32FormatBytes;
+
+   return TRUE;
+}
+
+
+/// The replay thread.  It releases each buffer to #audioCapture when it
+/// arrived the first time (relative to the first buffer) and signals
+/// #shReplayReadyEvent.  The deadlines are anchored to the start of the
+/// replay, so wakeup jitter doesn't turn into drift.
+///
+/// @param pContext Not used
+/// @return `0` if successful.  Non-`0` if there was a problem.
+static DWORD WINAPI audioReplayThread( _In_ LPVOID pContext ) {
+   UNREFERENCED_PARAMETER( pContext );
+
+   LOG_TRACE_B( IDS_AUDIO_REPLAY_START_THREAD );  // "Start replay thread"
+
+   const HANDLE hWait[ 2 ] = { shReplayStopEvent, shReplayTimer };
+   size_t stOffset = sstFirstBuffer;
+
+   for ( UINT64 i = 0 ; i < su64ReplayBuffers ; i++ ) {
+      audioRecordBuffer_t buffer;
+      memcpy( &buffer, spView + stOffset, sizeof( buffer ) );
+      stOffset += sizeof( buffer ) + buffer.u32Bytes;
+
+      /// - Sleep on the high-resolution timer until the buffer is due
+      const UINT64 u64Offset   = ( buffer.u64ArrivalTime > su64FirstArrival ) ? buffer.u64ArrivalTime - su64FirstArrival : 0;
+      const INT64  i64DueTicks = si64ReplayStartTicks + audioRecord100nsToTicks( u64Offset );
+
+      LARGE_INTEGER now;
+      QueryPerformanceCounter( &now );
+
+      if ( i64DueTicks > now.QuadPart ) {
+         LARGE_INTEGER dueTime;  // The relative time to wait (in 100ns units)
+         dueTime.QuadPart = -(LONGLONG) audioRecordTicksTo100ns( i64DueTicks - now.QuadPart );  // Negative is relative
+
+         if ( !SetWaitableTimer( shReplayTimer, &dueTime, 0, NULL, NULL, FALSE ) ) {
+            QUEUE_FATAL( IDS_AUDIO_REPLAY_TIMER_FAILED );  // "The replay's timer failed.  Exiting.  Investigate!"
+            break;
+         }
+
+         const DWORD dwWaitResult = WaitForMultipleObjects( 2, hWait, FALSE, INFINITE );
+         if ( dwWaitResult == WAIT_OBJECT_0 ) {
+            break;  // audioReplayStop
+         } else if ( dwWaitResult != WAIT_OBJECT_0 + 1 ) {
+            QUEUE_FATAL( IDS_AUDIO_REPLAY_TIMER_FAILED );  // "The replay's timer failed.  Exiting.  Investigate!"
+            break;
+         }
+      } else if ( WaitForSingleObject( shReplayStopEvent, 0 ) == WAIT_OBJECT_0 ) {
+         break;  // audioReplayStop
+      }
+
+      /// - Release the buffer and tell #audioCaptureThread about it.
+      ///   InterlockedIncrement64 is a full barrier.
+      InterlockedIncrement64( &sl64Due );
+
+      SetEvent( shReplayReadyEvent );
+   }
+
+   LOG_TRACE_B( IDS_AUDIO_REPLAY_END_THREAD );  // "End replay thread"
+
+   logTraceReleaseRing();
+   logFlightReleaseRing();
+
+   ExitThread( 0 );
+}
+
+
+/// Start the replay.  Call #audioReplayOpen first.
+///
+/// @param hSamplesReadyEvent Signal this event when a buffer is ready
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL audioReplayStart( _In_ const HANDLE hSamplesReadyEvent ) {
+   _ASSERTE( sbReplay );
+   _ASSERTE( spView != NULL );
+   _ASSERTE( hSamplesReadyEvent != NULL );
+   _ASSERTE( shReplayThread == NULL );
+
+   /// #### Function
+
+   shReplayReadyEvent = hSamplesReadyEvent;
+   sstCursor          = sstFirstBuffer;
+   sl64Consumed       = 0;
+
+   QueryPerformanceFrequency( &sFrequency );  // This never fails on Windows XP or later
+
+   LARGE_INTEGER now;
+   QueryPerformanceCounter( &now );
+   si64ReplayStartTicks = now.QuadPart;
+
+   LOG_INFO_R( IDS_AUDIO_REPLAY_STARTED, su64ReplayBuffers, su64ReplayFrames, (double) ( su64LastArrival - su64FirstArrival ) / 10000000.0 );  // "Replay started:  Buffers: %llu   Frames: %llu   Recorded: %.3f s"
+
+   /// - As fast as possible:  Every buffer is due now
+   if ( sbReplayFast ) {
+      sl64Due = (LONG64) su64ReplayBuffers;
+      SetEvent( shReplayReadyEvent );
+      return TRUE;
+   }
+
+   /// - At the original pacing:  Start a thread on a high-resolution
+   ///   waitable timer (fall back to a regular one on older versions of
+   ///   Windows)
+   sl64Due = 0;
+
+   shReplayTimer = CreateWaitableTimerExW( NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS );
+   if ( shReplayTimer == NULL ) {
+      shReplayTimer = CreateWaitableTimerExW( NULL, NULL, 0, TIMER_ALL_ACCESS );
+   }
+   shReplayStopEvent = CreateEventExW( NULL, NULL, CREATE_EVENT_MANUAL_RESET, EVENT_MODIFY_STATE | SYNCHRONIZE );
+   if ( shReplayTimer == NULL || shReplayStopEvent == NULL ) {
+      RETURN_FATAL( IDS_AUDIO_REPLAY_FAILED_TO_START );  // "Failed to start the replay thread.  Exiting."
+   }
+
+   shReplayThread = CreateThread( NULL, 0, audioReplayThread, NULL, 0, NULL );
+   if ( shReplayThread == NULL ) {
+      RETURN_FATAL( IDS_AUDIO_REPLAY_FAILED_TO_START );  // "Failed to start the replay thread.  Exiting."
+   }
+
+   return TRUE;
+}
+
+
+/// Stop the replay and release the recording.  Call this after the capture
+/// thread ends.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL audioReplayStop() {
+   if ( shReplayThread != NULL ) {
+      SetEvent( shReplayStopEvent );
+
+      if ( WaitForSingleObject( shReplayThread, INFINITE ) != WAIT_OBJECT_0 ) {
+         RETURN_FATAL( IDS_AUDIO_REPLAY_THREAD_END_FAILED );  // "Wait for the replay thread to end failed.  Exiting."
+      }
+
+      CloseHandle( shReplayThread );
+      shReplayThread = NULL;
+   }
+
+   if ( shReplayStopEvent != NULL ) {
+      CloseHandle( shReplayStopEvent );
+      shReplayStopEvent = NULL;
+   }
+   if ( shReplayTimer != NULL ) {
+      CloseHandle( shReplayTimer );
+      shReplayTimer = NULL;
+   }
+
+   audioReplayClose();
+
+   shReplayReadyEvent = NULL;
+
+   return TRUE;
+}
+
+
+/// The replay's version of `IAudioCaptureClient::GetBuffer`.  Called from
+/// #audioCapture.
+///
+/// The data points straight into the mapping, which is read-only.  The
+/// pipeline only reads it.
+///
+/// @see https://learn.microsoft.com/en-us/windows/win32/api/audioclient/nf-audioclient-iaudiocaptureclient-getbuffer
+///
+/// @return `S_OK` if there's a buffer, `AUDCLNT_S_BUFFER_EMPTY` if there isn't
+static HRESULT audioReplayGetBuffer(
+   _Out_       BYTE**  ppData,
+   _Out_       UINT32* pu32FramesToRead,
+   _Out_       DWORD*  pdwFlags,
+   _Out_opt_   UINT64* pu64DevicePosition,
+   _Out_opt_   UINT64* pu64QPCPosition ) {
+
+   _ASSERTE( ppData != NULL );
+   _ASSERTE( pu32FramesToRead != NULL );
+   _ASSERTE( pdwFlags != NULL );
+
+   if ( sl64Consumed == sl64Due ) {  // A volatile read has acquire semantics in MSVC
+      *ppData           = NULL;
+      *pu32FramesToRead = 0;
+      *pdwFlags         = 0;
+      return AUDCLNT_S_BUFFER_EMPTY;
+   }
+
+   audioRecordBuffer_t buffer;
+   memcpy( &buffer, spView + sstCursor, sizeof( buffer ) );
+
+   *ppData           = (BYTE*) ( spView + sstCursor + sizeof( buffer ) );
+   *pu32FramesToRead = buffer.u32Frames;
+   *pdwFlags         = buffer.dwFlags;
+
+   if ( pu64DevicePosition != NULL ) {
+      *pu64DevicePosition = buffer.u64DevicePosition;
+   }
+
+   /// Move the timestamp to the present.  Keep the buffer's original lag
+   /// (from when its first frame was recorded to when it arrived).
+   if ( pu64QPCPosition != NULL ) {
+      UINT64 u64Arrival;
+
+      if ( sbReplayFast ) {
+         LARGE_INTEGER now;
+         QueryPerformanceCounter( &now );
+         u64Arrival = audioRecordTicksTo100ns( now.QuadPart );
+      } else {
+         const UINT64 u64Offset = ( buffer.u64ArrivalTime > su64FirstArrival ) ? buffer.u64ArrivalTime - su64FirstArrival : 0;
+         u64Arrival = audioRecordTicksTo100ns( si64ReplayStartTicks ) + u64Offset;
+      }
+
+      const UINT64 u64Lag = ( buffer.u64ArrivalTime > buffer.u64QPCPosition ) ? buffer.u64ArrivalTime - buffer.u64QPCPosition : 0;
+
+      *pu64QPCPosition = ( u64Arrival > u64Lag ) ? u64Arrival - u64Lag : 0;
+   }
+
+   return S_OK;
+}
+
+
+/// The replay's version of `IAudioCaptureClient::ReleaseBuffer`.  When the
+/// last buffer is released, log how long the replay took.
+///
+/// @see https://learn.microsoft.com/en-us/windows/win32/api/audioclient/nf-audioclient-iaudiocaptureclient-releasebuffer
+///
+/// @return `S_OK` if successful
+static HRESULT audioReplayReleaseBuffer( _In_ const UINT32 u32FramesRead ) {
+   UNREFERENCED_PARAMETER( u32FramesRead );
+
+   _ASSERTE( sl64Consumed < sl64Due );
+
+   audioRecordBuffer_t buffer;
+   memcpy( &buffer, spView + sstCursor, sizeof( buffer ) );
+
+   sstCursor += sizeof( buffer ) + buffer.u32Bytes;
+   sl64Consumed++;
+
+   if ( (UINT64) sl64Consumed == su64ReplayBuffers ) {
+      LARGE_INTEGER now;
+      QueryPerformanceCounter( &now );
+
+      const double dRecordedSeconds = (double) ( su64LastArrival - su64FirstArrival ) / 10000000.0;
+      const double dReplaySeconds   = (double) ( now.QuadPart - si64ReplayStartTicks ) / (double) sFrequency.QuadPart;
+
+      const double dSpeed           = ( dReplaySeconds > 0.0 ) ? dRecordedSeconds / dReplaySeconds : 0.0;
+
+      LOG_INFO_R( IDS_AUDIO_REPLAY_FINISHED, su64ReplayBuffers, su64ReplayFrames, dRecordedSeconds, dReplaySeconds, dSpeed );  // "Replay finished:  Buffers: %llu   Frames: %llu   Recorded: %.3f s   Replayed in: %.3f s   Speed: %.2fx"
+
+      if ( sbReplayExit ) {
+         gracefulShutdown();
+      }
+
+      return S_OK;
+   }
+
+   /// #audioCaptureThread calls GetBuffer once per event.  If more buffers
+   /// are due, signal the event again so we catch up.
+   if ( sl64Consumed != sl64Due ) {
+      SetEvent( shReplayReadyEvent );
+   }
+
+   return S_OK;
+}
+
+
+const audioSource_t gAudioReplaySource = {
+   audioReplayGetBuffer,
+   audioReplayReleaseBuffer
+};
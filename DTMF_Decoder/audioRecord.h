@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Record the capture buffers to a file and replay them through the pipeline
+///
+/// #### The Recording
+/// A recording starts with an #audioRecordHeader_t, followed by the device's
+/// mix format (a `WAVEFORMATEX` and its `cbSize` extra bytes).  Then, for
+/// every buffer `GetBuffer` returned, an #audioRecordBuffer_t followed by
+/// the buffer's raw bytes.  Nothing is padded or aligned and nothing is ever
+/// rewritten, so a recording that was cut short is still good up to its last
+/// complete buffer.
+///
+/// @file    audioRecord.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>  // For BOOL
+#include <mmreg.h>    // For WAVEFORMATEX
+
+#include "audio.h"    // For audioSource_t
+
+
+/// The first 4 bytes of a recording (`DREC` in ASCII)
+#define AUDIO_RECORD_MAGIC   (0x43455244)
+
+/// The version of the recording's layout
+#define AUDIO_RECORD_VERSION (1)
+
+
+/// The start of a recording
+typedef struct {
+   UINT32 u32Magic;        ///< #AUDIO_RECORD_MAGIC
+   UINT32 u32Version;      ///< #AUDIO_RECORD_VERSION
+   UINT32 u32FormatBytes;  ///< The size of the mix format that follows (`sizeof( WAVEFORMATEX ) + cbSize`)
+   UINT32 u32Reserved;     ///< Always `0`
+   UINT64 u64StartTime;    ///< When the recording started (as a `FILETIME`)
+} audioRecordHeader_t;
+
+
+/// The header of one recorded buffer.  The times are performance counter
+/// times in 100ns units (like `GetBuffer`'s `pu64QPCPosition`).
+typedef struct {
+   UINT32 u32Bytes;           ///< The size of the raw bytes that follow (`u32Frames * nBlockAlign`)
+   UINT32 u32Frames;          ///< The number of frames in the buffer
+   DWORD  dwFlags;            ///< The `AUDCLNT_BUFFERFLAGS_*` `GetBuffer` returned
+   UINT32 u32Dropped;         ///< Buffers the recorder dropped just before this one (`0` in a bit-exact recording)
+   UINT64 u64DevicePosition;  ///< The device position of the first frame
+   UINT64 u64QPCPosition;     ///< When the first frame was recorded
+   UINT64 u64ArrivalTime;     ///< When `GetBuffer` returned the buffer
+} audioRecordBuffer_t;
+
+
+// The recorder
+extern BOOL audioRecordParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine );
+extern bool audioRecordIsEnabled();
+extern BOOL audioRecordStart( _In_ const audioSource_t* pSource, _In_ const WAVEFORMATEX* pFormat );
+extern BOOL audioRecordStop();
+
+// The replay source
+extern bool audioReplayIsEnabled();
+extern BOOL audioReplayOpen( _Outptr_ const WAVEFORMATEX** ppFormat, _Out_ UINT32* pu32FormatBytes );
+extern BOOL audioReplayStart( _In_ const HANDLE hSamplesReadyEvent );
+extern BOOL audioReplayStop();
+
+
+/// The recorder's implementation of #audioSource_t.  It passes every call to
+/// the source given to #audioRecordStart and records the buffers it returns.
+extern const audioSource_t gAudioRecordSource;
+
+/// The replay source's implementation of #audioSource_t
+extern const audioSource_t gAudioReplaySource;
@@ -0,0 +1,663 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// A simulated audio capture device.
+///
+/// The simulated device lets us watch the realtime behaviour of the capture
+/// pipeline on machines without a microphone (build agents, VMs, etc.).  It
+/// implements #audioSource_t, so #audioCapture runs exactly the same code it
+/// runs for WASAPI.
+///
+/// A device thread wakes up on a high-resolution waitable timer.  Its deadlines
+/// are anchored to the performance counter (not to the previous wakeup), so
+/// jitter doesn't accumulate into drift.  Each wakeup produces one buffer
+/// into a small single-producer / single-consumer ring and signals the
+/// samples-ready event.  When #audioCapture releases the buffer, we measure
+/// the end-to-end latency (from when the buffer was due to when the DFT
+/// finished with it) and count a deadline miss if it took longer than one
+/// period.  If the ring is full, the device drops the buffer (an overrun) and
+/// flags the next one with `AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY` -- just
+/// like a real device.
+///
+/// The device is enabled from the command line:
+///
+///     DTMF_Decoder.exe /simulate [/rate:8000] [/period:10000] [/jitter:2000]
+///                      [/discontinuity:1000] [/timestamperror:1000]
+///                      [/silent:1000] [/seed:1] [/digits:159D*86A]
+///                      [/file:"C:\audio.raw"] [/g711:ulaw]
+///
+/// `/period` and `/jitter` are in microseconds.  The glitch rates are in
+/// parts-per-million per buffer.  `/g711:ulaw` or `/g711:alaw` makes the
+/// device deliver G.711 (like a trunk would).  The digits are companded as
+/// they're made, and a `/file` is played as-is (so it should be a raw `.ul`
+/// or `.al` file).
+///
+/// ### APIs Used
+/// << Print Module API Documentation >>
+///
+/// @file    audioSim.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <AudioClient.h>  // For AUDCLNT_BUFFERFLAGS_*
+#include <malloc.h>       // For _malloc_dbg and free
+#include <stdlib.h>       // For _wtoi
+#include <wchar.h>        // For wcsstr
+
+#include "dtmfCorpus.h"   // For the DTMF synthesizer
+#include "logTrace.h"     // For LOG_TRACE_B
+#include "logFlight.h"    // For logFlightReleaseRing
+#include "audioSim.h"     // For yo bad self
+
+
+/// The number of buffers in the ring between the device thread and
+/// #audioCapture.  WASAPI's shared mode buffer holds about 2 periods, so this
+/// is generous.
+#define AUDIO_SIM_SLOTS (8)
+
+/// How long a synthesized digit sounds (in ms)
+#define AUDIO_SIM_TONE_MS (100)
+
+/// How long the silence between synthesized digits lasts (in ms)
+#define AUDIO_SIM_GAP_MS (100)
+
+/// The amplitude of each synthesized tone (a digit is 2 tones, so this must be
+/// `<= PCM_8_BIT_SILENCE / 2`)
+#define AUDIO_SIM_AMPLITUDE (50.0f)
+
+
+/// One buffer in the ring between the device thread and #audioCapture
+typedef struct {
+   BYTE*  pData;            ///< The PCM_8 frames in this buffer
+   UINT32 uFrames;          ///< The number of frames in #pData
+   DWORD  dwFlags;          ///< The `AUDCLNT_BUFFERFLAGS_*` for this buffer
+   UINT64 u64Position;      ///< The device position of the first frame
+   INT64  i64DueTicks;      ///< When this buffer was supposed to arrive (in performance counter ticks)
+} audioSimSlot_t;
+
+
+static audioSimConfig_t sConfig = {   ///< The device's configuration
+   8000,                              // uSampleRate
+   10000,                             // uPeriodUs
+   0,                                 // uJitterUs
+   0,                                 // uDiscontinuityPpm
+   0,                                 // uTimestampErrorPpm
+   0,                                 // uSilentPpm
+   1,                                 // uSeed
+   L"159D*86A26C48#07423BC#1111",     // wsDigits (from TESTPLAN.md)
+   L"",                               // wsFile
+   G711_LINEAR                        // law
+};
+
+static bool   sbEnabled       = false;  ///< `true` if the command line asked for the simulated device
+static bool   sbDeviceRunning = false;  ///< Keeps #audioSimThread running
+static HANDLE shDeviceThread  = NULL;   ///< The device thread
+static HANDLE shTimer         = NULL;   ///< The high-resolution waitable timer that paces the device
+static HANDLE shReadyEvent    = NULL;   ///< The samples-ready event we signal (owned by audio.cpp)
+
+static audioSimSlot_t sSlots[ AUDIO_SIM_SLOTS ];  ///< The buffer ring
+static BYTE*          spSlotMemory = NULL;        ///< One allocation for all of the slots' frames
+static volatile LONG64 sl64Written = 0;           ///< Buffers produced by #audioSimThread (only it writes this)
+static volatile LONG64 sl64Read    = 0;           ///< Buffers released by #audioCapture (only it writes this)
+
+static UINT32 suFramesPerBuffer = 0;  ///< The number of frames in each buffer
+static UINT64 su64Position      = 0;  ///< The device position of the next frame
+static bool   sbNextIsDiscontinuous = false;  ///< Set after an overrun
+
+static BYTE*  spFileData   = NULL;    ///< The contents of #audioSimConfig_t.wsFile
+static size_t sstFileSize  = 0;       ///< The size of #spFileData
+static size_t sstFileIndex = 0;       ///< The next byte to play from #spFileData
+
+static dtmfCorpus_t sCorpus;          ///< Synthesizes #audioSimConfig_t.wsDigits
+
+static UINT32 suRandom     = 1;       ///< State for #audioSimRandom
+
+static LARGE_INTEGER sFrequency;      ///< Performance counter ticks per second
+static INT64  si64PeriodTicks   = 0;  ///< #audioSimConfig_t.uPeriodUs in performance counter ticks
+
+// Statistics.  Each one is written by only one thread.
+static UINT64 su64Buffers        = 0;  ///< Buffers released by #audioCapture
+static UINT64 su64DeadlineMisses = 0;  ///< Buffers that took longer than a period to get through the pipeline
+static UINT64 su64Overruns       = 0;  ///< Buffers dropped because the ring was full
+static INT64  si64LatencySum     = 0;  ///< Sum of the end-to-end latencies (in ticks)
+static INT64  si64LatencyMax     = 0;  ///< The worst end-to-end latency (in ticks)
+
+
+/// A small, fast, repeatable pseudo-random number generator (xorshift32)
+///
+/// @return The next pseudo-random number
+static UINT32 audioSimRandom() {
+   suRandom ^= suRandom << 13;
+   suRandom ^= suRandom >> 17;
+   suRandom ^= suRandom << 5;
+   return suRandom;
+}
+
+
+/// Roll the dice for a glitch
+///
+/// @param uPpm The chance of the glitch in parts-per-million
+/// @return `true` if the glitch should happen
+static bool audioSimChance( _In_ const UINT32 uPpm ) {
+   return uPpm > 0 && ( audioSimRandom() % 1000000 ) < uPpm;
+}
+
+
+/// Find an option on the command line
+///
+/// @param pwszCmdLine The command line
+/// @param pwszOption  The option to find (including the leading `/`)
+/// @return A pointer to the character after the option or `NULL` if the
+///         option is not on the command line
+static const WCHAR* audioSimFindOption(
+   _In_z_ const PCWSTR pwszCmdLine,
+   _In_z_ const PCWSTR pwszOption ) {
+
+   const WCHAR* pFound = wcsstr( pwszCmdLine, pwszOption );
+   if ( pFound == NULL ) {
+      return NULL;
+   }
+
+   return pFound + wcslen( pwszOption );
+}
+
+
+/// Copy the value of a string option (which may be quoted) into a buffer
+///
+/// @param pValue  Points to the start of the value
+/// @param pBuffer The destination
+/// @param cchBuffer The size of #pBuffer in characters
+static void audioSimCopyValue(
+   _In_z_                     const WCHAR* pValue,
+   _Out_writes_z_( cchBuffer )      WCHAR* pBuffer,
+   _In_                       const size_t cchBuffer ) {
+
+   _ASSERTE( cchBuffer > 0 );
+
+   WCHAR wEnd = L' ';
+   if ( *pValue == L'"' ) {
+      wEnd = L'"';
+      pValue++;
+   }
+
+   size_t i = 0;
+   while ( *pValue != L'\0' && *pValue != wEnd && i < cchBuffer - 1 ) {
+      pBuffer[ i++ ] = *pValue++;
+   }
+   pBuffer[ i ] = L'\0';
+}
+
+
+/// Look for `/simulate` (and the simulated device's options) on the command
+/// line
+///
+/// @param pwszCmdLine The command line passed to #wWinMain
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL audioSimParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine ) {
+   /// #### Function
+
+   sbEnabled = false;
+
+   /// - If `/simulate` is not on the command line, then use the real device
+   if ( pwszCmdLine == NULL || audioSimFindOption( pwszCmdLine, L"/simulate" ) == NULL ) {
+      return TRUE;
+   }
+
+   sbEnabled = true;
+
+   /// - Read the numeric options
+   const WCHAR* pValue;
+
+   if ( ( pValue = audioSimFindOption( pwszCmdLine, L"/rate:" ) ) != NULL )           sConfig.uSampleRate        = (UINT32) _wtoi( pValue );
+   if ( ( pValue = audioSimFindOption( pwszCmdLine, L"/period:" ) ) != NULL )         sConfig.uPeriodUs          = (UINT32) _wtoi( pValue );
+   if ( ( pValue = audioSimFindOption( pwszCmdLine, L"/jitter:" ) ) != NULL )         sConfig.uJitterUs          = (UINT32) _wtoi( pValue );
+   if ( ( pValue = audioSimFindOption( pwszCmdLine, L"/discontinuity:" ) ) != NULL )  sConfig.uDiscontinuityPpm  = (UINT32) _wtoi( pValue );
+   if ( ( pValue = audioSimFindOption( pwszCmdLine, L"/timestamperror:" ) ) != NULL ) sConfig.uTimestampErrorPpm = (UINT32) _wtoi( pValue );
+   if ( ( pValue = audioSimFindOption( pwszCmdLine, L"/silent:" ) ) != NULL )         sConfig.uSilentPpm         = (UINT32) _wtoi( pValue );
+   if ( ( pValue = audioSimFindOption( pwszCmdLine, L"/seed:" ) ) != NULL )           sConfig.uSeed              = (UINT32) _wtoi( pValue );
+
+   /// - Read the string options
+   if ( ( pValue = audioSimFindOption( pwszCmdLine, L"/digits:" ) ) != NULL ) {
+      audioSimCopyValue( pValue, sConfig.wsDigits, _countof( sConfig.wsDigits ) );
+   }
+   if ( ( pValue = audioSimFindOption( pwszCmdLine, L"/file:" ) ) != NULL ) {
+      audioSimCopyValue( pValue, sConfig.wsFile, _countof( sConfig.wsFile ) );
+   }
+   if ( ( pValue = audioSimFindOption( pwszCmdLine, L"/g711:" ) ) != NULL ) {
+      WCHAR wsLaw[ 8 ];
+      audioSimCopyValue( pValue, wsLaw, _countof( wsLaw ) );
+
+      if ( !g711ParseLaw( wsLaw, &sConfig.law ) ) {
+         RETURN_FATAL( IDS_AUDIO_SIM_INVALID_CONFIG, L"/g711" );  // "The simulated audio device's %s option is not valid.  Exiting."
+      }
+   }
+
+   /// - Validate the configuration
+   if ( sConfig.uSampleRate < 4000 || sConfig.uSampleRate > 192000 ) {
+      RETURN_FATAL( IDS_AUDIO_SIM_INVALID_CONFIG, L"/rate" );  // "The simulated audio device's %s option is not valid.  Exiting."
+   }
+   if ( sConfig.uPeriodUs < 1000 || sConfig.uPeriodUs > 1000000 ) {
+      RETURN_FATAL( IDS_AUDIO_SIM_INVALID_CONFIG, L"/period" );  // "The simulated audio device's %s option is not valid.  Exiting."
+   }
+   if ( sConfig.uJitterUs >= sConfig.uPeriodUs ) {
+      RETURN_FATAL( IDS_AUDIO_SIM_INVALID_CONFIG, L"/jitter" );  // "The simulated audio device's %s option is not valid.  Exiting."
+   }
+
+   LOG_INFO_R( IDS_AUDIO_SIM_ENABLED );  // "Using a simulated audio device"
+
+   return TRUE;
+}
+
+
+/// @return `true` if the command line asked for the simulated audio device
+bool audioSimIsEnabled() {
+   return sbEnabled;
+}
+
+
+/// @return The sample rate of the simulated audio device
+UINT32 audioSimGetSampleRate() {
+   return sConfig.uSampleRate;
+}
+
+
+/// @return How the simulated audio device's frames are encoded
+g711Law_t audioSimGetLaw() {
+   return sConfig.law;
+}
+
+
+/// Load #audioSimConfig_t.wsFile into #spFileData
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+static BOOL audioSimLoadFile() {
+   _ASSERTE( spFileData == NULL );
+
+   HANDLE        hFile;     // The audio file
+   LARGE_INTEGER fileSize;  // The size of the file
+   DWORD         dwRead;    // Bytes read
+   BOOL          br;        // BOOL result
+
+   hFile = CreateFileW( sConfig.wsFile, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+   if ( hFile == INVALID_HANDLE_VALUE ) {
+      RETURN_FATAL( IDS_AUDIO_SIM_FAILED_TO_OPEN_FILE, sConfig.wsFile );  // "Failed to open the simulated audio file [%s].  Exiting."
+   }
+
+   br = GetFileSizeEx( hFile, &fileSize );
+   if ( !br || fileSize.QuadPart <= 0 || fileSize.QuadPart > MAXDWORD ) {
+      CloseHandle( hFile );
+      RETURN_FATAL( IDS_AUDIO_SIM_FAILED_TO_READ_FILE, sConfig.wsFile );  // "Failed to read the simulated audio file [%s].  Exiting."
+   }
+
+   spFileData = (BYTE*) _malloc_dbg( (size_t) fileSize.QuadPart, _CLIENT_BLOCK, __FILE__, __LINE__ );
+   if ( spFileData == NULL ) {
+      CloseHandle( hFile );
+      RETURN_FATAL( IDS_AUDIO_SIM_FAILED_TO_ALLOCATE );  // "Failed to allocate memory for the simulated audio device.  Exiting."
+   }
+
+   br = ReadFile( hFile, spFileData, (DWORD) fileSize.QuadPart, &dwRead, NULL );
+   CloseHandle( hFile );
+   if ( !br || dwRead != (DWORD) fileSize.QuadPart ) {
+      RETURN_FATAL( IDS_AUDIO_SIM_FAILED_TO_READ_FILE, sConfig.wsFile );  // "Failed to read the simulated audio file [%s].  Exiting."
+   }
+
+   sstFileSize  = (size_t) fileSize.QuadPart;
+   sstFileIndex = 0;
+
+   return TRUE;
+}
+
+
+/// Produce the next buffer into the ring.  Called from #audioSimThread.
+///
+/// @param i64DueTicks When this buffer was supposed to arrive
+static void audioSimProduce( _In_ const INT64 i64DueTicks ) {
+   /// #### Function
+
+   /// - If #audioCapture hasn't kept up, drop this buffer (an overrun) and
+   ///   flag the next one as discontinuous.  Keep the device position moving
+   ///   just like a real device would.
+   if ( sl64Written - sl64Read >= AUDIO_SIM_SLOTS ) {
+      su64Overruns++;
+      sbNextIsDiscontinuous = true;
+      su64Position += suFramesPerBuffer;
+      sCorpus.u64Position += suFramesPerBuffer;
+      return;
+   }
+
+   audioSimSlot_t* pSlot = &sSlots[ sl64Written % AUDIO_SIM_SLOTS ];
+
+   /// - Roll the dice for each kind of glitch
+   pSlot->dwFlags = 0;
+   if ( sbNextIsDiscontinuous || audioSimChance( sConfig.uDiscontinuityPpm ) ) {
+      pSlot->dwFlags |= AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY;
+      sbNextIsDiscontinuous = false;
+   }
+   if ( audioSimChance( sConfig.uTimestampErrorPpm ) ) {
+      pSlot->dwFlags |= AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR;
+   }
+   if ( audioSimChance( sConfig.uSilentPpm ) ) {
+      pSlot->dwFlags |= AUDCLNT_BUFFERFLAGS_SILENT;
+   }
+
+   /// - Fill the buffer from the file or the synthesizer.  Keep them moving
+   ///   during a silent buffer (like a real device would), then overwrite it
+   ///   with silence.
+   if ( spFileData != NULL ) {
+      for ( UINT32 i = 0 ; i < suFramesPerBuffer ; i++ ) {
+         pSlot->pData[ i ] = spFileData[ sstFileIndex++ ];
+         if ( sstFileIndex >= sstFileSize ) {
+            sstFileIndex = 0;
+         }
+      }
+   } else {
+      dtmfCorpusRender( &sCorpus, pSlot->pData, suFramesPerBuffer );
+      g711Compress( sConfig.law, pSlot->pData, pSlot->pData, suFramesPerBuffer );
+   }
+
+   if ( pSlot->dwFlags & AUDCLNT_BUFFERFLAGS_SILENT ) {
+      FillMemory( pSlot->pData, suFramesPerBuffer, gG711Compress[ sConfig.law ][ PCM_8_BIT_SILENCE ] );
+   }
+
+   pSlot->uFrames     = suFramesPerBuffer;
+   pSlot->u64Position = su64Position;
+   pSlot->i64DueTicks = i64DueTicks;
+
+   su64Position += suFramesPerBuffer;
+
+   /// - Publish the buffer.  InterlockedIncrement64 is a full barrier, so
+   ///   #audioCapture sees the whole slot before it sees the new count.
+   InterlockedIncrement64( &sl64Written );
+}
+
+
+/// The simulated device's thread.  It wakes up once a period (+/- jitter),
+/// produces a buffer and signals #shReadyEvent.
+///
+/// @param pContext Not used
+/// @return `0` if successful.  Non-`0` if there was a problem.
+static DWORD WINAPI audioSimThread( _In_ LPVOID pContext ) {
+   UNREFERENCED_PARAMETER( pContext );
+
+   LOG_TRACE_B( IDS_AUDIO_SIM_START_THREAD );  // "Start simulated audio device thread"
+
+   LARGE_INTEGER start;  // The time the device started
+   LARGE_INTEGER now;    // The current time
+   LARGE_INTEGER dueTime;  // The relative time to wait (in 100ns units)
+   UINT64        u64Tick = 0;
+
+   QueryPerformanceCounter( &start );
+
+   while ( sbDeviceRunning ) {
+      u64Tick++;
+
+      /// - Compute the next deadline from the start time (so jitter doesn't
+      ///   turn into drift)
+      INT64 i64OffsetUs = (INT64) ( u64Tick * sConfig.uPeriodUs );
+      if ( sConfig.uJitterUs > 0 ) {
+         i64OffsetUs += (INT64) ( audioSimRandom() % ( 2 * sConfig.uJitterUs + 1 ) ) - (INT64) sConfig.uJitterUs;
+      }
+
+      INT64 i64DueTicks = start.QuadPart + i64OffsetUs * sFrequency.QuadPart / 1000000;
+
+      /// - Sleep on the high-resolution timer until the deadline
+      QueryPerformanceCounter( &now );
+      if ( i64DueTicks > now.QuadPart ) {
+         dueTime.QuadPart = -( ( i64DueTicks - now.QuadPart ) * 10000000 / sFrequency.QuadPart );  // Negative is relative
+
+         if ( !SetWaitableTimer( shTimer, &dueTime, 0, NULL, NULL, FALSE )
+           || WaitForSingleObject( shTimer, INFINITE ) != WAIT_OBJECT_0 ) {
+            QUEUE_FATAL( IDS_AUDIO_SIM_TIMER_FAILED );  // "The simulated audio device's timer failed.  Exiting.  Investigate!"
+            break;
+         }
+      }
+
+      if ( !sbDeviceRunning ) {
+         break;
+      }
+
+      /// - Produce a buffer and tell #audioCaptureThread about it
+      audioSimProduce( i64DueTicks );
+
+      SetEvent( shReadyEvent );
+   }
+
+   LOG_TRACE_B( IDS_AUDIO_SIM_END_THREAD );  // "End simulated audio device thread"
+
+   logTraceReleaseRing();
+   logFlightReleaseRing();
+
+   ExitThread( 0 );
+}
+
+
+/// Start the simulated audio device
+///
+/// @param hSamplesReadyEvent Signal this event when a buffer is ready
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL audioSimStart( _In_ const HANDLE hSamplesReadyEvent ) {
+   _ASSERTE( sbEnabled );
+   _ASSERTE( hSamplesReadyEvent != NULL );
+   _ASSERTE( shDeviceThread == NULL );
+   _ASSERTE( spSlotMemory == NULL );
+
+   /// #### Function
+
+   shReadyEvent = hSamplesReadyEvent;
+
+   QueryPerformanceFrequency( &sFrequency );  // This never fails on Windows XP or later
+   si64PeriodTicks = (INT64) sConfig.uPeriodUs * sFrequency.QuadPart / 1000000;
+
+   /// - Reset the ring, the statistics and the random number generator
+   sl64Written           = 0;
+   sl64Read              = 0;
+   su64Position          = 0;
+   sbNextIsDiscontinuous = false;
+   su64Buffers           = 0;
+   su64DeadlineMisses    = 0;
+   su64Overruns          = 0;
+   si64LatencySum        = 0;
+   si64LatencyMax        = 0;
+   suRandom              = ( sConfig.uSeed != 0 ) ? sConfig.uSeed : 1;  // xorshift can't start at 0
+
+   /// - Allocate the buffers
+   suFramesPerBuffer = (UINT32) ( (UINT64) sConfig.uSampleRate * sConfig.uPeriodUs / 1000000 );
+   _ASSERTE( suFramesPerBuffer > 0 );
+
+   spSlotMemory = (BYTE*) _malloc_dbg( (size_t) suFramesPerBuffer * AUDIO_SIM_SLOTS, _CLIENT_BLOCK, __FILE__, __LINE__ );
+   if ( spSlotMemory == NULL ) {
+      RETURN_FATAL( IDS_AUDIO_SIM_FAILED_TO_ALLOCATE );  // "Failed to allocate memory for the simulated audio device.  Exiting."
+   }
+
+   for ( size_t i = 0 ; i < AUDIO_SIM_SLOTS ; i++ ) {
+      sSlots[ i ].pData = spSlotMemory + i * suFramesPerBuffer;
+   }
+
+   /// - Load the audio file (if there is one) or set up the synthesizer
+   if ( sConfig.wsFile[ 0 ] != L'\0' ) {
+      if ( !audioSimLoadFile() ) {
+         return FALSE;
+      }
+   } else {
+      dtmfCorpusConfig_t corpusConfig;
+      ZeroMemory( &corpusConfig, sizeof( corpusConfig ) );
+
+      corpusConfig.uSampleRate = sConfig.uSampleRate;
+      corpusConfig.uToneMs     = AUDIO_SIM_TONE_MS;
+      corpusConfig.uGapMs      = AUDIO_SIM_GAP_MS;
+      corpusConfig.fAmplitude  = AUDIO_SIM_AMPLITUDE;
+      corpusConfig.fSnrDb      = DTMF_CORPUS_NO_NOISE;
+      corpusConfig.uSeed       = sConfig.uSeed;
+
+      if ( !dtmfCorpusInit( &sCorpus, &corpusConfig, sConfig.wsDigits ) ) {
+         RETURN_FATAL( IDS_AUDIO_SIM_FAILED_TO_START_SYNTHESIZER );  // "Failed to start the simulated audio device's DTMF synthesizer.  Exiting."
+      }
+   }
+
+   /// - Create a high-resolution waitable timer (fall back to a regular one
+   ///   on older versions of Windows)
+   shTimer = CreateWaitableTimerExW( NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS );
+   if ( shTimer == NULL ) {
+      shTimer = CreateWaitableTimerExW( NULL, NULL, 0, TIMER_ALL_ACCESS );
+   }
+   if ( shTimer == NULL ) {
+      RETURN_FATAL( IDS_AUDIO_SIM_FAILED_TO_CREATE_TIMER );  // "Failed to create the simulated audio device's timer.  Exiting."
+   }
+
+   /// - Start the device thread
+   sbDeviceRunning = true;
+
+   shDeviceThread = CreateThread( NULL, 0, audioSimThread, NULL, 0, NULL );
+   if ( shDeviceThread == NULL ) {
+      sbDeviceRunning = false;
+      RETURN_FATAL( IDS_AUDIO_SIM_FAILED_TO_CREATE_THREAD );  // "Failed to create the simulated audio device thread.  Exiting."
+   }
+
+   LOG_INFO_R( IDS_AUDIO_SIM_STARTED, sConfig.uSampleRate, sConfig.uPeriodUs, sConfig.uJitterUs, suFramesPerBuffer );  // "Simulated audio device started:  %u Hz   Period: %u us   Jitter: %u us   %u frames per buffer"
+
+   return TRUE;
+}
+
+
+/// Stop the simulated audio device, log its statistics and release its
+/// resources
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL audioSimStop() {
+   BOOL br;  // BOOL result
+
+   /// #### Function
+
+   /// - Stop the device thread and wait for it to end.  It wakes up at least
+   ///   once a period, so this doesn't take long.
+   sbDeviceRunning = false;
+
+   if ( shDeviceThread != NULL ) {
+      if ( WaitForSingleObject( shDeviceThread, INFINITE ) != WAIT_OBJECT_0 ) {
+         RETURN_FATAL( IDS_AUDIO_SIM_THREAD_END_FAILED );  // "Wait for the simulated audio device thread to end failed.  Exiting."
+      }
+
+      br = CloseHandle( shDeviceThread );
+      CHECK_BR_R( IDS_AUDIO_SIM_FAILED_TO_CLOSE_HANDLE );  // "Failed to close a simulated audio device handle.  Exiting."
+      shDeviceThread = NULL;
+   }
+
+   if ( shTimer != NULL ) {
+      br = CloseHandle( shTimer );
+      CHECK_BR_R( IDS_AUDIO_SIM_FAILED_TO_CLOSE_HANDLE );  // "Failed to close a simulated audio device handle.  Exiting."
+      shTimer = NULL;
+   }
+
+   /// - Log the statistics
+   double dLatencyAvgMs = ( su64Buffers > 0 ) ? (double) si64LatencySum * 1000.0 / (double) sFrequency.QuadPart / (double) su64Buffers : 0.0;
+   double dLatencyMaxMs = (double) si64LatencyMax * 1000.0 / (double) sFrequency.QuadPart;
+
+   LOG_INFO_R( IDS_AUDIO_SIM_STATISTICS, su64Buffers, su64DeadlineMisses, su64Overruns, dLatencyAvgMs, dLatencyMaxMs );  // "Simulated audio device:  Buffers: %llu   Deadline misses: %llu   Overruns: %llu   Latency avg: %.3f ms   max: %.3f ms"
+
+   /// - Free the buffers
+   if ( spSlotMemory != NULL ) {
+      _free_dbg( spSlotMemory, _CLIENT_BLOCK );
+      spSlotMemory = NULL;
+   }
+
+   if ( spFileData != NULL ) {
+      _free_dbg( spFileData, _CLIENT_BLOCK );
+      spFileData  = NULL;
+      sstFileSize = 0;
+   }
+
+   shReadyEvent = NULL;
+
+   return TRUE;
+}
+
+
+/// The simulated device's version of `IAudioCaptureClient::GetBuffer`.  Called
+/// from #audioCapture.
+///
+/// @see https://learn.microsoft.com/en-us/windows/win32/api/audioclient/nf-audioclient-iaudiocaptureclient-getbuffer
+///
+/// @return `S_OK` if there's a buffer, `AUDCLNT_S_BUFFER_EMPTY` if there isn't
+static HRESULT audioSimGetBuffer(
+   _Out_       BYTE**  ppData,
+   _Out_       UINT32* pu32FramesToRead,
+   _Out_       DWORD*  pdwFlags,
+   _Out_opt_   UINT64* pu64DevicePosition,
+   _Out_opt_   UINT64* pu64QPCPosition ) {
+
+   _ASSERTE( ppData != NULL );
+   _ASSERTE( pu32FramesToRead != NULL );
+   _ASSERTE( pdwFlags != NULL );
+
+   if ( sl64Read == sl64Written ) {
+      *ppData           = NULL;
+      *pu32FramesToRead = 0;
+      *pdwFlags         = 0;
+      return AUDCLNT_S_BUFFER_EMPTY;
+   }
+
+   const audioSimSlot_t* pSlot = &sSlots[ sl64Read % AUDIO_SIM_SLOTS ];
+
+   *ppData           = pSlot->pData;
+   *pu32FramesToRead = pSlot->uFrames;
+   *pdwFlags         = pSlot->dwFlags;
+
+   if ( pu64DevicePosition != NULL ) {
+      *pu64DevicePosition = pSlot->u64Position;
+   }
+   if ( pu64QPCPosition != NULL ) {  // WASAPI reports when the first frame was recorded in 100ns units
+      *pu64QPCPosition = (UINT64) ( ( pSlot->i64DueTicks - si64PeriodTicks ) * 10000000 / sFrequency.QuadPart );
+   }
+
+   return S_OK;
+}
+
+
+/// The simulated device's version of `IAudioCaptureClient::ReleaseBuffer`.
+/// Called from #audioCapture after the DFT is done with the buffer, so this
+/// is where we measure the end-to-end latency.
+///
+/// @see https://learn.microsoft.com/en-us/windows/win32/api/audioclient/nf-audioclient-iaudiocaptureclient-releasebuffer
+///
+/// @return `S_OK` if successful
+static HRESULT audioSimReleaseBuffer( _In_ const UINT32 u32FramesRead ) {
+   UNREFERENCED_PARAMETER( u32FramesRead );
+
+   _ASSERTE( sl64Read < sl64Written );
+
+   LARGE_INTEGER now;
+   QueryPerformanceCounter( &now );
+
+   const audioSimSlot_t* pSlot = &sSlots[ sl64Read % AUDIO_SIM_SLOTS ];
+
+   INT64 i64Latency = now.QuadPart - pSlot->i64DueTicks;
+
+   su64Buffers++;
+   si64LatencySum += i64Latency;
+   if ( i64Latency > si64LatencyMax ) {
+      si64LatencyMax = i64Latency;
+   }
+   if ( i64Latency > si64PeriodTicks ) {
+      su64DeadlineMisses++;
+   }
+
+   InterlockedIncrement64( &sl64Read );
+
+   /// #audioCaptureThread calls GetBuffer once per event.  If the device got
+   /// ahead of us, signal the event again so we catch up.
+   if ( sl64Read != sl64Written ) {
+      SetEvent( shReadyEvent );
+   }
+
+   return S_OK;
+}
+
+
+const audioSource_t gAudioSimSource = {
+   audioSimGetBuffer,
+   audioSimReleaseBuffer
+};
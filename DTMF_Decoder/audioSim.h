@@ -0,0 +1,47 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// A simulated audio capture device that paces itself with the
+/// high-resolution performance counter
+///
+/// @file    audioSim.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>  // For BOOL, HANDLE, etc.
+#include "audio.h"    // For audioSource_t
+#include "g711.h"     // For g711Law_t
+
+
+/// The configuration of the simulated audio device.  All of the rates are in
+/// parts-per-million per buffer, so `10000` is a 1% chance.
+typedef struct {
+   UINT32 uSampleRate;         ///< Samples per second
+   UINT32 uPeriodUs;           ///< The nominal time between buffers in microseconds
+   UINT32 uJitterUs;           ///< Each buffer arrives up to +/- this many microseconds from its nominal time
+   UINT32 uDiscontinuityPpm;   ///< Chance of setting `AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY` on a buffer
+   UINT32 uTimestampErrorPpm;  ///< Chance of setting `AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR` on a buffer
+   UINT32 uSilentPpm;          ///< Chance of setting `AUDCLNT_BUFFERFLAGS_SILENT` on a buffer
+   UINT32 uSeed;               ///< Seed for the pseudo-random jitter and glitches (so runs are repeatable)
+   WCHAR  wsDigits[ 64 ];      ///< The DTMF digits to synthesize (repeats forever)
+   WCHAR  wsFile[ MAX_PATH ];  ///< If set, play this raw, 8-bit unsigned mono PCM file (repeats forever) instead of #wsDigits
+   g711Law_t law;              ///< How the frames are encoded.  #wsFile must already be encoded this way.
+} audioSimConfig_t;
+
+
+extern BOOL audioSimParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine );
+extern bool audioSimIsEnabled();
+extern UINT32 audioSimGetSampleRate();
+extern g711Law_t audioSimGetLaw();
+
+extern BOOL audioSimStart( _In_ const HANDLE hSamplesReadyEvent );
+extern BOOL audioSimStop();
+
+
+/// The simulated device's implementation of #audioSource_t
+extern const audioSource_t gAudioSimSource;
@@ -0,0 +1,608 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Throughput, latency and accuracy benchmarks for the Goertzel kernels.
+///
+/// The benchmarks run headless (no window and no audio device) from the
+/// command line:
+///
+///     DTMF_Decoder.exe /benchmark[:"C:\results.csv"]
+///
+/// For each sample rate in #sBenchmarkRates and each signal condition in
+/// #sBenchmarkConditions, #dtmfCorpusRender makes all 16 keys (several
+/// times over).  The signal is fed through #gPcmQueue a buffer at a time --
+/// just like #audioCapture does -- and every Goertzel kernel this build has
+/// analyzes each window on this thread.  We measure:
+///
+///   - Throughput:  Samples analyzed per second
+///   - Latency:  The time to analyze each buffer (p50, p90, p99 and max)
+///   - Accuracy:  Digits detected, digits missed and false detections
+///                (windows that decoded to a key that isn't sounding)
+///
+/// Because the corpus is generated, the ground truth comes from
+/// #dtmfCorpusKeyAt.
+///
+/// At 8kHz, the SIMD kernel is also fed each condition as G.711 (see
+/// #sBenchmarkInputs).  For those rows, the latency includes getting the
+/// buffer into #gPcmQueue:  Either decoded to 16-bit linear PCM and
+/// converted a sample at a time (what a separate decoding step would do) or
+/// expanded straight into the queue by #pcmEnqueueG711.
+///
+/// #mvcModelDirtyTest, #mvcSnapshotTest and #mvcHistoryTest run last.  They
+/// toggle every tone, publish snapshots and append history as fast as they
+/// can and log what the UI thread would have seen.  Then, #rtSchedJitterTest
+/// logs how late a DSP thread wakes up under load, with and without the
+/// real-time scheduling policy, and #numaPlaceTest logs the decoding
+/// throughput and cross-node traffic with and without NUMA placement.
+/// Then, #goertzelSlabTest attaches and detaches decoders as fast as it can
+/// while other threads decode, #timerWheelTest keeps 100,000 digit timers
+/// running and #dtmfEventsTest compares the event API to the bare detector.
+/// Finally, #goertzelTuneTest measures every kernel and work thread
+/// combination the autotuner picks from and checks that they agree.
+///
+/// The results are written as CSV (one row per kernel, rate and condition)
+/// so they can be compared from run to run.  The default file is
+/// #BENCHMARK_DEFAULT_FILE in the current directory.
+///
+/// ### APIs Used
+/// << Print Module API Documentation >>
+///
+/// @file    benchmark.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <malloc.h>       // For _malloc_dbg and _free_dbg
+#include <stdio.h>        // For sprintf_s()
+#include <stdlib.h>       // For qsort()
+#include <wchar.h>        // For wcsstr
+
+#include "version.h"      // For FULL_VERSION
+#include "audio.h"        // For PCM_8_BIT_SILENCE
+#include "mvcModel.h"     // For gPcmQueue and friends and mvcModelDirtyTest
+#include "goertzel.h"     // For the Goertzel kernels
+#include "dtmfCorpus.h"   // For the synthetic DTMF signals
+#include "g711.h"         // For the G.711 inputs
+#include "mvcSnapshot.h"  // For mvcSnapshotTest
+#include "mvcHistory.h"   // For mvcHistoryTest
+#include "rtSched.h"      // For rtSchedJitterTest
+#include "numaPlace.h"    // For numaPlaceTest
+#include "goertzelSlab.h" // For goertzelSlabTest
+#include "timerWheel.h"   // For timerWheelTest
+#include "dtmfEvents.h"   // For dtmfEventsTest
+#include "goertzelTune.h" // For goertzelTuneTest
+#include "benchmark.h"    // For yo bad self
+
+
+/// The results file when `/benchmark` doesn't name one
+#define BENCHMARK_DEFAULT_FILE L"DTMF_Benchmark.csv"
+
+/// The size of each buffer fed to #gPcmQueue (in ms).  This matches WASAPI's
+/// default shared-mode period.
+#define BENCHMARK_BUFFER_MS (10)
+
+/// The number of times each of the 16 keys is played in a run
+#define BENCHMARK_KEY_REPEATS (4)
+
+/// The digits played in a run (all 16 keys in keypad order)
+#define BENCHMARK_DIGITS DTMF_CORPUS_KEYS DTMF_CORPUS_KEYS DTMF_CORPUS_KEYS DTMF_CORPUS_KEYS
+
+/// The number of digits in #BENCHMARK_DIGITS
+#define BENCHMARK_DIGIT_COUNT ( 16 * BENCHMARK_KEY_REPEATS )
+
+/// The amplitude of the stronger tone (a digit is 2 tones, so this must be
+/// `<= PCM_8_BIT_SILENCE / 2`)
+#define BENCHMARK_AMPLITUDE (50.0f)
+
+/// The maximum length of a line in the results file
+#define BENCHMARK_MAX_LINE (512)
+
+
+/// The sample rates to benchmark
+static const UINT32 sBenchmarkRates[] = { 8000, 16000, 44100, 48000 };
+
+
+/// A signal condition to benchmark
+typedef struct {
+   PCWSTR wsName;          ///< The name of the condition (for the results)
+   float  fTwistDb;        ///< See #dtmfCorpusConfig_t.fTwistDb
+   float  fFreqOffsetPct;  ///< See #dtmfCorpusConfig_t.fFreqOffsetPct
+   float  fSnrDb;          ///< See #dtmfCorpusConfig_t.fSnrDb
+   UINT32 uToneMs;         ///< See #dtmfCorpusConfig_t.uToneMs
+   UINT32 uGapMs;          ///< See #dtmfCorpusConfig_t.uGapMs
+} benchmarkCondition_t;
+
+
+/// The signal conditions to benchmark.  The limits come from ITU-T Q.24:
+/// +/- 1.5% frequency tolerance, up to 8dB of reverse twist and 4dB of
+/// forward twist and 40ms tones with 40ms gaps.
+static const benchmarkCondition_t sBenchmarkConditions[] = {
+// wsName              Twist  Offset  SNR                   Tone  Gap
+   { L"clean",           0.0f,  0.0f, DTMF_CORPUS_NO_NOISE, 100, 100 },
+   { L"twist+4dB",       4.0f,  0.0f, DTMF_CORPUS_NO_NOISE, 100, 100 },
+   { L"twist-8dB",      -8.0f,  0.0f, DTMF_CORPUS_NO_NOISE, 100, 100 },
+   { L"offset+1.5%",     0.0f,  1.5f, DTMF_CORPUS_NO_NOISE, 100, 100 },
+   { L"offset-1.5%",     0.0f, -1.5f, DTMF_CORPUS_NO_NOISE, 100, 100 },
+   { L"snr20dB",         0.0f,  0.0f, 20.0f,                100, 100 },
+   { L"snr10dB",         0.0f,  0.0f, 10.0f,                100, 100 },
+   { L"short40ms",       0.0f,  0.0f, DTMF_CORPUS_NO_NOISE,  40,  40 },
+};
+
+
+/// How a signal is fed to the kernels
+typedef struct {
+   PCWSTR    wsName;  ///< The name of the input (for the results)
+   g711Law_t law;     ///< How the signal is encoded
+   bool      bFused;  ///< `true` to expand G.711 with #pcmEnqueueG711.  `false` to decode it to 16-bit linear PCM first.
+} benchmarkInput_t;
+
+
+/// The inputs to benchmark.  The G.711 inputs only run at 8kHz on
+/// #GOERTZEL_KERNEL_SIMD.
+static const benchmarkInput_t sBenchmarkInputs[] = {
+// wsName             Law          Fused
+   { L"pcm8",         G711_LINEAR, false },
+   { L"ulaw-decoded", G711_ULAW,   false },
+   { L"ulaw-fused",   G711_ULAW,   true  },
+   { L"alaw-decoded", G711_ALAW,   false },
+   { L"alaw-fused",   G711_ALAW,   true  },
+};
+
+
+/// The results of one kernel on one rate and condition
+typedef struct {
+   UINT64 u64Buffers;         ///< The number of buffers analyzed
+   double samplesPerSec;      ///< Samples analyzed per second
+   double p50Ns;              ///< Median time to analyze a buffer
+   double p90Ns;              ///< 90th percentile time to analyze a buffer
+   double p99Ns;              ///< 99th percentile time to analyze a buffer
+   double maxNs;              ///< The slowest buffer
+   size_t stHits;             ///< Digits that were detected
+   size_t stMisses;           ///< Digits that were never detected
+   size_t stFalseDetections;  ///< Windows that decoded to a key that wasn't sounding
+} benchmarkResult_t;
+
+
+static bool  sbEnabled = false;                       ///< `true` if the command line asked for the benchmarks
+static WCHAR swsResultsFile[ MAX_PATH ] = BENCHMARK_DEFAULT_FILE;  ///< Where to write the results
+
+static LARGE_INTEGER sFrequency;                      ///< Performance counter ticks per second
+
+
+/// Look for `/benchmark[:path]` on the command line
+///
+/// @param pwszCmdLine The command line passed to #wWinMain
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL benchmarkParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine ) {
+   /// #### Function
+
+   sbEnabled = false;
+
+   if ( pwszCmdLine == NULL ) {
+      return TRUE;
+   }
+
+   const WCHAR* pFound = wcsstr( pwszCmdLine, L"/benchmark" );
+   if ( pFound == NULL ) {
+      return TRUE;
+   }
+
+   sbEnabled = true;
+
+   /// - If there's a `:`, then the rest of the option (which may be quoted)
+   ///   is the results file
+   const WCHAR* pValue = pFound + wcslen( L"/benchmark" );
+   if ( *pValue == L':' ) {
+      pValue++;
+
+      WCHAR wEnd = L' ';
+      if ( *pValue == L'"' ) {
+         wEnd = L'"';
+         pValue++;
+      }
+
+      size_t i = 0;
+      while ( *pValue != L'\0' && *pValue != wEnd && i < _countof( swsResultsFile ) - 1 ) {
+         swsResultsFile[ i++ ] = *pValue++;
+      }
+      swsResultsFile[ i ] = L'\0';
+
+      if ( i == 0 ) {
+         RETURN_FATAL( IDS_BENCHMARK_INVALID_FILE );  // "The /benchmark results file is not valid.  Exiting."
+      }
+   }
+
+   return TRUE;
+}
+
+
+/// @return `true` if the command line asked for the benchmarks
+bool benchmarkIsEnabled() {
+   return sbEnabled;
+}
+
+
+/// Compare two doubles for `qsort`
+///
+/// @param p1 The first double
+/// @param p2 The second double
+/// @return `< 0`, `0` or `> 0`
+static int __cdecl benchmarkCompareDouble( _In_ const void* p1, _In_ const void* p2 ) {
+   double d1 = *(const double*) p1;
+   double d2 = *(const double*) p2;
+
+   return ( d1 < d2 ) ? -1 : ( d1 > d2 ) ? 1 : 0;
+}
+
+
+/// Get a percentile from a sorted array
+///
+/// @param pSorted  The sorted values
+/// @param stCount  The number of values
+/// @param fraction The percentile (`0.5` is the median)
+/// @return The value at the percentile
+static double benchmarkPercentile(
+   _In_reads_( stCount ) const double* pSorted,
+   _In_                  const size_t  stCount,
+   _In_                  const double  fraction ) {
+   _ASSERTE( stCount > 0 );
+
+   size_t stIndex = (size_t) ( fraction * (double) ( stCount - 1 ) + 0.5 );
+
+   return pSorted[ stIndex ];
+}
+
+
+/// Run one kernel over a rendered corpus
+///
+/// #gPcmQueue must be allocated and #goertzel_SetSampleRate must have been
+/// called for the corpus' sample rate.
+///
+/// @param kernel      The kernel to benchmark
+/// @param pInput      How #pSignal is encoded and fed to #gPcmQueue
+/// @param pCorpus     The generator that rendered #pSignal (for the ground truth)
+/// @param pSignal     The rendered signal (encoded per #pInput)
+/// @param stSignal    The number of frames in #pSignal
+/// @param stBuffer    The number of frames in each buffer
+/// @param pLinear     Scratch space for one buffer of 16-bit linear PCM
+/// @param pLatencies  Scratch space for one latency per buffer
+/// @param pResult     The results
+static void benchmarkKernel(
+   _In_                         const goertzelKernel_t   kernel,
+   _In_                         const benchmarkInput_t*  pInput,
+   _In_                         const dtmfCorpus_t*      pCorpus,
+   _In_reads_( stSignal )       const BYTE*              pSignal,
+   _In_                         const size_t             stSignal,
+   _In_                         const size_t             stBuffer,
+   _Out_writes_( stBuffer )           INT16*             pLinear,
+   _Out_writes_( stSignal / stBuffer ) double*           pLatencies,
+   _Out_                              benchmarkResult_t* pResult ) {
+   _ASSERTE( gPcmQueue != NULL );
+   _ASSERTE( stBuffer > 0 );
+
+   /// #### Function
+
+   ZeroMemory( pResult, sizeof( benchmarkResult_t ) );
+
+   bool digitHit[ BENCHMARK_DIGIT_COUNT ] = { false };
+
+   dtmfTones_t tones[ NUMBER_OF_DTMF_TONES ];  // Local copy of #gDtmfTones
+   CopyMemory( tones, gDtmfTones, sizeof( tones ) );
+
+   /// - Start with a silent queue
+   FillMemory( gPcmQueue, gstQueueSize, PCM_8_BIT_SILENCE );
+   gstQueueHead = 0;
+
+   LARGE_INTEGER start;    // Start time in ticks
+   LARGE_INTEGER end;      // End time in ticks
+   INT64 i64TotalTicks = 0;
+   size_t stBuffers    = stSignal / stBuffer;
+
+   for ( size_t b = 0 ; b < stBuffers ; b++ ) {
+      const BYTE* pBuffer = pSignal + b * stBuffer;
+
+      /// - Enqueue a buffer, then analyze the window.  For 8-bit PCM, only
+      ///   the kernel is timed.  For G.711, getting the buffer into the
+      ///   queue is timed too.
+      if ( pInput->law == G711_LINEAR ) {
+         for ( size_t i = 0 ; i < stBuffer ; i++ ) {
+            pcmEnqueue( pBuffer[ i ] );
+         }
+
+         QueryPerformanceCounter( &start );
+      } else if ( pInput->bFused ) {
+         QueryPerformanceCounter( &start );
+
+         pcmEnqueueG711( pInput->law, pBuffer, stBuffer );
+      } else {
+         QueryPerformanceCounter( &start );
+
+         for ( size_t i = 0 ; i < stBuffer ; i++ ) {
+            pLinear[ i ] = g711ToLinear16( pInput->law, pBuffer[ i ] );
+         }
+         for ( size_t i = 0 ; i < stBuffer ; i++ ) {
+            pcmEnqueue( (BYTE) ( PCM_8_BIT_SILENCE + ( (int) pLinear[ i ] * PCM_8_BIT_SILENCE ) / 32767 ) );
+         }
+      }
+
+      goertzelRunKernel( kernel, tones );
+      QueryPerformanceCounter( &end );
+
+      i64TotalTicks  += end.QuadPart - start.QuadPart;
+      pLatencies[ b ] = (double) ( end.QuadPart - start.QuadPart ) * 1.0e9 / (double) sFrequency.QuadPart;
+
+      /// - Score the window.  A key counts as a hit for the digit it
+      ///   overlaps.  A key that doesn't overlap its digit is a false
+      ///   detection.
+      WCHAR decoded = goertzelDecodeKey( tones );
+      if ( decoded == L'\0' ) {
+         continue;
+      }
+
+      UINT64 u64WindowEnd   = (UINT64) ( ( b + 1 ) * stBuffer );
+      UINT64 u64WindowStart = ( u64WindowEnd > gstQueueSize ) ? u64WindowEnd - gstQueueSize : 0;
+
+      if ( dtmfCorpusKeyAt( pCorpus, u64WindowEnd - 1 ) == decoded ) {
+         digitHit[ ( ( u64WindowEnd - 1 ) / pCorpus->u64DigitFrames ) % BENCHMARK_DIGIT_COUNT ] = true;
+      } else if ( dtmfCorpusKeyAt( pCorpus, u64WindowStart ) == decoded ) {
+         digitHit[ ( u64WindowStart / pCorpus->u64DigitFrames ) % BENCHMARK_DIGIT_COUNT ] = true;
+      } else {
+         pResult->stFalseDetections++;
+      }
+   }
+
+   /// - Summarize the throughput and latency
+   pResult->u64Buffers = stBuffers;
+
+   if ( i64TotalTicks > 0 ) {
+      pResult->samplesPerSec = (double) stBuffers * (double) gstQueueSize * (double) sFrequency.QuadPart / (double) i64TotalTicks;
+   }
+
+   qsort( pLatencies, stBuffers, sizeof( double ), benchmarkCompareDouble );
+
+   pResult->p50Ns = benchmarkPercentile( pLatencies, stBuffers, 0.50 );
+   pResult->p90Ns = benchmarkPercentile( pLatencies, stBuffers, 0.90 );
+   pResult->p99Ns = benchmarkPercentile( pLatencies, stBuffers, 0.99 );
+   pResult->maxNs = pLatencies[ stBuffers - 1 ];
+
+   /// - Count the digits
+   for ( size_t i = 0 ; i < BENCHMARK_DIGIT_COUNT ; i++ ) {
+      if ( digitHit[ i ] ) {
+         pResult->stHits++;
+      } else {
+         pResult->stMisses++;
+      }
+   }
+}
+
+
+/// Write a line to the results file
+///
+/// @param hFile  The results file
+/// @param pszLine The line (with its `\r\n`)
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+static BOOL benchmarkWriteLine( _In_ const HANDLE hFile, _In_z_ const char* pszLine ) {
+   DWORD dwLength  = (DWORD) strlen( pszLine );
+   DWORD dwWritten = 0;
+
+   BOOL br = WriteFile( hFile, pszLine, dwLength, &dwWritten, NULL );
+   if ( !br || dwWritten != dwLength ) {
+      RETURN_FATAL( IDS_BENCHMARK_FAILED_TO_WRITE_FILE, swsResultsFile );  // "Failed to write the benchmark results file [%s].  Exiting."
+   }
+
+   return TRUE;
+}
+
+
+/// Run every kernel over every sample rate and condition and write the
+/// results to #swsResultsFile
+///
+/// This runs on the main thread before the window or the audio device are
+/// created, so it owns #gPcmQueue and #gDtmfTones.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem or a
+///         self-test failed.
+BOOL benchmarkRun() {
+   _ASSERTE( sbEnabled );
+   _ASSERTE( gPcmQueue == NULL );
+
+   BOOL   br;                        // BOOL result
+   char   sLine[ BENCHMARK_MAX_LINE ];
+   size_t stResults = 0;
+
+   /// #### Function
+
+   LOG_INFO_R( IDS_BENCHMARK_ENABLED, swsResultsFile );  // "Running the benchmarks.  Results go to [%s]"
+
+   QueryPerformanceFrequency( &sFrequency );  // This never fails on Windows XP or later
+
+   /// - Create the results file and write the header
+   HANDLE hFile = CreateFileW( swsResultsFile, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+   if ( hFile == INVALID_HANDLE_VALUE ) {
+      RETURN_FATAL( IDS_BENCHMARK_FAILED_TO_OPEN_FILE, swsResultsFile );  // "Failed to open the benchmark results file [%s].  Exiting."
+   }
+
+   br = benchmarkWriteLine( hFile,
+      "version,kernel,sample_rate,condition,input,twist_db,freq_offset_pct,snr_db,tone_ms,gap_ms,"
+      "window_samples,buffers,samples_per_sec,latency_p50_ns,latency_p90_ns,latency_p99_ns,latency_max_ns,"
+      "digits,hits,misses,false_detections\r\n" );
+
+   BYTE*   pSignal    = NULL;
+   BYTE*   pCompanded = NULL;
+   double* pLatencies = NULL;
+   INT16   linear[ GOERTZEL_CONTEXT_MAX_RATE / 1000 * BENCHMARK_BUFFER_MS ];  // Scratch for the decoded G.711 inputs
+
+   for ( size_t r = 0 ; br && r < _countof( sBenchmarkRates ) ; r++ ) {
+      const UINT32 uRate = sBenchmarkRates[ r ];
+
+      /// - For each rate, size #gPcmQueue the same way #audioInit does and
+      ///   compute the Goertzel coefficients
+      br = pcmSetQueueSize( (size_t) uRate / 1000 * SIZE_OF_QUEUE_IN_MS );
+      if ( !br ) {
+         break;  // pcmSetQueueSize logged the problem
+      }
+
+      goertzel_SetSampleRate( (int) uRate );
+
+      const size_t stBuffer = (size_t) uRate * BENCHMARK_BUFFER_MS / 1000;
+
+      for ( size_t c = 0 ; br && c < _countof( sBenchmarkConditions ) ; c++ ) {
+         const benchmarkCondition_t* pCondition = &sBenchmarkConditions[ c ];
+
+         /// - For each condition, render the whole corpus once.  Then every
+         ///   kernel analyzes exactly the same signal.
+         dtmfCorpusConfig_t config;
+         ZeroMemory( &config, sizeof( config ) );
+
+         config.uSampleRate    = uRate;
+         config.uToneMs        = pCondition->uToneMs;
+         config.uGapMs         = pCondition->uGapMs;
+         config.fAmplitude     = BENCHMARK_AMPLITUDE;
+         config.fTwistDb       = pCondition->fTwistDb;
+         config.fFreqOffsetPct = pCondition->fFreqOffsetPct;
+         config.fSnrDb         = pCondition->fSnrDb;
+         config.uSeed          = 1;
+
+         dtmfCorpus_t corpus;
+         if ( !dtmfCorpusInit( &corpus, &config, BENCHMARK_DIGITS ) ) {
+            PROCESS_FATAL( IDS_BENCHMARK_FAILED_TO_START_CORPUS );  // "Failed to start the DTMF corpus generator.  Exiting."
+            br = FALSE;
+            break;
+         }
+
+         // Round the signal up to a whole number of buffers
+         size_t stSignal = (size_t) corpus.u64DigitFrames * BENCHMARK_DIGIT_COUNT;
+         stSignal = ( stSignal + stBuffer - 1 ) / stBuffer * stBuffer;
+
+         pSignal    = (BYTE*)   _malloc_dbg( stSignal, _CLIENT_BLOCK, __FILE__, __LINE__ );
+         pCompanded = (BYTE*)   _malloc_dbg( stSignal, _CLIENT_BLOCK, __FILE__, __LINE__ );
+         pLatencies = (double*) _malloc_dbg( stSignal / stBuffer * sizeof( double ), _CLIENT_BLOCK, __FILE__, __LINE__ );
+         if ( pSignal == NULL || pCompanded == NULL || pLatencies == NULL ) {
+            PROCESS_FATAL( IDS_BENCHMARK_FAILED_TO_ALLOCATE );  // "Failed to allocate memory for the benchmarks.  Exiting."
+            br = FALSE;
+            break;
+         }
+
+         dtmfCorpusRender( &corpus, pSignal, stSignal );
+
+         /// - Run every kernel this build has over every input and write a
+         ///   row for each
+         for ( int k = 0 ; br && k < GOERTZEL_KERNEL_COUNT ; k++ ) {
+            const goertzelKernel_t kernel = (goertzelKernel_t) k;
+            if ( !goertzelKernelAvailable( kernel ) ) {
+               continue;
+            }
+
+            for ( size_t n = 0 ; br && n < _countof( sBenchmarkInputs ) ; n++ ) {
+               const benchmarkInput_t* pInput = &sBenchmarkInputs[ n ];
+               if ( pInput->law != G711_LINEAR && ( uRate != 8000 || kernel != GOERTZEL_KERNEL_SIMD ) ) {
+                  continue;
+               }
+
+               const BYTE* pInputSignal = pSignal;
+               if ( pInput->law != G711_LINEAR ) {
+                  g711Compress( pInput->law, pSignal, pCompanded, stSignal );
+                  pInputSignal = pCompanded;
+               }
+
+               benchmarkResult_t result;
+               benchmarkKernel( kernel, pInput, &corpus, pInputSignal, stSignal, stBuffer, linear, pLatencies, &result );
+
+               sprintf_s( sLine, _countof( sLine ),
+                  "%s,%ls,%u,%ls,%ls,%.1f,%.2f,%.1f,%u,%u,%zu,%llu,%.0f,%.0f,%.0f,%.0f,%.0f,%d,%zu,%zu,%zu\r\n",
+                  FULL_VERSION, goertzelKernelName( kernel ), uRate, pCondition->wsName, pInput->wsName,
+                  pCondition->fTwistDb, pCondition->fFreqOffsetPct, pCondition->fSnrDb,
+                  pCondition->uToneMs, pCondition->uGapMs,
+                  gstQueueSize, result.u64Buffers, result.samplesPerSec,
+                  result.p50Ns, result.p90Ns, result.p99Ns, result.maxNs,
+                  BENCHMARK_DIGIT_COUNT, result.stHits, result.stMisses, result.stFalseDetections );
+
+               br = benchmarkWriteLine( hFile, sLine );
+
+               if ( pInput->law == G711_LINEAR ) {
+                  LOG_INFO_R( IDS_BENCHMARK_RESULT, goertzelKernelName( kernel ), uRate, pCondition->wsName, result.samplesPerSec / 1.0e6, result.p50Ns, result.p99Ns, result.stHits, BENCHMARK_DIGIT_COUNT, result.stFalseDetections );  // "Benchmark:  %-4s %6u Hz  %-12s %8.1f Msamples/s   p50: %.0f ns   p99: %.0f ns   Digits: %zu/%d   False: %zu"
+               } else {
+                  LOG_INFO_R( IDS_BENCHMARK_RESULT_G711, goertzelKernelName( kernel ), uRate, pCondition->wsName, pInput->wsName, result.samplesPerSec / 1.0e6, result.p50Ns, result.p99Ns, result.stHits, BENCHMARK_DIGIT_COUNT, result.stFalseDetections );  // "Benchmark:  %-4s %6u Hz  %-12s %-12s %8.1f Msamples/s   p50: %.0f ns   p99: %.0f ns   Digits: %zu/%d   False: %zu"
+               }
+
+               stResults++;
+            }
+         }
+
+         _free_dbg( pSignal, _CLIENT_BLOCK );
+         _free_dbg( pCompanded, _CLIENT_BLOCK );
+         _free_dbg( pLatencies, _CLIENT_BLOCK );
+         pSignal    = NULL;
+         pCompanded = NULL;
+         pLatencies = NULL;
+      }
+
+      pcmReleaseQueue();
+   }
+
+   /// - Clean up (even if there was a problem)
+   if ( pSignal != NULL ) {
+      _free_dbg( pSignal, _CLIENT_BLOCK );
+   }
+   if ( pCompanded != NULL ) {
+      _free_dbg( pCompanded, _CLIENT_BLOCK );
+   }
+   if ( pLatencies != NULL ) {
+      _free_dbg( pLatencies, _CLIENT_BLOCK );
+   }
+   if ( gPcmQueue != NULL ) {
+      pcmReleaseQueue();
+   }
+
+   CloseHandle( hFile );
+
+   if ( !br ) {
+      return FALSE;
+   }
+
+   /// - Run the self-tests.  Each one logs its results (not to the results
+   ///   file) and warns about its failures.  Run all of them, even after one
+   ///   fails.
+   bool bSelfTests = true;
+
+   /// - Count the UI updates under a storm of toggles
+   bSelfTests = mvcModelDirtyTest() && bSelfTests;
+
+   /// - Stress the triple buffer that publishes the model to the view
+   bSelfTests = mvcSnapshotTest() && bSelfTests;
+
+   /// - Stress the ring and check the pyramid behind the spectrogram
+   bSelfTests = mvcHistoryTest() && bSelfTests;
+
+   /// - Measure the DSP threads' wake jitter under load, with and without
+   ///   the real-time scheduling policy
+   bSelfTests = rtSchedJitterTest() && bSelfTests;
+
+   /// - Measure the streams' throughput and cross-node traffic, with and
+   ///   without NUMA placement
+   bSelfTests = numaPlaceTest() && bSelfTests;
+
+   /// - Measure the decoders' attach/detach rate while streams decode
+   bSelfTests = goertzelSlabTest() && bSelfTests;
+
+   /// - Measure the digit timers' wheel against polling every stream
+   bSelfTests = timerWheelTest() && bSelfTests;
+
+   /// - Measure the event API against the bare detector
+   bSelfTests = dtmfEventsTest() && bSelfTests;
+
+   /// - Measure the autotuner's combinations and check that they agree
+   bSelfTests = goertzelTuneTest() && bSelfTests;
+
+   LOG_INFO_R( IDS_BENCHMARK_DONE, stResults, swsResultsFile );  // "Benchmarks finished:  %zu results written to [%s]"
+
+   if ( !bSelfTests ) {
+      LOG_WARN_R( IDS_BENCHMARK_SELF_TESTS_FAILED );  // "At least one of the benchmark's self-tests failed.  See the warnings above."
+      return FALSE;
+   }
+
+   return TRUE;
+}
@@ -0,0 +1,20 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Throughput, latency and accuracy benchmarks for the Goertzel kernels
+///
+/// @file    benchmark.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>  // For BOOL, PCWSTR, etc.
+
+
+extern BOOL benchmarkParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine );
+extern bool benchmarkIsEnabled();
+extern BOOL benchmarkRun();
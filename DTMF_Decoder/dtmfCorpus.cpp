@@ -0,0 +1,302 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// A fast, table-driven generator of synthetic DTMF audio with a known
+/// ground truth.
+///
+/// The generator makes any of the 16 DTMF keys at any sample rate with a
+/// controlled twist, frequency offset, signal-to-noise ratio, tone duration
+/// and inter-digit gap.  It's used by the benchmarks and by the simulated
+/// audio device.
+///
+/// Each tone is a 32-bit phase accumulator that indexes a sine table, so a
+/// sample costs 2 table lookups, a few multiplies and (if there's noise) one
+/// xorshift.  The top bits of the accumulator index the table, so the
+/// frequency resolution is `sampleRate / 2^32` -- far finer than the
+/// Goertzel bins.
+///
+/// Because the signal is generated, we know exactly which key is sounding at
+/// any frame.  #dtmfCorpusKeyAt returns that ground truth.
+///
+/// ## Threads & Synchronization API
+/// | API                   | Link                                                                                     |
+/// |-----------------------| -----------------------------------------------------------------------------------------|
+/// | `InitOnceExecuteOnce` | https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-initonceexecuteonce |
+///
+/// @file    dtmfCorpus.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <wchar.h>        // For wcschr, wcsncpy_s
+
+/// _USE_MATH_DEFINES is for getting math defines in C++ (this is a .cpp file)
+#define _USE_MATH_DEFINES
+#include <math.h>         // For sin(), pow(), sqrt()
+
+#include "mvcModel.h"     // For gDtmfTones
+#include "audio.h"        // For PCM_8_BIT_SILENCE
+#include "dtmfCorpus.h"   // For yo bad self
+
+
+/// The number of bits used to index #sfSineTable
+#define DTMF_CORPUS_TABLE_BITS (10)
+
+/// The number of entries in #sfSineTable
+#define DTMF_CORPUS_TABLE_SIZE (1 << DTMF_CORPUS_TABLE_BITS)
+
+
+/// One cycle of a sine wave.  Built once by #dtmfCorpusBuildTable.
+static float sfSineTable[ DTMF_CORPUS_TABLE_SIZE ];
+
+/// Builds #sfSineTable exactly once, no matter how many threads call
+/// #dtmfCorpusInit at the same time
+static INIT_ONCE sTableOnce = INIT_ONCE_STATIC_INIT;
+
+
+/// Build #sfSineTable.  Called through `InitOnceExecuteOnce`.
+///
+/// @param pInitOnce  Not used
+/// @param pParameter Not used
+/// @param ppContext  Not used
+/// @return `TRUE`
+static BOOL CALLBACK dtmfCorpusBuildTable(
+   _Inout_     PINIT_ONCE pInitOnce,
+   _Inout_opt_ PVOID      pParameter,
+   _Out_opt_   PVOID*     ppContext ) {
+   UNREFERENCED_PARAMETER( pInitOnce );
+   UNREFERENCED_PARAMETER( pParameter );
+   UNREFERENCED_PARAMETER( ppContext );
+
+   for ( int i = 0 ; i < DTMF_CORPUS_TABLE_SIZE ; i++ ) {
+      sfSineTable[ i ] = (float) sin( 2.0 * M_PI * i / DTMF_CORPUS_TABLE_SIZE );
+   }
+
+   return TRUE;
+}
+
+
+/// Initialize a generator
+///
+/// @param pCorpus    The generator to initialize
+/// @param pConfig    The parameters of the signal
+/// @param pwszDigits The DTMF digits to play (repeats forever).  Characters
+///                   that aren't in #DTMF_CORPUS_KEYS are played as silence.
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL dtmfCorpusInit(
+   _Out_  dtmfCorpus_t*             pCorpus,
+   _In_   const dtmfCorpusConfig_t* pConfig,
+   _In_z_ PCWSTR                    pwszDigits ) {
+   _ASSERTE( pCorpus != NULL );
+   _ASSERTE( pConfig != NULL );
+   _ASSERTE( pwszDigits != NULL );
+
+   /// #### Function
+
+   ZeroMemory( pCorpus, sizeof( dtmfCorpus_t ) );
+
+   if ( pConfig->uSampleRate == 0 || pConfig->uToneMs + pConfig->uGapMs == 0 ) {
+      return FALSE;
+   }
+
+   /// - Build the sine table the first time through.  Other threads wait
+   ///   for it to finish.
+   if ( !InitOnceExecuteOnce( &sTableOnce, dtmfCorpusBuildTable, NULL, NULL ) ) {
+      return FALSE;
+   }
+
+   pCorpus->config = *pConfig;
+
+   if ( wcsncpy_s( pCorpus->wsDigits, _countof( pCorpus->wsDigits ), pwszDigits, _TRUNCATE ) == STRUNCATE ) {
+      return FALSE;
+   }
+   pCorpus->stDigits = wcslen( pCorpus->wsDigits );
+
+   pCorpus->u64ToneFrames  = (UINT64) pConfig->uSampleRate * pConfig->uToneMs / 1000;
+   pCorpus->u64DigitFrames = pCorpus->u64ToneFrames + (UINT64) pConfig->uSampleRate * pConfig->uGapMs / 1000;
+
+   if ( pCorpus->u64DigitFrames == 0 ) {
+      return FALSE;
+   }
+
+   /// - Convert the (offset) DTMF frequencies into phase increments.  A full
+   ///   cycle is `2^32`.
+   for ( int i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+      double frequency = gDtmfTones[ i ].frequency * ( 1.0 + pConfig->fFreqOffsetPct / 100.0 );
+
+      pCorpus->uPhaseStep[ i ] = (UINT32) ( frequency / pConfig->uSampleRate * 4294967296.0 );
+   }
+
+   /// - Apply the twist to the amplitudes.  The stronger tone gets
+   ///   #dtmfCorpusConfig_t.fAmplitude.
+   double twist = pow( 10.0, pConfig->fTwistDb / 20.0 );
+   if ( twist >= 1.0 ) {
+      pCorpus->fColAmplitude = pConfig->fAmplitude;
+      pCorpus->fRowAmplitude = (float) ( pConfig->fAmplitude / twist );
+   } else {
+      pCorpus->fRowAmplitude = pConfig->fAmplitude;
+      pCorpus->fColAmplitude = (float) ( pConfig->fAmplitude * twist );
+   }
+
+   /// - Scale the noise to the SNR.  Uniform noise in `[-a, a]` has an RMS
+   ///   of `a / sqrt(3)`.
+   if ( pConfig->fSnrDb < DTMF_CORPUS_NO_NOISE ) {
+      double signalRms = sqrt( ( pCorpus->fRowAmplitude * pCorpus->fRowAmplitude
+                               + pCorpus->fColAmplitude * pCorpus->fColAmplitude ) / 2.0 );
+      double noiseRms  = signalRms / pow( 10.0, pConfig->fSnrDb / 20.0 );
+
+      pCorpus->fNoiseAmplitude = (float) ( noiseRms * sqrt( 3.0 ) );
+   }
+
+   pCorpus->uNoiseState = ( pConfig->uSeed != 0 ) ? pConfig->uSeed : 1;  // xorshift can't start at 0
+
+   return TRUE;
+}
+
+
+/// Get the next noise sample.  xorshift32 is fast and good enough for noise.
+///
+/// Inlined for performance.
+///
+/// @param pCorpus The generator
+/// @return A uniform sample in `[-fNoiseAmplitude, fNoiseAmplitude)`
+__forceinline static float dtmfCorpusNoise( _Inout_ dtmfCorpus_t* pCorpus ) {
+   UINT32 x = pCorpus->uNoiseState;
+   x ^= x << 13;
+   x ^= x >> 17;
+   x ^= x << 5;
+   pCorpus->uNoiseState = x;
+
+   return (float) (INT32) x * ( 1.0f / 2147483648.0f ) * pCorpus->fNoiseAmplitude;
+}
+
+
+/// Convert a sample (centered on 0) to 8-bit PCM.  Round and clip.
+///
+/// @param fSample The sample
+/// @return The PCM_8 value
+__forceinline static BYTE dtmfCorpusToPcm( _In_ const float fSample ) {
+   int iSample = (int) floorf( (float) PCM_8_BIT_SILENCE + fSample + 0.5f );
+
+   if ( iSample < 0 ) {
+      return 0;
+   }
+   if ( iSample > 255 ) {
+      return 255;
+   }
+   return (BYTE) iSample;
+}
+
+
+/// Render the next frames of the signal
+///
+/// The frames are rendered a run at a time (the rest of a tone or the rest of
+/// a gap), so there are no divisions in the inner loops.
+///
+/// @param pCorpus  The generator
+/// @param pOut     Where to put the 8-bit PCM frames
+/// @param stFrames The number of frames to render
+void dtmfCorpusRender(
+   _Inout_                  dtmfCorpus_t* pCorpus,
+   _Out_writes_( stFrames ) BYTE*         pOut,
+   _In_                     const size_t  stFrames ) {
+   _ASSERTE( pCorpus != NULL );
+   _ASSERTE( pCorpus->u64DigitFrames > 0 );
+   _ASSERTE( pOut != NULL );
+
+   const UINT32 shift = 32 - DTMF_CORPUS_TABLE_BITS;
+
+   size_t stDone = 0;
+
+   while ( stDone < stFrames ) {
+      UINT64 u64Offset = pCorpus->u64Position % pCorpus->u64DigitFrames;
+      WCHAR  key       = dtmfCorpusKeyAt( pCorpus, pCorpus->u64Position );
+      UINT64 u64Run;
+
+      if ( u64Offset < pCorpus->u64ToneFrames ) {
+         u64Run = pCorpus->u64ToneFrames - u64Offset;
+      } else {
+         u64Run = pCorpus->u64DigitFrames - u64Offset;
+      }
+
+      if ( u64Run > (UINT64) ( stFrames - stDone ) ) {
+         u64Run = (UINT64) ( stFrames - stDone );
+      }
+
+      size_t stRun = (size_t) u64Run;
+
+      if ( key != L'\0' ) {
+         /// - Render the rest of a tone.  Each digit starts at phase 0.
+         size_t stKey    = wcschr( DTMF_CORPUS_KEYS, key ) - DTMF_CORPUS_KEYS;
+         UINT32 rowStep  = pCorpus->uPhaseStep[ stKey / 4 ];
+         UINT32 colStep  = pCorpus->uPhaseStep[ 4 + stKey % 4 ];
+
+         if ( u64Offset == 0 ) {
+            pCorpus->uRowPhase = 0;
+            pCorpus->uColPhase = 0;
+         }
+
+         UINT32 rowPhase = pCorpus->uRowPhase;
+         UINT32 colPhase = pCorpus->uColPhase;
+
+         for ( size_t i = 0 ; i < stRun ; i++ ) {
+            float fSample = pCorpus->fRowAmplitude * sfSineTable[ rowPhase >> shift ]
+                          + pCorpus->fColAmplitude * sfSineTable[ colPhase >> shift ];
+
+            if ( pCorpus->fNoiseAmplitude > 0.0f ) {
+               fSample += dtmfCorpusNoise( pCorpus );
+            }
+
+            pOut[ stDone + i ] = dtmfCorpusToPcm( fSample );
+
+            rowPhase += rowStep;
+            colPhase += colStep;
+         }
+
+         pCorpus->uRowPhase = rowPhase;
+         pCorpus->uColPhase = colPhase;
+      } else if ( pCorpus->fNoiseAmplitude > 0.0f ) {
+         /// - Render the rest of a gap (just the noise)
+         for ( size_t i = 0 ; i < stRun ; i++ ) {
+            pOut[ stDone + i ] = dtmfCorpusToPcm( dtmfCorpusNoise( pCorpus ) );
+         }
+      } else {
+         FillMemory( pOut + stDone, stRun, PCM_8_BIT_SILENCE );
+      }
+
+      stDone               += stRun;
+      pCorpus->u64Position += stRun;
+   }
+}
+
+
+/// The ground truth:  Which key is sounding at a frame?
+///
+/// @param pCorpus     The generator
+/// @param u64Position The frame
+/// @return The key from #DTMF_CORPUS_KEYS or `L'\0'` if the frame is silent
+WCHAR dtmfCorpusKeyAt(
+   _In_ const dtmfCorpus_t* pCorpus,
+   _In_ const UINT64        u64Position ) {
+   _ASSERTE( pCorpus != NULL );
+   _ASSERTE( pCorpus->u64DigitFrames > 0 );
+
+   if ( pCorpus->stDigits == 0 ) {
+      return L'\0';
+   }
+
+   if ( u64Position % pCorpus->u64DigitFrames >= pCorpus->u64ToneFrames ) {
+      return L'\0';  // The gap between the digits
+   }
+
+   WCHAR key = pCorpus->wsDigits[ ( u64Position / pCorpus->u64DigitFrames ) % pCorpus->stDigits ];
+
+   if ( key == L'\0' || wcschr( DTMF_CORPUS_KEYS, key ) == NULL ) {
+      return L'\0';  // Not a DTMF digit, so it's silent
+   }
+
+   return key;
+}
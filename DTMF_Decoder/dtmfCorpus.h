@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// A fast, table-driven generator of synthetic DTMF audio with a known
+/// ground truth
+///
+/// @file    dtmfCorpus.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>  // For BYTE, UINT32, etc.
+
+
+/// The 16 DTMF keys, laid out row by row just like the keypad.  The row of
+/// a key is `index / 4` and its column is `index % 4`.
+#define DTMF_CORPUS_KEYS L"123A456B789C*0#D"
+
+/// An SNR at or above this is treated as a clean signal (no noise is added)
+#define DTMF_CORPUS_NO_NOISE (100.0f)
+
+
+/// The parameters for a synthetic DTMF signal
+typedef struct {
+   UINT32 uSampleRate;      ///< Samples per second
+   UINT32 uToneMs;          ///< How long each digit sounds (in ms)
+   UINT32 uGapMs;           ///< The silence between digits (in ms)
+   float  fAmplitude;       ///< The peak amplitude of the stronger tone.  A digit is 2 tones, so this should be `<= PCM_8_BIT_SILENCE / 2`
+   float  fTwistDb;         ///< The level of the column (high) tone relative to the row (low) tone in dB.  `+` is forward twist.
+   float  fFreqOffsetPct;   ///< Shift both tones of every digit by this percent of their nominal frequency
+   float  fSnrDb;           ///< The signal-to-noise ratio in dB.  #DTMF_CORPUS_NO_NOISE or more is clean.
+   UINT32 uSeed;            ///< Seed for the noise (so runs are repeatable)
+} dtmfCorpusConfig_t;
+
+
+/// The state of a generator.  The generator is streaming, so it can make a
+/// signal of any length in chunks of any size.
+typedef struct {
+   dtmfCorpusConfig_t config;           ///< A copy of the configuration
+   WCHAR  wsDigits[ 64 ];               ///< The digits to play (repeats forever)
+   size_t stDigits;                     ///< The number of digits in #wsDigits
+   UINT64 u64ToneFrames;                ///< The number of frames in a tone
+   UINT64 u64DigitFrames;               ///< The number of frames in a tone and its gap
+   UINT64 u64Position;                  ///< The frame #dtmfCorpusRender will render next
+   UINT32 uRowPhase;                    ///< The phase accumulator of the row tone
+   UINT32 uColPhase;                    ///< The phase accumulator of the column tone
+   UINT32 uPhaseStep[ 8 ];              ///< The phase increment for each of the 8 DTMF frequencies
+   float  fRowAmplitude;                ///< The peak amplitude of the row tone
+   float  fColAmplitude;                ///< The peak amplitude of the column tone
+   float  fNoiseAmplitude;              ///< The peak amplitude of the (uniform) noise
+   UINT32 uNoiseState;                  ///< The xorshift state for the noise
+} dtmfCorpus_t;
+
+
+extern BOOL  dtmfCorpusInit( _Out_ dtmfCorpus_t* pCorpus, _In_ const dtmfCorpusConfig_t* pConfig, _In_z_ PCWSTR pwszDigits );
+extern void  dtmfCorpusRender( _Inout_ dtmfCorpus_t* pCorpus, _Out_writes_( stFrames ) BYTE* pOut, _In_ const size_t stFrames );
+extern WCHAR dtmfCorpusKeyAt( _In_ const dtmfCorpus_t* pCorpus, _In_ const UINT64 u64Position );
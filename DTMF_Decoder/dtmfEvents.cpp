@@ -0,0 +1,524 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// A C API that decodes a stream and delivers its tone and digit events in
+/// batches
+///
+/// The app's only output is #dtmfTones_t.detected and a repaint.  An
+/// application that embeds the decoder wants events instead:  When each tone
+/// turns on and off and when each digit goes down and up.
+///
+/// The application opens a stream with #dtmfEventsOpen and hands it samples
+/// with #dtmfEventsWrite.  Every 10ms of samples (a hop, like
+/// dtmfServiceDecode), the stream's decoder analyzes its window and the
+/// tones and key are compared with the last analysis.  The changes are the
+/// events, and they're delivered one of two ways:
+///
+///   - Callback:  If the stream has a callback, it's called once per
+///     analysis that has events, with all of them in one span.
+///   - Poll:  Otherwise, the events are queued in the stream and the
+///     application takes them in batches with #dtmfEventsPoll.  The queue
+///     holds #DTMF_EVENTS_QUEUE events.  If it's full, the newest events are
+///     dropped and counted (#dtmfEventsDropped).
+///
+/// A stream is one allocation, made by #dtmfEventsOpen:  The decoder, its
+/// window and the queue.  Nothing is allocated per event.
+///
+/// Each event is stamped with the index of the stream's newest sample when it
+/// was seen, so the application can line events up with its audio to the
+/// sample.  The analysis runs every hop, so that's when an event can be
+/// seen.
+///
+/// A stream belongs to one thread at a time.  Different streams can be used
+/// from different threads at once.
+///
+/// #dtmfEventsTest measures the cost of the events against the bare
+/// detector with 10,000 streams.  It runs with `/benchmark`.
+///
+/// @file    dtmfEvents.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <malloc.h>       // For _malloc_dbg and _free_dbg
+
+#include "mvcModel.h"     // For dtmfTones_t
+#include "goertzel.h"     // For goertzelContext_t
+#include "g711.h"         // For g711Law_t
+#include "dtmfCorpus.h"   // For the test's signal
+#include "dtmfEvents.h"   // For yo bad self
+
+
+/// A stream.  Its window follows it in the same allocation.
+struct dtmfEventsStream_t {
+   goertzelContext_t    decoder;          ///< The stream's decoder.  Its window is right after the stream.
+   g711Law_t            law;              ///< How the samples are encoded
+   dtmfEventsCallback_t pfnCallback;      ///< Gets the events or `NULL` to queue them for #dtmfEventsPoll
+   void*                pUser;            ///< For #pfnCallback
+   size_t               stHop;            ///< Samples between analyses (10ms)
+   size_t               stSinceAnalysis;  ///< Samples written since the last analysis
+   UINT64               u64Position;      ///< Samples written so far
+   UINT32               u32Tones;         ///< The tones that were on at the last analysis.  Bit `n` is `tones[ n ]`.
+   WCHAR                key;              ///< The key that was down at the last analysis or `L'\0'`
+   size_t               stQueueHead;      ///< The oldest event in #queue
+   size_t               stQueued;         ///< The events in #queue
+   UINT64               u64Dropped;       ///< The events that didn't fit in #queue
+   dtmfEvent_t          queue[ DTMF_EVENTS_QUEUE ];  ///< The events #dtmfEventsPoll hasn't taken
+};
+
+
+/// Open a stream
+///
+/// @param u32SampleRate Samples per second (`1000` to #GOERTZEL_CONTEXT_MAX_RATE)
+/// @param u32Format     How the samples are encoded (a #g711Law_t)
+/// @param pfnCallback   Gets each analysis' events, or `NULL` to queue them
+///                      for #dtmfEventsPoll
+/// @param pUser         Passed to #pfnCallback
+/// @return The stream or `NULL` if there was a problem.  Close it with
+///         #dtmfEventsClose.
+dtmfEventsStream_t* __cdecl dtmfEventsOpen(
+   _In_     const UINT32         u32SampleRate,
+   _In_     const UINT32         u32Format,
+   _In_opt_ dtmfEventsCallback_t pfnCallback,
+   _Inout_opt_ void*             pUser ) {
+
+   dtmfEventsStream_t* pStream = NULL;
+
+   if ( u32SampleRate >= 1000 && u32SampleRate <= GOERTZEL_CONTEXT_MAX_RATE && u32Format < G711_LAW_COUNT ) {
+      pStream = (dtmfEventsStream_t*) _malloc_dbg( sizeof( dtmfEventsStream_t ) + GOERTZEL_CONTEXT_WINDOW( u32SampleRate ), _CLIENT_BLOCK, __FILE__, __LINE__ );
+   }
+
+   if ( pStream != NULL ) {
+      ZeroMemory( pStream, sizeof( dtmfEventsStream_t ) );
+
+      if ( !goertzelContextInit( &pStream->decoder, (int) u32SampleRate, (BYTE*) ( pStream + 1 ) ) ) {
+         _free_dbg( pStream, _CLIENT_BLOCK );
+         pStream = NULL;
+      }
+   }
+
+   if ( pStream == NULL ) {
+      LOG_WARN_R( IDS_DTMF_EVENTS_FAILED_TO_OPEN, u32SampleRate, u32Format );  // "Failed to open an event stream (%u samples per second, format %u).  Continuing."
+      return NULL;
+   }
+
+   pStream->law         = (g711Law_t) u32Format;
+   pStream->pfnCallback = pfnCallback;
+   pStream->pUser       = pUser;
+   pStream->stHop       = u32SampleRate / 100;
+
+   return pStream;
+}
+
+
+/// Compare an analysis with the last one and deliver the changes
+///
+/// @param pStream The stream that was just analyzed
+/// @return The number of events
+static size_t dtmfEventsCollect( _Inout_ dtmfEventsStream_t* pStream ) {
+   UINT32 u32Tones = 0;
+
+   for ( UINT32 i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+      const dtmfTones_t* pTone = &pStream->decoder.tones[ i ];
+      if ( pTone->goertzelMagnitude >= GOERTZEL_MAGNITUDE_THRESHOLD && pTone->energyRatio >= GOERTZEL_RATIO_THRESHOLD ) {
+         u32Tones |= 1u << i;
+      }
+   }
+
+   /// Nearly every analysis is unchanged, so check that first.  If no tone
+   /// changed, the key can't have changed either.
+   if ( u32Tones == pStream->u32Tones ) {
+      return 0;
+   }
+
+   const WCHAR  key       = goertzelDecodeKey( pStream->decoder.tones );
+   const UINT32 u32Off    = pStream->u32Tones & ~u32Tones;
+   const UINT32 u32On     = u32Tones & ~pStream->u32Tones;
+   const UINT64 u64Sample = pStream->u64Position - 1;
+
+   dtmfEvent_t events[ DTMF_EVENTS_PER_ANALYSIS ];
+   size_t      stEvents = 0;
+
+   if ( key != pStream->key && pStream->key != L'\0' ) {
+      events[ stEvents++ ] = { u64Sample, DTMF_EVENT_DIGIT_UP, pStream->key };
+   }
+
+   for ( UINT32 i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+      if ( u32Off & ( 1u << i ) ) {
+         events[ stEvents++ ] = { u64Sample, DTMF_EVENT_TONE_OFF, i };
+      }
+   }
+
+   for ( UINT32 i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+      if ( u32On & ( 1u << i ) ) {
+         events[ stEvents++ ] = { u64Sample, DTMF_EVENT_TONE_ON, i };
+      }
+   }
+
+   if ( key != pStream->key && key != L'\0' ) {
+      events[ stEvents++ ] = { u64Sample, DTMF_EVENT_DIGIT_DOWN, key };
+   }
+
+   _ASSERTE( stEvents > 0 && stEvents <= DTMF_EVENTS_PER_ANALYSIS );
+
+   pStream->u32Tones = u32Tones;
+   pStream->key      = key;
+
+   /// - Hand the whole analysis to the callback or queue it
+   if ( pStream->pfnCallback != NULL ) {
+      pStream->pfnCallback( pStream->pUser, events, stEvents );
+      return stEvents;
+   }
+
+   for ( size_t i = 0 ; i < stEvents ; i++ ) {
+      if ( pStream->stQueued >= DTMF_EVENTS_QUEUE ) {
+         pStream->u64Dropped += stEvents - i;
+         break;
+      }
+
+      size_t stTail = pStream->stQueueHead + pStream->stQueued++;
+      stTail = ( stTail >= DTMF_EVENTS_QUEUE ) ? stTail - DTMF_EVENTS_QUEUE : stTail;
+
+      pStream->queue[ stTail ] = events[ i ];
+   }
+
+   return stEvents;
+}
+
+
+/// Decode samples.  Every hop, the stream's window is analyzed and any
+/// events are delivered (to the callback before this returns, or to the
+/// queue).
+///
+/// @param pStream   The stream
+/// @param pSamples  The samples (in the stream's format)
+/// @param stSamples The number of samples
+/// @return The number of events
+size_t __cdecl dtmfEventsWrite(
+   _Inout_                 dtmfEventsStream_t* pStream,
+   _In_reads_( stSamples ) const BYTE*         pSamples,
+   _In_                    size_t              stSamples ) {
+   _ASSERTE( pStream != NULL );
+
+   size_t stEvents = 0;
+
+   while ( stSamples > 0 ) {
+      size_t stRun = pStream->stHop - pStream->stSinceAnalysis;
+      stRun = ( stRun < stSamples ) ? stRun : stSamples;
+
+      goertzelContextWrite( &pStream->decoder, pStream->law, pSamples, stRun );
+
+      pSamples                 += stRun;
+      stSamples                -= stRun;
+      pStream->u64Position     += stRun;
+      pStream->stSinceAnalysis += stRun;
+
+      if ( pStream->stSinceAnalysis < pStream->stHop ) {
+         break;
+      }
+      pStream->stSinceAnalysis = 0;
+
+      goertzelContextAnalyze( &pStream->decoder );
+
+      stEvents += dtmfEventsCollect( pStream );
+   }
+
+   return stEvents;
+}
+
+
+/// Take the oldest queued events.  Streams with a callback never queue any.
+///
+/// @param pStream    The stream
+/// @param pEvents    Gets the events, oldest first
+/// @param stCapacity The events #pEvents holds
+/// @return The number of events in #pEvents.  `0` if there weren't any.
+size_t __cdecl dtmfEventsPoll(
+   _Inout_                              dtmfEventsStream_t* pStream,
+   _Out_writes_to_( stCapacity, return ) dtmfEvent_t*       pEvents,
+   _In_                                 const size_t        stCapacity ) {
+   _ASSERTE( pStream != NULL );
+   _ASSERTE( pEvents != NULL || stCapacity == 0 );
+
+   const size_t stTaken = ( pStream->stQueued < stCapacity ) ? pStream->stQueued : stCapacity;
+
+   /// The queue may wrap, so copy it in (at most) 2 runs
+   size_t stFirst = DTMF_EVENTS_QUEUE - pStream->stQueueHead;
+   stFirst = ( stFirst < stTaken ) ? stFirst : stTaken;
+
+   CopyMemory( pEvents,           &pStream->queue[ pStream->stQueueHead ], stFirst * sizeof( dtmfEvent_t ) );
+   CopyMemory( pEvents + stFirst, &pStream->queue[ 0 ],                    ( stTaken - stFirst ) * sizeof( dtmfEvent_t ) );
+
+   pStream->stQueueHead += stTaken;
+   pStream->stQueueHead  = ( pStream->stQueueHead >= DTMF_EVENTS_QUEUE ) ? pStream->stQueueHead - DTMF_EVENTS_QUEUE : pStream->stQueueHead;
+   pStream->stQueued    -= stTaken;
+
+   return stTaken;
+}
+
+
+/// @param pStream The stream
+/// @return The events that were dropped because the queue was full
+UINT64 __cdecl dtmfEventsDropped( _In_ const dtmfEventsStream_t* pStream ) {
+   _ASSERTE( pStream != NULL );
+
+   return pStream->u64Dropped;
+}
+
+
+/// Close a stream.  Any events still in its queue are discarded.
+///
+/// @param pStream The stream (it's OK if it's `NULL`)
+void __cdecl dtmfEventsClose( _In_opt_ dtmfEventsStream_t* pStream ) {
+   if ( pStream != NULL ) {
+      _free_dbg( pStream, _CLIENT_BLOCK );
+   }
+}
+
+
+/// The streams #dtmfEventsTest runs
+#define DTMF_EVENTS_TEST_STREAMS (10000)
+
+/// The sample rate of #dtmfEventsTest's streams
+#define DTMF_EVENTS_TEST_RATE    (8000)
+
+/// The signal #dtmfEventsTest plays on every stream (in ms)
+#define DTMF_EVENTS_TEST_MS      (1000)
+
+/// The samples #dtmfEventsTest writes at a time (20ms, like an RTP packet)
+#define DTMF_EVENTS_TEST_PACKET  (DTMF_EVENTS_TEST_RATE / 50)
+
+/// The digits in #dtmfEventsTest's signal
+#define DTMF_EVENTS_TEST_DIGITS  L"159#"
+
+
+/// What one pass of #dtmfEventsTest saw
+typedef struct {
+   UINT64 u64Digits;     ///< Digit down events (or key changes to a digit for the bare detector)
+   UINT64 u64Tones;      ///< Tone on and off events
+   UINT64 u64Hash;       ///< Every event, hashed in order
+   size_t stMisplaced;   ///< Digit down events stamped at a sample where their digit isn't sounding
+} dtmfEventsTestTally_t;
+
+
+static dtmfCorpus_t sTestCorpus;  ///< The signal's ground truth
+
+
+/// Count events for #dtmfEventsTest
+///
+/// @param pTally   What the pass saw
+/// @param pEvents  The events
+/// @param stEvents The number of events
+static void dtmfEventsTestCount( _Inout_ dtmfEventsTestTally_t* pTally, _In_reads_( stEvents ) const dtmfEvent_t* pEvents, _In_ const size_t stEvents ) {
+   for ( size_t i = 0 ; i < stEvents ; i++ ) {
+      const dtmfEvent_t* pEvent = &pEvents[ i ];
+
+      pTally->u64Hash = pTally->u64Hash * 0x100000001B3 ^ ( pEvent->u64Sample << 8 | pEvent->u32Type << 6 ) ^ pEvent->u32Value;
+
+      if ( pEvent->u32Type == DTMF_EVENT_DIGIT_DOWN ) {
+         pTally->u64Digits++;
+         if ( dtmfCorpusKeyAt( &sTestCorpus, pEvent->u64Sample ) != (WCHAR) pEvent->u32Value ) {
+            pTally->stMisplaced++;
+         }
+      } else if ( pEvent->u32Type == DTMF_EVENT_TONE_ON || pEvent->u32Type == DTMF_EVENT_TONE_OFF ) {
+         pTally->u64Tones++;
+      }
+   }
+}
+
+
+/// The callback for #dtmfEventsTest's callback pass
+///
+/// @param pUser    The pass' #dtmfEventsTestTally_t
+/// @param pEvents  The events
+/// @param stEvents The number of events
+static void __cdecl dtmfEventsTestCallback( _Inout_opt_ void* pUser, _In_reads_( stEvents ) const dtmfEvent_t* pEvents, _In_ size_t stEvents ) {
+   dtmfEventsTestCount( (dtmfEventsTestTally_t*) pUser, pEvents, stEvents );
+}
+
+
+/// Run one pass of #dtmfEventsTest
+///
+/// @param ppStreams The streams (already opened for the pass)
+/// @param pSignal   The signal every stream plays
+/// @param pTally    Gets what the pass saw
+/// @param bBare     `true` to run only the detector (no events)
+/// @return The QueryPerformanceCounter ticks the pass took
+static LONGLONG dtmfEventsTestPass(
+   _Inout_updates_( DTMF_EVENTS_TEST_STREAMS ) dtmfEventsStream_t** ppStreams,
+   _In_reads_( stSignal )                   const BYTE*           pSignal,
+   _In_                                     const size_t          stSignal,
+   _Inout_                                  dtmfEventsTestTally_t* pTally,
+   _In_                                     const bool            bBare ) {
+
+   LARGE_INTEGER start;
+   LARGE_INTEGER end;
+
+   dtmfEvent_t events[ DTMF_EVENTS_QUEUE ];
+
+   QueryPerformanceCounter( &start );
+
+   /// - A packet at a time for every stream, like a server would get them
+   for ( size_t stOffset = 0 ; stOffset + DTMF_EVENTS_TEST_PACKET <= stSignal ; stOffset += DTMF_EVENTS_TEST_PACKET ) {
+      for ( size_t i = 0 ; i < DTMF_EVENTS_TEST_STREAMS ; i++ ) {
+         dtmfEventsStream_t* pStream = ppStreams[ i ];
+
+         if ( !bBare ) {
+            if ( dtmfEventsWrite( pStream, pSignal + stOffset, DTMF_EVENTS_TEST_PACKET ) > 0 && pStream->pfnCallback == NULL ) {
+               dtmfEventsTestCount( pTally, events, dtmfEventsPoll( pStream, events, _countof( events ) ) );
+            }
+            continue;
+         }
+
+         /// - The bare detector is dtmfEventsWrite without the events:
+         ///   Write, analyze and decode the key
+         const BYTE* pSamples  = pSignal + stOffset;
+         size_t      stSamples = DTMF_EVENTS_TEST_PACKET;
+
+         while ( stSamples > 0 ) {
+            size_t stRun = pStream->stHop - pStream->stSinceAnalysis;
+            stRun = ( stRun < stSamples ) ? stRun : stSamples;
+
+            goertzelContextWrite( &pStream->decoder, pStream->law, pSamples, stRun );
+
+            pSamples                 += stRun;
+            stSamples                -= stRun;
+            pStream->stSinceAnalysis += stRun;
+
+            if ( pStream->stSinceAnalysis < pStream->stHop ) {
+               break;
+            }
+            pStream->stSinceAnalysis = 0;
+
+            goertzelContextAnalyze( &pStream->decoder );
+
+            const WCHAR key = goertzelDecodeKey( pStream->decoder.tones );
+            if ( key != pStream->key ) {
+               pTally->u64Digits += ( key != L'\0' ) ? 1 : 0;
+               pStream->key = key;
+            }
+         }
+      }
+   }
+
+   QueryPerformanceCounter( &end );
+
+   return end.QuadPart - start.QuadPart;
+}
+
+
+/// Measure the cost of the events against the bare detector
+///
+/// #DTMF_EVENTS_TEST_STREAMS streams play the same second of digits a
+/// packet at a time, 3 times:  With only the detector, with events polled
+/// after each packet and with events delivered to a callback.  Logs the
+/// time per analysis for each and what the events were.  It doesn't need a
+/// window or an audio device, so it runs with `/benchmark`.
+///
+/// @return `true` if the events matched the detector's keys, were stamped
+///         inside their digits, were the same both ways and none were
+///         dropped.  `false` if there was a problem.
+bool dtmfEventsTest() {
+   dtmfCorpusConfig_t config;
+   ZeroMemory( &config, sizeof( config ) );
+
+   config.uSampleRate = DTMF_EVENTS_TEST_RATE;
+   config.uToneMs     = 60;
+   config.uGapMs      = 80;
+   config.fAmplitude  = 50.0f;
+   config.fSnrDb      = DTMF_CORPUS_NO_NOISE;
+   config.uSeed       = 1;
+
+   const size_t stSignal = (size_t) DTMF_EVENTS_TEST_RATE * DTMF_EVENTS_TEST_MS / 1000;
+
+   BYTE*                pSignal   = (BYTE*)                _malloc_dbg( stSignal, _CLIENT_BLOCK, __FILE__, __LINE__ );
+   dtmfEventsStream_t** ppStreams = (dtmfEventsStream_t**) _malloc_dbg( DTMF_EVENTS_TEST_STREAMS * sizeof( dtmfEventsStream_t* ), _CLIENT_BLOCK, __FILE__, __LINE__ );
+
+   bool bStarted = pSignal != NULL && ppStreams != NULL && dtmfCorpusInit( &sTestCorpus, &config, DTMF_EVENTS_TEST_DIGITS );
+
+   if ( bStarted ) {
+      dtmfCorpusRender( &sTestCorpus, pSignal, stSignal );
+   }
+
+   dtmfEventsTestTally_t tallies[ 3 ];  // Bare, poll and callback
+   LONGLONG              llTicks[ 3 ] = { 0 };
+   UINT64                u64Dropped   = 0;
+
+   ZeroMemory( tallies, sizeof( tallies ) );
+
+   for ( size_t p = 0 ; p < _countof( tallies ) && bStarted ; p++ ) {
+      /// - Open every stream for the pass
+      size_t stOpened = 0;
+      while ( stOpened < DTMF_EVENTS_TEST_STREAMS ) {
+         ppStreams[ stOpened ] = dtmfEventsOpen( DTMF_EVENTS_TEST_RATE, G711_LINEAR, ( p == 2 ) ? dtmfEventsTestCallback : NULL, &tallies[ p ] );
+         if ( ppStreams[ stOpened ] == NULL ) {
+            bStarted = false;
+            break;
+         }
+         stOpened++;
+      }
+
+      if ( bStarted ) {
+         llTicks[ p ] = dtmfEventsTestPass( ppStreams, pSignal, stSignal, &tallies[ p ], p == 0 );
+      }
+
+      for ( size_t i = 0 ; i < stOpened ; i++ ) {
+         u64Dropped += dtmfEventsDropped( ppStreams[ i ] );
+         dtmfEventsClose( ppStreams[ i ] );
+      }
+   }
+
+   if ( pSignal != NULL ) {
+      _free_dbg( pSignal, _CLIENT_BLOCK );
+   }
+   if ( ppStreams != NULL ) {
+      _free_dbg( ppStreams, _CLIENT_BLOCK );
+   }
+
+   if ( !bStarted ) {
+      LOG_WARN_R( IDS_DTMF_EVENTS_TEST_FAILED_TO_START );  // "Failed to open the event test's streams.  Continuing."
+      return false;
+   }
+
+   LARGE_INTEGER frequency;
+   QueryPerformanceFrequency( &frequency );
+
+   const double dAnalyses = (double) DTMF_EVENTS_TEST_STREAMS * ( stSignal / ( DTMF_EVENTS_TEST_RATE / 100 ) );
+   double       dNs[ 3 ];
+
+   for ( size_t p = 0 ; p < _countof( dNs ) ; p++ ) {
+      dNs[ p ] = (double) llTicks[ p ] * 1.0e9 / (double) frequency.QuadPart / dAnalyses;
+   }
+
+   LOG_INFO_R( IDS_DTMF_EVENTS_TEST_RESULT,  // "Event test:  %zu streams   Per analysis:  Bare detector: %.0f ns   Polled: %.0f ns (%+.1f%%)   Callback: %.0f ns (%+.1f%%)   Digits: %llu (polled: %llu, callback: %llu)   Tone events: %llu   Misplaced: %zu   Dropped: %llu"
+      (size_t) DTMF_EVENTS_TEST_STREAMS,
+      dNs[ 0 ],
+      dNs[ 1 ], ( dNs[ 1 ] / dNs[ 0 ] - 1.0 ) * 100.0,
+      dNs[ 2 ], ( dNs[ 2 ] / dNs[ 0 ] - 1.0 ) * 100.0,
+      tallies[ 0 ].u64Digits,
+      tallies[ 1 ].u64Digits,
+      tallies[ 2 ].u64Digits,
+      tallies[ 1 ].u64Tones,
+      tallies[ 1 ].stMisplaced + tallies[ 2 ].stMisplaced,
+      u64Dropped );
+
+   size_t stErrors = tallies[ 1 ].stMisplaced + tallies[ 2 ].stMisplaced + (size_t) u64Dropped;
+
+   if ( tallies[ 1 ].u64Digits != tallies[ 0 ].u64Digits || tallies[ 0 ].u64Digits == 0 ) {
+      stErrors++;
+   }
+
+   if ( tallies[ 2 ].u64Digits != tallies[ 1 ].u64Digits || tallies[ 2 ].u64Tones != tallies[ 1 ].u64Tones || tallies[ 2 ].u64Hash != tallies[ 1 ].u64Hash ) {
+      stErrors++;
+   }
+
+   if ( stErrors > 0 ) {
+      LOG_WARN_R( IDS_DTMF_EVENTS_TEST_FAILED, stErrors );  // "The event test failed:  %zu events were missing, dropped, misplaced or delivered differently.  Continuing."
+      return false;
+   }
+
+   return true;
+}
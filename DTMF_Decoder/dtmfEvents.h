@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// A C API that decodes a stream and delivers its tone and digit events in
+/// batches
+///
+/// This header is C, so an application can embed the decoder without C++.
+///
+/// @file    dtmfEvents.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>  // For BYTE, UINT32, etc.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// The events a stream has queued for #dtmfEventsPoll.  If they aren't
+/// polled, the newest are dropped (see #dtmfEventsDropped).
+#define DTMF_EVENTS_QUEUE (64)
+
+/// The most events one analysis makes:  A tone off and on for each of the
+/// 8 tones, plus a digit up and down (in practice, it's far fewer)
+#define DTMF_EVENTS_PER_ANALYSIS (10)
+
+
+/// What happened.  The values are part of the API, so don't renumber them.
+enum dtmfEventType_t {
+   DTMF_EVENT_TONE_ON    = 1,  ///< A tone started.  #dtmfEvent_t.u32Value is the tone's index (`0` - `3` are the rows, `4` - `7` the columns).
+   DTMF_EVENT_TONE_OFF   = 2,  ///< A tone stopped.  #dtmfEvent_t.u32Value is the tone's index.
+   DTMF_EVENT_DIGIT_DOWN = 3,  ///< A digit started.  #dtmfEvent_t.u32Value is the key (a character from #DTMF_CORPUS_KEYS).
+   DTMF_EVENT_DIGIT_UP   = 4   ///< A digit stopped.  #dtmfEvent_t.u32Value is the key.
+};
+
+
+/// An event.  The events from one analysis all have the same
+/// #u64Sample and come in this order:  Digit up, tones off, tones on, then
+/// digit down.
+typedef struct {
+   UINT64 u64Sample;  ///< The stream's newest sample (counting from `0`) when the event was seen
+   UINT32 u32Type;    ///< A #dtmfEventType_t
+   UINT32 u32Value;   ///< The tone or the key (see #dtmfEventType_t)
+} dtmfEvent_t;
+
+
+/// A stream.  It's opaque:  Only dtmfEvents.cpp looks inside.
+typedef struct dtmfEventsStream_t dtmfEventsStream_t;
+
+
+/// Called from #dtmfEventsWrite once per analysis that has events
+///
+/// @param pUser    What was passed to #dtmfEventsOpen
+/// @param pEvents  The events.  They're only good until the callback returns.
+/// @param stEvents The number of events (`1` to #DTMF_EVENTS_PER_ANALYSIS)
+typedef void ( __cdecl* dtmfEventsCallback_t )( _Inout_opt_ void* pUser, _In_reads_( stEvents ) const dtmfEvent_t* pEvents, _In_ size_t stEvents );
+
+
+extern dtmfEventsStream_t* __cdecl dtmfEventsOpen( _In_ const UINT32 u32SampleRate, _In_ const UINT32 u32Format, _In_opt_ dtmfEventsCallback_t pfnCallback, _Inout_opt_ void* pUser );
+extern size_t              __cdecl dtmfEventsWrite( _Inout_ dtmfEventsStream_t* pStream, _In_reads_( stSamples ) const BYTE* pSamples, _In_ size_t stSamples );
+extern size_t              __cdecl dtmfEventsPoll( _Inout_ dtmfEventsStream_t* pStream, _Out_writes_to_( stCapacity, return ) dtmfEvent_t* pEvents, _In_ const size_t stCapacity );
+extern UINT64              __cdecl dtmfEventsDropped( _In_ const dtmfEventsStream_t* pStream );
+extern void                __cdecl dtmfEventsClose( _In_opt_ dtmfEventsStream_t* pStream );
+
+
+#ifdef __cplusplus
+}  // extern "C"
+
+extern bool dtmfEventsTest();
+#endif
@@ -0,0 +1,851 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// A load generator for the decoding service in dtmfService.cpp
+///
+/// The load generator runs headless (no window and no audio device):
+///
+///     DTMF_Decoder.exe /loadgen[:"C:\DTMF_Decoder.sock"] [/loadgenstreams:100] [/loadgenseconds:10] [/loadgenrate:8000] [/loadgenresults:"C:\results.csv"] [/loadgenflood] [/loadgeng711:ulaw|alaw]
+///     DTMF_Decoder.exe /loadgenshm[:"Local\DTMF_Decoder"] [...the same options...]
+///
+/// It opens `/loadgenstreams` connections to the service and, on each one,
+/// streams a different sequence of digits from #dtmfCorpusRender in real
+/// time for `/loadgenseconds`.  The streams are split over one thread per
+/// processor.  Every #DTMF_LOADGEN_TICK_MS, a thread sends each of its
+/// streams the audio that's come due and reads the events that came back.
+///
+/// `/loadgen` streams over the service's socket.  `/loadgenshm` streams
+/// through the service's shared-memory segment (see dtmfShm.cpp) and renders
+/// the audio directly into the stream's ring.  With `/loadgenflood`, the
+/// streams aren't paced:  Every thread sends as fast as the service will
+/// take it, so the throughput of the 2 transports can be compared.  With
+/// `/loadgeng711`, every stream is companded to G.711 before it's sent, so
+/// the service's expansion is part of what's measured.
+///
+/// We measure:
+///
+///   - Latency:  The time from sending the sample that completed the window
+///               (#dtmfServiceEvent_t.u64Position) to receiving the event.
+///               Each stream remembers when it sent each chunk, so the pacing
+///               of the load generator doesn't count against the service.
+///   - Accuracy:  Every key down is checked against #dtmfCorpusKeyAt
+///   - CPU:  The CPU time of the load generator and of the service (the
+///           service's process ID comes from `SIO_AF_UNIX_GETPEERPID`)
+///   - Throughput:  Samples sent per second, the number of sends (each one is
+///                  a system call over a socket) and, for shared memory, the
+///                  number of times a producer had to wake the service
+///
+/// The results are written as CSV (one row per stream) and summarized in the
+/// log (p50, p99, p99.9 and max latency over all streams and the spread of
+/// the per-stream means).
+///
+/// ## Sockets API
+/// | API                      | Link                                                                                          |
+/// |--------------------------| ----------------------------------------------------------------------------------------------|
+/// | `connect`                | https://learn.microsoft.com/en-us/windows/win32/api/winsock2/nf-winsock2-connect              |
+/// | `send`                   | https://learn.microsoft.com/en-us/windows/win32/api/winsock2/nf-winsock2-send                 |
+/// | `recv`                   | https://learn.microsoft.com/en-us/windows/win32/api/winsock/nf-winsock-recv                   |
+/// | `WSAIoctl`               | https://learn.microsoft.com/en-us/windows/win32/api/winsock2/nf-winsock2-wsaioctl             |
+/// | `SIO_AF_UNIX_GETPEERPID` | https://learn.microsoft.com/en-us/windows/win32/winsock/winsock-ioctls                        |
+///
+/// @file    dtmfLoadGen.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <malloc.h>       // For _malloc_dbg and _free_dbg
+#include <stdio.h>        // For sprintf_s()
+#include <stdlib.h>       // For qsort()
+
+#include "version.h"      // For FULL_VERSION
+#include "mvcModel.h"     // For SIZE_OF_QUEUE_IN_MS
+#include "goertzel.h"     // For GOERTZEL_CONTEXT_MAX_RATE
+#include "dtmfCorpus.h"   // For the synthetic DTMF signals
+#include "logTrace.h"     // For logTraceReleaseRing
+#include "logFlight.h"    // For logFlightReleaseRing
+#include "dtmfService.h"  // For the protocol
+#include "dtmfShm.h"      // For the shared-memory transport
+#include "g711.h"         // For g711Compress
+#include "dtmfLoadGen.h"  // For yo bad self
+
+#pragma comment(lib, "Ws2_32")
+
+
+/// The results file when `/loadgenresults` doesn't name one
+#define DTMF_LOADGEN_DEFAULT_FILE    L"DTMF_LoadGen.csv"
+
+/// The most streams `/loadgenstreams` can ask for
+#define DTMF_LOADGEN_MAX_STREAMS     (65536)
+
+/// How often each thread sends and receives (in milliseconds)
+#define DTMF_LOADGEN_TICK_MS         (10)
+
+/// How long to wait for the last events after the audio stops (in milliseconds)
+#define DTMF_LOADGEN_DRAIN_MS        (500)
+
+/// The most samples sent at once
+#define DTMF_LOADGEN_CHUNK           (4096)
+
+/// The most samples `/loadgenflood` sends a stream before moving on to the
+/// next one
+#define DTMF_LOADGEN_FLOOD_BURST     (65536)
+
+/// The number of sends each stream remembers (for the latency).  Must be a
+/// power of 2.
+#define DTMF_LOADGEN_SENDS           (256)
+
+/// The most worker threads
+#define DTMF_LOADGEN_MAX_THREADS     (64)
+
+/// How long each digit sounds and the gap after it (in ms)
+#define DTMF_LOADGEN_TONE_MS         (100)
+
+/// The amplitude of the stronger tone (see #BENCHMARK_AMPLITUDE)
+#define DTMF_LOADGEN_AMPLITUDE       (50.0f)
+
+/// The maximum length of a line in the results file
+#define DTMF_LOADGEN_MAX_LINE        (512)
+
+
+/// A send (for matching events to the time their sample was sent)
+typedef struct {
+   UINT64 u64End;  ///< The samples sent when this send finished
+   INT64  i64Qpc;  ///< When it finished (in performance counter ticks)
+} dtmfLoadGenSend_t;
+
+
+/// One stream.  Only the thread that owns it touches it.
+typedef struct {
+   SOCKET            socket;                               ///< The connection to the service (over a socket)
+   int               iShmStream;                           ///< The service's stream (over shared memory) or `-1`
+   bool              bOpen;                                ///< `false` if the service closed the stream
+   dtmfCorpus_t      corpus;                               ///< The stream's signal (and its ground truth)
+   UINT64            u64Sent;                              ///< Samples sent
+   UINT64            u64Sends;                             ///< Sends (or commits) that sent something
+   size_t            stPending;                            ///< Rendered samples in #pending that haven't been sent
+   size_t            stPendingOffset;                      ///< The next sample in #pending to send
+   BYTE              pending[ DTMF_LOADGEN_CHUNK ];        ///< Rendered samples
+   dtmfLoadGenSend_t sends[ DTMF_LOADGEN_SENDS ];          ///< The latest sends
+   UINT64            u64SendHead;                          ///< The next send to write
+   UINT64            u64SendTail;                          ///< The oldest send that an event could still match
+   BYTE              eventBytes[ sizeof( dtmfServiceEvent_t ) ];  ///< A partially received event
+   size_t            stEventBytes;                         ///< The bytes in #eventBytes
+   double*           pLatencies;                           ///< The latency of each event (in microseconds)
+   size_t            stLatencies;                          ///< The number of latencies in #pLatencies
+   size_t            stEvents;                             ///< Events received
+   size_t            stCorrect;                            ///< Keys that matched the ground truth
+   size_t            stIncorrect;                          ///< Keys that didn't
+} dtmfLoadGenStream_t;
+
+
+static bool   sbEnabled = false;                          ///< `true` if `/loadgen` is on the command line
+static WCHAR  swsSocket[ MAX_PATH ] = DTMF_SERVICE_DEFAULT_SOCKET;  ///< The service's socket
+static WCHAR  swsResultsFile[ MAX_PATH ] = DTMF_LOADGEN_DEFAULT_FILE;  ///< Where to write the results
+static UINT32 su32Streams    = 100;                       ///< The number of streams
+static UINT32 su32Seconds    = 10;                        ///< How long to stream
+static UINT32 su32SampleRate = 8000;                      ///< The sample rate of every stream
+static bool   sbShm   = false;                            ///< `true` to stream through shared memory instead of the socket
+static WCHAR  swsShmName[ MAX_PATH ] = DTMF_SHM_DEFAULT_NAME;  ///< The service's shared-memory segment
+static bool   sbFlood = false;                            ///< `true` to send as fast as the service takes it
+static g711Law_t sLaw = G711_LINEAR;                      ///< How the streams encode their samples (`/loadgeng711`)
+
+static dtmfLoadGenStream_t* spStreams = NULL;             ///< The streams
+static size_t sstLatencyCapacity = 0;                      ///< The latencies each stream can hold
+static LARGE_INTEGER sFrequency;                          ///< Performance counter ticks per second
+static LARGE_INTEGER sStart;                              ///< When the streams started
+
+
+/// Look for `/loadgen[:path]` or `/loadgenshm[:name]`, `/loadgenstreams:N`,
+/// `/loadgenseconds:N`, `/loadgenrate:N`, `/loadgenresults:path`,
+/// `/loadgenflood` and `/loadgeng711:law` on the command line
+///
+/// @param pwszCmdLine The command line passed to #wWinMain
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL dtmfLoadGenParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine ) {
+   /// #### Function
+
+   sbEnabled = false;
+
+   if ( pwszCmdLine == NULL ) {
+      return TRUE;
+   }
+
+   bool  bFound   = false;
+   bool  bResults = false;
+   bool  bG711    = false;
+   WCHAR wsUnused[ 2 ];  // `/loadgenflood` doesn't take a value
+   WCHAR wsLaw[ 8 ]  = L"";  // `/loadgeng711` needs a law
+
+   if ( !dtmfServiceParsePath( pwszCmdLine, L"/loadgen", swsSocket, _countof( swsSocket ), &bFound )
+     || !dtmfServiceParsePath( pwszCmdLine, L"/loadgenshm", swsShmName, _countof( swsShmName ), &sbShm )
+     || !dtmfServiceParsePath( pwszCmdLine, L"/loadgenflood", wsUnused, _countof( wsUnused ), &sbFlood ) ) {
+      RETURN_FATAL( IDS_DTMF_LOADGEN_INVALID_OPTION );  // "A /loadgen option is not valid.  Exiting."
+   }
+
+   if ( !bFound && !sbShm ) {
+      return TRUE;
+   }
+
+   if ( !dtmfServiceParsePath( pwszCmdLine, L"/loadgenresults", swsResultsFile, _countof( swsResultsFile ), &bResults )
+     || !dtmfServiceParseNumber( pwszCmdLine, L"/loadgenstreams:", &su32Streams )
+     || !dtmfServiceParseNumber( pwszCmdLine, L"/loadgenseconds:", &su32Seconds )
+     || !dtmfServiceParseNumber( pwszCmdLine, L"/loadgenrate:", &su32SampleRate )
+     || su32Streams == 0
+     || su32Streams > DTMF_LOADGEN_MAX_STREAMS
+     || su32Seconds == 0
+     || su32SampleRate < 1000
+     || su32SampleRate > GOERTZEL_CONTEXT_MAX_RATE
+     || !dtmfServiceParsePath( pwszCmdLine, L"/loadgeng711", wsLaw, _countof( wsLaw ), &bG711 )
+     || ( bG711 && !g711ParseLaw( wsLaw, &sLaw ) ) ) {
+      RETURN_FATAL( IDS_DTMF_LOADGEN_INVALID_OPTION );  // "A /loadgen option is not valid.  Exiting."
+   }
+
+   sbEnabled = true;
+
+   return TRUE;
+}
+
+
+/// @return `true` if the command line asked for the load generator
+bool dtmfLoadGenIsEnabled() {
+   return sbEnabled;
+}
+
+
+/// Compare two doubles for `qsort`
+///
+/// @param p1 The first double
+/// @param p2 The second double
+/// @return `< 0`, `0` or `> 0`
+static int __cdecl dtmfLoadGenCompareDouble( _In_ const void* p1, _In_ const void* p2 ) {
+   double d1 = *(const double*) p1;
+   double d2 = *(const double*) p2;
+
+   return ( d1 < d2 ) ? -1 : ( d1 > d2 ) ? 1 : 0;
+}
+
+
+/// Get a percentile from a sorted array
+///
+/// @param pSorted  The sorted values
+/// @param stCount  The number of values
+/// @param fraction The percentile (`0.5` is the median)
+/// @return The value at the percentile (or `0` if there aren't any values)
+static double dtmfLoadGenPercentile(
+   _In_reads_( stCount ) const double* pSorted,
+   _In_                  const size_t  stCount,
+   _In_                  const double  fraction ) {
+   if ( stCount == 0 ) {
+      return 0.0;
+   }
+
+   return pSorted[ (size_t) ( fraction * (double) ( stCount - 1 ) + 0.5 ) ];
+}
+
+
+/// Get a process' CPU time
+///
+/// @param hProcess The process
+/// @return The kernel and user time of the process (in 100ns ticks)
+static UINT64 dtmfLoadGenCpuTicks( _In_ const HANDLE hProcess ) {
+   FILETIME ftCreation, ftExit, ftKernel, ftUser;
+
+   if ( !GetProcessTimes( hProcess, &ftCreation, &ftExit, &ftKernel, &ftUser ) ) {
+      return 0;
+   }
+
+   return ( (UINT64) ftKernel.dwHighDateTime << 32 | ftKernel.dwLowDateTime )
+        + ( (UINT64) ftUser.dwHighDateTime   << 32 | ftUser.dwLowDateTime );
+}
+
+
+/// Handle an event from the service
+///
+/// @param pStream The stream
+/// @param pEvent  The event
+/// @param i64Now  When it arrived (in performance counter ticks)
+static void dtmfLoadGenHandleEvent( _Inout_ dtmfLoadGenStream_t* pStream, _In_ const dtmfServiceEvent_t* pEvent, _In_ const INT64 i64Now ) {
+   if ( pEvent->u32Magic != DTMF_SERVICE_MAGIC || pEvent->u32Type == DTMF_SERVICE_EVENT_REJECTED ) {
+      pStream->bOpen = false;
+      return;
+   }
+
+   pStream->stEvents++;
+
+   /// - The latency is measured from the send that carried the event's
+   ///   last sample.  Events come in order, so the tail only moves forward.
+   while ( pStream->u64SendTail < pStream->u64SendHead
+        && pStream->sends[ pStream->u64SendTail & ( DTMF_LOADGEN_SENDS - 1 ) ].u64End < pEvent->u64Position ) {
+      pStream->u64SendTail++;
+   }
+
+   if ( pStream->u64SendTail < pStream->u64SendHead && pStream->stLatencies < sstLatencyCapacity ) {
+      const INT64 i64Sent = pStream->sends[ pStream->u64SendTail & ( DTMF_LOADGEN_SENDS - 1 ) ].i64Qpc;
+      pStream->pLatencies[ pStream->stLatencies++ ] = (double) ( i64Now - i64Sent ) * 1.0e6 / (double) sFrequency.QuadPart;
+   }
+
+   /// - Score key downs the same way #benchmarkKernel does:  The key must
+   ///   be sounding at the start or the end of the window that found it
+   if ( pEvent->u32Type == DTMF_SERVICE_EVENT_KEY_DOWN && pEvent->u64Position > 0 ) {
+      const UINT64 u64Window = (UINT64) su32SampleRate / 1000 * SIZE_OF_QUEUE_IN_MS;
+      const UINT64 u64Start  = ( pEvent->u64Position > u64Window ) ? pEvent->u64Position - u64Window : 0;
+      const WCHAR  key       = (WCHAR) pEvent->u32Key;
+
+      if ( dtmfCorpusKeyAt( &pStream->corpus, pEvent->u64Position - 1 ) == key
+        || dtmfCorpusKeyAt( &pStream->corpus, u64Start ) == key ) {
+         pStream->stCorrect++;
+      } else {
+         pStream->stIncorrect++;
+      }
+   }
+}
+
+
+/// Remember a send (for the latency).  If the ring is full, forget the
+/// oldest one.
+///
+/// @param pStream The stream
+static void dtmfLoadGenRecordSend( _Inout_ dtmfLoadGenStream_t* pStream ) {
+   LARGE_INTEGER now;
+   QueryPerformanceCounter( &now );
+
+   dtmfLoadGenSend_t* pSend = &pStream->sends[ pStream->u64SendHead & ( DTMF_LOADGEN_SENDS - 1 ) ];
+   pSend->u64End = pStream->u64Sent;
+   pSend->i64Qpc = now.QuadPart;
+
+   pStream->u64Sends++;
+   pStream->u64SendHead++;
+   if ( pStream->u64SendHead - pStream->u64SendTail > DTMF_LOADGEN_SENDS ) {
+      pStream->u64SendTail = pStream->u64SendHead - DTMF_LOADGEN_SENDS;
+   }
+}
+
+
+/// Render a stream's audio that's come due directly into its shared-memory
+/// ring.  This never blocks.  If the ring is full, the rest is sent next
+/// time.
+///
+/// @param pStream The stream
+/// @param u64Due  The samples that should have been sent by now
+static void dtmfLoadGenSendShm( _Inout_ dtmfLoadGenStream_t* pStream, _In_ const UINT64 u64Due ) {
+   while ( pStream->u64Sent < u64Due ) {
+      BYTE*  pSamples = NULL;
+      size_t stFree   = dtmfShmReserve( pStream->iShmStream, &pSamples );
+      if ( stFree == 0 ) {
+         return;  // The service hasn't caught up
+      }
+
+      const UINT64 u64Render = u64Due - pStream->u64Sent;
+      if ( u64Render < (UINT64) stFree ) {
+         stFree = (size_t) u64Render;
+      }
+
+      dtmfCorpusRender( &pStream->corpus, pSamples, stFree );
+      g711Compress( sLaw, pSamples, pSamples, stFree );
+      dtmfShmCommit( pStream->iShmStream, stFree );
+
+      pStream->u64Sent += (UINT64) stFree;
+      dtmfLoadGenRecordSend( pStream );
+   }
+}
+
+
+/// Send a stream the audio that's come due.  This never blocks.  If the
+/// service isn't keeping up, the rest is sent next time.
+///
+/// @param pStream The stream
+/// @param u64Due  The samples that should have been sent by now
+static void dtmfLoadGenSendAudio( _Inout_ dtmfLoadGenStream_t* pStream, _In_ const UINT64 u64Due ) {
+   if ( pStream->iShmStream >= 0 ) {
+      dtmfLoadGenSendShm( pStream, u64Due );
+      return;
+   }
+
+   while ( pStream->u64Sent < u64Due ) {
+      if ( pStream->stPending == 0 ) {
+         UINT64 u64Render = u64Due - pStream->u64Sent;
+         u64Render = ( u64Render < DTMF_LOADGEN_CHUNK ) ? u64Render : DTMF_LOADGEN_CHUNK;
+
+         dtmfCorpusRender( &pStream->corpus, pStream->pending, (size_t) u64Render );
+         g711Compress( sLaw, pStream->pending, pStream->pending, (size_t) u64Render );
+         pStream->stPending       = (size_t) u64Render;
+         pStream->stPendingOffset = 0;
+      }
+
+      int iSent = send( pStream->socket, (const char*) pStream->pending + pStream->stPendingOffset, (int) pStream->stPending, 0 );
+      if ( iSent == SOCKET_ERROR ) {
+         if ( WSAGetLastError() != WSAEWOULDBLOCK ) {
+            pStream->bOpen = false;
+         }
+         return;
+      }
+
+      pStream->u64Sent         += (UINT64) iSent;
+      pStream->stPending       -= (size_t) iSent;
+      pStream->stPendingOffset += (size_t) iSent;
+
+      dtmfLoadGenRecordSend( pStream );
+   }
+}
+
+
+/// Read the events that have come back on a stream.  This never blocks.
+///
+/// @param pStream The stream
+static void dtmfLoadGenReceiveEvents( _Inout_ dtmfLoadGenStream_t* pStream ) {
+   if ( pStream->iShmStream >= 0 ) {
+      dtmfServiceEvent_t event;
+
+      while ( pStream->bOpen && dtmfShmReadEvent( pStream->iShmStream, &event ) ) {
+         LARGE_INTEGER now;
+         QueryPerformanceCounter( &now );
+
+         dtmfLoadGenHandleEvent( pStream, &event, now.QuadPart );
+      }
+      return;
+   }
+
+   for ( ;; ) {
+      int iReceived = recv( pStream->socket, (char*) pStream->eventBytes + pStream->stEventBytes, (int) ( sizeof( dtmfServiceEvent_t ) - pStream->stEventBytes ), 0 );
+
+      if ( iReceived == 0 || ( iReceived == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK ) ) {
+         pStream->bOpen = false;  // The service closed the stream
+         return;
+      }
+
+      if ( iReceived == SOCKET_ERROR ) {
+         return;  // Nothing more for now
+      }
+
+      pStream->stEventBytes += (size_t) iReceived;
+      if ( pStream->stEventBytes < sizeof( dtmfServiceEvent_t ) ) {
+         continue;
+      }
+
+      LARGE_INTEGER now;
+      QueryPerformanceCounter( &now );
+
+      dtmfServiceEvent_t event;
+      CopyMemory( &event, pStream->eventBytes, sizeof( event ) );
+      pStream->stEventBytes = 0;
+
+      dtmfLoadGenHandleEvent( pStream, &event, now.QuadPart );
+      if ( !pStream->bOpen ) {
+         return;
+      }
+   }
+}
+
+
+/// A worker thread.  It streams audio to its slice of the streams in real
+/// time (or, with `/loadgenflood`, as fast as the service takes it) and reads
+/// their events.
+///
+/// @param pParam The slice (the first stream is `pParam & 0xFFFFFFFF` and the
+///               number of streams is `pParam >> 32`)
+/// @return `0`
+static DWORD WINAPI dtmfLoadGenThread( _In_ LPVOID pParam ) {
+   const size_t stFirst = (size_t) ( (UINT64) (UINT_PTR) pParam & 0xFFFFFFFF );
+   const size_t stCount = (size_t) ( (UINT64) (UINT_PTR) pParam >> 32 );
+
+   const INT64 i64Duration = (INT64) su32Seconds * sFrequency.QuadPart;
+   const INT64 i64Drain    = (INT64) DTMF_LOADGEN_DRAIN_MS * sFrequency.QuadPart / 1000;
+
+   for ( ;; ) {
+      LARGE_INTEGER now;
+      QueryPerformanceCounter( &now );
+
+      const INT64 i64Elapsed = now.QuadPart - sStart.QuadPart;
+      if ( i64Elapsed > i64Duration + i64Drain ) {
+         break;
+      }
+
+      const bool   bSending = ( i64Elapsed < i64Duration );
+      const UINT64 u64Due   = (UINT64) i64Elapsed * su32SampleRate / (UINT64) sFrequency.QuadPart;
+
+      for ( size_t i = stFirst ; i < stFirst + stCount ; i++ ) {
+         dtmfLoadGenStream_t* pStream = &spStreams[ i ];
+
+         if ( pStream->bOpen && bSending ) {
+            dtmfLoadGenSendAudio( pStream, sbFlood ? pStream->u64Sent + DTMF_LOADGEN_FLOOD_BURST : u64Due );
+         }
+         if ( pStream->bOpen ) {
+            dtmfLoadGenReceiveEvents( pStream );
+         }
+      }
+
+      if ( !sbFlood || !bSending ) {
+         Sleep( DTMF_LOADGEN_TICK_MS );
+      }
+   }
+
+   logTraceReleaseRing();
+   logFlightReleaseRing();
+
+   return 0;
+}
+
+
+/// Connect a stream to the service and send its hello (over a socket) or
+/// open one of the service's shared-memory streams
+///
+/// @param pStream  The stream
+/// @param pAddress The service's address (over a socket)
+/// @param stIndex  The stream's number (to pick its digits and noise)
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+static BOOL dtmfLoadGenConnect( _Out_ dtmfLoadGenStream_t* pStream, _In_ const SOCKADDR_UN* pAddress, _In_ const size_t stIndex ) {
+   /// - Each stream plays all 16 keys, starting at a different one
+   WCHAR wsDigits[ 17 ];
+   for ( size_t i = 0 ; i < 16 ; i++ ) {
+      wsDigits[ i ] = DTMF_CORPUS_KEYS[ ( stIndex + i ) % 16 ];
+   }
+   wsDigits[ 16 ] = L'\0';
+
+   dtmfCorpusConfig_t config;
+   ZeroMemory( &config, sizeof( config ) );
+
+   config.uSampleRate = su32SampleRate;
+   config.uToneMs     = DTMF_LOADGEN_TONE_MS;
+   config.uGapMs      = DTMF_LOADGEN_TONE_MS;
+   config.fAmplitude  = DTMF_LOADGEN_AMPLITUDE;
+   config.fSnrDb      = DTMF_CORPUS_NO_NOISE;
+   config.uSeed       = (UINT32) stIndex + 1;
+
+   if ( !dtmfCorpusInit( &pStream->corpus, &config, wsDigits ) ) {
+      return FALSE;
+   }
+
+   if ( sbShm ) {
+      pStream->iShmStream = dtmfShmOpenStream( su32SampleRate, sLaw );
+      if ( pStream->iShmStream < 0 ) {
+         return FALSE;  // The service is out of streams
+      }
+
+      pStream->bOpen = true;
+
+      return TRUE;
+   }
+
+   pStream->socket = socket( AF_UNIX, SOCK_STREAM, 0 );
+   if ( pStream->socket == INVALID_SOCKET ) {
+      return FALSE;
+   }
+
+   if ( connect( pStream->socket, (const SOCKADDR*) pAddress, (int) sizeof( SOCKADDR_UN ) ) != 0 ) {
+      return FALSE;
+   }
+
+   dtmfServiceHello_t hello;
+   hello.u32Magic      = DTMF_SERVICE_MAGIC;
+   hello.u32Version    = DTMF_SERVICE_VERSION;
+   hello.u32SampleRate = su32SampleRate;
+   hello.u32Format     = (UINT32) sLaw;
+
+   if ( send( pStream->socket, (const char*) &hello, (int) sizeof( hello ), 0 ) != (int) sizeof( hello ) ) {
+      return FALSE;
+   }
+
+   u_long ulNonBlocking = 1;
+   if ( ioctlsocket( pStream->socket, FIONBIO, &ulNonBlocking ) != 0 ) {
+      return FALSE;
+   }
+
+   pStream->bOpen = true;
+
+   return TRUE;
+}
+
+
+/// Write a line to the results file
+///
+/// @param hFile   The results file
+/// @param pszLine The line (with its `\r\n`)
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+static BOOL dtmfLoadGenWriteLine( _In_ const HANDLE hFile, _In_z_ const char* pszLine ) {
+   DWORD dwLength  = (DWORD) strlen( pszLine );
+   DWORD dwWritten = 0;
+
+   BOOL br = WriteFile( hFile, pszLine, dwLength, &dwWritten, NULL );
+   if ( !br || dwWritten != dwLength ) {
+      RETURN_FATAL( IDS_DTMF_LOADGEN_FAILED_TO_WRITE_FILE, swsResultsFile );  // "Failed to write the load generator results file [%s].  Exiting."
+   }
+
+   return TRUE;
+}
+
+
+/// Write the results file and log the summary
+///
+/// @param pMerged    Scratch space for every latency
+/// @param clientPct  The load generator's CPU (as a percent of one core)
+/// @param servicePct The service's CPU (as a percent of one core) or `-1` if it's not known
+/// @param seconds    How long the streams sent audio (in seconds)
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+static BOOL dtmfLoadGenReport( _Out_ double* pMerged, _In_ const double clientPct, _In_ const double servicePct, _In_ const double seconds ) {
+   const char* pszTransport = sbShm ? "shm" : "socket";
+
+   char   sLine[ DTMF_LOADGEN_MAX_LINE ];
+   UINT64 u64Sent     = 0;
+   UINT64 u64Sends    = 0;
+   size_t stMerged    = 0;
+   size_t stEvents    = 0;
+   size_t stCorrect   = 0;
+   size_t stIncorrect = 0;
+   size_t stClosed    = 0;
+   double minMeanUs   = 0.0;
+   double maxMeanUs   = 0.0;
+   bool   bFirstMean  = true;
+
+   HANDLE hFile = CreateFileW( swsResultsFile, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+   if ( hFile == INVALID_HANDLE_VALUE ) {
+      RETURN_FATAL( IDS_DTMF_LOADGEN_FAILED_TO_OPEN_FILE, swsResultsFile );  // "Failed to open the load generator results file [%s].  Exiting."
+   }
+
+   BOOL br = dtmfLoadGenWriteLine( hFile,
+      "version,transport,law,flood,stream,sample_rate,samples_sent,sends,events,keys_correct,keys_incorrect,"
+      "latency_mean_us,latency_p50_us,latency_p99_us,latency_max_us,closed_early\r\n" );
+
+   for ( size_t i = 0 ; br && i < su32Streams ; i++ ) {
+      dtmfLoadGenStream_t* pStream = &spStreams[ i ];
+
+      /// - Summarize each stream (sorting its latencies in place) and add
+      ///   its latencies to the merged list
+      double sumUs = 0.0;
+      for ( size_t j = 0 ; j < pStream->stLatencies ; j++ ) {
+         sumUs += pStream->pLatencies[ j ];
+      }
+      const double meanUs = ( pStream->stLatencies > 0 ) ? sumUs / (double) pStream->stLatencies : 0.0;
+
+      CopyMemory( pMerged + stMerged, pStream->pLatencies, pStream->stLatencies * sizeof( double ) );
+      stMerged += pStream->stLatencies;
+
+      qsort( pStream->pLatencies, pStream->stLatencies, sizeof( double ), dtmfLoadGenCompareDouble );
+
+      if ( pStream->stLatencies > 0 ) {
+         if ( bFirstMean || meanUs < minMeanUs ) minMeanUs = meanUs;
+         if ( bFirstMean || meanUs > maxMeanUs ) maxMeanUs = meanUs;
+         bFirstMean = false;
+      }
+
+      u64Sent     += pStream->u64Sent;
+      u64Sends    += pStream->u64Sends;
+      stEvents    += pStream->stEvents;
+      stCorrect   += pStream->stCorrect;
+      stIncorrect += pStream->stIncorrect;
+      stClosed    += pStream->bOpen ? 0 : 1;
+
+      sprintf_s( sLine, sizeof( sLine ), "%s,%s,%ls,%d,%zu,%u,%llu,%llu,%zu,%zu,%zu,%.1f,%.1f,%.1f,%.1f,%d\r\n",
+         FULL_VERSION, pszTransport, g711LawName( sLaw ), sbFlood ? 1 : 0, i, su32SampleRate, pStream->u64Sent, pStream->u64Sends, pStream->stEvents, pStream->stCorrect, pStream->stIncorrect,
+         meanUs,
+         dtmfLoadGenPercentile( pStream->pLatencies, pStream->stLatencies, 0.50 ),
+         dtmfLoadGenPercentile( pStream->pLatencies, pStream->stLatencies, 0.99 ),
+         dtmfLoadGenPercentile( pStream->pLatencies, pStream->stLatencies, 1.00 ),
+         pStream->bOpen ? 0 : 1 );
+
+      br = dtmfLoadGenWriteLine( hFile, sLine );
+   }
+
+   CloseHandle( hFile );
+
+   if ( !br ) {
+      return FALSE;
+   }
+
+   /// - Summarize every stream together
+   qsort( pMerged, stMerged, sizeof( double ), dtmfLoadGenCompareDouble );
+
+   LOG_INFO_R( IDS_DTMF_LOADGEN_RESULT, (size_t) su32Streams, stEvents,
+      dtmfLoadGenPercentile( pMerged, stMerged, 0.50 ),
+      dtmfLoadGenPercentile( pMerged, stMerged, 0.99 ),
+      dtmfLoadGenPercentile( pMerged, stMerged, 0.999 ),
+      dtmfLoadGenPercentile( pMerged, stMerged, 1.00 ),
+      minMeanUs, maxMeanUs, stCorrect, stIncorrect, stClosed );  // "Load generator:  Streams: %zu   Events: %zu   Latency p50: %.0f us   p99: %.0f us   p99.9: %.0f us   max: %.0f us   Stream means: %.0f to %.0f us   Keys: %zu correct, %zu incorrect   Closed early: %zu"
+
+   if ( servicePct >= 0.0 ) {
+      LOG_INFO_R( IDS_DTMF_LOADGEN_CPU, clientPct, servicePct );  // "Load generator CPU:  Client: %.1f%%   Service: %.1f%%  (100%% is one core)"
+   } else {
+      LOG_INFO_R( IDS_DTMF_LOADGEN_CPU_CLIENT_ONLY, clientPct );  // "Load generator CPU:  Client: %.1f%%   Service: unknown  (100%% is one core)"
+   }
+
+   LOG_INFO_R( IDS_DTMF_LOADGEN_THROUGHPUT, (double) u64Sent / seconds / 1.0e6, sbShm ? L"shared memory" : L"socket", u64Sends, dtmfShmWakeups() );  // "Load generator throughput:  %.2f Msamples/s over the %s   Sends: %llu   Wakeups: %lld"
+
+   LOG_INFO_R( IDS_DTMF_LOADGEN_DONE, swsResultsFile );  // "Load generator finished.  Results written to [%s]"
+
+   return TRUE;
+}
+
+
+/// Close the streams and release everything.  This is safe to call at any
+/// point in #dtmfLoadGenRun.
+///
+/// @param pMerged The merged latencies (or `NULL`)
+static void dtmfLoadGenCleanup( _In_opt_ double* pMerged ) {
+   if ( spStreams != NULL ) {
+      for ( size_t i = 0 ; i < su32Streams ; i++ ) {
+         if ( spStreams[ i ].socket != INVALID_SOCKET ) {
+            closesocket( spStreams[ i ].socket );
+         }
+         if ( spStreams[ i ].iShmStream >= 0 ) {
+            dtmfShmCloseStream( spStreams[ i ].iShmStream );
+         }
+      }
+
+      if ( spStreams[ 0 ].pLatencies != NULL ) {
+         _free_dbg( spStreams[ 0 ].pLatencies, _CLIENT_BLOCK );  // Every stream's latencies are in one block
+      }
+
+      _free_dbg( spStreams, _CLIENT_BLOCK );
+      spStreams = NULL;
+   }
+
+   if ( pMerged != NULL ) {
+      _free_dbg( pMerged, _CLIENT_BLOCK );
+   }
+
+   if ( sbShm ) {
+      dtmfShmDetach();
+   }
+
+   WSACleanup();
+}
+
+
+/// Run the load generator against the service
+///
+/// This runs on the main thread instead of the window.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL dtmfLoadGenRun() {
+   _ASSERTE( sbEnabled );
+
+   /// #### Function
+
+   WSADATA wsaData;
+   if ( WSAStartup( MAKEWORD( 2, 2 ), &wsaData ) != 0 ) {
+      RETURN_FATAL( IDS_DTMF_SERVICE_FAILED_TO_START_WINSOCK );  // "Failed to start Winsock.  Exiting."
+   }
+
+   QueryPerformanceFrequency( &sFrequency );  // This never fails on Windows XP or later
+
+   LOG_INFO_R( IDS_DTMF_LOADGEN_ENABLED, (size_t) su32Streams, su32SampleRate, su32Seconds, sbShm ? swsShmName : swsSocket );  // "Running the load generator:  %zu streams at %u Hz for %u seconds to [%s]"
+
+   if ( sbShm && !dtmfShmAttach( swsShmName ) ) {
+      WSACleanup();
+      RETURN_FATAL( IDS_DTMF_LOADGEN_FAILED_TO_CONNECT, (size_t) 0, swsShmName, 0 );  // "Failed to connect stream %zu to the service at [%s].  Error: %d.  Exiting."
+   }
+
+   /// - Allocate the streams and room for the latencies.  A stream gets 2
+   ///   events per digit (plus some slack).
+   sstLatencyCapacity = (size_t) su32Seconds * 1000 / DTMF_LOADGEN_TONE_MS + 64;
+
+   spStreams = (dtmfLoadGenStream_t*) _malloc_dbg( su32Streams * sizeof( dtmfLoadGenStream_t ), _CLIENT_BLOCK, __FILE__, __LINE__ );
+   double* pLatencies = (double*) _malloc_dbg( su32Streams * sstLatencyCapacity * sizeof( double ), _CLIENT_BLOCK, __FILE__, __LINE__ );
+   double* pMerged    = (double*) _malloc_dbg( su32Streams * sstLatencyCapacity * sizeof( double ), _CLIENT_BLOCK, __FILE__, __LINE__ );
+   if ( spStreams == NULL || pLatencies == NULL || pMerged == NULL ) {
+      if ( pLatencies != NULL ) {
+         _free_dbg( pLatencies, _CLIENT_BLOCK );
+      }
+      if ( spStreams != NULL ) {
+         _free_dbg( spStreams, _CLIENT_BLOCK );
+         spStreams = NULL;
+      }
+      dtmfLoadGenCleanup( pMerged );
+      RETURN_FATAL( IDS_DTMF_LOADGEN_FAILED_TO_ALLOCATE );  // "Failed to allocate memory for the load generator.  Exiting."
+   }
+
+   ZeroMemory( spStreams, su32Streams * sizeof( dtmfLoadGenStream_t ) );
+   for ( size_t i = 0 ; i < su32Streams ; i++ ) {
+      spStreams[ i ].socket     = INVALID_SOCKET;
+      spStreams[ i ].iShmStream = -1;
+      spStreams[ i ].pLatencies = pLatencies + i * sstLatencyCapacity;
+   }
+
+   /// - Connect every stream
+   SOCKADDR_UN address;
+   if ( !dtmfServiceAddress( swsSocket, &address ) ) {
+      dtmfLoadGenCleanup( pMerged );
+      RETURN_FATAL( IDS_DTMF_LOADGEN_INVALID_OPTION );  // "A /loadgen option is not valid.  Exiting."
+   }
+
+   for ( size_t i = 0 ; i < su32Streams ; i++ ) {
+      if ( !dtmfLoadGenConnect( &spStreams[ i ], &address, i ) ) {
+         const int iError = WSAGetLastError();
+         dtmfLoadGenCleanup( pMerged );
+         RETURN_FATAL( IDS_DTMF_LOADGEN_FAILED_TO_CONNECT, i, swsSocket, iError );  // "Failed to connect stream %zu to the service at [%s].  Error: %d.  Exiting."
+      }
+   }
+
+   /// - Find the service's process (for its CPU time)
+   HANDLE hService     = NULL;
+   ULONG  ulServicePid = 0;
+   DWORD  dwBytes      = 0;
+
+   if ( sbShm ) {
+      ulServicePid = dtmfShmServicePid();
+   } else if ( WSAIoctl( spStreams[ 0 ].socket, SIO_AF_UNIX_GETPEERPID, NULL, 0, &ulServicePid, sizeof( ulServicePid ), &dwBytes, NULL, NULL ) != 0 ) {
+      ulServicePid = 0;
+   }
+
+   if ( ulServicePid != 0 ) {
+      hService = OpenProcess( PROCESS_QUERY_LIMITED_INFORMATION, FALSE, ulServicePid );
+   }
+
+   const UINT64 u64ClientCpuStart  = dtmfLoadGenCpuTicks( GetCurrentProcess() );
+   const UINT64 u64ServiceCpuStart = ( hService != NULL ) ? dtmfLoadGenCpuTicks( hService ) : 0;
+
+   /// - Split the streams over one thread per processor and run them
+   SYSTEM_INFO systemInfo;
+   GetSystemInfo( &systemInfo );
+
+   size_t stThreads = systemInfo.dwNumberOfProcessors;
+   stThreads = ( stThreads < DTMF_LOADGEN_MAX_THREADS ) ? stThreads : DTMF_LOADGEN_MAX_THREADS;
+   stThreads = ( stThreads < su32Streams ) ? stThreads : su32Streams;
+
+   HANDLE hThreads[ DTMF_LOADGEN_MAX_THREADS ] = { NULL };
+   BOOL   br = TRUE;
+
+   QueryPerformanceCounter( &sStart );
+
+   for ( size_t t = 0 ; t < stThreads ; t++ ) {
+      const size_t stFirst = su32Streams * t / stThreads;
+      const size_t stLast  = su32Streams * ( t + 1 ) / stThreads;
+
+      hThreads[ t ] = CreateThread( NULL, 0, dtmfLoadGenThread, (LPVOID) (UINT_PTR) ( (UINT64) ( stLast - stFirst ) << 32 | stFirst ), 0, NULL );
+      if ( hThreads[ t ] == NULL ) {
+         PROCESS_FATAL( IDS_DTMF_LOADGEN_FAILED_TO_START_THREADS );  // "Failed to start the load generator's threads.  Exiting."
+         br = FALSE;
+         break;
+      }
+   }
+
+   for ( size_t t = 0 ; t < stThreads ; t++ ) {
+      if ( hThreads[ t ] != NULL ) {
+         WaitForSingleObject( hThreads[ t ], INFINITE );
+         CloseHandle( hThreads[ t ] );
+      }
+   }
+
+   LARGE_INTEGER end;
+   QueryPerformanceCounter( &end );
+
+   /// - Report the CPU as a percent of one core over the whole run
+   const double wallTicks  = (double) ( end.QuadPart - sStart.QuadPart ) * 1.0e7 / (double) sFrequency.QuadPart;  // In 100ns ticks
+   const double clientPct  = (double) ( dtmfLoadGenCpuTicks( GetCurrentProcess() ) - u64ClientCpuStart ) * 100.0 / wallTicks;
+   double       servicePct = -1.0;
+
+   if ( hService != NULL ) {
+      servicePct = (double) ( dtmfLoadGenCpuTicks( hService ) - u64ServiceCpuStart ) * 100.0 / wallTicks;
+      CloseHandle( hService );
+   }
+
+   if ( br ) {
+      br = dtmfLoadGenReport( pMerged, clientPct, servicePct, (double) su32Seconds );
+   }
+
+   dtmfLoadGenCleanup( pMerged );
+
+   return br;
+}
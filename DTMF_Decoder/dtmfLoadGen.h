@@ -0,0 +1,20 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// A load generator for the decoding service in dtmfService.cpp
+///
+/// @file    dtmfLoadGen.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>  // For BOOL
+
+
+extern BOOL dtmfLoadGenParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine );
+extern bool dtmfLoadGenIsEnabled();
+extern BOOL dtmfLoadGenRun();
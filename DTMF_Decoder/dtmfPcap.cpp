@@ -0,0 +1,1592 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// An offline reader that decodes the DTMF in every RTP stream of a pcap file
+///
+/// The reader runs headless (no window and no audio device):
+///
+///     DTMF_Decoder.exe /pcap:"C:\calls.pcap" [/pcapresults:"C:\dtmf.csv"] [/pcapstreams:16384]
+///                      [/pcapeventpt:101] [/pcapl16pt:96] [/pcapl16rate:8000]
+///                      [/pcapmintone:40] [/pcapinterdigit:5000] [/pcapentry:30000]
+///
+/// #### Reading
+/// The capture is mapped into memory, so nothing is copied out of the file
+/// cache, and the reader prefetches #DTMF_PCAP_PREFETCH_BYTES ahead of itself.
+/// One thread walks the packets (Ethernet, VLAN, Linux cooked, raw IP and
+/// loopback captures over IPv4 or IPv6) and looks for RTP in UDP.  The
+/// streams are demultiplexed by their 5-tuple and SSRC in an
+/// open-addressing hash table that only the reading thread touches.
+///
+/// #### Decoding
+/// Every stream belongs to one of the decoder threads (one per remaining
+/// processor).  The reader hands each decoder a #dtmfPcapPacket_t (where the
+/// payload is in the file -- not the payload itself) over a
+/// single-producer, single-consumer ring.  The decoder:
+///
+///   - Puts the packets back in order by sequence number in a
+///     #DTMF_PCAP_JITTER packet window.  A packet that's still missing when
+///     the window fills is lost (and replaced with silence, so the timing
+///     holds).  A packet that arrives after its turn is late (and dropped).
+///   - Expands G.711 (payload types 0 and 8) and 16-bit linear PCM (payload
+///     type 11 or `/pcapl16pt`) into the stream's own #goertzelContext_t and
+///     analyzes it every 10ms, just like dtmfService.cpp.
+///   - Reports RFC 4733 telephone-events (`/pcapeventpt`) alongside the
+///     in-band keys.
+///   - Groups the keys into entries with 3 timers per stream:  An in-band
+///     key isn't reported until it has lasted `/pcapmintone` ms, an entry
+///     ends when no key comes for `/pcapinterdigit` ms after the last one
+///     and it ends anyway `/pcapentry` ms after its first key.  (`0` turns
+///     a timer off.)  The timers run on the decoder's #timerWheel_t in
+///     #DTMF_PCAP_TICK_US ticks of capture time, and the decoder advances
+///     the wheel before it plays each packet.  So an entry ends on time even
+///     when its stream has gone quiet, and no stream is ever polled.
+///
+/// Every key down, key up and entry end goes to a CSV file
+/// (#DTMF_PCAP_DEFAULT_FILE by default), sorted by stream and time.
+///
+/// ## Memory Mapped File API
+/// | API                     | Link                                                                                                  |
+/// |-------------------------| ------------------------------------------------------------------------------------------------------|
+/// | `CreateFileMappingW`    | https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-createfilemappingw         |
+/// | `MapViewOfFile`         | https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-mapviewoffile              |
+/// | `PrefetchVirtualMemory` | https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-prefetchvirtualmemory      |
+/// | `UnmapViewOfFile`       | https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-unmapviewoffile            |
+///
+/// @see https://wiki.wireshark.org/Development/LibpcapFileFormat
+/// @see https://www.rfc-editor.org/rfc/rfc3550 (RTP)
+/// @see https://www.rfc-editor.org/rfc/rfc4733 (telephone-events)
+///
+/// @file    dtmfPcap.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <malloc.h>       // For _malloc_dbg and _free_dbg
+#include <stdio.h>        // For sprintf_s()
+#include <stdlib.h>       // For qsort()
+
+#include "audio.h"        // For PCM_8_BIT_SILENCE
+#include "mvcModel.h"     // For dtmfTones_t
+#include "goertzel.h"     // For goertzelContext_t
+#include "timerWheel.h"   // For timerWheel_t
+#include "logTrace.h"     // For logTraceReleaseRing
+#include "logFlight.h"    // For logFlightReleaseRing
+#include "dtmfService.h"  // For dtmfServiceParsePath and the event types
+#include "dtmfPcap.h"     // For yo bad self
+
+
+/// The results file when `/pcapresults` doesn't name one
+#define DTMF_PCAP_DEFAULT_FILE       L"DTMF_Pcap.csv"
+
+/// The default number of streams `/pcapstreams` allows
+#define DTMF_PCAP_DEFAULT_STREAMS    (16384)
+
+/// The most streams `/pcapstreams` can ask for
+#define DTMF_PCAP_MAX_STREAMS        (262144)
+
+/// The packets a stream holds while it waits for a missing one.  Must be a
+/// power of 2 and no more than 32 (see #dtmfPcapStream_t.u32Present).
+#define DTMF_PCAP_JITTER             (16)
+
+/// The packets in each decoder's ring.  Must be a power of 2.
+#define DTMF_PCAP_RING_DEPTH         (16384)
+
+/// The reader publishes its progress to a decoder every this many packets
+#define DTMF_PCAP_PUBLISH_EVERY      (64)
+
+/// How far ahead of the reader to prefetch the file (in bytes)
+#define DTMF_PCAP_PREFETCH_BYTES     ( 64 * 1024 * 1024 )
+
+/// Polls of an empty ring before a decoder sleeps for a millisecond
+#define DTMF_PCAP_IDLE_SPINS         (64)
+
+/// The most decoder threads
+#define DTMF_PCAP_MAX_THREADS        (64)
+
+/// A payload type that's not used (the RTP payload types are 7 bits)
+#define DTMF_PCAP_NO_PAYLOAD_TYPE    (128)
+
+/// The size of a decoder's scratch buffer for converting 16-bit PCM (in
+/// samples)
+#define DTMF_PCAP_SCRATCH            (1024)
+
+/// The size of the results file's write buffer (in bytes)
+#define DTMF_PCAP_WRITE_BUFFER       ( 64 * 1024 )
+
+/// The maximum length of a line in the results file
+#define DTMF_PCAP_MAX_LINE           (256)
+
+/// A tick of the decoders' timer wheels (in microseconds of capture time).
+/// It's one hop of the analysis loop.
+#define DTMF_PCAP_TICK_US            (10000)
+
+/// The longest `/pcapmintone`, `/pcapinterdigit` or `/pcapentry` (in ms)
+#define DTMF_PCAP_MAX_TIMEOUT_MS     ( 60 * 60 * 1000 )
+
+
+/// The libpcap file header's magic numbers (as read on a little-endian
+/// machine)
+#define PCAP_MAGIC_US                (0xA1B2C3D4)  ///< Microsecond timestamps
+#define PCAP_MAGIC_NS                (0xA1B23C4D)  ///< Nanosecond timestamps
+#define PCAPNG_MAGIC                 (0x0A0D0D0A)  ///< A pcapng section header (not supported)
+
+/// The link types this reader understands
+#define PCAP_LINKTYPE_NULL           (0)    ///< BSD loopback
+#define PCAP_LINKTYPE_ETHERNET       (1)    ///< Ethernet
+#define PCAP_LINKTYPE_RAW            (101)  ///< Raw IPv4 or IPv6
+#define PCAP_LINKTYPE_LINUX_SLL      (113)  ///< Linux cooked capture
+#define PCAP_LINKTYPE_IPV4           (228)  ///< Raw IPv4
+#define PCAP_LINKTYPE_IPV6           (229)  ///< Raw IPv6
+#define PCAP_LINKTYPE_LINUX_SLL2     (276)  ///< Linux cooked capture v2
+
+
+/// What an RTP payload type carries
+enum dtmfPcapFormat_t {
+   DTMF_PCAP_FORMAT_NONE = 0,  ///< Not something this reader decodes
+   DTMF_PCAP_FORMAT_PCMU,      ///< G.711 mu-law at 8kHz (payload type 0)
+   DTMF_PCAP_FORMAT_PCMA,      ///< G.711 A-law at 8kHz (payload type 8)
+   DTMF_PCAP_FORMAT_L16,       ///< 16-bit, big-endian, mono linear PCM
+   DTMF_PCAP_FORMAT_EVENT      ///< RFC 4733 telephone-events
+};
+
+
+/// The events the reader adds to #dtmfServiceEventType_t
+enum dtmfPcapEventType_t {
+   DTMF_PCAP_EVENT_ENTRY_END = 16,  ///< An entry ended:  No key came for `/pcapinterdigit`
+   DTMF_PCAP_EVENT_ENTRY_TIMEOUT    ///< An entry ended:  It ran for `/pcapentry`
+};
+
+
+/// A stream's timers (#dtmfPcapStream_t.timers)
+enum dtmfPcapTimer_t {
+   DTMF_PCAP_TIMER_TONE = 0,    ///< The pending in-band key has lasted `/pcapmintone`
+   DTMF_PCAP_TIMER_INTERDIGIT,  ///< No key for `/pcapinterdigit` since the last one ended
+   DTMF_PCAP_TIMER_ENTRY,       ///< `/pcapentry` since the entry's first key
+   DTMF_PCAP_TIMER_COUNT        ///< The number of timers
+};
+
+
+/// Where an event came from
+enum dtmfPcapSource_t {
+   DTMF_PCAP_SOURCE_INBAND = 0,  ///< The Goertzel decoder heard it
+   DTMF_PCAP_SOURCE_RFC4733      ///< An RFC 4733 telephone-event packet
+};
+
+
+/// What identifies a stream.  The addresses are in network order (IPv4 is
+/// the first 4 bytes).
+typedef struct {
+   BYTE   src[ 16 ];   ///< The source address
+   BYTE   dst[ 16 ];   ///< The destination address
+   UINT32 u32Ssrc;     ///< The RTP synchronization source
+   UINT16 u16SrcPort;  ///< The UDP source port
+   UINT16 u16DstPort;  ///< The UDP destination port
+   UINT32 u32IpVersion;  ///< `4` or `6`
+} dtmfPcapKey_t;
+
+
+/// A packet handed from the reader to a decoder.  The payload stays in the
+/// mapped file.
+typedef struct {
+   UINT64 u64Offset;     ///< Where the RTP payload starts (in bytes from the start of the file)
+   UINT64 u64TimeUs;     ///< When it was captured (in microseconds since 1970)
+   UINT32 u32Stream;     ///< The stream
+   UINT32 u32RtpTime;    ///< The RTP timestamp
+   UINT16 u16Length;     ///< The length of the payload
+   UINT16 u16Sequence;   ///< The RTP sequence number
+   UINT32 u32PayloadType;  ///< The RTP payload type
+} dtmfPcapPacket_t;
+
+
+/// A key down or key up
+typedef struct {
+   UINT64 u64TimeUs;    ///< The capture time of the packet that found it
+   UINT64 u64Position;  ///< The samples (or RTP clock ticks) since the stream started
+   UINT32 u32Stream;    ///< The stream
+   UINT16 u16Source;    ///< A #dtmfPcapSource_t
+   UINT16 u16Type;      ///< #DTMF_SERVICE_EVENT_KEY_DOWN, #DTMF_SERVICE_EVENT_KEY_UP or a #dtmfPcapEventType_t
+   WCHAR  key;          ///< The key (for an entry's end, its last key)
+} dtmfPcapEvent_t;
+
+
+/// One RTP stream.  The reader sets #key before it queues the stream's first
+/// packet.  After that, only the stream's decoder touches it.
+typedef struct {
+   dtmfPcapKey_t     key;                          ///< What identifies the stream
+   bool              bStarted;                     ///< `true` after the first packet
+   bool              bAudio;                       ///< `true` after the first audio packet (and #decoder is ready)
+   bool              bEventDown;                   ///< `true` if a telephone-event hasn't ended
+   bool              bKeyDown;                     ///< `true` if #currentKey has lasted `/pcapmintone` and was reported
+   bool              bEntryIdle;                   ///< `true` if the entry's last key has ended (and #DTMF_PCAP_TIMER_INTERDIGIT is running)
+   UINT16            u16NextSequence;              ///< The next packet to play
+   UINT32            u32Present;                   ///< Bit `n` is set if #jitter[ n ] holds a packet
+   UINT32            u32FirstRtpTime;              ///< The RTP timestamp of the first packet
+   UINT32            u32EventRtpTime;              ///< The RTP timestamp of the latest telephone-event
+   UINT32            u32SampleRate;                ///< The sample rate #decoder was set up for
+   size_t            stLastSamples;                ///< The samples in the last audio packet (for replacing a lost one)
+   size_t            stHop;                        ///< Samples between analyses (10ms)
+   size_t            stSinceAnalysis;              ///< Samples since the last analysis
+   UINT64            u64Position;                  ///< Samples decoded
+   UINT64            u64TimeUs;                    ///< The capture time of the packet being played
+   UINT64            u64KeyPosition;               ///< Where #currentKey started
+   UINT64            u64KeyTimeUs;                 ///< When #currentKey started
+   UINT64            u64EntryPosition;             ///< Where the entry's last key started or ended
+   WCHAR             currentKey;                   ///< The in-band key the decoder hears (or `L'\0'`)
+   WCHAR             eventKey;                     ///< The telephone-event key that's down
+   WCHAR             entryKey;                     ///< The entry's last key (or `L'\0'` if there's no entry)
+   dtmfPcapSource_t  entrySource;                  ///< Where #entryKey came from
+   timerWheelEntry_t timers[ DTMF_PCAP_TIMER_COUNT ];  ///< The stream's timers (on its decoder's #dtmfPcapWorker_t.wheel)
+   dtmfPcapPacket_t  jitter[ DTMF_PCAP_JITTER ];   ///< Packets waiting for an earlier one
+   goertzelContext_t decoder;                      ///< The stream's decoder
+   BYTE              window[ GOERTZEL_CONTEXT_WINDOW( GOERTZEL_CONTEXT_MAX_RATE ) ];  ///< #decoder's window (the sample rate can change mid-stream)
+} dtmfPcapStream_t;
+
+
+/// A decoder thread and its ring.  The reader's and the decoder's indexes
+/// are on separate cache lines.
+typedef struct {
+   DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) volatile LONG64 l64Head;  ///< Packets the reader has published
+   UINT64            u64ReaderHead;                ///< Packets the reader has written (the reader's copy)
+   UINT64            u64ReaderTail;                ///< The latest #l64Tail the reader has seen
+   DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) volatile LONG64 l64Tail;  ///< Packets the decoder has taken
+   HANDLE            hThread;                      ///< The decoder thread
+   dtmfPcapPacket_t* pRing;                        ///< #DTMF_PCAP_RING_DEPTH packets
+   dtmfPcapEvent_t*  pEvents;                      ///< The events this decoder found
+   size_t            stEvents;                     ///< The events in #pEvents
+   size_t            stEventCapacity;              ///< The events #pEvents can hold
+   UINT64            u64Played;                    ///< Packets played
+   UINT64            u64Lost;                      ///< Packets that never came
+   UINT64            u64Late;                      ///< Packets that came after their turn (or twice)
+   UINT64            u64Reordered;                 ///< Packets that filled a gap
+   UINT64            u64InbandKeys;                ///< In-band keys found
+   UINT64            u64EventKeys;                 ///< Telephone-event keys found
+   UINT64            u64EventsDropped;             ///< Events that didn't fit in memory
+   UINT64            u64ShortTones;                ///< In-band keys that ended before `/pcapmintone`
+   UINT64            u64Entries;                   ///< Entries that ended
+   timerWheel_t      wheel;                        ///< The timers of this decoder's streams
+   BYTE              scratch[ DTMF_PCAP_SCRATCH ]; ///< 16-bit PCM converted to 8-bit
+} dtmfPcapWorker_t;
+
+
+static bool   sbEnabled = false;                           ///< `true` if `/pcap` is on the command line
+static WCHAR  swsCaptureFile[ MAX_PATH ] = L"";            ///< The capture
+static WCHAR  swsResultsFile[ MAX_PATH ] = DTMF_PCAP_DEFAULT_FILE;  ///< Where to write the events
+static UINT32 su32MaxStreams = DTMF_PCAP_DEFAULT_STREAMS;  ///< The most streams
+static UINT32 su32EventPt    = 101;                        ///< The telephone-event payload type
+static UINT32 su32L16Pt      = DTMF_PCAP_NO_PAYLOAD_TYPE;  ///< A dynamic payload type that carries 16-bit PCM
+static UINT32 su32L16Rate    = 8000;                       ///< #su32L16Pt's sample rate
+static UINT32 su32MinToneMs  = 40;                         ///< How long an in-band key must last (in ms).  `0` reports every key.
+static UINT32 su32InterDigitMs = 5000;                     ///< How long after a key ends its entry ends (in ms).  `0` to never end it this way.
+static UINT32 su32EntryMs    = 30000;                      ///< How long after its first key an entry ends (in ms).  `0` to never end it this way.
+
+static BYTE   sFormats[ DTMF_PCAP_NO_PAYLOAD_TYPE ];       ///< A #dtmfPcapFormat_t for each payload type
+static UINT32 sRates[ DTMF_PCAP_NO_PAYLOAD_TYPE ];         ///< The sample rate of each audio payload type
+
+static HANDLE      shFile    = INVALID_HANDLE_VALUE;       ///< The capture
+static HANDLE      shMapping = NULL;                       ///< The capture's file mapping
+static const BYTE* spBase    = NULL;                       ///< The mapped capture
+static UINT64      su64Size  = 0;                          ///< The size of the capture (in bytes)
+static bool        sbSwapped = false;                      ///< `true` if the capture was written on a big-endian machine
+static bool        sbNanoseconds = false;                  ///< `true` if the timestamps are in nanoseconds
+static UINT32      su32LinkType  = 0;                      ///< The capture's link type
+
+static dtmfPcapStream_t* spStreams = NULL;                 ///< The streams (allocated with `VirtualAlloc`)
+static UINT32      su32Streams   = 0;                      ///< The streams found so far
+static UINT32*     spTable       = NULL;                   ///< The hash table:  A stream's index + 1 or `0` if the slot is empty
+static size_t      sstTableMask  = 0;                      ///< The size of #spTable - 1
+
+static dtmfPcapWorker_t* spWorkers = NULL;                 ///< The decoders (allocated with `VirtualAlloc`)
+static size_t      sstWorkers    = 0;                      ///< The number of decoders
+static volatile bool sbReaderDone = false;                 ///< `true` when the reader has published every packet
+
+static BYTE        sSilence[ DTMF_PCAP_SCRATCH ];          ///< Silence for replacing lost packets
+
+static UINT64      su64Frames     = 0;                     ///< Packets in the capture
+static UINT64      su64Rtp        = 0;                     ///< RTP packets queued for a decoder
+static UINT64      su64NotRtp     = 0;                     ///< Packets that aren't RTP this reader decodes
+static UINT64      su64Fragments  = 0;                     ///< IPv4 fragments (skipped)
+static UINT64      su64Overflow   = 0;                     ///< RTP packets skipped because there were too many streams
+
+
+/// Look for `/pcap:path`, `/pcapresults:path`, `/pcapstreams:N`,
+/// `/pcapeventpt:N`, `/pcapl16pt:N`, `/pcapl16rate:N`, `/pcapmintone:N`,
+/// `/pcapinterdigit:N` and `/pcapentry:N` on the command line
+///
+/// @param pwszCmdLine The command line passed to #wWinMain
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL dtmfPcapParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine ) {
+   /// #### Function
+
+   sbEnabled = false;
+
+   if ( pwszCmdLine == NULL ) {
+      return TRUE;
+   }
+
+   bool bFound   = false;
+   bool bResults = false;
+
+   if ( !dtmfServiceParsePath( pwszCmdLine, L"/pcap", swsCaptureFile, _countof( swsCaptureFile ), &bFound ) ) {
+      RETURN_FATAL( IDS_DTMF_PCAP_INVALID_OPTION );  // "A /pcap option is not valid.  Exiting."
+   }
+
+   if ( !bFound ) {
+      return TRUE;
+   }
+
+   if ( swsCaptureFile[ 0 ] == L'\0'
+     || !dtmfServiceParsePath( pwszCmdLine, L"/pcapresults", swsResultsFile, _countof( swsResultsFile ), &bResults )
+     || !dtmfServiceParseNumber( pwszCmdLine, L"/pcapstreams:", &su32MaxStreams )
+     || !dtmfServiceParseNumber( pwszCmdLine, L"/pcapeventpt:", &su32EventPt )
+     || !dtmfServiceParseNumber( pwszCmdLine, L"/pcapl16pt:", &su32L16Pt )
+     || !dtmfServiceParseNumber( pwszCmdLine, L"/pcapl16rate:", &su32L16Rate )
+     || !dtmfServiceParseNumber( pwszCmdLine, L"/pcapmintone:", &su32MinToneMs )
+     || !dtmfServiceParseNumber( pwszCmdLine, L"/pcapinterdigit:", &su32InterDigitMs )
+     || !dtmfServiceParseNumber( pwszCmdLine, L"/pcapentry:", &su32EntryMs )
+     || su32MaxStreams == 0
+     || su32MaxStreams > DTMF_PCAP_MAX_STREAMS
+     || su32EventPt >= DTMF_PCAP_NO_PAYLOAD_TYPE
+     || su32L16Pt > DTMF_PCAP_NO_PAYLOAD_TYPE
+     || su32L16Pt == su32EventPt
+     || su32L16Rate < 1000
+     || su32L16Rate > GOERTZEL_CONTEXT_MAX_RATE
+     || su32MinToneMs > DTMF_PCAP_MAX_TIMEOUT_MS
+     || su32InterDigitMs > DTMF_PCAP_MAX_TIMEOUT_MS
+     || su32EntryMs > DTMF_PCAP_MAX_TIMEOUT_MS ) {
+      RETURN_FATAL( IDS_DTMF_PCAP_INVALID_OPTION );  // "A /pcap option is not valid.  Exiting."
+   }
+
+   sbEnabled = true;
+
+   return TRUE;
+}
+
+
+/// @return `true` if the command line asked for the pcap reader
+bool dtmfPcapIsEnabled() {
+   return sbEnabled;
+}
+
+
+/// Read a 16-bit number in network order
+///
+/// @param p Where it is
+/// @return The number
+__forceinline static UINT16 dtmfPcapBe16( _In_reads_( 2 ) const BYTE* p ) {
+   return (UINT16) ( ( p[ 0 ] << 8 ) | p[ 1 ] );
+}
+
+
+/// Read a 32-bit number in network order
+///
+/// @param p Where it is
+/// @return The number
+__forceinline static UINT32 dtmfPcapBe32( _In_reads_( 4 ) const BYTE* p ) {
+   return _byteswap_ulong( *(const UNALIGNED UINT32*) p );
+}
+
+
+/// Read a 32-bit number from a pcap header (in the capture's byte order)
+///
+/// @param p Where it is
+/// @return The number
+__forceinline static UINT32 dtmfPcapU32( _In_reads_( 4 ) const BYTE* p ) {
+   const UINT32 u32 = *(const UNALIGNED UINT32*) p;
+
+   return sbSwapped ? _byteswap_ulong( u32 ) : u32;
+}
+
+
+/// Find a stream in #spTable (or add it)
+///
+/// Only the reader calls this.
+///
+/// @param pKey What identifies the stream (its padding must be zeroed)
+/// @return The stream's index or #su32MaxStreams if there's no room for it
+static UINT32 dtmfPcapFindStream( _In_ const dtmfPcapKey_t* pKey ) {
+   /// - Hash the key (FNV-1a)
+   UINT64 u64Hash = 0xCBF29CE484222325;
+   const BYTE* pBytes = (const BYTE*) pKey;
+   for ( size_t i = 0 ; i < sizeof( dtmfPcapKey_t ) ; i++ ) {
+      u64Hash = ( u64Hash ^ pBytes[ i ] ) * 0x100000001B3;
+   }
+
+   /// - Probe until we find it or an empty slot
+   size_t stSlot = (size_t) u64Hash & sstTableMask;
+   while ( spTable[ stSlot ] != 0 ) {
+      const UINT32 u32Stream = spTable[ stSlot ] - 1;
+      if ( memcmp( &spStreams[ u32Stream ].key, pKey, sizeof( dtmfPcapKey_t ) ) == 0 ) {
+         return u32Stream;
+      }
+      stSlot = ( stSlot + 1 ) & sstTableMask;
+   }
+
+   if ( su32Streams >= su32MaxStreams ) {
+      if ( su64Overflow == 0 ) {
+         LOG_WARN_R( IDS_DTMF_PCAP_TOO_MANY_STREAMS, su32MaxStreams );  // "The capture has more than %u RTP streams.  The rest are skipped (see /pcapstreams)."
+      }
+      return su32MaxStreams;
+   }
+
+   /// - A new stream.  Its key is in place before its first packet is
+   ///   published.
+   CopyMemory( &spStreams[ su32Streams ].key, pKey, sizeof( dtmfPcapKey_t ) );
+   spTable[ stSlot ] = su32Streams + 1;
+
+   return su32Streams++;
+}
+
+
+/// Hand a packet to its stream's decoder.  If the decoder's ring is full,
+/// wait for it.
+///
+/// @param pPacket The packet
+static void dtmfPcapQueue( _In_ const dtmfPcapPacket_t* pPacket ) {
+   dtmfPcapWorker_t* pWorker = &spWorkers[ pPacket->u32Stream % sstWorkers ];
+
+   while ( pWorker->u64ReaderHead - pWorker->u64ReaderTail >= DTMF_PCAP_RING_DEPTH ) {
+      pWorker->l64Head       = (LONG64) pWorker->u64ReaderHead;  // A volatile write has release semantics in MSVC
+      pWorker->u64ReaderTail = (UINT64) pWorker->l64Tail;        // A volatile read has acquire semantics in MSVC
+
+      if ( pWorker->u64ReaderHead - pWorker->u64ReaderTail >= DTMF_PCAP_RING_DEPTH ) {
+         SwitchToThread();
+      }
+   }
+
+   pWorker->pRing[ pWorker->u64ReaderHead & ( DTMF_PCAP_RING_DEPTH - 1 ) ] = *pPacket;
+   pWorker->u64ReaderHead++;
+
+   if ( ( pWorker->u64ReaderHead & ( DTMF_PCAP_PUBLISH_EVERY - 1 ) ) == 0 ) {
+      pWorker->l64Head = (LONG64) pWorker->u64ReaderHead;  // A volatile write has release semantics in MSVC
+   }
+}
+
+
+/// Find the RTP in a captured packet and queue it
+///
+/// @param pFrame    The captured bytes
+/// @param stFrame   The number of captured bytes
+/// @param u64TimeUs When it was captured (in microseconds since 1970)
+static void dtmfPcapReadFrame( _In_reads_( stFrame ) const BYTE* pFrame, _In_ size_t stFrame, _In_ const UINT64 u64TimeUs ) {
+   /// - Skip the link layer header
+   const BYTE* p       = pFrame;
+   UINT32 u32EtherType = 0;  // `0` if the IP version is in the first nibble
+
+   switch ( su32LinkType ) {
+      case PCAP_LINKTYPE_NULL:
+         if ( stFrame < 4 ) { su64NotRtp++; return; }
+         p += 4; stFrame -= 4;
+         break;
+      case PCAP_LINKTYPE_ETHERNET:
+         if ( stFrame < 14 ) { su64NotRtp++; return; }
+         u32EtherType = dtmfPcapBe16( p + 12 );
+         p += 14; stFrame -= 14;
+         while ( ( u32EtherType == 0x8100 || u32EtherType == 0x88A8 ) && stFrame >= 4 ) {  // VLAN tags
+            u32EtherType = dtmfPcapBe16( p + 2 );
+            p += 4; stFrame -= 4;
+         }
+         break;
+      case PCAP_LINKTYPE_LINUX_SLL:
+         if ( stFrame < 16 ) { su64NotRtp++; return; }
+         u32EtherType = dtmfPcapBe16( p + 14 );
+         p += 16; stFrame -= 16;
+         break;
+      case PCAP_LINKTYPE_LINUX_SLL2:
+         if ( stFrame < 20 ) { su64NotRtp++; return; }
+         u32EtherType = dtmfPcapBe16( p );
+         p += 20; stFrame -= 20;
+         break;
+      default:  // Raw IP
+         break;
+   }
+
+   if ( u32EtherType != 0 && u32EtherType != 0x0800 && u32EtherType != 0x86DD ) {
+      su64NotRtp++;
+      return;
+   }
+
+   /// - Find the UDP payload in the IPv4 or IPv6 packet
+   dtmfPcapKey_t key;
+   ZeroMemory( &key, sizeof( key ) );
+
+   if ( stFrame < 1 ) {
+      su64NotRtp++;
+      return;
+   }
+
+   const UINT32 u32Version = p[ 0 ] >> 4;
+   if ( u32Version == 4 ) {
+      const size_t stHeader = (size_t) ( p[ 0 ] & 0x0F ) * 4;
+      if ( stFrame < 20 || stHeader < 20 || stFrame < stHeader || p[ 9 ] != 17 ) {
+         su64NotRtp++;
+         return;
+      }
+      if ( ( dtmfPcapBe16( p + 6 ) & 0x3FFF ) != 0 ) {  // More fragments or a fragment offset
+         su64Fragments++;
+         return;
+      }
+
+      const size_t stTotal = dtmfPcapBe16( p + 2 );
+      stFrame = ( stTotal >= stHeader && stTotal < stFrame ) ? stTotal : stFrame;  // Drop the Ethernet padding
+
+      CopyMemory( key.src, p + 12, 4 );
+      CopyMemory( key.dst, p + 16, 4 );
+      p += stHeader; stFrame -= stHeader;
+   } else if ( u32Version == 6 ) {
+      if ( stFrame < 40 || p[ 6 ] != 17 ) {  // Extension headers aren't followed
+         su64NotRtp++;
+         return;
+      }
+
+      const size_t stTotal = (size_t) dtmfPcapBe16( p + 4 ) + 40;
+      stFrame = ( stTotal < stFrame ) ? stTotal : stFrame;
+
+      CopyMemory( key.src, p + 8, 16 );
+      CopyMemory( key.dst, p + 24, 16 );
+      p += 40; stFrame -= 40;
+   } else {
+      su64NotRtp++;
+      return;
+   }
+
+   key.u32IpVersion = u32Version;
+
+   if ( stFrame < 8 ) {
+      su64NotRtp++;
+      return;
+   }
+
+   key.u16SrcPort = dtmfPcapBe16( p );
+   key.u16DstPort = dtmfPcapBe16( p + 2 );
+   p += 8; stFrame -= 8;
+
+   /// - Check that it's RTP (version 2) with a payload type we decode.
+   ///   That filters out SIP (its first byte is a letter, so its "version"
+   ///   is 1), RTCP (its "payload types" are 72 - 76) and most other UDP.
+   if ( stFrame < 12 || ( p[ 0 ] >> 6 ) != 2 || sFormats[ p[ 1 ] & 0x7F ] == DTMF_PCAP_FORMAT_NONE ) {
+      su64NotRtp++;
+      return;
+   }
+
+   size_t stHeader = 12 + (size_t) ( p[ 0 ] & 0x0F ) * 4;  // The CSRCs
+   if ( p[ 0 ] & 0x10 ) {                                    // The header extension
+      if ( stFrame < stHeader + 4 ) {
+         su64NotRtp++;
+         return;
+      }
+      stHeader += 4 + (size_t) dtmfPcapBe16( p + stHeader + 2 ) * 4;
+   }
+   size_t stPadding = ( p[ 0 ] & 0x20 ) ? p[ stFrame - 1 ] : 0;
+
+   if ( stFrame < stHeader + stPadding ) {
+      su64NotRtp++;
+      return;
+   }
+
+   key.u32Ssrc = dtmfPcapBe32( p + 8 );
+
+   dtmfPcapPacket_t packet;
+   packet.u32Stream = dtmfPcapFindStream( &key );
+   if ( packet.u32Stream >= su32MaxStreams ) {
+      su64Overflow++;
+      return;
+   }
+
+   packet.u64Offset      = (UINT64) ( p + stHeader - spBase );
+   packet.u64TimeUs      = u64TimeUs;
+   packet.u32RtpTime     = dtmfPcapBe32( p + 4 );
+   packet.u16Length      = (UINT16) ( stFrame - stHeader - stPadding );
+   packet.u16Sequence    = dtmfPcapBe16( p + 2 );
+   packet.u32PayloadType = p[ 1 ] & 0x7F;
+
+   dtmfPcapQueue( &packet );
+   su64Rtp++;
+}
+
+
+/// Walk every packet in the capture.  This runs on the main thread while the
+/// decoders run.
+static void dtmfPcapRead() {
+   const BYTE* p    = spBase + 24;  // The file header
+   const BYTE* pEnd = spBase + su64Size;
+   UINT64 u64Prefetched = 0;
+
+   while ( pEnd - p >= 16 ) {
+      /// - Keep #DTMF_PCAP_PREFETCH_BYTES of the file ahead of us in memory
+      const UINT64 u64Offset = (UINT64) ( p - spBase );
+      if ( u64Offset + DTMF_PCAP_PREFETCH_BYTES / 2 >= u64Prefetched && u64Prefetched < su64Size ) {
+         WIN32_MEMORY_RANGE_ENTRY range;
+         const UINT64 u64Bytes = ( su64Size - u64Prefetched < DTMF_PCAP_PREFETCH_BYTES ) ? su64Size - u64Prefetched : DTMF_PCAP_PREFETCH_BYTES;
+
+         range.VirtualAddress = (PVOID) ( spBase + u64Prefetched );
+         range.NumberOfBytes  = (SIZE_T) u64Bytes;
+         PrefetchVirtualMemory( GetCurrentProcess(), 1, &range, 0 );  // Just a hint.  If it fails, the pages fault in.
+
+         u64Prefetched += u64Bytes;
+      }
+
+      /// - Read the packet's header and hand the packet to #dtmfPcapReadFrame
+      const UINT32 u32Seconds  = dtmfPcapU32( p );
+      const UINT32 u32Fraction = dtmfPcapU32( p + 4 );
+      const UINT32 u32Captured = dtmfPcapU32( p + 8 );
+
+      if ( (UINT64) ( pEnd - p - 16 ) < u32Captured ) {
+         LOG_WARN_R( IDS_DTMF_PCAP_TRUNCATED, su64Frames );  // "The capture file ends in the middle of a packet after %llu packets"
+         break;
+      }
+
+      const UINT64 u64TimeUs = (UINT64) u32Seconds * 1000000 + ( sbNanoseconds ? u32Fraction / 1000 : u32Fraction );
+
+      dtmfPcapReadFrame( p + 16, u32Captured, u64TimeUs );
+
+      su64Frames++;
+      p += 16 + (size_t) u32Captured;
+   }
+
+   /// - Publish what's left and tell the decoders there's no more
+   for ( size_t i = 0 ; i < sstWorkers ; i++ ) {
+      spWorkers[ i ].l64Head = (LONG64) spWorkers[ i ].u64ReaderHead;
+   }
+
+   MemoryBarrier();
+   sbReaderDone = true;
+}
+
+
+/// Remember an event.  It has the capture time of the stream's packet.
+///
+/// @param pWorker     The decoder that found it
+/// @param pStream     The stream
+/// @param u32Stream   The stream's index
+/// @param source      Where it came from
+/// @param u32Type     #DTMF_SERVICE_EVENT_KEY_DOWN, #DTMF_SERVICE_EVENT_KEY_UP or
+///                    a #dtmfPcapEventType_t
+/// @param key         The key
+/// @param u64Position When it happened (in samples since the stream started)
+/// @return The event (so the caller can change its time) or `NULL` if it
+///         was dropped
+static dtmfPcapEvent_t* dtmfPcapAddEvent(
+   _Inout_ dtmfPcapWorker_t*      pWorker,
+   _In_    const dtmfPcapStream_t* pStream,
+   _In_    const UINT32           u32Stream,
+   _In_    const dtmfPcapSource_t source,
+   _In_    const UINT32           u32Type,
+   _In_    const WCHAR            key,
+   _In_    const UINT64           u64Position ) {
+
+   if ( pWorker->stEvents == pWorker->stEventCapacity ) {
+      const size_t stCapacity = ( pWorker->stEventCapacity == 0 ) ? 1024 : pWorker->stEventCapacity * 2;
+
+      dtmfPcapEvent_t* pEvents = (dtmfPcapEvent_t*) _realloc_dbg( pWorker->pEvents, stCapacity * sizeof( dtmfPcapEvent_t ), _CLIENT_BLOCK, __FILE__, __LINE__ );
+      if ( pEvents == NULL ) {
+         pWorker->u64EventsDropped++;
+         return NULL;
+      }
+
+      pWorker->pEvents         = pEvents;
+      pWorker->stEventCapacity = stCapacity;
+   }
+
+   dtmfPcapEvent_t* pEvent = &pWorker->pEvents[ pWorker->stEvents++ ];
+   pEvent->u64TimeUs   = pStream->u64TimeUs;
+   pEvent->u64Position = u64Position;
+   pEvent->u32Stream   = u32Stream;
+   pEvent->u16Source   = (UINT16) source;
+   pEvent->u16Type     = (UINT16) u32Type;
+   pEvent->key         = key;
+
+   if ( u32Type == DTMF_SERVICE_EVENT_KEY_DOWN ) {
+      if ( source == DTMF_PCAP_SOURCE_INBAND ) {
+         pWorker->u64InbandKeys++;
+      } else {
+         pWorker->u64EventKeys++;
+      }
+   }
+
+   return pEvent;
+}
+
+
+/// Convert a capture time to a tick of the decoders' timer wheels
+///
+/// @param u64TimeUs A capture time (in microseconds since 1970)
+/// @return The tick
+__forceinline static UINT64 dtmfPcapTick( _In_ const UINT64 u64TimeUs ) {
+   return u64TimeUs / DTMF_PCAP_TICK_US;
+}
+
+
+/// @param u32Ms A timeout (in milliseconds)
+/// @return The timeout in ticks (rounded up)
+__forceinline static UINT64 dtmfPcapTicks( _In_ const UINT32 u32Ms ) {
+   return ( (UINT64) u32Ms * 1000 + DTMF_PCAP_TICK_US - 1 ) / DTMF_PCAP_TICK_US;
+}
+
+
+/// Report a key down.  It starts an entry (and its `/pcapentry` timer) or
+/// adds to the one that's open.
+///
+/// @param pWorker     The stream's decoder thread
+/// @param pStream     The stream
+/// @param u32Stream   The stream's index
+/// @param source      Where it came from
+/// @param key         The key
+/// @param u64Position Where it started (in samples since the stream started)
+/// @param u64TimeUs   When it started (the capture time)
+static void dtmfPcapKeyDown(
+   _Inout_ dtmfPcapWorker_t*      pWorker,
+   _Inout_ dtmfPcapStream_t*      pStream,
+   _In_    const UINT32           u32Stream,
+   _In_    const dtmfPcapSource_t source,
+   _In_    const WCHAR            key,
+   _In_    const UINT64           u64Position,
+   _In_    const UINT64           u64TimeUs ) {
+
+   dtmfPcapEvent_t* pEvent = dtmfPcapAddEvent( pWorker, pStream, u32Stream, source, DTMF_SERVICE_EVENT_KEY_DOWN, key, u64Position );
+   if ( pEvent != NULL ) {
+      pEvent->u64TimeUs = u64TimeUs;
+   }
+
+   timerWheelCancel( &pWorker->wheel, &pStream->timers[ DTMF_PCAP_TIMER_INTERDIGIT ] );
+
+   if ( pStream->entryKey == L'\0' && su32EntryMs > 0 ) {
+      timerWheelArm( &pWorker->wheel, &pStream->timers[ DTMF_PCAP_TIMER_ENTRY ], dtmfPcapTick( u64TimeUs ) + dtmfPcapTicks( su32EntryMs ) );
+   }
+
+   pStream->entryKey         = key;
+   pStream->entrySource      = source;
+   pStream->u64EntryPosition = u64Position;
+   pStream->bEntryIdle       = false;
+}
+
+
+/// Report a key up and start the entry's `/pcapinterdigit` timer
+///
+/// @param pWorker     The stream's decoder thread
+/// @param pStream     The stream
+/// @param u32Stream   The stream's index
+/// @param source      Where it came from
+/// @param key         The key
+/// @param u64Position Where it ended (in samples since the stream started)
+static void dtmfPcapKeyUp(
+   _Inout_ dtmfPcapWorker_t*      pWorker,
+   _Inout_ dtmfPcapStream_t*      pStream,
+   _In_    const UINT32           u32Stream,
+   _In_    const dtmfPcapSource_t source,
+   _In_    const WCHAR            key,
+   _In_    const UINT64           u64Position ) {
+
+   dtmfPcapAddEvent( pWorker, pStream, u32Stream, source, DTMF_SERVICE_EVENT_KEY_UP, key, u64Position );
+
+   if ( pStream->entryKey == L'\0' ) {
+      return;  // The entry already ended (at /pcapentry)
+   }
+
+   pStream->u64EntryPosition = u64Position;
+   pStream->bEntryIdle       = true;
+
+   if ( su32InterDigitMs > 0 ) {
+      timerWheelArm( &pWorker->wheel, &pStream->timers[ DTMF_PCAP_TIMER_INTERDIGIT ], dtmfPcapTick( pStream->u64TimeUs ) + dtmfPcapTicks( su32InterDigitMs ) );
+   }
+}
+
+
+/// End a stream's entry
+///
+/// @param pWorker   The stream's decoder thread
+/// @param pStream   The stream
+/// @param u32Stream The stream's index
+/// @param u32Type   A #dtmfPcapEventType_t (why it ended)
+/// @param u64Tick   The tick it ended on
+static void dtmfPcapEndEntry(
+   _Inout_ dtmfPcapWorker_t* pWorker,
+   _Inout_ dtmfPcapStream_t* pStream,
+   _In_    const UINT32      u32Stream,
+   _In_    const UINT32      u32Type,
+   _In_    const UINT64      u64Tick ) {
+
+   timerWheelCancel( &pWorker->wheel, &pStream->timers[ DTMF_PCAP_TIMER_INTERDIGIT ] );
+   timerWheelCancel( &pWorker->wheel, &pStream->timers[ DTMF_PCAP_TIMER_ENTRY ] );
+
+   dtmfPcapEvent_t* pEvent = dtmfPcapAddEvent( pWorker, pStream, u32Stream, pStream->entrySource, u32Type, pStream->entryKey, pStream->u64EntryPosition );
+   if ( pEvent != NULL ) {
+      pEvent->u64TimeUs = u64Tick * DTMF_PCAP_TICK_US;
+   }
+
+   pStream->entryKey   = L'\0';
+   pStream->bEntryIdle = false;
+   pWorker->u64Entries++;
+}
+
+
+/// Handle a tick's expired timers (see #timerWheelExpired_t)
+///
+/// Two of a stream's timers can expire on the same tick, and the first one
+/// can make the second one moot, so each one checks that it still applies.
+///
+/// @param pContext The decoder thread (a #dtmfPcapWorker_t)
+/// @param pExpired The timers that expired
+/// @param u64Tick  The tick they expired on
+static void dtmfPcapTimerExpired( _Inout_opt_ void* pContext, _In_ timerWheelEntry_t* pExpired, _In_ const UINT64 u64Tick ) {
+   dtmfPcapWorker_t* pWorker = (dtmfPcapWorker_t*) pContext;
+
+   while ( pExpired != NULL ) {
+      timerWheelEntry_t* pNext   = pExpired->pNext;
+      dtmfPcapStream_t*  pStream = &spStreams[ pExpired->u32Id ];
+
+      switch ( pExpired->u32Kind ) {
+         /// - The in-band key lasted long enough:  Report it from where it
+         ///   started
+         case DTMF_PCAP_TIMER_TONE:
+            if ( pStream->currentKey != L'\0' && !pStream->bKeyDown ) {
+               pStream->bKeyDown = true;
+               dtmfPcapKeyDown( pWorker, pStream, pExpired->u32Id, DTMF_PCAP_SOURCE_INBAND, pStream->currentKey, pStream->u64KeyPosition, pStream->u64KeyTimeUs );
+            }
+            break;
+
+         /// - No key since the last one ended
+         case DTMF_PCAP_TIMER_INTERDIGIT:
+            if ( pStream->entryKey != L'\0' && pStream->bEntryIdle ) {
+               dtmfPcapEndEntry( pWorker, pStream, pExpired->u32Id, DTMF_PCAP_EVENT_ENTRY_END, u64Tick );
+            }
+            break;
+
+         /// - The entry has gone on long enough
+         default:
+            if ( pStream->entryKey != L'\0' ) {
+               dtmfPcapEndEntry( pWorker, pStream, pExpired->u32Id, DTMF_PCAP_EVENT_ENTRY_TIMEOUT, u64Tick );
+            }
+            break;
+      }
+
+      pExpired = pNext;
+   }
+}
+
+
+/// Follow a change in a stream's in-band key.  A new key isn't reported
+/// until it has lasted `/pcapmintone` (#DTMF_PCAP_TIMER_TONE), so a blip of
+/// speech or noise that looks like DTMF isn't a key.
+///
+/// @param pWorker   The stream's decoder thread
+/// @param pStream   The stream
+/// @param u32Stream The stream's index
+/// @param key       The key the decoder hears now (or `L'\0'`)
+static void dtmfPcapInbandKey( _Inout_ dtmfPcapWorker_t* pWorker, _Inout_ dtmfPcapStream_t* pStream, _In_ const UINT32 u32Stream, _In_ const WCHAR key ) {
+   if ( pStream->currentKey != L'\0' ) {
+      if ( pStream->bKeyDown ) {
+         dtmfPcapKeyUp( pWorker, pStream, u32Stream, DTMF_PCAP_SOURCE_INBAND, pStream->currentKey, pStream->u64Position );
+      } else if ( timerWheelCancel( &pWorker->wheel, &pStream->timers[ DTMF_PCAP_TIMER_TONE ] ) ) {
+         pWorker->u64ShortTones++;
+      }
+   }
+
+   pStream->currentKey     = key;
+   pStream->bKeyDown       = false;
+   pStream->u64KeyPosition = pStream->u64Position;
+   pStream->u64KeyTimeUs   = pStream->u64TimeUs;
+
+   if ( key == L'\0' ) {
+      return;
+   }
+
+   if ( su32MinToneMs == 0 ) {
+      pStream->bKeyDown = true;
+      dtmfPcapKeyDown( pWorker, pStream, u32Stream, DTMF_PCAP_SOURCE_INBAND, key, pStream->u64Position, pStream->u64TimeUs );
+      return;
+   }
+
+   timerWheelArm( &pWorker->wheel, &pStream->timers[ DTMF_PCAP_TIMER_TONE ], dtmfPcapTick( pStream->u64TimeUs ) + dtmfPcapTicks( su32MinToneMs ) );
+}
+
+
+/// Run 8-bit samples through a stream's decoder a hop at a time (like
+/// dtmfServiceDecode) and follow any change in the key
+///
+/// @param pWorker   The stream's decoder thread
+/// @param pStream   The stream
+/// @param u32Stream The stream's index
+/// @param law       How #pBytes is encoded
+/// @param pBytes    The samples
+/// @param stLength  The number of samples
+static void dtmfPcapDecodeSamples(
+   _Inout_                  dtmfPcapWorker_t* pWorker,
+   _Inout_                  dtmfPcapStream_t* pStream,
+   _In_                     const UINT32      u32Stream,
+   _In_                     const g711Law_t   law,
+   _In_reads_( stLength )   const BYTE*       pBytes,
+   _In_                     size_t            stLength ) {
+
+   while ( stLength > 0 ) {
+      size_t stRun = pStream->stHop - pStream->stSinceAnalysis;
+      stRun = ( stRun < stLength ) ? stRun : stLength;
+
+      goertzelContextWrite( &pStream->decoder, law, pBytes, stRun );
+
+      pBytes                   += stRun;
+      stLength                 -= stRun;
+      pStream->u64Position     += stRun;
+      pStream->stSinceAnalysis += stRun;
+
+      if ( pStream->stSinceAnalysis < pStream->stHop ) {
+         break;
+      }
+      pStream->stSinceAnalysis = 0;
+
+      goertzelContextAnalyze( &pStream->decoder );
+
+      const WCHAR key = goertzelDecodeKey( pStream->decoder.tones );
+      if ( key != pStream->currentKey ) {
+         dtmfPcapInbandKey( pWorker, pStream, u32Stream, key );
+      }
+   }
+}
+
+
+/// Fill in for a lost packet with silence, so the keys after it are still
+/// in the right place
+///
+/// @param pWorker   The stream's decoder thread
+/// @param pStream   The stream
+/// @param u32Stream The stream's index
+static void dtmfPcapConceal( _Inout_ dtmfPcapWorker_t* pWorker, _Inout_ dtmfPcapStream_t* pStream, _In_ const UINT32 u32Stream ) {
+   pWorker->u64Lost++;
+
+   if ( !pStream->bAudio ) {
+      return;
+   }
+
+   size_t stSamples = pStream->stLastSamples;
+   while ( stSamples > 0 ) {
+      const size_t stRun = ( stSamples < sizeof( sSilence ) ) ? stSamples : sizeof( sSilence );
+      dtmfPcapDecodeSamples( pWorker, pStream, u32Stream, G711_LINEAR, sSilence, stRun );
+      stSamples -= stRun;
+   }
+}
+
+
+/// Report an RFC 4733 telephone-event.  The sender repeats each event
+/// (with a growing duration) until it ends, then repeats the end 3 times.
+/// All of them have the event's RTP timestamp.
+///
+/// @param pWorker   The stream's decoder thread
+/// @param pStream   The stream
+/// @param pPacket   The telephone-event packet
+/// @param pPayload  Its payload
+static void dtmfPcapTelephoneEvent(
+   _Inout_                  dtmfPcapWorker_t*       pWorker,
+   _Inout_                  dtmfPcapStream_t*       pStream,
+   _In_                     const dtmfPcapPacket_t* pPacket,
+   _In_reads_( 4 )          const BYTE*             pPayload ) {
+
+   if ( pPacket->u16Length < 4 || pPayload[ 0 ] > 15 ) {
+      return;  // Not a DTMF event (flash, modem tones and so on)
+   }
+
+   const WCHAR  key      = L"0123456789*#ABCD"[ pPayload[ 0 ] ];
+   const bool   bEnd     = ( pPayload[ 1 ] & 0x80 ) != 0;
+   const UINT64 u64Start = (UINT64) (UINT32) ( pPacket->u32RtpTime - pStream->u32FirstRtpTime );
+
+   /// - A new RTP timestamp is a new event.  End the last one, if its end
+   ///   packets were lost.
+   if ( pPacket->u32RtpTime != pStream->u32EventRtpTime || pStream->eventKey == L'\0' ) {
+      if ( pStream->bEventDown ) {
+         dtmfPcapKeyUp( pWorker, pStream, pPacket->u32Stream, DTMF_PCAP_SOURCE_RFC4733, pStream->eventKey, u64Start );
+      }
+
+      dtmfPcapKeyDown( pWorker, pStream, pPacket->u32Stream, DTMF_PCAP_SOURCE_RFC4733, key, u64Start, pStream->u64TimeUs );
+
+      pStream->u32EventRtpTime = pPacket->u32RtpTime;
+      pStream->eventKey        = key;
+      pStream->bEventDown      = true;
+   }
+
+   /// - The first end packet ends it.  The repeats are ignored.
+   if ( bEnd && pStream->bEventDown ) {
+      dtmfPcapKeyUp( pWorker, pStream, pPacket->u32Stream, DTMF_PCAP_SOURCE_RFC4733, key, u64Start + dtmfPcapBe16( pPayload + 2 ) );
+      pStream->bEventDown = false;
+   }
+}
+
+
+/// Play a packet (in sequence order) into its stream
+///
+/// @param pWorker The stream's decoder thread
+/// @param pPacket The packet
+static void dtmfPcapPlay( _Inout_ dtmfPcapWorker_t* pWorker, _In_ const dtmfPcapPacket_t* pPacket ) {
+   dtmfPcapStream_t* pStream  = &spStreams[ pPacket->u32Stream ];
+   const BYTE*       pPayload = spBase + pPacket->u64Offset;
+   const BYTE        format   = sFormats[ pPacket->u32PayloadType ];
+
+   pWorker->u64Played++;
+   pStream->u64TimeUs = pPacket->u64TimeUs;
+
+   if ( format == DTMF_PCAP_FORMAT_EVENT ) {
+      dtmfPcapTelephoneEvent( pWorker, pStream, pPacket, pPayload );
+      return;
+   }
+
+   /// - Set up the decoder on the first audio packet (and again if the
+   ///   sample rate changes)
+   const UINT32 u32Rate = sRates[ pPacket->u32PayloadType ];
+   if ( !pStream->bAudio || pStream->u32SampleRate != u32Rate ) {
+      if ( !goertzelContextInit( &pStream->decoder, (int) u32Rate, pStream->window ) ) {
+         return;
+      }
+
+      pStream->bAudio          = true;
+      pStream->u32SampleRate   = u32Rate;
+      pStream->stHop           = u32Rate / 100;
+      pStream->stSinceAnalysis = 0;
+   }
+
+   if ( format == DTMF_PCAP_FORMAT_PCMU || format == DTMF_PCAP_FORMAT_PCMA ) {
+      pStream->stLastSamples = pPacket->u16Length;
+      dtmfPcapDecodeSamples( pWorker, pStream, pPacket->u32Stream, ( format == DTMF_PCAP_FORMAT_PCMU ) ? G711_ULAW : G711_ALAW, pPayload, pPacket->u16Length );
+      return;
+   }
+
+   /// - 16-bit PCM is converted to 8-bit (like #processAudioFrame converts
+   ///   floats) a scratch buffer at a time
+   const size_t stSamples = pPacket->u16Length / 2;
+   pStream->stLastSamples = stSamples;
+
+   for ( size_t stDone = 0 ; stDone < stSamples ; ) {
+      size_t stRun = stSamples - stDone;
+      stRun = ( stRun < DTMF_PCAP_SCRATCH ) ? stRun : DTMF_PCAP_SCRATCH;
+
+      for ( size_t i = 0 ; i < stRun ; i++ ) {
+         const INT16 i16Sample = (INT16) dtmfPcapBe16( pPayload + ( stDone + i ) * 2 );
+         pWorker->scratch[ i ] = (BYTE) ( PCM_8_BIT_SILENCE + ( (int) i16Sample * PCM_8_BIT_SILENCE ) / 32767 );
+      }
+
+      dtmfPcapDecodeSamples( pWorker, pStream, pPacket->u32Stream, G711_LINEAR, pWorker->scratch, stRun );
+      stDone += stRun;
+   }
+}
+
+
+/// Play the packets at the front of a stream's jitter window, until the
+/// next one is missing
+///
+/// @param pWorker   The stream's decoder thread
+/// @param pStream   The stream
+static void dtmfPcapDrain( _Inout_ dtmfPcapWorker_t* pWorker, _Inout_ dtmfPcapStream_t* pStream ) {
+   for ( ;; ) {
+      const UINT32 u32Bit = 1u << ( pStream->u16NextSequence & ( DTMF_PCAP_JITTER - 1 ) );
+      if ( ( pStream->u32Present & u32Bit ) == 0 ) {
+         return;
+      }
+
+      dtmfPcapPlay( pWorker, &pStream->jitter[ pStream->u16NextSequence & ( DTMF_PCAP_JITTER - 1 ) ] );
+
+      pStream->u32Present &= ~u32Bit;
+      pStream->u16NextSequence++;
+   }
+}
+
+
+/// Give up on the next packet:  Play it if it's here or conceal it if it's
+/// lost
+///
+/// @param pWorker   The stream's decoder thread
+/// @param pStream   The stream
+/// @param u32Stream The stream's index
+static void dtmfPcapSkip( _Inout_ dtmfPcapWorker_t* pWorker, _Inout_ dtmfPcapStream_t* pStream, _In_ const UINT32 u32Stream ) {
+   const UINT32 u32Bit = 1u << ( pStream->u16NextSequence & ( DTMF_PCAP_JITTER - 1 ) );
+
+   if ( pStream->u32Present & u32Bit ) {
+      dtmfPcapPlay( pWorker, &pStream->jitter[ pStream->u16NextSequence & ( DTMF_PCAP_JITTER - 1 ) ] );
+      pStream->u32Present &= ~u32Bit;
+   } else {
+      dtmfPcapConceal( pWorker, pStream, u32Stream );
+   }
+
+   pStream->u16NextSequence++;
+}
+
+
+/// Put a packet in its place in its stream's jitter window and play
+/// whatever is ready
+///
+/// @param pWorker The stream's decoder thread
+/// @param pPacket The packet
+static void dtmfPcapReceive( _Inout_ dtmfPcapWorker_t* pWorker, _In_ const dtmfPcapPacket_t* pPacket ) {
+   dtmfPcapStream_t* pStream = &spStreams[ pPacket->u32Stream ];
+
+   if ( !pStream->bStarted ) {
+      pStream->bStarted        = true;
+      pStream->u16NextSequence = pPacket->u16Sequence;
+      pStream->u32FirstRtpTime = pPacket->u32RtpTime;
+
+      for ( UINT32 i = 0 ; i < DTMF_PCAP_TIMER_COUNT ; i++ ) {
+         timerWheelEntryInit( &pStream->timers[ i ], pPacket->u32Stream, i );
+      }
+   }
+
+   INT16 i16Ahead = (INT16) ( pPacket->u16Sequence - pStream->u16NextSequence );
+   if ( i16Ahead < 0 ) {
+      pWorker->u64Late++;  // Its turn has passed
+      return;
+   }
+
+   /// - If it's past the window, move the window up to it
+   while ( i16Ahead >= DTMF_PCAP_JITTER ) {
+      dtmfPcapSkip( pWorker, pStream, pPacket->u32Stream );
+      i16Ahead--;
+   }
+
+   const size_t stSlot = pPacket->u16Sequence & ( DTMF_PCAP_JITTER - 1 );
+   if ( pStream->u32Present & ( 1u << stSlot ) ) {
+      pWorker->u64Late++;  // A duplicate
+      return;
+   }
+
+   if ( i16Ahead == 0 && pStream->u32Present != 0 ) {
+      pWorker->u64Reordered++;  // It filled a gap
+   }
+
+   pStream->jitter[ stSlot ] = *pPacket;
+   pStream->u32Present      |= 1u << stSlot;
+
+   dtmfPcapDrain( pWorker, pStream );
+}
+
+
+/// A decoder thread.  It decodes every #sstWorkers'th stream until the
+/// reader is done, then plays what's left in its streams' jitter windows
+/// and ends their entries.
+///
+/// Before it plays each packet, it moves its timer wheel up to the packet's
+/// capture time.
+///
+/// @param pParam The thread's number
+/// @return `0`
+static DWORD WINAPI dtmfPcapDecoderThread( _In_ LPVOID pParam ) {
+   const size_t      stThread = (size_t) (UINT_PTR) pParam;
+   dtmfPcapWorker_t* pWorker  = &spWorkers[ stThread ];
+   UINT64            u64Tail  = 0;
+   size_t            stSpins  = 0;
+
+   timerWheelInit( &pWorker->wheel, 0 );
+
+   for ( ;; ) {
+      const bool   bDone   = sbReaderDone;
+      const UINT64 u64Head = (UINT64) pWorker->l64Head;  // A volatile read has acquire semantics in MSVC
+
+      if ( u64Tail == u64Head ) {
+         if ( bDone ) {
+            break;  // sbReaderDone was set after the last publish, so this is everything
+         }
+         if ( ++stSpins < DTMF_PCAP_IDLE_SPINS ) {
+            SwitchToThread();
+         } else {
+            Sleep( 1 );
+         }
+         continue;
+      }
+      stSpins = 0;
+
+      while ( u64Tail < u64Head ) {
+         const dtmfPcapPacket_t* pPacket = &pWorker->pRing[ u64Tail & ( DTMF_PCAP_RING_DEPTH - 1 ) ];
+
+         timerWheelAdvance( &pWorker->wheel, dtmfPcapTick( pPacket->u64TimeUs ), dtmfPcapTimerExpired, pWorker );
+         dtmfPcapReceive( pWorker, pPacket );
+         u64Tail++;
+      }
+
+      pWorker->l64Tail = (LONG64) u64Tail;  // A volatile write has release semantics in MSVC
+   }
+
+   /// - Flush every stream this thread owns and end any key that's still
+   ///   down (an in-band key that hasn't lasted `/pcapmintone` is dropped)
+   for ( size_t i = stThread ; i < su32Streams ; i += sstWorkers ) {
+      dtmfPcapStream_t* pStream = &spStreams[ i ];
+
+      while ( pStream->u32Present != 0 ) {
+         dtmfPcapSkip( pWorker, pStream, (UINT32) i );
+      }
+
+      if ( pStream->currentKey != L'\0' ) {
+         dtmfPcapInbandKey( pWorker, pStream, (UINT32) i, L'\0' );
+      }
+      if ( pStream->bEventDown ) {
+         dtmfPcapKeyUp( pWorker, pStream, (UINT32) i, DTMF_PCAP_SOURCE_RFC4733, pStream->eventKey, (UINT64) (UINT32) ( pStream->u32EventRtpTime - pStream->u32FirstRtpTime ) );
+         pStream->bEventDown = false;
+      }
+   }
+
+   /// - Run the wheel out, so every open entry ends when it would have
+   const UINT32 u32Longest = ( su32InterDigitMs > su32EntryMs ) ? su32InterDigitMs : su32EntryMs;
+   timerWheelAdvance( &pWorker->wheel, pWorker->wheel.u64Now + dtmfPcapTicks( u32Longest ) + 1, dtmfPcapTimerExpired, pWorker );
+
+   logTraceReleaseRing();
+   logFlightReleaseRing();
+
+   return 0;
+}
+
+
+/// Compare two events for `qsort` (by stream, then by time)
+///
+/// @param p1 The first event
+/// @param p2 The second event
+/// @return `< 0`, `0` or `> 0`
+static int __cdecl dtmfPcapCompareEvents( _In_ const void* p1, _In_ const void* p2 ) {
+   const dtmfPcapEvent_t* pEvent1 = (const dtmfPcapEvent_t*) p1;
+   const dtmfPcapEvent_t* pEvent2 = (const dtmfPcapEvent_t*) p2;
+
+   if ( pEvent1->u32Stream != pEvent2->u32Stream ) {
+      return ( pEvent1->u32Stream < pEvent2->u32Stream ) ? -1 : 1;
+   }
+   if ( pEvent1->u64TimeUs != pEvent2->u64TimeUs ) {
+      return ( pEvent1->u64TimeUs < pEvent2->u64TimeUs ) ? -1 : 1;
+   }
+   if ( pEvent1->u64Position != pEvent2->u64Position ) {
+      return ( pEvent1->u64Position < pEvent2->u64Position ) ? -1 : 1;
+   }
+   return (int) pEvent1->u16Source - (int) pEvent2->u16Source;
+}
+
+
+/// Format an address and port like `10.0.0.1:5004` or `[2001:db8:0:0:0:0:0:1]:5004`
+///
+/// @param pszOut   Gets the address
+/// @param stOut    The size of #pszOut
+/// @param pAddress The address (in network order)
+/// @param u32IpVersion `4` or `6`
+/// @param u16Port  The port
+static void dtmfPcapFormatAddress(
+   _Out_writes_z_( stOut ) char*        pszOut,
+   _In_                    const size_t stOut,
+   _In_reads_( 16 )        const BYTE*  pAddress,
+   _In_                    const UINT32 u32IpVersion,
+   _In_                    const UINT16 u16Port ) {
+
+   if ( u32IpVersion == 4 ) {
+      sprintf_s( pszOut, stOut, "%u.%u.%u.%u:%u", pAddress[ 0 ], pAddress[ 1 ], pAddress[ 2 ], pAddress[ 3 ], u16Port );
+      return;
+   }
+
+   sprintf_s( pszOut, stOut, "[%x:%x:%x:%x:%x:%x:%x:%x]:%u",
+      dtmfPcapBe16( pAddress ),      dtmfPcapBe16( pAddress + 2 ),  dtmfPcapBe16( pAddress + 4 ),  dtmfPcapBe16( pAddress + 6 ),
+      dtmfPcapBe16( pAddress + 8 ),  dtmfPcapBe16( pAddress + 10 ), dtmfPcapBe16( pAddress + 12 ), dtmfPcapBe16( pAddress + 14 ),
+      u16Port );
+}
+
+
+/// Merge the decoders' events, sort them and write them to #swsResultsFile
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+static BOOL dtmfPcapWriteResults() {
+   /// - Merge and sort the events
+   size_t stEvents = 0;
+   for ( size_t i = 0 ; i < sstWorkers ; i++ ) {
+      stEvents += spWorkers[ i ].stEvents;
+   }
+
+   dtmfPcapEvent_t* pEvents = (dtmfPcapEvent_t*) _malloc_dbg( ( stEvents > 0 ? stEvents : 1 ) * sizeof( dtmfPcapEvent_t ), _CLIENT_BLOCK, __FILE__, __LINE__ );
+   char*            pBuffer = (char*) _malloc_dbg( DTMF_PCAP_WRITE_BUFFER, _CLIENT_BLOCK, __FILE__, __LINE__ );
+   if ( pEvents == NULL || pBuffer == NULL ) {
+      if ( pEvents != NULL ) _free_dbg( pEvents, _CLIENT_BLOCK );
+      if ( pBuffer != NULL ) _free_dbg( pBuffer, _CLIENT_BLOCK );
+      RETURN_FATAL( IDS_DTMF_PCAP_FAILED_TO_ALLOCATE );  // "Failed to allocate memory for the capture reader.  Exiting."
+   }
+
+   size_t stMerged = 0;
+   for ( size_t i = 0 ; i < sstWorkers ; i++ ) {
+      CopyMemory( pEvents + stMerged, spWorkers[ i ].pEvents, spWorkers[ i ].stEvents * sizeof( dtmfPcapEvent_t ) );
+      stMerged += spWorkers[ i ].stEvents;
+   }
+
+   qsort( pEvents, stEvents, sizeof( dtmfPcapEvent_t ), dtmfPcapCompareEvents );
+
+   /// - Write them a buffer at a time
+   HANDLE hFile = CreateFileW( swsResultsFile, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+   if ( hFile == INVALID_HANDLE_VALUE ) {
+      _free_dbg( pEvents, _CLIENT_BLOCK );
+      _free_dbg( pBuffer, _CLIENT_BLOCK );
+      RETURN_FATAL( IDS_DTMF_PCAP_FAILED_TO_OPEN_RESULTS, swsResultsFile );  // "Failed to open the capture results file [%s].  Exiting."
+   }
+
+   static const char szHeader[] = "stream,source,destination,ssrc,detector,event,key,position_samples,capture_time_s\r\n";
+
+   BOOL   br       = TRUE;
+   size_t stBuffer = sizeof( szHeader ) - 1;
+   CopyMemory( pBuffer, szHeader, stBuffer );
+
+   for ( size_t i = 0 ; br && i <= stEvents ; i++ ) {
+      /// - Flush the buffer when the next line might not fit (and at the end)
+      if ( i == stEvents || DTMF_PCAP_WRITE_BUFFER - stBuffer < DTMF_PCAP_MAX_LINE ) {
+         DWORD dwWritten = 0;
+         br = WriteFile( hFile, pBuffer, (DWORD) stBuffer, &dwWritten, NULL ) && dwWritten == (DWORD) stBuffer;
+         stBuffer = 0;
+
+         if ( i == stEvents ) {
+            break;
+         }
+      }
+
+      const dtmfPcapEvent_t*  pEvent  = &pEvents[ i ];
+      const dtmfPcapStream_t* pStream = &spStreams[ pEvent->u32Stream ];
+
+      char szSource[ 64 ];
+      char szDestination[ 64 ];
+      dtmfPcapFormatAddress( szSource,      sizeof( szSource ),      pStream->key.src, pStream->key.u32IpVersion, pStream->key.u16SrcPort );
+      dtmfPcapFormatAddress( szDestination, sizeof( szDestination ), pStream->key.dst, pStream->key.u32IpVersion, pStream->key.u16DstPort );
+
+      const char* pszType = "up";
+      switch ( pEvent->u16Type ) {
+         case DTMF_SERVICE_EVENT_KEY_DOWN:   pszType = "down";          break;
+         case DTMF_PCAP_EVENT_ENTRY_END:     pszType = "entry_end";     break;
+         case DTMF_PCAP_EVENT_ENTRY_TIMEOUT: pszType = "entry_timeout"; break;
+      }
+
+      const int iLength = sprintf_s( pBuffer + stBuffer, DTMF_PCAP_WRITE_BUFFER - stBuffer, "%u,%s,%s,0x%08X,%s,%s,%c,%llu,%llu.%06llu\r\n",
+         pEvent->u32Stream, szSource, szDestination, pStream->key.u32Ssrc,
+         ( pEvent->u16Source == DTMF_PCAP_SOURCE_INBAND ) ? "inband" : "rfc4733",
+         pszType,
+         (char) pEvent->key,
+         pEvent->u64Position,
+         pEvent->u64TimeUs / 1000000, pEvent->u64TimeUs % 1000000 );
+
+      stBuffer += ( iLength > 0 ) ? (size_t) iLength : 0;
+   }
+
+   CloseHandle( hFile );
+   _free_dbg( pEvents, _CLIENT_BLOCK );
+   _free_dbg( pBuffer, _CLIENT_BLOCK );
+
+   if ( !br ) {
+      RETURN_FATAL( IDS_DTMF_PCAP_FAILED_TO_WRITE_RESULTS, swsResultsFile );  // "Failed to write the capture results file [%s].  Exiting."
+   }
+
+   return TRUE;
+}
+
+
+/// Release everything #dtmfPcapRun allocated
+static void dtmfPcapCleanup() {
+   if ( spWorkers != NULL ) {
+      for ( size_t i = 0 ; i < sstWorkers ; i++ ) {
+         if ( spWorkers[ i ].pEvents != NULL ) {
+            _free_dbg( spWorkers[ i ].pEvents, _CLIENT_BLOCK );
+         }
+         if ( spWorkers[ i ].pRing != NULL ) {
+            VirtualFree( spWorkers[ i ].pRing, 0, MEM_RELEASE );
+         }
+      }
+      VirtualFree( spWorkers, 0, MEM_RELEASE );
+      spWorkers = NULL;
+   }
+
+   if ( spStreams != NULL ) {
+      VirtualFree( spStreams, 0, MEM_RELEASE );
+      spStreams = NULL;
+   }
+   if ( spTable != NULL ) {
+      VirtualFree( spTable, 0, MEM_RELEASE );
+      spTable = NULL;
+   }
+
+   if ( spBase != NULL ) {
+      UnmapViewOfFile( spBase );
+      spBase = NULL;
+   }
+   if ( shMapping != NULL ) {
+      CloseHandle( shMapping );
+      shMapping = NULL;
+   }
+   if ( shFile != INVALID_HANDLE_VALUE ) {
+      CloseHandle( shFile );
+      shFile = INVALID_HANDLE_VALUE;
+   }
+}
+
+
+/// Map the capture and check its file header
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+static BOOL dtmfPcapOpen() {
+   shFile = CreateFileW( swsCaptureFile, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+   if ( shFile == INVALID_HANDLE_VALUE ) {
+      RETURN_FATAL( IDS_DTMF_PCAP_FAILED_TO_OPEN, swsCaptureFile );  // "Failed to open the capture file [%s].  Exiting."
+   }
+
+   LARGE_INTEGER size;
+   if ( !GetFileSizeEx( shFile, &size ) || size.QuadPart < 24 ) {
+      RETURN_FATAL( IDS_DTMF_PCAP_NOT_PCAP, swsCaptureFile );  // "[%s] is not a pcap file (pcapng isn't supported).  Exiting."
+   }
+   su64Size = (UINT64) size.QuadPart;
+
+   /// - Map the whole file.  A 32-bit build can only map what fits in its
+   ///   address space.
+   shMapping = CreateFileMappingW( shFile, NULL, PAGE_READONLY, 0, 0, NULL );
+   if ( shMapping != NULL ) {
+      spBase = (const BYTE*) MapViewOfFile( shMapping, FILE_MAP_READ, 0, 0, 0 );
+   }
+   if ( spBase == NULL ) {
+      RETURN_FATAL( IDS_DTMF_PCAP_FAILED_TO_MAP, swsCaptureFile, GetLastError() );  // "Failed to map the capture file [%s].  Error: %u.  Exiting."
+   }
+
+   /// - Check the magic number (which tells us the byte order and the
+   ///   timestamps' resolution) and the link type
+   const UINT32 u32Magic = *(const UNALIGNED UINT32*) spBase;
+
+   sbSwapped     = ( u32Magic == _byteswap_ulong( PCAP_MAGIC_US ) || u32Magic == _byteswap_ulong( PCAP_MAGIC_NS ) );
+   sbNanoseconds = ( u32Magic == PCAP_MAGIC_NS || u32Magic == _byteswap_ulong( PCAP_MAGIC_NS ) );
+
+   if ( !sbSwapped && u32Magic != PCAP_MAGIC_US && u32Magic != PCAP_MAGIC_NS ) {
+      RETURN_FATAL( IDS_DTMF_PCAP_NOT_PCAP, swsCaptureFile );  // "[%s] is not a pcap file (pcapng isn't supported).  Exiting."
+   }
+
+   su32LinkType = dtmfPcapU32( spBase + 20 ) & 0xFFFF;  // The upper bits are FCS flags
+
+   switch ( su32LinkType ) {
+      case PCAP_LINKTYPE_NULL:
+      case PCAP_LINKTYPE_ETHERNET:
+      case PCAP_LINKTYPE_RAW:
+      case PCAP_LINKTYPE_LINUX_SLL:
+      case PCAP_LINKTYPE_IPV4:
+      case PCAP_LINKTYPE_IPV6:
+      case PCAP_LINKTYPE_LINUX_SLL2:
+         break;
+      default:
+         RETURN_FATAL( IDS_DTMF_PCAP_UNSUPPORTED_LINK, su32LinkType );  // "The capture's link type %u is not supported.  Exiting."
+   }
+
+   return TRUE;
+}
+
+
+/// Decode every RTP stream in the capture and write the keys to
+/// #swsResultsFile
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL dtmfPcapRun() {
+   _ASSERTE( sbEnabled );
+
+   /// #### Function
+
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER start;
+   LARGE_INTEGER end;
+   QueryPerformanceFrequency( &frequency );  // This never fails on Windows XP or later
+   QueryPerformanceCounter( &start );
+
+   /// - Build the payload type table
+   ZeroMemory( sFormats, sizeof( sFormats ) );
+   ZeroMemory( sRates, sizeof( sRates ) );
+
+   sFormats[ 0 ]  = DTMF_PCAP_FORMAT_PCMU;  sRates[ 0 ]  = 8000;
+   sFormats[ 8 ]  = DTMF_PCAP_FORMAT_PCMA;  sRates[ 8 ]  = 8000;
+   sFormats[ 11 ] = DTMF_PCAP_FORMAT_L16;   sRates[ 11 ] = 44100;
+   if ( su32L16Pt < DTMF_PCAP_NO_PAYLOAD_TYPE ) {
+      sFormats[ su32L16Pt ] = DTMF_PCAP_FORMAT_L16;
+      sRates[ su32L16Pt ]   = su32L16Rate;
+   }
+   sFormats[ su32EventPt ] = DTMF_PCAP_FORMAT_EVENT;
+
+   FillMemory( sSilence, sizeof( sSilence ), PCM_8_BIT_SILENCE );
+
+   su32Streams   = 0;
+   su64Frames    = 0;
+   su64Rtp       = 0;
+   su64NotRtp    = 0;
+   su64Fragments = 0;
+   su64Overflow  = 0;
+   sbReaderDone  = false;
+
+   if ( !dtmfPcapOpen() ) {
+      dtmfPcapCleanup();
+      return FALSE;
+   }
+
+   /// - Allocate the streams, the hash table (at most half full) and a
+   ///   decoder per processor (the reader takes one).  Untouched pages
+   ///   cost nothing.
+   size_t stTable = 1;
+   while ( stTable < (size_t) su32MaxStreams * 2 ) {
+      stTable <<= 1;
+   }
+   sstTableMask = stTable - 1;
+
+   SYSTEM_INFO systemInfo;
+   GetSystemInfo( &systemInfo );
+
+   sstWorkers = ( systemInfo.dwNumberOfProcessors > 1 ) ? systemInfo.dwNumberOfProcessors - 1 : 1;
+   sstWorkers = ( sstWorkers < DTMF_PCAP_MAX_THREADS ) ? sstWorkers : DTMF_PCAP_MAX_THREADS;
+
+   spStreams = (dtmfPcapStream_t*) VirtualAlloc( NULL, (size_t) su32MaxStreams * sizeof( dtmfPcapStream_t ), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE );
+   spTable   = (UINT32*)           VirtualAlloc( NULL, stTable * sizeof( UINT32 ), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE );
+   spWorkers = (dtmfPcapWorker_t*) VirtualAlloc( NULL, sstWorkers * sizeof( dtmfPcapWorker_t ), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE );
+
+   bool bAllocated = ( spStreams != NULL && spTable != NULL && spWorkers != NULL );
+   for ( size_t i = 0 ; bAllocated && i < sstWorkers ; i++ ) {
+      spWorkers[ i ].pRing = (dtmfPcapPacket_t*) VirtualAlloc( NULL, DTMF_PCAP_RING_DEPTH * sizeof( dtmfPcapPacket_t ), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE );
+      bAllocated = ( spWorkers[ i ].pRing != NULL );
+   }
+
+   if ( !bAllocated ) {
+      dtmfPcapCleanup();
+      RETURN_FATAL( IDS_DTMF_PCAP_FAILED_TO_ALLOCATE );  // "Failed to allocate memory for the capture reader.  Exiting."
+   }
+
+   LOG_INFO_R( IDS_DTMF_PCAP_STARTED, swsCaptureFile, su64Size / ( 1024 * 1024 ), sstWorkers );  // "Reading the capture [%s] (%llu MB) with %zu decoder threads"
+
+   /// - Start the decoders, then read the capture on this thread
+   for ( size_t i = 0 ; i < sstWorkers ; i++ ) {
+      spWorkers[ i ].hThread = CreateThread( NULL, 0, dtmfPcapDecoderThread, (LPVOID) (UINT_PTR) i, 0, NULL );
+      if ( spWorkers[ i ].hThread == NULL ) {
+         sbReaderDone = true;
+         for ( size_t j = 0 ; j < i ; j++ ) {
+            WaitForSingleObject( spWorkers[ j ].hThread, INFINITE );
+            CloseHandle( spWorkers[ j ].hThread );
+         }
+         dtmfPcapCleanup();
+         RETURN_FATAL( IDS_DTMF_PCAP_FAILED_TO_START_THREAD );  // "Failed to start a capture decoder thread.  Exiting."
+      }
+   }
+
+   dtmfPcapRead();
+
+   for ( size_t i = 0 ; i < sstWorkers ; i++ ) {
+      WaitForSingleObject( spWorkers[ i ].hThread, INFINITE );
+      CloseHandle( spWorkers[ i ].hThread );
+   }
+
+   QueryPerformanceCounter( &end );
+
+   /// - Write the results and the summary
+   BOOL br = dtmfPcapWriteResults();
+
+   UINT64 u64Lost = 0, u64Late = 0, u64Reordered = 0, u64InbandKeys = 0, u64EventKeys = 0, u64EventsDropped = 0, u64ShortTones = 0, u64Entries = 0;
+   for ( size_t i = 0 ; i < sstWorkers ; i++ ) {
+      u64Lost          += spWorkers[ i ].u64Lost;
+      u64Late          += spWorkers[ i ].u64Late;
+      u64Reordered     += spWorkers[ i ].u64Reordered;
+      u64InbandKeys    += spWorkers[ i ].u64InbandKeys;
+      u64EventKeys     += spWorkers[ i ].u64EventKeys;
+      u64EventsDropped += spWorkers[ i ].u64EventsDropped;
+      u64ShortTones    += spWorkers[ i ].u64ShortTones;
+      u64Entries       += spWorkers[ i ].u64Entries;
+   }
+
+   const double seconds = (double) ( end.QuadPart - start.QuadPart ) / (double) frequency.QuadPart;
+
+   LOG_INFO_R( IDS_DTMF_PCAP_DONE, su64Frames, su64Rtp, su32Streams, seconds, (double) su64Size / ( 1024.0 * 1024.0 ) / seconds );  // "Capture:  %llu packets  %llu RTP packets  %u streams  %.2f s  %.1f MB/s"
+   LOG_INFO_R( IDS_DTMF_PCAP_JITTER, u64Lost, u64Late, u64Reordered, su64NotRtp, su64Fragments, su64Overflow );  // "Capture:  Lost: %llu  Late: %llu  Reordered: %llu  Not RTP: %llu  Fragments: %llu  Too many streams: %llu"
+   LOG_INFO_R( IDS_DTMF_PCAP_KEYS, u64InbandKeys, u64EventKeys, swsResultsFile );  // "Capture:  %llu in-band keys and %llu RFC 4733 keys.  Results in [%s]"
+   LOG_INFO_R( IDS_DTMF_PCAP_ENTRIES, u64Entries, u64ShortTones, su32MinToneMs );  // "Capture:  %llu entries.  %llu in-band tones were shorter than %u ms."
+
+   if ( u64EventsDropped > 0 ) {
+      LOG_WARN_R( IDS_DTMF_PCAP_EVENTS_DROPPED, u64EventsDropped );  // "Capture:  %llu events were dropped (out of memory)"
+   }
+
+   dtmfPcapCleanup();
+
+   return br;
+}
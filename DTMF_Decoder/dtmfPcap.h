@@ -0,0 +1,20 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// An offline reader that decodes the DTMF in every RTP stream of a pcap file
+///
+/// @file    dtmfPcap.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>  // For BOOL
+
+
+extern BOOL dtmfPcapParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine );
+extern bool dtmfPcapIsEnabled();
+extern BOOL dtmfPcapRun();
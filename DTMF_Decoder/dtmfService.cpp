@@ -0,0 +1,862 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// A headless service that decodes many PCM streams at once over Unix domain
+/// sockets
+///
+/// The service runs without a window or an audio device:
+///
+///     DTMF_Decoder.exe /service[:"C:\DTMF_Decoder.sock"] [/servicestreams:4096] [/serviceseconds:0] [/serviceshm...]
+///
+/// Media servers connect to the socket and stream PCM to it (see
+/// dtmfService.h for the protocol).  Each stream gets its own
+/// #goertzelContext_t, so the streams never share a window.  Every 10ms of
+/// audio, the stream's window is analyzed with the SIMD kernel and, when the
+/// key changes, an event goes back to the client.
+///
+/// #### Sockets and threads
+/// Windows doesn't have `epoll`.  Its scalable equivalent is an I/O
+/// completion port, and Windows 10 (1803 and later) has `AF_UNIX` sockets.
+///
+///   - An accept thread takes new connections, gives each one a stream from
+///     the pool and posts its first overlapped `WSARecv`.
+///   - One worker thread per processor waits on the completion port.  When a
+///     receive completes, the worker decodes the bytes, sends any events and
+///     posts the next receive.  A stream only ever has one receive
+///     outstanding, so only one worker touches it at a time and the stream
+///     needs no locks.
+///   - Events are sent with a non-blocking `send`.  A client that doesn't
+///     read its events has them dropped (and counted) -- it never stalls a
+///     worker.
+///
+/// #### The stream pool
+/// The streams are allocated once, up front, and kept on a lock-free
+/// `SLIST`.  Connecting and disconnecting never touch the heap.  When the
+/// pool is empty, new connections are refused.
+///
+/// A stream's decoder is attached from its node's #goertzelSlab_t when its
+/// hello arrives (and the sample rate is known) and detached when it
+/// closes.  Both are a lock-free pop or push, the decoder's window is sized
+/// for its rate and the coefficients are shared by every stream at that
+/// rate (see goertzelSlab.cpp).
+///
+/// #### NUMA placement
+/// On a multi-socket server, each NUMA node gets its own pool, completion
+/// port and workers (see numaPlace.cpp).  The node's streams are allocated
+/// on the node and its workers are pinned to its CPUs, so a stream's
+/// decoders never leave the node.  The accept thread gives each new
+/// connection to the node with the fewest active streams.  With `/nonuma`
+/// (or on one node) there's one pool and one port, and nothing is pinned.
+///
+/// The main thread logs the service's statistics (including its CPU time)
+/// every #DTMF_SERVICE_STATS_MS.  It runs for `/serviceseconds` (or, if
+/// that's `0`, until the process is ended).
+///
+/// With `/serviceshm`, producers on the same machine can skip the sockets and
+/// write into shared memory instead (see dtmfShm.cpp).
+///
+/// dtmfLoadGen.cpp is a client that measures the service.
+///
+/// ## Sockets API
+/// | API                         | Link                                                                                                  |
+/// |-----------------------------| ------------------------------------------------------------------------------------------------------|
+/// | `WSAStartup`                | https://learn.microsoft.com/en-us/windows/win32/api/winsock/nf-winsock-wsastartup                     |
+/// | `socket`                    | https://learn.microsoft.com/en-us/windows/win32/api/winsock2/nf-winsock2-socket                       |
+/// | `bind`                      | https://learn.microsoft.com/en-us/windows/win32/api/winsock/nf-winsock-bind                           |
+/// | `listen`                    | https://learn.microsoft.com/en-us/windows/win32/api/winsock2/nf-winsock2-listen                       |
+/// | `accept`                    | https://learn.microsoft.com/en-us/windows/win32/api/winsock2/nf-winsock2-accept                       |
+/// | `WSARecv`                   | https://learn.microsoft.com/en-us/windows/win32/api/winsock2/nf-winsock2-wsarecv                      |
+/// | `send`                      | https://learn.microsoft.com/en-us/windows/win32/api/winsock2/nf-winsock2-send                         |
+/// | `ioctlsocket`               | https://learn.microsoft.com/en-us/windows/win32/api/winsock/nf-winsock-ioctlsocket                    |
+/// | `AF_UNIX`                   | https://devblogs.microsoft.com/commandline/af_unix-comes-to-windows/                                  |
+///
+/// ## Threads & Synchronization API
+/// | API                          | Link                                                                                                   |
+/// |------------------------------| -------------------------------------------------------------------------------------------------------|
+/// | `CreateIoCompletionPort`     | https://learn.microsoft.com/en-us/windows/win32/fileio/createiocompletionport                          |
+/// | `GetQueuedCompletionStatus`  | https://learn.microsoft.com/en-us/windows/win32/api/ioapiset/nf-ioapiset-getqueuedcompletionstatus     |
+/// | `PostQueuedCompletionStatus` | https://learn.microsoft.com/en-us/windows/win32/fileio/postqueuedcompletionstatus                      |
+/// | `InterlockedPushEntrySList`  | https://learn.microsoft.com/en-us/windows/win32/api/interlockedapi/nf-interlockedapi-interlockedpushentryslist |
+/// | `InterlockedPopEntrySList`   | https://learn.microsoft.com/en-us/windows/win32/api/interlockedapi/nf-interlockedapi-interlockedpopentryslist  |
+/// | `GetProcessTimes`            | https://learn.microsoft.com/en-us/windows/win32/api/processthreadsapi/nf-processthreadsapi-getprocesstimes |
+///
+/// @file    dtmfService.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <stdio.h>        // For swscanf_s
+#include <wchar.h>        // For wcsstr
+
+#include "mvcModel.h"     // For dtmfTones_t
+#include "goertzel.h"     // For goertzelContext_t
+#include "goertzelSlab.h" // For goertzelSlabAttach
+#include "logTrace.h"     // For logTraceReleaseRing
+#include "logFlight.h"    // For logFlightReleaseRing
+#include "dtmfShm.h"      // For shared-memory ingestion
+#include "numaPlace.h"    // For the NUMA placement layer
+#include "dtmfService.h"  // For yo bad self
+
+#pragma comment(lib, "Ws2_32")
+
+
+/// The default number of streams in the pool
+#define DTMF_SERVICE_DEFAULT_STREAMS (4096)
+
+/// The most streams `/servicestreams` can ask for
+#define DTMF_SERVICE_MAX_STREAMS     (65536)
+
+/// The size of each stream's receive buffer (in bytes)
+#define DTMF_SERVICE_RECV_BUFFER     (4096)
+
+/// How often the main thread logs the statistics (in milliseconds)
+#define DTMF_SERVICE_STATS_MS        (10000)
+
+/// The completion key that tells a worker thread to end
+#define DTMF_SERVICE_KEY_STOP        (1)
+
+/// The most worker threads
+#define DTMF_SERVICE_MAX_WORKERS     (64)
+
+
+/// One stream.  Only the thread that owns its outstanding receive touches
+/// it, so it needs no locks.
+typedef struct DECLSPEC_ALIGN( MEMORY_ALLOCATION_ALIGNMENT ) {
+   SLIST_ENTRY        entry;                              ///< Links free streams in #dtmfServiceNode_t.pool.  Must be first.
+   OVERLAPPED         overlapped;                         ///< The outstanding receive
+   SOCKET             socket;                             ///< The client or `INVALID_SOCKET` if the stream is free
+   size_t             stNode;                             ///< The #sNodes the stream belongs to
+   WSABUF             wsaBuf;                             ///< Points to #recvBuffer
+   size_t             stHelloBytes;                       ///< The bytes of #hello received so far
+   dtmfServiceHello_t hello;                              ///< The client's hello
+   size_t             stHop;                              ///< Samples between analyses (10ms)
+   size_t             stSinceAnalysis;                    ///< Samples since the last analysis
+   UINT64             u64Position;                        ///< Samples received (after the hello)
+   WCHAR              currentKey;                         ///< The key that's down (or `L'\0'`)
+   goertzelContext_t* pDecoder;                           ///< The stream's decoder (from its node's #dtmfServiceNode_t.slab) or `NULL` before the hello
+   BYTE               recvBuffer[ DTMF_SERVICE_RECV_BUFFER ];  ///< Where #WSARecv puts the bytes
+} dtmfServiceStream_t;
+
+
+/// The statistics.  Each counter is on its own cache line, so the workers
+/// don't fight over them.
+static struct {
+   DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) volatile LONG64 l64Active;         ///< Streams that are connected
+   DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) volatile LONG64 l64Accepted;       ///< Streams that have connected
+   DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) volatile LONG64 l64Refused;        ///< Connections refused because the pool was empty
+   DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) volatile LONG64 l64Rejected;       ///< Streams with a bad hello
+   DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) volatile LONG64 l64Bytes;          ///< Bytes received
+   DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) volatile LONG64 l64EventsSent;     ///< Events sent
+   DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) volatile LONG64 l64EventsDropped;  ///< Events dropped because the client wasn't reading
+} sStats;
+
+
+static bool   sbEnabled = false;                         ///< `true` if `/service` (the socket service) is on the command line
+static WCHAR  swsSocket[ MAX_PATH ] = DTMF_SERVICE_DEFAULT_SOCKET;  ///< The socket's path
+static UINT32 su32Streams = DTMF_SERVICE_DEFAULT_STREAMS;  ///< The number of streams in the pool
+static UINT32 su32Seconds = 0;                           ///< How long to run.  `0` to run until the process is ended.
+
+static volatile bool sbStopping = false;                 ///< `true` when the service is shutting down
+static SOCKET  sListenSocket = INVALID_SOCKET;           ///< The listening socket
+static HANDLE  shAcceptThread = NULL;                    ///< The accept thread
+static HANDLE  shWorkerThreads[ DTMF_SERVICE_MAX_WORKERS ] = { NULL };  ///< The worker threads
+static size_t  sstWorkers = 0;                           ///< The number of worker threads
+
+
+/// The streams and workers on one NUMA node.  Each is on its own cache
+/// lines, so the nodes don't fight over them.
+typedef struct DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) {
+   SLIST_HEADER         pool;             ///< The node's free streams
+   goertzelSlab_t       slab;             ///< The node's stream decoders
+   dtmfServiceStream_t* pStreams;         ///< The node's streams (allocated on the node with #numaPlaceAlloc)
+   size_t               stStreams;        ///< The number of streams in #pStreams
+   HANDLE               hCompletionPort;  ///< The port the node's workers wait on
+   size_t               stWorkers;        ///< The number of workers on the node
+   volatile LONG64      l64Active;        ///< The node's streams that are connected
+} dtmfServiceNode_t;
+
+static dtmfServiceNode_t sNodes[ NUMA_PLACE_MAX_NODES ];  ///< The nodes
+static size_t            sstNodes = 0;                   ///< The number of nodes in #sNodes
+
+
+/// Look for an option like `/service[:path]` on the command line.  The
+/// option must be followed by `:`, a space or the end of the command line
+/// (so `/service` doesn't match `/servicestreams`).  The path may be quoted.
+///
+/// @param pwszCmdLine The command line
+/// @param pwszOption  The option (without the `:`)
+/// @param pwszPath    Gets the path, if there is one.  Unchanged if there isn't.
+/// @param stPath      The size of #pwszPath (in characters)
+/// @param pbFound     Set to `true` if the option is on the command line
+/// @return `TRUE` if successful.  `FALSE` if the path is empty.
+BOOL dtmfServiceParsePath(
+   _In_z_                   const PCWSTR  pwszCmdLine,
+   _In_z_                   const PCWSTR  pwszOption,
+   _Out_writes_z_( stPath )       WCHAR*  pwszPath,
+   _In_                     const size_t  stPath,
+   _Out_                          bool*   pbFound ) {
+
+   *pbFound = false;
+
+   const size_t stOption = wcslen( pwszOption );
+   const WCHAR* pFound   = wcsstr( pwszCmdLine, pwszOption );
+
+   while ( pFound != NULL ) {
+      const WCHAR wNext = pFound[ stOption ];
+      if ( wNext == L':' || wNext == L' ' || wNext == L'\0' ) {
+         break;
+      }
+      pFound = wcsstr( pFound + stOption, pwszOption );
+   }
+
+   if ( pFound == NULL ) {
+      return TRUE;
+   }
+
+   *pbFound = true;
+
+   const WCHAR* pValue = pFound + stOption;
+   if ( *pValue != L':' ) {
+      return TRUE;
+   }
+   pValue++;
+
+   WCHAR wEnd = L' ';
+   if ( *pValue == L'"' ) {
+      wEnd = L'"';
+      pValue++;
+   }
+
+   size_t i = 0;
+   while ( *pValue != L'\0' && *pValue != wEnd && i < stPath - 1 ) {
+      pwszPath[ i++ ] = *pValue++;
+   }
+   pwszPath[ i ] = L'\0';
+
+   return ( i > 0 );
+}
+
+
+/// Read a number after an option like `/servicestreams:`
+///
+/// @param pwszCmdLine The command line
+/// @param pwszOption  The option (with the `:`)
+/// @param pu32Value   Gets the number.  Unchanged if the option isn't there.
+/// @return `TRUE` if successful.  `FALSE` if the number is not valid.
+BOOL dtmfServiceParseNumber(
+   _In_z_ const PCWSTR  pwszCmdLine,
+   _In_z_ const PCWSTR  pwszOption,
+   _Inout_      UINT32* pu32Value ) {
+
+   const WCHAR* pFound = wcsstr( pwszCmdLine, pwszOption );
+   if ( pFound == NULL ) {
+      return TRUE;
+   }
+
+   UINT32 u32Value = 0;
+   if ( swscanf_s( pFound + wcslen( pwszOption ), L"%u", &u32Value ) != 1 ) {
+      return FALSE;
+   }
+
+   *pu32Value = u32Value;
+
+   return TRUE;
+}
+
+
+/// Make the address of a Unix domain socket.  `sun_path` is UTF-8.
+///
+/// @param pwszPath The socket's path
+/// @param pAddress Gets the address
+/// @return `TRUE` if successful.  `FALSE` if the path is too long.
+BOOL dtmfServiceAddress( _In_z_ const PCWSTR pwszPath, _Out_ SOCKADDR_UN* pAddress ) {
+   ZeroMemory( pAddress, sizeof( SOCKADDR_UN ) );
+
+   pAddress->sun_family = AF_UNIX;
+
+   int iResult = WideCharToMultiByte( CP_UTF8, 0, pwszPath, -1, pAddress->sun_path, (int) sizeof( pAddress->sun_path ), NULL, NULL );
+
+   return ( iResult > 1 );  // More than the `\0`
+}
+
+
+/// Look for `/service[:path]`, `/servicestreams:N` and `/serviceseconds:N`
+/// on the command line.  The shared-memory options are parsed by
+/// #dtmfShmParseCommandLine.
+///
+/// @param pwszCmdLine The command line passed to #wWinMain
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL dtmfServiceParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine ) {
+   /// #### Function
+
+   sbEnabled = false;
+
+   if ( pwszCmdLine == NULL ) {
+      return TRUE;
+   }
+
+   if ( !dtmfShmParseCommandLine( pwszCmdLine ) ) {
+      return FALSE;  // dtmfShmParseCommandLine logged the problem
+   }
+
+   bool bFound = false;
+
+   if ( !dtmfServiceParsePath( pwszCmdLine, L"/service", swsSocket, _countof( swsSocket ), &bFound ) ) {
+      RETURN_FATAL( IDS_DTMF_SERVICE_INVALID_OPTION );  // "A /service option is not valid.  Exiting."
+   }
+
+   if ( !dtmfServiceParseNumber( pwszCmdLine, L"/serviceseconds:", &su32Seconds ) ) {
+      RETURN_FATAL( IDS_DTMF_SERVICE_INVALID_OPTION );  // "A /service option is not valid.  Exiting."
+   }
+
+   if ( !bFound ) {
+      return TRUE;
+   }
+
+   if ( !dtmfServiceParseNumber( pwszCmdLine, L"/servicestreams:", &su32Streams )
+     || su32Streams == 0
+     || su32Streams > DTMF_SERVICE_MAX_STREAMS ) {
+      RETURN_FATAL( IDS_DTMF_SERVICE_INVALID_OPTION );  // "A /service option is not valid.  Exiting."
+   }
+
+   sbEnabled = true;
+
+   return TRUE;
+}
+
+
+/// @return `true` if the command line asked for the service (over sockets,
+///         shared memory or both)
+bool dtmfServiceIsEnabled() {
+   return sbEnabled || dtmfShmIsEnabled();
+}
+
+
+/// Send an event to a stream's client.  This never blocks.  If the client
+/// isn't reading its events, the event is dropped.
+///
+/// @param pStream The stream
+/// @param u32Type A #dtmfServiceEventType_t
+/// @param key     The key
+/// @return `TRUE` if the stream is still good.  `FALSE` if it should be closed.
+static BOOL dtmfServiceSendEvent( _In_ dtmfServiceStream_t* pStream, _In_ const UINT32 u32Type, _In_ const WCHAR key ) {
+   dtmfServiceEvent_t event;
+
+   event.u32Magic    = DTMF_SERVICE_MAGIC;
+   event.u32Type     = u32Type;
+   event.u64Position = pStream->u64Position;
+   event.u32Key      = (UINT32) key;
+   event.u32Reserved = 0;
+
+   int iSent = send( pStream->socket, (const char*) &event, (int) sizeof( event ), 0 );
+
+   if ( iSent == (int) sizeof( event ) ) {
+      InterlockedIncrement64( &sStats.l64EventsSent );
+      return TRUE;
+   }
+
+   if ( iSent == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK ) {
+      InterlockedIncrement64( &sStats.l64EventsDropped );
+      return TRUE;
+   }
+
+   return FALSE;  // A partial event (or an error) breaks the stream
+}
+
+
+/// Decode the bytes a receive brought in
+///
+/// @param pStream The stream
+/// @param stBytes The number of bytes in #dtmfServiceStream_t.recvBuffer
+/// @return `TRUE` if the stream is still good.  `FALSE` if it should be closed.
+static BOOL dtmfServiceDecode( _In_ dtmfServiceStream_t* pStream, _In_ const size_t stBytes ) {
+   const BYTE* pBytes   = pStream->recvBuffer;
+   size_t      stLength = stBytes;
+
+   /// - Finish the hello first
+   if ( pStream->stHelloBytes < sizeof( dtmfServiceHello_t ) ) {
+      size_t stCopy = sizeof( dtmfServiceHello_t ) - pStream->stHelloBytes;
+      stCopy = ( stCopy < stLength ) ? stCopy : stLength;
+
+      CopyMemory( (BYTE*) &pStream->hello + pStream->stHelloBytes, pBytes, stCopy );
+      pStream->stHelloBytes += stCopy;
+      pBytes                += stCopy;
+      stLength              -= stCopy;
+
+      if ( pStream->stHelloBytes < sizeof( dtmfServiceHello_t ) ) {
+         return TRUE;  // Wait for the rest of it
+      }
+
+      if ( pStream->hello.u32Magic   != DTMF_SERVICE_MAGIC
+        || pStream->hello.u32Version != DTMF_SERVICE_VERSION
+        || pStream->hello.u32Format  >= G711_LAW_COUNT
+        || ( pStream->pDecoder = goertzelSlabAttach( &sNodes[ pStream->stNode ].slab, (int) pStream->hello.u32SampleRate ) ) == NULL ) {
+         InterlockedIncrement64( &sStats.l64Rejected );
+         dtmfServiceSendEvent( pStream, DTMF_SERVICE_EVENT_REJECTED, L'\0' );
+         return FALSE;
+      }
+
+      pStream->stHop = pStream->hello.u32SampleRate / 100;
+   }
+
+   /// - Then run the samples through the stream's decoder a hop at a time
+   ///   (G.711 is expanded as it's written to the window).  Every #stHop
+   ///   samples, analyze the window and report any change in the key.
+   while ( stLength > 0 ) {
+      size_t stRun = pStream->stHop - pStream->stSinceAnalysis;
+      stRun = ( stRun < stLength ) ? stRun : stLength;
+
+      goertzelContextWrite( pStream->pDecoder, (g711Law_t) pStream->hello.u32Format, pBytes, stRun );
+
+      pBytes                   += stRun;
+      stLength                 -= stRun;
+      pStream->u64Position     += stRun;
+      pStream->stSinceAnalysis += stRun;
+
+      if ( pStream->stSinceAnalysis < pStream->stHop ) {
+         break;
+      }
+      pStream->stSinceAnalysis = 0;
+
+      goertzelContextAnalyze( pStream->pDecoder );
+
+      const WCHAR key = goertzelDecodeKey( pStream->pDecoder->tones );
+      if ( key == pStream->currentKey ) {
+         continue;
+      }
+
+      if ( pStream->currentKey != L'\0' && !dtmfServiceSendEvent( pStream, DTMF_SERVICE_EVENT_KEY_UP, pStream->currentKey ) ) {
+         return FALSE;
+      }
+      if ( key != L'\0' && !dtmfServiceSendEvent( pStream, DTMF_SERVICE_EVENT_KEY_DOWN, key ) ) {
+         return FALSE;
+      }
+
+      pStream->currentKey = key;
+   }
+
+   return TRUE;
+}
+
+
+/// Post a stream's next receive
+///
+/// @param pStream The stream
+/// @return `TRUE` if successful.  `FALSE` if the stream should be closed.
+static BOOL dtmfServicePostReceive( _In_ dtmfServiceStream_t* pStream ) {
+   DWORD dwFlags = 0;
+
+   ZeroMemory( &pStream->overlapped, sizeof( OVERLAPPED ) );
+
+   int iResult = WSARecv( pStream->socket, &pStream->wsaBuf, 1, NULL, &dwFlags, &pStream->overlapped, NULL );
+   if ( iResult == SOCKET_ERROR && WSAGetLastError() != WSA_IO_PENDING ) {
+      return FALSE;
+   }
+
+   return TRUE;  // The completion port gets the result (even if it finished now)
+}
+
+
+/// Close a stream, detach its decoder and put it back in its node's pool
+///
+/// @param pStream The stream
+static void dtmfServiceClose( _In_ dtmfServiceStream_t* pStream ) {
+   closesocket( pStream->socket );
+   pStream->socket = INVALID_SOCKET;
+
+   if ( pStream->pDecoder != NULL ) {
+      goertzelSlabDetach( &sNodes[ pStream->stNode ].slab, pStream->pDecoder );
+      pStream->pDecoder = NULL;
+   }
+
+   InterlockedDecrement64( &sStats.l64Active );
+   InterlockedDecrement64( &sNodes[ pStream->stNode ].l64Active );
+   InterlockedPushEntrySList( &sNodes[ pStream->stNode ].pool, &pStream->entry );
+}
+
+
+/// A worker thread.  Pinned to its node, it decodes the node's completed
+/// receives until it gets #DTMF_SERVICE_KEY_STOP.
+///
+/// @param pParam The worker's node
+/// @return `0`
+static DWORD WINAPI dtmfServiceWorkerThread( _In_ LPVOID pParam ) {
+   const size_t stNode = (size_t) (UINT_PTR) pParam;
+   const HANDLE hCompletionPort = sNodes[ stNode ].hCompletionPort;
+
+   const DWORD_PTR dwpOldAffinity = numaPlacePin( stNode );
+
+   for ( ;; ) {
+      DWORD       dwBytes     = 0;
+      ULONG_PTR   completionKey = 0;
+      OVERLAPPED* pOverlapped = NULL;
+
+      BOOL br = GetQueuedCompletionStatus( hCompletionPort, &dwBytes, &completionKey, &pOverlapped, INFINITE );
+
+      if ( pOverlapped == NULL ) {
+         if ( completionKey == DTMF_SERVICE_KEY_STOP ) {
+            break;
+         }
+         continue;  // The port failed without a stream.  Nothing to clean up.
+      }
+
+      dtmfServiceStream_t* pStream = CONTAINING_RECORD( pOverlapped, dtmfServiceStream_t, overlapped );
+
+      /// - A failed receive or `0` bytes means the client is gone
+      if ( !br || dwBytes == 0 || sbStopping ) {
+         if ( !sbStopping ) {
+            dtmfServiceClose( pStream );
+         }
+         continue;  // When stopping, #dtmfServiceRun closes the streams
+      }
+
+      InterlockedAdd64( &sStats.l64Bytes, dwBytes );
+
+      if ( !dtmfServiceDecode( pStream, dwBytes ) || !dtmfServicePostReceive( pStream ) ) {
+         dtmfServiceClose( pStream );
+      }
+   }
+
+   if ( dwpOldAffinity != 0 ) {
+      SetThreadAffinityMask( GetCurrentThread(), dwpOldAffinity );
+   }
+
+   logTraceReleaseRing();
+   logFlightReleaseRing();
+
+   return 0;
+}
+
+
+/// The accept thread.  It gives each new connection a stream from the
+/// least busy node's pool and posts its first receive.  It ends when
+/// #dtmfServiceRun closes #sListenSocket.
+///
+/// @param pParam Not used
+/// @return `0`
+static DWORD WINAPI dtmfServiceAcceptThread( _In_ LPVOID pParam ) {
+   UNREFERENCED_PARAMETER( pParam );
+
+   while ( !sbStopping ) {
+      SOCKET client = accept( sListenSocket, NULL, NULL );
+      if ( client == INVALID_SOCKET ) {
+         if ( !sbStopping ) {
+            LOG_WARN_R( IDS_DTMF_SERVICE_FAILED_TO_ACCEPT, WSAGetLastError() );  // "The service failed to accept a connection.  Error: %d"
+            Sleep( 100 );  // Don't spin if the error doesn't go away
+         }
+         continue;
+      }
+
+      /// - Balance the nodes:  Take a stream from the node with the fewest
+      ///   active streams.  If its pool is empty, try the others.  If they're
+      ///   all empty, refuse the connection.
+      size_t stBest = 0;
+      for ( size_t i = 1 ; i < sstNodes ; i++ ) {
+         if ( sNodes[ i ].l64Active < sNodes[ stBest ].l64Active ) {
+            stBest = i;
+         }
+      }
+
+      dtmfServiceStream_t* pStream = NULL;
+      for ( size_t i = 0 ; i < sstNodes && pStream == NULL ; i++ ) {
+         pStream = (dtmfServiceStream_t*) InterlockedPopEntrySList( &sNodes[ ( stBest + i ) % sstNodes ].pool );
+      }
+
+      if ( pStream == NULL ) {
+         InterlockedIncrement64( &sStats.l64Refused );
+         closesocket( client );
+         continue;
+      }
+
+      pStream->socket          = client;
+      pStream->wsaBuf.buf      = (CHAR*) pStream->recvBuffer;
+      pStream->wsaBuf.len      = DTMF_SERVICE_RECV_BUFFER;
+      pStream->stHelloBytes    = 0;
+      pStream->stHop           = 0;
+      pStream->stSinceAnalysis = 0;
+      pStream->u64Position     = 0;
+      pStream->currentKey      = L'\0';
+
+      InterlockedIncrement64( &sStats.l64Active );
+      InterlockedIncrement64( &sStats.l64Accepted );
+      InterlockedIncrement64( &sNodes[ pStream->stNode ].l64Active );
+
+      /// - Make sends non-blocking (receives are overlapped, so this doesn't
+      ///   change them) and attach the socket to its node's completion port
+      u_long ulNonBlocking = 1;
+      if ( ioctlsocket( client, FIONBIO, &ulNonBlocking ) != 0
+        || CreateIoCompletionPort( (HANDLE) client, sNodes[ pStream->stNode ].hCompletionPort, 0, 0 ) == NULL
+        || !dtmfServicePostReceive( pStream ) ) {
+         dtmfServiceClose( pStream );
+      }
+   }
+
+   logTraceReleaseRing();
+   logFlightReleaseRing();
+
+   return 0;
+}
+
+
+/// Get the process' CPU time
+///
+/// @return The kernel and user time of this process (in 100ns ticks)
+static UINT64 dtmfServiceCpuTicks() {
+   FILETIME ftCreation, ftExit, ftKernel, ftUser;
+
+   if ( !GetProcessTimes( GetCurrentProcess(), &ftCreation, &ftExit, &ftKernel, &ftUser ) ) {
+      return 0;
+   }
+
+   return ( (UINT64) ftKernel.dwHighDateTime << 32 | ftKernel.dwLowDateTime )
+        + ( (UINT64) ftUser.dwHighDateTime   << 32 | ftUser.dwLowDateTime );
+}
+
+
+/// Log the statistics
+///
+/// @param cpuPct The CPU used since the last time (as a percent of one core)
+static void dtmfServiceLogStats( _In_ const double cpuPct ) {
+   LOG_INFO_R( IDS_DTMF_SERVICE_STATS, sStats.l64Active, sStats.l64Accepted, sStats.l64Refused, sStats.l64Rejected, (double) sStats.l64Bytes / 1.0e6, sStats.l64EventsSent, sStats.l64EventsDropped, cpuPct );  // "Service:  Active: %lld   Accepted: %lld   Refused: %lld   Rejected: %lld   Received: %.1f MB   Events: %lld   Dropped: %lld   CPU: %.1f%%"
+}
+
+
+/// Stop the socket threads, close every stream and release everything.  This
+/// is safe to call at any point in #dtmfServiceStartSockets.
+static void dtmfServiceCleanup() {
+   sbStopping = true;
+
+   /// - Closing the listening socket wakes the accept thread
+   if ( sListenSocket != INVALID_SOCKET ) {
+      closesocket( sListenSocket );
+      sListenSocket = INVALID_SOCKET;
+   }
+
+   if ( shAcceptThread != NULL ) {
+      WaitForSingleObject( shAcceptThread, INFINITE );
+      CloseHandle( shAcceptThread );
+      shAcceptThread = NULL;
+   }
+
+   /// - Tell each worker to end
+   for ( size_t n = 0 ; n < sstNodes ; n++ ) {
+      for ( size_t i = 0 ; i < sNodes[ n ].stWorkers ; i++ ) {
+         PostQueuedCompletionStatus( sNodes[ n ].hCompletionPort, 0, DTMF_SERVICE_KEY_STOP, NULL );
+      }
+      sNodes[ n ].stWorkers = 0;
+   }
+
+   for ( size_t i = 0 ; i < sstWorkers ; i++ ) {
+      WaitForSingleObject( shWorkerThreads[ i ], INFINITE );
+      CloseHandle( shWorkerThreads[ i ] );
+      shWorkerThreads[ i ] = NULL;
+   }
+   sstWorkers = 0;
+
+   /// - Close the streams that are still connected, then drain the canceled
+   ///   receives from each port before the streams are freed
+   for ( size_t n = 0 ; n < sstNodes ; n++ ) {
+      dtmfServiceNode_t* pNode = &sNodes[ n ];
+
+      for ( size_t i = 0 ; pNode->pStreams != NULL && i < pNode->stStreams ; i++ ) {
+         if ( pNode->pStreams[ i ].socket != INVALID_SOCKET ) {
+            closesocket( pNode->pStreams[ i ].socket );
+            pNode->pStreams[ i ].socket = INVALID_SOCKET;
+         }
+      }
+
+      if ( pNode->hCompletionPort != NULL ) {
+         DWORD       dwBytes;
+         ULONG_PTR   completionKey;
+         OVERLAPPED* pOverlapped;
+
+         while ( GetQueuedCompletionStatus( pNode->hCompletionPort, &dwBytes, &completionKey, &pOverlapped, 100 ) || pOverlapped != NULL ) {
+            // Discard it
+         }
+
+         CloseHandle( pNode->hCompletionPort );
+         pNode->hCompletionPort = NULL;
+      }
+
+      numaPlaceFree( pNode->pStreams );
+      pNode->pStreams  = NULL;
+      pNode->stStreams = 0;
+
+      goertzelSlabRelease( &pNode->slab );
+   }
+   sstNodes = 0;
+
+   WSACleanup();
+}
+
+
+/// Start the socket service:  The stream pool, the listening socket, the
+/// completion port and its threads
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+static BOOL dtmfServiceStartSockets() {
+   _ASSERTE( sbEnabled );
+
+   WSADATA wsaData;
+   if ( WSAStartup( MAKEWORD( 2, 2 ), &wsaData ) != 0 ) {
+      RETURN_FATAL( IDS_DTMF_SERVICE_FAILED_TO_START_WINSOCK );  // "Failed to start Winsock.  Exiting."
+   }
+
+   sbStopping = false;
+   ZeroMemory( (void*) &sStats, sizeof( sStats ) );
+
+   /// - Split the streams evenly over the nodes.  Allocate each node's
+   ///   streams on the node and put them in its pool.
+   sstNodes = numaPlaceNodes();
+   sstNodes = ( sstNodes < su32Streams ) ? sstNodes : su32Streams;
+
+   static_assert( sizeof( dtmfServiceStream_t ) % MEMORY_ALLOCATION_ALIGNMENT == 0, "The streams must stay aligned for the SLIST" );
+
+   for ( size_t n = 0 ; n < sstNodes ; n++ ) {
+      dtmfServiceNode_t* pNode = &sNodes[ n ];
+
+      pNode->stStreams       = su32Streams / sstNodes + ( ( n < su32Streams % sstNodes ) ? 1 : 0 );
+      pNode->stWorkers       = 0;
+      pNode->hCompletionPort = NULL;
+      pNode->l64Active       = 0;
+      goertzelSlabInit( &pNode->slab, n );
+      pNode->pStreams        = (dtmfServiceStream_t*) numaPlaceAlloc( n, pNode->stStreams * sizeof( dtmfServiceStream_t ) );
+      if ( pNode->pStreams == NULL ) {
+         dtmfServiceCleanup();
+         RETURN_FATAL( IDS_DTMF_SERVICE_FAILED_TO_ALLOCATE, (size_t) su32Streams );  // "Failed to allocate %zu streams for the service.  Exiting."
+      }
+
+      InitializeSListHead( &pNode->pool );
+      for ( size_t i = pNode->stStreams ; i > 0 ; i-- ) {
+         pNode->pStreams[ i - 1 ].socket = INVALID_SOCKET;
+         pNode->pStreams[ i - 1 ].stNode = n;
+         pNode->pStreams[ i - 1 ].pDecoder = NULL;
+         InterlockedPushEntrySList( &pNode->pool, &pNode->pStreams[ i - 1 ].entry );
+      }
+   }
+
+   /// - Bind the socket.  A stale socket file from an earlier run would make
+   ///   `bind` fail, so delete it first.
+   SOCKADDR_UN address;
+   if ( !dtmfServiceAddress( swsSocket, &address ) ) {
+      dtmfServiceCleanup();
+      RETURN_FATAL( IDS_DTMF_SERVICE_INVALID_OPTION );  // "A /service option is not valid.  Exiting."
+   }
+
+   DeleteFileW( swsSocket );
+
+   sListenSocket = socket( AF_UNIX, SOCK_STREAM, 0 );
+   if ( sListenSocket == INVALID_SOCKET
+     || bind( sListenSocket, (const SOCKADDR*) &address, (int) sizeof( address ) ) != 0
+     || listen( sListenSocket, SOMAXCONN ) != 0 ) {
+      const int iError = WSAGetLastError();
+      dtmfServiceCleanup();
+      RETURN_FATAL( IDS_DTMF_SERVICE_FAILED_TO_LISTEN, swsSocket, iError );  // "The service failed to listen on [%s].  Error: %d.  Exiting."
+   }
+
+   /// - Start a worker per processor (dealt round-robin over the nodes), a
+   ///   completion port per node and the accept thread
+   SYSTEM_INFO systemInfo;
+   GetSystemInfo( &systemInfo );
+
+   size_t stWorkers = systemInfo.dwNumberOfProcessors;
+   stWorkers = ( stWorkers < DTMF_SERVICE_MAX_WORKERS ) ? stWorkers : DTMF_SERVICE_MAX_WORKERS;
+   stWorkers = ( stWorkers > sstNodes ) ? stWorkers : sstNodes;  // At least one on every node
+
+   for ( size_t i = 0 ; i < stWorkers ; i++ ) {
+      sNodes[ i % sstNodes ].stWorkers++;
+   }
+
+   for ( size_t n = 0 ; n < sstNodes ; n++ ) {
+      sNodes[ n ].hCompletionPort = CreateIoCompletionPort( INVALID_HANDLE_VALUE, NULL, 0, (DWORD) sNodes[ n ].stWorkers );
+      if ( sNodes[ n ].hCompletionPort == NULL ) {
+         dtmfServiceCleanup();
+         RETURN_FATAL( IDS_DTMF_SERVICE_FAILED_TO_START_THREADS );  // "Failed to start the service's threads.  Exiting."
+      }
+   }
+
+   for ( sstWorkers = 0 ; sstWorkers < stWorkers ; sstWorkers++ ) {
+      shWorkerThreads[ sstWorkers ] = CreateThread( NULL, 0, dtmfServiceWorkerThread, (LPVOID) (UINT_PTR) ( sstWorkers % sstNodes ), 0, NULL );
+      if ( shWorkerThreads[ sstWorkers ] == NULL ) {
+         dtmfServiceCleanup();
+         RETURN_FATAL( IDS_DTMF_SERVICE_FAILED_TO_START_THREADS );  // "Failed to start the service's threads.  Exiting."
+      }
+   }
+
+   shAcceptThread = CreateThread( NULL, 0, dtmfServiceAcceptThread, NULL, 0, NULL );
+   if ( shAcceptThread == NULL ) {
+      dtmfServiceCleanup();
+      RETURN_FATAL( IDS_DTMF_SERVICE_FAILED_TO_START_THREADS );  // "Failed to start the service's threads.  Exiting."
+   }
+
+   LOG_INFO_R( IDS_DTMF_SERVICE_ENABLED, swsSocket, (size_t) su32Streams, sstWorkers, sstNodes );  // "The decoding service is listening on [%s] with %zu streams and %zu workers on %zu NUMA nodes"
+
+   return TRUE;
+}
+
+
+/// Run the service until `/serviceseconds` have passed (or forever)
+///
+/// This runs on the main thread instead of the window.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL dtmfServiceRun() {
+   _ASSERTE( dtmfServiceIsEnabled() );
+
+   /// #### Function
+
+   /// - Start the socket service and/or shared-memory ingestion
+   if ( sbEnabled && !dtmfServiceStartSockets() ) {
+      return FALSE;  // dtmfServiceStartSockets logged the problem
+   }
+
+   if ( dtmfShmIsEnabled() && !dtmfShmStart() ) {
+      if ( sbEnabled ) {
+         dtmfServiceCleanup();
+      }
+      return FALSE;  // dtmfShmStart logged the problem
+   }
+
+   /// - Log the statistics until it's time to stop
+   const ULONGLONG ullStart   = GetTickCount64();
+   ULONGLONG       ullLast    = ullStart;
+   UINT64          u64LastCpu = dtmfServiceCpuTicks();
+
+   while ( su32Seconds == 0 || GetTickCount64() - ullStart < (ULONGLONG) su32Seconds * 1000 ) {
+      ULONGLONG ullWait = DTMF_SERVICE_STATS_MS;
+      if ( su32Seconds != 0 ) {
+         const ULONGLONG ullLeft = (ULONGLONG) su32Seconds * 1000 - ( GetTickCount64() - ullStart );
+         ullWait = ( ullLeft < ullWait ) ? ullLeft : ullWait;
+      }
+
+      Sleep( (DWORD) ullWait );
+
+      const ULONGLONG ullNow = GetTickCount64();
+      const UINT64    u64Cpu = dtmfServiceCpuTicks();
+
+      // CPU ticks are 100ns and wall ticks are 1ms
+      double cpuPct = ( ullNow > ullLast ) ? (double) ( u64Cpu - u64LastCpu ) / 100.0 / (double) ( ullNow - ullLast ) : 0.0;
+
+      if ( sbEnabled ) {
+         dtmfServiceLogStats( cpuPct );
+      }
+      if ( dtmfShmIsEnabled() ) {
+         dtmfShmLogStats( cpuPct );
+      }
+
+      ullLast    = ullNow;
+      u64LastCpu = u64Cpu;
+   }
+
+   if ( dtmfShmIsEnabled() ) {
+      dtmfShmStop();
+   }
+   if ( sbEnabled ) {
+      dtmfServiceCleanup();
+   }
+
+   return TRUE;
+}
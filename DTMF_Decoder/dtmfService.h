@@ -0,0 +1,70 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// A headless service that decodes many PCM streams at once over Unix domain
+/// sockets
+///
+/// #### The Protocol
+/// A client connects to the service's socket and sends a
+/// #dtmfServiceHello_t followed by 8-bit, mono samples (unsigned PCM or
+/// G.711, see #dtmfServiceHello_t.u32Format) for as long as it likes.  The service sends back a #dtmfServiceEvent_t whenever
+/// a key starts or ends.  Everything is little-endian.
+///
+/// @file    dtmfService.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>  // For BOOL, UINT32, etc.
+#include <winsock2.h> // For SOCKET
+#include <afunix.h>   // For SOCKADDR_UN
+
+
+/// The first 4 bytes of every message (`DTMF` in ASCII)
+#define DTMF_SERVICE_MAGIC   (0x464D5444)
+
+/// The version of the protocol
+#define DTMF_SERVICE_VERSION (1)
+
+/// The socket when `/service` or `/loadgen` doesn't name one
+#define DTMF_SERVICE_DEFAULT_SOCKET L"DTMF_Decoder.sock"
+
+
+/// The first thing a client sends
+typedef struct {
+   UINT32 u32Magic;       ///< #DTMF_SERVICE_MAGIC
+   UINT32 u32Version;     ///< #DTMF_SERVICE_VERSION
+   UINT32 u32SampleRate;  ///< Samples per second (up to #GOERTZEL_CONTEXT_MAX_RATE)
+   UINT32 u32Format;      ///< A #g711Law_t.  `0` (#G711_LINEAR) is unsigned PCM.
+} dtmfServiceHello_t;
+
+
+/// The events the service sends
+enum dtmfServiceEventType_t {
+   DTMF_SERVICE_EVENT_KEY_DOWN = 1,  ///< A key started
+   DTMF_SERVICE_EVENT_KEY_UP,        ///< The key ended
+   DTMF_SERVICE_EVENT_REJECTED       ///< The hello wasn't valid.  The service closes the stream.
+};
+
+
+/// An event from the service
+typedef struct {
+   UINT32 u32Magic;     ///< #DTMF_SERVICE_MAGIC
+   UINT32 u32Type;      ///< A #dtmfServiceEventType_t
+   UINT64 u64Position;  ///< The number of samples (after the hello) the service had when it found the change
+   UINT32 u32Key;       ///< The key (a `WCHAR` from #DTMF_CORPUS_KEYS)
+   UINT32 u32Reserved;  ///< `0`
+} dtmfServiceEvent_t;
+
+
+extern BOOL dtmfServiceParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine );
+extern bool dtmfServiceIsEnabled();
+extern BOOL dtmfServiceRun();
+
+extern BOOL dtmfServiceParsePath( _In_z_ const PCWSTR pwszCmdLine, _In_z_ const PCWSTR pwszOption, _Out_writes_z_( stPath ) WCHAR* pwszPath, _In_ const size_t stPath, _Out_ bool* pbFound );
+extern BOOL dtmfServiceParseNumber( _In_z_ const PCWSTR pwszCmdLine, _In_z_ const PCWSTR pwszOption, _Inout_ UINT32* pu32Value );
+extern BOOL dtmfServiceAddress( _In_z_ const PCWSTR pwszPath, _Out_ SOCKADDR_UN* pAddress );
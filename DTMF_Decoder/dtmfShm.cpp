@@ -0,0 +1,724 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Shared-memory PCM ingestion for the decoding service
+///
+/// The socket service in dtmfService.cpp costs a system call and a copy for
+/// every buffer in each direction.  When the producer is on the same machine,
+/// it can write its samples straight into a ring in a shared segment instead:
+///
+///     DTMF_Decoder.exe /serviceshm[:"Local\DTMF_Decoder"] [/serviceshmstreams:1024]
+///
+/// (`/service` and `/serviceshm` can run at the same time.)
+///
+/// The layout of the segment is in dtmfShm.h.  A producer:
+///   1. Attaches with #dtmfShmAttach and claims a stream with
+///      #dtmfShmOpenStream
+///   2. Gets a pointer to the free part of its ring with #dtmfShmReserve,
+///      writes (or renders) samples directly into it and publishes them with
+///      #dtmfShmCommit
+///   3. Reads key events with #dtmfShmReadEvent
+///   4. Gives the stream back with #dtmfShmCloseStream
+///
+/// The service's decoder threads (one per processor) each own every Nth
+/// stream.  They run #goertzelContextAnalyzeRing directly on the ring --
+/// the samples are never copied.  A thread keeps #dtmfShmStream_t.l64Tail at
+/// the start of the next window it will analyze, so the producer can't
+/// overwrite a window that hasn't been analyzed yet.  If the ring is full,
+/// #dtmfShmReserve returns `0` and the producer tries again later.
+///
+/// The decoder threads are dealt over the NUMA nodes and pinned to them.
+/// Each thread's streams (the service's private state, not the rings) are
+/// allocated on its node (see numaPlace.cpp).
+///
+/// When a decoder thread runs out of work, it raises its doorbell and waits
+/// on its wake event.  A producer only calls `SetEvent` when it finds the
+/// doorbell raised, so a busy service is fed without any system calls.
+///
+/// A producer that ends without calling #dtmfShmCloseStream leaves its
+/// stream open until the service restarts.
+///
+/// ## Shared Memory API
+/// | API                   | Link                                                                                                  |
+/// |-----------------------| ------------------------------------------------------------------------------------------------------|
+/// | `CreateFileMappingW`  | https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-createfilemappingw         |
+/// | `OpenFileMappingW`    | https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-openfilemappingw           |
+/// | `MapViewOfFile`       | https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-mapviewoffile              |
+/// | `UnmapViewOfFile`     | https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-unmapviewoffile            |
+/// | `CreateEventW`        | https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-createeventw                 |
+/// | `OpenEventW`          | https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-openeventw                   |
+/// | `MemoryBarrier`       | https://learn.microsoft.com/en-us/windows/win32/api/winnt/nf-winnt-memorybarrier                      |
+///
+/// @file    dtmfShm.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <stdio.h>        // For swprintf_s
+
+#include "mvcModel.h"     // For dtmfTones_t
+#include "goertzel.h"     // For goertzelContext_t
+#include "g711.h"         // For g711Expand
+#include "numaPlace.h"    // For the NUMA placement layer
+#include "logTrace.h"     // For logTraceReleaseRing
+#include "logFlight.h"    // For logFlightReleaseRing
+#include "dtmfService.h"  // For the events and the option parsers
+#include "dtmfShm.h"      // For yo bad self
+
+
+/// The default number of streams in the segment
+#define DTMF_SHM_DEFAULT_STREAMS (1024)
+
+/// The most streams `/serviceshmstreams` can ask for
+#define DTMF_SHM_MAX_STREAMS     (16384)
+
+/// The size of each stream's PCM ring (in bytes).  Must be a power of 2 and
+/// at least twice the largest window.
+#define DTMF_SHM_RING_BYTES      (65536)
+
+/// How long a decoder thread sleeps when there's no work and nobody rings
+/// its doorbell (in milliseconds)
+#define DTMF_SHM_IDLE_MS         (100)
+
+
+static_assert( ( DTMF_SHM_RING_BYTES & ( DTMF_SHM_RING_BYTES - 1 ) ) == 0, "DTMF_SHM_RING_BYTES must be a power of 2" );
+static_assert( DTMF_SHM_RING_BYTES >= 2 * GOERTZEL_CONTEXT_WINDOW( GOERTZEL_CONTEXT_MAX_RATE ), "DTMF_SHM_RING_BYTES must hold 2 windows" );
+static_assert( ( DTMF_SHM_EVENT_DEPTH & ( DTMF_SHM_EVENT_DEPTH - 1 ) ) == 0, "DTMF_SHM_EVENT_DEPTH must be a power of 2" );
+
+
+/// The service's private state for a stream (it's not in the segment, so a
+/// producer can't corrupt it)
+typedef struct {
+   UINT32            u32Generation;  ///< The #dtmfShmStream_t.u32Generation this was set up for.  `0` if it hasn't been.
+   bool              bReady;         ///< `true` if the stream is being decoded
+   size_t            stHop;          ///< Samples between analyses (10ms)
+   g711Law_t         law;            ///< How the producer encodes the samples
+   UINT64            u64Position;    ///< The samples analyzed so far
+   WCHAR             currentKey;     ///< The key that's down (or `L'\0'`)
+   goertzelContext_t decoder;        ///< The coefficients and the results.  It has no window of its own.
+} dtmfShmDecoder_t;
+
+
+static bool   sbEnabled = false;                          ///< `true` if `/serviceshm` is on the command line
+static WCHAR  swsName[ MAX_PATH ] = DTMF_SHM_DEFAULT_NAME;  ///< The segment's name
+static UINT32 su32Streams = DTMF_SHM_DEFAULT_STREAMS;     ///< The number of streams (for the service)
+
+static HANDLE           shMapping = NULL;                 ///< The segment
+static BYTE*            spBase    = NULL;                 ///< The segment, mapped
+static dtmfShmHeader_t* spHeader  = NULL;                 ///< The segment's header
+static dtmfShmStream_t* spStreams = NULL;                 ///< The segment's streams
+static BYTE*            spRings   = NULL;                 ///< The segment's PCM rings
+static HANDLE           shWakeEvents[ DTMF_SHM_MAX_THREADS ] = { NULL };  ///< Each decoder thread's wake event
+
+static volatile bool    sbStopping = false;               ///< `true` when the service is shutting down
+static HANDLE           shThreads[ DTMF_SHM_MAX_THREADS ] = { NULL };     ///< The decoder threads
+static dtmfShmDecoder_t* spDecoders[ DTMF_SHM_MAX_THREADS ] = { NULL };  ///< The service's state for each thread's streams (on the thread's node).  Stream `i` is `spDecoders[ i % threads ][ i / threads ]`.
+
+static volatile LONG64 sl64Active        = 0;             ///< Streams being decoded
+static volatile LONG64 sl64Decoded       = 0;             ///< Samples analyzed
+static volatile LONG64 sl64EventsSent    = 0;             ///< Events written to the event rings
+static volatile LONG64 sl64EventsDropped = 0;             ///< Events dropped because an event ring was full
+
+
+/// Look for `/serviceshm[:name]` and `/serviceshmstreams:N` on the command
+/// line.  Called by #dtmfServiceParseCommandLine.
+///
+/// @param pwszCmdLine The command line passed to #wWinMain
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL dtmfShmParseCommandLine( _In_z_ const PCWSTR pwszCmdLine ) {
+   sbEnabled = false;
+
+   bool bFound = false;
+
+   if ( !dtmfServiceParsePath( pwszCmdLine, L"/serviceshm", swsName, _countof( swsName ), &bFound ) ) {
+      RETURN_FATAL( IDS_DTMF_SHM_INVALID_OPTION );  // "A /serviceshm option is not valid.  Exiting."
+   }
+
+   if ( !bFound ) {
+      return TRUE;
+   }
+
+   if ( !dtmfServiceParseNumber( pwszCmdLine, L"/serviceshmstreams:", &su32Streams )
+     || su32Streams == 0
+     || su32Streams > DTMF_SHM_MAX_STREAMS ) {
+      RETURN_FATAL( IDS_DTMF_SHM_INVALID_OPTION );  // "A /serviceshm option is not valid.  Exiting."
+   }
+
+   sbEnabled = true;
+
+   return TRUE;
+}
+
+
+/// @return `true` if the command line asked for shared-memory ingestion
+bool dtmfShmIsEnabled() {
+   return sbEnabled;
+}
+
+
+/// Make the name of a decoder thread's wake event
+///
+/// @param pwszEvent Gets the name
+/// @param stEvent   The size of #pwszEvent (in characters)
+/// @param pwszName  The segment's name
+/// @param stThread  The decoder thread
+static void dtmfShmWakeEventName(
+   _Out_writes_z_( stEvent )       WCHAR* pwszEvent,
+   _In_                      const size_t stEvent,
+   _In_z_                    const PCWSTR pwszName,
+   _In_                      const size_t stThread ) {
+   swprintf_s( pwszEvent, stEvent, L"%s.wake.%zu", pwszName, stThread );
+}
+
+
+/// Ring a decoder thread's doorbell, but only if it's asleep
+///
+/// Inlined for performance.
+///
+/// @param stThread The decoder thread
+__forceinline static void dtmfShmRingDoorbell( _In_ const size_t stThread ) {
+   dtmfShmDoorbell_t* pDoorbell = &spHeader->doorbells[ stThread ];
+
+   if ( pDoorbell->lSleeping && InterlockedExchange( &pDoorbell->lSleeping, 0 ) == 1 ) {
+      InterlockedIncrement64( &pDoorbell->l64Wakeups );
+      SetEvent( shWakeEvents[ stThread ] );
+   }
+}
+
+
+/// Write an event to a stream's event ring.  If the producer isn't reading
+/// its events, the event is dropped.
+///
+/// @param pShared  The stream
+/// @param pDecoder The service's state for the stream
+/// @param u32Type  A #dtmfServiceEventType_t
+/// @param key      The key
+static void dtmfShmPutEvent(
+   _Inout_       dtmfShmStream_t*  pShared,
+   _In_    const dtmfShmDecoder_t* pDecoder,
+   _In_    const UINT32            u32Type,
+   _In_    const WCHAR             key ) {
+
+   const LONG64 l64Head = pShared->l64EventHead;
+
+   if ( l64Head - pShared->l64EventTail >= DTMF_SHM_EVENT_DEPTH ) {
+      pShared->l64EventsDropped += 1;
+      InterlockedIncrement64( &sl64EventsDropped );
+      return;
+   }
+
+   dtmfServiceEvent_t* pEvent = &pShared->events[ l64Head & ( DTMF_SHM_EVENT_DEPTH - 1 ) ];
+
+   pEvent->u32Magic    = DTMF_SERVICE_MAGIC;
+   pEvent->u32Type     = u32Type;
+   pEvent->u64Position = pDecoder->u64Position;
+   pEvent->u32Key      = (UINT32) key;
+   pEvent->u32Reserved = 0;
+
+   pShared->l64EventHead = l64Head + 1;  // A volatile write has release semantics in MSVC
+
+   InterlockedIncrement64( &sl64EventsSent );
+}
+
+
+/// Decode everything a producer has written to a stream
+///
+/// @param stStream The stream
+/// @return The number of samples analyzed (or `1` if the stream changed
+///         state), so the caller knows there was work
+static UINT64 dtmfShmDecodeStream( _In_ const size_t stStream ) {
+   dtmfShmStream_t*  pShared  = &spStreams[ stStream ];
+   dtmfShmDecoder_t* pDecoder = &spDecoders[ stStream % spHeader->u32Threads ][ stStream / spHeader->u32Threads ];
+
+   const LONG lState = pShared->lState;
+
+   /// - Free a stream the producer is done with
+   if ( lState == DTMF_SHM_CLOSING ) {
+      if ( pDecoder->bReady ) {
+         InterlockedDecrement64( &sl64Active );
+      }
+      pDecoder->bReady = false;
+      InterlockedExchange( &pShared->lState, DTMF_SHM_FREE );
+      return 1;
+   }
+
+   if ( lState != DTMF_SHM_OPEN ) {
+      return 0;
+   }
+
+   /// - Set up a stream that was just opened.  If its sample rate isn't
+   ///   supported, reject it.
+   if ( pDecoder->u32Generation != pShared->u32Generation ) {
+      pDecoder->u32Generation = pShared->u32Generation;
+      pDecoder->u64Position   = 0;
+      pDecoder->currentKey    = L'\0';
+      pDecoder->law           = (g711Law_t) pShared->u32Format;
+      pDecoder->bReady        = pShared->u32Format < G711_LAW_COUNT
+                             && goertzelContextInit( &pDecoder->decoder, (int) pShared->u32SampleRate, NULL ) != FALSE;
+
+      if ( !pDecoder->bReady ) {
+         dtmfShmPutEvent( pShared, pDecoder, DTMF_SERVICE_EVENT_REJECTED, L'\0' );
+         return 1;
+      }
+
+      pDecoder->stHop = pShared->u32SampleRate / 100;
+      InterlockedIncrement64( &sl64Active );
+   }
+
+   if ( !pDecoder->bReady ) {
+      return 0;
+   }
+
+   /// - Analyze the ring in place, one hop at a time
+   const UINT64 u64Head   = (UINT64) pShared->l64Head;  // A volatile read has acquire semantics in MSVC
+   const UINT64 u64Window = pDecoder->decoder.stWindowSize;
+   BYTE*        pRing     = spRings + stStream * DTMF_SHM_RING_BYTES;
+   UINT64       u64Analyzed = 0;
+
+   while ( pDecoder->u64Position + pDecoder->stHop <= u64Head ) {
+      /// - Expand a G.711 hop in place.  The producer doesn't touch it again
+      ///   and the service owns it until it moves the tail past it.
+      if ( pDecoder->law != G711_LINEAR ) {
+         const size_t stOffset = (size_t) ( pDecoder->u64Position & ( DTMF_SHM_RING_BYTES - 1 ) );
+         size_t       stFirst  = DTMF_SHM_RING_BYTES - stOffset;
+         stFirst = ( stFirst < pDecoder->stHop ) ? stFirst : pDecoder->stHop;
+
+         g711Expand( pDecoder->law, pRing + stOffset, pRing + stOffset, stFirst );
+         g711Expand( pDecoder->law, pRing, pRing, pDecoder->stHop - stFirst );
+      }
+
+      pDecoder->u64Position += pDecoder->stHop;
+      u64Analyzed           += pDecoder->stHop;
+
+      if ( pDecoder->u64Position < u64Window ) {
+         continue;  // Wait for a whole window
+      }
+
+      goertzelContextAnalyzeRing( &pDecoder->decoder, pRing, DTMF_SHM_RING_BYTES, pDecoder->u64Position );
+
+      const WCHAR key = goertzelDecodeKey( pDecoder->decoder.tones );
+      if ( key == pDecoder->currentKey ) {
+         continue;
+      }
+
+      if ( pDecoder->currentKey != L'\0' ) {
+         dtmfShmPutEvent( pShared, pDecoder, DTMF_SERVICE_EVENT_KEY_UP, pDecoder->currentKey );
+      }
+      if ( key != L'\0' ) {
+         dtmfShmPutEvent( pShared, pDecoder, DTMF_SERVICE_EVENT_KEY_DOWN, key );
+      }
+
+      pDecoder->currentKey = key;
+   }
+
+   /// - Give the producer back everything before the next window
+   if ( u64Analyzed > 0 ) {
+      const UINT64 u64NextStart = pDecoder->u64Position + pDecoder->stHop;
+      pShared->l64Tail = (LONG64) ( ( u64NextStart > u64Window ) ? u64NextStart - u64Window : 0 );
+   }
+
+   return u64Analyzed;
+}
+
+
+/// A decoder thread.  Pinned to its node, it decodes every
+/// #dtmfShmHeader_t.u32Threads'th stream until the service stops.
+///
+/// @param pParam The thread's number
+/// @return `0`
+static DWORD WINAPI dtmfShmDecoderThread( _In_ LPVOID pParam ) {
+   const size_t stThread  = (size_t) (UINT_PTR) pParam;
+   const size_t stThreads = spHeader->u32Threads;
+
+   dtmfShmDoorbell_t* pDoorbell = &spHeader->doorbells[ stThread ];
+
+   const DWORD_PTR dwpOldAffinity = numaPlacePin( numaPlaceWorkerNode( stThread ) );
+
+   while ( !sbStopping ) {
+      UINT64 u64Work = 0;
+      for ( size_t i = stThread ; i < su32Streams ; i += stThreads ) {
+         u64Work += dtmfShmDecodeStream( i );
+      }
+
+      if ( u64Work > 0 ) {
+         InterlockedAdd64( &sl64Decoded, (LONG64) u64Work );
+         continue;
+      }
+
+      /// - Out of work.  Raise the doorbell, then look once more (a producer
+      ///   may have committed just before it saw the doorbell) before
+      ///   sleeping.
+      pDoorbell->lSleeping = 1;
+      MemoryBarrier();
+
+      for ( size_t i = stThread ; i < su32Streams ; i += stThreads ) {
+         u64Work += dtmfShmDecodeStream( i );
+      }
+
+      if ( u64Work == 0 ) {
+         WaitForSingleObject( shWakeEvents[ stThread ], DTMF_SHM_IDLE_MS );
+      } else {
+         InterlockedAdd64( &sl64Decoded, (LONG64) u64Work );
+      }
+
+      pDoorbell->lSleeping = 0;
+   }
+
+   if ( dwpOldAffinity != 0 ) {
+      SetThreadAffinityMask( GetCurrentThread(), dwpOldAffinity );
+   }
+
+   logTraceReleaseRing();
+   logFlightReleaseRing();
+
+   return 0;
+}
+
+
+/// Create the segment and start the decoder threads
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL dtmfShmStart() {
+   _ASSERTE( sbEnabled );
+   _ASSERTE( spBase == NULL );
+
+   /// #### Function
+
+   sbStopping        = false;
+   sl64Active        = 0;
+   sl64Decoded       = 0;
+   sl64EventsSent    = 0;
+   sl64EventsDropped = 0;
+
+   /// - Lay out the segment:  The header, the streams, then the rings (on a
+   ///   page boundary)
+   const size_t stStreamsOffset = ( sizeof( dtmfShmHeader_t ) + SYSTEM_CACHE_ALIGNMENT_SIZE - 1 ) / SYSTEM_CACHE_ALIGNMENT_SIZE * SYSTEM_CACHE_ALIGNMENT_SIZE;
+   const UINT64 u64RingsOffset  = ( stStreamsOffset + (UINT64) su32Streams * sizeof( dtmfShmStream_t ) + 4095 ) / 4096 * 4096;
+   const UINT64 u64Size         = u64RingsOffset + (UINT64) su32Streams * DTMF_SHM_RING_BYTES;
+
+   /// - Create the segment (backed by the paging file).  If it already
+   ///   exists, another service owns it.
+   shMapping = CreateFileMappingW( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD) ( u64Size >> 32 ), (DWORD) u64Size, swsName );
+   if ( shMapping == NULL || GetLastError() == ERROR_ALREADY_EXISTS ) {
+      const DWORD dwError = GetLastError();
+      dtmfShmStop();
+      RETURN_FATAL( IDS_DTMF_SHM_FAILED_TO_CREATE, swsName, dwError );  // "Failed to create the shared memory segment [%s].  Error: %u.  Exiting."
+   }
+
+   spBase = (BYTE*) MapViewOfFile( shMapping, FILE_MAP_ALL_ACCESS, 0, 0, 0 );
+   if ( spBase == NULL ) {
+      const DWORD dwError = GetLastError();
+      dtmfShmStop();
+      RETURN_FATAL( IDS_DTMF_SHM_FAILED_TO_CREATE, swsName, dwError );  // "Failed to create the shared memory segment [%s].  Error: %u.  Exiting."
+   }
+
+   spHeader  = (dtmfShmHeader_t*) spBase;
+   spStreams = (dtmfShmStream_t*) ( spBase + stStreamsOffset );
+   spRings   = spBase + u64RingsOffset;
+
+   /// - Start a decoder thread per processor, each with its own wake event
+   SYSTEM_INFO systemInfo;
+   GetSystemInfo( &systemInfo );
+
+   size_t stThreads = systemInfo.dwNumberOfProcessors;
+   stThreads = ( stThreads < DTMF_SHM_MAX_THREADS ) ? stThreads : DTMF_SHM_MAX_THREADS;
+   stThreads = ( stThreads < su32Streams ) ? stThreads : su32Streams;
+
+   /// - The service's state for each stream lives in its own memory, on the
+   ///   node of the thread that decodes it
+   const size_t stPerThread = ( su32Streams + stThreads - 1 ) / stThreads;
+
+   for ( size_t i = 0 ; i < stThreads ; i++ ) {
+      spDecoders[ i ] = (dtmfShmDecoder_t*) numaPlaceAlloc( numaPlaceWorkerNode( i ), stPerThread * sizeof( dtmfShmDecoder_t ) );
+      if ( spDecoders[ i ] == NULL ) {
+         dtmfShmStop();
+         RETURN_FATAL( IDS_DTMF_SERVICE_FAILED_TO_ALLOCATE, (size_t) su32Streams );  // "Failed to allocate %zu streams for the service.  Exiting."
+      }
+   }
+
+   // The segment's pages start out zeroed, so every stream is DTMF_SHM_FREE
+   spHeader->u32Version       = DTMF_SHM_VERSION;
+   spHeader->u32Streams       = su32Streams;
+   spHeader->u32RingBytes     = DTMF_SHM_RING_BYTES;
+   spHeader->u32Threads       = (UINT32) stThreads;
+   spHeader->u32StreamsOffset = (UINT32) stStreamsOffset;
+   spHeader->u32ServicePid    = GetCurrentProcessId();
+   spHeader->u64RingsOffset   = u64RingsOffset;
+
+   for ( size_t i = 0 ; i < stThreads ; i++ ) {
+      WCHAR wsEvent[ MAX_PATH + 32 ];
+      dtmfShmWakeEventName( wsEvent, _countof( wsEvent ), swsName, i );
+
+      shWakeEvents[ i ] = CreateEventW( NULL, FALSE, FALSE, wsEvent );
+      if ( shWakeEvents[ i ] == NULL ) {
+         dtmfShmStop();
+         RETURN_FATAL( IDS_DTMF_SERVICE_FAILED_TO_START_THREADS );  // "Failed to start the service's threads.  Exiting."
+      }
+   }
+
+   for ( size_t i = 0 ; i < stThreads ; i++ ) {
+      shThreads[ i ] = CreateThread( NULL, 0, dtmfShmDecoderThread, (LPVOID) (UINT_PTR) i, 0, NULL );
+      if ( shThreads[ i ] == NULL ) {
+         dtmfShmStop();
+         RETURN_FATAL( IDS_DTMF_SERVICE_FAILED_TO_START_THREADS );  // "Failed to start the service's threads.  Exiting."
+      }
+   }
+
+   /// - Write the magic number last, so producers can't attach to a
+   ///   half-built segment
+   spHeader->u32Magic = DTMF_SHM_MAGIC;
+
+   LOG_INFO_R( IDS_DTMF_SHM_ENABLED, swsName, (size_t) su32Streams, stThreads, u64Size / ( 1024 * 1024 ) );  // "Shared memory ingestion on [%s] with %zu streams and %zu decoder threads (%llu MB)"
+
+   return TRUE;
+}
+
+
+/// @return The number of times producers woke a decoder thread
+LONG64 dtmfShmWakeups() {
+   if ( spHeader == NULL ) {
+      return 0;
+   }
+
+   LONG64 l64Wakeups = 0;
+   for ( size_t i = 0 ; i < spHeader->u32Threads && i < DTMF_SHM_MAX_THREADS ; i++ ) {
+      l64Wakeups += spHeader->doorbells[ i ].l64Wakeups;
+   }
+
+   return l64Wakeups;
+}
+
+
+/// @return The service's process ID or `0` if the segment isn't attached
+DWORD dtmfShmServicePid() {
+   return ( spHeader != NULL ) ? spHeader->u32ServicePid : 0;
+}
+
+
+/// Log the shared-memory statistics
+///
+/// @param cpuPct The service's CPU since the last time (as a percent of one core)
+void dtmfShmLogStats( _In_ const double cpuPct ) {
+   LOG_INFO_R( IDS_DTMF_SHM_STATS, sl64Active, (double) sl64Decoded / 1.0e6, sl64EventsSent, sl64EventsDropped, dtmfShmWakeups(), cpuPct );  // "Shared memory:  Active: %lld   Decoded: %.1f Msamples   Events: %lld   Dropped: %lld   Wakeups: %lld   CPU: %.1f%%"
+}
+
+
+/// Stop the decoder threads and release the segment.  This is safe to call
+/// at any point in #dtmfShmStart and from a producer (after
+/// #dtmfShmAttach).
+void dtmfShmStop() {
+   sbStopping = true;
+
+   for ( size_t i = 0 ; i < DTMF_SHM_MAX_THREADS ; i++ ) {
+      if ( shThreads[ i ] != NULL ) {
+         SetEvent( shWakeEvents[ i ] );
+         WaitForSingleObject( shThreads[ i ], INFINITE );
+         CloseHandle( shThreads[ i ] );
+         shThreads[ i ] = NULL;
+      }
+   }
+
+   for ( size_t i = 0 ; i < DTMF_SHM_MAX_THREADS ; i++ ) {
+      if ( shWakeEvents[ i ] != NULL ) {
+         CloseHandle( shWakeEvents[ i ] );
+         shWakeEvents[ i ] = NULL;
+      }
+   }
+
+   if ( spBase != NULL ) {
+      UnmapViewOfFile( spBase );
+      spBase    = NULL;
+      spHeader  = NULL;
+      spStreams = NULL;
+      spRings   = NULL;
+   }
+
+   if ( shMapping != NULL ) {
+      CloseHandle( shMapping );
+      shMapping = NULL;
+   }
+
+   for ( size_t i = 0 ; i < DTMF_SHM_MAX_THREADS ; i++ ) {
+      numaPlaceFree( spDecoders[ i ] );
+      spDecoders[ i ] = NULL;
+   }
+}
+
+
+/// Attach a producer to the service's segment
+///
+/// @param pwszName The segment's name
+/// @return `TRUE` if successful.  `FALSE` if the service isn't running (the
+///         reason is logged).
+BOOL dtmfShmAttach( _In_z_ const PCWSTR pwszName ) {
+   _ASSERTE( spBase == NULL );
+
+   wcsncpy_s( swsName, _countof( swsName ), pwszName, _TRUNCATE );
+
+   shMapping = OpenFileMappingW( FILE_MAP_ALL_ACCESS, FALSE, swsName );
+   if ( shMapping != NULL ) {
+      spBase = (BYTE*) MapViewOfFile( shMapping, FILE_MAP_ALL_ACCESS, 0, 0, 0 );
+   }
+
+   if ( spBase == NULL ) {
+      LOG_WARN_R( IDS_DTMF_SHM_FAILED_TO_ATTACH, swsName, GetLastError() );  // "Failed to attach to the shared memory segment [%s].  Error: %u"
+      dtmfShmDetach();
+      return FALSE;
+   }
+
+   spHeader = (dtmfShmHeader_t*) spBase;
+
+   if ( spHeader->u32Magic != DTMF_SHM_MAGIC || spHeader->u32Version != DTMF_SHM_VERSION
+     || spHeader->u32RingBytes != DTMF_SHM_RING_BYTES || spHeader->u32Threads > DTMF_SHM_MAX_THREADS ) {
+      LOG_WARN_R( IDS_DTMF_SHM_FAILED_TO_ATTACH, swsName, (DWORD) ERROR_INVALID_DATA );  // "Failed to attach to the shared memory segment [%s].  Error: %u"
+      dtmfShmDetach();
+      return FALSE;
+   }
+
+   su32Streams = spHeader->u32Streams;
+   spStreams   = (dtmfShmStream_t*) ( spBase + spHeader->u32StreamsOffset );
+   spRings     = spBase + spHeader->u64RingsOffset;
+
+   /// - Open each decoder thread's wake event (just to ring it)
+   for ( size_t i = 0 ; i < spHeader->u32Threads ; i++ ) {
+      WCHAR wsEvent[ MAX_PATH + 32 ];
+      dtmfShmWakeEventName( wsEvent, _countof( wsEvent ), swsName, i );
+
+      shWakeEvents[ i ] = OpenEventW( EVENT_MODIFY_STATE, FALSE, wsEvent );
+      if ( shWakeEvents[ i ] == NULL ) {
+         LOG_WARN_R( IDS_DTMF_SHM_FAILED_TO_ATTACH, swsName, GetLastError() );  // "Failed to attach to the shared memory segment [%s].  Error: %u"
+         dtmfShmDetach();
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+
+/// Detach a producer from the segment
+void dtmfShmDetach() {
+   dtmfShmStop();  // A producer has no threads, so this just releases the segment
+}
+
+
+/// Claim a free stream and open it
+///
+/// @param u32SampleRate The stream's samples per second
+/// @param law           How the producer will encode the samples
+/// @return The stream or `-1` if they're all taken
+int dtmfShmOpenStream( _In_ const UINT32 u32SampleRate, _In_ const g711Law_t law ) {
+   _ASSERTE( spHeader != NULL );
+
+   for ( size_t i = 0 ; i < su32Streams ; i++ ) {
+      dtmfShmStream_t* pShared = &spStreams[ i ];
+
+      if ( pShared->lState != DTMF_SHM_FREE
+        || InterlockedCompareExchange( &pShared->lState, DTMF_SHM_CLAIMED, DTMF_SHM_FREE ) != DTMF_SHM_FREE ) {
+         continue;
+      }
+
+      pShared->l64Head          = 0;
+      pShared->l64Tail          = 0;
+      pShared->l64EventHead     = 0;
+      pShared->l64EventTail     = 0;
+      pShared->l64EventsDropped = 0;
+      pShared->u32SampleRate    = u32SampleRate;
+      pShared->u32Format        = (UINT32) law;
+      pShared->u32Generation   += 1;
+      if ( pShared->u32Generation == 0 ) {
+         pShared->u32Generation = 1;  // 0 means "never set up" to the service
+      }
+
+      pShared->lState = DTMF_SHM_OPEN;  // A volatile write has release semantics in MSVC
+
+      dtmfShmRingDoorbell( i % spHeader->u32Threads );
+
+      return (int) i;
+   }
+
+   return -1;
+}
+
+
+/// Give a stream back to the service
+///
+/// @param iStream The stream
+void dtmfShmCloseStream( _In_ const int iStream ) {
+   _ASSERTE( iStream >= 0 && (UINT32) iStream < su32Streams );
+
+   spStreams[ iStream ].lState = DTMF_SHM_CLOSING;
+
+   dtmfShmRingDoorbell( (size_t) iStream % spHeader->u32Threads );
+}
+
+
+/// Get the free part of a stream's ring.  The producer writes samples
+/// directly into it and then calls #dtmfShmCommit.
+///
+/// @param iStream   The stream
+/// @param ppSamples Gets where to write
+/// @return The number of samples that can be written there (`0` if the ring
+///         is full)
+size_t dtmfShmReserve( _In_ const int iStream, _Outptr_ BYTE** ppSamples ) {
+   _ASSERTE( iStream >= 0 && (UINT32) iStream < su32Streams );
+
+   const dtmfShmStream_t* pShared = &spStreams[ iStream ];
+
+   const UINT64 u64Head = (UINT64) pShared->l64Head;
+   const UINT64 u64Tail = (UINT64) pShared->l64Tail;  // A volatile read has acquire semantics in MSVC
+
+   const size_t stOffset = (size_t) ( u64Head & ( DTMF_SHM_RING_BYTES - 1 ) );
+   const size_t stFree   = DTMF_SHM_RING_BYTES - (size_t) ( u64Head - u64Tail );
+   const size_t stToEnd  = DTMF_SHM_RING_BYTES - stOffset;
+
+   *ppSamples = spRings + (size_t) iStream * DTMF_SHM_RING_BYTES + stOffset;
+
+   return ( stFree < stToEnd ) ? stFree : stToEnd;
+}
+
+
+/// Publish samples written after #dtmfShmReserve and wake the stream's
+/// decoder thread if it's asleep
+///
+/// @param iStream   The stream
+/// @param stSamples The number of samples written
+void dtmfShmCommit( _In_ const int iStream, _In_ const size_t stSamples ) {
+   _ASSERTE( iStream >= 0 && (UINT32) iStream < su32Streams );
+
+   dtmfShmStream_t* pShared = &spStreams[ iStream ];
+
+   pShared->l64Head = pShared->l64Head + (LONG64) stSamples;  // A volatile write has release semantics in MSVC
+
+   /// The new head must be visible before the doorbell is read, or the
+   /// decoder thread could go to sleep without seeing the samples
+   MemoryBarrier();
+
+   dtmfShmRingDoorbell( (size_t) iStream % spHeader->u32Threads );
+}
+
+
+/// Read the next event from a stream's event ring
+///
+/// @param iStream The stream
+/// @param pEvent  Gets the event
+/// @return `true` if there was an event
+bool dtmfShmReadEvent( _In_ const int iStream, _Out_ dtmfServiceEvent_t* pEvent ) {
+   _ASSERTE( iStream >= 0 && (UINT32) iStream < su32Streams );
+
+   dtmfShmStream_t* pShared = &spStreams[ iStream ];
+
+   const LONG64 l64Tail = pShared->l64EventTail;
+   if ( l64Tail == pShared->l64EventHead ) {
+      return false;
+   }
+
+   CopyMemory( pEvent, &pShared->events[ l64Tail & ( DTMF_SHM_EVENT_DEPTH - 1 ) ], sizeof( dtmfServiceEvent_t ) );
+
+   pShared->l64EventTail = l64Tail + 1;
+
+   return true;
+}
@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Shared-memory PCM ingestion for the decoding service
+///
+/// #### The Segment
+/// The service creates a named file mapping laid out as a
+/// #dtmfShmHeader_t, then an array of #dtmfShmStream_t, then one PCM ring per
+/// stream (each #dtmfShmHeader_t.u32RingBytes long).  Every ring is
+/// single-producer/single-consumer:  A producer process writes samples and
+/// advances #dtmfShmStream_t.l64Head.  The service reads them in place and
+/// advances #dtmfShmStream_t.l64Tail.  Events come back the same way, through
+/// each stream's #dtmfShmStream_t.events ring.
+///
+/// @file    dtmfShm.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>      // For BOOL, LONG64, etc.
+#include "dtmfService.h"  // For dtmfServiceEvent_t
+#include "g711.h"         // For g711Law_t
+
+
+/// The first 4 bytes of the segment (`DSHM` in ASCII)
+#define DTMF_SHM_MAGIC          (0x4D485344)
+
+/// The version of the segment's layout
+#define DTMF_SHM_VERSION        (2)
+
+/// The segment when `/serviceshm` or `/loadgenshm` doesn't name one.  The wake
+/// events are named `<segment>.wake.<thread>`.
+#define DTMF_SHM_DEFAULT_NAME   L"Local\\DTMF_Decoder"
+
+/// The number of events in each stream's event ring.  Must be a power of 2.
+#define DTMF_SHM_EVENT_DEPTH    (64)
+
+/// The most decoder threads
+#define DTMF_SHM_MAX_THREADS    (64)
+
+
+/// The states of a stream
+enum dtmfShmState_t {
+   DTMF_SHM_FREE = 0,  ///< Nobody has the stream
+   DTMF_SHM_CLAIMED,   ///< A producer is setting the stream up
+   DTMF_SHM_OPEN,      ///< The producer is writing and the service is decoding
+   DTMF_SHM_CLOSING    ///< The producer is done.  The service frees the stream.
+};
+
+
+/// A decoder thread's doorbell.  Producers only ring it (with `SetEvent`)
+/// when the thread is asleep, so a busy service costs no system calls.
+typedef struct DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) {
+   volatile LONG   lSleeping;   ///< `1` if the thread is waiting on its wake event
+   volatile LONG64 l64Wakeups;  ///< The number of times a producer woke it
+} dtmfShmDoorbell_t;
+
+
+/// The start of the segment
+typedef struct {
+   UINT32            u32Magic;                              ///< #DTMF_SHM_MAGIC
+   UINT32            u32Version;                            ///< #DTMF_SHM_VERSION
+   UINT32            u32Streams;                            ///< The number of streams
+   UINT32            u32RingBytes;                          ///< The size of each PCM ring.  A power of 2.
+   UINT32            u32Threads;                            ///< The number of decoder threads.  Stream `i` belongs to thread `i % u32Threads`.
+   UINT32            u32StreamsOffset;                      ///< Where the streams start (in bytes from the start of the segment)
+   UINT32            u32ServicePid;                         ///< The service's process ID (for the load generator's CPU)
+   UINT32            u32Reserved;                           ///< Keeps #u64RingsOffset aligned
+   UINT64            u64RingsOffset;                        ///< Where the rings start (in bytes from the start of the segment)
+   dtmfShmDoorbell_t doorbells[ DTMF_SHM_MAX_THREADS ];     ///< One per decoder thread
+} dtmfShmHeader_t;
+
+
+/// One stream's shared state.  The producer's, the service's and the
+/// client's indexes are on separate cache lines.
+typedef struct {
+   DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) volatile LONG64 l64Head;  ///< Samples the producer has written
+   volatile LONG      lState;                                              ///< A #dtmfShmState_t
+   UINT32             u32SampleRate;                                       ///< Samples per second (set before #DTMF_SHM_OPEN)
+   UINT32             u32Generation;                                       ///< Incremented each time the stream is claimed
+   UINT32             u32Format;                                           ///< A #g711Law_t (set before #DTMF_SHM_OPEN).  The service expands G.711 in place.
+   DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) volatile LONG64 l64Tail;  ///< The oldest sample the service still needs
+   volatile LONG64    l64EventHead;                                        ///< Events the service has written
+   volatile LONG64    l64EventsDropped;                                    ///< Events dropped because the event ring was full
+   DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) volatile LONG64 l64EventTail;  ///< Events the producer has read
+   dtmfServiceEvent_t events[ DTMF_SHM_EVENT_DEPTH ];                      ///< The event ring
+} dtmfShmStream_t;
+
+
+// The service
+extern BOOL dtmfShmParseCommandLine( _In_z_ const PCWSTR pwszCmdLine );
+extern bool dtmfShmIsEnabled();
+extern BOOL dtmfShmStart();
+extern void dtmfShmLogStats( _In_ const double cpuPct );
+extern void dtmfShmStop();
+
+// The producers
+extern BOOL   dtmfShmAttach( _In_z_ const PCWSTR pwszName );
+extern void   dtmfShmDetach();
+extern int    dtmfShmOpenStream( _In_ const UINT32 u32SampleRate, _In_ const g711Law_t law );
+extern void   dtmfShmCloseStream( _In_ const int iStream );
+extern size_t dtmfShmReserve( _In_ const int iStream, _Outptr_ BYTE** ppSamples );
+extern void   dtmfShmCommit( _In_ const int iStream, _In_ const size_t stSamples );
+extern bool   dtmfShmReadEvent( _In_ const int iStream, _Out_ dtmfServiceEvent_t* pEvent );
+extern LONG64 dtmfShmWakeups();
+extern DWORD  dtmfShmServicePid();
@@ -0,0 +1,321 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// G.711 mu-law and A-law input
+///
+/// Archived audio and live trunks are usually G.711:  8,000 companded bytes
+/// per second.  Rather than decoding them to 16-bit PCM and then converting
+/// that to 8-bit PCM (the way #processAudioFrame converts floats), each law
+/// has one 256-entry table that goes straight from a companded byte to the
+/// 8-bit PCM #gPcmQueue holds.  The tables are built by the compiler from
+/// the ITU-T G.711 formulas.
+///
+/// #g711Expand runs the table lookup 32 bytes at a time with AVX2 byte
+/// shuffles, so the expansion can be fused into the write to a window (see
+/// #pcmEnqueueG711 and #goertzelContextWrite).  A `vpshufb` only looks up 16
+/// entries, so:
+///
+///   - Both laws are sign-magnitude and the magnitude only depends on the low
+///     7 bits.  That leaves 128 entries:  8 rows of 16.
+///   - Each row is XORed with the one before it.  Subtracting 16 from the
+///     index after each row makes every row past the sample's row look up
+///     `0` (a `vpshufb` index with its high bit set), so XORing the lookups
+///     together gives the sample's row.
+///   - `vpsignb` puts the sign back.
+///
+/// That's 3 instructions per row, all in registers.  A `vpgatherdd` would
+/// need 4 gathers and 3 packs for 32 bytes.
+///
+/// ### APIs Used
+/// << Print Module API Documentation >>
+///
+/// @file    g711.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <immintrin.h>    // For the AVX2 intrinsics
+#include <wchar.h>        // For _wcsicmp
+
+#include "audio.h"        // For PCM_8_BIT_SILENCE
+#include "g711.h"         // For yo bad self
+
+
+/// The tables behind #gG711Expand and #gG711Compress
+typedef struct {
+   BYTE expand[ G711_LAW_COUNT ][ 256 ];    ///< See #gG711Expand
+   BYTE compress[ G711_LAW_COUNT ][ 256 ];  ///< See #gG711Compress
+} g711Tables_t;
+
+
+/// Decode a mu-law byte to 16-bit linear PCM (ITU-T G.711 table 2a)
+///
+/// @param code The mu-law byte
+/// @return The linear sample
+static constexpr INT16 g711_DecodeUlaw( _In_ const BYTE code ) {
+   const int iCode      = ~code & 0xFF;  // mu-law bytes are sent inverted
+   const int iMagnitude = ( ( ( ( iCode & 0x0F ) << 3 ) + 0x84 ) << ( ( iCode & 0x70 ) >> 4 ) ) - 0x84;
+
+   return (INT16) ( ( iCode & 0x80 ) ? -iMagnitude : iMagnitude );
+}
+
+
+/// Decode an A-law byte to 16-bit linear PCM (ITU-T G.711 table 1a)
+///
+/// @param code The A-law byte
+/// @return The linear sample
+static constexpr INT16 g711_DecodeAlaw( _In_ const BYTE code ) {
+   const int iCode    = code ^ 0x55;  // A-law bytes are sent with the even bits inverted
+   const int iSegment = ( iCode & 0x70 ) >> 4;
+
+   int iMagnitude = ( ( iCode & 0x0F ) << 4 ) + 8;
+   if ( iSegment > 0 ) {
+      iMagnitude = ( iMagnitude + 0x100 ) << ( iSegment - 1 );
+   }
+
+   return (INT16) ( ( iCode & 0x80 ) ? iMagnitude : -iMagnitude );
+}
+
+
+/// Encode 16-bit linear PCM as mu-law (truncating, like the ITU-T reference)
+///
+/// @param iLinear The linear sample
+/// @return The mu-law byte
+static constexpr BYTE g711_EncodeUlaw( _In_ const int iLinear ) {
+   int iBiased = ( ( iLinear < 0 ) ? -iLinear : iLinear ) + 0x84;
+   if ( iBiased > 0x7FFF ) {
+      iBiased = 0x7FFF;
+   }
+
+   int iExponent = 0;
+   while ( iExponent < 7 && ( iBiased >> ( iExponent + 8 ) ) != 0 ) {
+      iExponent++;
+   }
+
+   const int iMantissa = ( iBiased >> ( iExponent + 3 ) ) & 0x0F;
+
+   return (BYTE) ~( ( ( iLinear < 0 ) ? 0x80 : 0x00 ) | ( iExponent << 4 ) | iMantissa );
+}
+
+
+/// Encode 16-bit linear PCM as A-law (truncating, like the ITU-T reference)
+///
+/// @param iLinear The linear sample
+/// @return The A-law byte
+static constexpr BYTE g711_EncodeAlaw( _In_ const int iLinear ) {
+   int iMagnitude = ( iLinear < 0 ) ? -iLinear : iLinear;
+   if ( iMagnitude > 0x7FFF ) {
+      iMagnitude = 0x7FFF;
+   }
+
+   int iSegment = 0;
+   if ( iMagnitude >= 0x100 ) {
+      iSegment = 1;
+      while ( iSegment < 7 && ( iMagnitude >> ( iSegment + 8 ) ) != 0 ) {
+         iSegment++;
+      }
+   }
+
+   const int iMantissa = ( iMagnitude >> ( ( iSegment == 0 ) ? 4 : iSegment + 3 ) ) & 0x0F;
+
+   return (BYTE) ( ( ( ( iLinear < 0 ) ? 0x00 : 0x80 ) | ( iSegment << 4 ) | iMantissa ) ^ 0x55 );
+}
+
+
+/// Round 16-bit linear PCM to 8-bit PCM.  The magnitude is rounded (not the
+/// sample), so positive and negative samples are mirror images around
+/// #PCM_8_BIT_SILENCE.  #g711Expand counts on that.
+///
+/// @param iLinear The linear sample
+/// @return The 8-bit sample
+static constexpr BYTE g711_To8( _In_ const int iLinear ) {
+   int iMagnitude = ( ( ( iLinear < 0 ) ? -iLinear : iLinear ) + 128 ) >> 8;
+   if ( iMagnitude > PCM_8_BIT_SILENCE ) {
+      iMagnitude = PCM_8_BIT_SILENCE;
+   }
+
+   return (BYTE) ( ( iLinear < 0 ) ? PCM_8_BIT_SILENCE - iMagnitude : PCM_8_BIT_SILENCE + iMagnitude );
+}
+
+
+/// Build the tables (at compile time)
+///
+/// @return The tables
+static constexpr g711Tables_t g711_MakeTables() {
+   g711Tables_t tables = {};
+
+   for ( int i = 0 ; i < 256 ; i++ ) {
+      int iLinear = ( i - PCM_8_BIT_SILENCE ) * 256;
+      if ( iLinear > 0x7FFF ) {
+         iLinear = 0x7FFF;
+      }
+
+      tables.expand[ G711_LINEAR ][ i ]   = (BYTE) i;
+      tables.expand[ G711_ULAW ][ i ]     = g711_To8( g711_DecodeUlaw( (BYTE) i ) );
+      tables.expand[ G711_ALAW ][ i ]     = g711_To8( g711_DecodeAlaw( (BYTE) i ) );
+
+      tables.compress[ G711_LINEAR ][ i ] = (BYTE) i;
+      tables.compress[ G711_ULAW ][ i ]   = g711_EncodeUlaw( iLinear );
+      tables.compress[ G711_ALAW ][ i ]   = g711_EncodeAlaw( iLinear );
+   }
+
+   return tables;
+}
+
+
+/// The tables
+static constexpr g711Tables_t sTables = g711_MakeTables();
+
+const BYTE ( &gG711Expand )[ G711_LAW_COUNT ][ 256 ]   = sTables.expand;
+const BYTE ( &gG711Compress )[ G711_LAW_COUNT ][ 256 ] = sTables.compress;
+
+
+// A spot check of the tables against ITU-T G.711:  Both laws' zero codes
+// are silence and full scale is still full scale
+static_assert( sTables.expand[ G711_ULAW ][ 0xFF ] == PCM_8_BIT_SILENCE, "mu-law 0xFF must be silence" );
+static_assert( sTables.expand[ G711_ULAW ][ 0x7F ] == PCM_8_BIT_SILENCE, "mu-law 0x7F must be silence" );
+static_assert( sTables.expand[ G711_ALAW ][ 0xD5 ] == PCM_8_BIT_SILENCE, "A-law 0xD5 must be silence" );
+static_assert( sTables.expand[ G711_ULAW ][ 0x80 ] == PCM_8_BIT_SILENCE + 125, "mu-law 0x80 must be +32124" );
+static_assert( sTables.expand[ G711_ALAW ][ 0x2A ] == PCM_8_BIT_SILENCE - 126, "A-law 0x2A must be -32256" );
+static_assert( sTables.compress[ G711_ULAW ][ PCM_8_BIT_SILENCE ] == 0xFF, "8-bit silence must be mu-law 0xFF" );
+
+
+/// Read a law from a command line option's value
+///
+/// @param pwszValue `pcm`, `ulaw` or `alaw`
+/// @param pLaw      Gets the law
+/// @return `true` if #pwszValue is a law.  `false` if it isn't.
+bool g711ParseLaw( _In_z_ const PCWSTR pwszValue, _Out_ g711Law_t* pLaw ) {
+   for ( int i = 0 ; i < G711_LAW_COUNT ; i++ ) {
+      if ( _wcsicmp( pwszValue, g711LawName( (g711Law_t) i ) ) == 0 ) {
+         *pLaw = (g711Law_t) i;
+         return true;
+      }
+   }
+
+   *pLaw = G711_LINEAR;
+   return false;
+}
+
+
+/// @param law The law
+/// @return The law's name (for options and results)
+PCWSTR g711LawName( _In_ const g711Law_t law ) {
+   switch ( law ) {
+      case G711_LINEAR: return L"pcm";
+      case G711_ULAW:   return L"ulaw";
+      case G711_ALAW:   return L"alaw";
+      default:          return L"?";
+   }
+}
+
+
+/// Decode one byte to 16-bit linear PCM -- what a separate decoding tool
+/// would produce.  #g711Expand is the fast way to get to 8-bit PCM.
+///
+/// @param law  The law
+/// @param code The companded byte (or an 8-bit sample for #G711_LINEAR)
+/// @return The linear sample
+INT16 g711ToLinear16( _In_ const g711Law_t law, _In_ const BYTE code ) {
+   switch ( law ) {
+      case G711_ULAW: return g711_DecodeUlaw( code );
+      case G711_ALAW: return g711_DecodeAlaw( code );
+      default:        return (INT16) ( ( code > PCM_8_BIT_SILENCE + 127 ) ? 0x7FFF : ( code - PCM_8_BIT_SILENCE ) * 256 );
+   }
+}
+
+
+/// Expand companded bytes to 8-bit PCM.  #pIn and #pOut may be the same (to
+/// expand in place) but must not otherwise overlap.
+///
+/// @param law       The law (#G711_LINEAR just copies)
+/// @param pIn       The companded bytes
+/// @param pOut      Gets the 8-bit PCM
+/// @param stSamples The number of samples
+void g711Expand(
+   _In_                      const g711Law_t law,
+   _In_reads_( stSamples )   const BYTE*     pIn,
+   _Out_writes_( stSamples )       BYTE*     pOut,
+   _In_                      const size_t    stSamples ) {
+   _ASSERTE( law < G711_LAW_COUNT );
+
+   if ( law == G711_LINEAR ) {
+      if ( pIn != pOut ) {
+         CopyMemory( pOut, pIn, stSamples );
+      }
+      return;
+   }
+
+   const BYTE* pTable = sTables.expand[ law ];
+
+   /// #### Function
+
+   /// - Load the magnitudes of the positive half of the table (`0x80` to
+   ///   `0xFF`) as 8 rows of 16, each XORed with the row before it
+   const __m128i silence128 = _mm_set1_epi8( PCM_8_BIT_SILENCE );
+
+   __m256i rows[ 8 ];
+   __m128i previous = _mm_setzero_si128();
+
+   for ( size_t r = 0 ; r < 8 ; r++ ) {
+      const __m128i row = _mm_sub_epi8( _mm_loadu_si128( (const __m128i*) ( pTable + 0x80 + r * 16 ) ), silence128 );
+
+      rows[ r ] = _mm256_broadcastsi128_si256( _mm_xor_si128( row, previous ) );
+      previous  = row;
+   }
+
+   const __m256i lowBits = _mm256_set1_epi8( 0x7F );
+   const __m256i sixteen = _mm256_set1_epi8( 16 );
+   const __m256i one     = _mm256_set1_epi8( 1 );
+   const __m256i silence = _mm256_set1_epi8( PCM_8_BIT_SILENCE );
+
+   /// - Expand 32 samples at a time
+   size_t i = 0;
+
+   for ( ; i + 32 <= stSamples ; i += 32 ) {
+      const __m256i in = _mm256_loadu_si256( (const __m256i*) ( pIn + i ) );
+
+      __m256i index     = _mm256_and_si256( in, lowBits );
+      __m256i magnitude = _mm256_setzero_si256();
+
+      for ( size_t r = 0 ; r < 8 ; r++ ) {
+         magnitude = _mm256_xor_si256( magnitude, _mm256_shuffle_epi8( rows[ r ], index ) );
+         index     = _mm256_sub_epi8( index, sixteen );
+      }
+
+      // A set high bit is a positive sample.  vpsignb negates where the
+      // sample looks negative to it, so subtract from silence.
+      const __m256i out = _mm256_sub_epi8( silence, _mm256_sign_epi8( magnitude, _mm256_or_si256( in, one ) ) );
+
+      _mm256_storeu_si256( (__m256i*) ( pOut + i ), out );
+   }
+
+   /// - Look up the rest one at a time
+   for ( ; i < stSamples ; i++ ) {
+      pOut[ i ] = pTable[ pIn[ i ] ];
+   }
+}
+
+
+/// Compand 8-bit PCM.  #pIn and #pOut may be the same (to compand in place).
+///
+/// @param law       The law (#G711_LINEAR just copies)
+/// @param pIn       The 8-bit PCM
+/// @param pOut      Gets the companded bytes
+/// @param stSamples The number of samples
+void g711Compress(
+   _In_                      const g711Law_t law,
+   _In_reads_( stSamples )   const BYTE*     pIn,
+   _Out_writes_( stSamples )       BYTE*     pOut,
+   _In_                      const size_t    stSamples ) {
+   _ASSERTE( law < G711_LAW_COUNT );
+
+   const BYTE* pTable = sTables.compress[ law ];
+
+   for ( size_t i = 0 ; i < stSamples ; i++ ) {
+      pOut[ i ] = pTable[ pIn[ i ] ];
+   }
+}
@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// G.711 mu-law and A-law input.  Companded bytes are expanded straight into
+/// the 8-bit PCM that the Goertzel kernels read.
+///
+/// @file    g711.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>  // For BYTE, INT16, etc.
+
+
+/// How the bytes of an 8-bit stream are encoded.  The values go over the
+/// wire (see #dtmfServiceHello_t.u32Format), so don't renumber them.
+enum g711Law_t {
+   G711_LINEAR = 0,  ///< Not companded:  8-bit unsigned PCM where #PCM_8_BIT_SILENCE is silence
+   G711_ULAW   = 1,  ///< G.711 mu-law (North America and Japan)
+   G711_ALAW   = 2,  ///< G.711 A-law (everywhere else)
+   G711_LAW_COUNT    ///< The number of laws
+};
+
+
+/// Expand a companded byte to 8-bit PCM:  `gG711Expand[ law ][ code ]`.
+/// #G711_LINEAR's table does nothing.
+extern const BYTE ( &gG711Expand )[ G711_LAW_COUNT ][ 256 ];
+
+/// Compand 8-bit PCM:  `gG711Compress[ law ][ sample ]`.  #G711_LINEAR's
+/// table does nothing.
+extern const BYTE ( &gG711Compress )[ G711_LAW_COUNT ][ 256 ];
+
+
+extern bool   g711ParseLaw( _In_z_ const PCWSTR pwszValue, _Out_ g711Law_t* pLaw );
+extern PCWSTR g711LawName( _In_ const g711Law_t law );
+extern INT16  g711ToLinear16( _In_ const g711Law_t law, _In_ const BYTE code );
+
+extern void g711Expand( _In_ const g711Law_t law, _In_reads_( stSamples ) const BYTE* pIn, _Out_writes_( stSamples ) BYTE* pOut, _In_ const size_t stSamples );
+extern void g711Compress( _In_ const g711Law_t law, _In_reads_( stSamples ) const BYTE* pIn, _Out_writes_( stSamples ) BYTE* pOut, _In_ const size_t stSamples );
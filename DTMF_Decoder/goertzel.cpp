@@ -8,6 +8,10 @@
 /// a Goertzel algorithm for analyzing the energy in the 8 DTMF frquencies
 /// in an 8-bit PCM audio stream.
 ///
+/// Which kernel runs and how many threads share the 8 tones is in
+/// #gGoertzelTuning.  #goertzel_Start has #goertzelTuneRun pick it for the
+/// machine and the sample rate before it starts the threads.
+///
 /// @see https://github.com/Harvie/Programs/blob/master/c/goertzel/goertzel.c
 /// @see https://en.wikipedia.org/wiki/Goertzel_algorithm
 /// @see https://en.wikipedia.org/wiki/Fast_Fourier_transform
@@ -20,21 +24,32 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "framework.h"    // Standard system include files
-#include <avrt.h>         // For AvSetMmThreadCharacteristics()
 #include <stdio.h>        // For sprintf_s()
+#include <immintrin.h>    // For the SSE intrinsics
 
 /// _USE_MATH_DEFINES is for getting math defines in C++ (this is a .cpp file)
 #define _USE_MATH_DEFINES
 #include <math.h>         // For sinf() and cosf()
 
 #include "DTMF_Decoder.h" // For APP_NAME
+#include "audio.h"        // For PCM_8_BIT_SILENCE
 #include "mvcModel.h"     // For gPcmQueue and friends
+#include "perfCounters.h" // For perfCountersAdd
+#include "logTrace.h"     // For LOG_TRACE_B
+#include "logFlight.h"    // For logFlightReleaseRing
+#include "rtSched.h"      // For the real-time scheduling policy
+#include "dtmfCorpus.h"   // For DTMF_CORPUS_KEYS
+#include "g711.h"         // For g711Expand
+#include "goertzelTune.h" // For goertzelTuneRun
 #include "goertzel.h"     // For yo bad self
 
 
 /// A floating point version of PI
 #define M_PIF 3.141592653589793238462643383279502884e+00F
 
+/// The number of times #goertzelBenchmark runs each kernel over all 8 tones
+#define GOERTZEL_BENCHMARK_RUNS (1000)
+
 /// All of the DFT work threads wait to start on this handle.
 /// Declared external to support inlining.
 HANDLE ghStartDFTevent = NULL;
@@ -43,9 +58,26 @@ HANDLE ghStartDFTevent = NULL;
 /// Declared external to support inlining.
 HANDLE ghDoneDFTevents[ NUMBER_OF_DTMF_TONES ] = { NULL };
 
-/// Array of handles to the 8 work threads
+/// Array of handles to the work threads
 static HANDLE shWorkThreads[ NUMBER_OF_DTMF_TONES ] = { NULL };
 
+/// Each work thread's index (the threads get a pointer to theirs)
+static const int siWorkerIndex[ NUMBER_OF_DTMF_TONES ] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+
+/// The kernel, work threads and hop the DFT runs with.  Until
+/// #goertzelTuneRun picks one, it's the original configuration:  One thread
+/// per tone running the Assembly Language kernel (the C kernel in 32-bit
+/// builds) on every buffer.  Declared external to support inlining.
+goertzelTuning_t gGoertzelTuning = {
+   #ifdef _WIN64
+      GOERTZEL_KERNEL_ASM,
+   #else
+      GOERTZEL_KERNEL_C,
+   #endif
+   NUMBER_OF_DTMF_TONES,
+   0
+};
+
 extern "C" float sfScaleFactor = 0;  ///< Set in #goertzel_Start and used in #goertzel_Magnitude
 
 
@@ -54,6 +86,7 @@ extern "C" float sfScaleFactor = 0;  ///< Set in #goertzel_Start and used in #go
 
    extern "C" {
       void goertzel_Magnitude_x64( const UINT8 index, dtmfTones_t* toneStruct );
+      void goertzel_MagnitudeEnergy_x64( const UINT8 index, dtmfTones_t* toneStruct );
    };
 #else
    #pragma message( "Compiling 32-bit program" )
@@ -69,6 +102,9 @@ extern "C" float sfScaleFactor = 0;  ///< Set in #goertzel_Start and used in #go
 /// The original version of this algorithm came from:
 /// https://github.com/Harvie/Programs/blob/master/c/goertzel/goertzel.c
 ///
+/// The DFT threads use #goertzel_MagnitudeEnergy.  This version is kept as the
+/// baseline for #goertzelBenchmark.
+///
 /// Inlined for performance.
 ///
 /// @param index       The index into the DTMF tones array
@@ -101,40 +137,244 @@ __forceinline static void goertzel_Magnitude(
    real = ( q1 * toneStruct->cosine - q2 );
    imag = ( q1 * toneStruct->sine );
 
-   toneStruct->goertzelMagnitude = sqrtf( real * real + imag * imag ) / fScaleFactor;
+   toneStruct->goertzelMagnitude = sqrtf( real * real + imag * imag ) / sfScaleFactor;
 }
 #endif
 
 
-/// Runs each of the 8 DFT work threads
+/// Compute the Goertzel magnitude of 8-bit PCM data and the total energy of
+/// the window in the same pass
+///
+/// The sum-of-squares is accumulated as an integer (around #PCM_8_BIT_SILENCE)
+/// so it's exact and it runs on the integer units alongside the floating
+/// point Goertzel recurrence.  Computing it here saves a second trip through
+/// #gPcmQueue.
+///
+/// A sinusoid with amplitude `A` has a mean power of `A^2 / 2`, so
+/// #dtmfTones_t.energyRatio is the fraction of the window's power that's in
+/// this tone.
+///
+/// Inlined for performance.
+///
+/// @param index       The index into the DTMF tones array
+/// @param toneStruct  A pointer to #gDtmfTones (so it doesn't have to
+///                    re-compute the index each time
+__forceinline static void goertzel_MagnitudeEnergy(
+   _In_     const UINT8        index,
+   _Inout_        dtmfTones_t* toneStruct ) {
+
+   _ASSERTE( gstQueueHead < gstQueueSize );
+   _ASSERTE( gstQueueSize > 0 );
+
+   float real, imag;
+
+   float q1 = 0;
+   float q2 = 0;
+
+   UINT64 sumOfSquares = 0;
+
+   size_t queueRead = gstQueueHead;  // Thread safe way to point to the next available byte for reading
+
+   for ( size_t i = 0; i < gstQueueSize; i++ ) {
+      BYTE sample   = gPcmQueue[ queueRead++ ];
+      int  centered = (int) sample - PCM_8_BIT_SILENCE;
+
+      float q0 = toneStruct->coeff * q1 - q2 + ( (float) sample );
+      q2 = q1;
+      q1 = q0;
+
+      sumOfSquares += (UINT64) ( centered * centered );
+
+      if ( queueRead >= gstQueueSize ) { // Wrap around at the end of the queue
+         queueRead = 0;
+      }
+   }
+
+   // Calculate the real and imaginary results scaling appropriately
+   real = ( q1 * toneStruct->cosine - q2 );
+   imag = ( q1 * toneStruct->sine );
+
+   float magnitude = sqrtf( real * real + imag * imag ) / sfScaleFactor;
+   float energy    = (float) sumOfSquares / (float) gstQueueSize;
+
+   toneStruct->goertzelMagnitude = magnitude;
+   toneStruct->totalEnergy       = energy;
+   toneStruct->energyRatio       = ( energy > 0.0f ) ? ( magnitude * magnitude ) / ( 2.0f * energy ) : 0.0f;
+}
+
+
+/// Run the Goertzel recurrence for 4 tones at once over a contiguous run of
+/// #gPcmQueue.  Helper for #goertzel_MagnitudeEnergy_SIMD.
+///
+/// Inlined for performance.
+///
+/// @param pStart        The first sample
+/// @param pEnd          One past the last sample
+/// @param coeffLo       The coefficients for tones 0 - 3
+/// @param coeffHi       The coefficients for tones 4 - 7
+/// @param q1Lo,q2Lo     The state for tones 0 - 3
+/// @param q1Hi,q2Hi     The state for tones 4 - 7
+/// @param pSumOfSquares Accumulates the energy of the window
+__forceinline static void goertzel_SimdRun(
+   _In_    const BYTE*   pStart,
+   _In_    const BYTE*   pEnd,
+   _In_    const __m128  coeffLo,
+   _In_    const __m128  coeffHi,
+   _Inout_       __m128& q1Lo,
+   _Inout_       __m128& q2Lo,
+   _Inout_       __m128& q1Hi,
+   _Inout_       __m128& q2Hi,
+   _Inout_       UINT64* pSumOfSquares ) {
+
+   UINT64 sumOfSquares = *pSumOfSquares;
+
+   for ( const BYTE* p = pStart ; p < pEnd ; p++ ) {
+      int    centered = (int) *p - PCM_8_BIT_SILENCE;
+      __m128 sample   = _mm_set1_ps( (float) *p );
+
+      __m128 q0Lo = _mm_add_ps( _mm_sub_ps( _mm_mul_ps( coeffLo, q1Lo ), q2Lo ), sample );
+      __m128 q0Hi = _mm_add_ps( _mm_sub_ps( _mm_mul_ps( coeffHi, q1Hi ), q2Hi ), sample );
+      q2Lo = q1Lo;
+      q1Lo = q0Lo;
+      q2Hi = q1Hi;
+      q1Hi = q0Hi;
+
+      sumOfSquares += (UINT64) ( centered * centered );
+   }
+
+   *pSumOfSquares = sumOfSquares;
+}
+
+
+/// Compute the Goertzel magnitude and the window energy of all 8 tones in one
+/// pass over a window of PCM data using SSE.  The window is 2 contiguous runs
+/// (the second may be empty), so a circular buffer can be read in place.
+///
+/// The scalar kernels run one tone per pass (and one tone per thread).  This
+/// kernel puts the 8 recurrences side-by-side in 2 SSE registers, so it reads
+/// each sample once for all 8 tones.  It's meant to be run on one thread.
+///
+/// @param tones        The 8 tones to compute
+/// @param pRun1        The oldest sample in the window
+/// @param pEnd1        One past the end of the first run
+/// @param pRun2        The start of the second run
+/// @param pEnd2        One past the newest sample in the window
+/// @param fScaleFactor Scales the magnitude (like #sfScaleFactor)
+static void goertzel_SimdRuns(
+   _Inout_updates_( NUMBER_OF_DTMF_TONES ) dtmfTones_t* tones,
+   _In_                              const BYTE*        pRun1,
+   _In_                              const BYTE*        pEnd1,
+   _In_                              const BYTE*        pRun2,
+   _In_                              const BYTE*        pEnd2,
+   _In_                              const float        fScaleFactor ) {
+   const size_t stSize = (size_t) ( pEnd1 - pRun1 ) + (size_t) ( pEnd2 - pRun2 );
+   _ASSERTE( stSize > 0 );
+
+   __m128 coeffLo = _mm_setr_ps( tones[ 0 ].coeff, tones[ 1 ].coeff, tones[ 2 ].coeff, tones[ 3 ].coeff );
+   __m128 coeffHi = _mm_setr_ps( tones[ 4 ].coeff, tones[ 5 ].coeff, tones[ 6 ].coeff, tones[ 7 ].coeff );
+
+   __m128 q1Lo = _mm_setzero_ps();
+   __m128 q2Lo = _mm_setzero_ps();
+   __m128 q1Hi = _mm_setzero_ps();
+   __m128 q2Hi = _mm_setzero_ps();
+
+   UINT64 sumOfSquares = 0;
+
+   // Two contiguous runs, so there's no wrap test in the loop
+   goertzel_SimdRun( pRun1, pEnd1, coeffLo, coeffHi, q1Lo, q2Lo, q1Hi, q2Hi, &sumOfSquares );
+   goertzel_SimdRun( pRun2, pEnd2, coeffLo, coeffHi, q1Lo, q2Lo, q1Hi, q2Hi, &sumOfSquares );
+
+   float q1[ NUMBER_OF_DTMF_TONES ];
+   float q2[ NUMBER_OF_DTMF_TONES ];
+
+   _mm_storeu_ps( &q1[ 0 ], q1Lo );
+   _mm_storeu_ps( &q1[ 4 ], q1Hi );
+   _mm_storeu_ps( &q2[ 0 ], q2Lo );
+   _mm_storeu_ps( &q2[ 4 ], q2Hi );
+
+   float energy = (float) sumOfSquares / (float) stSize;
+
+   for ( size_t i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+      float real = ( q1[ i ] * tones[ i ].cosine - q2[ i ] );
+      float imag = ( q1[ i ] * tones[ i ].sine );
+
+      float magnitude = sqrtf( real * real + imag * imag ) / fScaleFactor;
+
+      tones[ i ].goertzelMagnitude = magnitude;
+      tones[ i ].totalEnergy       = energy;
+      tones[ i ].energyRatio       = ( energy > 0.0f ) ? ( magnitude * magnitude ) / ( 2.0f * energy ) : 0.0f;
+   }
+}
+
+
+/// Compute the Goertzel magnitude and the window energy of all 8 tones in one
+/// pass over a circular window of PCM data using SSE.  See #goertzel_SimdRuns.
+///
+/// @param tones        The 8 tones to compute
+/// @param pWindow      The window (like #gPcmQueue)
+/// @param stHead       The oldest sample in the window (like #gstQueueHead)
+/// @param stSize       The size of the window (like #gstQueueSize)
+/// @param fScaleFactor Scales the magnitude (like #sfScaleFactor)
+static void goertzel_SimdWindow(
+   _Inout_updates_( NUMBER_OF_DTMF_TONES ) dtmfTones_t* tones,
+   _In_reads_( stSize )              const BYTE*        pWindow,
+   _In_                              const size_t       stHead,
+   _In_                              const size_t       stSize,
+   _In_                              const float        fScaleFactor ) {
+   _ASSERTE( stHead < stSize );
+   _ASSERTE( stSize > 0 );
+
+   // Read from the head to the end of the queue, then wrap around
+   goertzel_SimdRuns( tones, pWindow + stHead, pWindow + stSize, pWindow, pWindow + stHead, fScaleFactor );
+}
+
+
+/// Compute the Goertzel magnitude and the window energy of all 8 tones in one
+/// pass over #gPcmQueue using SSE.  See #goertzel_SimdWindow.
+///
+/// @param tones  The 8 tones to compute (normally #gDtmfTones)
+static void goertzel_MagnitudeEnergy_SIMD( _Inout_updates_( NUMBER_OF_DTMF_TONES ) dtmfTones_t* tones ) {
+   _ASSERTE( gstQueueHead < gstQueueSize );
+   _ASSERTE( gstQueueSize > 0 );
+
+   goertzel_SimdWindow( tones, gPcmQueue, gstQueueHead, gstQueueSize, sfScaleFactor );
+}
+
+
+/// Runs each of the DFT work threads
 ///
 /// @see https://learn.microsoft.com/en-us/previous-versions/windows/desktop/legacy/ms686736(v=vs.85)
 ///
-/// @param pContext Holds the index of which tone this thread is responsibile
-///                 for values are `0` through `7`.  This is critical for
-///                 thread safety.
+/// @param pContext Holds the index of this thread (from #siWorkerIndex).
+///                 Values are `0` through `gGoertzelTuning.uWorkers - 1`.
+///                 Each thread has its own share of the tones.  This is
+///                 critical for thread safety.
 ///
 /// @return `0` if successful.  Non-`0` if there was a problem.
 DWORD WINAPI goertzelWorkThread( _In_ LPVOID pContext ) {
    _ASSERTE( pContext != NULL );
 
-   int    iIndex = *(int*) pContext;  // Comes to us as an int from #dtmfTones_t
+   int    iIndex = *(int*) pContext;  // Comes to us as an int from #siWorkerIndex
    size_t index  = iIndex;            // But we use it as an index into an array, so convert to `size_t`
 
-   _ASSERTE( iIndex < NUMBER_OF_DTMF_TONES );
+   _ASSERTE( gGoertzelTuning.uWorkers > 0 );
+   _ASSERTE( iIndex < (int) gGoertzelTuning.uWorkers );
+
+   /// The tones this thread computes
+   const size_t stFirstTone = index * NUMBER_OF_DTMF_TONES / gGoertzelTuning.uWorkers;
+   const size_t stLastTone  = ( index + 1 ) * NUMBER_OF_DTMF_TONES / gGoertzelTuning.uWorkers;
    _ASSERTE( ghStartDFTevent != NULL );
    _ASSERTE( ghDoneDFTevents[ index ]  != NULL );
 
    /// #### Function
 
-   LOG_TRACE_R( IDS_GOERTZEL_START, index );  // "Goertzel DFT thread: %zu   Starting."
+   LOG_TRACE_B( IDS_GOERTZEL_START, index );  // "Goertzel DFT thread: %zu   Starting."
 
-   HANDLE mmcssHandle = NULL;  // Local to the thread for safety
+   rtSchedThread_t rtThread;  // Local to the thread for safety
 
-   /// - Set the CPU priority for this thread with AvSetMmThreadCharacteristicsW
-   ///     - Uses the exported #gdwMmcssTaskIndex originally set in #audioStart
-   mmcssHandle = AvSetMmThreadCharacteristicsW( L"Capture", &gdwMmcssTaskIndex );
-   if ( mmcssHandle == NULL ) {
+   /// - Set the CPU priority (and any pinning) for this thread with
+   ///   #rtSchedEnter
+   if ( !rtSchedEnter( RT_SCHED_ROLE_DSP, index, &rtThread ) ) {
       LOG_WARN_R( IDS_GOERTZEL_FAILED_TO_SET_MMCSS, iIndex );  // "Goertzel DFT thread: %zu   Failed to set MMCSS on Goertzel work thread.  Continuing."
    }
    // LOG_INFO_R( IDS_GOERTZEL_SET_MMCSS, iIndex );  // "Goertzel DFT thread: %zu   Set MMCSS on Goertzel work thread."
@@ -147,19 +387,10 @@ DWORD WINAPI goertzelWorkThread( _In_ LPVOID pContext ) {
       ///   with WaitForSingleObject
       dwWaitResult = WaitForSingleObject( ghStartDFTevent, INFINITE);
       if ( dwWaitResult == WAIT_OBJECT_0 ) {
-         ///     - Compute the energy in given DTMF frequency using #goertzel_Magnitude
+         ///     - Compute the energy in this thread's DTMF frequencies and
+         ///       the total energy of the window with #goertzelAnalyzeTones
          if ( gbIsRunning ) {
-            #ifdef _WIN64
-               goertzel_Magnitude_x64( (UINT8) index, &gDtmfTones[index] );
-            #else
-              goertzel_Magnitude( iIndex, &gDtmfTones[index] );
-            #endif
-
-            if ( gDtmfTones[index].goertzelMagnitude >= GOERTZEL_MAGNITUDE_THRESHOLD ) {
-               mvcModelToggleToneDetectedStatus( index, true );
-            } else {
-               mvcModelToggleToneDetectedStatus( index, false );
-            }
+            goertzelAnalyzeTones( stFirstTone, stLastTone );
          }
       } else if ( dwWaitResult == WAIT_FAILED ) {
          QUEUE_FATAL( IDS_GOERTZEL_WAITFORSINGLEOBJECT_FAILED, iIndex );  // "WaitForSingleObject in Goertzel thread %zu failed.  Exiting.  Investigate!"
@@ -173,15 +404,16 @@ DWORD WINAPI goertzelWorkThread( _In_ LPVOID pContext ) {
    }
 
    /// - When the loop is done, restore the thread's priority with
-   ///   AvRevertMmThreadCharacteristics
-   if ( mmcssHandle != NULL ) {
-      if( !AvRevertMmThreadCharacteristics( mmcssHandle ) ) {
-         LOG_WARN_Q( IDS_GOERTZEL_FAILED_TO_REVERT_MMCSS, iIndex );  // "Goertzel DFT thread: %zu   Failed to revert MMCSS on Goertzel work thread.  Continuing."
-      }
-      mmcssHandle = NULL;
+   ///   #rtSchedLeave
+   if ( !rtSchedLeave( &rtThread ) ) {
+      LOG_WARN_Q( IDS_GOERTZEL_FAILED_TO_REVERT_MMCSS, iIndex );  // "Goertzel DFT thread: %zu   Failed to revert MMCSS on Goertzel work thread.  Continuing."
    }
 
-   LOG_TRACE_R( IDS_GOERTZEL_DONE, index );  // "Goertzel DFT thread: %zu   Done"
+   LOG_TRACE_B( IDS_GOERTZEL_DONE, index );  // "Goertzel DFT thread: %zu   Done"
+
+   perfCountersReleaseSlot();
+   logTraceReleaseRing();
+   logFlightReleaseRing();
 
    ExitThread( 0 );
 }
@@ -225,18 +457,42 @@ BOOL goertzel_Init() {
 }
 
 
-/// Start the DFT work threads
+/// Compute the sine, cosine and coeff of each tone for a window size and a
+/// sample rate
 ///
-/// @param  iSampleRate  Samples per second
-/// @return `TRUE` if successful.  `FALSE` if there was a problem.
-BOOL goertzel_Start( _In_ const int iSampleRate ) {
-   _ASSERTE( iSampleRate > 0 );
-   _ASSERTE( gstQueueSize > 0 );  // Set in #audioInit
-   _ASSERTE( ghStartDFTevent != NULL );
+/// @param tones       The 8 tones (their frequencies must be set)
+/// @param stWindow    The number of samples in the window
+/// @param iSampleRate Samples per second
+static void goertzel_ComputeCoefficients(
+   _Inout_updates_( NUMBER_OF_DTMF_TONES ) dtmfTones_t* tones,
+   _In_                              const size_t       stWindow,
+   _In_                              const int          iSampleRate ) {
 
    float floatSamplingRate = (float) iSampleRate;
+   float floatNumSamples   = (float) stWindow;
+
+   for ( int i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+      int   k      = (int) ( 0.5f + ( ( floatNumSamples * tones[ i ].frequency ) / (float) floatSamplingRate ) );
+      float omega  = ( 2.0f * M_PIF * k ) / floatNumSamples;
+
+      tones[ i ].sine   = sinf( omega );
+      tones[ i ].cosine = cosf( omega );
+      tones[ i ].coeff  = 2.0f * tones[ i ].cosine;
+   }
+}
 
-   float floatNumSamples = (float) gstQueueSize;
+
+/// Compute the values the Goertzel DFT needs for a sample rate and the
+/// current #gstQueueSize:  #sfScaleFactor and the sine, cosine and coeff
+/// for each DTMF tone in #gDtmfTones.
+///
+/// This is separate from #goertzel_Start so the benchmarks can set up the
+/// kernels without starting the DFT work threads.
+///
+/// @param  iSampleRate  Samples per second
+void goertzel_SetSampleRate( _In_ const int iSampleRate ) {
+   _ASSERTE( iSampleRate > 0 );
+   _ASSERTE( gstQueueSize > 0 );  // Set in #audioInit
 
    /// #### Function
    ///
@@ -245,21 +501,260 @@ BOOL goertzel_Start( _In_ const int iSampleRate ) {
    sfScaleFactor = gstQueueSize / 2.0f;
 
    /// - Set sine, cosine and coeff for each DTMF tone in #gDtmfTones.
-   for ( int i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
-      int   k      = (int) ( 0.5f + ( ( floatNumSamples * gDtmfTones[ i ].frequency ) / (float) floatSamplingRate ) );
-      float omega  = ( 2.0f * M_PIF * k ) / floatNumSamples;
+   goertzel_ComputeCoefficients( gDtmfTones, gstQueueSize, iSampleRate );
+}
+
+
+/// The most sample rates #goertzel_RateTable keeps
+#define GOERTZEL_RATE_TABLES (32)
+
+/// Set in a slot's state when its table is ready
+#define GOERTZEL_RATE_READY  (0x40000000L)
 
-      gDtmfTones[ i ].sine   = sinf( omega );
-      gDtmfTones[ i ].cosine = cosf( omega );
-      gDtmfTones[ i ].coeff  = 2.0f * gDtmfTones[ i ].cosine;
+static_assert( GOERTZEL_CONTEXT_MAX_RATE < GOERTZEL_RATE_READY, "A sample rate must fit under GOERTZEL_RATE_READY" );
+
+/// The coefficients for one sample rate.  Once it's ready, it never changes,
+/// so every stream at the rate shares it.
+typedef struct {
+   int         iSampleRate;                    ///< Samples per second
+   size_t      stWindowSize;                   ///< #GOERTZEL_CONTEXT_WINDOW
+   float       fScaleFactor;                   ///< Scales the magnitude
+   dtmfTones_t tones[ NUMBER_OF_DTMF_TONES ];  ///< The frequencies and their sine, cosine and coeff
+} goertzelRateTable_t;
+
+static goertzelRateTable_t sRateTables[ GOERTZEL_RATE_TABLES ];  ///< The rates seen so far
+
+/// `0` = empty.  Otherwise, the slot's sample rate -- with
+/// #GOERTZEL_RATE_READY set when its table is ready.
+static volatile LONG slRateTableState[ GOERTZEL_RATE_TABLES ] = { 0 };
+
+
+/// Get the shared coefficients for a sample rate.  The first stream at a rate
+/// computes them.  Every later stream just finds them.
+///
+/// Lock-free:  A thread claims an empty slot by writing its rate into the
+/// slot's state with an interlocked compare-exchange, and sets
+/// #GOERTZEL_RATE_READY when the table is built.  Slots are claimed in
+/// order, so if a claim fails, the slot holds the rate that won it.  If
+/// that's our rate, we wait (briefly) for its table instead of building
+/// another one -- so each rate is built once and takes one slot.
+///
+/// @param iSampleRate Samples per second
+/// @return The rate's table or `NULL` if there's no room for another rate
+static const goertzelRateTable_t* goertzel_RateTable( _In_ const int iSampleRate ) {
+   for ( size_t i = 0 ; i < GOERTZEL_RATE_TABLES ; i++ ) {
+      LONG lState = slRateTableState[ i ];  // A volatile read has acquire semantics in MSVC
+
+      if ( lState == 0 ) {
+         lState = InterlockedCompareExchange( &slRateTableState[ i ], (LONG) iSampleRate, 0 );
+
+         if ( lState == 0 ) {  // We claimed it.  Build the table.
+            goertzelRateTable_t* pTable = &sRateTables[ i ];
+
+            /// Size the window the same way #audioInit sizes #gPcmQueue
+            pTable->iSampleRate  = iSampleRate;
+            pTable->stWindowSize = GOERTZEL_CONTEXT_WINDOW( iSampleRate );
+            pTable->fScaleFactor = pTable->stWindowSize / 2.0f;
+
+            CopyMemory( pTable->tones, gDtmfTones, sizeof( pTable->tones ) );  // For the frequencies
+            goertzel_ComputeCoefficients( pTable->tones, pTable->stWindowSize, iSampleRate );
+
+            InterlockedExchange( &slRateTableState[ i ], (LONG) iSampleRate | GOERTZEL_RATE_READY );  // Publish it
+
+            return pTable;
+         }
+      }
+
+      /// The slot belongs to a rate.  If it's ours, wait until it's ready.
+      if ( ( lState & ~GOERTZEL_RATE_READY ) == (LONG) iSampleRate ) {
+         while ( ( slRateTableState[ i ] & GOERTZEL_RATE_READY ) == 0 ) {
+            YieldProcessor();  // Another thread is computing 16 sines and cosines
+         }
+         return &sRateTables[ i ];
+      }
+   }
+
+   return NULL;
+}
+
+
+/// Set up a decoder for one stream (see #goertzelContext_t).  It starts
+/// with a silent window.
+///
+/// The coefficients come from the rate's shared table, so setting up a
+/// stream costs a copy, not 16 calls to `sinf` and `cosf`.
+///
+/// @param pContext    The decoder
+/// @param iSampleRate Samples per second (up to #GOERTZEL_CONTEXT_MAX_RATE)
+/// @param pWindow     Holds #GOERTZEL_CONTEXT_WINDOW samples, or `NULL` if
+///                    the stream is only analyzed with
+///                    #goertzelContextAnalyzeRing
+/// @return `TRUE` if successful.  `FALSE` if the sample rate is not supported.
+BOOL goertzelContextInit( _Out_ goertzelContext_t* pContext, _In_ const int iSampleRate, _Out_writes_opt_( GOERTZEL_CONTEXT_WINDOW( iSampleRate ) ) BYTE* pWindow ) {
+   if ( iSampleRate < 1000 || iSampleRate > GOERTZEL_CONTEXT_MAX_RATE ) {
+      return FALSE;
+   }
+
+   pContext->stHead  = 0;
+   pContext->pWindow = pWindow;
+
+   const goertzelRateTable_t* pTable = goertzel_RateTable( iSampleRate );
+   if ( pTable != NULL ) {
+      pContext->stWindowSize = pTable->stWindowSize;
+      pContext->fScaleFactor = pTable->fScaleFactor;
+      CopyMemory( pContext->tones, pTable->tones, sizeof( pContext->tones ) );
+   } else {  // Too many rates to share.  Compute this one.
+      pContext->stWindowSize = GOERTZEL_CONTEXT_WINDOW( iSampleRate );
+      pContext->fScaleFactor = pContext->stWindowSize / 2.0f;
+      CopyMemory( pContext->tones, gDtmfTones, sizeof( pContext->tones ) );  // For the frequencies
+      goertzel_ComputeCoefficients( pContext->tones, pContext->stWindowSize, iSampleRate );
+   }
+
+   if ( pWindow != NULL ) {
+      FillMemory( pWindow, pContext->stWindowSize, PCM_8_BIT_SILENCE );
+   }
+
+   return TRUE;
+}
+
+
+/// Add a run of samples to a stream's window.  G.711 bytes are expanded as
+/// they're written (see #g711Expand).  This is #goertzelContextEnqueue for
+/// a whole buffer.
+///
+/// @param pContext  The decoder
+/// @param law       How #pSamples are encoded
+/// @param pSamples  The samples
+/// @param stSamples The number of samples
+void goertzelContextWrite(
+   _Inout_                 goertzelContext_t* pContext,
+   _In_                    const g711Law_t    law,
+   _In_reads_( stSamples ) const BYTE*        pSamples,
+   _In_                    const size_t       stSamples ) {
+   const BYTE* pNext  = pSamples;
+   size_t      stLeft = stSamples;
+
+   while ( stLeft > 0 ) {
+      size_t stRun = pContext->stWindowSize - pContext->stHead;
+      stRun = ( stRun < stLeft ) ? stRun : stLeft;
+
+      g711Expand( law, pNext, pContext->pWindow + pContext->stHead, stRun );
+
+      pNext            += stRun;
+      stLeft           -= stRun;
+      pContext->stHead += stRun;
+
+      if ( pContext->stHead >= pContext->stWindowSize ) {
+         pContext->stHead = 0;
+      }
+   }
+}
+
+
+/// Analyze a stream's window with the SIMD kernel (all 8 tones on the
+/// calling thread).  The results are in #goertzelContext_t.tones.
+///
+/// @param pContext The decoder
+void goertzelContextAnalyze( _Inout_ goertzelContext_t* pContext ) {
+   _ASSERTE( pContext->pWindow != NULL );
+
+   goertzel_SimdWindow( pContext->tones, pContext->pWindow, pContext->stHead, pContext->stWindowSize, pContext->fScaleFactor );
+}
+
+
+/// Analyze the newest window of a stream that lives in someone else's ring
+/// buffer, in place (the samples aren't copied into #goertzelContext_t.window).
+/// The results are in #goertzelContext_t.tones.
+///
+/// @param pContext   The decoder (for its coefficients and window size)
+/// @param pRing      The ring
+/// @param stRingSize The size of the ring.  Must be a power of 2 and at least
+///                   #goertzelContext_t.stWindowSize.
+/// @param u64End     The number of samples that have been written to the ring
+///                   (the window ends here).  Must be at least the window size.
+void goertzelContextAnalyzeRing(
+   _Inout_                    goertzelContext_t* pContext,
+   _In_reads_( stRingSize ) const BYTE*          pRing,
+   _In_                     const size_t         stRingSize,
+   _In_                     const UINT64         u64End ) {
+   _ASSERTE( ( stRingSize & ( stRingSize - 1 ) ) == 0 );
+   _ASSERTE( stRingSize >= pContext->stWindowSize );
+   _ASSERTE( u64End >= pContext->stWindowSize );
+
+   const size_t stStart = (size_t) ( ( u64End - pContext->stWindowSize ) & ( stRingSize - 1 ) );
+
+   if ( stStart + pContext->stWindowSize <= stRingSize ) {
+      goertzel_SimdRuns( pContext->tones, pRing + stStart, pRing + stStart + pContext->stWindowSize, pRing, pRing, pContext->fScaleFactor );
+   } else {
+      const size_t stWrapped = stStart + pContext->stWindowSize - stRingSize;
+      goertzel_SimdRuns( pContext->tones, pRing + stStart, pRing + stRingSize, pRing, pRing + stWrapped, pContext->fScaleFactor );
    }
+}
+
+
+/// Decode a key from the tones the same way #goertzelWorkThread detects
+/// them:  Exactly one row and exactly one column must be detected.
+///
+/// @param tones The analyzed tones
+/// @return The key from #DTMF_CORPUS_KEYS or `L'\0'` if there isn't one
+WCHAR goertzelDecodeKey( _In_reads_( NUMBER_OF_DTMF_TONES ) const dtmfTones_t* tones ) {
+   int iRow    = -1;
+   int iColumn = -1;
 
    for ( int i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+      bool detected = tones[ i ].goertzelMagnitude >= GOERTZEL_MAGNITUDE_THRESHOLD
+                   && tones[ i ].energyRatio       >= GOERTZEL_RATIO_THRESHOLD;
+      if ( !detected ) {
+         continue;
+      }
+
+      if ( i < 4 ) {
+         if ( iRow != -1 ) {
+            return L'\0';  // More than one row
+         }
+         iRow = i;
+      } else {
+         if ( iColumn != -1 ) {
+            return L'\0';  // More than one column
+         }
+         iColumn = i - 4;
+      }
+   }
+
+   if ( iRow == -1 || iColumn == -1 ) {
+      return L'\0';
+   }
+
+   return DTMF_CORPUS_KEYS[ iRow * 4 + iColumn ];
+}
+
+
+/// Start the DFT work threads
+///
+/// @param  iSampleRate  Samples per second
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL goertzel_Start( _In_ const int iSampleRate ) {
+   _ASSERTE( iSampleRate > 0 );
+   _ASSERTE( gstQueueSize > 0 );  // Set in #audioInit
+   _ASSERTE( ghStartDFTevent != NULL );
+
+   /// #### Function
+   ///
+   /// - Compute the coefficients with #goertzel_SetSampleRate
+   goertzel_SetSampleRate( iSampleRate );
+
+   /// - Pick the kernel, the number of work threads and the hop for this
+   ///   machine with #goertzelTuneRun
+   goertzelTuneRun( iSampleRate );  // Failures are logged as warnings
+
+   _ASSERTE( gGoertzelTuning.uWorkers <= NUMBER_OF_DTMF_TONES );
+
+   for ( int i = 0 ; i < (int) gGoertzelTuning.uWorkers ; i++ ) {
       _ASSERTE( ghDoneDFTevents[ i ] != NULL );
       _ASSERTE( shWorkThreads[ i ] == NULL );
 
       /// - Use CreateThread to start the threads, storing the handles in #shWorkThreads
-      shWorkThreads[i] = CreateThread(NULL, 0, goertzelWorkThread, &gDtmfTones[i].index, 0, NULL);
+      shWorkThreads[i] = CreateThread(NULL, 0, goertzelWorkThread, (LPVOID) &siWorkerIndex[i], 0, NULL);
       if ( shWorkThreads[ i ] == NULL ) {
          RETURN_FATAL( IDS_GOERTZEL_FAILED_TO_CREATE_WORK_THREAD, i );  // "Failed to create Goertzel work thread %d.  Exiting."
       }
@@ -321,11 +816,11 @@ BOOL goertzel_Stop() {
    ///         - Read about WaitForMultipleObjects for the details.
    DWORD   dwWaitResult;  // Result from WaitForMultipleObjects
    dwWaitResult = WaitForMultipleObjects(
-      NUMBER_OF_DTMF_TONES,  // Number of object handles
+      numRunningThreads,     // Number of object handles (the threads were started in order)
       ghDoneDFTevents,       // Array of object handles
       TRUE,                  // bWaitAll:  If TRUE, return when all objects are signaled.  If FALSE, return when any one of the objects are signaled.
       INFINITE );            // Time-out interval, in milliseconds
-   if ( !( dwWaitResult >= WAIT_OBJECT_0 && dwWaitResult <= ( WAIT_OBJECT_0 + NUMBER_OF_DTMF_TONES - 1 ) ) ) {
+   if ( !( dwWaitResult >= WAIT_OBJECT_0 && dwWaitResult <= ( WAIT_OBJECT_0 + numRunningThreads - 1 ) ) ) {
       RETURN_FATAL( IDS_GOERTZEL_THREAD_END_FAILED );  // "Wait for all Goertzel threads to end failed.  Exiting."
    }
 
@@ -370,3 +865,181 @@ BOOL goertzel_Release() {
 
    return TRUE;
 }
+
+
+/// @param kernel The kernel to check
+/// @return `true` if this build has the kernel
+bool goertzelKernelAvailable( _In_ const goertzelKernel_t kernel ) {
+   switch ( kernel ) {
+      case GOERTZEL_KERNEL_C:
+      case GOERTZEL_KERNEL_SIMD:
+         return true;
+      case GOERTZEL_KERNEL_ASM:
+         #ifdef _WIN64
+            return true;
+         #else
+            return false;
+         #endif
+      default:
+         return false;
+   }
+}
+
+
+/// @param kernel The kernel
+/// @return The name of the kernel (for reports)
+PCWSTR goertzelKernelName( _In_ const goertzelKernel_t kernel ) {
+   switch ( kernel ) {
+      case GOERTZEL_KERNEL_C:    return L"C";
+      case GOERTZEL_KERNEL_ASM:  return L"asm";
+      case GOERTZEL_KERNEL_SIMD: return L"SIMD";
+      default:                   return L"unknown";
+   }
+}
+
+
+/// Compute the magnitude and energy of all 8 tones with one of the kernels,
+/// on the calling thread
+///
+/// This does not use the DFT work threads.  It's for the benchmarks and for
+/// callers that want to do the whole analysis on one thread.
+///
+/// @param kernel The kernel to use.  It must be #goertzelKernelAvailable.
+/// @param tones  The 8 tones to compute (normally #gDtmfTones or a copy of it)
+void goertzelRunKernel(
+   _In_                                       const goertzelKernel_t kernel,
+   _Inout_updates_( NUMBER_OF_DTMF_TONES )          dtmfTones_t*     tones ) {
+   goertzelRunKernelRange( kernel, tones, 0, NUMBER_OF_DTMF_TONES );
+}
+
+
+/// Compute the magnitude and energy of some of the tones with one of the
+/// kernels, on the calling thread.  This is a DFT work thread's share.
+///
+/// The SIMD kernel computes all 8 tones in one pass, so it can't be split:
+/// Its range has to be all of the tones.
+///
+/// @param kernel  The kernel to use.  It must be #goertzelKernelAvailable.
+/// @param tones   The 8 tones (normally #gDtmfTones or a copy of it)
+/// @param stFirst The first tone to compute
+/// @param stLast  One past the last tone to compute
+void goertzelRunKernelRange(
+   _In_                                       const goertzelKernel_t kernel,
+   _Inout_updates_( NUMBER_OF_DTMF_TONES )          dtmfTones_t*     tones,
+   _In_                                       const size_t           stFirst,
+   _In_                                       const size_t           stLast ) {
+   _ASSERTE( goertzelKernelAvailable( kernel ) );
+   _ASSERTE( stFirst < stLast && stLast <= NUMBER_OF_DTMF_TONES );
+
+   switch ( kernel ) {
+      case GOERTZEL_KERNEL_C:
+         for ( size_t i = stFirst ; i < stLast ; i++ ) {
+            goertzel_MagnitudeEnergy( (UINT8) i, &tones[ i ] );
+         }
+         break;
+      case GOERTZEL_KERNEL_ASM:
+         #ifdef _WIN64
+            for ( size_t i = stFirst ; i < stLast ; i++ ) {
+               goertzel_MagnitudeEnergy_x64( (UINT8) i, &tones[ i ] );
+            }
+         #endif
+         break;
+      case GOERTZEL_KERNEL_SIMD:
+         _ASSERTE( stFirst == 0 && stLast == NUMBER_OF_DTMF_TONES );
+         goertzel_MagnitudeEnergy_SIMD( tones );
+         break;
+      default:
+         _ASSERT_EXPR( FALSE, L"Unknown Goertzel kernel" );
+   }
+}
+
+
+/// Analyze some of the tones in #gPcmQueue with the #gGoertzelTuning kernel
+/// and set their detected state.  A DFT work thread calls this with its
+/// share of the tones.  With no work threads, the capture thread calls it
+/// (through #goertzel_compute_dtmf_tones) with all of them.
+///
+/// @param stFirst The first tone
+/// @param stLast  One past the last tone
+void goertzelAnalyzeTones( _In_ const size_t stFirst, _In_ const size_t stLast ) {
+   goertzelRunKernelRange( gGoertzelTuning.kernel, gDtmfTones, stFirst, stLast );
+   perfCountersAdd( PERF_COUNTER_DFT_PASSES, stLast - stFirst );
+
+   /// A tone is detected when it's above #GOERTZEL_MAGNITUDE_THRESHOLD and it
+   /// holds at least #GOERTZEL_RATIO_THRESHOLD of the window's energy
+   for ( size_t i = stFirst ; i < stLast ; i++ ) {
+      if ( gDtmfTones[ i ].goertzelMagnitude >= GOERTZEL_MAGNITUDE_THRESHOLD
+        && gDtmfTones[ i ].energyRatio       >= GOERTZEL_RATIO_THRESHOLD ) {
+         mvcModelToggleToneDetectedStatus( i, true );
+      } else {
+         mvcModelToggleToneDetectedStatus( i, false );
+      }
+   }
+}
+
+
+/// Measure the overhead of the fused magnitude + energy kernel against the
+/// magnitude-only kernel.
+///
+/// This is not normally used, except for testing.  It must be called after
+/// #goertzel_Start (so the coefficients and #gPcmQueue are set).  It works on
+/// a copy of #gDtmfTones, so it's safe to run while the DFT threads are running.
+/// The results are written to the log.
+void goertzelBenchmark() {
+   _ASSERTE( gPcmQueue != NULL );
+   _ASSERTE( gstQueueSize > 0 );
+   _ASSERTE( sfScaleFactor > 0 );
+
+   /// #### Function
+
+   LARGE_INTEGER frequency;  // Ticks per second
+   LARGE_INTEGER start;      // Start time in ticks
+   LARGE_INTEGER end;        // End time in ticks
+
+   dtmfTones_t tones[ NUMBER_OF_DTMF_TONES ];  // Local copy of #gDtmfTones
+
+   CopyMemory( tones, gDtmfTones, sizeof( tones ) );
+
+   QueryPerformanceFrequency( &frequency );  // This never fails on Windows XP or later
+
+   /// - Time the magnitude-only kernel
+   QueryPerformanceCounter( &start );
+   for ( int run = 0 ; run < GOERTZEL_BENCHMARK_RUNS ; run++ ) {
+      for ( UINT8 i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+         #ifdef _WIN64
+            goertzel_Magnitude_x64( i, &tones[ i ] );
+         #else
+            goertzel_Magnitude( i, &tones[ i ] );
+         #endif
+      }
+   }
+   QueryPerformanceCounter( &end );
+
+   double magnitudeOnlyNs = (double) ( end.QuadPart - start.QuadPart ) * 1.0e9
+                          / (double) frequency.QuadPart
+                          / (double) ( GOERTZEL_BENCHMARK_RUNS * NUMBER_OF_DTMF_TONES );
+
+   /// - Time the fused magnitude + energy kernel
+   QueryPerformanceCounter( &start );
+   for ( int run = 0 ; run < GOERTZEL_BENCHMARK_RUNS ; run++ ) {
+      for ( UINT8 i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+         #ifdef _WIN64
+            goertzel_MagnitudeEnergy_x64( i, &tones[ i ] );
+         #else
+            goertzel_MagnitudeEnergy( i, &tones[ i ] );
+         #endif
+      }
+   }
+   QueryPerformanceCounter( &end );
+
+   double fusedNs = (double) ( end.QuadPart - start.QuadPart ) * 1.0e9
+                  / (double) frequency.QuadPart
+                  / (double) ( GOERTZEL_BENCHMARK_RUNS * NUMBER_OF_DTMF_TONES );
+
+   /// - Log the time per tone and the overhead of computing the energy
+   LOG_INFO_R( IDS_GOERTZEL_BENCHMARK_RESULT, gstQueueSize, magnitudeOnlyNs, fusedNs, ( fusedNs / magnitudeOnlyNs - 1.0 ) * 100.0 );  // "Goertzel benchmark:  %zu samples   Magnitude only: %.1f ns   Magnitude + energy: %.1f ns   Overhead: %.1f%%"
+
+   for ( size_t i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+      LOG_INFO_R( IDS_GOERTZEL_BENCHMARK_TONE, tones[ i ].label, tones[ i ].goertzelMagnitude, tones[ i ].totalEnergy, tones[ i ].energyRatio );  // "Goertzel benchmark:  %s Hz   Magnitude: %.2f   Energy: %.2f   Ratio: %.3f"
+   }
+}
@@ -18,23 +18,102 @@
 #pragma once
 
 #include <Windows.h>  // For BOOL, etc.
+#include "g711.h"     // For g711Law_t
 
 
 /// When the result of #goertzel_Magnitude `>=` #GOERTZEL_MAGNITUDE_THRESHOLD, 
 /// then we've detected a tone.
 #define GOERTZEL_MAGNITUDE_THRESHOLD  10.0f
 
+/// A tone must also hold at least this fraction of the total energy in the
+/// window (#dtmfTones_t.energyRatio).  This rejects broadband noise that's
+/// loud enough to trip #GOERTZEL_MAGNITUDE_THRESHOLD.
+///
+/// A pure tone is `1.0`.  A balanced DTMF digit is about `0.5` per tone and
+/// a digit with 8dB of twist puts about `0.14` in its weaker tone.
+#define GOERTZEL_RATIO_THRESHOLD      0.05f
+
+/// The Goertzel kernels DTMF Decoder has.  They all compute the same
+/// results (#dtmfTones_t.goertzelMagnitude, #dtmfTones_t.totalEnergy and
+/// #dtmfTones_t.energyRatio).
+enum goertzelKernel_t {
+   GOERTZEL_KERNEL_C = 0,  ///< The reference C kernel (one tone per pass)
+   GOERTZEL_KERNEL_ASM,    ///< The hand-coded x64 Assembly Language kernel (one tone per pass).  64-bit builds only.
+   GOERTZEL_KERNEL_SIMD,   ///< SSE across the tones (all 8 tones in one pass)
+   GOERTZEL_KERNEL_COUNT   ///< The number of kernels
+};
+
+/// How the DFT work is split up on this machine.  #goertzelTuneRun picks it
+/// when the DFT starts (see goertzelTune.cpp).
+typedef struct {
+   goertzelKernel_t kernel;    ///< The kernel the DFT runs
+   UINT32           uWorkers;  ///< The DFT work threads (`1`, `2`, `4` or `8`), each with its share of the tones, or `0` to run the DFT on the capture thread
+   UINT32           uHopMs;    ///< The least capture time between analyses (in ms).  `0` analyzes every buffer.
+} goertzelTuning_t;
+
+/// The highest sample rate a #goertzelContext_t supports
+#define GOERTZEL_CONTEXT_MAX_RATE (48000)
+
+/// The size of a window at a sample rate (like #gstQueueSize)
+#define GOERTZEL_CONTEXT_WINDOW( iSampleRate ) ( (size_t) ( iSampleRate ) / 1000 * SIZE_OF_QUEUE_IN_MS )
+
+/// A decoder for one stream.  It has its own window and results, so it
+/// doesn't use #gPcmQueue or #gDtmfTones and any number of them can run at
+/// once (one thread at a time per context).
+///
+/// The window belongs to whoever set up the context (usually a
+/// #goertzelSlab_t), so it can be sized for the stream's sample rate.
+typedef struct {
+   dtmfTones_t tones[ NUMBER_OF_DTMF_TONES ];  ///< The coefficients (copied from the rate's shared table) and the latest results
+   float       fScaleFactor;                   ///< Scales the magnitude (like #sfScaleFactor)
+   size_t      stWindowSize;                   ///< The number of samples in #pWindow (like #gstQueueSize)
+   size_t      stHead;                         ///< The oldest sample in #pWindow (like #gstQueueHead)
+   BYTE*       pWindow;                        ///< The samples (like #gPcmQueue) or `NULL` if only #goertzelContextAnalyzeRing is used
+} goertzelContext_t;
+
 extern BOOL goertzel_Init();
+extern void goertzel_SetSampleRate( _In_ const int iSampleRate );
 extern BOOL goertzel_Start( _In_ const int SAMPLING_RATE_IN );
 extern BOOL goertzel_Stop();
 extern BOOL goertzel_Release();
 
+extern bool   goertzelKernelAvailable( _In_ const goertzelKernel_t kernel );
+extern PCWSTR goertzelKernelName( _In_ const goertzelKernel_t kernel );
+extern void   goertzelRunKernel( _In_ const goertzelKernel_t kernel, _Inout_updates_( NUMBER_OF_DTMF_TONES ) dtmfTones_t* tones );
+extern void   goertzelRunKernelRange( _In_ const goertzelKernel_t kernel, _Inout_updates_( NUMBER_OF_DTMF_TONES ) dtmfTones_t* tones, _In_ const size_t stFirst, _In_ const size_t stLast );
+extern void   goertzelAnalyzeTones( _In_ const size_t stFirst, _In_ const size_t stLast );
+
+extern void goertzelBenchmark();
+
+extern BOOL  goertzelContextInit( _Out_ goertzelContext_t* pContext, _In_ const int iSampleRate, _Out_writes_opt_( GOERTZEL_CONTEXT_WINDOW( iSampleRate ) ) BYTE* pWindow );
+extern void  goertzelContextWrite( _Inout_ goertzelContext_t* pContext, _In_ const g711Law_t law, _In_reads_( stSamples ) const BYTE* pSamples, _In_ const size_t stSamples );
+extern void  goertzelContextAnalyze( _Inout_ goertzelContext_t* pContext );
+extern void  goertzelContextAnalyzeRing( _Inout_ goertzelContext_t* pContext, _In_reads_( stRingSize ) const BYTE* pRing, _In_ const size_t stRingSize, _In_ const UINT64 u64End );
+extern WCHAR goertzelDecodeKey( _In_reads_( NUMBER_OF_DTMF_TONES ) const dtmfTones_t* tones );
+
+
+/// Add a sample to a stream's window (like #pcmEnqueue)
+///
+/// Inlined for performance.
+///
+/// @param pContext The decoder
+/// @param data     The sample
+__forceinline void goertzelContextEnqueue( _Inout_ goertzelContext_t* pContext, _In_ const BYTE data ) {
+   pContext->pWindow[ pContext->stHead++ ] = data;
+
+   if ( pContext->stHead >= pContext->stWindowSize ) {
+      pContext->stHead = 0;
+   }
+}
+
 extern HANDLE ghStartDFTevent;
 extern HANDLE ghDoneDFTevents[ NUMBER_OF_DTMF_TONES ];
+extern goertzelTuning_t gGoertzelTuning;
 
 
-/// Signal the Goertzel DFT worker threads to start, then wait for all 8 of
-/// them to finish.
+/// Signal the Goertzel DFT worker threads to start, then wait for all of
+/// them to finish.  With no workers (see #goertzelTuning_t.uWorkers), the
+/// DFT runs right here.
 ///
 /// Inlined for performance.
 ///
@@ -43,16 +122,21 @@ __forceinline BOOL goertzel_compute_dtmf_tones() {
    BOOL  br;            // BOOL result
    DWORD dwWaitResult;  // Result from WaitForMultipleObjects
 
+   if ( gGoertzelTuning.uWorkers == 0 ) {
+      goertzelAnalyzeTones( 0, NUMBER_OF_DTMF_TONES );
+      return TRUE;
+   }
+
    /// Start all of the worker threads
    br = SetEvent( ghStartDFTevent );
    CHECK_BR_Q( IDS_GOERTZEL_FAILED_TO_SIGNAL_START_DFT, 0 );  // "Failed to signal a ghStartDFTevent.  Exiting."
 
    /// Wait for all of the worker threads to signal their ghDoneDFTevents
    dwWaitResult = WaitForMultipleObjects( 
-                     NUMBER_OF_DTMF_TONES,  // Number of object handles
-                     ghDoneDFTevents,        // Array of object handles
-                     TRUE,                  // bWaitAll:  If TRUE, return when all objects are signaled.  If FALSE, return when any one of the objects are signaled.
-                     INFINITE );            // Time-out interval, in milliseconds
+                     gGoertzelTuning.uWorkers,  // Number of object handles
+                     ghDoneDFTevents,           // Array of object handles
+                     TRUE,                      // bWaitAll:  If TRUE, return when all objects are signaled.  If FALSE, return when any one of the objects are signaled.
+                     INFINITE );                // Time-out interval, in milliseconds
 
    /// For performance reasons, I'm asserting the result of the `WaitForMultipleObjects`.
    /// I don't want to compute this in the Release version for each audio buffer run.
@@ -61,7 +145,7 @@ __forceinline BOOL goertzel_compute_dtmf_tones() {
    /// indicates that the state of all specified objects are signaled.
    ///
    /// @see https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-waitformultipleobjects 
-   _ASSERTE( dwWaitResult >= WAIT_OBJECT_0 && dwWaitResult <= ( WAIT_OBJECT_0 + NUMBER_OF_DTMF_TONES - 1 ) );
+   _ASSERTE( dwWaitResult >= WAIT_OBJECT_0 && dwWaitResult <= ( WAIT_OBJECT_0 + gGoertzelTuning.uWorkers - 1 ) );
 
 	/// When all of the worker threads are done, reset the start event
    br = ResetEvent( ghStartDFTevent );
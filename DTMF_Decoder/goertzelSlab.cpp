@@ -0,0 +1,509 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// A lock-free slab allocator for stream decoders (#goertzelContext_t)
+///
+/// Under call churn, the service sets up and tears down thousands of
+/// decoders a minute.  Setting one up used to mean computing 16 sines and
+/// cosines and filling a window sized for 48kHz, whatever the stream's rate.
+/// Now:
+///
+///   - The coefficients for each sample rate are computed once and shared
+///     (see #goertzelContextInit)
+///   - Decoders come from a #goertzelSlab_t in 3 sample rate classes
+///     (#goertzelSlabClass_t).  A decoder's window follows it in its slot
+///     and is sized for its class, so an 8kHz stream's decoder is a sixth of
+///     the size of a 48kHz one.
+///   - #goertzelSlabAttach pops a decoder off its class' lock-free `SLIST`
+///     and #goertzelSlabDetach pushes it back.  Neither takes a lock, calls
+///     the heap or touches a worker thread.  When a class runs dry, the
+///     thread that found it empty takes the slab's lock and carves a chunk of
+///     #GOERTZEL_SLAB_CHUNK decoders.  Chunks are only freed by
+///     #goertzelSlabRelease.
+///
+/// Each NUMA node has its own slab, and its chunks come from
+/// #numaPlaceAlloc, so a decoder is on the node of the workers that use it.
+///
+/// #goertzelSlabTest measures the sustained attach/detach rate while other
+/// threads decode.  It runs with `/benchmark`.
+///
+/// ### APIs Used
+/// | API                          | Link                                                                                                      |
+/// |------------------------------|-----------------------------------------------------------------------------------------------------------|
+/// | `InterlockedPopEntrySList`   | https://learn.microsoft.com/en-us/windows/win32/api/interlockedapi/nf-interlockedapi-interlockedpopentryslist  |
+/// | `InterlockedPushEntrySList`  | https://learn.microsoft.com/en-us/windows/win32/api/interlockedapi/nf-interlockedapi-interlockedpushentryslist |
+/// | `AcquireSRWLockExclusive`    | https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-acquiresrwlockexclusive           |
+///
+/// @file    goertzelSlab.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <stdlib.h>       // For qsort
+
+#include "audio.h"        // For PCM_8_BIT_SILENCE
+#include "mvcModel.h"     // For dtmfTones_t
+#include "goertzel.h"     // For goertzelContext_t
+#include "numaPlace.h"    // For numaPlaceAlloc
+#include "goertzelSlab.h" // For yo bad self
+
+
+/// The highest sample rate of each class
+static const int siClassRates[ GOERTZEL_SLAB_CLASS_COUNT ] = { 8000, 16000, GOERTZEL_CONTEXT_MAX_RATE };
+
+
+/// A decoder's slot in a chunk.  Its window follows it.
+typedef struct DECLSPEC_ALIGN( MEMORY_ALLOCATION_ALIGNMENT ) {
+   SLIST_ENTRY         entry;      ///< Links free slots.  Must be first.
+   goertzelSlabClass_t rateClass;  ///< The class the slot was carved for
+   goertzelContext_t   context;    ///< The decoder
+} goertzelSlabSlot_t;
+
+
+/// The header at the start of each chunk
+struct goertzelSlabChunk_t {
+   goertzelSlabChunk_t* pNext;  ///< The slab's next chunk
+};
+
+
+/// The bytes from the start of a chunk to its first slot
+#define GOERTZEL_SLAB_HEADER ( ( sizeof( goertzelSlabChunk_t ) + SYSTEM_CACHE_ALIGNMENT_SIZE - 1 ) / SYSTEM_CACHE_ALIGNMENT_SIZE * SYSTEM_CACHE_ALIGNMENT_SIZE )
+
+
+/// @param rateClass A sample rate class
+/// @return The size of a slot and its window (on its own cache lines)
+static size_t goertzelSlabStride( _In_ const goertzelSlabClass_t rateClass ) {
+   const size_t stBytes = sizeof( goertzelSlabSlot_t ) + GOERTZEL_CONTEXT_WINDOW( siClassRates[ rateClass ] );
+
+   return ( stBytes + SYSTEM_CACHE_ALIGNMENT_SIZE - 1 ) / SYSTEM_CACHE_ALIGNMENT_SIZE * SYSTEM_CACHE_ALIGNMENT_SIZE;
+}
+
+
+/// Start an empty slab.  Nothing is allocated until the first attach.
+///
+/// @param pSlab  The slab
+/// @param stNode The NUMA node its chunks come from (see #numaPlaceNodes)
+void goertzelSlabInit( _Out_ goertzelSlab_t* pSlab, _In_ const size_t stNode ) {
+   _ASSERTE( pSlab != NULL );
+
+   for ( size_t i = 0 ; i < GOERTZEL_SLAB_CLASS_COUNT ; i++ ) {
+      InitializeSListHead( &pSlab->free[ i ] );
+   }
+
+   InitializeSRWLock( &pSlab->lock );
+   pSlab->stNode      = stNode;
+   pSlab->pChunks     = NULL;
+   pSlab->l64Chunks   = 0;
+   pSlab->l64Attached = 0;
+}
+
+
+/// Free every chunk.  Nobody may be using the slab or any of its decoders.
+///
+/// @param pSlab The slab
+void goertzelSlabRelease( _Inout_ goertzelSlab_t* pSlab ) {
+   _ASSERTE( pSlab != NULL );
+
+   while ( pSlab->pChunks != NULL ) {
+      goertzelSlabChunk_t* pNext = pSlab->pChunks->pNext;
+      numaPlaceFree( pSlab->pChunks );
+      pSlab->pChunks = pNext;
+   }
+
+   goertzelSlabInit( pSlab, pSlab->stNode );
+}
+
+
+/// Carve a chunk for a class that ran dry.  Another thread may have carved
+/// one while this one waited for the lock, so look again first.
+///
+/// @param pSlab     The slab
+/// @param rateClass The class
+/// @return A free slot or `NULL` if a chunk couldn't be allocated
+static goertzelSlabSlot_t* goertzelSlabGrow( _Inout_ goertzelSlab_t* pSlab, _In_ const goertzelSlabClass_t rateClass ) {
+   AcquireSRWLockExclusive( &pSlab->lock );
+
+   goertzelSlabSlot_t* pSlot = (goertzelSlabSlot_t*) InterlockedPopEntrySList( &pSlab->free[ rateClass ] );
+
+   if ( pSlot == NULL ) {
+      const size_t stStride = goertzelSlabStride( rateClass );
+
+      BYTE* pChunk = (BYTE*) numaPlaceAlloc( pSlab->stNode, GOERTZEL_SLAB_HEADER + GOERTZEL_SLAB_CHUNK * stStride );
+      if ( pChunk != NULL ) {
+         ( (goertzelSlabChunk_t*) pChunk )->pNext = pSlab->pChunks;
+         pSlab->pChunks = (goertzelSlabChunk_t*) pChunk;
+         InterlockedIncrement64( &pSlab->l64Chunks );
+
+         /// - Keep the first slot and put the rest in the free list
+         for ( size_t i = GOERTZEL_SLAB_CHUNK ; i > 0 ; i-- ) {
+            pSlot = (goertzelSlabSlot_t*) ( pChunk + GOERTZEL_SLAB_HEADER + ( i - 1 ) * stStride );
+            pSlot->rateClass = rateClass;
+
+            if ( i > 1 ) {
+               InterlockedPushEntrySList( &pSlab->free[ rateClass ], &pSlot->entry );
+            }
+         }
+      }
+   }
+
+   ReleaseSRWLockExclusive( &pSlab->lock );
+
+   return pSlot;
+}
+
+
+/// Attach a decoder for a new stream.  It's set up for the sample rate with
+/// a silent window (see #goertzelContextInit).
+///
+/// Lock-free and O(1) unless the rate's class has to grow.
+///
+/// @param pSlab       The slab
+/// @param iSampleRate Samples per second (up to #GOERTZEL_CONTEXT_MAX_RATE)
+/// @return The decoder or `NULL` if the sample rate is not supported or
+///         there's no memory
+goertzelContext_t* goertzelSlabAttach( _Inout_ goertzelSlab_t* pSlab, _In_ const int iSampleRate ) {
+   _ASSERTE( pSlab != NULL );
+
+   if ( iSampleRate < 1000 || iSampleRate > GOERTZEL_CONTEXT_MAX_RATE ) {
+      return NULL;
+   }
+
+   goertzelSlabClass_t rateClass = GOERTZEL_SLAB_CLASS_8K;
+   while ( iSampleRate > siClassRates[ rateClass ] ) {
+      rateClass = (goertzelSlabClass_t) ( rateClass + 1 );
+   }
+
+   goertzelSlabSlot_t* pSlot = (goertzelSlabSlot_t*) InterlockedPopEntrySList( &pSlab->free[ rateClass ] );
+   if ( pSlot == NULL ) {
+      pSlot = goertzelSlabGrow( pSlab, rateClass );
+      if ( pSlot == NULL ) {
+         return NULL;
+      }
+   }
+
+   _ASSERTE( pSlot->rateClass == rateClass );
+
+   goertzelContextInit( &pSlot->context, iSampleRate, (BYTE*) ( pSlot + 1 ) );  // The window follows the slot
+
+   InterlockedIncrement64( &pSlab->l64Attached );
+
+   return &pSlot->context;
+}
+
+
+/// Give a decoder back to its slab.  Lock-free and O(1).
+///
+/// @param pSlab    The slab it came from
+/// @param pContext From #goertzelSlabAttach
+void goertzelSlabDetach( _Inout_ goertzelSlab_t* pSlab, _In_ goertzelContext_t* pContext ) {
+   _ASSERTE( pSlab != NULL );
+   _ASSERTE( pContext != NULL );
+
+   goertzelSlabSlot_t* pSlot = CONTAINING_RECORD( pContext, goertzelSlabSlot_t, context );
+
+   _ASSERTE( pSlot->rateClass < GOERTZEL_SLAB_CLASS_COUNT );
+
+   InterlockedDecrement64( &pSlab->l64Attached );
+   InterlockedPushEntrySList( &pSlab->free[ pSlot->rateClass ], &pSlot->entry );
+}
+
+
+/// How long each pass of #goertzelSlabTest runs (in milliseconds)
+#define GOERTZEL_SLAB_TEST_MS        (1000)
+
+/// The #goertzelSlabTest threads that decode and the ones that churn
+#define GOERTZEL_SLAB_TEST_DECODERS  (2)
+#define GOERTZEL_SLAB_TEST_CHURNERS  (2)  ///< See #GOERTZEL_SLAB_TEST_DECODERS
+
+/// The streams each decoding thread decodes
+#define GOERTZEL_SLAB_TEST_STREAMS   (64)
+
+/// The streams each churning thread keeps attached.  It detaches the oldest
+/// and attaches a new one, over and over.
+#define GOERTZEL_SLAB_TEST_LIVE      (16)
+
+/// The attach times each churning thread keeps (the latest ones)
+#define GOERTZEL_SLAB_TEST_SAMPLES   (8192)
+
+/// The sample rates the churning threads cycle through (one of each class
+/// and 44.1kHz, which shares the 48kHz class)
+static const int siTestRates[ 4 ] = { 8000, 16000, 44100, 48000 };
+
+
+/// The state shared by the #goertzelSlabTest threads
+static volatile LONG     slTestGo = 0;  ///< `0` = wait, `1` = run, `2` = stop
+static goertzelSlab_t    sTestSlab;     ///< The slab under test
+static goertzelContext_t sTestReference[ 4 ];  ///< A decoder set up for each of #siTestRates (for the coefficients)
+static UINT64            su64TestAnalyses[ GOERTZEL_SLAB_TEST_DECODERS ];  ///< Each decoding thread's analyses
+static UINT64            su64TestChurns[ GOERTZEL_SLAB_TEST_CHURNERS ];    ///< Each churning thread's attach/detach pairs
+static size_t            sstTestErrors[ GOERTZEL_SLAB_TEST_CHURNERS ];     ///< Each churning thread's bad decoders
+static UINT64            su64TestTicks[ GOERTZEL_SLAB_TEST_CHURNERS ][ GOERTZEL_SLAB_TEST_SAMPLES ];  ///< Each churning thread's attach times (QPC ticks)
+
+
+/// A #goertzelSlabTest decoding thread.  It attaches its streams once, then
+/// writes a hop to each one and analyzes it until it's told to stop.  It
+/// never touches the slab while the churning threads run.
+///
+/// @param pParam The thread's number
+/// @return `0`
+static DWORD WINAPI goertzelSlabTestDecoder( _In_ LPVOID pParam ) {
+   const size_t stThread = (size_t) (UINT_PTR) pParam;
+
+   goertzelContext_t* pStreams[ GOERTZEL_SLAB_TEST_STREAMS ] = { NULL };
+   BYTE               hop[ 80 ];  // 10ms at 8kHz
+   UINT64             u64Analyses = 0;
+
+   for ( size_t i = 0 ; i < sizeof( hop ) ; i++ ) {
+      hop[ i ] = (BYTE) ( PCM_8_BIT_SILENCE - 32 + ( i * 37 ) % 64 );  // Something that isn't silence
+   }
+
+   for ( size_t i = 0 ; i < GOERTZEL_SLAB_TEST_STREAMS ; i++ ) {
+      pStreams[ i ] = goertzelSlabAttach( &sTestSlab, 8000 );
+   }
+
+   while ( slTestGo == 0 ) {
+      YieldProcessor();
+   }
+
+   while ( slTestGo == 1 ) {
+      for ( size_t i = 0 ; i < GOERTZEL_SLAB_TEST_STREAMS ; i++ ) {
+         if ( pStreams[ i ] != NULL ) {
+            goertzelContextWrite( pStreams[ i ], G711_LINEAR, hop, sizeof( hop ) );
+            goertzelContextAnalyze( pStreams[ i ] );
+            u64Analyses++;
+         }
+      }
+   }
+
+   for ( size_t i = 0 ; i < GOERTZEL_SLAB_TEST_STREAMS ; i++ ) {
+      if ( pStreams[ i ] != NULL ) {
+         goertzelSlabDetach( &sTestSlab, pStreams[ i ] );
+      }
+   }
+
+   su64TestAnalyses[ stThread ] = u64Analyses;
+
+   return 0;
+}
+
+
+/// A #goertzelSlabTest churning thread.  It keeps #GOERTZEL_SLAB_TEST_LIVE
+/// streams attached, replacing the oldest one as fast as it can.  Each
+/// decoder is checked when it's attached (its window and coefficients
+/// match its rate) and stamped, and the stamp is checked when it's detached
+/// (nobody else was handed the same decoder).
+///
+/// @param pParam The thread's number
+/// @return `0`
+static DWORD WINAPI goertzelSlabTestChurner( _In_ LPVOID pParam ) {
+   const size_t stThread = (size_t) (UINT_PTR) pParam;
+
+   goertzelContext_t* pLive[ GOERTZEL_SLAB_TEST_LIVE ] = { NULL };
+   UINT64             u64Stamps[ GOERTZEL_SLAB_TEST_LIVE ] = { 0 };
+   UINT64             u64Churns = 0;
+   size_t             stErrors  = 0;
+   LARGE_INTEGER      before;
+   LARGE_INTEGER      after;
+
+   while ( slTestGo == 0 ) {
+      YieldProcessor();
+   }
+
+   while ( slTestGo == 1 ) {
+      const size_t stSlot = (size_t) ( u64Churns % GOERTZEL_SLAB_TEST_LIVE );
+      const size_t stRate = (size_t) ( u64Churns % _countof( siTestRates ) );
+
+      /// - Check the oldest stream's stamp and detach it
+      if ( pLive[ stSlot ] != NULL ) {
+         if ( *(UINT64*) pLive[ stSlot ]->pWindow != u64Stamps[ stSlot ] ) {
+            stErrors++;
+         }
+         goertzelSlabDetach( &sTestSlab, pLive[ stSlot ] );
+      }
+
+      /// - Attach a new one (timed) and check it
+      QueryPerformanceCounter( &before );
+      goertzelContext_t* pContext = goertzelSlabAttach( &sTestSlab, siTestRates[ stRate ] );
+      QueryPerformanceCounter( &after );
+
+      su64TestTicks[ stThread ][ u64Churns % GOERTZEL_SLAB_TEST_SAMPLES ] = (UINT64) ( after.QuadPart - before.QuadPart );
+
+      pLive[ stSlot ] = pContext;
+      if ( pContext == NULL ) {
+         stErrors++;
+         u64Churns++;
+         continue;
+      }
+
+      if ( pContext->stWindowSize != sTestReference[ stRate ].stWindowSize
+        || pContext->pWindow[ pContext->stWindowSize - 1 ] != PCM_8_BIT_SILENCE
+        || memcmp( pContext->tones, sTestReference[ stRate ].tones, sizeof( pContext->tones ) ) != 0 ) {
+         stErrors++;
+      }
+
+      u64Stamps[ stSlot ] = ( (UINT64) stThread << 56 ) | u64Churns;
+      *(UINT64*) pContext->pWindow = u64Stamps[ stSlot ];
+
+      u64Churns++;
+   }
+
+   for ( size_t i = 0 ; i < GOERTZEL_SLAB_TEST_LIVE ; i++ ) {
+      if ( pLive[ i ] != NULL ) {
+         goertzelSlabDetach( &sTestSlab, pLive[ i ] );
+      }
+   }
+
+   su64TestChurns[ stThread ] = u64Churns;
+   sstTestErrors[ stThread ]  = stErrors;
+
+   return 0;
+}
+
+
+/// Compare two UINT64s for `qsort`
+///
+/// @param p1 The first UINT64
+/// @param p2 The second UINT64
+/// @return `< 0`, `0` or `> 0`
+static int __cdecl goertzelSlabCompareU64( _In_ const void* p1, _In_ const void* p2 ) {
+   UINT64 u1 = *(const UINT64*) p1;
+   UINT64 u2 = *(const UINT64*) p2;
+
+   return ( u1 < u2 ) ? -1 : ( u1 > u2 ) ? 1 : 0;
+}
+
+
+/// Run one pass of #goertzelSlabTest
+///
+/// @param bChurn `true` to churn while decoding
+/// @return `true` if the threads ran.  `false` if they didn't start.
+static bool goertzelSlabTestPass( _In_ const bool bChurn ) {
+   HANDLE hThreads[ GOERTZEL_SLAB_TEST_DECODERS + GOERTZEL_SLAB_TEST_CHURNERS ] = { NULL };
+   size_t stThreads = 0;
+   bool   bStarted  = true;
+
+   slTestGo = 0;
+   ZeroMemory( su64TestAnalyses, sizeof( su64TestAnalyses ) );
+   ZeroMemory( su64TestChurns,   sizeof( su64TestChurns ) );
+   ZeroMemory( sstTestErrors,    sizeof( sstTestErrors ) );
+
+   for ( size_t i = 0 ; i < GOERTZEL_SLAB_TEST_DECODERS && bStarted ; i++ ) {
+      hThreads[ stThreads ] = CreateThread( NULL, 0, goertzelSlabTestDecoder, (LPVOID) (UINT_PTR) i, 0, NULL );
+      bStarted = hThreads[ stThreads++ ] != NULL;
+   }
+
+   for ( size_t i = 0 ; i < GOERTZEL_SLAB_TEST_CHURNERS && bStarted && bChurn ; i++ ) {
+      hThreads[ stThreads ] = CreateThread( NULL, 0, goertzelSlabTestChurner, (LPVOID) (UINT_PTR) i, 0, NULL );
+      bStarted = hThreads[ stThreads++ ] != NULL;
+   }
+
+   if ( bStarted ) {
+      InterlockedExchange( &slTestGo, 1 );
+      Sleep( GOERTZEL_SLAB_TEST_MS );
+   } else {
+      LOG_WARN_R( IDS_GOERTZEL_SLAB_TEST_FAILED_TO_START );  // "Failed to start the slab test threads.  Continuing."
+   }
+
+   InterlockedExchange( &slTestGo, 2 );
+
+   for ( size_t i = 0 ; i < stThreads ; i++ ) {
+      if ( hThreads[ i ] != NULL ) {
+         WaitForSingleObject( hThreads[ i ], INFINITE );
+         CloseHandle( hThreads[ i ] );
+      }
+   }
+
+   return bStarted;
+}
+
+
+/// Measure the sustained attach/detach rate while other threads decode
+///
+/// #GOERTZEL_SLAB_TEST_DECODERS threads decode #GOERTZEL_SLAB_TEST_STREAMS
+/// streams each -- first alone, then while #GOERTZEL_SLAB_TEST_CHURNERS
+/// threads attach and detach decoders at 8, 16, 44.1 and 48kHz as fast as
+/// they can.  Logs the attach/detach rate, the attach time percentiles and
+/// the decoding throughput with and without the churn.  It doesn't need a
+/// window or an audio device, so it runs with `/benchmark`.
+///
+/// @return `true` if every decoder was set up right and none was handed out
+///         twice.  `false` if there was a problem.
+bool goertzelSlabTest() {
+   LARGE_INTEGER frequency;
+   QueryPerformanceFrequency( &frequency );
+
+   for ( size_t i = 0 ; i < _countof( siTestRates ) ; i++ ) {
+      goertzelContextInit( &sTestReference[ i ], siTestRates[ i ], NULL );
+   }
+
+   goertzelSlabInit( &sTestSlab, 0 );
+
+   /// - Decode alone, then decode while churning
+   bool bResult = goertzelSlabTestPass( false );
+
+   UINT64 u64Quiet = 0;
+   for ( size_t i = 0 ; i < GOERTZEL_SLAB_TEST_DECODERS ; i++ ) {
+      u64Quiet += su64TestAnalyses[ i ];
+   }
+
+   bResult = goertzelSlabTestPass( true ) && bResult;
+
+   UINT64 u64Analyses = 0;
+   UINT64 u64Churns   = 0;
+   size_t stErrors    = 0;
+   size_t stSamples   = 0;
+
+   /// The attach times are sorted as one flat array
+   UINT64* pTicks = &su64TestTicks[ 0 ][ 0 ];
+
+   for ( size_t i = 0 ; i < GOERTZEL_SLAB_TEST_DECODERS ; i++ ) {
+      u64Analyses += su64TestAnalyses[ i ];
+   }
+
+   for ( size_t i = 0 ; i < GOERTZEL_SLAB_TEST_CHURNERS ; i++ ) {
+      u64Churns += su64TestChurns[ i ];
+      stErrors  += sstTestErrors[ i ];
+
+      /// - Gather each churning thread's attach times at the front of the
+      ///   array to sort them together
+      const size_t stKept = ( su64TestChurns[ i ] < GOERTZEL_SLAB_TEST_SAMPLES ) ? (size_t) su64TestChurns[ i ] : GOERTZEL_SLAB_TEST_SAMPLES;
+      MoveMemory( pTicks + stSamples, su64TestTicks[ i ], stKept * sizeof( UINT64 ) );
+      stSamples += stKept;
+   }
+
+   if ( sTestSlab.l64Attached != 0 ) {
+      stErrors++;  // Something wasn't given back
+   }
+
+   const LONG64 l64Chunks = sTestSlab.l64Chunks;
+
+   goertzelSlabRelease( &sTestSlab );
+
+   if ( !bResult || stSamples == 0 ) {
+      return false;
+   }
+
+   qsort( pTicks, stSamples, sizeof( UINT64 ), goertzelSlabCompareU64 );
+
+   const double usPerTick = 1.0e6 / (double) frequency.QuadPart;
+   const double dSeconds  = GOERTZEL_SLAB_TEST_MS / 1000.0;
+
+   LOG_INFO_R( IDS_GOERTZEL_SLAB_TEST_RESULT,  // "Slab test:  Attach/detach: %.0f per second   Attach p50: %.2f us   p99: %.2f us   Analyses/s: %.0f while churning, %.0f without   Chunks: %lld   Errors: %zu"
+      (double) u64Churns / dSeconds,
+      (double) pTicks[ ( stSamples - 1 ) / 2 ] * usPerTick,
+      (double) pTicks[ ( stSamples - 1 ) * 99 / 100 ] * usPerTick,
+      (double) u64Analyses / dSeconds,
+      (double) u64Quiet / dSeconds,
+      l64Chunks,
+      stErrors );
+
+   if ( stErrors > 0 ) {
+      LOG_WARN_R( IDS_GOERTZEL_SLAB_TEST_FAILED, stErrors );  // "The slab test failed:  %zu decoders were set up wrong or handed out twice.  Continuing."
+      return false;
+   }
+
+   return true;
+}
@@ -0,0 +1,56 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// A lock-free slab allocator for stream decoders (#goertzelContext_t)
+///
+/// @file    goertzelSlab.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>      // For SLIST_HEADER, SRWLOCK, etc.
+
+#include "mvcModel.h"     // For dtmfTones_t
+#include "goertzel.h"     // For goertzelContext_t
+
+
+/// The sample rate classes.  Every decoder in a class has a window that's
+/// big enough for the class' highest rate.
+typedef enum {
+   GOERTZEL_SLAB_CLASS_8K = 0,  ///< Up to 8kHz (narrowband telephony)
+   GOERTZEL_SLAB_CLASS_16K,     ///< Up to 16kHz (wideband telephony)
+   GOERTZEL_SLAB_CLASS_48K,     ///< Up to #GOERTZEL_CONTEXT_MAX_RATE
+   GOERTZEL_SLAB_CLASS_COUNT    ///< The number of classes
+} goertzelSlabClass_t;
+
+/// The number of decoders a slab carves from each chunk it allocates
+#define GOERTZEL_SLAB_CHUNK (256)
+
+
+/// A chunk of decoders (the header at the start of each allocation)
+typedef struct goertzelSlabChunk_t goertzelSlabChunk_t;
+
+
+/// The decoders of one NUMA node, in a free list per sample rate class.
+/// #goertzelSlabAttach and #goertzelSlabDetach are one interlocked pop or
+/// push.  Only when a class runs dry does a thread take #lock to carve a
+/// new chunk.
+typedef struct {
+   SLIST_HEADER         free[ GOERTZEL_SLAB_CLASS_COUNT ];  ///< Each class' free decoders
+   SRWLOCK              lock;         ///< Held while a chunk is added
+   size_t               stNode;       ///< The NUMA node the chunks come from (see #numaPlaceAlloc)
+   goertzelSlabChunk_t* pChunks;      ///< Every chunk, so #goertzelSlabRelease can free them
+   volatile LONG64      l64Chunks;    ///< The number of chunks
+   volatile LONG64      l64Attached;  ///< The decoders that are attached
+} goertzelSlab_t;
+
+
+extern void  goertzelSlabInit( _Out_ goertzelSlab_t* pSlab, _In_ const size_t stNode );
+extern void  goertzelSlabRelease( _Inout_ goertzelSlab_t* pSlab );
+extern goertzelContext_t* goertzelSlabAttach( _Inout_ goertzelSlab_t* pSlab, _In_ const int iSampleRate );
+extern void  goertzelSlabDetach( _Inout_ goertzelSlab_t* pSlab, _In_ goertzelContext_t* pContext );
+extern bool  goertzelSlabTest();
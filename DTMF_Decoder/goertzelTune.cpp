@@ -0,0 +1,870 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Pick the Goertzel kernel, work threads and hop for this machine
+///
+/// The fastest way to run the DFT depends on the machine.  One thread per
+/// tone (the original design) spreads the work out, but every buffer pays
+/// for waking 8 threads and waiting for all of them.  On some machines that
+/// costs more than it saves.  The SIMD kernel does all 8 tones in one pass,
+/// and how it compares to the others depends on the window, which depends
+/// on the sample rate.
+///
+/// So, when the DFT starts, #goertzelTuneRun measures every combination
+/// this build has:  Each kernel (#goertzelKernel_t) with the DFT on the
+/// capture thread or on 1, 2, 4 or 8 work threads (the SIMD kernel can't be
+/// split, so it's 0 or 1).  Each one analyzes a window of synthetic DTMF
+/// at the device's sample rate #GOERTZEL_TUNE_RUNS times (or for
+/// #GOERTZEL_TUNE_MAX_MS), dispatched the same way
+/// #goertzel_compute_dtmf_tones dispatches it.  That usually takes a few
+/// milliseconds.
+///
+/// Then it picks:
+///
+///   - The shortest hop (#suTuneHopsMs) that some combination fits into:
+///     Its p99 has to be under #GOERTZEL_TUNE_BUDGET_PCT of the hop.  The
+///     capture thread analyzes at most once per hop.
+///   - Of the combinations that fit, the one with the lowest median
+///
+/// The choice goes into #gGoertzelTuning and into a small cache file
+/// (#GOERTZEL_TUNE_DEFAULT_FILE or `/tunefile:`), keyed by the CPU's
+/// model (from `cpuid`), the sample rate and the version of DTMF Decoder.
+/// The next start on the same machine at the same rate uses the cache and
+/// skips the measurements.  `/retune` measures anyway and `/notune` keeps
+/// the original configuration (#gGoertzelTuning's initial value).
+///
+/// #goertzelTuneTest runs the measurements at 8, 16 and 48kHz and checks
+/// that every combination computes the same tones.  It runs with
+/// `/benchmark`.
+///
+/// ### APIs Used
+/// << Print Module API Documentation >>
+///
+/// @file    goertzelTune.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <intrin.h>       // For __cpuid
+#include <math.h>         // For fabsf
+#include <stdio.h>        // For sprintf_s()
+#include <stdlib.h>       // For qsort() and strtoul()
+#include <string.h>       // For strchr() and strcmp()
+#include <wchar.h>        // For wcsstr
+
+#include "version.h"      // For FULL_VERSION
+#include "mvcModel.h"     // For gPcmQueue and gDtmfTones
+#include "rtSched.h"      // For the real-time scheduling policy
+#include "dtmfCorpus.h"   // For the synthetic DTMF
+#include "goertzel.h"     // For gGoertzelTuning
+#include "goertzelTune.h" // For yo bad self
+
+
+/// The analyses each combination runs before it's timed
+#define GOERTZEL_TUNE_WARMUP     (20)
+
+/// The analyses each combination is timed for
+#define GOERTZEL_TUNE_RUNS       (200)
+
+/// The most time (in ms) spent timing one combination.  A combination
+/// that's this slow is nowhere near the budget, so its remaining runs are
+/// skipped (this keeps a machine with slow thread wakeups from starting
+/// slowly).
+#define GOERTZEL_TUNE_MAX_MS     (100)
+
+/// An analysis has to fit in this percent of a hop (at p99).  The rest is
+/// for converting the buffer, publishing the results and everything else
+/// that's running.
+#define GOERTZEL_TUNE_BUDGET_PCT (25)
+
+/// The most combinations #goertzelTuneMeasureAll measures
+#define GOERTZEL_TUNE_MAX_CANDIDATES ( GOERTZEL_KERNEL_COUNT * 5 )
+
+/// The largest cache file that's read
+#define GOERTZEL_TUNE_MAX_FILE   (8192)
+
+/// The fields in a line of the cache file:  Version, sample rate, kernel,
+/// work threads, hop (in ms) and CPU, separated by tabs
+#define GOERTZEL_TUNE_FIELDS     (6)
+
+
+/// The numbers of work threads that are measured.  `0` runs the DFT on the
+/// capture thread.  Each must divide #NUMBER_OF_DTMF_TONES evenly.
+static const UINT32 suTuneWorkers[] = { 0, 1, 2, 4, NUMBER_OF_DTMF_TONES };
+
+/// The hops to choose from (in ms), shortest first.  Most devices deliver a
+/// buffer every 10ms, so the shortest hop analyzes every buffer, like the
+/// original configuration.
+static const UINT32 suTuneHopsMs[] = { 10, 20 };
+
+
+/// One combination and how it did
+typedef struct {
+   goertzelTuning_t tuning;                         ///< The kernel and work threads (the hop isn't measured)
+   double           p50Us;                          ///< The median time to analyze a window (in microseconds)
+   double           p99Us;                          ///< The 99th percentile time to analyze a window (in microseconds)
+   dtmfTones_t      tones[ NUMBER_OF_DTMF_TONES ];  ///< What it computed
+} goertzelTuneCandidate_t;
+
+
+static bool  sbEnabled = true;    ///< `false` with `/notune`
+static bool  sbRetune  = false;   ///< `true` with `/retune`
+static WCHAR swsFile[ MAX_PATH ]         = GOERTZEL_TUNE_DEFAULT_FILE;  ///< The tuning cache
+static WCHAR swsTempFile[ MAX_PATH + 4 ] = L"";                         ///< #swsFile + `.tmp`
+
+static HANDLE           shTuneStart = NULL;                                ///< Stands in for #ghStartDFTevent
+static HANDLE           shTuneDone[ NUMBER_OF_DTMF_TONES ]    = { NULL };  ///< Stands in for #ghDoneDFTevents
+static HANDLE           shTuneThreads[ NUMBER_OF_DTMF_TONES ] = { NULL };  ///< The work threads being measured
+static volatile LONG    slTuneRunning = 0;                                 ///< `0` tells the work threads to end
+static goertzelTuning_t sTuneCandidate;                                    ///< The combination being measured
+static dtmfTones_t      sTuneTones[ NUMBER_OF_DTMF_TONES ];                ///< Stands in for #gDtmfTones, so the display never sees the measurements
+
+
+/// Look for `/notune`, `/retune` and `/tunefile:path` on the command line
+///
+/// @param pwszCmdLine The command line passed to #wWinMain
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL goertzelTuneParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine ) {
+   /// #### Function
+
+   sbEnabled = true;
+   sbRetune  = false;
+
+   if ( pwszCmdLine != NULL && wcsstr( pwszCmdLine, L"/notune" ) != NULL ) {
+      sbEnabled = false;
+      LOG_INFO_R( IDS_GOERTZEL_TUNE_DISABLED );  // "Autotuning is off"
+   }
+
+   if ( pwszCmdLine != NULL && wcsstr( pwszCmdLine, L"/retune" ) != NULL ) {
+      sbRetune = true;
+   }
+
+   /// - The rest of `/tunefile:` (which may be quoted) is the cache file
+   const WCHAR* pValue = ( pwszCmdLine != NULL ) ? wcsstr( pwszCmdLine, L"/tunefile:" ) : NULL;
+   if ( pValue != NULL ) {
+      pValue += wcslen( L"/tunefile:" );
+
+      WCHAR wEnd = L' ';
+      if ( *pValue == L'"' ) {
+         wEnd = L'"';
+         pValue++;
+      }
+
+      size_t i = 0;
+      while ( *pValue != L'\0' && *pValue != wEnd && i < _countof( swsFile ) - 1 ) {
+         swsFile[ i++ ] = *pValue++;
+      }
+      swsFile[ i ] = L'\0';
+
+      if ( i == 0 ) {
+         RETURN_FATAL( IDS_GOERTZEL_TUNE_INVALID_FILE );  // "The /tunefile file is not valid.  Exiting."
+      }
+   }
+
+   swprintf_s( swsTempFile, _countof( swsTempFile ), L"%s.tmp", swsFile );
+
+   return TRUE;
+}
+
+
+/// Name this machine's CPU:  Its brand string and its signature (family,
+/// model and stepping) from `cpuid`
+///
+/// @param pszCpu  Gets the name
+/// @param stSize  The size of #pszCpu
+static void goertzelTuneCpu( _Out_writes_z_( stSize ) char* pszCpu, _In_ const size_t stSize ) {
+   int  regs[ 4 ];
+   char szBrand[ 49 ] = { 0 };
+
+   __cpuid( regs, 0x80000000 );
+   if ( (unsigned) regs[ 0 ] >= 0x80000004 ) {
+      for ( int i = 0 ; i < 3 ; i++ ) {
+         __cpuid( regs, 0x80000002 + i );
+         CopyMemory( szBrand + i * 16, regs, 16 );
+      }
+   } else {  // No brand string, so use the vendor
+      __cpuid( regs, 0 );
+      CopyMemory( szBrand,     &regs[ 1 ], 4 );
+      CopyMemory( szBrand + 4, &regs[ 3 ], 4 );
+      CopyMemory( szBrand + 8, &regs[ 2 ], 4 );
+   }
+
+   const char* pBrand = szBrand;
+   while ( *pBrand == ' ' ) {
+      pBrand++;  // Brand strings are often padded on the left
+   }
+
+   __cpuid( regs, 1 );
+
+   sprintf_s( pszCpu, stSize, "%s (%08X)", pBrand, (unsigned) regs[ 0 ] );
+}
+
+
+/// @param kernel A kernel
+/// @param pszName A kernel name from the cache file
+/// @return `true` if #pszName is the kernel's name (#goertzelKernelName)
+static bool goertzelTuneIsKernel( _In_ const goertzelKernel_t kernel, _In_z_ const char* pszName ) {
+   PCWSTR pwszKernel = goertzelKernelName( kernel );
+
+   while ( *pwszKernel != L'\0' && (WCHAR) (unsigned char) *pszName == *pwszKernel ) {
+      pwszKernel++;
+      pszName++;
+   }
+
+   return *pwszKernel == L'\0' && *pszName == '\0';
+}
+
+
+/// Split a line of the cache file into its fields (in place)
+///
+/// @param pszLine  The line.  Tabs are replaced with `\0`s.
+/// @param pFields  Gets the start of each field
+/// @return `true` if it's a line with #GOERTZEL_TUNE_FIELDS fields.  `false`
+///         if it's a comment or it isn't valid.
+static bool goertzelTuneSplit( _Inout_z_ char* pszLine, _Out_writes_( GOERTZEL_TUNE_FIELDS ) char** pFields ) {
+   size_t stFields = 0;
+
+   if ( pszLine[ 0 ] == '#' || pszLine[ 0 ] == '\0' ) {
+      return false;
+   }
+
+   pFields[ stFields++ ] = pszLine;
+
+   for ( char* p = pszLine ; *p != '\0' && stFields < GOERTZEL_TUNE_FIELDS ; p++ ) {
+      if ( *p == '\t' ) {
+         *p = '\0';
+         pFields[ stFields++ ] = p + 1;
+      }
+   }
+
+   return stFields == GOERTZEL_TUNE_FIELDS;
+}
+
+
+/// Read the cache file.  If it's longer than #pBuffer, the last line that
+/// fits is probably cut off, so it's left out.
+///
+/// @param pBuffer Gets the file (it's not `\0` terminated)
+/// @param stMax   The size of #pBuffer
+/// @return The bytes read (up to the end of the last whole line).  `0` if
+///         there's no cache file yet.
+static size_t goertzelTuneReadFile( _Out_writes_to_( stMax, return ) char* pBuffer, _In_ const size_t stMax ) {
+   HANDLE hFile = CreateFileW( swsFile, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+   if ( hFile == INVALID_HANDLE_VALUE ) {
+      return 0;
+   }
+
+   DWORD dwRead = 0;
+   if ( !ReadFile( hFile, pBuffer, (DWORD) stMax, &dwRead, NULL ) ) {
+      dwRead = 0;
+   }
+
+   CloseHandle( hFile );
+
+   if ( dwRead == (DWORD) stMax ) {  // There may be more, so drop the partial line
+      while ( dwRead > 0 && pBuffer[ dwRead - 1 ] != '\n' ) {
+         dwRead--;
+      }
+   }
+
+   return dwRead;
+}
+
+
+/// Find the end of a line of the cache file (without changing it)
+///
+/// @param pLine   The start of the line
+/// @param pstLine Gets the length of the line, without its `\r\n`
+/// @return The start of the next line
+static const char* goertzelTuneNextLine( _In_z_ const char* pLine, _Out_ size_t* pstLine ) {
+   const char* pEnd = strchr( pLine, '\n' );
+   if ( pEnd == NULL ) {
+      pEnd = pLine + strlen( pLine );
+   }
+
+   const char* pNext = ( *pEnd == '\n' ) ? pEnd + 1 : pEnd;
+
+   if ( pEnd > pLine && pEnd[ -1 ] == '\r' ) {
+      pEnd--;
+   }
+
+   *pstLine = (size_t) ( pEnd - pLine );
+
+   return pNext;
+}
+
+
+/// @param pLine       A line of the cache file
+/// @param stLine      The length of the line (without its `\r\n`)
+/// @param pszCpu      This machine's CPU (from #goertzelTuneCpu)
+/// @param iSampleRate Samples per second
+/// @return `true` if it's a valid line for another machine or rate, so
+///         #goertzelTuneSave keeps it
+static bool goertzelTuneKeepLine( _In_reads_( stLine ) const char* pLine, _In_ const size_t stLine, _In_z_ const char* pszCpu, _In_ const int iSampleRate ) {
+   char  sLine[ 256 ];
+   char* pFields[ GOERTZEL_TUNE_FIELDS ];
+
+   if ( stLine >= _countof( sLine ) ) {
+      return false;
+   }
+
+   CopyMemory( sLine, pLine, stLine );
+   sLine[ stLine ] = '\0';
+
+   return goertzelTuneSplit( sLine, pFields )
+       && !( strtoul( pFields[ 1 ], NULL, 10 ) == (unsigned long) iSampleRate && strcmp( pFields[ 5 ], pszCpu ) == 0 );
+}
+
+
+/// Look for this machine, rate and version in the cache file
+///
+/// @param pszCpu      This machine's CPU (from #goertzelTuneCpu)
+/// @param iSampleRate Samples per second
+/// @param pTuning     Gets the cached choice
+/// @return `true` if it was found.  `false` if it has to be measured.
+static bool goertzelTuneLoad( _In_z_ const char* pszCpu, _In_ const int iSampleRate, _Out_ goertzelTuning_t* pTuning ) {
+   char sFile[ GOERTZEL_TUNE_MAX_FILE + 1 ];
+
+   sFile[ goertzelTuneReadFile( sFile, GOERTZEL_TUNE_MAX_FILE ) ] = '\0';
+
+   char* pLine = sFile;
+   while ( *pLine != '\0' ) {
+      char* pNext = strchr( pLine, '\n' );
+      if ( pNext != NULL ) {
+         *pNext++ = '\0';
+      } else {
+         pNext = pLine + strlen( pLine );
+      }
+
+      char* pCr = strchr( pLine, '\r' );
+      if ( pCr != NULL ) {
+         *pCr = '\0';
+      }
+
+      char* pFields[ GOERTZEL_TUNE_FIELDS ];
+
+      if ( goertzelTuneSplit( pLine, pFields )
+        && strcmp( pFields[ 0 ], FULL_VERSION ) == 0
+        && strtoul( pFields[ 1 ], NULL, 10 ) == (unsigned long) iSampleRate
+        && strcmp( pFields[ 5 ], pszCpu ) == 0 ) {
+
+         /// - The line is for us, but it only counts if everything in it
+         ///   still makes sense
+         pTuning->uWorkers = (UINT32) strtoul( pFields[ 3 ], NULL, 10 );
+         pTuning->uHopMs   = (UINT32) strtoul( pFields[ 4 ], NULL, 10 );
+
+         bool bValid = false;
+         for ( int k = 0 ; k < GOERTZEL_KERNEL_COUNT ; k++ ) {
+            if ( goertzelKernelAvailable( (goertzelKernel_t) k ) && goertzelTuneIsKernel( (goertzelKernel_t) k, pFields[ 2 ] ) ) {
+               pTuning->kernel = (goertzelKernel_t) k;
+               bValid = true;
+            }
+         }
+
+         bool bWorkers = false;
+         for ( size_t w = 0 ; w < _countof( suTuneWorkers ) ; w++ ) {
+            bWorkers = bWorkers || pTuning->uWorkers == suTuneWorkers[ w ];
+         }
+
+         return bValid && bWorkers
+             && ( pTuning->kernel != GOERTZEL_KERNEL_SIMD || pTuning->uWorkers <= 1 )
+             && pTuning->uHopMs <= 1000;
+      }
+
+      pLine = pNext;
+   }
+
+   return false;
+}
+
+
+/// Save a choice in the cache file.  The lines for other machines and
+/// rates are kept (the file may be on a share), and any older line for this
+/// machine and rate is replaced.  The file never grows past
+/// #GOERTZEL_TUNE_MAX_FILE:  If the new line doesn't fit, the oldest lines
+/// are dropped.
+///
+/// @param pszCpu      This machine's CPU (from #goertzelTuneCpu)
+/// @param iSampleRate Samples per second
+/// @param pTuning     The choice
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+static BOOL goertzelTuneSave( _In_z_ const char* pszCpu, _In_ const int iSampleRate, _In_ const goertzelTuning_t* pTuning ) {
+   char   sOld[ GOERTZEL_TUNE_MAX_FILE + 1 ];
+   char   sNew[ GOERTZEL_TUNE_MAX_FILE + 1 ];  // The `+ 1` is for sprintf_s' `\0`
+   char   sEntry[ 256 ];
+   size_t stUsed = 0;
+   size_t stEntry;
+   int    iWritten;
+
+   sOld[ goertzelTuneReadFile( sOld, GOERTZEL_TUNE_MAX_FILE ) ] = '\0';
+
+   iWritten = sprintf_s( sNew, _countof( sNew ), "# DTMF Decoder tuning cache:  version, sample rate, kernel, work threads, hop (ms), CPU\r\n" );
+   stUsed += ( iWritten > 0 ) ? (size_t) iWritten : 0;
+
+   iWritten = sprintf_s( sEntry, _countof( sEntry ), "%s\t%d\t%ls\t%u\t%u\t%s\r\n",
+      FULL_VERSION, iSampleRate, goertzelKernelName( pTuning->kernel ), pTuning->uWorkers, pTuning->uHopMs, pszCpu );
+   stEntry = ( iWritten > 0 ) ? (size_t) iWritten : 0;
+
+   /// - Add up the lines that are kept.  If they don't all fit with the new
+   ///   line, drop enough of the oldest (the first) to make room.
+   size_t      stKept = 0;
+   size_t      stLine;
+   const char* pLine = sOld;
+
+   while ( *pLine != '\0' ) {
+      const char* pNext = goertzelTuneNextLine( pLine, &stLine );
+
+      if ( goertzelTuneKeepLine( pLine, stLine, pszCpu, iSampleRate ) ) {
+         stKept += stLine + 2;  // + `\r\n`
+      }
+
+      pLine = pNext;
+   }
+
+   const size_t stRoom = GOERTZEL_TUNE_MAX_FILE - stUsed - stEntry;
+   size_t       stDrop = ( stKept > stRoom ) ? stKept - stRoom : 0;
+
+   pLine = sOld;
+   while ( *pLine != '\0' ) {
+      const char* pNext = goertzelTuneNextLine( pLine, &stLine );
+
+      if ( goertzelTuneKeepLine( pLine, stLine, pszCpu, iSampleRate ) ) {
+         if ( stDrop > 0 ) {
+            stDrop -= ( stLine + 2 < stDrop ) ? stLine + 2 : stDrop;
+         } else {
+            iWritten = sprintf_s( sNew + stUsed, _countof( sNew ) - stUsed, "%.*s\r\n", (int) stLine, pLine );
+            stUsed += ( iWritten > 0 ) ? (size_t) iWritten : 0;
+         }
+      }
+
+      pLine = pNext;
+   }
+
+   iWritten = sprintf_s( sNew + stUsed, _countof( sNew ) - stUsed, "%s", sEntry );
+   stUsed += ( iWritten > 0 ) ? (size_t) iWritten : 0;
+
+   /// - Write it to a temporary file, then replace the cache with it
+   HANDLE hFile = CreateFileW( swsTempFile, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+   if ( hFile == INVALID_HANDLE_VALUE ) {
+      LOG_WARN_R( IDS_GOERTZEL_TUNE_FAILED_TO_WRITE_FILE, swsFile );  // "Failed to write the tuning cache [%s].  Continuing."
+      return FALSE;
+   }
+
+   DWORD dwWritten = 0;
+   BOOL  br = WriteFile( hFile, sNew, (DWORD) stUsed, &dwWritten, NULL );
+   CloseHandle( hFile );
+
+   if ( br && dwWritten == (DWORD) stUsed ) {
+      br = MoveFileExW( swsTempFile, swsFile, MOVEFILE_REPLACE_EXISTING );
+   } else {
+      br = FALSE;
+   }
+
+   if ( !br ) {
+      LOG_WARN_R( IDS_GOERTZEL_TUNE_FAILED_TO_WRITE_FILE, swsFile );  // "Failed to write the tuning cache [%s].  Continuing."
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/// A work thread being measured.  It's #goertzelWorkThread without the
+/// display:  It waits for #shTuneStart, computes its share of
+/// #sTuneTones and signals its #shTuneDone.
+///
+/// @param pContext The thread's index
+/// @return `0`
+static DWORD WINAPI goertzelTuneWorkThread( _In_ LPVOID pContext ) {
+   const size_t stWorker = (size_t) (UINT_PTR) pContext;
+   const size_t stFirst  = stWorker * NUMBER_OF_DTMF_TONES / sTuneCandidate.uWorkers;
+   const size_t stLast   = ( stWorker + 1 ) * NUMBER_OF_DTMF_TONES / sTuneCandidate.uWorkers;
+
+   rtSchedThread_t rtThread;
+   rtSchedEnter( RT_SCHED_ROLE_DSP, stWorker, &rtThread );  // Like the real work threads.  It still runs if it fails.
+
+   while ( true ) {
+      WaitForSingleObject( shTuneStart, INFINITE );
+      if ( slTuneRunning == 0 ) {  // A volatile read has acquire semantics in MSVC
+         break;
+      }
+
+      goertzelRunKernelRange( sTuneCandidate.kernel, sTuneTones, stFirst, stLast );
+
+      SetEvent( shTuneDone[ stWorker ] );
+   }
+
+   rtSchedLeave( &rtThread );
+
+   return 0;
+}
+
+
+/// Compare two doubles for `qsort`
+///
+/// @param p1 The first double
+/// @param p2 The second double
+/// @return `< 0`, `0` or `> 0`
+static int __cdecl goertzelTuneCompareDouble( _In_ const void* p1, _In_ const void* p2 ) {
+   double d1 = *(const double*) p1;
+   double d2 = *(const double*) p2;
+
+   return ( d1 < d2 ) ? -1 : ( d1 > d2 ) ? 1 : 0;
+}
+
+
+/// Time one combination on #gPcmQueue
+///
+/// @param pCandidate The combination.  Gets its times and tones.
+/// @return `true` if it ran.  `false` if its work threads didn't start.
+static bool goertzelTuneMeasure( _Inout_ goertzelTuneCandidate_t* pCandidate ) {
+   const UINT32 uWorkers = pCandidate->tuning.uWorkers;
+
+   sTuneCandidate = pCandidate->tuning;
+   CopyMemory( sTuneTones, gDtmfTones, sizeof( sTuneTones ) );  // For the coefficients
+
+   bool bStarted = true;
+
+   /// - Start the work threads (if any), with the same events
+   ///   #goertzel_Start uses
+   if ( uWorkers > 0 ) {
+      slTuneRunning = 1;
+      shTuneStart   = CreateEventW( NULL, TRUE, FALSE, NULL );  // Manually reset, like #ghStartDFTevent
+      bStarted      = shTuneStart != NULL;
+
+      for ( UINT32 i = 0 ; i < uWorkers && bStarted ; i++ ) {
+         shTuneDone[ i ]    = CreateEventW( NULL, FALSE, FALSE, NULL );  // Automatically reset, like #ghDoneDFTevents
+         shTuneThreads[ i ] = ( shTuneDone[ i ] != NULL ) ? CreateThread( NULL, 0, goertzelTuneWorkThread, (LPVOID) (UINT_PTR) i, 0, NULL ) : NULL;
+         bStarted           = shTuneThreads[ i ] != NULL;
+      }
+   }
+
+   /// - Time each analysis the way #goertzel_compute_dtmf_tones runs it
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER start;
+   LARGE_INTEGER end;
+   LARGE_INTEGER first;
+   double        dUs[ GOERTZEL_TUNE_RUNS ];
+   size_t        stRuns = 0;
+
+   QueryPerformanceFrequency( &frequency );
+   QueryPerformanceCounter( &first );
+
+   const LONGLONG llMaxTicks = frequency.QuadPart * GOERTZEL_TUNE_MAX_MS / 1000;
+
+   for ( size_t run = 0 ; run < GOERTZEL_TUNE_WARMUP + GOERTZEL_TUNE_RUNS && bStarted ; run++ ) {
+      QueryPerformanceCounter( &start );
+
+      if ( uWorkers == 0 ) {
+         goertzelRunKernelRange( sTuneCandidate.kernel, sTuneTones, 0, NUMBER_OF_DTMF_TONES );
+      } else {
+         SetEvent( shTuneStart );
+         WaitForMultipleObjects( uWorkers, shTuneDone, TRUE, INFINITE );
+         ResetEvent( shTuneStart );
+      }
+
+      QueryPerformanceCounter( &end );
+
+      if ( run >= GOERTZEL_TUNE_WARMUP ) {
+         dUs[ stRuns++ ] = (double) ( end.QuadPart - start.QuadPart ) * 1.0e6 / (double) frequency.QuadPart;
+      }
+
+      if ( end.QuadPart - first.QuadPart > llMaxTicks ) {
+         if ( stRuns == 0 ) {  // It's too slow to warm up, so time one run
+            dUs[ stRuns++ ] = (double) ( end.QuadPart - start.QuadPart ) * 1.0e6 / (double) frequency.QuadPart;
+         }
+         break;
+      }
+   }
+
+   /// - Stop the work threads
+   InterlockedExchange( &slTuneRunning, 0 );
+   if ( shTuneStart != NULL ) {
+      SetEvent( shTuneStart );
+   }
+
+   for ( size_t i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+      if ( shTuneThreads[ i ] != NULL ) {
+         WaitForSingleObject( shTuneThreads[ i ], INFINITE );
+         CloseHandle( shTuneThreads[ i ] );
+         shTuneThreads[ i ] = NULL;
+      }
+      if ( shTuneDone[ i ] != NULL ) {
+         CloseHandle( shTuneDone[ i ] );
+         shTuneDone[ i ] = NULL;
+      }
+   }
+
+   if ( shTuneStart != NULL ) {
+      CloseHandle( shTuneStart );
+      shTuneStart = NULL;
+   }
+
+   if ( !bStarted ) {
+      return false;
+   }
+
+   _ASSERTE( stRuns > 0 );
+
+   qsort( dUs, stRuns, sizeof( double ), goertzelTuneCompareDouble );
+
+   pCandidate->p50Us = dUs[ ( stRuns - 1 ) / 2 ];
+   pCandidate->p99Us = dUs[ ( stRuns - 1 ) * 99 / 100 ];
+   CopyMemory( pCandidate->tones, sTuneTones, sizeof( pCandidate->tones ) );
+
+   return true;
+}
+
+
+/// Time every combination this build has on a window of synthetic DTMF.
+/// #gPcmQueue and the coefficients in #gDtmfTones must already be set up for
+/// the sample rate (by #pcmSetQueueSize and #goertzel_SetSampleRate).
+/// #gPcmQueue is silent again when it's done.
+///
+/// @param iSampleRate Samples per second
+/// @param pCandidates Gets the combinations.  The first is the C kernel on
+///                    the calling thread (the reference).
+/// @return The number of combinations.  `0` if there was a problem.
+static size_t goertzelTuneMeasureAll( _In_ const int iSampleRate, _Out_writes_( GOERTZEL_TUNE_MAX_CANDIDATES ) goertzelTuneCandidate_t* pCandidates ) {
+   _ASSERTE( gPcmQueue != NULL );
+   _ASSERTE( gstQueueSize > 0 );
+
+   /// - Fill the window with a digit
+   dtmfCorpusConfig_t config;
+   ZeroMemory( &config, sizeof( config ) );
+
+   config.uSampleRate = (UINT32) iSampleRate;
+   config.uToneMs     = SIZE_OF_QUEUE_IN_MS;
+   config.uGapMs      = SIZE_OF_QUEUE_IN_MS;
+   config.fAmplitude  = 50.0f;
+   config.fSnrDb      = DTMF_CORPUS_NO_NOISE;
+   config.uSeed       = 1;
+
+   dtmfCorpus_t corpus;
+   if ( !dtmfCorpusInit( &corpus, &config, L"5" ) ) {
+      return 0;
+   }
+
+   dtmfCorpusRender( &corpus, gPcmQueue, gstQueueSize );
+   gstQueueHead = 0;
+
+   /// - Time each kernel on the capture thread and on each number of work
+   ///   threads
+   size_t stCandidates = 0;
+   bool   bStarted     = true;
+
+   for ( int k = 0 ; k < GOERTZEL_KERNEL_COUNT && bStarted ; k++ ) {
+      const goertzelKernel_t kernel = (goertzelKernel_t) k;
+      if ( !goertzelKernelAvailable( kernel ) ) {
+         continue;
+      }
+
+      for ( size_t w = 0 ; w < _countof( suTuneWorkers ) && bStarted ; w++ ) {
+         if ( kernel == GOERTZEL_KERNEL_SIMD && suTuneWorkers[ w ] > 1 ) {
+            continue;  // The SIMD kernel does all 8 tones in one pass
+         }
+
+         goertzelTuneCandidate_t* pCandidate = &pCandidates[ stCandidates ];
+
+         pCandidate->tuning.kernel   = kernel;
+         pCandidate->tuning.uWorkers = suTuneWorkers[ w ];
+         pCandidate->tuning.uHopMs   = 0;
+
+         bStarted = goertzelTuneMeasure( pCandidate );
+         if ( bStarted ) {
+            LOG_INFO_R( IDS_GOERTZEL_TUNE_CANDIDATE, goertzelKernelName( kernel ), suTuneWorkers[ w ], pCandidate->p50Us, pCandidate->p99Us );  // "Tuning:  %s kernel   Workers: %u   p50: %.1f us   p99: %.1f us"
+            stCandidates++;
+         }
+      }
+   }
+
+   SecureZeroMemory( gPcmQueue, gstQueueSize );  // Back the way #pcmSetQueueSize left it
+
+   return bStarted ? stCandidates : 0;
+}
+
+
+/// Pick the shortest hop some combination fits into and, of those that fit,
+/// the one with the lowest median
+///
+/// @param pCandidates  The measured combinations
+/// @param stCandidates The number of combinations
+/// @param pChoice      Gets the choice
+/// @return `true` if the choice fits the budget.  `false` if nothing did, so
+///         the steadiest combination was picked with the longest hop.
+static bool goertzelTuneChoose(
+   _In_reads_( stCandidates ) const goertzelTuneCandidate_t* pCandidates,
+   _In_                       const size_t                   stCandidates,
+   _Out_                      goertzelTuning_t*              pChoice ) {
+   _ASSERTE( stCandidates > 0 );
+
+   for ( size_t h = 0 ; h < _countof( suTuneHopsMs ) ; h++ ) {
+      const double dBudgetUs = suTuneHopsMs[ h ] * 1000.0 * GOERTZEL_TUNE_BUDGET_PCT / 100.0;
+
+      size_t stBest = stCandidates;
+      for ( size_t c = 0 ; c < stCandidates ; c++ ) {
+         if ( pCandidates[ c ].p99Us <= dBudgetUs && ( stBest == stCandidates || pCandidates[ c ].p50Us < pCandidates[ stBest ].p50Us ) ) {
+            stBest = c;
+         }
+      }
+
+      if ( stBest < stCandidates ) {
+         *pChoice        = pCandidates[ stBest ].tuning;
+         pChoice->uHopMs = suTuneHopsMs[ h ];
+         return true;
+      }
+   }
+
+   size_t stSteadiest = 0;
+   for ( size_t c = 1 ; c < stCandidates ; c++ ) {
+      if ( pCandidates[ c ].p99Us < pCandidates[ stSteadiest ].p99Us ) {
+         stSteadiest = c;
+      }
+   }
+
+   *pChoice        = pCandidates[ stSteadiest ].tuning;
+   pChoice->uHopMs = suTuneHopsMs[ _countof( suTuneHopsMs ) - 1 ];
+
+   return false;
+}
+
+
+/// Pick the kernel, work threads and hop for this machine and sample rate
+/// and put them in #gGoertzelTuning.  The choice comes from the cache file
+/// if it has one for this machine, rate and version.  Otherwise, every
+/// combination is measured and the choice is saved.
+///
+/// Called by #goertzel_Start after #goertzel_SetSampleRate and before the
+/// work threads start.  With `/notune`, it does nothing.
+///
+/// @param iSampleRate Samples per second
+void goertzelTuneRun( _In_ const int iSampleRate ) {
+   if ( !sbEnabled ) {
+      return;  // Keep the original configuration
+   }
+
+   char  szCpu[ 96 ];
+   WCHAR wsCpu[ 96 ];
+
+   goertzelTuneCpu( szCpu, _countof( szCpu ) );
+   for ( size_t i = 0 ; i < _countof( wsCpu ) ; i++ ) {
+      wsCpu[ i ] = (WCHAR) (unsigned char) szCpu[ i ];  // For the log (it's ASCII)
+   }
+
+   goertzelTuning_t tuning;
+
+   /// - Use the cache if it has this machine and rate
+   if ( !sbRetune && goertzelTuneLoad( szCpu, iSampleRate, &tuning ) ) {
+      gGoertzelTuning = tuning;
+      LOG_INFO_R( IDS_GOERTZEL_TUNE_CACHED, wsCpu, iSampleRate, goertzelKernelName( tuning.kernel ), tuning.uWorkers, tuning.uHopMs );  // "Tuning:  Using the cached choice for %s at %d Hz:  %s kernel   Workers: %u   Hop: %u ms"
+      return;
+   }
+
+   /// - Otherwise, measure every combination and pick one
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER start;
+   LARGE_INTEGER end;
+
+   QueryPerformanceFrequency( &frequency );
+   QueryPerformanceCounter( &start );
+
+   goertzelTuneCandidate_t candidates[ GOERTZEL_TUNE_MAX_CANDIDATES ];
+
+   const size_t stCandidates = goertzelTuneMeasureAll( iSampleRate, candidates );
+   if ( stCandidates == 0 ) {
+      LOG_WARN_R( IDS_GOERTZEL_TUNE_FAILED_TO_START );  // "Failed to start the tuning threads.  Keeping the original configuration.  Continuing."
+      return;
+   }
+
+   if ( !goertzelTuneChoose( candidates, stCandidates, &tuning ) ) {
+      LOG_WARN_R( IDS_GOERTZEL_TUNE_OVER_BUDGET, GOERTZEL_TUNE_BUDGET_PCT, tuning.uHopMs );  // "Tuning:  Nothing analyzes a window within %d%% of a %u ms hop.  Using the steadiest.  Continuing."
+   }
+
+   QueryPerformanceCounter( &end );
+
+   gGoertzelTuning = tuning;
+
+   LOG_INFO_R( IDS_GOERTZEL_TUNE_CHOSE,  // "Tuning:  Chose the %s kernel   Workers: %u   Hop: %u ms   for %s at %d Hz (in %.1f ms)"
+      goertzelKernelName( tuning.kernel ), tuning.uWorkers, tuning.uHopMs, wsCpu, iSampleRate,
+      (double) ( end.QuadPart - start.QuadPart ) * 1000.0 / (double) frequency.QuadPart );
+
+   goertzelTuneSave( szCpu, iSampleRate, &tuning );  // Failures are logged as warnings
+}
+
+
+/// Run the tuning measurements at 8, 16 and 48kHz, log what would be picked
+/// and check that every combination computes the same tones as the C kernel
+/// on one thread.  Nothing is cached and #gGoertzelTuning isn't changed.  It
+/// doesn't need a window or an audio device, so it runs with `/benchmark`.
+///
+/// Call it when #gPcmQueue isn't allocated.
+///
+/// @return `true` if every combination ran and matched.  `false` if there was
+///         a problem.
+bool goertzelTuneTest() {
+   static const int siRates[] = { 8000, 16000, 48000 };
+
+   size_t stMismatched = 0;
+   bool   bStarted     = true;
+
+   for ( size_t r = 0 ; r < _countof( siRates ) && bStarted ; r++ ) {
+      if ( !pcmSetQueueSize( (size_t) siRates[ r ] / 1000 * SIZE_OF_QUEUE_IN_MS ) ) {
+         bStarted = false;  // pcmSetQueueSize logged the problem
+         break;
+      }
+
+      goertzel_SetSampleRate( siRates[ r ] );
+
+      goertzelTuneCandidate_t candidates[ GOERTZEL_TUNE_MAX_CANDIDATES ];
+
+      const size_t stCandidates = goertzelTuneMeasureAll( siRates[ r ], candidates );
+
+      pcmReleaseQueue();
+
+      if ( stCandidates == 0 ) {
+         bStarted = false;
+         break;
+      }
+
+      /// - Compare every combination to the first (the C kernel on one
+      ///   thread)
+      _ASSERTE( candidates[ 0 ].tuning.kernel == GOERTZEL_KERNEL_C && candidates[ 0 ].tuning.uWorkers == 0 );
+
+      size_t stRateMismatched = 0;
+      for ( size_t c = 1 ; c < stCandidates ; c++ ) {
+         for ( size_t i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+            const dtmfTones_t* pReference = &candidates[ 0 ].tones[ i ];
+            const dtmfTones_t* pTone      = &candidates[ c ].tones[ i ];
+
+            if ( fabsf( pTone->goertzelMagnitude - pReference->goertzelMagnitude ) > 1.0e-3f * ( 1.0f + pReference->goertzelMagnitude )
+              || fabsf( pTone->totalEnergy - pReference->totalEnergy ) > 1.0e-3f * ( 1.0f + pReference->totalEnergy ) ) {
+               stRateMismatched++;
+               break;
+            }
+         }
+      }
+
+      goertzelTuning_t choice;
+      goertzelTuneChoose( candidates, stCandidates, &choice );
+
+      LOG_INFO_R( IDS_GOERTZEL_TUNE_TEST_RESULT,  // "Tuning test:  %d Hz:  Would choose the %s kernel   Workers: %u   Hop: %u ms   Combinations: %zu   Mismatched: %zu"
+         siRates[ r ], goertzelKernelName( choice.kernel ), choice.uWorkers, choice.uHopMs, stCandidates, stRateMismatched );
+
+      stMismatched += stRateMismatched;
+   }
+
+   if ( !bStarted ) {
+      LOG_WARN_R( IDS_GOERTZEL_TUNE_TEST_FAILED_TO_START );  // "Failed to start the tuning test.  Continuing."
+      return false;
+   }
+
+   if ( stMismatched > 0 ) {
+      LOG_WARN_R( IDS_GOERTZEL_TUNE_TEST_FAILED, stMismatched );  // "The tuning test failed:  %zu combinations computed different tones.  Continuing."
+      return false;
+   }
+
+   return true;
+}
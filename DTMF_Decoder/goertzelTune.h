@@ -0,0 +1,24 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Pick the Goertzel kernel, work threads and hop for this machine
+///
+/// @file    goertzelTune.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>  // For BOOL, etc.
+
+
+/// The tuning cache when `/tunefile` doesn't name one
+#define GOERTZEL_TUNE_DEFAULT_FILE L"DTMF_Tuning.txt"
+
+
+extern BOOL goertzelTuneParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine );
+extern void goertzelTuneRun( _In_ const int iSampleRate );
+extern bool goertzelTuneTest();
@@ -90,4 +90,99 @@ exitForLoop:
 
 goertzel_Magnitude_x64 ENDP
 
+
+; The fused version of goertzel_Magnitude_x64.  It computes the Goertzel
+; magnitude and the sum-of-squares of the window in the same pass over the
+; queue, then stores toneStruct->goertzelMagnitude, toneStruct->totalEnergy
+; and toneStruct->energyRatio.
+;
+; The sum-of-squares is done in the integer registers so it runs alongside
+; the floating point recurrence (and doesn't touch XMM6-15, which are
+; non-volatile).
+;
+; CL   = The UINT8 index (const param 1)
+; RDX  = The 64-bit pointer to the dtmfTone struct (param 2)
+; R8   = gPcmQueue (copied from external size_t)
+; R9   = gPcmQueue + gstQueueSize (marks the end of the queue)
+; R10  = Scratch (centered PCM byte and its square)
+; R11  = Sum of squares
+; XMM0 = q0
+; XMM1 = q1
+; XMM2 = q2
+; XMM3 = coeff
+; XMM4 = Scratch (PCM byte)
+; XMM5 = Scratch
+;
+PCM_8_BIT_SILENCE EQU 127
+
+public goertzel_MagnitudeEnergy_x64
+goertzel_MagnitudeEnergy_x64 PROC
+
+	XOR RAX, RAX                      ; Zero out RAX
+	XOR R11, R11                      ; sumOfSquares = 0
+	MOV  R8, gPcmQueue                ; Read from this point in the Queue
+	MOV  R9, R8
+	ADD  R9, gstQueueSize             ; Read up to this position
+
+	VPXOR XMM1, XMM1, XMM1            ; float q1 = 0;
+	VPXOR XMM2, XMM1, XMM1            ; float q2 = 0;
+	MOVSS XMM3, dword ptr [RDX + 56]  ; Copy toneStruct->coeff into XMM3
+
+forLoopEnergy:
+	CMP R8, R9                        ; gPcmQueue < (gPcmQueue + gstQueueSize);
+	JNB exitForLoopEnergy
+	; Do the work of the for() loop
+
+	MOV        AL, byte ptr [R8]      ; Get the PCM byte from the queue
+	VMULSS   XMM0, XMM3, XMM1         ; q0 = toneStruct->coeff * q1
+	CVTSI2SS XMM4, EAX                ; Copy the PCM byte into XMM4
+	MOV      R10D, EAX                ; centered = the PCM byte
+	VSUBSS   XMM0, XMM0, XMM2         ; q0 -= q2
+	SUB      R10D, PCM_8_BIT_SILENCE  ; centered -= PCM_8_BIT_SILENCE
+	MOVSS    XMM2, XMM1               ; q2 = q1
+	IMUL     R10D, R10D               ; centered * centered (always positive, so R10 is zero-extended)
+	VADDSS   XMM0, XMM0, XMM4         ; q0 += the PCM byte
+	ADD      R11, R10                 ; sumOfSquares += centered * centered
+	MOVSS    XMM1, XMM0               ; q1 = q0
+
+	; Done inside the for() loop
+	INC R8                            ; i++
+	JMP forLoopEnergy
+
+exitForLoopEnergy:
+
+	MOVSS  XMM4, dword ptr [RDX + 52] ; Get toneStruct->cosine
+	MOVSS  XMM5, dword ptr [RDX + 48] ; Get toneStruct->sine
+	MULSS  XMM4, XMM1                 ; q1 * toneStruct->cosine
+	MULSS  XMM5, XMM1                 ; q1 * toneStruct->sine
+	SUBSS  XMM4, XMM2                 ; q1 * toneStruct->cosine - q2
+	MULSS  XMM4, XMM4                 ; real * real
+	MULSS  XMM5, XMM5                 ; imag * imag
+	ADDSS  XMM4, XMM5                 ; real * real + imag * imag
+	MOVSS  XMM5, dword ptr [sfScaleFactor]
+	SQRTSS XMM4, XMM4                 ; Square root
+	DIVSS  XMM4, XMM5                 ; / sfScaleFactor
+	MOVSS  dword ptr [RDX + 44], XMM4 ; Store in toneStruct->goertzelMagnitude
+
+	CVTSI2SS XMM0, R11                ; (float) sumOfSquares
+	MOV      R10, gstQueueSize
+	CVTSI2SS XMM1, R10                ; (float) gstQueueSize
+	DIVSS    XMM0, XMM1               ; energy = sumOfSquares / gstQueueSize
+	MOVSS    dword ptr [RDX + 60], XMM0 ; Store in toneStruct->totalEnergy
+
+	VPXOR    XMM5, XMM5, XMM5         ; ratio = 0
+	UCOMISS  XMM0, XMM5               ; If energy <= 0, leave the ratio at 0
+	JBE      storeRatio
+	MULSS    XMM4, XMM4               ; magnitude * magnitude
+	ADDSS    XMM0, XMM0               ; 2 * energy
+	DIVSS    XMM4, XMM0               ; ( magnitude * magnitude ) / ( 2 * energy )
+	MOVSS    XMM5, XMM4
+
+storeRatio:
+	MOVSS  dword ptr [RDX + 64], XMM5 ; Store in toneStruct->energyRatio
+
+	RET
+
+goertzel_MagnitudeEnergy_x64 ENDP
+
 END
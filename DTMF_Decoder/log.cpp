@@ -8,6 +8,7 @@
 ///
 /// Requirements for the logger:
 ///   - Log to `OutputDebugString` with the flexibility of `printf`
+///   - Optionally, log to a file without blocking the caller (see logFile.cpp)
 ///   - Both wide and narrow logging
 ///   - For log levels #LOG_LEVEL_FATAL, #LOG_LEVEL_ERROR and #LOG_LEVEL_WARN
 ///     also show a message box and appropriate icon
@@ -57,8 +58,8 @@
 /// very bad things happen.  C'est la vie.
 ///
 /// I'm also storing the a pointer to the instance handle as well.  This is
-/// for getting strings from the resources via `LoadStringW`.  All of the
-/// strings loaded from resources are assumed to be wide (UNICODE).
+/// for preloading the strings from the resources (see logStrings.cpp).  All
+/// of the strings loaded from resources are assumed to be wide (UNICODE).
 ///
 /// When Log functions throw exceptions, they will:
 /// ```
@@ -76,6 +77,11 @@
 /// To that end, we will use the same design pattern to save messages with
 /// #LOG_INFO_Q, #logQ, #logQueueHasEntry, et. al..
 ///
+/// The worker threads only copy a queued message's raw arguments (like the
+/// flight recorder does).  The main thread composes it, sends it to
+/// `OutputDebugStringW`, the file sink and WER and shows it when it dequeues
+/// it (see #logDequeueAndDisplayMessage).
+///
 /// The message IDs stored in this stateful holder should be the same IDs that
 /// can be displayed by the `_R` loggers.
 ///
@@ -110,10 +116,11 @@
 /// ## Threads & Synchronization API
 /// | API                         | Link                                                                                               |
 /// |-----------------------------| ---------------------------------------------------------------------------------------------------|
-/// | `InitializeCriticalSection` | https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-initializecriticalsection |
-/// | `DeleteCriticalSection`     | https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-deletecriticalsection     |
-/// | `EnterCriticalSection`      | https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-entercriticalsection      |
-/// | `LeaveCriticalSection`      | https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-leavecriticalsection      |
+/// | `InterlockedCompareExchange64` | https://learn.microsoft.com/en-us/windows/win32/api/winnt/nf-winnt-interlockedcompareexchange64  |
+/// | `InterlockedExchange64`        | https://learn.microsoft.com/en-us/windows/win32/api/winnt/nf-winnt-interlockedexchange64         |
+/// | `InterlockedIncrement64`       | https://learn.microsoft.com/en-us/windows/win32/api/winnt/nf-winnt-interlockedincrement64        |
+/// | `MemoryBarrier`                | https://learn.microsoft.com/en-us/windows/win32/api/winnt/nf-winnt-memorybarrier                 |
+/// | `CreateThread`                 | https://learn.microsoft.com/en-us/windows/win32/api/processthreadsapi/nf-processthreadsapi-createthread |
 ///
 /// @file    log.cpp
 /// @author  Mark Nelson <marknels@hawaii.edu>
@@ -123,6 +130,10 @@
 #include "log.h"          // For yourself
 #include "log_ex.h"       // For extensions to the log
 #include "logWER.h"       // For logWerEvent
+#include "logStrings.h"   // For the preloaded string table
+#include "logFile.h"      // For the file sink
+#include "logFlight.h"    // For the flight recorder
+#include "logMpsc.h"      // For the log queue
 
 #include <stdio.h>        // For sprintf_s
 #include <stdarg.h>       // For va_start
@@ -147,17 +158,50 @@ WCHAR swAppName [ MAX_LOG_STRING ] = L"";  ///< The (wide) non-localized applica
 WCHAR swAppTitle[ MAX_LOG_STRING ] = L"";  ///< The (wide) localized application name set in #logInit and used as the window title in `MessageBoxW`
 
 
-#define MAX_LOG_QUEUE_DEPTH 16     /**< The maximum depth of the log queue.  Set to `4` when testing. */
+#define MAX_LOG_QUEUE_DEPTH 16     /**< The maximum depth of the log queue.  Must be a power of 2.  Set to `4` when testing. */
 // #define MAX_LOG_QUEUE_DEPTH 4   /**< The maximum depth of the log queue (used for testing) */
-static size_t log_queue_tail = 0;  ///< If the queue is not empty, then point to the first valid node in the queue.
-static size_t log_queue_head = 0;  ///< If the queue is not full, then point to the next available entry in the queue.
-static size_t log_queue_size = 0;  ///< The number of valid entries in the queue
 
-static CRITICAL_SECTION log_queue_critical_section;  ///< Manage the queue in a thread-safe manner
+static_assert( ( MAX_LOG_QUEUE_DEPTH & ( MAX_LOG_QUEUE_DEPTH - 1 ) ) == 0, "MAX_LOG_QUEUE_DEPTH must be a power of 2" );
+
+/// The number of producer threads in #logQueueStressTest
+#define LOG_STRESS_PRODUCERS 8
+
+/// The number of messages each producer sends in #logQueueStressTest
+#define LOG_STRESS_MESSAGES  100000
+
+
+/// One cell in the log queue.  The sequence number says who owns it (see
+/// logMpsc.h).  The message isn't composed until it's dequeued, so the cell
+/// holds everything needed to compose it later.
+struct logCell_t {
+   volatile LONG64 l64Sequence;                  ///< Who owns this cell.  Must be first.
+   logLevels_t     logLevel;                     ///< The level of the message
+   UINT            uResourceId;                  ///< The resource string that formats #logCell_t::args
+   PCWSTR          pwszFunctionName;             ///< The function that logged it (a string literal)
+   PCWSTR          pwszResourceName;             ///< The name of the resource (a string literal)
+   UINT            uArgs;                        ///< The number of arguments in #logCell_t::args
+   UINT64          args[ LOG_FLIGHT_MAX_ARGS ];  ///< The raw arguments (see #logFlightCaptureArgs)
+};
 
-/// An array of log messages that can't be displayed at the time the log is
-/// generated (like in a worker thread or drawing a screen buffer).
-static logEntry_t logQueue[ MAX_LOG_QUEUE_DEPTH ];
+
+static logCell_t logQueueCells[ MAX_LOG_QUEUE_DEPTH ];  ///< The messages in #logQueue
+
+/// A bounded, lock-free, multi-producer / single-consumer queue (logMpsc.h)
+/// of log messages that can't be displayed at the time the log is generated
+/// (like in a worker thread or drawing a screen buffer).
+///
+/// The consumer is the main thread (the only thread that can show a
+/// `MessageBox`).  If the queue is full, the message is dropped and
+/// counted.  It's still in the flight recorder.
+static logMpsc_t logQueue = { (BYTE*) logQueueCells, sizeof( logCell_t ), MAX_LOG_QUEUE_DEPTH };
+
+static bool logEnqueue(
+   _In_       const logLevels_t logLevel,
+   _In_z_     const PCWSTR      functionName,
+   _In_opt_z_ const PCWSTR      resourceName,
+   _In_       const UINT        resourceId,
+   _In_z_     const PCWSTR      format,
+   _In_             va_list     args );
 
 
 /// Initialize the logger
@@ -231,8 +275,10 @@ BOOL logInit(
       }
    }
 
-
-   InitializeCriticalSection( &log_queue_critical_section );
+   /// Load the resource strings (now that we have the instance handle)
+   if ( !logStringsInit() ) {
+      return FALSE;
+   }
 
    /// Call #logQueueReset to reset the message store
    logQueueReset();
@@ -247,6 +293,11 @@ BOOL logInit(
 ///
 /// @return `TRUE` if successful.  `FALSE` if there was a problem.
 BOOL logCleanup() {
+   /// Report any messages that didn't fit in the queue
+   if ( logQueueDropped() > 0 ) {
+      LOG_DEBUG_R( IDS_LOG_QUEUE_DROPPED, logQueueDropped() );  // "The log queue was full.  %llu messages were not queued."
+   }
+
    sphMainWindow = NULL;  /// Set #sphMainWindow to `NULL`
 
    /// No need to clean/erase #sphInstance.  It should be good for the lifetime
@@ -254,8 +305,6 @@ BOOL logCleanup() {
 
    logQueueReset();
 
-   DeleteCriticalSection( &log_queue_critical_section );
-
    return TRUE;
 }
 
@@ -330,7 +379,15 @@ void logA(
 
    OutputDebugStringA( buffer.sBuf );
 
-   /// @todo Convert to wide character.  Maybe use mbstowcs_s to do it.
+   /// Send a wide copy to the file sink
+   WCHAR wsBuf[ MAX_LOG_STRING ];
+   if ( MultiByteToWideChar( CP_ACP, 0, buffer.sBuf, -1, wsBuf, MAX_LOG_STRING ) > 0 ) {
+      logFileWrite( logLevel, wsBuf );
+   }
+
+   if ( logLevel == LOG_LEVEL_FATAL ) {
+      logFileFlush();
+   }
 
    if ( logLevel == LOG_LEVEL_WARN ) {
       MessageBoxA( ( ( sphMainWindow == NULL ) ? NULL : *sphMainWindow ), buffer.sBuf, sAppName, MB_OK | MB_ICONWARNING );
@@ -407,29 +464,23 @@ int vLogComposeW(
 
 /// Get a string from the resource file
 ///
+/// The strings are preloaded by #logStringsInit, so this is an array lookup.
+/// There's no copy, so the string is read-only.
+///
 /// @param resourceId An ID from the string section of the resource file
-/// @param pString    A guarded buffer to receive the string (#BUFFER_GUARD must be set before calling into this function)
-void logGetStringFromResources(
-   _In_   const UINT       resourceId,
-   _Inout_      wBuffer_t* pString ) {
-
-   _ASSERTE( pString->dwGuard == BUFFER_GUARD );
+/// @return The string.  Never `NULL`.
+PCWSTR logGetStringFromResources( _In_ const UINT resourceId ) {
+   PCWSTR pwszString = logGetString( resourceId );
 
-   INT ir;  // INT result
-
-   ir = LoadStringW( *sphInstance, resourceId, pString->sBuf, MAX_LOG_STRING );
    /// Becuse we are in a log routine, it doesn't make sense to log an error
    /// message.  So, if there are problems, then fail fast by throwing an
    /// `_ASSERT_EXPR( FALSE, ...`.
-   if ( !ir ) {
+   if ( pwszString == NULL ) {
       FATAL_IN_LOG( L"Can't find string in resources.  Exiting immediately." );
+      return L"?";
    }
 
-   /// If we overrun the format and violate the stack guard, then fail fast by
-   /// throwing an `_ASSERT_EXPR( FALSE, ...`.
-   if ( pString->dwGuard != BUFFER_GUARD ) {
-      FATAL_IN_LOG( L"VIOLATED STACK GUARD in Logger.  Exiting immediately." );
-   }
+   return pwszString;
 }
 
 
@@ -490,13 +541,20 @@ void vLogW(
 
    // There's no real validation for args
 
+   logFlightRecord( logLevel, resourceId, format, args );
+
    wBuffer_t buffer = { L"", BUFFER_GUARD };
 
    vLogComposeW( logLevel, functionName, format, &buffer, args );
 
    OutputDebugStringW( buffer.sBuf );
+   logFileWrite( logLevel, buffer.sBuf );
    logWerEvent( logLevel, resourceName, resourceId, buffer.sBuf );
 
+   if ( logLevel == LOG_LEVEL_FATAL ) {
+      logFileFlush();  /// Get the reason we're ending into the log file
+   }
+
    if ( logLevel >= LOG_LEVEL_WARN ) {
       logShowMessageW( logLevel, buffer.sBuf );
    }
@@ -541,8 +599,7 @@ void logW(
 /// #LOG_INFO_R.  It is not intended to be called directly.
 ///
 /// Loggers like this (that use resources) **can not** be called before it's
-/// initialized.  The application's instance handle needs to be set for
-/// `LoadStringW` to work.
+/// initialized.  #logInit preloads the strings from the resources.
 ///
 /// @param logLevel        The level of this logging event
 /// @param functionName    The name of the function
@@ -565,13 +622,11 @@ void logR(
    if ( functionName[ 0 ] == L'\0' )
       return;
 
-   wBuffer_t format = { L"", BUFFER_GUARD };
-
-   logGetStringFromResources( resourceId, &format );
+   PCWSTR format = logGetStringFromResources( resourceId );
 
    va_list args;
    va_start( args, resourceId );  // va_start & va_end do not have result codes
-   vLogW( logLevel, functionName, resourceName, resourceId, format.sBuf, args );
+   vLogW( logLevel, functionName, resourceName, resourceId, format, args );
    va_end( args );
 }
 
@@ -581,15 +636,26 @@ void logR(
 /// This is used at times when a `MessageBox` can't be displayed at the time
 /// the log is generated (like in a worker thread or drawing a screen pBuffer).
 /// At these times, the application can use this to:
-///   1. Immediately send the message to `OutputDebugStringW`
-///   2. Store the message in a static queue (up to #MAX_LOG_QUEUE_DEPTH) entries
-///   3. When the app can display a `MessageBox`, play back the message
+///   1. Record the message in the flight recorder
+///   2. Store its raw arguments in a lock-free queue (up to
+///      #MAX_LOG_QUEUE_DEPTH entries).  If the queue is full, the message is
+///      dropped and counted.  #LOG_LEVEL_TRACE, #LOG_LEVEL_DEBUG and
+///      #LOG_LEVEL_INFO messages only get the first half of the queue, so
+///      they can't crowd out a warning.
+///   3. When the app can display a `MessageBox`, compose and play back the
+///      message (see #logDequeueAndDisplayMessage)
+///
+/// This never composes, never calls `OutputDebugStringW` and never waits.  A
+/// #LOG_LEVEL_FATAL only wakes the file sink's writer.
+///
+/// String arguments are rendered when the message is dequeued, so they must
+/// be string literals or globals (see #logFlightFormat).
 ///
 /// This is intended to be called through the wide resource string logging
 /// macros like #LOG_INFO_Q.  It is not intended to be called directly.
 ///
-/// The logger **can not** be called before it's initialized.  The
-/// application's instance handle needs to be set for `LoadStringW` to work.
+/// The logger **can not** be called before it's initialized.  #logInit
+/// preloads the strings from the resources.
 ///
 /// @param logLevel        The level of this logging event
 /// @param functionName    The name of the function
@@ -612,56 +678,118 @@ void logQ(
    if ( functionName[ 0 ] == L'\0' )
       return;
 
-   wBuffer_t format = { L"", BUFFER_GUARD };
-
-   logGetStringFromResources( resourceId, &format );
-
-   wBuffer_t buffer = { L"", BUFFER_GUARD };
+   PCWSTR format = logGetStringFromResources( resourceId );
 
    va_list args;
    va_start( args, resourceId );  // va_start & va_end do not have result codes
-   vLogComposeW( logLevel, functionName, format.sBuf, &buffer, args );
+   logFlightRecord( logLevel, resourceId, format, args );
+   logEnqueue( logLevel, functionName, resourceName, resourceId, format, args );
    va_end( args );
 
-   OutputDebugStringW( buffer.sBuf );
-   logWerEvent( logLevel, resourceName, resourceId, buffer.sBuf );
+   /// Get what's already in the file sink's queue to the log file.  Don't
+   /// wait for it -- the main thread flushes when it dequeues this.
+   if ( logLevel == LOG_LEVEL_FATAL ) {
+      logFileWakeWriter();
+   }
+}
 
-   _ASSERTE( logValidate() );
 
-   EnterCriticalSection( &log_queue_critical_section );
+/// Put a message in the log queue.  This never blocks, never takes a lock
+/// and never formats anything.
+///
+/// This is safe to call from any thread.
+///
+/// @param logLevel     The level of the message
+/// @param functionName The name of the function.  Must be a string literal.
+/// @param resourceName The name of the resource.  Must be a string literal.
+/// @param resourceId   The ID of the resource string
+/// @param format       The resource string.  Its conversions say which
+///                     arguments to copy.
+/// @param args         The arguments to `format`
+/// @return `true` if the message was queued.  `false` if the queue was full
+///         and the message was dropped.
+static bool logEnqueue(
+   _In_       const logLevels_t logLevel,
+   _In_z_     const PCWSTR      functionName,
+   _In_opt_z_ const PCWSTR      resourceName,
+   _In_       const UINT        resourceId,
+   _In_z_     const PCWSTR      format,
+   _In_             va_list     args ) {
+   _ASSERTE( resourceId != NO_RESOURCE );
 
-   /// Post a #LOG_DEBUG_R message if the queue maxes out
-   if ( log_queue_size >= MAX_LOG_QUEUE_DEPTH ) {
-      LOG_DEBUG_R( IDS_LOG_MAXED_OUT_QUEUE );  // "MAX_LOG_QUEUE_DEPTH reached.  No longer queuing new messages."
-      LeaveCriticalSection( &log_queue_critical_section );
-      return;
+   /// - Keep half of the queue for #LOG_LEVEL_WARN and higher
+   if ( logLevel < LOG_LEVEL_WARN && logMpscSize( &logQueue ) >= MAX_LOG_QUEUE_DEPTH / 2 ) {
+      InterlockedIncrement64( &logQueue.l64Dropped );
+      return false;
    }
 
-   /// No need to queue #LOG_LEVEL_TRACE, #LOG_LEVEL_DEBUG, #LOG_LEVEL_INFO
-   /// messages.
-   if ( logLevel == LOG_LEVEL_TRACE || logLevel == LOG_LEVEL_DEBUG || logLevel == LOG_LEVEL_INFO ) {
-      LeaveCriticalSection( &log_queue_critical_section );
-      return;
+   /// - Claim a position.  If the queue is full, #logMpscClaim counts (doesn't
+   ///   log) the dropped message.  It's still in the flight recorder.
+   const LONG64 l64Position = logMpscClaim( &logQueue );
+   if ( l64Position < 0 ) {
+      return false;
    }
 
-   _ASSERTE( log_queue_head < MAX_LOG_QUEUE_DEPTH );
+   /// - Fill the cell, then publish it to the consumer
+   logCell_t* pCell = &logQueueCells[ logMpscIndex( &logQueue, l64Position ) ];
+
+   pCell->logLevel         = logLevel;
+   pCell->uResourceId      = resourceId;
+   pCell->pwszFunctionName = functionName;
+   pCell->pwszResourceName = resourceName;
+   pCell->uArgs            = logFlightCaptureArgs( format, args, pCell->args );
 
-   logQueue[ log_queue_head ].uResourceId = resourceId;
-   logQueue[ log_queue_head ].logLevel = logLevel;
+   logMpscPublish( &logQueue, l64Position );
 
-   CopyMemory( logQueue[ log_queue_head ].sBuf, buffer.sBuf, sizeof( buffer.sBuf ) );
+   return true;
+}
 
-   log_queue_size += 1;
-   log_queue_head = ++log_queue_head % MAX_LOG_QUEUE_DEPTH;
 
-   LeaveCriticalSection( &log_queue_critical_section );
+/// Compose a queued message the way #vLogComposeW would have
+///
+/// Only call this from the consumer (main) thread.
+///
+/// @param pCell   The cell
+/// @param pBuffer The composed message
+static void logQueueCompose( _In_ const logCell_t* pCell, _Out_ wBuffer_t* pBuffer ) {
+   pBuffer->dwGuard = BUFFER_GUARD;
 
-   _ASSERTE( logValidate() );
+   int iChars = swprintf_s( pBuffer->sBuf, MAX_LOG_STRING, L"%s: ", pCell->pwszFunctionName );
+   size_t stUsed = ( iChars > 0 ) ? (size_t) iChars : 0;
+
+   stUsed += logFlightFormat( logGetStringFromResources( pCell->uResourceId ), pCell->args, pCell->uArgs,
+                              pBuffer->sBuf + stUsed, MAX_LOG_STRING - stUsed - 1 );  // Leave room for the `\n`
+
+   /// Append a `\n` for MSVC's debugger
+   pBuffer->sBuf[ stUsed++ ] = L'\n';
+   pBuffer->sBuf[ stUsed ]   = L'\0';
+
+   _ASSERTE( pBuffer->dwGuard == BUFFER_GUARD );
+}
+
+
+/// Get the cell at the head of the queue if it's ready to be read
+///
+/// Only call this from the consumer (main) thread.
+///
+/// @return The cell or `NULL` if the queue is empty
+static logCell_t* logQueueHead() {
+   const LONG64 l64Position = logMpscHead( &logQueue );
+
+   if ( l64Position < 0 ) {
+      return NULL;  // Empty (or the producer hasn't finished writing it)
+   }
+
+   return &logQueueCells[ logMpscIndex( &logQueue, l64Position ) ];
 }
 
 
 /// Validate the health of the log's data structures
 ///
+/// The producers don't take a lock, so the cells can change while we look at
+/// them.  This only checks what can't be torn:  The pointers, the positions
+/// and the guards.
+///
 /// @return `true` if successful.  `false` if there was a problem.
 bool logValidate() {
    /// To validate the `sphInst` and `sphWindow` parameters, we try to read one
@@ -689,56 +817,19 @@ bool logValidate() {
       }
    }
 
-   EnterCriticalSection( &log_queue_critical_section );
-
-   _ASSERTE( log_queue_head < MAX_LOG_QUEUE_DEPTH );
-   _ASSERTE( log_queue_tail < MAX_LOG_QUEUE_DEPTH );
-   _ASSERTE( log_queue_size <= MAX_LOG_QUEUE_DEPTH );
-
-   // If #log_queue_size == 0, then #log_queue_head must equal #log_queue_tail
-   if ( log_queue_size == 0 ) {
-      _ASSERTE( log_queue_head == log_queue_tail );
-   }
-
-   // If #log_queue_size == #MAX_LOG_QUEUE_DEPTH, then #log_queue_head must also equal #log_queue_tail
-   if ( log_queue_size == MAX_LOG_QUEUE_DEPTH ) {
-      _ASSERTE( log_queue_head == log_queue_tail );
-   }
+   /// Read the dequeue position first.  It never passes the enqueue position.
+   LONG64 l64Dequeue = logQueue.l64Dequeue;
+   LONG64 l64Enqueue = logQueue.l64Enqueue;
 
-   if ( log_queue_tail < log_queue_head ) {
-      long long calculated_size = (long long) log_queue_head - log_queue_tail;
-      _ASSERTE( log_queue_size == calculated_size );
-   } else if( log_queue_tail > log_queue_head ) {
-      long long calculated_size = MAX_LOG_QUEUE_DEPTH - ( log_queue_tail - log_queue_head );
-      _ASSERTE( log_queue_size == calculated_size );
-   }
+   _ASSERTE( l64Dequeue >= 0 );
+   _ASSERTE( l64Enqueue >= l64Dequeue );
+   _ASSERTE( l64Enqueue - l64Dequeue <= MAX_LOG_QUEUE_DEPTH );
+   _ASSERTE( logQueue.l64Dropped >= 0 );
 
    for ( size_t i = 0 ; i < MAX_LOG_QUEUE_DEPTH ; i++ ) {
-      _ASSERTE( logQueue[ i ].dwGuard == BUFFER_GUARD );
+      _ASSERTE( logQueueCells[ i ].uArgs <= LOG_FLIGHT_MAX_ARGS );
    }
 
-   size_t count = MAX_LOG_QUEUE_DEPTH;
-   size_t index = log_queue_tail;
-   size_t remaining = log_queue_size;
-
-   while ( count > 0 ) {
-      if ( remaining > 0 ) {
-         _ASSERTE( logQueue[ index ].logLevel    >= LOG_LEVEL_WARN );
-         _ASSERTE( logQueue[ index ].uResourceId != NO_RESOURCE );
-         _ASSERTE( logQueue[ index ].sBuf[ 0 ]   != L'\0' );
-
-         remaining -= 1;
-      } else {
-         _ASSERTE( logQueue[ index ].logLevel    == LOG_LEVEL_TRACE );
-         _ASSERTE( logQueue[ index ].uResourceId == NO_RESOURCE );
-         _ASSERTE( logQueue[ index ].sBuf[ 0 ]   == L'\0' );
-      }
-      index = ++index % MAX_LOG_QUEUE_DEPTH;
-      count -= 1;
-   }
-
-   LeaveCriticalSection( &log_queue_critical_section );
-
    return true;
 }
 
@@ -747,29 +838,27 @@ bool logValidate() {
 ///
 /// @param index The entry to zero out
 void logQueueResetEntry( size_t index ) {
-   logQueue[ index ].dwGuard = BUFFER_GUARD;
-   SecureZeroMemory( logQueue[ index ].sBuf, sizeof( logQueue[ index ].sBuf ) );
-   logQueue[ index ].logLevel = LOG_LEVEL_TRACE;
-   logQueue[ index ].uResourceId = NO_RESOURCE;
-
-   _ASSERTE( logQueue[ index ].dwGuard == BUFFER_GUARD );
+   logCell_t* pCell = &logQueueCells[ index ];
+
+   SecureZeroMemory( pCell->args, sizeof( pCell->args ) );
+   pCell->logLevel         = LOG_LEVEL_TRACE;
+   pCell->uResourceId      = NO_RESOURCE;
+   pCell->pwszFunctionName = NULL;
+   pCell->pwszResourceName = NULL;
+   pCell->uArgs            = 0;
 }
 
 
 /// Initialize / reset the log quueue
+///
+/// Only call this when no other threads are logging (like in #logInit and
+/// #logCleanup).
 void logQueueReset() {
-
-   EnterCriticalSection( &log_queue_critical_section );
-
    for ( size_t i = 0 ; i < MAX_LOG_QUEUE_DEPTH ; i++ ) {
       logQueueResetEntry( i );
    }
 
-   log_queue_head = 0;
-   log_queue_tail = 0;
-   log_queue_size = 0;
-
-   LeaveCriticalSection( &log_queue_critical_section );
+   logMpscReset( &logQueue, logQueueCells, sizeof( logCell_t ), MAX_LOG_QUEUE_DEPTH );
 
    _ASSERTE( logValidate() );
    _ASSERTE( !logQueueHasEntry() );
@@ -780,62 +869,84 @@ void logQueueReset() {
 ///
 /// @return `true` if there's a log entry waiting.  `false` if there is not.
 bool logQueueHasEntry() {
-   if ( log_queue_size == 0 ) {
-      return false;
-   } else {
-      return true;
-   }
+   return logQueueHead() != NULL;
 }
 
 
 /// The size of the log queue
+///
+/// Producers may be in the middle of writing some of these.
+///
 /// @return The size of the log queue
 size_t logQueueSize() {
-   return log_queue_size;
+   return logMpscSize( &logQueue );
+}
+
+
+/// The number of messages dropped because the log queue was full
+///
+/// @return The number of dropped messages since #logQueueReset
+UINT64 logQueueDropped() {
+   return (UINT64) logQueue.l64Dropped;
 }
 
 
 /// Dequeue a log message
 ///
+/// Only call this from the consumer (main) thread.
+///
 /// @return The size of the queue after dequeuing this message
 size_t logDequeue() {
+   logCell_t* pCell = logQueueHead();
 
    /// Return 0 if the queue is empty
-   if ( log_queue_size == 0 ) {
+   if ( pCell == NULL ) {
       return 0;
    }
 
-   _ASSERTE( logValidate() );
-
-   EnterCriticalSection( &log_queue_critical_section );
-
-   logQueueResetEntry( log_queue_tail );
-   log_queue_size -= 1;
-   log_queue_tail = ++log_queue_tail % MAX_LOG_QUEUE_DEPTH;
+   logQueueResetEntry( logMpscIndex( &logQueue, logQueue.l64Dequeue ) );
 
-   LeaveCriticalSection( &log_queue_critical_section );
+   /// Free the cell for the producers' next lap, then move on
+   logMpscRelease( &logQueue );
 
    _ASSERTE( logValidate() );
 
-   return log_queue_size;
+   return logQueueSize();
 }
 
 
 /// Dequeue and display a queued log message
 ///
+/// This does the work #logQ left for the consumer:  Compose the message,
+/// send it to `OutputDebugStringW`, the file sink and WER and (for
+/// #LOG_LEVEL_WARN and higher) show it.
+///
+/// Only call this from the consumer (main) thread.
+///
 /// @return The size of the queue after dequeuing this message
 size_t logDequeueAndDisplayMessage() {
+   logCell_t* pCell = logQueueHead();
 
    /// Return 0 if the queue is empty
-   if ( log_queue_size == 0 ) {
+   if ( pCell == NULL ) {
       return 0;
    }
 
-   EnterCriticalSection( &log_queue_critical_section );
+   /// The cell belongs to us until #logDequeue frees it
+   wBuffer_t buffer;
+   logQueueCompose( pCell, &buffer );
+
+   OutputDebugStringW( buffer.sBuf );
+   logFileWrite( pCell->logLevel, buffer.sBuf );
+   logWerEvent( pCell->logLevel, pCell->pwszResourceName, pCell->uResourceId, buffer.sBuf );
 
-   logShowMessageW( logQueue[ log_queue_tail ].logLevel, logQueue[ log_queue_tail ].sBuf );
+   if ( pCell->logLevel == LOG_LEVEL_FATAL ) {
+      logFileFlush();  /// Get the reason we're ending into the log file
+   }
 
-   LeaveCriticalSection( &log_queue_critical_section );
+   if ( pCell->logLevel >= LOG_LEVEL_WARN ) {
+      logShowMessageW( pCell->logLevel, buffer.sBuf );
+   }
 
    return logDequeue();
 }
@@ -843,26 +954,153 @@ size_t logDequeueAndDisplayMessage() {
 
 /// Peek at the first message that could be dequeued.
 ///
-/// @param logEntry Copy the message information into this buffer
+/// Only call this from the consumer (main) thread.
+///
+/// @param logEntry Copy the message information (and the composed message)
+///                 into this buffer
 /// @return `TRUE` if successful.  `FALSE` if there is no message to look at.
 BOOL logPeekQueuedMessage( logEntry_t* logEntry ) {
    _ASSERTE( logEntry != NULL );
 
-   EnterCriticalSection( &log_queue_critical_section );
-
-   if ( log_queue_size == 0 ) {
-      LeaveCriticalSection( &log_queue_critical_section );
+   logCell_t* pCell = logQueueHead();
+   if ( pCell == NULL ) {
       return FALSE;
    }
 
-   CopyMemory( logEntry, &logQueue[ log_queue_tail ], sizeof( logEntry_t ) );
+   wBuffer_t buffer;
+   logQueueCompose( pCell, &buffer );
 
-   LeaveCriticalSection( &log_queue_critical_section );
+   logEntry->uResourceId = pCell->uResourceId;
+   logEntry->logLevel    = pCell->logLevel;
+   logEntry->dwGuard     = BUFFER_GUARD;
+   CopyMemory( logEntry->sBuf, buffer.sBuf, sizeof( logEntry->sBuf ) );
 
    return TRUE;
 }
 
 
+/// The state shared by the #logQueueStressTest threads
+static volatile LONG slStressGo = 0;  ///< The producers spin until this is `1`
+
+
+/// Put one #logQueueStressTest message in the queue.  `va_list` can't be
+/// built by hand, so this takes `...`.
+///
+/// @param format The resource string for #IDS_LOG_QUEUE_STRESS_TEST
+/// @param ...    The producer's number and the sequence number (as `size_t`)
+static void logQueueStressEnqueue( _In_z_ const PCWSTR format, ... ) {
+   va_list args;
+   va_start( args, format );
+   logEnqueue( LOG_LEVEL_WARN, __FUNCTIONW__, L"IDS_LOG_QUEUE_STRESS_TEST", IDS_LOG_QUEUE_STRESS_TEST, format, args );
+   va_end( args );
+}
+
+
+/// A #logQueueStressTest producer.  Sends #LOG_STRESS_MESSAGES messages as
+/// fast as it can.  Each message has the producer's number and a sequence
+/// number, so the consumer can check the order.
+///
+/// @param Context The producer's number
+/// @return `0`
+static DWORD WINAPI logQueueStressProducer( LPVOID Context ) {
+   const size_t stProducer = (size_t) Context;
+   const PCWSTR format     = logGetStringFromResources( IDS_LOG_QUEUE_STRESS_TEST );
+
+   while ( slStressGo == 0 ) {
+      YieldProcessor();  // Start all of the producers at once
+   }
+
+   for ( size_t i = 0 ; i < LOG_STRESS_MESSAGES ; i++ ) {
+      logQueueStressEnqueue( format, stProducer, i );
+   }
+
+   return 0;
+}
+
+
+/// Stress the log queue with #LOG_STRESS_PRODUCERS producer threads while
+/// this thread consumes
+///
+/// Checks that every message is either received or counted as dropped, that
+/// each producer's messages arrive in order and that none are torn.  Logs the
+/// throughput when it's done.
+///
+/// This is not normally used, except for testing.  Don't call it while other
+/// threads are logging -- it resets the queue.
+///
+/// @return `true` if the queue passed.  `false` if there was a problem.
+bool logQueueStressTest() {
+   HANDLE        hProducers[ LOG_STRESS_PRODUCERS ];
+   LONG64        l64NextExpected[ LOG_STRESS_PRODUCERS ] = { 0 };
+   UINT64        u64Received = 0;
+   bool          bPassed     = true;
+   LARGE_INTEGER start;
+   LARGE_INTEGER end;
+   LARGE_INTEGER frequency;
+
+   logQueueReset();
+   slStressGo = 0;
+
+   for ( size_t i = 0 ; i < LOG_STRESS_PRODUCERS ; i++ ) {
+      hProducers[ i ] = CreateThread( NULL, 0, logQueueStressProducer, (LPVOID) i, 0, NULL );
+      if ( hProducers[ i ] == NULL ) {
+         FATAL_IN_LOG( L"Failed to create a log stress test thread." );  // Can't be localized
+         return false;
+      }
+   }
+
+   QueryPerformanceFrequency( &frequency );
+   QueryPerformanceCounter( &start );
+   InterlockedExchange( &slStressGo, 1 );
+
+   /// Consume until all of the producers are done and the queue is empty
+   for ( ;; ) {
+      const logCell_t* pCell = logQueueHead();
+
+      if ( pCell != NULL ) {
+         const UINT64 u64Producer = pCell->args[ 0 ];
+         const UINT64 u64Sequence = pCell->args[ 1 ];
+
+         if ( pCell->uArgs != 2
+           || u64Producer >= LOG_STRESS_PRODUCERS
+           || pCell->logLevel != LOG_LEVEL_WARN
+           || pCell->uResourceId != IDS_LOG_QUEUE_STRESS_TEST ) {
+            bPassed = false;  // A torn message
+         } else if ( (LONG64) u64Sequence < l64NextExpected[ u64Producer ] ) {
+            bPassed = false;  // Out of order (dropped messages leave gaps, but it never goes backwards)
+         } else {
+            l64NextExpected[ u64Producer ] = (LONG64) u64Sequence + 1;
+         }
+
+         logDequeue();
+         u64Received++;
+      } else if ( WaitForMultipleObjects( LOG_STRESS_PRODUCERS, hProducers, TRUE, 0 ) == WAIT_OBJECT_0 && !logQueueHasEntry() ) {
+         break;
+      }
+   }
+
+   QueryPerformanceCounter( &end );
+
+   for ( size_t i = 0 ; i < LOG_STRESS_PRODUCERS ; i++ ) {
+      CloseHandle( hProducers[ i ] );
+   }
+
+   const UINT64 u64Sent    = (UINT64) LOG_STRESS_PRODUCERS * LOG_STRESS_MESSAGES;
+   const UINT64 u64Dropped = logQueueDropped();
+   const double seconds    = (double) ( end.QuadPart - start.QuadPart ) / (double) frequency.QuadPart;
+
+   if ( u64Received + u64Dropped != u64Sent ) {
+      bPassed = false;  // Lost (or duplicated) messages
+   }
+
+   LOG_INFO_R( IDS_LOG_QUEUE_STRESS_RESULT, LOG_STRESS_PRODUCERS, u64Sent, u64Received, u64Dropped, (double) u64Sent / seconds, bPassed ? L"PASSED" : L"FAILED" );  // "Log queue stress test:  Producers: %d   Sent: %llu   Received: %llu   Dropped: %llu   Messages/sec: %.0f   %s"
+
+   logQueueReset();
+
+   return bPassed;
+}
+
+
 /// Test the logging functionality
 ///
 /// To run all of the queue tests, set #MAX_LOG_QUEUE_DEPTH to 4
@@ -923,11 +1161,16 @@ void logTest() {
    #if MAX_LOG_QUEUE_DEPTH == 4
       // Queued log testing (wide) with parameters
       // This works best when MAX_LOG_QUEUE_DEPTH = 4 or 5
+      // TRACE, DEBUG and INFO only get the first half of the queue
       LOG_TRACE_Q( IDS_LOG_TEST_PARAMETERS_Q, 1, L"Queued TRACE", 1.0 );  // Testing LOG_<Level>_Q (wide) varargs [%d] [%s] [%f]
       LOG_DEBUG_Q( IDS_LOG_TEST_PARAMETERS_Q, 2, L"Queued DEBUG", 2.0 );  // Testing LOG_<Level>_Q (wide) varargs [%d] [%s] [%f]
-      LOG_INFO_Q(  IDS_LOG_TEST_PARAMETERS_Q, 3, L"Queued INFO",  3.0 );  // Testing LOG_<Level>_Q (wide) varargs [%d] [%s] [%f]
+      LOG_INFO_Q(  IDS_LOG_TEST_PARAMETERS_Q, 3, L"Queued INFO - YOU SHOULD NOT SEE THIS",  3.0 );  // Testing LOG_<Level>_Q (wide) varargs [%d] [%s] [%f]
+      _ASSERTE( logQueueHasMsg() );
+      _ASSERTE( logQueueSize() == 2 );
+
+      _ASSERTE( logDequeueAndDisplayMessage() == 1 );
+      _ASSERTE( logDequeueAndDisplayMessage() == 0 );
       _ASSERTE( !logQueueHasMsg() );
-      _ASSERTE( logQueueSize() == 0 );
       logEntry_t logEntry = { NO_RESOURCE, LOG_LEVEL_TRACE, L"", BUFFER_GUARD };
       _ASSERTE( logPeekQueuedMessage( &logEntry ) == FALSE );
 
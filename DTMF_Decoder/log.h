@@ -28,7 +28,7 @@ enum logLevels_t {
 #define MAX_LOG_STRING 256
 
 
-/// A log message that can be queued and displayed later
+/// A queued log message, composed by #logPeekQueuedMessage
 struct logEntry_t {
    UINT        uResourceId;             ///< The resoruce string ID of the log entry
    logLevels_t logLevel;                ///< The level of the log entry
@@ -160,6 +160,9 @@ extern void   logQueueReset();
 extern bool   logQueueHasEntry();
 extern bool   logValidate();
 extern size_t logQueueSize();
+extern UINT64 logQueueDropped();
 
 extern size_t logDequeueAndDisplayMessage();
 extern BOOL   logPeekQueuedMessage( logEntry_t* logEntry );
+
+extern bool   logQueueStressTest();
@@ -0,0 +1,781 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Extend log.cpp with an asynchronous, batched file sink (with rotation)
+///
+/// `OutputDebugStringW` goes through a system-wide mutex and nobody sees it
+/// unless DebugView is running.  With `/logfile` on the command line, every
+/// log message is also written to a file.
+///
+/// The loggers never touch the file.  #logFileWrite copies the message, a
+/// timestamp and the thread ID into a bounded, lock-free queue (logMpsc.h,
+/// like the log queue in log.cpp) and returns.  A writer thread wakes up
+/// every #LOG_FILE_WRITE_MS, converts everything in the queue to UTF-8 in one
+/// big buffer and writes it with as few `WriteFile` calls as it can.  During
+/// a storm, the producer that fills the queue halfway wakes the writer early.
+/// If the queue is full, the message is dropped and counted -- the caller
+/// never waits on the disk.
+///
+/// The file is rotated when it reaches `/logfilesize` megabytes or when it's
+/// `/logfileminutes` old.  The current file is renamed to `<file>.1`, `.1` to
+/// `.2` and so on up to #LOG_FILE_KEEP.
+///
+/// #LOG_LEVEL_FATAL messages call #logFileFlush, which waits for the writer
+/// to put everything on the disk before the program ends.  A queued
+/// #LOG_LEVEL_FATAL (from a worker thread) only wakes the writer with
+/// #logFileWakeWriter -- the main thread flushes when it dequeues it.
+///
+///     DTMF_Decoder.exe /logfile[:"C:\DTMF_Decoder.log"] [/logfilesize:10] [/logfileminutes:60]
+///
+/// #logFileStormTest measures the throughput of the sink and the latency of
+/// the calling thread.
+///
+/// ## Threads & Synchronization API
+/// | API                            | Link                                                                                                    |
+/// |--------------------------------| --------------------------------------------------------------------------------------------------------|
+/// | `CreateThread`                 | https://learn.microsoft.com/en-us/windows/win32/api/processthreadsapi/nf-processthreadsapi-createthread |
+/// | `CreateEventExW`               | https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-createeventexw                 |
+/// | `WaitForMultipleObjects`       | https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-waitformultipleobjects         |
+/// | `InterlockedCompareExchange64` | https://learn.microsoft.com/en-us/windows/win32/api/winnt/nf-winnt-interlockedcompareexchange64         |
+///
+/// ## File API
+/// | API                       | Link                                                                                                 |
+/// |---------------------------| -----------------------------------------------------------------------------------------------------|
+/// | `CreateFileW`             | https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-createfilew                   |
+/// | `WriteFile`               | https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-writefile                     |
+/// | `FlushFileBuffers`        | https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-flushfilebuffers              |
+/// | `MoveFileExW`             | https://learn.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-movefileexw                   |
+/// | `GetSystemTimeAsFileTime` | https://learn.microsoft.com/en-us/windows/win32/api/sysinfoapi/nf-sysinfoapi-getsystemtimeasfiletime |
+/// | `WideCharToMultiByte`     | https://learn.microsoft.com/en-us/windows/win32/api/stringapiset/nf-stringapiset-widechartomultibyte |
+///
+/// @file    logFile.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <stdio.h>        // For swprintf_s
+#include <wchar.h>        // For wcsstr
+
+#include "log.h"          // For LOG_INFO_R
+#include "log_ex.h"       // For FATAL_IN_LOG
+#include "logMpsc.h"      // For the queue
+#include "logFile.h"      // For yourself
+
+
+static_assert( ( LOG_FILE_QUEUE_DEPTH & ( LOG_FILE_QUEUE_DEPTH - 1 ) ) == 0, "LOG_FILE_QUEUE_DEPTH must be a power of 2" );
+
+/// The log file when `/logfile` doesn't name one
+#define LOG_FILE_DEFAULT_FILE     L"DTMF_Decoder.log"
+
+/// The default size to rotate the file at (in megabytes)
+#define LOG_FILE_DEFAULT_SIZE_MB  (10)
+
+/// The number of old files to keep (`<file>.1` to `<file>.N`)
+#define LOG_FILE_KEEP             (5)
+
+/// How often the writer thread empties the queue (in milliseconds)
+#define LOG_FILE_WRITE_MS         (50)
+
+/// How long #logFileFlush waits for the writer thread (in milliseconds)
+#define LOG_FILE_FLUSH_TIMEOUT_MS (2000)
+
+/// The size of the writer thread's write buffer (in bytes)
+#define LOG_FILE_WRITE_BUFFER     (256 * 1024)
+
+/// The number of producer threads in #logFileStormTest
+#define LOG_FILE_STORM_PRODUCERS  (4)
+
+/// The number of messages each #logFileStormTest producer sends
+#define LOG_FILE_STORM_MESSAGES   (100000)
+
+/// The number of latency buckets in #logFileStormTest (one per power of 2
+/// nanoseconds)
+#define LOG_FILE_STORM_BUCKETS    (40)
+
+/// How long #logFileStormTest waits for the writer after the last producer
+/// is done (in milliseconds)
+#define LOG_FILE_STORM_DEADLINE_MS (5000)
+
+
+/// One record in the queue
+typedef struct {
+   volatile LONG64 l64Sequence;             ///< Who owns this cell (see logMpsc.h).  Must be first.
+   FILETIME        ftTime;                  ///< When it was logged
+   DWORD           dwThreadId;              ///< The thread that logged it
+   logLevels_t     logLevel;                ///< The level of the message
+   WCHAR           sBuf[ MAX_LOG_STRING ];  ///< The composed message
+} logFileCell_t;
+
+
+static logFileCell_t sCells[ LOG_FILE_QUEUE_DEPTH ];  ///< The records in #sQueue
+
+/// The sink's queue.  A bounded, lock-free, multi-producer/single-consumer
+/// queue (logMpsc.h).  Only the writer thread consumes.
+static logMpsc_t sQueue = { (BYTE*) sCells, sizeof( logFileCell_t ), LOG_FILE_QUEUE_DEPTH };
+
+
+static bool   sbEnabled         = false;                 ///< `true` if `/logfile` is on the command line
+static volatile bool sbRunning  = false;                 ///< `true` while the writer thread is taking messages
+static volatile LONG slInFlight = 0;                     ///< Threads in #logFileWrite or #logFileFlush.  #logFileCleanup waits for them before it closes the events.
+static WCHAR  swsFile[ MAX_PATH ] = LOG_FILE_DEFAULT_FILE;  ///< The log file
+static UINT64 su64RotateBytes   = (UINT64) LOG_FILE_DEFAULT_SIZE_MB * 1024 * 1024;  ///< Rotate when the file is this big
+static UINT64 su64RotateTicks   = 0;                     ///< Rotate when the file is this old (in `FILETIME` ticks).  `0` to never rotate on time.
+
+static HANDLE shFile            = INVALID_HANDLE_VALUE;  ///< The log file
+static UINT64 su64FileBytes     = 0;                     ///< The size of the log file
+static UINT64 su64FileOpened    = 0;                     ///< When the log file was opened (as a `FILETIME`)
+static HANDLE shWriterThread    = NULL;                  ///< The writer thread
+static HANDLE shStopEvent       = NULL;                  ///< Tells the writer thread to do a last write and end
+static HANDLE shFlushEvent      = NULL;                  ///< Tells the writer thread to write and flush now
+static HANDLE shWakeEvent       = NULL;                  ///< Tells the writer thread to write now (the queue is half full or there was a queued fatal)
+static HANDLE shFlushedEvent    = NULL;                  ///< The writer thread sets this after a flush
+
+static CHAR   ssWriteBuffer[ LOG_FILE_WRITE_BUFFER ];    ///< Formatted lines waiting to be written
+static size_t sstWriteBufferUsed = 0;                    ///< Bytes in #ssWriteBuffer
+
+
+/// Read a number after an option like `/logfilesize:`
+///
+/// @param pwszCmdLine The command line
+/// @param pwszOption  The option (with the `:`)
+/// @param pu64Value   Receives the number.  Unchanged if the option isn't there.
+/// @return `TRUE` if successful.  `FALSE` if the number is not valid.
+static BOOL logFileParseNumber(
+   _In_z_ const PCWSTR  pwszCmdLine,
+   _In_z_ const PCWSTR  pwszOption,
+   _Inout_      UINT64* pu64Value ) {
+
+   const WCHAR* pFound = wcsstr( pwszCmdLine, pwszOption );
+   if ( pFound == NULL ) {
+      return TRUE;
+   }
+
+   UINT64 u64Value = 0;
+   if ( swscanf_s( pFound + wcslen( pwszOption ), L"%llu", &u64Value ) != 1 ) {
+      return FALSE;
+   }
+
+   *pu64Value = u64Value;
+
+   return TRUE;
+}
+
+
+/// Look for `/logfile[:path]`, `/logfilesize:N` and `/logfileminutes:N` on
+/// the command line
+///
+/// @param pwszCmdLine The command line passed to #wWinMain
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL logFileParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine ) {
+   sbEnabled = false;
+
+   if ( pwszCmdLine == NULL ) {
+      return TRUE;
+   }
+
+   /// `/logfilesize` and `/logfileminutes` also start with `/logfile`, so
+   /// look for `/logfile` followed by the end, a space or a `:`
+   const WCHAR* pFound = pwszCmdLine;
+   const size_t stOptionLength = wcslen( L"/logfile" );
+   for ( ;; ) {
+      pFound = wcsstr( pFound, L"/logfile" );
+      if ( pFound == NULL ) {
+         return TRUE;
+      }
+      const WCHAR wNext = pFound[ stOptionLength ];
+      if ( wNext == L'\0' || wNext == L' ' || wNext == L':' ) {
+         break;
+      }
+      pFound += stOptionLength;
+   }
+
+   /// If there's a `:`, then the rest of the option (which may be quoted) is
+   /// the log file
+   const WCHAR* pValue = pFound + stOptionLength;
+   if ( *pValue == L':' ) {
+      pValue++;
+
+      WCHAR wEnd = L' ';
+      if ( *pValue == L'"' ) {
+         wEnd = L'"';
+         pValue++;
+      }
+
+      size_t i = 0;
+      while ( *pValue != L'\0' && *pValue != wEnd && i < _countof( swsFile ) - 1 ) {
+         swsFile[ i++ ] = *pValue++;
+      }
+      swsFile[ i ] = L'\0';
+
+      if ( i == 0 ) {
+         RETURN_FATAL( IDS_LOG_FILE_INVALID_OPTION );  // "A /logfile option is not valid.  Exiting."
+      }
+   }
+
+   UINT64 u64SizeMb  = LOG_FILE_DEFAULT_SIZE_MB;
+   UINT64 u64Minutes = 0;
+
+   if ( !logFileParseNumber( pwszCmdLine, L"/logfilesize:", &u64SizeMb )
+     || !logFileParseNumber( pwszCmdLine, L"/logfileminutes:", &u64Minutes )
+     || u64SizeMb == 0 ) {
+      RETURN_FATAL( IDS_LOG_FILE_INVALID_OPTION );  // "A /logfile option is not valid.  Exiting."
+   }
+
+   su64RotateBytes = u64SizeMb * 1024 * 1024;
+   su64RotateTicks = u64Minutes * 60 * 10000000;  // FILETIME ticks are 100ns
+
+   sbEnabled = true;
+
+   return TRUE;
+}
+
+
+/// Put a message in the sink's queue.  #logFileWrite keeps the sink open
+/// while this runs.
+///
+/// @param logLevel    The level of the message
+/// @param pwszMessage The composed message
+/// @return `true` if the message was queued.  `false` if it was dropped.
+static bool logFileEnqueue( _In_ const logLevels_t logLevel, _In_z_ const PCWSTR pwszMessage ) {
+   /// If the writer hasn't gotten to the next cell yet, the queue is full
+   /// and #logMpscClaim counts the dropped message
+   const LONG64 l64Position = logMpscClaim( &sQueue );
+   if ( l64Position < 0 ) {
+      return false;
+   }
+
+   logFileCell_t* pCell = &sCells[ logMpscIndex( &sQueue, l64Position ) ];
+
+   GetSystemTimeAsFileTime( &pCell->ftTime );  // Reads shared memory.  It's not a system call.
+   pCell->dwThreadId = GetCurrentThreadId();
+   pCell->logLevel   = logLevel;
+   wcsncpy_s( pCell->sBuf, MAX_LOG_STRING, pwszMessage, _TRUNCATE );
+
+   /// Publish the cell to the writer thread
+   logMpscPublish( &sQueue, l64Position );
+
+   /// Only the producer that fills the queue halfway wakes the writer (once
+   /// per storm, not once per message)
+   if ( l64Position - sQueue.l64Dequeue == LOG_FILE_QUEUE_DEPTH / 2 ) {
+      SetEvent( shWakeEvent );
+   }
+
+   return true;
+}
+
+
+/// Put a message in the sink's queue.  This never blocks, never takes a lock
+/// and never does I/O, so it's safe to call from any thread.
+///
+/// If the sink isn't running, this does nothing.  If the queue is full, the
+/// message is dropped and counted.
+///
+/// @param logLevel    The level of the message
+/// @param pwszMessage The composed message
+/// @return `true` if the message was queued.  `false` if it was dropped (or
+///         the sink isn't running).
+bool logFileWrite( _In_ const logLevels_t logLevel, _In_z_ const PCWSTR pwszMessage ) {
+   bool bQueued = false;
+
+   InterlockedIncrement( &slInFlight );  // A full barrier, so it's counted before sbRunning is read
+
+   if ( sbRunning ) {
+      bQueued = logFileEnqueue( logLevel, pwszMessage );
+   }
+
+   InterlockedDecrement( &slInFlight );
+
+   return bQueued;
+}
+
+
+/// Write #ssWriteBuffer to the log file
+static void logFileWriteBuffer() {
+   if ( sstWriteBufferUsed == 0 ) {
+      return;
+   }
+
+   DWORD dwWritten = 0;
+   WriteFile( shFile, ssWriteBuffer, (DWORD) sstWriteBufferUsed, &dwWritten, NULL );  // If the disk is full, there's nobody to tell
+   su64FileBytes     += dwWritten;
+   sstWriteBufferUsed = 0;
+}
+
+
+/// Open (or re-open) the log file for appending
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+static BOOL logFileOpen() {
+   shFile = CreateFileW( swsFile, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+   if ( shFile == INVALID_HANDLE_VALUE ) {
+      return FALSE;
+   }
+
+   LARGE_INTEGER size = { 0 };
+   GetFileSizeEx( shFile, &size );
+   su64FileBytes = (UINT64) size.QuadPart;
+
+   FILETIME now;
+   GetSystemTimeAsFileTime( &now );
+   su64FileOpened = ( (UINT64) now.dwHighDateTime << 32 ) | now.dwLowDateTime;
+
+   return TRUE;
+}
+
+
+/// Rotate the log file if it's too big or too old
+///
+/// @param stIncoming The bytes that are about to be written
+static void logFileRotateIfNeeded( _In_ const size_t stIncoming ) {
+   FILETIME now;
+   GetSystemTimeAsFileTime( &now );
+   const UINT64 u64Now = ( (UINT64) now.dwHighDateTime << 32 ) | now.dwLowDateTime;
+
+   const bool bTooBig = su64FileBytes > 0 && su64FileBytes + stIncoming > su64RotateBytes;
+   const bool bTooOld = su64RotateTicks != 0 && u64Now - su64FileOpened >= su64RotateTicks;
+
+   if ( !bTooBig && !bTooOld ) {
+      return;
+   }
+
+   CloseHandle( shFile );
+   shFile = INVALID_HANDLE_VALUE;
+
+   /// Shift `<file>.N-1` to `<file>.N` ... `<file>` to `<file>.1`.  The
+   /// oldest one is replaced.
+   WCHAR wsFrom[ MAX_PATH + 8 ];
+   WCHAR wsTo  [ MAX_PATH + 8 ];
+
+   for ( int i = LOG_FILE_KEEP - 1 ; i >= 0 ; i-- ) {
+      if ( i == 0 ) {
+         swprintf_s( wsFrom, _countof( wsFrom ), L"%s", swsFile );
+      } else {
+         swprintf_s( wsFrom, _countof( wsFrom ), L"%s.%d", swsFile, i );
+      }
+      swprintf_s( wsTo, _countof( wsTo ), L"%s.%d", swsFile, i + 1 );
+
+      MoveFileExW( wsFrom, wsTo, MOVEFILE_REPLACE_EXISTING );  // The older files may not exist yet
+   }
+
+   logFileOpen();  // If this fails, WriteFile fails quietly until the next rotation
+}
+
+
+/// Format a record and add it to #ssWriteBuffer
+///
+/// @param pCell The record
+static void logFileFormat( _In_ const logFileCell_t* pCell ) {
+   static const PCWSTR swsLevels[] = { L"TRACE", L"DEBUG", L"INFO ", L"WARN ", L"ERROR", L"FATAL" };
+
+   FILETIME   ftLocal;
+   SYSTEMTIME st;
+   FileTimeToLocalFileTime( &pCell->ftTime, &ftLocal );
+   FileTimeToSystemTime( &ftLocal, &st );
+
+   WCHAR wsLine[ MAX_LOG_STRING + 64 ];
+   int   iChars;
+
+   /// The messages already end with a `\n` (for the debugger)
+   iChars = swprintf_s( wsLine, _countof( wsLine ), L"%04u-%02u-%02u %02u:%02u:%02u.%03u  %5lu  %s  %s",
+      st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond, st.wMilliseconds,
+      pCell->dwThreadId,
+      ( (size_t) pCell->logLevel < _countof( swsLevels ) ) ? swsLevels[ pCell->logLevel ] : L"?    ",
+      pCell->sBuf );
+
+   if ( iChars <= 0 ) {
+      return;
+   }
+
+   /// Make room for the line (in UTF-8, it's at most 3 bytes per character)
+   if ( sstWriteBufferUsed + (size_t) iChars * 3 > sizeof( ssWriteBuffer ) ) {
+      logFileRotateIfNeeded( sstWriteBufferUsed );
+      logFileWriteBuffer();
+   }
+
+   int iBytes = WideCharToMultiByte( CP_UTF8, 0, wsLine, iChars,
+      ssWriteBuffer + sstWriteBufferUsed, (int) ( sizeof( ssWriteBuffer ) - sstWriteBufferUsed ), NULL, NULL );
+
+   sstWriteBufferUsed += ( iBytes > 0 ) ? (size_t) iBytes : 0;
+}
+
+
+/// Move everything in the queue to the log file
+static void logFileDrain() {
+   for ( ;; ) {
+      const LONG64 l64Position = logMpscHead( &sQueue );
+      if ( l64Position < 0 ) {
+         break;  // Empty (or a producer hasn't finished publishing yet)
+      }
+
+      logFileFormat( &sCells[ logMpscIndex( &sQueue, l64Position ) ] );
+
+      /// Give the cell back to the producers
+      logMpscRelease( &sQueue );
+   }
+
+   logFileRotateIfNeeded( sstWriteBufferUsed );
+   logFileWriteBuffer();
+}
+
+
+/// The writer thread
+///
+/// @param Context Not used
+/// @return `0`
+static DWORD WINAPI logFileWriterThread( LPVOID Context ) {
+   UNREFERENCED_PARAMETER( Context );
+
+   HANDLE hEvents[ 3 ] = { shStopEvent, shFlushEvent, shWakeEvent };
+
+   for ( ;; ) {
+      DWORD dwWaitResult = WaitForMultipleObjects( _countof( hEvents ), hEvents, FALSE, LOG_FILE_WRITE_MS );
+
+      logFileDrain();
+
+      if ( dwWaitResult == WAIT_OBJECT_0 + 1 ) {
+         FlushFileBuffers( shFile );
+         SetEvent( shFlushedEvent );
+      } else if ( dwWaitResult != WAIT_TIMEOUT && dwWaitResult != WAIT_OBJECT_0 + 2 ) {
+         break;  // Stopped (or the wait failed).  Either way, we just did a last write.
+      }
+   }
+
+   ExitThread( 0 );
+}
+
+
+/// Reset the queue.  Only call this when nobody is using it.
+static void logFileQueueReset() {
+   logMpscReset( &sQueue, sCells, sizeof( logFileCell_t ), LOG_FILE_QUEUE_DEPTH );
+}
+
+
+/// Open the log file and start the writer thread (if `/logfile` is on the
+/// command line)
+///
+/// The file sink is optional, so if it can't start, warn and run without it.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL logFileInit() {
+   if ( !sbEnabled ) {
+      return TRUE;
+   }
+
+   logFileQueueReset();
+
+   if ( !logFileOpen() ) {
+      LOG_WARN_R( IDS_LOG_FILE_FAILED_TO_OPEN, swsFile );  // "Failed to open the log file [%s].  Continuing without it."
+      return FALSE;
+   }
+
+   shStopEvent    = CreateEventExW( NULL, NULL, 0, EVENT_MODIFY_STATE | SYNCHRONIZE );
+   shFlushEvent   = CreateEventExW( NULL, NULL, 0, EVENT_MODIFY_STATE | SYNCHRONIZE );
+   shFlushedEvent = CreateEventExW( NULL, NULL, 0, EVENT_MODIFY_STATE | SYNCHRONIZE );
+   shWakeEvent    = CreateEventExW( NULL, NULL, 0, EVENT_MODIFY_STATE | SYNCHRONIZE );
+
+   if ( shStopEvent != NULL && shFlushEvent != NULL && shFlushedEvent != NULL && shWakeEvent != NULL ) {
+      shWriterThread = CreateThread( NULL, 0, logFileWriterThread, NULL, 0, NULL );
+   }
+
+   if ( shWriterThread == NULL ) {
+      logFileCleanup();
+      LOG_WARN_R( IDS_LOG_FILE_FAILED_TO_START_WRITER );  // "Failed to start the log file writer thread.  Continuing without a log file."
+      return FALSE;
+   }
+
+   sbRunning = true;
+
+   LOG_INFO_R( IDS_LOG_FILE_ENABLED, swsFile, su64RotateBytes / ( 1024 * 1024 ) );  // "Writing the log to [%s] (rotating at %llu MB)"
+
+   return TRUE;
+}
+
+
+/// Ask the writer thread to write everything in the queue and flush the file
+/// to the disk -- and wait (a little while) for it.
+///
+/// This is called for #LOG_LEVEL_FATAL messages, so the file has the reason
+/// the program ended.  It's the only sink call that waits.
+void logFileFlush() {
+   InterlockedIncrement( &slInFlight );  // A full barrier, so it's counted before sbRunning is read
+
+   if ( sbRunning && GetCurrentThreadId() != GetThreadId( shWriterThread ) ) {
+      SetEvent( shFlushEvent );
+      WaitForSingleObject( shFlushedEvent, LOG_FILE_FLUSH_TIMEOUT_MS );
+   }
+
+   InterlockedDecrement( &slInFlight );
+}
+
+
+/// Wake the writer thread to write everything in the queue now.  This never
+/// waits, so it's safe to call from the worker threads (see #logQ).
+void logFileWakeWriter() {
+   InterlockedIncrement( &slInFlight );  // A full barrier, so it's counted before sbRunning is read
+
+   if ( sbRunning ) {
+      SetEvent( shWakeEvent );
+   }
+
+   InterlockedDecrement( &slInFlight );
+}
+
+
+/// Get the number of messages the sink dropped because its queue was full
+///
+/// @return The number of dropped messages
+UINT64 logFileDropped() {
+   return (UINT64) sQueue.l64Dropped;
+}
+
+
+/// Stop the writer thread (after a last write) and close the log file
+///
+/// Messages logged after this only go to DebugView.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL logFileCleanup() {
+   sbRunning = false;
+   MemoryBarrier();  // Write sbRunning before reading slInFlight
+
+   /// A thread that saw sbRunning before it went `false` may still be about
+   /// to signal an event.  Wait for it to leave before closing them.
+   while ( slInFlight != 0 ) {
+      SwitchToThread();
+   }
+
+   if ( shWriterThread != NULL ) {
+      SetEvent( shStopEvent );
+      WaitForSingleObject( shWriterThread, INFINITE );
+      CloseHandle( shWriterThread );
+      shWriterThread = NULL;
+   }
+
+   if ( shStopEvent != NULL ) {
+      CloseHandle( shStopEvent );
+      shStopEvent = NULL;
+   }
+
+   if ( shFlushEvent != NULL ) {
+      CloseHandle( shFlushEvent );
+      shFlushEvent = NULL;
+   }
+
+   if ( shFlushedEvent != NULL ) {
+      CloseHandle( shFlushedEvent );
+      shFlushedEvent = NULL;
+   }
+
+   if ( shWakeEvent != NULL ) {
+      CloseHandle( shWakeEvent );
+      shWakeEvent = NULL;
+   }
+
+   if ( shFile != INVALID_HANDLE_VALUE ) {
+      CloseHandle( shFile );
+      shFile = INVALID_HANDLE_VALUE;
+   }
+
+   /// Report any messages that were dropped (to DebugView)
+   if ( sQueue.l64Dropped > 0 ) {
+      LOG_INFO_R( IDS_LOG_FILE_DROPPED, (UINT64) sQueue.l64Dropped );  // "The log file's queue was full.  %llu messages were not written."
+   }
+
+   return TRUE;
+}
+
+
+/// The state shared by the #logFileStormTest threads
+static volatile LONG slStormGo = 0;  ///< The producers spin until this is `1`
+
+/// The #logFileStormTest latency histogram.  Bucket `i` counts calls that
+/// took less than `2^i` nanoseconds.
+static volatile LONG64 sl64StormBuckets[ LOG_FILE_STORM_BUCKETS ];
+
+static volatile LONG64 sl64StormMaxNs   = 0;  ///< The slowest call in #logFileStormTest
+static volatile LONG64 sl64StormQueued  = 0;  ///< Storm messages that went into the queue
+static volatile LONG64 sl64StormDropped = 0;  ///< Storm messages that were dropped because the queue was full
+static double sdStormTicksToNs = 0.0;       ///< Converts performance counter ticks to nanoseconds
+
+
+/// A #logFileStormTest producer.  Sends #LOG_FILE_STORM_MESSAGES messages as
+/// fast as it can and times every call.
+///
+/// @param Context The producer's number
+/// @return `0`
+static DWORD WINAPI logFileStormProducer( LPVOID Context ) {
+   const UINT uProducer = (UINT) (size_t) Context;
+   WCHAR      sBuf[ MAX_LOG_STRING ];
+   LONG64     l64Buckets[ LOG_FILE_STORM_BUCKETS ] = { 0 };
+   LONG64     l64MaxNs = 0;
+   LONG64     l64Queued = 0;
+
+   while ( slStormGo == 0 ) {
+      YieldProcessor();  // Start all of the producers at once
+   }
+
+   for ( UINT i = 0 ; i < LOG_FILE_STORM_MESSAGES ; i++ ) {
+      swprintf_s( sBuf, MAX_LOG_STRING, L"logFileStormProducer: Storm message %u from producer %u\n", i, uProducer );
+
+      LARGE_INTEGER start;
+      LARGE_INTEGER end;
+
+      QueryPerformanceCounter( &start );
+      const bool bQueued = logFileWrite( LOG_LEVEL_TRACE, sBuf );
+      QueryPerformanceCounter( &end );
+
+      l64Queued += bQueued ? 1 : 0;
+
+      const LONG64 l64Ns = (LONG64) ( (double) ( end.QuadPart - start.QuadPart ) * sdStormTicksToNs );
+
+      size_t stBucket = 0;
+      while ( stBucket < LOG_FILE_STORM_BUCKETS - 1 && ( 1LL << stBucket ) <= l64Ns ) {
+         stBucket++;
+      }
+      l64Buckets[ stBucket ]++;
+
+      if ( l64Ns > l64MaxNs ) {
+         l64MaxNs = l64Ns;
+      }
+   }
+
+   for ( size_t i = 0 ; i < LOG_FILE_STORM_BUCKETS ; i++ ) {
+      InterlockedAdd64( &sl64StormBuckets[ i ], l64Buckets[ i ] );
+   }
+
+   InterlockedAdd64( &sl64StormQueued,  l64Queued );
+   InterlockedAdd64( &sl64StormDropped, LOG_FILE_STORM_MESSAGES - l64Queued );
+
+   LONG64 l64Seen = sl64StormMaxNs;
+   while ( l64MaxNs > l64Seen ) {
+      l64Seen = InterlockedCompareExchange64( &sl64StormMaxNs, l64MaxNs, l64Seen );
+   }
+
+   return 0;
+}
+
+
+/// Get a percentile from the #logFileStormTest histogram
+///
+/// @param u64Total   The number of calls
+/// @param percentile The percentile (like `99.9`)
+/// @return The upper bound of the bucket the percentile falls in (in nanoseconds)
+static UINT64 logFileStormPercentile( _In_ const UINT64 u64Total, _In_ const double percentile ) {
+   const UINT64 u64Target = (UINT64) ( (double) u64Total * percentile / 100.0 );
+   UINT64 u64Seen = 0;
+
+   for ( size_t i = 0 ; i < LOG_FILE_STORM_BUCKETS ; i++ ) {
+      u64Seen += (UINT64) sl64StormBuckets[ i ];
+      if ( u64Seen >= u64Target ) {
+         return 1ULL << i;
+      }
+   }
+
+   return 1ULL << ( LOG_FILE_STORM_BUCKETS - 1 );
+}
+
+
+/// Flood the file sink with #LOG_FILE_STORM_PRODUCERS threads and measure it
+///
+/// Logs the sink's throughput (records written to the file per second) and
+/// the latency of the calling threads (p50, p99, p99.9 and max).  Checks
+/// that every storm message was either written or dropped.  Messages that
+/// other threads log during the storm are counted separately.
+///
+/// If the writer hasn't caught up #LOG_FILE_STORM_DEADLINE_MS after the last
+/// producer is done, the test fails.
+///
+/// The sink must be running (start DTMF Decoder with `/logfile`).  The storm
+/// goes into the real log file.
+///
+/// This is not normally used, except for testing.
+///
+/// @return `true` if the sink passed.  `false` if there was a problem.
+bool logFileStormTest() {
+   if ( !sbRunning ) {
+      LOG_WARN_R( IDS_LOG_FILE_STORM_NOT_RUNNING );  // "The log file storm test needs /logfile.  Continuing."
+      return false;
+   }
+
+   HANDLE        hProducers[ LOG_FILE_STORM_PRODUCERS ];
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER start;
+   LARGE_INTEGER end;
+
+   QueryPerformanceFrequency( &frequency );
+   sdStormTicksToNs = 1.0e9 / (double) frequency.QuadPart;
+
+   ZeroMemory( (void*) sl64StormBuckets, sizeof( sl64StormBuckets ) );
+   sl64StormMaxNs   = 0;
+   sl64StormQueued  = 0;
+   sl64StormDropped = 0;
+   slStormGo        = 0;
+
+   /// The storm's messages (and anything other threads log) go into the
+   /// queue after this position
+   const LONG64 l64EnqueueBefore = sQueue.l64Enqueue;
+
+   for ( size_t i = 0 ; i < LOG_FILE_STORM_PRODUCERS ; i++ ) {
+      hProducers[ i ] = CreateThread( NULL, 0, logFileStormProducer, (LPVOID) i, 0, NULL );
+      if ( hProducers[ i ] == NULL ) {
+         FATAL_IN_LOG( L"Failed to create a log file storm thread." );  // Can't be localized
+         return false;
+      }
+   }
+
+   QueryPerformanceCounter( &start );
+   InterlockedExchange( &slStormGo, 1 );
+
+   WaitForMultipleObjects( LOG_FILE_STORM_PRODUCERS, hProducers, TRUE, INFINITE );
+
+   for ( size_t i = 0 ; i < LOG_FILE_STORM_PRODUCERS ; i++ ) {
+      CloseHandle( hProducers[ i ] );
+   }
+
+   const UINT64 u64Sent   = (UINT64) LOG_FILE_STORM_PRODUCERS * LOG_FILE_STORM_MESSAGES;
+   const UINT64 u64Queued = (UINT64) sl64StormQueued;
+
+   /// Every position between these was claimed by a producer or by another
+   /// thread that logged during the storm
+   const LONG64 l64EnqueueAfter = sQueue.l64Enqueue;
+   const UINT64 u64Other        = (UINT64) ( l64EnqueueAfter - l64EnqueueBefore ) - u64Queued;
+
+   /// Wait for the writer to get past the last of them
+   const ULONGLONG u64Deadline = GetTickCount64() + LOG_FILE_STORM_DEADLINE_MS;
+   bool bTimedOut = false;
+
+   while ( sQueue.l64Dequeue < l64EnqueueAfter ) {
+      if ( GetTickCount64() >= u64Deadline ) {
+         bTimedOut = true;
+         break;
+      }
+      Sleep( LOG_FILE_WRITE_MS );
+   }
+
+   QueryPerformanceCounter( &end );
+
+   /// The writer handles the queue in order, so everything it read in the
+   /// storm's window -- except the other threads' messages -- is the storm's
+   const LONG64 l64Dequeue = sQueue.l64Dequeue;
+   const UINT64 u64Handled = (UINT64) ( ( l64Dequeue < l64EnqueueAfter ? l64Dequeue : l64EnqueueAfter ) - l64EnqueueBefore );
+   const UINT64 u64Written = ( u64Handled > u64Other ) ? u64Handled - u64Other : 0;
+   const UINT64 u64Dropped = (UINT64) sl64StormDropped;
+   const double seconds    = (double) ( end.QuadPart - start.QuadPart ) / (double) frequency.QuadPart;
+
+   LOG_INFO_R( IDS_LOG_FILE_STORM_RESULT,  // "Log file storm:  Producers: %d   Sent: %llu   Written: %llu   Dropped: %llu   Other threads: %llu   Records/sec: %.0f   Call latency p50: %llu ns   p99: %llu ns   p99.9: %llu ns   max: %lld ns"
+      LOG_FILE_STORM_PRODUCERS, u64Sent, u64Written, u64Dropped, u64Other, (double) u64Written / seconds,
+      logFileStormPercentile( u64Sent, 50.0 ),
+      logFileStormPercentile( u64Sent, 99.0 ),
+      logFileStormPercentile( u64Sent, 99.9 ),
+      (LONG64) sl64StormMaxNs );
+
+   if ( bTimedOut ) {
+      LOG_WARN_R( IDS_LOG_FILE_STORM_TIMED_OUT, LOG_FILE_STORM_DEADLINE_MS, u64Written, u64Queued );  // "The log file storm test timed out.  After %d ms, the writer had written %llu of %llu queued messages."
+      return false;
+   }
+
+   return u64Written + u64Dropped == u64Sent;
+}
@@ -0,0 +1,30 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Extend log.cpp with an asynchronous, batched file sink (with rotation)
+///
+/// @file    logFile.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>  // For BOOL, UINT64, etc.
+#include "log.h"      // For logLevels_t and MAX_LOG_STRING
+
+
+/// The number of log records the sink can hold.  Must be a power of 2.
+#define LOG_FILE_QUEUE_DEPTH (1024)
+
+
+extern BOOL logFileParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine );
+extern BOOL logFileInit();
+extern BOOL logFileCleanup();
+extern bool logFileWrite( _In_ const logLevels_t logLevel, _In_z_ const PCWSTR pwszMessage );
+extern void logFileFlush();
+extern void logFileWakeWriter();
+extern UINT64 logFileDropped();
+extern bool logFileStormTest();
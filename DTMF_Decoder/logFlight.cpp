@@ -0,0 +1,566 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Extend log.cpp with a binary flight recorder for Windows Error Reporting
+///
+/// logWER.cpp used to copy every log message into two 4K `WCHAR` buffers
+/// (the first messages and the last messages), from every thread, without a
+/// lock.  Now, #logFlightRecord copies a timestamp, the level, the resource
+/// ID and the first #LOG_FLIGHT_MAX_ARGS raw arguments into a record.  The
+/// format's conversions say how many arguments there are and what type each
+/// one is.  No formatting, no string copies and no locks:
+///   - The first #LOG_FLIGHT_FIRST_DEPTH records (from any thread) go into
+///     #sFirst and are never overwritten.  This preserves the startup logs.
+///     A record's slot is claimed with one `InterlockedIncrement`.
+///   - After that, each thread writes into its own ring (claimed the first
+///     time it logs), which keeps its last #LOG_FLIGHT_RING_DEPTH records.
+///
+/// The records are only turned into text when there's a report to send.
+/// #logFlightRender merges everything by timestamp and renders it with the
+/// same `IDS_*` strings the loggers use.  #logFlightRegister registers the
+/// raw records with WER at startup, so they are in the dump if the program
+/// crashes.
+///
+/// The log queue in log.cpp keeps its messages the same way:  #logQ copies
+/// the arguments with #logFlightCaptureArgs and the main thread renders them
+/// with #logFlightFormat when it dequeues the message.
+///
+/// String arguments are just pointers, and the string may be gone by the time
+/// the record is rendered.  So, a string is only rendered if it's inside the
+/// program's image (string literals and globals).  Otherwise, it's rendered
+/// as its address.
+///
+/// ## Debugging& Instrumentation API
+/// | API                      | Link                                                                                        |
+/// |--------------------------| --------------------------------------------------------------------------------------------|
+/// | `WerRegisterMemoryBlock` | https://learn.microsoft.com/en-us/windows/win32/api/werapi/nf-werapi-werregistermemoryblock |
+/// | `va_copy`                | https://learn.microsoft.com/en-us/cpp/c-runtime-library/reference/va-arg-va-copy-va-end-va-start?view=msvc-170 |
+/// | `GetModuleHandleW`       | https://learn.microsoft.com/en-us/windows/win32/api/libloaderapi/nf-libloaderapi-getmodulehandlew |
+///
+/// @file    logFlight.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <stddef.h>       // For offsetof
+#include <stdio.h>        // For swprintf_s
+#include <werapi.h>       // For WerRegisterMemoryBlock
+
+#include "log.h"          // For LOG_INFO_R
+#include "log_ex.h"       // For logGetStringFromResources
+#include "logRings.h"     // For claiming and merging the rings
+#include "logStrings.h"   // For logGetString
+#include "logFlight.h"    // For yourself
+
+
+/// The size of the rendered report (in characters)
+#define LOG_FLIGHT_TEXT_SIZE        (32 * 1024)
+
+/// The longest string argument that will be rendered (in characters)
+#define LOG_FLIGHT_MAX_STRING_ARG   (64)
+
+/// The number of calls timed in #logFlightBenchmark
+#define LOG_FLIGHT_BENCHMARK_CALLS  (100000)
+
+
+/// The records from startup.  Never overwritten.
+static logFlightRecord_t sFirst[ LOG_FLIGHT_FIRST_DEPTH ];
+
+/// The number of #sFirst slots that have been claimed (it keeps counting
+/// after #sFirst is full)
+static volatile LONG slFirstClaimed = 0;
+
+static logFlightRing_t sRings[ LOG_FLIGHT_RINGS ];  ///< The per-thread rings
+static volatile LONG64 sl64NoRingDropped = 0;       ///< Records dropped because the thread couldn't get a ring
+
+static_assert( offsetof( logFlightRecord_t, i64Timestamp ) == 0, "logRings.h needs the timestamp first" );
+
+/// Where #sRings are (for logRings.h)
+static const logRings_t sRingSet = {
+   (BYTE*) sRings, sizeof( logFlightRing_t ), LOG_FLIGHT_RINGS,
+   offsetof( logFlightRing_t, lOwned ), offsetof( logFlightRing_t, records ), sizeof( logFlightRecord_t ), LOG_FLIGHT_RING_DEPTH };
+
+static __declspec( thread ) logFlightRing_t* spRing = NULL;  ///< The calling thread's ring
+static __declspec( thread ) bool sbNoRing = false;           ///< `true` if the calling thread couldn't get a ring
+
+static WCHAR swsText[ LOG_FLIGHT_TEXT_SIZE ];  ///< The rendered report
+
+static INT64  si64Origin  = 0;    ///< Timestamps in the report are relative to the first record
+static double sdTicksToMs = 0.0;  ///< Converts performance counter ticks to milliseconds
+
+
+/// The type of the argument a conversion (like `%llu`) takes
+typedef enum {
+   LOG_FLIGHT_ARG_END,      ///< The format ended in the middle of a conversion
+   LOG_FLIGHT_ARG_NONE,     ///< `%%` doesn't take an argument
+   LOG_FLIGHT_ARG_UNKNOWN,  ///< A conversion we don't know.  Don't read any more arguments.
+   LOG_FLIGHT_ARG_INT,      ///< `%d`, `%u`, `%x`, `%c`, `%hu`, `%ld`, etc.
+   LOG_FLIGHT_ARG_INT64,    ///< `%lld`, `%llu`, `%I64x`, `%jd`, etc.
+   LOG_FLIGHT_ARG_SIZE,     ///< `%zu`, `%zx`, `%td`, `%Id`, etc.
+   LOG_FLIGHT_ARG_POINTER,  ///< `%s`, `%S`, `%p`, etc.
+   LOG_FLIGHT_ARG_DOUBLE    ///< `%f`, `%e`, `%g`, `%a`, etc.
+} logFlightArg_t;
+
+
+/// Claim a ring for the calling thread
+///
+/// @return The thread's ring or `NULL` if they are all taken
+static logFlightRing_t* logFlightClaimRing() {
+   if ( sbNoRing ) {
+      return NULL;
+   }
+
+   spRing = (logFlightRing_t*) logRingsClaim( &sRingSet );
+   if ( spRing == NULL ) {
+      sbNoRing = true;  // Don't look again
+   }
+
+   return spRing;
+}
+
+
+/// Release the calling thread's ring (if it has one).  Call this before a
+/// thread that logs ends.
+///
+/// The records stay in the ring.  The next thread to claim it continues where
+/// this one left off.
+void logFlightReleaseRing() {
+   if ( spRing != NULL ) {
+      logRingsRelease( &sRingSet, spRing );
+      spRing = NULL;
+   }
+}
+
+
+/// Copy one conversion (like `%-8.3llu`) out of a format and get the type of
+/// its argument.  #logFlightCaptureArgs and #logFlightFormat both use this, so
+/// they always agree on the arguments.
+///
+/// @param ppFormat The `%` that starts the conversion.  On return, the
+///                 character after the conversion.
+/// @param wsSpec   The conversion (with a `\0`)
+/// @param stSpec   The size of `wsSpec` (in characters)
+/// @return The type of the conversion's argument
+static logFlightArg_t logFlightParseSpec(
+   _Inout_                 const WCHAR** ppFormat,
+   _Out_writes_z_( stSpec )      WCHAR*  wsSpec,
+   _In_                    const size_t  stSpec ) {
+
+   const WCHAR* p = *ppFormat;
+   size_t stUsed = 0;
+
+   _ASSERTE( *p == L'%' && stSpec >= 4 );
+
+   wsSpec[ stUsed++ ] = *p++;
+   while ( *p != L'\0' && wcschr( L"-+ #0123456789.lhzjtIL", *p ) != NULL && stUsed < stSpec - 2 ) {
+      wsSpec[ stUsed++ ] = *p++;
+   }
+   wsSpec[ stUsed ] = L'\0';
+
+   if ( *p == L'\0' ) {
+      *ppFormat = p;
+      return LOG_FLIGHT_ARG_END;
+   }
+
+   const WCHAR wConversion = *p++;
+   wsSpec[ stUsed++ ] = wConversion;
+   wsSpec[ stUsed ]   = L'\0';
+   *ppFormat = p;
+
+   if ( wConversion == L'%' ) {
+      return LOG_FLIGHT_ARG_NONE;
+   }
+
+   if ( wcschr( L"sSZpn", wConversion ) != NULL ) {
+      return LOG_FLIGHT_ARG_POINTER;
+   }
+
+   if ( wcschr( L"fFeEgGaA", wConversion ) != NULL ) {
+      return LOG_FLIGHT_ARG_DOUBLE;
+   }
+
+   if ( wcschr( L"cC", wConversion ) != NULL ) {
+      return LOG_FLIGHT_ARG_INT;
+   }
+
+   if ( wcschr( L"diuoxX", wConversion ) == NULL ) {
+      return LOG_FLIGHT_ARG_UNKNOWN;
+   }
+
+   /// The size of an integer comes from its modifiers.  On Windows, `long`
+   /// is 32 bits.
+   if ( wcsstr( wsSpec, L"ll" ) != NULL || wcsstr( wsSpec, L"I64" ) != NULL || wcschr( wsSpec, L'j' ) != NULL ) {
+      return LOG_FLIGHT_ARG_INT64;
+   }
+
+   if ( wcsstr( wsSpec, L"I32" ) != NULL ) {
+      return LOG_FLIGHT_ARG_INT;
+   }
+
+   if ( wcschr( wsSpec, L'z' ) != NULL || wcschr( wsSpec, L't' ) != NULL || wcschr( wsSpec, L'I' ) != NULL ) {
+      return LOG_FLIGHT_ARG_SIZE;
+   }
+
+   return LOG_FLIGHT_ARG_INT;
+}
+
+
+/// Copy the first #LOG_FLIGHT_MAX_ARGS arguments -- only the ones the format
+/// has conversions for, each read with its real type
+///
+/// This never blocks, never takes a lock and never formats anything.
+///
+/// @param format The format string.  Its conversions say which arguments to
+///               read.
+/// @param args   The arguments to `format`
+/// @param pArgs  The raw arguments (render them with #logFlightFormat)
+/// @return The number of arguments copied into `pArgs`
+UINT logFlightCaptureArgs(
+   _In_z_                              const PCWSTR  format,
+   _In_                                      va_list args,
+   _Out_writes_( LOG_FLIGHT_MAX_ARGS )       UINT64* pArgs ) {
+
+   UINT         uArgs = 0;
+   const WCHAR* p     = format;
+   WCHAR        wsSpec[ 16 ];
+   va_list      copy;
+
+   va_copy( copy, args );
+   while ( p != NULL && uArgs < LOG_FLIGHT_MAX_ARGS && ( p = wcschr( p, L'%' ) ) != NULL ) {
+      const logFlightArg_t argType = logFlightParseSpec( &p, wsSpec, _countof( wsSpec ) );
+
+      if ( argType == LOG_FLIGHT_ARG_NONE ) {
+         continue;
+      } else if ( argType == LOG_FLIGHT_ARG_INT ) {
+         pArgs[ uArgs++ ] = (UINT64) (INT64) va_arg( copy, int );
+      } else if ( argType == LOG_FLIGHT_ARG_INT64 ) {
+         pArgs[ uArgs++ ] = va_arg( copy, UINT64 );
+      } else if ( argType == LOG_FLIGHT_ARG_SIZE ) {
+         pArgs[ uArgs++ ] = va_arg( copy, size_t );
+      } else if ( argType == LOG_FLIGHT_ARG_POINTER ) {
+         pArgs[ uArgs++ ] = (UINT_PTR) va_arg( copy, void* );
+      } else if ( argType == LOG_FLIGHT_ARG_DOUBLE ) {
+         const double d = va_arg( copy, double );
+         static_assert( sizeof( d ) == sizeof( pArgs[ 0 ] ), "A double must fit in an argument" );
+         CopyMemory( &pArgs[ uArgs++ ], &d, sizeof( d ) );
+      } else {
+         break;  // The end of the format or a conversion we don't know
+      }
+   }
+   va_end( copy );
+
+   return uArgs;
+}
+
+
+/// Record a log message in the flight recorder.  Called by the `_R`, `_Q`
+/// and `_W` loggers.
+///
+/// This never blocks, never takes a lock and never formats anything.
+///
+/// @param logLevel   The level of the message
+/// @param resourceId The ID of the resource string (or `0`)
+/// @param format     The format string.  Its conversions say which arguments
+///                   to read.  It's only kept if `resourceId` is `0`, so it
+///                   must be a string literal.
+/// @param args       The arguments to `format`
+void logFlightRecord(
+   _In_       const logLevels_t logLevel,
+   _In_       const UINT        resourceId,
+   _In_z_     const PCWSTR      format,
+   _In_             va_list     args ) {
+
+   logFlightRecord_t* pRecord = NULL;
+   logFlightRing_t*   pRing   = NULL;
+
+   /// Use #sFirst until it's full
+   if ( slFirstClaimed < LOG_FLIGHT_FIRST_DEPTH ) {
+      const LONG lSlot = InterlockedIncrement( &slFirstClaimed ) - 1;
+      if ( lSlot < LOG_FLIGHT_FIRST_DEPTH ) {
+         pRecord = &sFirst[ lSlot ];
+      }
+   }
+
+   if ( pRecord == NULL ) {
+      pRing = ( spRing != NULL ) ? spRing : logFlightClaimRing();
+      if ( pRing == NULL ) {
+         InterlockedIncrement64( &sl64NoRingDropped );
+         return;
+      }
+      pRecord = &pRing->records[ pRing->l64Head & ( LOG_FLIGHT_RING_DEPTH - 1 ) ];
+   }
+
+   LARGE_INTEGER now;
+   QueryPerformanceCounter( &now );  // Reads the TSC.  It's not a system call.
+
+   pRecord->pwszFormat  = ( resourceId == 0 ) ? format : NULL;
+   pRecord->uResourceId = resourceId;
+   pRecord->dwThreadId  = GetCurrentThreadId();
+   pRecord->logLevel    = logLevel;
+
+   pRecord->uArgs = logFlightCaptureArgs( format, args, pRecord->args );
+
+   /// The timestamp goes last.  A record with a timestamp is complete.
+   pRecord->i64Timestamp = now.QuadPart;
+
+   if ( pRing != NULL ) {
+      pRing->l64Head = pRing->l64Head + 1;
+   }
+}
+
+
+/// Register the records with WER, so they are in the dump if the program
+/// crashes.  Called by #logWerInit.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL logFlightRegister() {
+   HRESULT hr;
+
+   hr = WerRegisterMemoryBlock( sFirst, sizeof( sFirst ) );
+   if ( hr != S_OK ) {
+      return FALSE;
+   }
+
+   hr = WerRegisterMemoryBlock( sRings, sizeof( sRings ) );
+   if ( hr != S_OK ) {
+      return FALSE;
+   }
+
+   hr = WerRegisterMemoryBlock( swsText, sizeof( swsText ) );
+   if ( hr != S_OK ) {
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/// Check if a string is inside the program's image (a string literal or a
+/// global), so it's safe to read
+///
+/// @param p The string
+/// @return `true` if it's safe to render
+static bool logFlightIsInImage( _In_ const UINT_PTR p ) {
+   static UINT_PTR suImageStart = 0;
+   static UINT_PTR suImageEnd   = 0;
+
+   if ( suImageStart == 0 ) {
+      const BYTE* pBase = (const BYTE*) GetModuleHandleW( NULL );
+      const IMAGE_DOS_HEADER* pDos = (const IMAGE_DOS_HEADER*) pBase;
+      const IMAGE_NT_HEADERS* pNt  = (const IMAGE_NT_HEADERS*) ( pBase + pDos->e_lfanew );
+
+      suImageStart = (UINT_PTR) pBase;
+      suImageEnd   = suImageStart + pNt->OptionalHeader.SizeOfImage;
+   }
+
+   return p >= suImageStart && p + LOG_FLIGHT_MAX_STRING_ARG * sizeof( WCHAR ) <= suImageEnd;
+}
+
+
+/// Render a format string and raw arguments from #logFlightCaptureArgs
+///
+/// This is a small `printf`:  Each conversion is rendered by `swprintf_s`
+/// with its argument (as the type #logFlightRecord read it), except for
+/// strings (see #logFlightIsInImage).  Conversions past the last argument
+/// that was kept are rendered as `?`.
+///
+/// @param pwszFormat The format
+/// @param args       The raw arguments
+/// @param uArgs      The number of arguments
+/// @param pwsOut     The buffer
+/// @param stOut      The size of the buffer (in characters)
+/// @return The number of characters written
+size_t logFlightFormat(
+   _In_z_                 const PCWSTR  pwszFormat,
+   _In_reads_( uArgs )    const UINT64* args,
+   _In_                   const UINT    uArgs,
+   _Out_writes_( stOut )        WCHAR*  pwsOut,
+   _In_                   const size_t  stOut ) {
+
+   size_t stUsed = 0;
+   size_t stArg  = 0;
+   const WCHAR* p = pwszFormat;
+
+   while ( *p != L'\0' && stUsed + 1 < stOut ) {
+      if ( *p != L'%' ) {
+         pwsOut[ stUsed++ ] = *p++;
+         continue;
+      }
+
+      /// Copy one conversion (like `%-8.3llu`) into its own format
+      WCHAR wsSpec[ 16 ];
+      const logFlightArg_t argType = logFlightParseSpec( &p, wsSpec, _countof( wsSpec ) );
+      if ( argType == LOG_FLIGHT_ARG_END ) {
+         break;
+      }
+
+      const WCHAR  wConversion = wsSpec[ wcslen( wsSpec ) - 1 ];
+      const UINT64 u64Arg      = ( stArg < uArgs ) ? args[ stArg ] : 0;
+      int iChars = 0;
+
+      if ( argType == LOG_FLIGHT_ARG_NONE ) {
+         iChars = swprintf_s( pwsOut + stUsed, stOut - stUsed, L"%%" );
+      } else if ( stArg >= uArgs || argType == LOG_FLIGHT_ARG_UNKNOWN ) {
+         iChars = swprintf_s( pwsOut + stUsed, stOut - stUsed, L"?" );  // We didn't keep this argument
+         stArg = uArgs;  // #logFlightRecord stopped here too
+      } else if ( wConversion == L's' || wConversion == L'S' ) {
+         if ( u64Arg != 0 && logFlightIsInImage( (UINT_PTR) u64Arg ) ) {
+            iChars = swprintf_s( pwsOut + stUsed, stOut - stUsed, ( wConversion == L's' ) ? L"%.*s" : L"%.*S", LOG_FLIGHT_MAX_STRING_ARG, (void*) (UINT_PTR) u64Arg );
+         } else {
+            iChars = swprintf_s( pwsOut + stUsed, stOut - stUsed, L"<%p>", (void*) (UINT_PTR) u64Arg );
+         }
+         stArg++;
+      } else if ( argType == LOG_FLIGHT_ARG_POINTER ) {
+         iChars = swprintf_s( pwsOut + stUsed, stOut - stUsed, L"<%p>", (void*) (UINT_PTR) u64Arg );  // Like `%p` (and `%n` is never written)
+         stArg++;
+      } else if ( argType == LOG_FLIGHT_ARG_DOUBLE ) {
+         double d;
+         CopyMemory( &d, &u64Arg, sizeof( d ) );
+         iChars = swprintf_s( pwsOut + stUsed, stOut - stUsed, wsSpec, d );
+         stArg++;
+      } else if ( argType == LOG_FLIGHT_ARG_INT64 ) {
+         iChars = swprintf_s( pwsOut + stUsed, stOut - stUsed, wsSpec, u64Arg );
+         stArg++;
+      } else if ( argType == LOG_FLIGHT_ARG_SIZE ) {
+         iChars = swprintf_s( pwsOut + stUsed, stOut - stUsed, wsSpec, (size_t) u64Arg );
+         stArg++;
+      } else {
+         iChars = swprintf_s( pwsOut + stUsed, stOut - stUsed, wsSpec, (int) u64Arg );
+         stArg++;
+      }
+
+      stUsed += ( iChars > 0 ) ? (size_t) iChars : 0;
+   }
+
+   pwsOut[ stUsed ] = L'\0';
+
+   return stUsed;
+}
+
+
+/// Render one record as a line in #swsText
+///
+/// @param pRecord The record
+/// @param pstUsed The characters used in #swsText so far
+static void logFlightRenderRecord(
+   _In_    const logFlightRecord_t* pRecord,
+   _Inout_       size_t*            pstUsed ) {
+
+   static const PCWSTR swsLevels[] = { L"TRACE", L"DEBUG", L"INFO ", L"WARN ", L"ERROR", L"FATAL" };
+
+   const size_t stRemaining = _countof( swsText ) - *pstUsed;
+   if ( stRemaining < 64 ) {
+      return;  // Full
+   }
+
+   PCWSTR pwszFormat = ( pRecord->uResourceId != 0 ) ? logGetString( pRecord->uResourceId ) : pRecord->pwszFormat;
+   if ( pwszFormat == NULL ) {
+      pwszFormat = L"?";
+   }
+
+   int iChars = swprintf_s( swsText + *pstUsed, stRemaining, L"%10.3f %5lu %s ",
+      (double) ( pRecord->i64Timestamp - si64Origin ) * sdTicksToMs,
+      pRecord->dwThreadId,
+      ( (size_t) pRecord->logLevel < _countof( swsLevels ) ) ? swsLevels[ pRecord->logLevel ] : L"?    " );
+   if ( iChars <= 0 ) {
+      return;
+   }
+   *pstUsed += (size_t) iChars;
+
+   *pstUsed += logFlightFormat( pwszFormat, pRecord->args, pRecord->uArgs, swsText + *pstUsed, _countof( swsText ) - *pstUsed - 2 );
+
+   swsText[ ( *pstUsed )++ ] = L'\n';
+   swsText[ *pstUsed ] = L'\0';
+}
+
+
+/// Render the flight recorder into text (oldest record first)
+///
+/// The startup records come first, then the rings merged by timestamp.  This
+/// is called when a report is submitted, so the cost of formatting is only
+/// paid when it's needed.  Threads may still be logging while this runs, so
+/// a record may be torn -- that's OK for a crash report.
+///
+/// @return The text (it's also registered with WER)
+PCWSTR logFlightRender() {
+   LARGE_INTEGER frequency;
+   QueryPerformanceFrequency( &frequency );
+
+   sdTicksToMs = 1000.0 / (double) frequency.QuadPart;
+   si64Origin  = sFirst[ 0 ].i64Timestamp;
+
+   size_t stUsed = 0;
+   swsText[ 0 ] = L'\0';
+
+   const LONG lFirst = ( slFirstClaimed < LOG_FLIGHT_FIRST_DEPTH ) ? slFirstClaimed : LOG_FLIGHT_FIRST_DEPTH;
+   for ( LONG i = 0 ; i < lFirst ; i++ ) {
+      if ( sFirst[ i ].i64Timestamp != 0 ) {
+         logFlightRenderRecord( &sFirst[ i ], &stUsed );
+      }
+   }
+
+   /// Each ring is in time order, so merge them by always taking the oldest
+   /// record at the tail of any ring (see #logRingsOldest)
+   LONG64 l64Tails[ LOG_FLIGHT_RINGS ];
+   LONG64 l64Heads[ LOG_FLIGHT_RINGS ];
+
+   for ( size_t i = 0 ; i < LOG_FLIGHT_RINGS ; i++ ) {
+      l64Heads[ i ] = sRings[ i ].l64Head;
+      l64Tails[ i ] = ( l64Heads[ i ] > LOG_FLIGHT_RING_DEPTH ) ? l64Heads[ i ] - LOG_FLIGHT_RING_DEPTH : 0;
+   }
+
+   for ( ;; ) {
+      const size_t stOldest = logRingsOldest( &sRingSet, l64Tails, l64Heads );
+      if ( stOldest == LOG_FLIGHT_RINGS ) {
+         break;
+      }
+
+      logFlightRenderRecord( (const logFlightRecord_t*) logRingsRecord( &sRingSet, stOldest, l64Tails[ stOldest ] ), &stUsed );
+      l64Tails[ stOldest ]++;
+   }
+
+   if ( sl64NoRingDropped > 0 ) {
+      swprintf_s( swsText + stUsed, _countof( swsText ) - stUsed, L"%llu records dropped (no ring)\n", (UINT64) sl64NoRingDropped );
+   }
+
+   return swsText;
+}
+
+
+/// Time #logFlightRecord (the cost every `_R`, `_Q` and `_W` log pays for
+/// the flight recorder) and show a sample of the rendered text in DebugView
+///
+/// This is not normally used, except for testing.
+void logFlightBenchmark() {
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER start;
+   LARGE_INTEGER end;
+
+   QueryPerformanceFrequency( &frequency );
+
+   /// `va_list` can't be built by hand, so time it through a helper that
+   /// takes `...`
+   struct helper {
+      static void record( const UINT resourceId, ... ) {
+         va_list args;
+         va_start( args, resourceId );
+         logFlightRecord( LOG_LEVEL_TRACE, resourceId, L"", args );
+         va_end( args );
+      }
+   };
+
+   QueryPerformanceCounter( &start );
+   for ( size_t i = 0 ; i < LOG_FLIGHT_BENCHMARK_CALLS ; i++ ) {
+      helper::record( IDS_LOG_TRACE_BENCHMARK_MESSAGE, i );  // "Trace benchmark message:  %zu"
+   }
+   QueryPerformanceCounter( &end );
+
+   const double ns = (double) ( end.QuadPart - start.QuadPart ) * 1.0e9 / (double) frequency.QuadPart / LOG_FLIGHT_BENCHMARK_CALLS;
+
+   OutputDebugStringW( logFlightRender() );
+
+   LOG_INFO_R( IDS_LOG_FLIGHT_BENCHMARK, ns );  // "Flight recorder:  %.1f ns/record"
+}
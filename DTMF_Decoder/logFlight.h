@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Extend log.cpp with a binary flight recorder for Windows Error Reporting
+///
+/// @file    logFlight.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>  // For BOOL, UINT_PTR, etc.
+#include <stdarg.h>   // For va_list
+#include "log.h"      // For logLevels_t
+
+
+/// The maximum number of arguments in a flight record
+#define LOG_FLIGHT_MAX_ARGS    (4)
+
+/// The number of records kept from startup (never overwritten)
+#define LOG_FLIGHT_FIRST_DEPTH (64)
+
+/// The number of records in each thread's ring.  Must be a power of 2.
+#define LOG_FLIGHT_RING_DEPTH  (128)
+
+/// The maximum number of threads that can hold a ring at once
+#define LOG_FLIGHT_RINGS       (32)
+
+
+/// One flight record.  It holds everything needed to render the message
+/// later:  The format (a resource ID or a wide string literal), the time,
+/// the thread, the level and the raw arguments.
+typedef struct {
+   INT64       i64Timestamp;                 ///< When it was logged (in performance counter ticks).  `0` if the record is empty.
+   PCWSTR      pwszFormat;                   ///< The format when there's no resource ID.  Must be a string literal.
+   UINT        uResourceId;                  ///< The resource string used to format the arguments (or `0`)
+   DWORD       dwThreadId;                   ///< The thread that logged it
+   logLevels_t logLevel;                     ///< The level of the message
+   UINT        uArgs;                        ///< The number of arguments in #logFlightRecord_t::args
+   UINT64      args[ LOG_FLIGHT_MAX_ARGS ];  ///< The raw arguments (each one read with its real type)
+} logFlightRecord_t;
+
+
+/// One thread's ring of flight records.  Only the thread that owns the ring
+/// writes to it.  It's only read when a report is rendered (or from a dump).
+typedef struct DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) {
+   volatile LONG64   l64Head;                           ///< The next record the owner will write
+   volatile LONG     lOwned;                            ///< `1` if a thread holds this ring
+   logFlightRecord_t records[ LOG_FLIGHT_RING_DEPTH ];  ///< The records
+} logFlightRing_t;
+
+
+extern void logFlightRecord(
+   _In_       const logLevels_t logLevel,
+   _In_       const UINT        resourceId,
+   _In_z_     const PCWSTR      format,
+   _In_             va_list     args );
+
+extern UINT logFlightCaptureArgs(
+   _In_z_                              const PCWSTR  format,
+   _In_                                      va_list args,
+   _Out_writes_( LOG_FLIGHT_MAX_ARGS )       UINT64* pArgs );
+
+extern size_t logFlightFormat(
+   _In_z_                 const PCWSTR  pwszFormat,
+   _In_reads_( uArgs )    const UINT64* args,
+   _In_                   const UINT    uArgs,
+   _Out_writes_( stOut )        WCHAR*  pwsOut,
+   _In_                   const size_t  stOut );
+
+extern BOOL   logFlightRegister();
+extern PCWSTR logFlightRender();
+extern void   logFlightReleaseRing();
+extern void   logFlightBenchmark();
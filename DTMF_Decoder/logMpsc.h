@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// A bounded, lock-free, multi-producer / single-consumer queue
+///
+/// This is Dmitry Vyukov's bounded queue.  Producers claim a position with
+/// one `InterlockedCompareExchange64` and never wait for each other or the
+/// consumer.  If the queue is full, the producer gives up and the drop is
+/// counted.
+///
+/// The log queue (log.cpp) and the file sink's queue (logFile.cpp) both use
+/// it.  The queue only keeps the positions and each cell's sequence number.
+/// The cells belong to the caller and each one starts with its
+/// `volatile LONG64` sequence number.
+///
+/// The sequence number says who owns a cell.  When it's equal to a
+/// producer's position, the cell is free for that producer.  When it's
+/// `position + 1`, the cell is ready for the consumer.  After the consumer is
+/// done with it, it's `position + depth` -- so it's free for the next lap.
+///
+/// @see https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+///
+/// @file    logMpsc.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>  // For LONG64, InterlockedCompareExchange64, etc.
+#include <crtdbg.h>   // For _ASSERTE
+
+
+/// A queue's positions.  The producers' position, the consumer's position and
+/// the drop count are on separate cache lines, so they don't fight.
+typedef struct {
+   BYTE*  pCells;      ///< The caller's first cell
+   size_t stCellSize;  ///< The distance between the cells (in bytes)
+   LONG64 l64Depth;    ///< The number of cells.  Must be a power of 2.
+   DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) volatile LONG64 l64Enqueue;  ///< The next position a producer will claim
+   DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) volatile LONG64 l64Dequeue;  ///< The next position the consumer will read
+   DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) volatile LONG64 l64Dropped;  ///< The number of messages dropped because the queue was full
+} logMpsc_t;
+
+
+/// @param pQueue      The queue
+/// @param l64Position A position
+/// @return The index of the position's cell
+__forceinline size_t logMpscIndex( _In_ const logMpsc_t* pQueue, _In_ const LONG64 l64Position ) {
+   return (size_t) ( l64Position & ( pQueue->l64Depth - 1 ) );
+}
+
+
+/// @param pQueue      The queue
+/// @param l64Position A position
+/// @return The sequence number of the position's cell
+__forceinline volatile LONG64* logMpscSequence( _In_ const logMpsc_t* pQueue, _In_ const LONG64 l64Position ) {
+   return (volatile LONG64*) ( pQueue->pCells + logMpscIndex( pQueue, l64Position ) * pQueue->stCellSize );
+}
+
+
+/// Initialize / reset a queue.  Every cell is free for the first lap.
+///
+/// Only call this when nobody is using the queue.
+///
+/// @param pQueue     The queue
+/// @param pCells     The first cell.  Each cell must start with its
+///                   `volatile LONG64` sequence number.
+/// @param stCellSize The size of a cell (in bytes)
+/// @param l64Depth   The number of cells.  Must be a power of 2.
+__forceinline void logMpscReset(
+   _Out_ logMpsc_t*   pQueue,
+   _In_  void*        pCells,
+   _In_  const size_t stCellSize,
+   _In_  const LONG64 l64Depth ) {
+   _ASSERTE( ( l64Depth & ( l64Depth - 1 ) ) == 0 );
+
+   pQueue->pCells     = (BYTE*) pCells;
+   pQueue->stCellSize = stCellSize;
+   pQueue->l64Depth   = l64Depth;
+
+   for ( LONG64 i = 0 ; i < l64Depth ; i++ ) {
+      *logMpscSequence( pQueue, i ) = i;
+   }
+
+   pQueue->l64Enqueue = 0;
+   pQueue->l64Dequeue = 0;
+   pQueue->l64Dropped = 0;
+
+   MemoryBarrier();
+}
+
+
+/// Claim a cell for a producer.  This never blocks and never takes a lock.
+///
+/// After filling the cell, call #logMpscPublish.
+///
+/// @param pQueue The queue
+/// @return The claimed position.  `-1` if the queue was full (the drop was
+///         counted).
+__forceinline LONG64 logMpscClaim( _Inout_ logMpsc_t* pQueue ) {
+   LONG64 l64Position = pQueue->l64Enqueue;
+
+   for ( ;; ) {
+      const LONG64 l64Diff = *logMpscSequence( pQueue, l64Position ) - l64Position;
+
+      if ( l64Diff == 0 ) {  // The cell is free.  Try to claim it.
+         const LONG64 l64Was = InterlockedCompareExchange64( &pQueue->l64Enqueue, l64Position + 1, l64Position );
+         if ( l64Was == l64Position ) {
+            return l64Position;
+         }
+         l64Position = l64Was;  // Another producer got it.  Try the next one.
+      } else if ( l64Diff < 0 ) {  // The consumer hasn't freed the cell from the last lap.  The queue is full.
+         InterlockedIncrement64( &pQueue->l64Dropped );
+         return -1;
+      } else {  // Another producer got here first.  Catch up.
+         l64Position = pQueue->l64Enqueue;
+      }
+   }
+}
+
+
+/// Hand a filled cell to the consumer
+///
+/// @param pQueue      The queue
+/// @param l64Position The position from #logMpscClaim
+__forceinline void logMpscPublish( _Inout_ logMpsc_t* pQueue, _In_ const LONG64 l64Position ) {
+   InterlockedExchange64( logMpscSequence( pQueue, l64Position ), l64Position + 1 );  // A full barrier, so the cell is visible first
+}
+
+
+/// Get the position at the head of the queue if its cell is ready to be read
+///
+/// Only call this from the consumer.
+///
+/// @param pQueue The queue
+/// @return The position.  `-1` if the queue is empty (or the producer
+///         hasn't finished publishing it).
+__forceinline LONG64 logMpscHead( _In_ const logMpsc_t* pQueue ) {
+   const LONG64 l64Position = pQueue->l64Dequeue;
+
+   if ( *logMpscSequence( pQueue, l64Position ) != l64Position + 1 ) {
+      return -1;
+   }
+
+   MemoryBarrier();  // Read the sequence before the cell
+
+   return l64Position;
+}
+
+
+/// Give the cell at the head of the queue back to the producers and move on.
+/// The head must be ready (see #logMpscHead).
+///
+/// Only call this from the consumer.
+///
+/// @param pQueue The queue
+__forceinline void logMpscRelease( _Inout_ logMpsc_t* pQueue ) {
+   const LONG64 l64Position = pQueue->l64Dequeue;
+
+   _ASSERTE( *logMpscSequence( pQueue, l64Position ) == l64Position + 1 );
+
+   InterlockedExchange64( logMpscSequence( pQueue, l64Position ), l64Position + pQueue->l64Depth );
+   pQueue->l64Dequeue = l64Position + 1;
+}
+
+
+/// The number of claimed cells.  Producers may be in the middle of filling
+/// some of them.
+///
+/// @param pQueue The queue
+/// @return The size of the queue
+__forceinline size_t logMpscSize( _In_ const logMpsc_t* pQueue ) {
+   const LONG64 l64Dequeue = pQueue->l64Dequeue;  // Read the dequeue position first.  It never passes the enqueue position.
+   const LONG64 l64Enqueue = pQueue->l64Enqueue;
+
+   return (size_t) ( l64Enqueue - l64Dequeue );
+}
@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// An array of per-thread rings of timestamped records
+///
+/// The trace logger (logTrace.cpp) and the flight recorder (logFlight.cpp)
+/// both give each thread that logs its own ring.  A thread claims a free ring
+/// with one `InterlockedCompareExchange` the first time it logs and releases
+/// it when it ends.  The reader merges the rings in time order by always
+/// taking the oldest record at the tail of any ring.
+///
+/// The rings and records belong to the caller.  #logRings_t says where they
+/// are:  Each ring has a `volatile LONG` owner flag and an array of records,
+/// and each record starts with its `INT64` timestamp.
+///
+/// @file    logRings.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>  // For LONG, INT64, InterlockedCompareExchange, etc.
+
+
+/// Where an array of rings and their records are
+typedef struct {
+   BYTE*  pRings;           ///< The caller's first ring
+   size_t stRingSize;       ///< The distance between the rings (in bytes)
+   size_t stRings;          ///< The number of rings
+   size_t stOwnedOffset;    ///< Where a ring's `volatile LONG` owner flag is (`1` if a thread holds it)
+   size_t stRecordsOffset;  ///< Where a ring's first record is
+   size_t stRecordSize;     ///< The distance between the records (in bytes)
+   LONG64 l64Depth;         ///< The number of records in each ring.  Must be a power of 2.
+} logRings_t;
+
+
+/// @param pRings The rings
+/// @param pRing  A ring
+/// @return The ring's owner flag
+__forceinline volatile LONG* logRingsOwned( _In_ const logRings_t* pRings, _In_ const void* pRing ) {
+   return (volatile LONG*) ( (const BYTE*) pRing + pRings->stOwnedOffset );
+}
+
+
+/// Claim a free ring for the calling thread
+///
+/// @param pRings The rings
+/// @return The ring or `NULL` if they are all taken
+__forceinline void* logRingsClaim( _In_ const logRings_t* pRings ) {
+   for ( size_t i = 0 ; i < pRings->stRings ; i++ ) {
+      BYTE* pRing = pRings->pRings + i * pRings->stRingSize;
+      volatile LONG* plOwned = logRingsOwned( pRings, pRing );
+
+      if ( *plOwned == 0 && InterlockedCompareExchange( plOwned, 1, 0 ) == 0 ) {
+         return pRing;
+      }
+   }
+
+   return NULL;
+}
+
+
+/// Release a ring.  Its records stay in it.
+///
+/// @param pRings The rings
+/// @param pRing  The ring from #logRingsClaim
+__forceinline void logRingsRelease( _In_ const logRings_t* pRings, _Inout_ void* pRing ) {
+   InterlockedExchange( logRingsOwned( pRings, pRing ), 0 );
+}
+
+
+/// @param pRings      The rings
+/// @param stRing      The index of a ring
+/// @param l64Position A position in the ring
+/// @return The position's record
+__forceinline void* logRingsRecord( _In_ const logRings_t* pRings, _In_ const size_t stRing, _In_ const LONG64 l64Position ) {
+   return pRings->pRings + stRing * pRings->stRingSize + pRings->stRecordsOffset
+        + (size_t) ( l64Position & ( pRings->l64Depth - 1 ) ) * pRings->stRecordSize;
+}
+
+
+/// Find the ring whose next record is the oldest.  Each ring is in time
+/// order, so taking it (and moving its tail) again and again merges the
+/// rings in time order.
+///
+/// @param pRings    The rings
+/// @param pl64Tails The next record to read in each ring
+/// @param pl64Heads The end of the records to read in each ring
+/// @return The index of the ring.  `stRings` if every ring is empty.
+__forceinline size_t logRingsOldest(
+   _In_                          const logRings_t* pRings,
+   _In_reads_( pRings->stRings ) const LONG64*     pl64Tails,
+   _In_reads_( pRings->stRings ) const LONG64*     pl64Heads ) {
+
+   size_t stOldest  = pRings->stRings;
+   INT64  i64Oldest = 0;
+
+   for ( size_t i = 0 ; i < pRings->stRings ; i++ ) {
+      if ( pl64Tails[ i ] == pl64Heads[ i ] ) {
+         continue;  // Empty
+      }
+
+      const INT64 i64Timestamp = *(const INT64*) logRingsRecord( pRings, i, pl64Tails[ i ] );
+
+      if ( stOldest == pRings->stRings || i64Timestamp < i64Oldest ) {
+         stOldest  = i;
+         i64Oldest = i64Timestamp;
+      }
+   }
+
+   return stOldest;
+}
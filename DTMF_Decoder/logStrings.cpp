@@ -0,0 +1,150 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Extend log.cpp with a preloaded table of the resource strings
+///
+/// Every `_R` and `_Q` log used to call `LoadStringW` and copy the format
+/// string into a buffer on the stack.  Now, #logInit loads every string once
+/// into one contiguous arena and #logGetString is an array lookup.
+///
+/// The table is indexed by `resourceId - LOG_STRING_FIRST_ID`.  The range of
+/// IDs and the size of the arena come from `logStrings_generated.h`, which
+/// `bin/generate_strings.py` writes from `DTMF_Decoder.rc` and `Resource.h`
+/// before every build.  On Windows, the strings come from the resources, so
+/// they are localized.  Builds without Windows resources copy them from the
+/// embedded table in logStringsEmbedded.cpp.
+///
+/// The table is written once (before any other threads start) and only read
+/// after that, so it doesn't need a lock.
+///
+/// ## Generic Win32 API
+/// | API           | Link                                                                               |
+/// |---------------| -----------------------------------------------------------------------------------|
+/// | `LoadStringW` | https://learn.microsoft.com/en-us/windows/win32/api/winuser/nf-winuser-loadstringw |
+///
+/// @file    logStrings.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include "log.h"          // For MAX_LOG_STRING
+#include "log_ex.h"       // For sphInstance and FATAL_IN_LOG
+#include "logStrings.h"   // For yourself
+
+#include "logStrings_generated.h"  // For the range of IDs and the size of the arena
+
+
+/// The number of slots in the string table
+#define LOG_STRING_COUNT ( LOG_STRING_LAST_ID - LOG_STRING_FIRST_ID + 1 )
+
+/// Where each string starts in #swsArena (plus 1).  `0` means there's no
+/// string with that ID.
+static UINT32 suOffsets[ LOG_STRING_COUNT ];
+
+/// All of the strings, one after another, each with a `\0`.  It's twice the
+/// size of the English strings to leave room for translations.
+static WCHAR swsArena[ LOG_STRING_ARENA_CHARS * 2 ];
+
+
+/// Add a string to the table
+///
+/// @param resourceId The string's ID
+/// @param pwszText   The string (it doesn't need a `\0`)
+/// @param stLength   The length of the string (in characters)
+/// @param pstUsed    The characters used in #swsArena so far
+/// @return `TRUE` if successful.  `FALSE` if the arena is full.
+static BOOL logStringsAdd(
+   _In_                       const UINT    resourceId,
+   _In_reads_( stLength )     const WCHAR*  pwszText,
+   _In_                       const size_t  stLength,
+   _Inout_                          size_t* pstUsed ) {
+
+   if ( resourceId < LOG_STRING_FIRST_ID || resourceId > LOG_STRING_LAST_ID ) {
+      return TRUE;  // Not a string the logger uses
+   }
+
+   if ( *pstUsed + stLength + 1 > _countof( swsArena ) ) {
+      return FALSE;
+   }
+
+   CopyMemory( &swsArena[ *pstUsed ], pwszText, stLength * sizeof( WCHAR ) );
+   swsArena[ *pstUsed + stLength ] = L'\0';
+
+   suOffsets[ resourceId - LOG_STRING_FIRST_ID ] = (UINT32) *pstUsed + 1;
+   *pstUsed += stLength + 1;
+
+   return TRUE;
+}
+
+
+/// Load every string into the table.  Called by #logInit.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL logStringsInit() {
+   size_t stUsed = 0;
+
+   ZeroMemory( suOffsets, sizeof( suOffsets ) );
+
+#ifdef _WIN32
+   _ASSERTE( sphInstance != NULL );
+
+   for ( UINT id = LOG_STRING_FIRST_ID ; id <= LOG_STRING_LAST_ID ; id++ ) {
+      /// With a buffer size of `0`, `LoadStringW` returns a read-only
+      /// pointer to the string in the resources (without a `\0`)
+      const WCHAR* pwszText = NULL;
+      int iLength = LoadStringW( *sphInstance, id, (LPWSTR) &pwszText, 0 );
+      if ( iLength <= 0 || pwszText == NULL ) {
+         continue;  // There's no string with this ID
+      }
+
+      if ( iLength >= MAX_LOG_STRING ) {
+         iLength = MAX_LOG_STRING - 1;  // The same as the old `LoadStringW` into a log buffer
+      }
+
+      if ( !logStringsAdd( id, pwszText, (size_t) iLength, &stUsed ) ) {
+         FATAL_IN_LOG( L"The log's string table is full.  Exiting immediately." );  // Can't be localized
+         return FALSE;
+      }
+   }
+#else
+   for ( UINT id = LOG_STRING_FIRST_ID ; id <= LOG_STRING_LAST_ID ; id++ ) {
+      const WCHAR* pwszText = logStringsEmbeddedGet( id );
+      if ( pwszText == NULL ) {
+         continue;  // There's no string with this ID
+      }
+
+      size_t stLength = wcslen( pwszText );
+      if ( stLength >= MAX_LOG_STRING ) {
+         stLength = MAX_LOG_STRING - 1;
+      }
+
+      if ( !logStringsAdd( id, pwszText, stLength, &stUsed ) ) {
+         FATAL_IN_LOG( L"The log's string table is full.  Exiting immediately." );  // Can't be localized
+         return FALSE;
+      }
+   }
+#endif
+
+   return TRUE;
+}
+
+
+/// Get a string from the table
+///
+/// @param resourceId An ID from the string section of the resource file
+/// @return The string or `NULL` if there isn't one
+PCWSTR logGetString( _In_ const UINT resourceId ) {
+   if ( resourceId < LOG_STRING_FIRST_ID || resourceId > LOG_STRING_LAST_ID ) {
+      return NULL;
+   }
+
+   const UINT32 uOffset = suOffsets[ resourceId - LOG_STRING_FIRST_ID ];
+   if ( uOffset == 0 ) {
+      return NULL;
+   }
+
+   return &swsArena[ uOffset - 1 ];
+}
@@ -0,0 +1,18 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Extend log.cpp with a preloaded table of the resource strings
+///
+/// @file    logStrings.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+
+extern BOOL   logStringsInit();
+extern PCWSTR logGetString( _In_ const UINT resourceId );
+extern PCWSTR logStringsEmbeddedGet( _In_ const UINT32 uResourceId );  // In logStringsEmbedded.cpp
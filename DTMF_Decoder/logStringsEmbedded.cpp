@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// An embedded copy of the resource strings (for builds without Windows
+/// resources)
+///
+/// `logStrings_generated.h` carries every string in `DTMF_Decoder.rc`, but
+/// the table is only compiled here (where #LOG_STRINGS_EMBEDDED is defined).
+/// This file doesn't include framework.h or any Windows headers -- only
+/// `<stdint.h>` and `<wchar.h>` -- so it compiles anywhere.
+///
+/// The Windows build still loads its strings with `LoadStringW` (so they are
+/// localized).  Other builds call #logStringsEmbeddedGet from
+/// #logStringsInit.
+///
+/// @file    logStringsEmbedded.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>       // For uint32_t
+#include <wchar.h>        // For wchar_t and NULL
+
+
+/// A string's ID and its text (used by the generated, embedded string table)
+typedef struct {
+   uint32_t       uResourceId;  ///< The string's ID from Resource.h
+   const wchar_t* pwszText;     ///< The string from DTMF_Decoder.rc
+} logStringDefinition_t;
+
+#define LOG_STRINGS_EMBEDDED  ///< Compile the embedded table in logStrings_generated.h
+#include "logStrings_generated.h"  // For sEmbeddedStrings
+
+
+/// Find a string in the embedded table
+///
+/// #sEmbeddedStrings is sorted by ID, so this is a binary search.
+///
+/// @param uResourceId An ID from the string section of the resource file
+/// @return The string or `NULL` if there isn't one
+const wchar_t* logStringsEmbeddedGet( const uint32_t uResourceId ) {
+   size_t stLow  = 0;
+   size_t stHigh = sizeof( sEmbeddedStrings ) / sizeof( sEmbeddedStrings[ 0 ] );
+
+   while ( stLow < stHigh ) {
+      const size_t stMid = stLow + ( stHigh - stLow ) / 2;
+
+      if ( sEmbeddedStrings[ stMid ].uResourceId == uResourceId ) {
+         return sEmbeddedStrings[ stMid ].pwszText;
+      }
+
+      if ( sEmbeddedStrings[ stMid ].uResourceId < uResourceId ) {
+         stLow = stMid + 1;
+      } else {
+         stHigh = stMid;
+      }
+   }
+
+   return NULL;
+}
@@ -0,0 +1,364 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// The string table from DTMF_Decoder.rc
+///
+/// **Generated by bin/generate_strings.py.  Do not edit.**
+///
+/// @file    logStrings_generated.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#define LOG_STRING_FIRST_ID    103   ///< The lowest string ID
+#define LOG_STRING_LAST_ID     444   ///< The highest string ID
+#define LOG_STRING_ARENA_CHARS 19362  ///< The characters (with `\0`s) in all of the strings
+
+#ifdef LOG_STRINGS_EMBEDDED
+/// Every string in DTMF_Decoder.rc, sorted by ID (for builds without Windows
+/// resources).  The IDs are numbers, so this doesn't need Resource.h.
+static const logStringDefinition_t sEmbeddedStrings[] = {
+   { 103, L"DTMF Dec\x00f6" L"der" },  // IDS_APP_TITLE
+   { 104, L"Goertzel DFT thread: %zu   Failed to set MMCSS on Goertzel work thread.  Continuing" },  // IDS_GOERTZEL_FAILED_TO_SET_MMCSS
+   { 105, L"WaitForSingleObject in Goertzel thread %zu failed.  Exiting.  Investigate!" },  // IDS_GOERTZEL_WAITFORSINGLEOBJECT_FAILED
+   { 106, L"WaitForSingleObject in Goertzel thread %zu ended for an unknown reason.  Exiting.  Investigate!" },  // IDS_GOERTZEL_WAITFORSINGLEOBJECT_FAILED_UNKNOWN
+   { 107, L"Goertzel DFT thread: %zu   Failed to revert MMCSS on Goertzel work thread.  Continuing." },  // IDS_GOERTZEL_FAILED_TO_REVERT_MMCSS
+   { 108, L"Goertzel DFT thread: %zu   Done" },  // IDS_GOERTZEL_DONE
+   { 109, L"DTMFDECODER" },  // IDC_DTMFDECODER
+   { 110, L"Goertzel DFT thread: %zu   Starting." },  // IDS_GOERTZEL_START
+   { 111, L"Failed to close ghStartDFTevent handle." },  // IDS_GOERTZEL_FAILED_TO_CLOSE_STARTDFT_HANDLE
+   { 112, L"Failed to close a ghDoneDFTevent handle." },  // IDS_GOERTZEL_FAILED_TO_CLOSE_DONEDFT_HANDLES
+   { 113, L"All Goertzel threads ended normally." },  // IDS_GOERTZEL_ENDED_NORMALLY
+   { 114, L"Wait for all Goertzel threads to end failed.  Exiting." },  // IDS_GOERTZEL_THREAD_END_FAILED
+   { 115, L"Failed to signal a ghStartDFTevent.  Exiting." },  // IDS_GOERTZEL_FAILED_TO_SIGNAL_START_DFT
+   { 116, L"Failed to create a ghStartDFTevent event handle.  Exiting." },  // IDS_GOERTZEL_FAILED_TO_CREATE_STARTDFT_HANDLE
+   { 117, L"Failed to create a ghDoneDFTevent handle %d.  Exiting." },  // IDS_GOERTZEL_FAILED_TO_CREATE_DONEDFT_HANDLES
+   { 118, L"Failed to create Goertzel work thread %d.  Exiting." },  // IDS_GOERTZEL_FAILED_TO_CREATE_WORK_THREAD
+   { 119, L"Failed to allocate memory for PCM queue" },  // IDS_MODEL_FAILED_TO_MALLOC
+   { 123, L"Failed to get a message.  Ending program." },  // IDS_DTMF_DECODER_FAILED_TO_GET_MESSAGE
+   { 124, L"Failed to paint window.  Investigate!!" },  // IDS_DTMF_DECODER_FAILED_TO_PAINT
+   { 125, L"Failed to end paint.  Investigate!!" },  // IDS_DTMF_DECODER_FAILED_TO_END_PAINT
+   { 126, L"Failed to start Goertzel DFT worker threads.  Exiting." },  // IDS_AUDIO_FAILED_TO_START_GOERTZEL
+   { 127, L"Failed to stop the audio device" },  // IDS_DTMF_DECODER_FAILED_TO_STOP_AUDIO_DEVICE
+   { 128, L"Failed to destroy window" },  // IDS_DTMF_DECODER_FAILED_TO_DESTROY_WINDOW
+   { 129, L"Failed to cleanup view resources" },  // IDS_DTMF_DECODER_FAILED_TO_CLEANUP_VIEW
+   { 130, L"Failed to set the name of the app" },  // IDS_DTMF_DECODER_ABOUT_FAILED_TO_SET_NAME
+   { 131, L"Failed to set the build date of the app" },  // IDS_DTMF_DECODER_ABOUT_FAILED_TO_SET_DATE
+   { 132, L"Failed to end the About window" },  // IDS_DTMF_DECODER_ABOUT_FAILED_TO_END
+   { 133, L"Failed to initialize COM.  Exiting." },  // IDS_DTMF_DECODER_FAILED_TO_INITIALIZE_COM
+   { 134, L"Starting %s   Version:  %s   Built:  %s" },  // IDS_DTMF_DECODER_STARTING
+   { 135, L"Failed to set the version of the app" },  // IDS_DTMF_DECODER_ABOUT_FAILED_TO_SET_VERSION
+   { 136, L"Failed to retrieve window class name.  Exiting." },  // IDS_DTMF_DECODER_FAILED_TO_RETRIEVE_CLASS_NAME
+   { 137, L"Failed to register window class.  Exiting." },  // IDS_DTMF_DECODER_FAILED_TO_REGISTER_WINDOW_CLASS
+   { 138, L"Failed to create main window.  Exiting." },  // IDS_DTMF_DECODER_FAILED_TO_CREATE_MAIN_WINDOW
+   { 139, L"Created main window:  Width=%d  Height=%d" },  // IDS_DTMF_DECODER_CREATED_MAIN_WINDOW
+   { 140, L"Failed to close WER handle" },  // IDS_LOG_WER_FAILED_TO_CLOSE_HANDLE
+   { 141, L"Failed to initialize the model.  Exiting." },  // IDS_DTMF_DECODER_FAILED_TO_INITIALIZE_MODEL
+   { 142, L"Failed to initialize the view.  Exiting." },  // IDS_DTMF_DECODER_FAILED_TO_INITIALIZE_VIEW
+   { 143, L"Failed to initialize the audio capture system.  Exiting." },  // IDS_DTMF_DECODER_FAILED_TO_INITIALIZE_AUDIO
+   { 144, L"Failed to load menu accelerator.  Exiting." },  // IDS_DTMF_DECODER_FAILED_TO_LOAD_MENU
+   { 145, L"All application resources were successfully initialized" },  // IDS_DTMF_DECODER_APP_RESOURCES_READY
+   { 146, L"Failed to end the Goertzel DFT threads" },  // IDS_DTMF_DECODER_FAILED_TO_END_DFT_THREADS
+   { 147, L"Failed to clean up audio resources." },  // IDS_DTMF_DECODER_FAILED_TO_CLEANUP_AUDIO
+   { 148, L"Failed to cleanup Goertzel DFT" },  // IDS_DTMF_DECODER_FAILED_TO_CLEANUP_DFT
+   { 149, L"Failed to cleanup the model." },  // IDS_DTMF_DECODER_FAILED_TO_CLEANUP_MODEL
+   { 150, L"Failed to cleanup the logs." },  // IDS_DTMF_DECODER_FAILED_TO_CLEANUP_LOGS
+   { 151, L"All %s resources were cleaned up.  Ending program:  SUCCESS." },  // IDS_DTMF_DECODER_ENDING_SUCCESSFULLY
+   { 152, L"All %s resources were cleaned up.  Ending program in failure mode." },  // IDS_DTMF_DECODER_ENDING_IN_FAILURE_MODE
+   { 153, L"Goertzel DFT thread: %zu   Set MMCSS on Goertzel work thread." },  // IDS_GOERTZEL_SET_MMCSS
+   { 154, L"Draw rectangle:  left=%ld  top=%ld  right=%ld  bottom=%ld" },  // IDS_VIEW_DRAW_RECTANGLE
+   { 155, L"Update region:  (%d, %d) to (%d, %d)" },  // IDS_VIEW_UPDATE_REGION
+   { 156, L"Failed to end drawing operations on render target" },  // IDS_VIEW_FAILED_TO_END_DRAW
+   { 157, L"Failed to compute DTMF tones.  Exiting.  Investigate!" },  // IDS_AUDIO_FAILED_TO_COMPUTE_DTMF_TONES
+   { 158, L"Buffer flag set: SILENT" },  // IDS_AUDIO_BUFFER_SILENT
+   { 159, L"Buffer flag set: DATA_DISCONTINUITY" },  // IDS_AUDIO_BUFFER_DISCONTINUOUS
+   { 160, L"Buffer flag set: TIMESTAMP_ERROR" },  // IDS_AUDIO_BUFFER_TIMESTAMP_MISALIGNED
+   { 161, L"Some other bufer flags are set.  Investigate!" },  // IDS_AUDIO_BUFFER_OTHER_ISSUE
+   { 162, L"Failed to reset the DFT start event" },  // IDS_GOERTZEL_FAILED_TO_RESET_STARTDFT_EVENT
+   { 163, L"Failed to create Direct2D Factory" },  // IDS_VIEW_FAILED_TO_CREATE_DIRECT2D_FACTORY
+   { 164, L"Failed to create DirectWrite Factory" },  // IDS_VIEW_FAILED_TO_CREATE_DIRECTWRITE_FACTORY
+   { 165, L"Failed to create a font resource" },  // IDS_VIEW_FAILED_TO_CREATE_FONT_RESOURCE
+   { 166, L"Failed to set word wrap" },  // IDS_VIEW_FAILED_TO_SET_WORD_WRAP
+   { 167, L"Failed to set text alignment" },  // IDS_VIEW_FAILED_TO_SET_TEXT_ALIGNMENT
+   { 168, L"Failed to set paragraph alignment" },  // IDS_VIEW_FAILED_TO_SET_PARAGRAPH_ALIGNMENT
+   { 169, L"Failed to get the window size" },  // IDS_VIEW_FAILED_TO_GET_WINDOW_SIZE
+   { 170, L"Failed to create Direct2D Render Target" },  // IDS_VIEW_FAILED_TO_CREATE_DIRECT2D_RENDER_TARGET
+   { 171, L"Failed to create Direct2D Brush" },  // IDS_VIEW_FAILED_TO_CREATE_DIRECT2D_BRUSH
+   { 172, L"ReleaseBuffer didn't return S_OK.  Exiting.  Investigate!" },  // IDS_AUDIO_FAILED_TO_RELEASE_AUDIO_BUFFER
+   { 173, L"GetBuffer returned an empty buffer.  Continue." },  // IDS_AUDIO_GETBUFFER_EMPTY
+   { 174, L"GetBuffer returned out of order data.  Continue." },  // IDS_AUDIO_GETBUFFER_NOT_SEQUENTIAL
+   { 175, L"GetBuffer did not return S_OK.  Exiting.  Investigate!" },  // IDS_AUDIO_GETBUFFER_NOT_OK
+   { 176, L"Start capture thread" },  // IDS_AUDIO_START_THREAD
+   { 177, L"Failed to set MMCSS on the audio capture thread.  Continuing." },  // IDS_AUDIO_FAILED_TO_SET_MMCSS
+   { 178, L"Set MMCSS on the audio capture thread." },  // IDS_AUDIO_SET_MMCSS
+   { 179, L"WaitForSingleObject in audio capture thread failed.  Exiting.  Investigate!" },  // IDS_AUDIO_WAIT_FAILED
+   { 180, L"Failed to revert MMCSS on the audio capture thread.  Continuing." },  // IDS_AUDIO_FAILED_TO_REVERT_MMCSS
+   { 181, L"End audio capture thread" },  // IDS_AUDIO_END_THREAD
+   { 182, L"Using WAVE_FORMAT_EXTENSIBLE format" },  // IDS_AUDIO_USING_WAVE_FORMAT_EXTENSIBLE
+   { 183, L"Channels:  %hu" },  // IDS_AUDIO_FORMAT_CHANNELS
+   { 184, L"Samples per Second:  %u" },  // IDS_AUDIO_FORMAT_SAMPLES_PER_SECOND
+   { 185, L"Bytes per Second:  %u" },  // IDS_AUDIO_FORMAT_BYTES_PER_SECOND
+   { 186, L"Block (frame) alignment, in bytes:  %u" },  // IDS_AUDIO_FORMAT_FRAME_ALIGNMENT
+   { 187, L"Bits per sample:  %u" },  // IDS_AUDIO_FORMAT_BITS_PER_SAMPLE
+   { 188, L"Valid bits per sample:  %hu" },  // IDS_AUDIO_FORMAT_VALID_BITS_PER_SAMPLE
+   { 189, L"Extended wave format is PCM" },  // IDS_AUDIO_EXTENDED_FORMAT_PCM
+   { 190, L"Extended wave format is IEEE Float" },  // IDS_AUDIO_EXTENDED_FORMAT_FLOAT
+   { 191, L"Extended wave format is not recognized" },  // IDS_AUDIO_EXTENDED_FORMAT_UNKNOWN
+   { 192, L"Using WAVE_FORMAT format" },  // IDS_AUDIO_USING_WAVE_FORMAT
+   { 193, L"Wave format is PCM" },  // IDS_AUDIO_FORMAT_PCM
+   { 194, L"Wave format is IEEE Float" },  // IDS_AUDIO_FORMAT_FLOAT
+   { 195, L"Wave format is not recognized" },  // IDS_AUDIO_FORMAT_UNKNOWN
+   { 196, L"Exclusive mode not supported right now.  Exiting." },  // IDS_AUDIO_EXCLUSIVE_MODE_UNSUPPORTED
+   { 197, L"Failed to instantiate the multimedia device enumerator via COM.  Exiting." },  // IDS_AUDIO_FAILED_TO_CREATE_DEVICE
+   { 198, L"Failed to get default audio device" },  // IDS_AUDIO_FAILED_TO_GET_DEFAULT_DEVICE
+   { 199, L"Failed to get the audio device's ID string" },  // IDS_AUDIO_FAILED_TO_GET_DEVICE_ID
+   { 200, L"Device ID:  %s" },  // IDS_AUDIO_DEVICE_ID
+   { 201, L"Failed to get the audio device's state" },  // IDS_AUDIO_FAILED_TO_GET_DEVICE_STATE
+   { 202, L"The audio device state is not active" },  // IDS_AUDIO_DEVICE_NOT_ACTIVE
+   { 203, L"Failed to open device property store" },  // IDS_AUDIO_FAILED_TO_OPEN_PROPERTIES
+   { 204, L"Failed to retrieve the [%s] property from the audio driver for this device.  Continuing." },  // IDS_AUDIO_FAILED_TO_RETRIEVE_PROPERTY
+   { 205, L"Device interface friendly name:  %s" },  // IDS_AUDIO_DEVICE_INTERFACE_NAME
+   { 206, L"Device description:  %s" },  // IDS_AUDIO_DEVICE_DESCRIPTION
+   { 207, L"Device friendly name:  %s" },  // IDS_AUDIO_DEVICE_NAME
+   { 208, L"Failed to activate an audio client" },  // IDS_AUDIO_FAILED_TO_ACTIVATE
+   { 209, L"Failed to retrieve mix format" },  // IDS_AUDIO_FAILED_TO_GET_MIX_FORMAT
+   { 210, L"The mix format follows:" },  // IDS_AUDIO_MIX_FORMAT
+   { 211, L"The requested format is supported" },  // IDS_AUDIO_FORMAT_SUPPORTED
+   { 212, L"The requested format is is not supported" },  // IDS_AUDIO_FORMAT_UNSUPPORTED
+   { 213, L"The requested format is not available, but this format is:" },  // IDS_AUDIO_FORMAT_NOT_AVAILABLE
+   { 214, L"Failed to validate the requested format" },  // IDS_AUDIO_FORMAT_INVALID
+   { 215, L"Failed to match with the audio format" },  // IDS_AUDIO_FAILED_TO_MATCH_FORMAT
+   { 216, L"Failed to initialize the audio client" },  // IDS_AUDIO_FAILED_TO_INITIALIZE
+   { 217, L"Failed to get buffer size" },  // IDS_AUDIO_FAILED_TO_GET_BUFFER_SIZE
+   { 218, L"The maximum capacity of the buffer is %u frames or %i ms" },  // IDS_AUDIO_BUFFER_CAPACITY
+   { 219, L"Failed to get audio client device periods" },  // IDS_AUDIO_FAILED_TO_GET_DEVICE_PERIODS
+   { 220, L"Default device period=%lli ms" },  // IDS_AUDIO_DEFAULT_DEVICE_PERIOD
+   { 221, L"Minimum device period=%lli ms" },  // IDS_AUDIO_MINIMUM_DEVICE_PERIOD
+   { 222, L"Failed to allocate PCM queue" },  // IDS_AUDIO_FAILED_PCM_MALLOC
+   { 223, L"Queue size=%zu bytes or %d ms" },  // IDS_AUDIO_QUEUE_SIZE
+   { 225, L"Failed to create an audio samples ready event" },  // IDS_AUDIO_FAILED_TO_CREATE_READY_EVENT
+   { 226, L"Failed to set audio capture ready event" },  // IDS_AUDIO_FAILED_TO_SET_EVENT_CALLBACK
+   { 227, L"Failed to get capture client" },  // IDS_AUDIO_FAILED_TO_GET_CAPTURE_CLIENT
+   { 228, L"Failed to create the audio capture thread" },  // IDS_AUDIO_FAILED_TO_CREATE_CAPTURE_THREAD
+   { 229, L"Failed to start capturing the audio stream" },  // IDS_AUDIO_FAILED_TO_START_CAPTURE_STREAM
+   { 230, L"The audio capture interface has been initialized" },  // IDS_AUDIO_INIT_SUCCESSFUL
+   { 231, L"Stopping the audio stream returned an unexpected value.  Investigate!!" },  // IDS_AUDIO_STOP_FAILED
+   { 232, L"Failed to close shCaptureThread" },  // IDS_AUDIO_FAILED_CLOSING_THREAD
+   { 233, L"Failed to close ghAudioSamplesReadyEvent." },  // IDS_AUDIO_FAILED_CLOSING_EVENT
+   { 234, L"Failed to release the audio client" },  // IDS_AUDIO_FAILED_TO_RELEASE_CLIENT
+   { 235, L"Failed to release property:  %s" },  // IDS_AUDIO_FAILED_TO_RELEASE_PROPERTY
+   { 236, L"The log queue was full.  %llu messages were not queued." },  // IDS_LOG_QUEUE_DROPPED
+   { 237, L"Testing LOG_<Level>_R (wide)" },  // IDS_LOG_TEST_BASIC
+   { 238, L"Testing LOG_<Level>_R (wide) varargs [%d] [%s] [%f]" },  // IDS_LOG_TEST_PARAMETERS
+   { 239, L"Testing LOG_<Level>_Q (wide) varargs [%d] [%s] [%f]" },  // IDS_LOG_TEST_PARAMETERS_Q
+   { 240, L"Wide: (Resource)678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123" },  // IDS_LOG_TEST_253
+   { 241, L"Wide: (Resource)6789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234" },  // IDS_LOG_TEST_254
+   { 242, L"Wide: (Resource)67890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345" },  // IDS_LOG_TEST_255
+   { 243, L"LOG_<Level>_Q (wide) stress test.  size=%zu  enqueue count=%zu  dequeue size=%%zu  dequeue count=%%zu" },  // IDS_LOG_QUEUE_STRESS_TEST
+   { 244, L"Failed to submit Windows Error Report" },  // IDS_LOG_WER_FAILED_TO_SUBMIT_REPORT
+   { 245, L"Windows Error Report submitted successfully" },  // IDS_LOG_WER_SUCCESSFULLY_SUBMITTED
+   { 246, L"Failed to get the executable's full path name" },  // IDS_LOG_WER_FAILED_TO_GET_EXE_PATH
+   { 247, L"Executable's full path and filename=%s" },  // IDS_LOG_WER_FULL_EXE_FILENAME
+   { 248, L"%s has detected a problem and needs to shutdown.  A report will be generated and sent to the developer." },  // IDS_LOG_WER_DESCRIPTION
+   { 249, L"%s Error Report" },  // IDS_LOG_WER_REPORT_NAME
+   { 250, L"Failed to create a Windows Error Report (should it be needed later).  Continuing." },  // IDS_LOG_WER_FAILED_CREATE_REPORT
+   { 251, L"Initialized Windows Error Reporting." },  // IDS_LOG_WER_INIT_SUCCESS
+   { 252, L"Failed to set WER parameter:  %d   Continuing." },  // IDS_LOG_WER_FAILED_TO_SET_PARAMETER
+   { 253, L"WER fatal error logged" },  // IDS_LOG_WER_FATAL_ERROR_LOGGED
+   { 254, L"Failed to add dump to Windows Error Report" },  // IDS_LOG_WER_FAILED_TO_ADD_DUMP
+   { 255, L"Failed to register %s memory block with Windows Error Report" },  // IDS_LOG_WER_FAILED_TO_REGISTER_MEMORY
+   { 256, L"Failed to signal an audio capture thread.  Exiting." },  // IDS_AUDIO_FAILED_TO_SIGNAL_THREAD
+   { 257, L"Wait for the audio capture thread to end failed.  Exiting." },  // IDS_AUDIO_THREAD_END_FAILED
+   { 258, L"Failed to retrieve menu.  Exiting." },  // IDS_DTMF_DECODER_FAILED_TO_RETRIEVE_MENU
+   { 259, L"Failed to set menu state.  Exiting." },  // IDS_AUDIO_FAILED_TO_SET_MENU_STATE
+   { 260, L"Failed to start capturing audio.  Exiting." },  // IDS_DTMF_DECODER_FAILED_TO_START_AUDIO
+   { 261, L"Failed to redraw menu.  Exiting." },  // IDS_AUDIO_FAILED_TO_DRAW_MENU
+   { 262, L"The audio capture device has started." },  // IDS_AUDIO_START_SUCCESSFUL
+   { 263, L"Failed to initialize the Goertzel DFT module.  Exiting." },  // IDS_DTMF_DECODER_FAILED_TO_INITIALIZE_GOERTZEL
+   { 264, L"Goertzel benchmark:  %zu samples   Magnitude only: %.1f ns   Magnitude + energy: %.1f ns   Overhead: %.1f%%" },  // IDS_GOERTZEL_BENCHMARK_RESULT
+   { 265, L"Goertzel benchmark:  %s Hz   Magnitude: %.2f   Energy: %.2f   Ratio: %.3f" },  // IDS_GOERTZEL_BENCHMARK_TONE
+   { 266, L"Using a simulated audio device" },  // IDS_AUDIO_SIM_ENABLED
+   { 267, L"The simulated audio device's %s option is not valid.  Exiting." },  // IDS_AUDIO_SIM_INVALID_CONFIG
+   { 268, L"Failed to open the simulated audio file [%s].  Exiting." },  // IDS_AUDIO_SIM_FAILED_TO_OPEN_FILE
+   { 269, L"Failed to read the simulated audio file [%s].  Exiting." },  // IDS_AUDIO_SIM_FAILED_TO_READ_FILE
+   { 270, L"Failed to allocate memory for the simulated audio device.  Exiting." },  // IDS_AUDIO_SIM_FAILED_TO_ALLOCATE
+   { 271, L"Failed to create the simulated audio device's timer.  Exiting." },  // IDS_AUDIO_SIM_FAILED_TO_CREATE_TIMER
+   { 272, L"Failed to create the simulated audio device thread.  Exiting." },  // IDS_AUDIO_SIM_FAILED_TO_CREATE_THREAD
+   { 273, L"The simulated audio device's timer failed.  Exiting.  Investigate!" },  // IDS_AUDIO_SIM_TIMER_FAILED
+   { 274, L"Start simulated audio device thread" },  // IDS_AUDIO_SIM_START_THREAD
+   { 275, L"End simulated audio device thread" },  // IDS_AUDIO_SIM_END_THREAD
+   { 276, L"Simulated audio device started:  %u Hz   Period: %u us   Jitter: %u us   %u frames per buffer" },  // IDS_AUDIO_SIM_STARTED
+   { 277, L"Wait for the simulated audio device thread to end failed.  Exiting." },  // IDS_AUDIO_SIM_THREAD_END_FAILED
+   { 278, L"Failed to close a simulated audio device handle.  Exiting." },  // IDS_AUDIO_SIM_FAILED_TO_CLOSE_HANDLE
+   { 279, L"Simulated audio device:  Buffers: %llu   Deadline misses: %llu   Overruns: %llu   Latency avg: %.3f ms   max: %.3f ms" },  // IDS_AUDIO_SIM_STATISTICS
+   { 280, L"Failed to parse the command line.  Exiting." },  // IDS_DTMF_DECODER_FAILED_TO_PARSE_COMMAND_LINE
+   { 281, L"Failed to start the simulated audio device's DTMF synthesizer.  Exiting." },  // IDS_AUDIO_SIM_FAILED_TO_START_SYNTHESIZER
+   { 282, L"The /benchmark results file is not valid.  Exiting." },  // IDS_BENCHMARK_INVALID_FILE
+   { 283, L"Running the benchmarks.  Results go to [%s]" },  // IDS_BENCHMARK_ENABLED
+   { 284, L"Failed to open the benchmark results file [%s].  Exiting." },  // IDS_BENCHMARK_FAILED_TO_OPEN_FILE
+   { 285, L"Failed to write the benchmark results file [%s].  Exiting." },  // IDS_BENCHMARK_FAILED_TO_WRITE_FILE
+   { 286, L"Failed to start the DTMF corpus generator.  Exiting." },  // IDS_BENCHMARK_FAILED_TO_START_CORPUS
+   { 287, L"Failed to allocate memory for the benchmarks.  Exiting." },  // IDS_BENCHMARK_FAILED_TO_ALLOCATE
+   { 288, L"Benchmark:  %-4s %6u Hz  %-12s %8.1f Msamples/s   p50: %.0f ns   p99: %.0f ns   Digits: %zu/%d   False: %zu" },  // IDS_BENCHMARK_RESULT
+   { 289, L"Benchmarks finished:  %zu results written to [%s]" },  // IDS_BENCHMARK_DONE
+   { 290, L"The benchmarks failed.  Exiting." },  // IDS_DTMF_DECODER_BENCHMARK_FAILED
+   { 291, L"Latency:  %-15s  Count: %llu   Mean: %.0f us   p50: %.0f us   p90: %.0f us   p99: %.0f us   p99.9: %.0f us   Max: %.0f us" },  // IDS_PERF_LATENCY_SUMMARY
+   { 292, L"The /counterinterval option is not valid.  Exiting." },  // IDS_PERF_COUNTERS_INVALID_INTERVAL
+   { 293, L"The /counters file is not valid.  Exiting." },  // IDS_PERF_COUNTERS_INVALID_FILE
+   { 294, L"Writing performance counters to [%s] every %u seconds" },  // IDS_PERF_COUNTERS_ENABLED
+   { 295, L"Failed to set the performance counters timer.  Continuing." },  // IDS_PERF_COUNTERS_FAILED_TO_SET_TIMER
+   { 296, L"Out of performance counter slots.  Some counts may be lost.  Continuing." },  // IDS_PERF_COUNTERS_OUT_OF_SLOTS
+   { 297, L"Failed to write the performance counters file [%s].  Continuing." },  // IDS_PERF_COUNTERS_FAILED_TO_WRITE_FILE
+   { 298, L"Counters:  Buffers: %llu   Frames: %llu   Gated: %llu   Discontinuities: %llu   Out of order: %llu   DSP mean: %.1f us   DSP max: %.1f us" },  // IDS_PERF_COUNTERS_SUMMARY
+   { 299, L"Log queue stress test:  Producers: %d   Sent: %llu   Received: %llu   Dropped: %llu   Messages/sec: %.0f   %s" },  // IDS_LOG_QUEUE_STRESS_RESULT
+   { 300, L"The /trace file is not valid.  Exiting." },  // IDS_LOG_TRACE_INVALID_FILE
+   { 301, L"Failed to open the trace file [%s].  Continuing without tracing." },  // IDS_LOG_TRACE_FAILED_TO_OPEN_FILE
+   { 302, L"Failed to start the trace drain thread.  Continuing without tracing." },  // IDS_LOG_TRACE_FAILED_TO_START_DRAINER
+   { 303, L"Writing trace records to [%s]" },  // IDS_LOG_TRACE_ENABLED
+   { 304, L"Trace records dropped:  %llu (ring full)   %llu (no ring)" },  // IDS_LOG_TRACE_DROPPED
+   { 305, L"Trace benchmark:  LOG_TRACE_B: %.1f ns/call   logR: %.1f ns/call   logQ: %.1f ns/call" },  // IDS_LOG_TRACE_BENCHMARK
+   { 306, L"Trace benchmark message:  %zu" },  // IDS_LOG_TRACE_BENCHMARK_MESSAGE
+   { 307, L"Buffer:  Frames: %zu   Position: %zu   Flags: 0x%zx" },  // IDS_AUDIO_TRACE_BUFFER
+   { 308, L"Failed to cleanup the trace logger." },  // IDS_DTMF_DECODER_FAILED_TO_CLEANUP_TRACE
+   { 309, L"A /logfile option is not valid.  Exiting." },  // IDS_LOG_FILE_INVALID_OPTION
+   { 310, L"Failed to open the log file [%s].  Continuing without it." },  // IDS_LOG_FILE_FAILED_TO_OPEN
+   { 311, L"Failed to start the log file writer thread.  Continuing without a log file." },  // IDS_LOG_FILE_FAILED_TO_START_WRITER
+   { 312, L"Writing the log to [%s] (rotating at %llu MB)" },  // IDS_LOG_FILE_ENABLED
+   { 313, L"The log file's queue was full.  %llu messages were not written." },  // IDS_LOG_FILE_DROPPED
+   { 314, L"The log file storm test needs /logfile.  Continuing." },  // IDS_LOG_FILE_STORM_NOT_RUNNING
+   { 315, L"Log file storm:  Producers: %d   Sent: %llu   Written: %llu   Dropped: %llu   Other threads: %llu   Records/sec: %.0f   Call latency p50: %llu ns   p99: %llu ns   p99.9: %llu ns   max: %lld ns" },  // IDS_LOG_FILE_STORM_RESULT
+   { 316, L"Failed to cleanup the log file." },  // IDS_DTMF_DECODER_FAILED_TO_CLEANUP_LOG_FILE
+   { 317, L"Flight recorder:  %.1f ns/record" },  // IDS_LOG_FLIGHT_BENCHMARK
+   { 318, L"A /service option is not valid.  Exiting." },  // IDS_DTMF_SERVICE_INVALID_OPTION
+   { 319, L"Failed to start Winsock.  Exiting." },  // IDS_DTMF_SERVICE_FAILED_TO_START_WINSOCK
+   { 320, L"Failed to allocate %zu streams for the service.  Exiting." },  // IDS_DTMF_SERVICE_FAILED_TO_ALLOCATE
+   { 321, L"The service failed to listen on [%s].  Error: %d.  Exiting." },  // IDS_DTMF_SERVICE_FAILED_TO_LISTEN
+   { 322, L"Failed to start the service's threads.  Exiting." },  // IDS_DTMF_SERVICE_FAILED_TO_START_THREADS
+   { 323, L"The service failed to accept a connection.  Error: %d" },  // IDS_DTMF_SERVICE_FAILED_TO_ACCEPT
+   { 324, L"The decoding service is listening on [%s] with %zu streams and %zu workers on %zu NUMA nodes" },  // IDS_DTMF_SERVICE_ENABLED
+   { 325, L"Service:  Active: %lld   Accepted: %lld   Refused: %lld   Rejected: %lld   Received: %.1f MB   Events: %lld   Dropped: %lld   CPU: %.1f%%" },  // IDS_DTMF_SERVICE_STATS
+   { 326, L"A /loadgen option is not valid.  Exiting." },  // IDS_DTMF_LOADGEN_INVALID_OPTION
+   { 327, L"Failed to allocate memory for the load generator.  Exiting." },  // IDS_DTMF_LOADGEN_FAILED_TO_ALLOCATE
+   { 328, L"Failed to connect stream %zu to the service at [%s].  Error: %d.  Exiting." },  // IDS_DTMF_LOADGEN_FAILED_TO_CONNECT
+   { 329, L"Failed to start the load generator's threads.  Exiting." },  // IDS_DTMF_LOADGEN_FAILED_TO_START_THREADS
+   { 330, L"Failed to open the load generator results file [%s].  Exiting." },  // IDS_DTMF_LOADGEN_FAILED_TO_OPEN_FILE
+   { 331, L"Failed to write the load generator results file [%s].  Exiting." },  // IDS_DTMF_LOADGEN_FAILED_TO_WRITE_FILE
+   { 332, L"Running the load generator:  %zu streams at %u Hz for %u seconds to [%s]" },  // IDS_DTMF_LOADGEN_ENABLED
+   { 333, L"Load generator:  Streams: %zu   Events: %zu   Latency p50: %.0f us   p99: %.0f us   p99.9: %.0f us   max: %.0f us   Stream means: %.0f to %.0f us   Keys: %zu correct, %zu incorrect   Closed early: %zu" },  // IDS_DTMF_LOADGEN_RESULT
+   { 334, L"Load generator CPU:  Client: %.1f%%   Service: %.1f%%  (100%% is one core)" },  // IDS_DTMF_LOADGEN_CPU
+   { 335, L"Load generator CPU:  Client: %.1f%%   Service: unknown  (100%% is one core)" },  // IDS_DTMF_LOADGEN_CPU_CLIENT_ONLY
+   { 336, L"Load generator finished.  Results written to [%s]" },  // IDS_DTMF_LOADGEN_DONE
+   { 337, L"The headless service, load generator or pcap reader failed.  Exiting." },  // IDS_DTMF_DECODER_HEADLESS_FAILED
+   { 338, L"A /serviceshm option is not valid.  Exiting." },  // IDS_DTMF_SHM_INVALID_OPTION
+   { 339, L"Failed to create the shared memory segment [%s].  Error: %u.  Exiting." },  // IDS_DTMF_SHM_FAILED_TO_CREATE
+   { 340, L"Shared memory ingestion on [%s] with %zu streams and %zu decoder threads (%llu MB)" },  // IDS_DTMF_SHM_ENABLED
+   { 341, L"Shared memory:  Active: %lld   Decoded: %.1f Msamples   Events: %lld   Dropped: %lld   Wakeups: %lld   CPU: %.1f%%" },  // IDS_DTMF_SHM_STATS
+   { 342, L"Failed to attach to the shared memory segment [%s].  Error: %u" },  // IDS_DTMF_SHM_FAILED_TO_ATTACH
+   { 343, L"Load generator throughput:  %.2f Msamples/s over the %s   Sends: %llu   Wakeups: %lld" },  // IDS_DTMF_LOADGEN_THROUGHPUT
+   { 344, L"Wave format is G.711 mu-law" },  // IDS_AUDIO_FORMAT_MULAW
+   { 345, L"Wave format is G.711 A-law" },  // IDS_AUDIO_FORMAT_ALAW
+   { 346, L"Benchmark:  %-4s %6u Hz  %-12s %-12s %8.1f Msamples/s   p50: %.0f ns   p99: %.0f ns   Digits: %zu/%d   False: %zu" },  // IDS_BENCHMARK_RESULT_G711
+   { 347, L"A /pcap option is not valid.  Exiting." },  // IDS_DTMF_PCAP_INVALID_OPTION
+   { 348, L"Failed to open the capture file [%s].  Exiting." },  // IDS_DTMF_PCAP_FAILED_TO_OPEN
+   { 349, L"Failed to map the capture file [%s].  Error: %u.  Exiting." },  // IDS_DTMF_PCAP_FAILED_TO_MAP
+   { 350, L"[%s] is not a pcap file (pcapng isn't supported).  Exiting." },  // IDS_DTMF_PCAP_NOT_PCAP
+   { 351, L"The capture's link type %u is not supported.  Exiting." },  // IDS_DTMF_PCAP_UNSUPPORTED_LINK
+   { 352, L"Failed to allocate memory for the capture reader.  Exiting." },  // IDS_DTMF_PCAP_FAILED_TO_ALLOCATE
+   { 353, L"Failed to start a capture decoder thread.  Exiting." },  // IDS_DTMF_PCAP_FAILED_TO_START_THREAD
+   { 354, L"Failed to open the capture results file [%s].  Exiting." },  // IDS_DTMF_PCAP_FAILED_TO_OPEN_RESULTS
+   { 355, L"Failed to write the capture results file [%s].  Exiting." },  // IDS_DTMF_PCAP_FAILED_TO_WRITE_RESULTS
+   { 356, L"Reading the capture [%s] (%llu MB) with %zu decoder threads" },  // IDS_DTMF_PCAP_STARTED
+   { 357, L"The capture file ends in the middle of a packet after %llu packets" },  // IDS_DTMF_PCAP_TRUNCATED
+   { 358, L"The capture has more than %u RTP streams.  The rest are skipped (see /pcapstreams)." },  // IDS_DTMF_PCAP_TOO_MANY_STREAMS
+   { 359, L"Capture:  %llu packets  %llu RTP packets  %u streams  %.2f s  %.1f MB/s" },  // IDS_DTMF_PCAP_DONE
+   { 360, L"Capture:  Lost: %llu  Late: %llu  Reordered: %llu  Not RTP: %llu  Fragments: %llu  Too many streams: %llu" },  // IDS_DTMF_PCAP_JITTER
+   { 361, L"Capture:  %llu in-band keys and %llu RFC 4733 keys.  Results in [%s]" },  // IDS_DTMF_PCAP_KEYS
+   { 362, L"Capture:  %llu events were dropped (out of memory)" },  // IDS_DTMF_PCAP_EVENTS_DROPPED
+   { 363, L"The /record or /replay options are not valid.  Exiting." },  // IDS_AUDIO_RECORD_INVALID_CONFIG
+   { 364, L"Recording the capture buffers to [%s]" },  // IDS_AUDIO_RECORD_ENABLED
+   { 365, L"Failed to create the recording [%s].  Error: %u.  Exiting." },  // IDS_AUDIO_RECORD_FAILED_TO_OPEN
+   { 366, L"Failed to allocate memory for the recorder.  Exiting." },  // IDS_AUDIO_RECORD_FAILED_TO_ALLOCATE
+   { 367, L"Failed to start the recorder's writer thread.  Exiting." },  // IDS_AUDIO_RECORD_FAILED_TO_START
+   { 368, L"Failed to write the recording [%s].  Error: %u.  Recording stopped." },  // IDS_AUDIO_RECORD_WRITE_FAILED
+   { 369, L"Wait for the recorder's writer thread to end failed.  Exiting." },  // IDS_AUDIO_RECORD_THREAD_END_FAILED
+   { 370, L"Recorder:  Buffers: %llu   Frames: %llu   Bytes: %llu   Dropped: %llu" },  // IDS_AUDIO_RECORD_STATISTICS
+   { 371, L"The recorder dropped %llu buffers because the disk couldn't keep up.  The recording is not bit-exact." },  // IDS_AUDIO_RECORD_NOT_EXACT
+   { 372, L"Start recorder thread" },  // IDS_AUDIO_RECORD_START_THREAD
+   { 373, L"End recorder thread" },  // IDS_AUDIO_RECORD_END_THREAD
+   { 374, L"Replaying the capture buffers in [%s] %s" },  // IDS_AUDIO_REPLAY_ENABLED
+   { 375, L"Failed to open the recording [%s].  Error: %u.  Exiting." },  // IDS_AUDIO_REPLAY_FAILED_TO_OPEN
+   { 376, L"[%s] is not a valid recording.  Exiting." },  // IDS_AUDIO_REPLAY_INVALID_FILE
+   { 377, L"The recording [%s] ends with a partial buffer.  Replaying its %llu complete buffers." },  // IDS_AUDIO_REPLAY_TRUNCATED
+   { 378, L"The recording [%s] is missing %llu buffers that the recorder dropped.  The replay is not bit-exact." },  // IDS_AUDIO_REPLAY_NOT_EXACT
+   { 379, L"Failed to allocate memory for the replay.  Exiting." },  // IDS_AUDIO_REPLAY_FAILED_TO_ALLOCATE
+   { 380, L"Replay started:  Buffers: %llu   Frames: %llu   Recorded: %.3f s" },  // IDS_AUDIO_REPLAY_STARTED
+   { 381, L"Replay finished:  Buffers: %llu   Frames: %llu   Recorded: %.3f s   Replayed in: %.3f s   Speed: %.2fx" },  // IDS_AUDIO_REPLAY_FINISHED
+   { 382, L"Failed to start the replay thread.  Exiting." },  // IDS_AUDIO_REPLAY_FAILED_TO_START
+   { 383, L"The replay's timer failed.  Exiting.  Investigate!" },  // IDS_AUDIO_REPLAY_TIMER_FAILED
+   { 384, L"Wait for the replay thread to end failed.  Exiting." },  // IDS_AUDIO_REPLAY_THREAD_END_FAILED
+   { 385, L"Start replay thread" },  // IDS_AUDIO_REPLAY_START_THREAD
+   { 386, L"End replay thread" },  // IDS_AUDIO_REPLAY_END_THREAD
+   { 387, L"Failed to set the display's refresh timer.  Exiting." },  // IDS_VIEW_FAILED_TO_SET_REFRESH_TIMER
+   { 388, L"Failed to invalidate the display (tones 0x%02x)" },  // IDS_VIEW_FAILED_TO_INVALIDATE
+   { 389, L"Failed to start a dirty mask test thread.  Continuing." },  // IDS_MODEL_DIRTY_TEST_FAILED_TO_START
+   { 390, L"Dirty mask test:  Toggles: %llu   Ticks: %llu   UI updates: %llu   Toggles per update: %.0f" },  // IDS_MODEL_DIRTY_TEST_RESULT
+   { 391, L"The dirty mask test failed.  Tones drawn: 0x%02x   UI updates: %llu   Ticks: %llu" },  // IDS_MODEL_DIRTY_TEST_FAILED
+   { 392, L"Failed to start the snapshot test thread.  Continuing." },  // IDS_SNAPSHOT_TEST_FAILED_TO_START
+   { 393, L"Snapshot test:  Published: %llu   Reads: %llu   New snapshots read: %llu   Torn: %llu   Backwards: %llu" },  // IDS_SNAPSHOT_TEST_RESULT
+   { 394, L"The snapshot test failed.  The last read was snapshot %llu of %llu." },  // IDS_SNAPSHOT_TEST_FAILED
+   { 395, L"Failed to start the history test thread.  Continuing." },  // IDS_HISTORY_TEST_FAILED_TO_START
+   { 396, L"History test:  Appended: %llu   Read: %llu   Overruns: %llu   Torn: %llu   Pyramid errors: %llu" },  // IDS_HISTORY_TEST_RESULT
+   { 397, L"The history test failed.  Continuing." },  // IDS_HISTORY_TEST_FAILED
+   { 398, L"Failed to create the spectrogram's bitmap" },  // IDS_VIEW_FAILED_TO_CREATE_SPECTROGRAM
+   { 399, L"Failed to update the spectrogram" },  // IDS_VIEW_FAILED_TO_UPDATE_SPECTROGRAM
+   { 400, L"Failed to create the keypad's bitmap" },  // IDS_VIEW_FAILED_TO_CREATE_KEYPAD_ATLAS
+   { 401, L"Paint:  Paints: %llu   Paint mean: %.1f us   Paint max: %.1f us" },  // IDS_PERF_COUNTERS_PAINT_SUMMARY
+   { 402, L"Real-time scheduling is off" },  // IDS_RT_SCHED_DISABLED
+   { 403, L"The /capturecpu or /dspcpus option is not valid.  Exiting." },  // IDS_RT_SCHED_INVALID_CPUS
+   { 404, L"Pinning the capture thread to CPU %d and the DSP threads to CPUs %d to %d (-1 is not pinned)" },  // IDS_RT_SCHED_PINNING
+   { 405, L"Failed to lock the working set in memory (error %lu).  Continuing." },  // IDS_RT_SCHED_FAILED_TO_LOCK_MEMORY
+   { 406, L"Locked a working set of %u MB in memory" },  // IDS_RT_SCHED_LOCKED_MEMORY
+   { 407, L"Failed to pin a thread to CPU %d.  Continuing." },  // IDS_RT_SCHED_FAILED_TO_PIN
+   { 408, L"Failed to start the jitter test threads.  Continuing." },  // IDS_RT_SCHED_JITTER_FAILED_TO_START
+   { 409, L"Jitter test (%s):  Wakes: %zu   p50: %.1f us   p99: %.1f us   p99.9: %.1f us   Max: %.1f us   Load threads: %lu" },  // IDS_RT_SCHED_JITTER_RESULT
+   { 410, L"NUMA placement is off" },  // IDS_NUMA_PLACE_DISABLED
+   { 411, L"Failed to find the NUMA nodes (error %lu).  Exiting." },  // IDS_NUMA_PLACE_FAILED_TO_FIND_NODES
+   { 412, L"Placing the service's streams and workers on %zu NUMA nodes" },  // IDS_NUMA_PLACE_NODES
+   { 413, L"Failed to pin a thread to NUMA node %u (error %lu).  Continuing." },  // IDS_NUMA_PLACE_FAILED_TO_PIN
+   { 414, L"Failed to allocate %zu bytes on NUMA node %u (error %lu).  Continuing without placement." },  // IDS_NUMA_PLACE_FAILED_TO_ALLOCATE
+   { 415, L"Failed to start the NUMA placement test.  Continuing." },  // IDS_NUMA_PLACE_TEST_FAILED_TO_START
+   { 416, L"NUMA test (%s):  Nodes: %zu   Workers: %zu   Streams: %zu   Analyses/s: %.0f   Remote pages: %.1f%%   Cross-node: %.1f MB/s" },  // IDS_NUMA_PLACE_TEST_RESULT
+   { 417, L"With placement, %.1f%% of the stream pages were on another node (%.1f%% without it)" },  // IDS_NUMA_PLACE_TEST_REMOTE
+   { 418, L"Slab test:  Attach/detach: %.0f per second   Attach p50: %.2f us   p99: %.2f us   Analyses/s: %.0f while churning, %.0f without   Chunks: %lld   Errors: %zu" },  // IDS_GOERTZEL_SLAB_TEST_RESULT
+   { 419, L"Failed to start the slab test threads.  Continuing." },  // IDS_GOERTZEL_SLAB_TEST_FAILED_TO_START
+   { 420, L"The slab test failed:  %zu decoders were set up wrong or handed out twice.  Continuing." },  // IDS_GOERTZEL_SLAB_TEST_FAILED
+   { 421, L"Capture:  %llu entries.  %llu in-band tones were shorter than %u ms." },  // IDS_DTMF_PCAP_ENTRIES
+   { 422, L"Timer wheel test:  %zu timers   Arm: %.1f ns   Cancel and re-arm: %.1f ns   Tick: %.2f us (checking every timer: %.2f us)   Expired: %llu (polling: %llu)   Wrong tick: %zu   Missed: %zu" },  // IDS_TIMER_WHEEL_TEST_RESULT
+   { 423, L"Failed to allocate the timer wheel test's timers.  Continuing." },  // IDS_TIMER_WHEEL_TEST_FAILED_TO_START
+   { 424, L"The timer wheel test failed:  %zu timers expired on the wrong tick or not at all.  Continuing." },  // IDS_TIMER_WHEEL_TEST_FAILED
+   { 425, L"Failed to open an event stream (%u samples per second, format %u).  Continuing." },  // IDS_DTMF_EVENTS_FAILED_TO_OPEN
+   { 426, L"Event test:  %zu streams   Per analysis:  Bare detector: %.0f ns   Polled: %.0f ns (%+.1f%%)   Callback: %.0f ns (%+.1f%%)   Digits: %llu (polled: %llu, callback: %llu)   Tone events: %llu   Misplaced: %zu   Dropped: %llu" },  // IDS_DTMF_EVENTS_TEST_RESULT
+   { 427, L"Failed to open the event test's streams.  Continuing." },  // IDS_DTMF_EVENTS_TEST_FAILED_TO_START
+   { 428, L"The event test failed:  %zu events were missing, dropped, misplaced or delivered differently.  Continuing." },  // IDS_DTMF_EVENTS_TEST_FAILED
+   { 429, L"Autotuning is off" },  // IDS_GOERTZEL_TUNE_DISABLED
+   { 430, L"The /tunefile file is not valid.  Exiting." },  // IDS_GOERTZEL_TUNE_INVALID_FILE
+   { 431, L"Tuning:  Using the cached choice for %s at %d Hz:  %s kernel   Workers: %u   Hop: %u ms" },  // IDS_GOERTZEL_TUNE_CACHED
+   { 432, L"Tuning:  %s kernel   Workers: %u   p50: %.1f us   p99: %.1f us" },  // IDS_GOERTZEL_TUNE_CANDIDATE
+   { 433, L"Tuning:  Chose the %s kernel   Workers: %u   Hop: %u ms   for %s at %d Hz (in %.1f ms)" },  // IDS_GOERTZEL_TUNE_CHOSE
+   { 434, L"Tuning:  Nothing analyzes a window within %d%% of a %u ms hop.  Using the steadiest.  Continuing." },  // IDS_GOERTZEL_TUNE_OVER_BUDGET
+   { 435, L"Failed to start the tuning threads.  Keeping the original configuration.  Continuing." },  // IDS_GOERTZEL_TUNE_FAILED_TO_START
+   { 436, L"Failed to write the tuning cache [%s].  Continuing." },  // IDS_GOERTZEL_TUNE_FAILED_TO_WRITE_FILE
+   { 437, L"Tuning test:  %d Hz:  Would choose the %s kernel   Workers: %u   Hop: %u ms   Combinations: %zu   Mismatched: %zu" },  // IDS_GOERTZEL_TUNE_TEST_RESULT
+   { 438, L"Failed to start the tuning test.  Continuing." },  // IDS_GOERTZEL_TUNE_TEST_FAILED_TO_START
+   { 439, L"The tuning test failed:  %zu combinations computed different tones.  Continuing." },  // IDS_GOERTZEL_TUNE_TEST_FAILED
+   { 440, L"The log file storm test timed out.  After %d ms, the writer had written %llu of %llu queued messages." },  // IDS_LOG_FILE_STORM_TIMED_OUT
+   { 441, L"At least one of the benchmark's self-tests failed.  See the warnings above." },  // IDS_BENCHMARK_SELF_TESTS_FAILED
+   { 442, L"The keypad is painted with DirectWrite on every paint (not from the pre-rendered bitmap)" },  // IDS_VIEW_PAINT_DIRECTWRITE
+   { 443, L"Locked all of the process' memory in RAM (mlockall)" },  // IDS_RT_SCHED_LOCKED_ALL_MEMORY
+   { 444, L"The real-time jitter test only runs on Windows.  Skipping it." },  // IDS_RT_SCHED_JITTER_WINDOWS_ONLY
+};
+#endif
@@ -0,0 +1,407 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Extend log.cpp with a deferred-formatting, binary trace logger for the
+/// realtime threads
+///
+/// #LOG_TRACE_R formats a wide string and calls `OutputDebugStringW` on the
+/// calling thread.  That's too much to do in the capture and DFT threads.
+/// #LOG_TRACE_B just copies a resource ID, a timestamp and the raw arguments
+/// into a ring that belongs to the calling thread:  No formatting, no locks
+/// and no system calls.
+///
+/// A drain thread wakes up every #LOG_TRACE_DRAIN_MS, merges the rings in
+/// time order, formats each record with its `IDS_*` resource string (the same
+/// strings the `_R` loggers use) and writes them to the trace file.  If a
+/// ring fills up before the drain thread gets to it, the new records are
+/// dropped and counted -- a realtime thread never waits on the logger.
+///
+/// Tracing is off unless DTMF Decoder is started with:
+///
+///     DTMF_Decoder.exe /trace[:"C:\DTMF_Trace.log"]
+///
+/// #logTraceBenchmark compares the cost of #LOG_TRACE_B with #logR and #logQ.
+///
+/// ## Threads & Synchronization API
+/// | API                   | Link                                                                                                    |
+/// |-----------------------| --------------------------------------------------------------------------------------------------------|
+/// | `CreateThread`        | https://learn.microsoft.com/en-us/windows/win32/api/processthreadsapi/nf-processthreadsapi-createthread |
+/// | `CreateEventExW`      | https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-createeventexw                 |
+/// | `WaitForSingleObject` | https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-waitforsingleobject            |
+/// | `GetCurrentThreadId`  | https://learn.microsoft.com/en-us/windows/win32/api/processthreadsapi/nf-processthreadsapi-getcurrentthreadid |
+///
+/// ## File API
+/// | API                   | Link                                                                                    |
+/// |-----------------------| ----------------------------------------------------------------------------------------|
+/// | `CreateFileW`         | https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-createfilew      |
+/// | `WriteFile`           | https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-writefile        |
+/// | `WideCharToMultiByte` | https://learn.microsoft.com/en-us/windows/win32/api/stringapiset/nf-stringapiset-widechartomultibyte |
+///
+/// @file    logTrace.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <stddef.h>       // For offsetof
+#include <stdio.h>        // For swprintf_s
+#include <wchar.h>        // For wcsstr
+
+#include "log.h"          // For logR and logQ
+#include "log_ex.h"       // For logGetStringFromResources
+#include "logRings.h"     // For claiming and merging the rings
+#include "logTrace.h"     // For yourself
+
+
+/// The trace file when `/trace` doesn't name one
+#define LOG_TRACE_DEFAULT_FILE    L"DTMF_Trace.log"
+
+/// How often the drain thread empties the rings (in milliseconds)
+#define LOG_TRACE_DRAIN_MS        (100)
+
+/// The size of the drain thread's write buffer (in bytes)
+#define LOG_TRACE_WRITE_BUFFER    (64 * 1024)
+
+/// The number of calls timed for each logger in #logTraceBenchmark
+#define LOG_TRACE_BENCHMARK_CALLS (1000)
+
+
+bool gbLogTraceEnabled = false;
+__declspec( thread ) logTraceRing_t* gpLogTraceRing = NULL;
+
+static __declspec( thread ) bool sbNoRing = false;  ///< `true` if the calling thread couldn't get a ring
+
+static logTraceRing_t sRings[ LOG_TRACE_RINGS ];    ///< The per-thread rings
+static volatile LONG64 sl64NoRingDropped = 0;       ///< Records dropped because the thread couldn't get a ring
+
+static_assert( offsetof( logTraceRecord_t, i64Timestamp ) == 0, "logRings.h needs the timestamp first" );
+
+/// Where #sRings are (for logRings.h)
+static const logRings_t sRingSet = {
+   (BYTE*) sRings, sizeof( logTraceRing_t ), LOG_TRACE_RINGS,
+   offsetof( logTraceRing_t, lOwned ), offsetof( logTraceRing_t, records ), sizeof( logTraceRecord_t ), LOG_TRACE_RING_DEPTH };
+
+static WCHAR  swsFile[ MAX_PATH ] = LOG_TRACE_DEFAULT_FILE;  ///< The trace file
+static HANDLE shFile          = INVALID_HANDLE_VALUE;        ///< The trace file
+static HANDLE shDrainThread   = NULL;                        ///< The drain thread
+static HANDLE shStopEvent     = NULL;                        ///< Tells the drain thread to do a last drain and end
+static INT64  si64Origin      = 0;                           ///< Timestamps in the file are relative to #logTraceInit
+static double sdTicksToMs     = 0.0;                         ///< Converts performance counter ticks to milliseconds
+
+static CHAR   ssWriteBuffer[ LOG_TRACE_WRITE_BUFFER ];       ///< Formatted lines waiting to be written
+static size_t sstWriteBufferUsed = 0;                        ///< Bytes in #ssWriteBuffer
+
+
+/// Look for `/trace[:path]` on the command line
+///
+/// @param pwszCmdLine The command line passed to #wWinMain
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL logTraceParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine ) {
+   gbLogTraceEnabled = false;
+
+   if ( pwszCmdLine == NULL ) {
+      return TRUE;
+   }
+
+   const WCHAR* pFound = wcsstr( pwszCmdLine, L"/trace" );
+   if ( pFound == NULL ) {
+      return TRUE;
+   }
+
+   /// If there's a `:`, then the rest of the option (which may be quoted) is
+   /// the trace file
+   const WCHAR* pValue = pFound + wcslen( L"/trace" );
+   if ( *pValue == L':' ) {
+      pValue++;
+
+      WCHAR wEnd = L' ';
+      if ( *pValue == L'"' ) {
+         wEnd = L'"';
+         pValue++;
+      }
+
+      size_t i = 0;
+      while ( *pValue != L'\0' && *pValue != wEnd && i < _countof( swsFile ) - 1 ) {
+         swsFile[ i++ ] = *pValue++;
+      }
+      swsFile[ i ] = L'\0';
+
+      if ( i == 0 ) {
+         RETURN_FATAL( IDS_LOG_TRACE_INVALID_FILE );  // "The /trace file is not valid.  Exiting."
+      }
+   }
+
+   gbLogTraceEnabled = true;
+
+   return TRUE;
+}
+
+
+/// Claim a ring for the calling thread.  Called by #logTraceWrite the first
+/// time a thread traces something.
+///
+/// @return The thread's ring or `NULL` if they are all taken
+logTraceRing_t* logTraceClaimRing() {
+   if ( sbNoRing ) {
+      InterlockedIncrement64( &sl64NoRingDropped );
+      return NULL;
+   }
+
+   gpLogTraceRing = (logTraceRing_t*) logRingsClaim( &sRingSet );
+   if ( gpLogTraceRing == NULL ) {
+      sbNoRing = true;  // Don't look again
+      InterlockedIncrement64( &sl64NoRingDropped );
+   }
+
+   return gpLogTraceRing;
+}
+
+
+/// Release the calling thread's ring (if it has one).  Call this before a
+/// thread that traces things ends.
+///
+/// The drain thread still drains the ring's records.  The next thread to
+/// claim it continues where this one left off.
+void logTraceReleaseRing() {
+   if ( gpLogTraceRing != NULL ) {
+      logRingsRelease( &sRingSet, gpLogTraceRing );
+      gpLogTraceRing = NULL;
+   }
+}
+
+
+/// Write #ssWriteBuffer to the trace file
+static void logTraceFlush() {
+   if ( sstWriteBufferUsed == 0 ) {
+      return;
+   }
+
+   DWORD dwWritten = 0;
+   WriteFile( shFile, ssWriteBuffer, (DWORD) sstWriteBufferUsed, &dwWritten, NULL );  // If the disk is full, there's nobody to tell
+   sstWriteBufferUsed = 0;
+}
+
+
+/// Format a record and add it to #ssWriteBuffer
+///
+/// @param pRecord The record
+static void logTraceFormat( _In_ const logTraceRecord_t* pRecord ) {
+   PCWSTR format = logGetStringFromResources( pRecord->uResourceId );
+   WCHAR  wsLine[ MAX_LOG_STRING + 64 ];
+   int    iChars;
+
+   iChars = swprintf_s( wsLine, _countof( wsLine ), L"%12.3f  %5lu  %s: ",
+      (double) ( pRecord->i64Timestamp - si64Origin ) * sdTicksToMs,
+      pRecord->dwThreadId,
+      pRecord->pwszFunctionName );
+
+   /// The format string comes from our own resources and every argument is a
+   /// word, so the extra arguments are harmless
+   iChars += swprintf_s( wsLine + iChars, _countof( wsLine ) - iChars, format,
+      pRecord->args[ 0 ], pRecord->args[ 1 ], pRecord->args[ 2 ], pRecord->args[ 3 ] );
+
+   iChars += swprintf_s( wsLine + iChars, _countof( wsLine ) - iChars, L"\r\n" );
+
+   /// Make room for the line (in UTF-8, it's at most 3 bytes per character)
+   if ( sstWriteBufferUsed + (size_t) iChars * 3 > sizeof( ssWriteBuffer ) ) {
+      logTraceFlush();
+   }
+
+   int iBytes = WideCharToMultiByte( CP_UTF8, 0, wsLine, iChars,
+      ssWriteBuffer + sstWriteBufferUsed, (int) ( sizeof( ssWriteBuffer ) - sstWriteBufferUsed ), NULL, NULL );
+
+   sstWriteBufferUsed += ( iBytes > 0 ) ? (size_t) iBytes : 0;
+}
+
+
+/// Drain every ring, oldest record first, into the trace file
+///
+/// Each ring is in time order, so this merges them by always taking the
+/// oldest record at the tail of any ring (see #logRingsOldest).
+static void logTraceDrain() {
+   LONG64 l64Tails[ LOG_TRACE_RINGS ];
+   LONG64 l64Heads[ LOG_TRACE_RINGS ];
+
+   /// Only drain what's there now.  New records wait for the next pass.
+   for ( size_t i = 0 ; i < LOG_TRACE_RINGS ; i++ ) {
+      l64Heads[ i ] = sRings[ i ].l64Head;  // A volatile read has acquire semantics in MSVC
+      l64Tails[ i ] = sRings[ i ].l64Tail;
+   }
+
+   for ( ;; ) {
+      const size_t stOldest = logRingsOldest( &sRingSet, l64Tails, l64Heads );
+      if ( stOldest == LOG_TRACE_RINGS ) {
+         break;
+      }
+
+      logTraceFormat( (const logTraceRecord_t*) logRingsRecord( &sRingSet, stOldest, l64Tails[ stOldest ] ) );
+
+      /// Give the record back to its owner
+      l64Tails[ stOldest ]++;
+      sRings[ stOldest ].l64Tail = l64Tails[ stOldest ];
+   }
+
+   logTraceFlush();
+}
+
+
+/// The drain thread
+///
+/// @param Context Not used
+/// @return `0`
+static DWORD WINAPI logTraceDrainThread( LPVOID Context ) {
+   UNREFERENCED_PARAMETER( Context );
+
+   for ( ;; ) {
+      DWORD dwWaitResult = WaitForSingleObject( shStopEvent, LOG_TRACE_DRAIN_MS );
+
+      logTraceDrain();
+
+      if ( dwWaitResult != WAIT_TIMEOUT ) {
+         break;  // Stopped (or the wait failed).  Either way, we just did a last drain.
+      }
+   }
+
+   ExitThread( 0 );
+}
+
+
+/// Open the trace file and start the drain thread (if `/trace` is on the
+/// command line)
+///
+/// Tracing is a diagnostic, so if it can't start, warn and run without it.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL logTraceInit() {
+   if ( !gbLogTraceEnabled ) {
+      return TRUE;
+   }
+
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER now;
+
+   QueryPerformanceFrequency( &frequency );  // These never fail on Windows XP or later
+   QueryPerformanceCounter( &now );
+
+   si64Origin  = now.QuadPart;
+   sdTicksToMs = 1000.0 / (double) frequency.QuadPart;
+
+   shFile = CreateFileW( swsFile, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+   if ( shFile == INVALID_HANDLE_VALUE ) {
+      gbLogTraceEnabled = false;
+      LOG_WARN_R( IDS_LOG_TRACE_FAILED_TO_OPEN_FILE, swsFile );  // "Failed to open the trace file [%s].  Continuing without tracing."
+      return FALSE;
+   }
+
+   shStopEvent = CreateEventExW( NULL, NULL, 0, EVENT_MODIFY_STATE | SYNCHRONIZE );
+   if ( shStopEvent != NULL ) {
+      shDrainThread = CreateThread( NULL, 0, logTraceDrainThread, NULL, 0, NULL );
+   }
+
+   if ( shDrainThread == NULL ) {
+      gbLogTraceEnabled = false;
+      logTraceCleanup();
+      LOG_WARN_R( IDS_LOG_TRACE_FAILED_TO_START_DRAINER );  // "Failed to start the trace drain thread.  Continuing without tracing."
+      return FALSE;
+   }
+
+   LOG_INFO_R( IDS_LOG_TRACE_ENABLED, swsFile );  // "Writing trace records to [%s]"
+
+   return TRUE;
+}
+
+
+/// Stop the drain thread (after a last drain) and close the trace file
+///
+/// Call this after the threads that trace have ended.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL logTraceCleanup() {
+   gbLogTraceEnabled = false;
+
+   if ( shDrainThread != NULL ) {
+      SetEvent( shStopEvent );
+      WaitForSingleObject( shDrainThread, INFINITE );
+      CloseHandle( shDrainThread );
+      shDrainThread = NULL;
+   }
+
+   if ( shStopEvent != NULL ) {
+      CloseHandle( shStopEvent );
+      shStopEvent = NULL;
+   }
+
+   if ( shFile != INVALID_HANDLE_VALUE ) {
+      CloseHandle( shFile );
+      shFile = INVALID_HANDLE_VALUE;
+   }
+
+   /// Report any records that were dropped
+   UINT64 u64Dropped = 0;
+   for ( size_t i = 0 ; i < LOG_TRACE_RINGS ; i++ ) {
+      u64Dropped += (UINT64) sRings[ i ].l64Dropped;
+   }
+
+   if ( u64Dropped > 0 || sl64NoRingDropped > 0 ) {
+      LOG_INFO_R( IDS_LOG_TRACE_DROPPED, u64Dropped, (UINT64) sl64NoRingDropped );  // "Trace records dropped:  %llu (ring full)   %llu (no ring)"
+   }
+
+   return TRUE;
+}
+
+
+/// Compare the per-call cost of #LOG_TRACE_B with #logR and #logQ (at
+/// #LOG_LEVEL_TRACE)
+///
+/// #LOG_TRACE_B writes into a private ring, so this works with or without
+/// `/trace` and doesn't disturb the real trace file.  The other loggers send
+/// #LOG_TRACE_BENCHMARK_CALLS messages to DebugView.
+///
+/// This is not normally used, except for testing.
+void logTraceBenchmark() {
+   static logTraceRing_t benchRing;  // Too big for the stack
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER start;
+   LARGE_INTEGER end;
+
+   QueryPerformanceFrequency( &frequency );
+
+   const double ticksToNs = 1.0e9 / (double) frequency.QuadPart;
+
+   /// - Time #logTracePut.  Empty the ring after every lap (as if the drain
+   ///   thread kept up) so we time the fast path, not the drop path.
+   const size_t stPutCalls = LOG_TRACE_BENCHMARK_CALLS * 1000;
+
+   QueryPerformanceCounter( &start );
+   for ( size_t i = 0 ; i < stPutCalls ; i++ ) {
+      logTracePut( &benchRing, __FUNCTIONW__, IDS_LOG_TRACE_BENCHMARK_MESSAGE, i, 0, 0, 0 );
+      if ( ( i & ( LOG_TRACE_RING_DEPTH - 1 ) ) == LOG_TRACE_RING_DEPTH - 1 ) {
+         benchRing.l64Tail = benchRing.l64Head;
+      }
+   }
+   QueryPerformanceCounter( &end );
+
+   const double binaryNs = (double) ( end.QuadPart - start.QuadPart ) * ticksToNs / (double) stPutCalls;
+
+   /// - Time #logR
+   QueryPerformanceCounter( &start );
+   for ( size_t i = 0 ; i < LOG_TRACE_BENCHMARK_CALLS ; i++ ) {
+      LOG_TRACE_R( IDS_LOG_TRACE_BENCHMARK_MESSAGE, i );  // "Trace benchmark message:  %zu"
+   }
+   QueryPerformanceCounter( &end );
+
+   const double logRNs = (double) ( end.QuadPart - start.QuadPart ) * ticksToNs / LOG_TRACE_BENCHMARK_CALLS;
+
+   /// - Time #logQ
+   QueryPerformanceCounter( &start );
+   for ( size_t i = 0 ; i < LOG_TRACE_BENCHMARK_CALLS ; i++ ) {
+      LOG_TRACE_Q( IDS_LOG_TRACE_BENCHMARK_MESSAGE, i );  // "Trace benchmark message:  %zu"
+   }
+   QueryPerformanceCounter( &end );
+
+   const double logQNs = (double) ( end.QuadPart - start.QuadPart ) * ticksToNs / LOG_TRACE_BENCHMARK_CALLS;
+
+   LOG_INFO_R( IDS_LOG_TRACE_BENCHMARK, binaryNs, logRNs, logQNs );  // "Trace benchmark:  LOG_TRACE_B: %.1f ns/call   logR: %.1f ns/call   logQ: %.1f ns/call"
+}
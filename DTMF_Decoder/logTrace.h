@@ -0,0 +1,158 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Extend log.cpp with a deferred-formatting, binary trace logger for the
+/// realtime threads
+///
+/// @file    logTrace.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>  // For BOOL, UINT_PTR, QueryPerformanceCounter, etc.
+
+
+/// The maximum number of argument words in a trace record
+#define LOG_TRACE_MAX_ARGS   (4)
+
+/// The number of records in each thread's ring.  Must be a power of 2.
+#define LOG_TRACE_RING_DEPTH (512)
+
+/// The maximum number of threads that can hold a ring at once
+#define LOG_TRACE_RINGS      (32)
+
+
+/// One trace record.  It holds everything needed to format the message later:
+/// The resource string, the function, the time, the thread and the raw
+/// arguments.
+typedef struct {
+   INT64    i64Timestamp;                  ///< When it was logged (in performance counter ticks)
+   PCWSTR   pwszFunctionName;              ///< The function that logged it.  Must be a string literal (like `__FUNCTIONW__`).
+   UINT     uResourceId;                   ///< The resource string used to format the arguments
+   DWORD    dwThreadId;                    ///< The thread that logged it
+   UINT_PTR args[ LOG_TRACE_MAX_ARGS ];    ///< The raw arguments
+} logTraceRecord_t;
+
+
+/// One thread's ring of trace records.  Only the thread that owns the ring
+/// writes records and #logTraceRing_t::l64Head.  Only the drain thread
+/// reads records and writes #logTraceRing_t::l64Tail.  The head and tail are
+/// on separate cache lines, so the 2 threads don't fight over them.
+typedef struct {
+   DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) volatile LONG64 l64Head;  ///< The next record the owner will write
+   volatile LONG64  l64Dropped;                                            ///< Records the owner dropped because the ring was full
+   volatile LONG    lOwned;                                                ///< `1` if a thread holds this ring
+   DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) volatile LONG64 l64Tail;  ///< The next record the drain thread will read
+   logTraceRecord_t records[ LOG_TRACE_RING_DEPTH ];                       ///< The records
+} logTraceRing_t;
+
+
+extern BOOL logTraceParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine );
+extern BOOL logTraceInit();
+extern BOOL logTraceCleanup();
+extern void logTraceBenchmark();
+
+extern logTraceRing_t* logTraceClaimRing();
+extern void logTraceReleaseRing();
+
+
+/// `true` if `/trace` is on the command line.  Declared external to support
+/// inlining.
+extern bool gbLogTraceEnabled;
+
+/// The calling thread's ring (or `NULL` if it hasn't claimed one).  Declared
+/// external to support inlining.
+extern __declspec( thread ) logTraceRing_t* gpLogTraceRing;
+
+
+/// Write a record to a ring.  No formatting, no locks and no system calls.
+///
+/// Inlined for performance.
+///
+/// @param pRing            The ring (owned by the calling thread)
+/// @param pwszFunctionName The function that's logging (a string literal)
+/// @param uResourceId      The resource string used to format the arguments
+/// @param a0, a1, a2, a3   The raw arguments
+__forceinline void logTracePut(
+   _Inout_      logTraceRing_t* pRing,
+   _In_z_ const PCWSTR          pwszFunctionName,
+   _In_   const UINT            uResourceId,
+   _In_   const UINT_PTR        a0,
+   _In_   const UINT_PTR        a1,
+   _In_   const UINT_PTR        a2,
+   _In_   const UINT_PTR        a3 ) {
+
+   const LONG64 l64Head = pRing->l64Head;
+
+   if ( l64Head - pRing->l64Tail >= LOG_TRACE_RING_DEPTH ) {
+      pRing->l64Dropped += 1;  // Full.  Never wait for the drain thread.
+      return;
+   }
+
+   logTraceRecord_t* pRecord = &pRing->records[ l64Head & ( LOG_TRACE_RING_DEPTH - 1 ) ];
+
+   LARGE_INTEGER now;
+   QueryPerformanceCounter( &now );  // Reads the TSC.  It's not a system call.
+
+   pRecord->i64Timestamp     = now.QuadPart;
+   pRecord->pwszFunctionName = pwszFunctionName;
+   pRecord->uResourceId      = uResourceId;
+   pRecord->dwThreadId       = GetCurrentThreadId();  // Reads the TEB.  It's not a system call.
+   pRecord->args[ 0 ]        = a0;
+   pRecord->args[ 1 ]        = a1;
+   pRecord->args[ 2 ]        = a2;
+   pRecord->args[ 3 ]        = a3;
+
+   /// A volatile write has release semantics in MSVC, so the drain thread
+   /// sees the record before it sees the new head
+   pRing->l64Head = l64Head + 1;
+}
+
+
+/// Record a trace message in the calling thread's ring
+///
+/// This is intended to be called through #LOG_TRACE_B.  It is not intended to
+/// be called directly.
+///
+/// Inlined for performance.
+///
+/// @param pwszFunctionName The function that's logging (a string literal)
+/// @param uResourceId      The resource string used to format the arguments
+/// @param a0, a1, a2, a3   The raw arguments
+__forceinline void logTraceWrite(
+   _In_z_ const PCWSTR   pwszFunctionName,
+   _In_   const UINT     uResourceId,
+   _In_   const UINT_PTR a0 = 0,
+   _In_   const UINT_PTR a1 = 0,
+   _In_   const UINT_PTR a2 = 0,
+   _In_   const UINT_PTR a3 = 0 ) {
+
+   if ( !gbLogTraceEnabled ) {
+      return;
+   }
+
+   logTraceRing_t* pRing = gpLogTraceRing;
+   if ( pRing == NULL ) {
+      pRing = logTraceClaimRing();
+      if ( pRing == NULL ) {
+         return;  // Out of rings.  logTraceClaimRing counted it.
+      }
+   }
+
+   logTracePut( pRing, pwszFunctionName, uResourceId, a0, a1, a2, a3 );
+}
+
+
+/// Log a binary trace message using a resource string
+///
+/// The arguments are copied as raw words and formatted later by the drain
+/// thread, so they must be integers or pointers that are still valid later --
+/// not strings or floating point numbers.  The resource string should format
+/// them with `%zu`, `%zd`, `%zx` or `%p`.
+///
+/// This only records anything when `/trace` is on the command line.
+#define LOG_TRACE_B( uId, ... )  logTraceWrite( __FUNCTIONW__, uId, __VA_ARGS__ )
@@ -16,8 +16,9 @@
 ///     - The error message
 ///     - The resource name
 ///     - The resource id
-///   - The first 4K of log messages
-///   - The last 4K of log messages (in a circular buffer)
+///   - The flight recorder (see logFlight.cpp):
+///     - The first log messages
+///     - The last log messages from each thread
 ///
 /// The design is such that the main application doesn't need to know much
 /// about logWER.
@@ -56,14 +57,12 @@
 /// | `WerReportSetParameter`  | https ://learn.microsoft.com/en-us/windows/win32/api/werapi/nf-werapi-werreportsetparameter                         |
 /// | `WerReportSubmit`        | https ://learn.microsoft.com/en-us/windows/win32/api/werapi/nf-werapi-werreportsubmit                               |
 /// | `_ASSERTE`               | https://learn.microsoft.com/en-us/cpp/c-runtime-library/reference/assert-asserte-assert-expr-macros?view=msvc-170   |
-/// | `wcslen`                 | https://en.cppreference.com/w/c/string/wide/wcslen                                                                  |
 /// | `va_arg`                 | https://learn.microsoft.com/en-us/cpp/c-runtime-library/reference/va-arg-va-copy-va-end-va-start?view=msvc-170      |
 ///
 /// ## CRT & Memory Management API
 /// | API                | Link                                                                                         |
 /// |--------------------| ---------------------------------------------------------------------------------------------|
 /// | `CopyMemory`       | https://learn.microsoft.com/en-us/previous-versions/windows/desktop/legacy/aa366535(v=vs.85) |
-/// | `StringCbCopyExW`  | https://learn.microsoft.com/en-us/windows/win32/api/strsafe/nf-strsafe-stringcbcopyexw       |
 /// | `StringCbPrintfW`  | https://learn.microsoft.com/en-us/windows/win32/api/strsafe/nf-strsafe-stringcbprintfw       |
 /// | `StringCchPrintfW` | https://learn.microsoft.com/en-us/windows/win32/api/strsafe/nf-strsafe-stringcchprintfw      |
 ///
@@ -78,6 +77,7 @@
 #include "log.h"          // For LOG_INFO
 #include "log_ex.h"       // For extensions to the log
 #include "version.h"      // For FULL_VERSION_W
+#include "logFlight.h"    // For the flight recorder
 
 #include <inttypes.h>     // For PRIu16
 #include <psapi.h>        // For GetProcessImageFileNameW
@@ -87,8 +87,6 @@
 
 #define REPORT_NAME_SIZE 64  ///< The maximum size of #swzReportName
 
-#define MESSAGE_BUFFER_CAPACITY 4096   ///< Define the size of #msgBuf_t.msgBuf
-
 
 static HREPORT shReport = NULL;                            ///< Handle to the windows error report
 static WCHAR   swzFullExeFilename[ MAX_PATH ]    = { 0 };  ///< Full path of the executable file name
@@ -96,33 +94,6 @@ static WCHAR   swzReportName[ REPORT_NAME_SIZE ] = { 0 };  ///< Name of the repo
 static BOOL    sbLoggedWerFatalEvent = FALSE;              ///< WER captures the first #LOG_LEVEL_ERROR or #LOG_LEVEL_FATAL event.  This is `TRUE` if an event has been logged.
 
 
-/// The structure of the two WER buffers
-///
-/// Integers are held as bytes as that's easier to read as a memory dump
-///
-/// @todo Create and monitor a guard for this buffer
-typedef struct {
-   size_t messageBufferCapacity;  ///< The size of the message buffer in bytes
-   size_t msgStartOffset;         ///< The offset (in bytes!) to the end of the buffer (or the wraparound point)
-   WCHAR msgBuf[ MESSAGE_BUFFER_CAPACITY ];  ///< The message buffer
-} msgBuf_t;
-
-/// A buffer with the first #MESSAGE_BUFFER_CAPACITY characters of the log.
-/// Once data is written into this buffer, it never gets overwritten.  This
-/// buffer preserves the startup logs of the application.
-static msgBuf_t firstMsgs = { MESSAGE_BUFFER_CAPACITY << 1, 0, { 0 } };
-
-/// `FALSE` while #firstMsgs is filling.  Once it's full, set to `TRUE` and
-/// #lastMsgs will start filling.
-static BOOL bIsFirstBufferFull = FALSE;
-
-/// A circular buffer with the last #MESSAGE_BUFFER_CAPACITY characters of the
-/// log.  After the initial log is written in #firstMsgs, log messages are
-/// written (circularly) in this buffer.  This buffer preserves the events
-/// leading up to the failure.
-static msgBuf_t lastMsgs = { MESSAGE_BUFFER_CAPACITY << 1, 0, { 0 } };
-
-
 /// Initialize Windows Error Reporting
 ///
 /// As an extension to log.cpp, logWER.cpp can see all of the variables set in
@@ -153,16 +124,14 @@ RETURN_BOOL logWerInit() {
    CopyMemory( myReport.wzApplicationPath,   swzFullExeFilename, sizeof( myReport.wzApplicationPath   ) );
 
    // Compose myReport.wzDescription
-   wBuffer_t format = { L"", BUFFER_GUARD };
-   logGetStringFromResources( IDS_LOG_WER_DESCRIPTION, &format );  // "%s has a problem and needs to shutdown.  A report will be generated and sent to the developer."
-   StringCbPrintfW( myReport.wzDescription, sizeof( myReport.wzDescription ), format.sBuf, swAppTitle );
+   PCWSTR format = logGetStringFromResources( IDS_LOG_WER_DESCRIPTION );  // "%s has a problem and needs to shutdown.  A report will be generated and sent to the developer."
+   StringCbPrintfW( myReport.wzDescription, sizeof( myReport.wzDescription ), format, swAppTitle );
 
    myReport.hwndParent = *sphMainWindow;
 
    // Compose swzReportName
-   format = { L"", BUFFER_GUARD };
-   logGetStringFromResources( IDS_LOG_WER_REPORT_NAME, &format );  // "%s Error Report"
-   StringCchPrintfW( swzReportName, REPORT_NAME_SIZE, format.sBuf, swAppTitle );
+   format = logGetStringFromResources( IDS_LOG_WER_REPORT_NAME );  // "%s Error Report"
+   StringCchPrintfW( swzReportName, REPORT_NAME_SIZE, format, swAppTitle );
 
    hr = WerReportCreate(
       swzReportName,       // A Unicode string with the name of this event
@@ -176,13 +145,22 @@ RETURN_BOOL logWerInit() {
 
    sbLoggedWerFatalEvent = FALSE;
 
+   /// Register the flight recorder, so it's in the dump if the program crashes
+   if ( !logFlightRegister() ) {
+      LOG_WARN_R( IDS_LOG_WER_FAILED_TO_REGISTER_MEMORY, L"Flight recorder" );  // "Failed to register %s memory block with Windows Error Report"
+   }
+
    LOG_INFO_R( IDS_LOG_WER_INIT_SUCCESS );  // "Initialized Windows Error Reporting."
 
    return TRUE;
 }
 
 
-/// Journal a log message into one of the two WER log queues
+/// Characterize the report with the first #LOG_LEVEL_ERROR or
+/// #LOG_LEVEL_FATAL message
+///
+/// The loggers record every message in the flight recorder (see
+/// #logFlightRecord), so this doesn't copy anything for lower levels.
 ///
 /// @param logLevel      The level of this logging event
 /// @param resourceName  The name of the resource (if any)
@@ -211,64 +189,7 @@ RETURN_BOOL logWerEvent(
 
    HRESULT hr;  // HRESULT result
 
-   _ASSERTE( firstMsgs.messageBufferCapacity >= firstMsgs.msgStartOffset );
-   _ASSERTE( lastMsgs.messageBufferCapacity >= lastMsgs.msgStartOffset );
-
-   size_t msgLength = wcslen( logMsg ) << 1;  // wcslen returns the number of chars, << 1 converts to bytes
-
-   size_t firstBytesRemaining = firstMsgs.messageBufferCapacity - firstMsgs.msgStartOffset;
-
-   /// If the current message would overflow #firstMsgs, then it's full and
-   /// it's time to shift to the #lastMsgs buffer.
-   if ( !bIsFirstBufferFull && msgLength >= firstBytesRemaining ) {
-      bIsFirstBufferFull = TRUE;
-   }
-
-   STRSAFE_LPWSTR endPtr;
-
-   if ( !bIsFirstBufferFull ) {  // If #firstMsgs is not full...
-      _ASSERTE( firstBytesRemaining > msgLength );
-
-      hr = StringCbCopyExW(
-         firstMsgs.msgBuf + ( firstMsgs.msgStartOffset >> 1 ),  // Destination buffer
-         firstBytesRemaining,                   // Size of destination buffer in bytes
-         logMsg,                                // Null terminated wide source string
-         &endPtr,                               // Populate a pointer to the end of the destination buffer
-         NULL,                                  // Number of unused bytes in destination
-         0                                      // Flags
-      );
-      if ( !( hr == S_OK || hr == STRSAFE_E_INSUFFICIENT_BUFFER ) ) {
-         FATAL_IN_LOG( L"Unknown error in StringCbCopyExW.  Exiting immediately." );
-      }
-
-      // Pointer arithmetic is always in terms of the derefrenced object
-      // (`WCHAR`s in this case), so convert them to bytes.
-      firstMsgs.msgStartOffset = ( endPtr - firstMsgs.msgBuf ) << 1;
-   } else {
-      size_t lastBytesRemaining = lastMsgs.messageBufferCapacity - lastMsgs.msgStartOffset;
-
-      // If this message exceeds the remaining size of the buffer, then start over
-      if ( msgLength >= lastBytesRemaining ) {
-         lastMsgs.msgStartOffset = 0;
-         lastBytesRemaining = lastMsgs.messageBufferCapacity;
-      }
-
-      hr = StringCbCopyExW(
-         lastMsgs.msgBuf + ( lastMsgs.msgStartOffset >> 1 ),  // Destination buffer
-         lastBytesRemaining,                    // Size of destination buffer in bytes
-         logMsg,                                // Null terminated wide source string
-         &endPtr,                               // Populate a pointer to the end of the destination buffer
-         NULL,                                  // Number of unused bytes in destination
-         0                                      // Flags
-      );
-      if ( !( hr == S_OK || hr == STRSAFE_E_INSUFFICIENT_BUFFER ) ) {
-         FATAL_IN_LOG( L"Unknown error in StringCbCopyExW.  Exiting immediately." );
-      }
-
-      // Pointer arithmetic is always in terms of the derefrenced object
-      // (`WCHAR`s in this case), so convert them to bytes.
-      lastMsgs.msgStartOffset = ( endPtr - lastMsgs.msgBuf ) << 1;
-   }
+   /// The message itself is in the flight recorder (see logFlight.cpp)
 
    /// Don't set any WER parameters if the log level is less than #LOG_LEVEL_ERROR
    if ( logLevel < LOG_LEVEL_ERROR ) {
@@ -344,15 +265,9 @@ RETURN_BOOL logWerEvent(
 RETURN_BOOL logWerSubmit() {
    HRESULT hr;  // HRESULT result
 
-   hr = WerRegisterMemoryBlock(
-      &firstMsgs, sizeof( firstMsgs )
-   );
-   CHECK_HR_R( IDS_LOG_WER_FAILED_TO_REGISTER_MEMORY, L"First" );  // "Failed to register %s memory block with Windows Error Report"
-
-   hr = WerRegisterMemoryBlock(
-      &lastMsgs, sizeof( lastMsgs )
-   );
-   CHECK_HR_R( IDS_LOG_WER_FAILED_TO_REGISTER_MEMORY, L"Last" );  // "Failed to register %s memory block with Windows Error Report"
+   /// Render the flight recorder into its (registered) text buffer now.  The
+   /// raw records were registered by #logWerInit.
+   logFlightRender();
 
 
    hr = WerReportAddDump(
@@ -34,9 +34,7 @@ extern WCHAR      swAppName[ MAX_LOG_STRING ];
 extern WCHAR      swAppTitle[ MAX_LOG_STRING ];
 
 
-extern void logGetStringFromResources(
-   _In_   const UINT       resourceId,
-   _Inout_      wBuffer_t* pString );
+extern PCWSTR logGetStringFromResources( _In_ const UINT resourceId );
 
 extern void logShowMessageW( logLevels_t logLevel, PCWSTR message );
 
@@ -0,0 +1,434 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// A history of the Goertzel magnitudes for the meters and the spectrogram
+///
+/// #mvcSnapshotPublish appends every analysis with #mvcHistoryAppend (on the
+/// capture thread).  #mvcViewRefresh drains them into the pyramid with
+/// #mvcHistoryDrain (on the UI thread) and the view draws from
+/// #mvcHistoryGetPyramid.  Nothing here touches a window, so
+/// #mvcHistoryTest runs headless.
+///
+/// @file    mvcHistory.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <math.h>         // For log10f
+
+#include "mvcModel.h"     // For NUMBER_OF_DTMF_TONES
+#include "goertzel.h"     // For GOERTZEL_MAGNITUDE_THRESHOLD
+#include "mvcHistory.h"   // For yo bad self
+
+
+/// How long #mvcHistoryTest runs the writer (in milliseconds)
+#define MVC_HISTORY_TEST_MS (1000)
+
+
+static mvcHistoryRing_t    sRing;     ///< The model's history.  The capture thread writes and the UI thread reads.
+static mvcHistoryPyramid_t sPyramid;  ///< The model's downsampled history.  Only the UI thread touches it.
+static mvcHistoryEntry_t   sDrained[ MVC_HISTORY_RING_SIZE ];  ///< Scratch for #mvcHistoryDrain
+
+
+/// Take the oldest entries the reader hasn't seen yet.  Only the reader may
+/// call this.
+///
+/// The writer may overwrite an entry while we copy it.  So, after the copy,
+/// we check the head again and throw out (and count as overruns) any entry
+/// the writer could have reached.
+///
+/// @param pRing     The ring
+/// @param pEntries  Where to copy the entries
+/// @param stMax     The most entries to copy
+/// @param pu64First The ring index of the first entry copied (so the caller
+///                  can see the gaps)
+/// @return The number of entries copied
+size_t mvcHistoryRingRead(
+   _Inout_                         mvcHistoryRing_t*  pRing,
+   _Out_writes_to_( stMax, return ) mvcHistoryEntry_t* pEntries,
+   _In_                      const size_t             stMax,
+   _Out_                           UINT64*            pu64First ) {
+   _ASSERTE( pRing    != NULL );
+   _ASSERTE( pEntries != NULL );
+
+   const LONG64 l64Head  = pRing->l64Head;  // A volatile read has acquire semantics in MSVC
+   LONG64       l64Start = pRing->l64Tail;
+
+   /// - Skip what the writer already overwrote
+   if ( l64Head - l64Start > MVC_HISTORY_RING_SIZE ) {
+      pRing->u64Overruns += (UINT64) ( l64Head - MVC_HISTORY_RING_SIZE - l64Start );
+      l64Start = l64Head - MVC_HISTORY_RING_SIZE;
+   }
+
+   size_t stCount = (size_t) ( l64Head - l64Start );
+   stCount = ( stCount < stMax ) ? stCount : stMax;
+
+   for ( size_t i = 0 ; i < stCount ; i++ ) {
+      pEntries[ i ] = pRing->entries[ ( l64Start + (LONG64) i ) & ( MVC_HISTORY_RING_SIZE - 1 ) ];
+   }
+
+   /// - The copies must be done before we look at the head again
+   MemoryBarrier();
+
+   /// - The writer is writing (or has written) the slots of every entry
+   ///   older than `head - size + 1`, so throw them out
+   const LONG64 l64Safe = pRing->l64Head - MVC_HISTORY_RING_SIZE + 1;
+   if ( l64Start < l64Safe ) {
+      size_t stTorn = (size_t) ( l64Safe - l64Start );
+      stTorn = ( stTorn < stCount ) ? stTorn : stCount;
+
+      memmove( pEntries, pEntries + stTorn, ( stCount - stTorn ) * sizeof( mvcHistoryEntry_t ) );
+      stCount            -= stTorn;
+      l64Start           += (LONG64) stTorn;
+      pRing->u64Overruns += stTorn;
+   }
+
+   pRing->l64Tail = l64Start + (LONG64) stCount;
+   *pu64First     = (UINT64) l64Start;
+
+   return stCount;
+}
+
+
+/// Add an analysis to level 0 of the pyramid.  Every second column of a
+/// level is combined with the one before it (the peak of each tone) and
+/// carried up to the next level.
+///
+/// @param pPyramid The pyramid
+/// @param pEntry   The analysis
+void mvcHistoryPyramidAdd( _Inout_ mvcHistoryPyramid_t* pPyramid, _In_ const mvcHistoryEntry_t* pEntry ) {
+   _ASSERTE( pPyramid != NULL );
+   _ASSERTE( pEntry   != NULL );
+
+   mvcHistoryEntry_t carry = *pEntry;
+
+   for ( size_t stLevel = 0 ; stLevel < MVC_HISTORY_LEVELS ; stLevel++ ) {
+      const UINT64 u64Column = pPyramid->u64Columns[ stLevel ]++;
+
+      pPyramid->columns[ stLevel ][ u64Column & ( MVC_HISTORY_COLUMNS - 1 ) ] = carry;
+
+      if ( ( u64Column & 1 ) == 0 ) {
+         break;  // The first of a pair waits for its partner
+      }
+
+      const mvcHistoryEntry_t* pPartner = &pPyramid->columns[ stLevel ][ ( u64Column - 1 ) & ( MVC_HISTORY_COLUMNS - 1 ) ];
+
+      for ( size_t i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+         carry.fMagnitude[ i ] = ( pPartner->fMagnitude[ i ] > carry.fMagnitude[ i ] ) ? pPartner->fMagnitude[ i ] : carry.fMagnitude[ i ];
+      }
+   }
+}
+
+
+/// Get a column of the pyramid
+///
+/// @param pPyramid  The pyramid
+/// @param stLevel   The level
+/// @param u64Column The column (counting from the first one ever added to
+///                  the level)
+/// @return The column or `NULL` if it hasn't been added yet or has fallen
+///         out of the level's ring
+const mvcHistoryEntry_t* mvcHistoryPyramidColumn(
+   _In_ const mvcHistoryPyramid_t* pPyramid,
+   _In_ const size_t               stLevel,
+   _In_ const UINT64               u64Column ) {
+   _ASSERTE( pPyramid != NULL );
+   _ASSERTE( stLevel < MVC_HISTORY_LEVELS );
+
+   const UINT64 u64Columns = pPyramid->u64Columns[ stLevel ];
+
+   if ( u64Column >= u64Columns || u64Columns - u64Column > MVC_HISTORY_COLUMNS ) {
+      return NULL;
+   }
+
+   return &pPyramid->columns[ stLevel ][ u64Column & ( MVC_HISTORY_COLUMNS - 1 ) ];
+}
+
+
+/// Scale a magnitude for display.  The scale is logarithmic and covers
+/// #MVC_HISTORY_RANGE_DB with #GOERTZEL_MAGNITUDE_THRESHOLD in the middle,
+/// so a tone that's just detected is at `0.5`.
+///
+/// @param fMagnitude A Goertzel magnitude
+/// @return `0.0` to `1.0`
+float mvcHistoryScale( _In_ const float fMagnitude ) {
+   if ( fMagnitude <= 0.0f ) {
+      return 0.0f;
+   }
+
+   const float fDb    = 20.0f * log10f( fMagnitude / GOERTZEL_MAGNITUDE_THRESHOLD );
+   const float fScale = fDb / MVC_HISTORY_RANGE_DB + 0.5f;
+
+   return ( fScale < 0.0f ) ? 0.0f : ( fScale > 1.0f ) ? 1.0f : fScale;
+}
+
+
+/// Empty the history.  Neither the capture thread nor the UI thread may be
+/// using it.
+void mvcHistoryReset() {
+   ZeroMemory( (void*) &sRing, sizeof( sRing ) );
+   ZeroMemory( &sPyramid, sizeof( sPyramid ) );
+}
+
+
+/// Append an analysis to the history.  Only the capture thread may call
+/// this.
+///
+/// @param pfMagnitude The 8 magnitudes
+void mvcHistoryAppend( _In_reads_( NUMBER_OF_DTMF_TONES ) const float* pfMagnitude ) {
+   mvcHistoryRingAppend( &sRing, pfMagnitude );
+}
+
+
+/// Move every new analysis from the ring into the pyramid.  Only the UI
+/// thread may call this.
+///
+/// @return The number of analyses added.  `0` if nothing is new.
+size_t mvcHistoryDrain() {
+   size_t stAdded = 0;
+   size_t stCount;
+   UINT64 u64First;
+
+   while ( ( stCount = mvcHistoryRingRead( &sRing, sDrained, _countof( sDrained ), &u64First ) ) > 0 ) {
+      for ( size_t i = 0 ; i < stCount ; i++ ) {
+         mvcHistoryPyramidAdd( &sPyramid, &sDrained[ i ] );
+      }
+      stAdded += stCount;
+   }
+
+   return stAdded;
+}
+
+
+/// Get the pyramid.  Only the UI thread may call this.
+///
+/// @return The pyramid.  It changes on the next #mvcHistoryDrain.
+const mvcHistoryPyramid_t* mvcHistoryGetPyramid() {
+   return &sPyramid;
+}
+
+
+/// The state shared by the #mvcHistoryTest threads
+static volatile LONG       slHistoryTestGo        = 0;  ///< `0` = wait, `1` = append, `2` = stop
+static mvcHistoryRing_t    sHistoryTestRing;            ///< The test's own ring (so the display isn't disturbed)
+static mvcHistoryPyramid_t sHistoryTestPyramid;         ///< The test's own pyramid
+static mvcHistoryEntry_t   sHistoryTestRead[ MVC_HISTORY_RING_SIZE ];  ///< Scratch for the test's reader
+
+
+/// The value #mvcHistoryTest gives a tone of an entry.  It's exact in a
+/// `float`, so the test can compare with `==`.
+///
+/// @param u64Index The entry's index
+/// @param stTone   The tone
+/// @return The magnitude
+static float mvcHistoryTestValue( _In_ const UINT64 u64Index, _In_ const size_t stTone ) {
+   return (float) ( ( u64Index * NUMBER_OF_DTMF_TONES + stTone ) & 0xFFFFF );
+}
+
+
+/// The value the pyramid part of #mvcHistoryTest gives a tone of an
+/// analysis.  It jumps around, so the peaks land in different places.
+///
+/// @param u64Analysis The analysis
+/// @param stTone      The tone
+/// @return The magnitude
+static float mvcHistoryTestPyramidValue( _In_ const UINT64 u64Analysis, _In_ const size_t stTone ) {
+   return (float) ( ( u64Analysis * 37 + stTone * 11 ) % 101 );
+}
+
+
+/// The #mvcHistoryTest writer.  Appends entries as fast as it can until
+/// it's told to stop.
+///
+/// @param Context Not used
+/// @return `0`
+static DWORD WINAPI mvcHistoryTestWriter( LPVOID Context ) {
+   UNREFERENCED_PARAMETER( Context );
+
+   float  fMagnitude[ NUMBER_OF_DTMF_TONES ];
+   UINT64 u64Index = 0;
+
+   while ( slHistoryTestGo == 0 ) {
+      YieldProcessor();  // Start with the reader
+   }
+
+   while ( slHistoryTestGo == 1 ) {
+      for ( size_t i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+         fMagnitude[ i ] = mvcHistoryTestValue( u64Index, i );
+      }
+      mvcHistoryRingAppend( &sHistoryTestRing, fMagnitude );
+      u64Index++;
+   }
+
+   return 0;
+}
+
+
+/// Check that the pyramid holds the peaks of the analyses
+/// #mvcHistoryTestPyramidValue made
+///
+/// @param u64Analyses The number of analyses added
+/// @return The number of columns that were wrong
+static UINT64 mvcHistoryTestCheckPyramid( _In_ const UINT64 u64Analyses ) {
+   UINT64 u64Errors = 0;
+
+   for ( size_t stLevel = 0 ; stLevel < MVC_HISTORY_LEVELS ; stLevel++ ) {
+      const UINT64 u64Columns = u64Analyses >> stLevel;
+
+      if ( sHistoryTestPyramid.u64Columns[ stLevel ] != u64Columns ) {
+         u64Errors++;
+         continue;
+      }
+
+      /// - The column just before the ring must be gone
+      if ( u64Columns > MVC_HISTORY_COLUMNS && mvcHistoryPyramidColumn( &sHistoryTestPyramid, stLevel, u64Columns - MVC_HISTORY_COLUMNS - 1 ) != NULL ) {
+         u64Errors++;
+      }
+
+      const UINT64 u64Oldest = ( u64Columns > MVC_HISTORY_COLUMNS ) ? u64Columns - MVC_HISTORY_COLUMNS : 0;
+
+      for ( UINT64 c = u64Oldest ; c < u64Columns ; c++ ) {
+         const mvcHistoryEntry_t* pColumn = mvcHistoryPyramidColumn( &sHistoryTestPyramid, stLevel, c );
+         if ( pColumn == NULL ) {
+            u64Errors++;
+            continue;
+         }
+
+         for ( size_t i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+            float fPeak = 0.0f;
+            for ( UINT64 a = c << stLevel ; a < ( c + 1 ) << stLevel ; a++ ) {
+               const float fValue = mvcHistoryTestPyramidValue( a, i );
+               fPeak = ( fValue > fPeak ) ? fValue : fPeak;
+            }
+            if ( pColumn->fMagnitude[ i ] != fPeak ) {
+               u64Errors++;
+               break;
+            }
+         }
+      }
+   }
+
+   return u64Errors;
+}
+
+
+/// Test the history headless
+///
+///   - The pyramid:  Add a known pattern and check that every column of
+///     every level is the peak of the analyses under it
+///   - The ring:  A writer thread appends as fast as it can while this
+///     thread reads (and sometimes naps for a UI tick, so it falls behind).
+///     Checks that no entry is ever torn or out of order and that every
+///     entry was either read or counted as an overrun.
+///   - The scale:  The threshold is in the middle
+///
+/// It doesn't need a window or an audio device, so it runs with
+/// `/benchmark`.
+///
+/// @return `true` if the test passed.  `false` if there was a problem.
+bool mvcHistoryTest() {
+   /// #### Function
+
+   /// - Test the pyramid
+   const UINT64 u64Analyses = ( MVC_HISTORY_COLUMNS << MVC_HISTORY_LEVELS ) + 3;  // Fills every level and then some
+
+   ZeroMemory( &sHistoryTestPyramid, sizeof( sHistoryTestPyramid ) );
+
+   for ( UINT64 a = 0 ; a < u64Analyses ; a++ ) {
+      mvcHistoryEntry_t entry;
+      for ( size_t i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+         entry.fMagnitude[ i ] = mvcHistoryTestPyramidValue( a, i );
+      }
+      mvcHistoryPyramidAdd( &sHistoryTestPyramid, &entry );
+   }
+
+   const UINT64 u64PyramidErrors = mvcHistoryTestCheckPyramid( u64Analyses );
+
+   /// - Test the scale
+   const bool bScale = mvcHistoryScale( 0.0f ) == 0.0f
+                    && mvcHistoryScale( 1.0e9f ) == 1.0f
+                    && fabsf( mvcHistoryScale( GOERTZEL_MAGNITUDE_THRESHOLD ) - 0.5f ) < 0.001f;
+
+   /// - Test the ring
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER start;
+   LARGE_INTEGER now;
+
+   QueryPerformanceFrequency( &frequency );
+
+   ZeroMemory( (void*) &sHistoryTestRing, sizeof( sHistoryTestRing ) );
+   slHistoryTestGo = 0;
+
+   HANDLE hWriter = CreateThread( NULL, 0, mvcHistoryTestWriter, NULL, 0, NULL );
+   if ( hWriter == NULL ) {
+      LOG_WARN_R( IDS_HISTORY_TEST_FAILED_TO_START );  // "Failed to start the history test thread.  Continuing."
+      return false;
+   }
+
+   UINT64 u64Read  = 0;
+   UINT64 u64Torn  = 0;
+   UINT64 u64Next  = 0;  // The index we expect to read next
+   UINT64 u64Gaps  = 0;  // Entries skipped between reads (must match the overruns)
+   UINT64 u64Pass  = 0;
+   bool   bStopped = false;
+
+   QueryPerformanceCounter( &start );
+   InterlockedExchange( &slHistoryTestGo, 1 );
+
+   for ( ;; ) {
+      UINT64       u64First;
+      const size_t stCount = mvcHistoryRingRead( &sHistoryTestRing, sHistoryTestRead, _countof( sHistoryTestRead ), &u64First );
+
+      if ( u64First < u64Next ) {
+         u64Torn++;  // Went backwards
+      } else {
+         u64Gaps += u64First - u64Next;
+      }
+
+      for ( size_t j = 0 ; j < stCount ; j++ ) {
+         for ( size_t i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+            if ( sHistoryTestRead[ j ].fMagnitude[ i ] != mvcHistoryTestValue( u64First + j, i ) ) {
+               u64Torn++;
+               break;
+            }
+         }
+      }
+      u64Read += stCount;
+      u64Next  = u64First + stCount;
+
+      if ( bStopped ) {
+         if ( stCount == 0 ) {
+            break;  // Drained after the writer stopped
+         }
+         continue;
+      }
+
+      if ( ( ++u64Pass & 0x3F ) == 0 ) {
+         Sleep( VIEW_REFRESH_MS );  // Nap like a UI tick, so the writer laps us
+      }
+
+      QueryPerformanceCounter( &now );
+      if ( ( now.QuadPart - start.QuadPart ) * 1000 / frequency.QuadPart >= MVC_HISTORY_TEST_MS ) {
+         InterlockedExchange( &slHistoryTestGo, 2 );
+         WaitForSingleObject( hWriter, INFINITE );
+         CloseHandle( hWriter );
+         bStopped = true;
+      }
+   }
+
+   const UINT64 u64Appended = (UINT64) sHistoryTestRing.l64Head;
+   const UINT64 u64Overruns = sHistoryTestRing.u64Overruns;
+
+   LOG_INFO_R( IDS_HISTORY_TEST_RESULT,  // "History test:  Appended: %llu   Read: %llu   Overruns: %llu   Torn: %llu   Pyramid errors: %llu"
+      u64Appended, u64Read, u64Overruns, u64Torn, u64PyramidErrors );
+
+   if ( u64Torn != 0 || u64PyramidErrors != 0 || !bScale || u64Read + u64Overruns != u64Appended || u64Gaps != u64Overruns ) {
+      LOG_WARN_R( IDS_HISTORY_TEST_FAILED );  // "The history test failed.  Continuing."
+      return false;
+   }
+
+   return true;
+}
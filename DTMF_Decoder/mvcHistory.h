@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// A history of the Goertzel magnitudes for the meters and the spectrogram
+///
+/// The capture thread appends the 8 magnitudes of every analysis to a
+/// lock-free ring (#mvcHistoryRing_t).  On every UI tick, the UI thread
+/// drains the ring into a pyramid (#mvcHistoryPyramid_t):  Level 0 is every
+/// analysis and each level above it is the peak of 2 columns of the level
+/// below it.  Every level is a fixed-size ring of columns, so the history
+/// never grows and the view can draw any time span from
+/// #MVC_HISTORY_COLUMNS columns.
+///
+/// @file    mvcHistory.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>      // For BOOL, LONG64, etc.
+
+#include "mvcModel.h"     // For NUMBER_OF_DTMF_TONES
+
+
+/// The number of analyses the ring holds.  Must be a power of 2.  At about
+/// 100 analyses per second, this is 10 seconds -- the UI thread drains it
+/// every #VIEW_REFRESH_MS.
+#define MVC_HISTORY_RING_SIZE (1024)
+
+/// The number of levels in the pyramid.  Level `n` has one column for every
+/// `2^n` analyses.
+#define MVC_HISTORY_LEVELS    (4)
+
+/// The number of columns each level keeps.  Must be a power of 2.
+#define MVC_HISTORY_COLUMNS   (256)
+
+/// The span of #mvcHistoryScale in dB.  #GOERTZEL_MAGNITUDE_THRESHOLD is in
+/// the middle.
+#define MVC_HISTORY_RANGE_DB  (48.0f)
+
+static_assert( ( MVC_HISTORY_RING_SIZE & ( MVC_HISTORY_RING_SIZE - 1 ) ) == 0, "MVC_HISTORY_RING_SIZE must be a power of 2" );
+static_assert( ( MVC_HISTORY_COLUMNS   & ( MVC_HISTORY_COLUMNS   - 1 ) ) == 0, "MVC_HISTORY_COLUMNS must be a power of 2" );
+
+
+/// The magnitudes of one analysis (or the peaks of several)
+typedef struct {
+   float fMagnitude[ NUMBER_OF_DTMF_TONES ];  ///< #dtmfTones_t.goertzelMagnitude of each tone
+} mvcHistoryEntry_t;
+
+
+/// A single-writer, single-reader ring of analyses.  The writer never waits:
+/// If the reader falls more than #MVC_HISTORY_RING_SIZE behind, the oldest
+/// entries are overwritten and the reader counts them as overruns.
+typedef struct {
+   mvcHistoryEntry_t entries[ MVC_HISTORY_RING_SIZE ];  ///< The ring
+   volatile LONG64   l64Head;      ///< Entries the writer has appended (only it writes this)
+   LONG64            l64Tail;      ///< Entries the reader has taken (only it touches this)
+   UINT64            u64Overruns;  ///< Entries the reader lost (only it touches this)
+} mvcHistoryRing_t;
+
+
+/// The downsampled history.  Only the reader (the UI thread) touches it.
+typedef struct {
+   mvcHistoryEntry_t columns[ MVC_HISTORY_LEVELS ][ MVC_HISTORY_COLUMNS ];  ///< Each level's ring of columns
+   UINT64            u64Columns[ MVC_HISTORY_LEVELS ];                      ///< The columns ever added to each level
+} mvcHistoryPyramid_t;
+
+
+/// Append an analysis to the ring.  Only the writer may call this.
+///
+/// Inlined for performance.
+///
+/// @param pRing       The ring
+/// @param pfMagnitude The 8 magnitudes
+__forceinline void mvcHistoryRingAppend( _Inout_ mvcHistoryRing_t* pRing, _In_reads_( NUMBER_OF_DTMF_TONES ) const float* pfMagnitude ) {
+   const LONG64 l64Head = pRing->l64Head;  // Only this thread writes it
+
+   memcpy( pRing->entries[ l64Head & ( MVC_HISTORY_RING_SIZE - 1 ) ].fMagnitude, pfMagnitude, sizeof( mvcHistoryEntry_t ) );
+
+   pRing->l64Head = l64Head + 1;  // A volatile write has release semantics in MSVC
+}
+
+
+extern size_t mvcHistoryRingRead( _Inout_ mvcHistoryRing_t* pRing, _Out_writes_to_( stMax, return ) mvcHistoryEntry_t* pEntries, _In_ const size_t stMax, _Out_ UINT64* pu64First );
+extern void   mvcHistoryPyramidAdd( _Inout_ mvcHistoryPyramid_t* pPyramid, _In_ const mvcHistoryEntry_t* pEntry );
+extern const mvcHistoryEntry_t* mvcHistoryPyramidColumn( _In_ const mvcHistoryPyramid_t* pPyramid, _In_ const size_t stLevel, _In_ const UINT64 u64Column );
+extern float  mvcHistoryScale( _In_ const float fMagnitude );
+
+extern void   mvcHistoryReset();
+extern void   mvcHistoryAppend( _In_reads_( NUMBER_OF_DTMF_TONES ) const float* pfMagnitude );
+extern size_t mvcHistoryDrain();
+extern const mvcHistoryPyramid_t* mvcHistoryGetPyramid();
+extern bool   mvcHistoryTest();
@@ -17,6 +17,12 @@
 #include <malloc.h>       // For malloc and free
 
 #include "mvcModel.h"     // For yo bad self
+#include "mvcSnapshot.h"  // For mvcSnapshotReset
+#include "mvcHistory.h"   // For mvcHistoryReset
+
+
+/// How long #mvcModelDirtyTest toggles the tones (in milliseconds)
+#define MVC_DIRTY_TEST_MS (1000)
 
 
 /// Currently does nothing, but it's good to have around
@@ -40,6 +46,16 @@ BOOL mvcModelRelease() {
       gDtmfTones[ i ].detected = false;
    }
 
+   /// - Clear #glMvcDirtyMask and #gl64MvcDirtyOrigin
+   InterlockedExchange( &glMvcDirtyMask, 0 );
+   InterlockedExchange64( &gl64MvcDirtyOrigin, 0 );
+
+   /// - Call #mvcSnapshotReset to empty the view's snapshot
+   mvcSnapshotReset();
+
+   /// - Call #mvcHistoryReset to empty the meters and the spectrogram
+   mvcHistoryReset();
+
    /// - Nothing to clean with #gdwMmcssTaskIndex
 
    /// - We expect #audioCleanup to clean #ghAudioSamplesReadyEvent
@@ -67,6 +83,10 @@ dtmfTones_t gDtmfTones[ NUMBER_OF_DTMF_TONES ] = {
 };
 
 
+volatile LONG glMvcDirtyMask = 0;
+volatile LONG64 gl64MvcDirtyOrigin = 0;
+
+
 bool gbIsRunning = false;
 
 
@@ -116,6 +136,34 @@ BOOL pcmSetQueueSize( _In_ const size_t size ) {
 }
 
 
+void pcmEnqueueG711( _In_ const g711Law_t law, _In_reads_( stSamples ) const BYTE* pSamples, _In_ const size_t stSamples ) {
+   _ASSERTE( gPcmQueue != NULL );
+   _ASSERTE( gstQueueHead < gstQueueSize );
+
+   /// #### Function
+
+   const BYTE* pNext  = pSamples;
+   size_t      stLeft = stSamples;
+
+   /// - Write at most 2 runs per lap:  Up to the end of the queue, then from
+   ///   the start
+   while ( stLeft > 0 ) {
+      size_t stRun = gstQueueSize - gstQueueHead;
+      stRun = ( stRun < stLeft ) ? stRun : stLeft;
+
+      g711Expand( law, pNext, gPcmQueue + gstQueueHead, stRun );
+
+      pNext        += stRun;
+      stLeft       -= stRun;
+      gstQueueHead += stRun;
+
+      if ( gstQueueHead >= gstQueueSize ) {
+         gstQueueHead = 0;
+      }
+   }
+}
+
+
 void pcmReleaseQueue() {
    /// #### Function
 
@@ -139,3 +187,194 @@ void pcmReleaseQueue() {
 
 DWORD   gdwMmcssTaskIndex        = 0;
 HANDLE  ghAudioSamplesReadyEvent = NULL;
+
+
+/// Compute the one rectangle that covers every tone in a dirty mask.  A row
+/// tone covers its whole row and a column tone covers its whole column
+/// (including the frequency labels).  #MVC_DIRTY_HISTORY covers the meters
+/// and the spectrogram.
+///
+/// This doesn't touch the window, so it's safe to call from anywhere.
+///
+/// `WM_PAINT` only ever sees the bounding box of the update region (see
+/// `GetUpdateRect`), so a union of rectangles costs no more paint than a
+/// region would.
+///
+/// @param lMask The tones to redraw (from #mvcModelTakeDirty) and
+///              #MVC_DIRTY_HISTORY
+/// @param pRect The rectangle to invalidate
+/// @return `true` if there's something to redraw.  `false` if the mask is
+///         empty (and `pRect` is all zeros).
+bool mvcModelDirtyRect( _In_ const LONG lMask, _Out_ RECT* pRect ) {
+   _ASSERTE( pRect != NULL );
+
+   static const LONG slRowTop[ 4 ]  = { ROW0, ROW1, ROW2, ROW3 };
+   static const LONG slColLeft[ 4 ] = { COL0, COL1, COL2, COL3 };
+
+   pRect->left   = 0;
+   pRect->top    = 0;
+   pRect->right  = 0;
+   pRect->bottom = 0;
+
+   bool bDirty = false;
+
+   for ( size_t i = 0 ; i <= NUMBER_OF_DTMF_TONES ; i++ ) {
+      if ( ( lMask & ( 1L << i ) ) == 0 ) {
+         continue;
+      }
+
+      RECT rect;
+
+      if ( i == NUMBER_OF_DTMF_TONES ) {   // MVC_DIRTY_HISTORY
+         rect.left   = METER_LEFT;
+         rect.top    = HISTORY_TOP;
+         rect.right  = SPECTROGRAM_LEFT + SPECTROGRAM_WIDTH;
+         rect.bottom = HISTORY_TOP + HISTORY_HEIGHT;
+      } else if ( ( i & 0b1100 ) == 0 ) {  // If i is between 0 and 3, it's a row
+         rect.left   = 0;
+         rect.top    = slRowTop[ i ];
+         rect.right  = giWindowWidth;
+         rect.bottom = slRowTop[ i ] + BOX_HEIGHT;
+      } else {                             // Otherwise, it's a column
+         rect.left   = slColLeft[ i - 4 ] - 16;
+         rect.top    = 0;
+         rect.right  = slColLeft[ i - 4 ] + 71;
+         rect.bottom = giWindowHeight;
+      }
+
+      if ( !bDirty ) {
+         *pRect = rect;
+         bDirty = true;
+      } else {
+         pRect->left   = ( rect.left   < pRect->left   ) ? rect.left   : pRect->left;
+         pRect->top    = ( rect.top    < pRect->top    ) ? rect.top    : pRect->top;
+         pRect->right  = ( rect.right  > pRect->right  ) ? rect.right  : pRect->right;
+         pRect->bottom = ( rect.bottom > pRect->bottom ) ? rect.bottom : pRect->bottom;
+      }
+   }
+
+   return bDirty;
+}
+
+
+/// The state shared by the #mvcModelDirtyTest threads
+static volatile LONG   slDirtyTestGo      = 0;  ///< `0` = wait, `1` = toggle, `2` = stop
+static volatile LONG   slDirtyTestMask    = 0;  ///< The test's own dirty mask (so the display isn't disturbed)
+static volatile LONG64 sl64DirtyTestFlips = 0;  ///< The number of times the tones toggled
+static volatile bool   sbDirtyTestDetected[ NUMBER_OF_DTMF_TONES ];  ///< The test's own detected state
+
+
+/// A #mvcModelDirtyTest worker.  Toggles one tone as fast as it can (much
+/// faster than any real signal) until it's told to stop.
+///
+/// @param Context The tone's index
+/// @return `0`
+static DWORD WINAPI mvcModelDirtyTestWorker( LPVOID Context ) {
+   const size_t toneIndex = (size_t) Context;
+   LONG64       l64Flips  = 0;
+
+   while ( slDirtyTestGo == 0 ) {
+      YieldProcessor();  // Start all of the workers at once
+   }
+
+   while ( slDirtyTestGo == 1 ) {
+      sbDirtyTestDetected[ toneIndex ] = !sbDirtyTestDetected[ toneIndex ];
+      mvcModelMarkDirty( &slDirtyTestMask, 1L << toneIndex );
+      l64Flips++;
+   }
+
+   InterlockedAdd64( &sl64DirtyTestFlips, l64Flips );
+
+   return 0;
+}
+
+
+/// Toggle every tone from its own thread as fast as possible while this
+/// thread plays the part of the UI tick:  Every #VIEW_REFRESH_MS it takes
+/// the mask and counts an update if anything changed.
+///
+/// Logs the toggles, the ticks and the UI updates.  Checks that:
+///   - Every tone that toggled was drawn at least once
+///   - Nothing is left in the mask after the workers stop
+///
+/// It doesn't need a window or an audio device, so it runs with
+/// `/benchmark`.
+///
+/// @return `true` if the test passed.  `false` if there was a problem.
+bool mvcModelDirtyTest() {
+   HANDLE        hWorkers[ NUMBER_OF_DTMF_TONES ];
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER start;
+   LARGE_INTEGER now;
+
+   QueryPerformanceFrequency( &frequency );
+
+   slDirtyTestGo      = 0;
+   slDirtyTestMask    = 0;
+   sl64DirtyTestFlips = 0;
+   ZeroMemory( (void*) sbDirtyTestDetected, sizeof( sbDirtyTestDetected ) );
+
+   for ( size_t i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+      hWorkers[ i ] = CreateThread( NULL, 0, mvcModelDirtyTestWorker, (LPVOID) i, 0, NULL );
+      if ( hWorkers[ i ] == NULL ) {
+         LOG_WARN_R( IDS_MODEL_DIRTY_TEST_FAILED_TO_START );  // "Failed to start a dirty mask test thread.  Continuing."
+         InterlockedExchange( &slDirtyTestGo, 2 );
+         if ( i > 0 ) {
+            WaitForMultipleObjects( (DWORD) i, hWorkers, TRUE, INFINITE );
+         }
+         for ( size_t j = 0 ; j < i ; j++ ) {
+            CloseHandle( hWorkers[ j ] );
+         }
+         return false;
+      }
+   }
+
+   UINT64 u64Ticks   = 0;
+   UINT64 u64Updates = 0;
+   LONG   lDrawn     = 0;  // Every tone the "UI" has seen
+
+   QueryPerformanceCounter( &start );
+   InterlockedExchange( &slDirtyTestGo, 1 );
+
+   /// - Play the part of the UI thread's #IDT_VIEW_REFRESH tick
+   do {
+      Sleep( VIEW_REFRESH_MS );
+
+      const LONG lMask = mvcModelTakeDirty( &slDirtyTestMask );
+      u64Ticks++;
+      if ( lMask != 0 ) {
+         u64Updates++;
+         lDrawn |= lMask;
+      }
+
+      QueryPerformanceCounter( &now );
+   } while ( ( now.QuadPart - start.QuadPart ) * 1000 / frequency.QuadPart < MVC_DIRTY_TEST_MS );
+
+   InterlockedExchange( &slDirtyTestGo, 2 );
+   WaitForMultipleObjects( NUMBER_OF_DTMF_TONES, hWorkers, TRUE, INFINITE );
+
+   for ( size_t i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+      CloseHandle( hWorkers[ i ] );
+   }
+
+   /// - One last tick picks up whatever the workers did before they stopped
+   const LONG lLast = mvcModelTakeDirty( &slDirtyTestMask );
+   u64Ticks++;
+   if ( lLast != 0 ) {
+      u64Updates++;
+      lDrawn |= lLast;
+   }
+
+   const UINT64 u64Flips = (UINT64) sl64DirtyTestFlips;
+   const LONG   lAll     = ( 1L << NUMBER_OF_DTMF_TONES ) - 1;
+
+   LOG_INFO_R( IDS_MODEL_DIRTY_TEST_RESULT,  // "Dirty mask test:  Toggles: %llu   Ticks: %llu   UI updates: %llu   Toggles per update: %.0f"
+      u64Flips, u64Ticks, u64Updates, ( u64Updates > 0 ) ? (double) u64Flips / (double) u64Updates : 0.0 );
+
+   if ( lDrawn != lAll || slDirtyTestMask != 0 ) {
+      LOG_WARN_R( IDS_MODEL_DIRTY_TEST_FAILED, (UINT) lDrawn, u64Updates, u64Ticks );  // "The dirty mask test failed.  Tones drawn: 0x%02x   UI updates: %llu   Ticks: %llu"
+      return false;
+   }
+
+   return true;
+}
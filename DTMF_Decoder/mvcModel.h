@@ -16,7 +16,9 @@
 #pragma once
 
 #include <Windows.h>      // For WCHAR, BYTE, etc.
-#include "mvcView.h"      // For mvcInvalidateRow and mvcInvalidateColumn
+#include "mvcView.h"      // For ROW0, COL0, BOX_HEIGHT, etc.
+#include "perfLatency.h"  // For perfLatencyStamp
+#include "g711.h"         // For g711Law_t
 
 
 /// The number of tones DTMF Decoder processes
@@ -45,9 +47,13 @@ extern BOOL mvcModelRelease();
 ///
 /// #sine, #cosine, #coeff are computed in #goertzel_Start
 ///
-/// #goertzelMagnitude is set in #goertzel_Magnitude
+/// #goertzelMagnitude, #totalEnergy and #energyRatio are set in
+/// #goertzel_MagnitudeEnergy
 ///
 /// #detected is set in #goertzelWorkThread
+///
+/// @internal `goertzel_64.asm` accesses this structure by offset.  Only add
+///           new members to the end of the structure.
 typedef struct {
    int   index;              ///< The index of the tone in the gDtmfTones array
    float frequency;          ///< The DTMF tone's frequency
@@ -57,6 +63,8 @@ typedef struct {
    float sine;               ///< Pre-computed sin offset for the frequency and sample rate
    float cosine;             ///< Pre-computed cosine offset for the frequency and smaple rate
    float coeff;              ///< Pre-computed Goertzel coefficient
+   float totalEnergy;        ///< The mean power of the whole window (computed in the same pass as #goertzelMagnitude)
+   float energyRatio;        ///< The fraction of #totalEnergy that's in this tone
 } dtmfTones_t;
 
 
@@ -164,6 +172,11 @@ __forceinline void pcmEnqueue( _In_ const BYTE data ) {
 }
 
 
+/// Expand a run of G.711 bytes (or copy 8-bit PCM) straight into
+/// #gPcmQueue.  This is #pcmEnqueue for a whole buffer.
+extern void pcmEnqueueG711( _In_ const g711Law_t law, _In_reads_( stSamples ) const BYTE* pSamples, _In_ const size_t stSamples );
+
+
 /// Release memory allocated to #gPcmQueue
 extern void pcmReleaseQueue();
 
@@ -180,106 +193,88 @@ extern DWORD gdwMmcssTaskIndex;
 extern HANDLE ghAudioSamplesReadyEvent;
 
 
-/// Invalidate the column (not the whole screen)
+/// The tones whose #dtmfTones_t.detected changed since the display was last
+/// invalidated.  Bit `n` is `gDtmfTones[ n ]`.
+///
+/// #mvcSnapshotPublish sets bits with #mvcModelMarkDirty after each
+/// analysis for the tones whose state changed.  The UI thread
+/// takes the whole mask with #mvcModelTakeDirty on every #mvcViewRefresh
+/// tick and makes one invalidation for all of them.  So, no matter how
+/// fast the tones toggle, the DSP threads never call into the window manager
+/// and the display is invalidated at most once per tick.
+extern volatile LONG glMvcDirtyMask;
+
+/// The #gi64PerfOrigin of the oldest buffer whose tone changes are waiting in
+/// #glMvcDirtyMask.  `0` if there isn't one.  It travels with the dirty
+/// bits, so the UI thread can time #PERF_STAGE_VIEW_INVALIDATE from the
+/// buffer that changed the tone (not whichever buffer is current).
+extern volatile LONG64 gl64MvcDirtyOrigin;
+
+/// The bit in #glMvcDirtyMask for the meters and the spectrogram.  It's
+/// above the tones' bits.
+#define MVC_DIRTY_HISTORY (1L << NUMBER_OF_DTMF_TONES)
+
+
+/// Mark tones as needing to be redrawn
+///
+/// There's no cheap check before the `InterlockedOr`.  The published
+/// snapshot must be visible before the UI thread can clear the bit -- and
+/// the locked instruction is that fence.  The mask is only touched when a
+/// tone changes state, so it's rare.
 ///
 /// Inlined for performance.
 ///
-/// @param column Index of the column... 0 through 3.
-///
-/// @return `TRUE` if successful.  `FALSE` if there was a problem.
-__forceinline BOOL mvcInvalidateColumn( _In_ const size_t column ) {
-   _ASSERTE( column <= 3 );
-   _ASSERTE( ghMainWindow != NULL );
-
-   /// #### Function
-
-   BOOL br;                    // BOOL result
-   RECT rectToRedraw = { 0 };  // The rectangle to redraw
-
-   rectToRedraw.top = 0;
-   rectToRedraw.bottom = giWindowHeight;
-
-   switch ( column ) {
-      case 0:
-         rectToRedraw.left = COL0 - 16;
-         rectToRedraw.right = COL0 + 71;
-         break;
-      case 1:
-         rectToRedraw.left = COL1 - 16;
-         rectToRedraw.right = COL1 + 71;
-         break;
-      case 2:
-         rectToRedraw.left = COL2 - 16;
-         rectToRedraw.right = COL2 + 71;
-         break;
-      case 3:
-         rectToRedraw.left = COL3 - 16;
-         rectToRedraw.right = COL3 + 71;
-         break;
-   }
+/// @param plMask The dirty mask (normally #glMvcDirtyMask)
+/// @param lTones The tones to mark (bit `n` is `gDtmfTones[ n ]`)
+__forceinline void mvcModelMarkDirty( _Inout_ volatile LONG* plMask, _In_ const LONG lTones ) {
+   _ASSERTE( ( lTones & ~( ( 1L << NUMBER_OF_DTMF_TONES ) - 1 ) ) == 0 );
+
+   InterlockedOr( plMask, lTones );
+}
+
 
-   /// - Based on the column, invalidate the appropriate display region with InvalidateRect
-   br = InvalidateRect( ghMainWindow, &rectToRedraw, FALSE );
-   if ( !br ) {
-      QUEUE_FATAL( IDS_MODEL_FAILED_TO_INVALIDATE_COLUMN, column );  // "Failed to invalidate column %zu"
-      return FALSE;
+/// Take (read and clear) the tones that need to be redrawn
+///
+/// @param plMask The dirty mask (normally #glMvcDirtyMask)
+/// @return The tones that changed since the last take.  `0` if nothing changed.
+__forceinline LONG mvcModelTakeDirty( _Inout_ volatile LONG* plMask ) {
+   if ( *plMask == 0 ) {
+      return 0;  // Don't lock the bus when nothing changed
    }
 
-   return TRUE;
+   return InterlockedExchange( plMask, 0 );
 }
 
 
-/// Invalidate just the row (not the whole screen)
-///
-/// Inlined for performance.
+/// Remember when the buffer whose tone changes are about to be marked in
+/// #glMvcDirtyMask was recorded.  If older changes are still waiting, their
+/// origin is kept.  Call this before #mvcModelMarkDirty, whose
+/// `InterlockedOr` publishes it.
 ///
-/// @param row Index of the row... 0 through 3.
-///
-/// @return `TRUE` if successful.  `FALSE` if there was a problem.
-__forceinline BOOL mvcInvalidateRow( _In_ const size_t row ) {
-   _ASSERTE( row <= 3 );
-   _ASSERTE( ghMainWindow != NULL );
-
-   /// #### Function
-
-   BOOL br;                    // BOOL result
-   RECT rectToRedraw = { 0 };  // The rectangle to redraw
-
-   rectToRedraw.left = 0;
-   rectToRedraw.right = giWindowWidth;
-
-   switch ( row ) {
-      case 0:
-         rectToRedraw.top = ROW0;
-         rectToRedraw.bottom = ROW0 + BOX_HEIGHT;
-         break;
-      case 1:
-         rectToRedraw.top = ROW1;
-         rectToRedraw.bottom = ROW1 + BOX_HEIGHT;
-         break;
-      case 2:
-         rectToRedraw.top = ROW2;
-         rectToRedraw.bottom = ROW2 + BOX_HEIGHT;
-         break;
-      case 3:
-         rectToRedraw.top = ROW3;
-         rectToRedraw.bottom = ROW3 + BOX_HEIGHT;
-         break;
-   }
+/// @param i64Origin The buffer's #gi64PerfOrigin
+__forceinline void mvcModelMarkDirtyOrigin( _In_ const INT64 i64Origin ) {
+   InterlockedCompareExchange64( &gl64MvcDirtyOrigin, i64Origin, 0 );
+}
 
-   /// - Based on the row, invalidate the appropriate display region with InvalidateRect
-   br = InvalidateRect( ghMainWindow, &rectToRedraw, FALSE );
-   if ( !br ) {
-      QUEUE_FATAL( IDS_MODEL_FAILED_TO_INVALIDATE_ROW, row );  // "Failed to invalidate row %zu"
-      return FALSE;
-   }
 
-   return TRUE;
+/// Take (read and clear) #gl64MvcDirtyOrigin.  Call this after
+/// #mvcModelTakeDirty took some tones.
+///
+/// @return The origin of the oldest change that was taken.  `0` if it's not
+///         known.
+__forceinline INT64 mvcModelTakeDirtyOrigin() {
+   return InterlockedExchange64( &gl64MvcDirtyOrigin, 0 );
 }
 
 
-/// Determine if the state of a DTMF tone has changed.  If it has, invalidate
-/// that region of the display.
+extern bool mvcModelDirtyRect( _In_ const LONG lMask, _Out_ RECT* pRect );
+
+extern bool mvcModelDirtyTest();
+
+
+/// Determine if the state of a DTMF tone has changed.  If it has, record it.
+/// The display doesn't see it until the whole analysis is published by
+/// #mvcSnapshotPublish.
 ///
 /// @param toneIndex      Index of the DTMF tone.
 /// @param detectedStatus Based on the Goertzel DFT, is the tone detected
@@ -295,16 +290,6 @@ __forceinline void mvcModelToggleToneDetectedStatus(
    if ( gDtmfTones[ toneIndex ].detected != detectedStatus ) {
       gDtmfTones[ toneIndex ].detected = detectedStatus;
 
-      BOOL br;  // BOOL result
-
-      if ( ( toneIndex & 0b1100 ) == 0 ) {  // If toneIndex is between 0 and 3
-         br = mvcInvalidateRow( toneIndex );
-      } else {
-         br = mvcInvalidateColumn( toneIndex - 4 );  // toneIndex is between 4 and 7,
-      }                                              // which turns into columns 0 through 3
-
-      if ( !br ) {
-         QUEUE_FATAL( IDS_MODEL_FAILED_TO_INVALIDATE_REGION, toneIndex );  // "Goertzel DFT thread %zu   Failed to invalidate region of screen"
-      }
+      perfLatencyStamp( PERF_STAGE_MODEL_TOGGLE );
    }
 }
@@ -0,0 +1,299 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Publish a complete, immutable snapshot of the model to the view with a
+/// lock-free triple buffer
+///
+/// The 8 Goertzel threads write #gDtmfTones at their own pace.  If the view
+/// read them directly, a paint could land in the middle of an analysis and
+/// draw a row from this buffer and a column from the last one -- a key
+/// combination that was never sounding.
+///
+/// So, the capture thread (the only writer) calls #mvcSnapshotPublish after
+/// all 8 DFT threads are done with a buffer.  The UI thread (the only
+/// reader) calls #mvcSnapshotRead once per paint and draws everything from
+/// that one snapshot.  Neither side locks or waits.
+///
+/// #mvcSnapshotPublish also compares the new snapshot with the last one and
+/// marks the tones that changed in #glMvcDirtyMask.  Because it marks them
+/// after the snapshot is published, the paint that follows always sees the
+/// change.
+///
+/// @file    mvcSnapshot.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+
+#include "dtmfCorpus.h"   // For DTMF_CORPUS_KEYS
+#include "mvcModel.h"     // For gDtmfTones and glMvcDirtyMask
+#include "mvcSnapshot.h"  // For yo bad self
+#include "mvcHistory.h"   // For mvcHistoryAppend
+
+
+/// How long #mvcSnapshotTest publishes snapshots (in milliseconds)
+#define MVC_SNAPSHOT_TEST_MS (1000)
+
+
+/// The model's snapshots.  The capture thread writes and the UI thread reads.
+static mvcTripleBuffer_t sTriple = { {}, 1, 0, 2 };
+
+/// The sequence number of the last snapshot published to #sTriple.  Only
+/// the writer touches this.
+static UINT64 su64Sequence = 0;
+
+/// The tones that were detected in the last snapshot published to #sTriple.
+/// Only the writer touches this.
+static LONG slPublished = 0;
+
+
+/// Empty the snapshots.  Neither the capture thread nor the UI thread may be
+/// using them.
+void mvcSnapshotReset() {
+   mvcTripleBufferInit( &sTriple );
+   su64Sequence = 0;
+   slPublished  = 0;
+}
+
+
+/// Decode a key from a snapshot's detected tones:  Exactly one row and
+/// exactly one column must be detected.
+///
+/// @param pSnapshot The snapshot
+/// @return The key from #DTMF_CORPUS_KEYS or `L'\0'` if there isn't one
+static WCHAR mvcSnapshotDecodeKey( _In_ const mvcSnapshot_t* pSnapshot ) {
+   int iRow    = -1;
+   int iColumn = -1;
+
+   for ( int i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+      if ( !pSnapshot->bDetected[ i ] ) {
+         continue;
+      }
+
+      if ( i < 4 ) {
+         if ( iRow != -1 ) {
+            return L'\0';  // More than one row
+         }
+         iRow = i;
+      } else {
+         if ( iColumn != -1 ) {
+            return L'\0';  // More than one column
+         }
+         iColumn = i - 4;
+      }
+   }
+
+   if ( iRow == -1 || iColumn == -1 ) {
+      return L'\0';
+   }
+
+   return DTMF_CORPUS_KEYS[ iRow * 4 + iColumn ];
+}
+
+
+/// Publish #gDtmfTones as the latest snapshot and mark the tones that
+/// changed in #glMvcDirtyMask.  Called by the capture thread after all of
+/// the DFT threads are done with a buffer.
+///
+/// @param u64QPCPosition When the newest frame of the buffer was recorded
+///                       (from `GetBuffer`)
+void mvcSnapshotPublish( _In_ const UINT64 u64QPCPosition ) {
+   mvcSnapshot_t* pSnapshot = mvcTripleBufferBack( &sTriple );
+   LONG           lDetected = 0;
+
+   /// #### Function
+
+   /// - Copy the whole analysis into the back buffer
+   for ( size_t i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+      pSnapshot->fMagnitude[ i ]   = gDtmfTones[ i ].goertzelMagnitude;
+      pSnapshot->fEnergyRatio[ i ] = gDtmfTones[ i ].energyRatio;
+      pSnapshot->bDetected[ i ]    = gDtmfTones[ i ].detected;
+
+      if ( pSnapshot->bDetected[ i ] ) {
+         lDetected |= 1L << i;
+      }
+   }
+
+   pSnapshot->wcDigit        = mvcSnapshotDecodeKey( pSnapshot );
+   pSnapshot->u64QPCPosition = u64QPCPosition;
+   pSnapshot->u64Sequence    = ++su64Sequence;
+
+   /// - Publish it
+   mvcTripleBufferPublish( &sTriple );
+
+   /// - Append its magnitudes to the meters' and spectrogram's history
+   mvcHistoryAppend( pSnapshot->fMagnitude );
+
+   /// - Then, mark the tones that changed so the UI thread redraws them
+   const LONG lChanged = lDetected ^ slPublished;
+   slPublished = lDetected;
+
+   if ( lChanged != 0 ) {
+      mvcModelMarkDirtyOrigin( gi64PerfOrigin );
+      mvcModelMarkDirty( &glMvcDirtyMask, lChanged );
+   }
+}
+
+
+/// Get the latest complete snapshot.  Only the UI thread may call this.
+///
+/// @return The latest snapshot.  It's good until the next call.
+const mvcSnapshot_t* mvcSnapshotRead() {
+   return mvcTripleBufferRead( &sTriple );
+}
+
+
+/// The state shared by the #mvcSnapshotTest threads
+static volatile LONG     slSnapshotTestGo          = 0;  ///< `0` = wait, `1` = publish, `2` = stop
+static volatile LONG64   sl64SnapshotTestPublished = 0;  ///< The number of snapshots the writer published
+static mvcTripleBuffer_t sSnapshotTestTriple;            ///< The test's own triple buffer (so the display isn't disturbed)
+
+
+/// Fill a snapshot so that every member can be checked against its
+/// sequence number
+///
+/// @param pSnapshot   The snapshot to fill
+/// @param u64Sequence The snapshot's sequence number
+static void mvcSnapshotTestFill( _Out_ mvcSnapshot_t* pSnapshot, _In_ const UINT64 u64Sequence ) {
+   for ( size_t i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+      pSnapshot->fMagnitude[ i ]   = (float) ( ( u64Sequence * NUMBER_OF_DTMF_TONES + i ) & 0xFFFFF );  // Exact in a float
+      pSnapshot->fEnergyRatio[ i ] = pSnapshot->fMagnitude[ i ] * 0.5f;
+      pSnapshot->bDetected[ i ]    = ( ( u64Sequence >> i ) & 1 ) != 0;
+   }
+
+   pSnapshot->wcDigit        = DTMF_CORPUS_KEYS[ u64Sequence & 0xF ];
+   pSnapshot->u64QPCPosition = u64Sequence * 3;
+   pSnapshot->u64Sequence    = u64Sequence;
+}
+
+
+/// Check that every member of a snapshot came from the same
+/// #mvcSnapshotTestFill
+///
+/// @param pSnapshot The snapshot to check
+/// @return `true` if the snapshot is whole.  `false` if it's torn.
+static bool mvcSnapshotTestCheck( _In_ const mvcSnapshot_t* pSnapshot ) {
+   mvcSnapshot_t expected;
+
+   if ( pSnapshot->u64Sequence == 0 ) {
+      return pSnapshot->u64QPCPosition == 0 && pSnapshot->wcDigit == L'\0';  // The empty snapshot
+   }
+
+   mvcSnapshotTestFill( &expected, pSnapshot->u64Sequence );
+
+   for ( size_t i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+      if ( pSnapshot->fMagnitude[ i ]   != expected.fMagnitude[ i ]
+        || pSnapshot->fEnergyRatio[ i ] != expected.fEnergyRatio[ i ]
+        || pSnapshot->bDetected[ i ]    != expected.bDetected[ i ] ) {
+         return false;
+      }
+   }
+
+   return pSnapshot->wcDigit == expected.wcDigit && pSnapshot->u64QPCPosition == expected.u64QPCPosition;
+}
+
+
+/// The #mvcSnapshotTest writer.  Publishes snapshots as fast as it can
+/// until it's told to stop.
+///
+/// @param Context Not used
+/// @return `0`
+static DWORD WINAPI mvcSnapshotTestWriter( LPVOID Context ) {
+   UNREFERENCED_PARAMETER( Context );
+
+   UINT64 u64Sequence = 0;
+
+   while ( slSnapshotTestGo == 0 ) {
+      YieldProcessor();  // Start with the reader
+   }
+
+   while ( slSnapshotTestGo == 1 ) {
+      mvcSnapshotTestFill( mvcTripleBufferBack( &sSnapshotTestTriple ), ++u64Sequence );
+      mvcTripleBufferPublish( &sSnapshotTestTriple );
+   }
+
+   InterlockedExchange64( &sl64SnapshotTestPublished, (LONG64) u64Sequence );
+
+   return 0;
+}
+
+
+/// Hammer a triple buffer with a writer thread that publishes as fast as it
+/// can while this thread reads as fast as it can.
+///
+/// Logs the snapshots published, the reads and how many of the reads got a
+/// new snapshot.  Checks that:
+///   - Every snapshot the reader gets is whole (not torn)
+///   - The sequence numbers never go backwards
+///   - After the writer stops, the reader gets the last snapshot it published
+///
+/// It doesn't need a window or an audio device, so it runs with
+/// `/benchmark`.
+///
+/// @return `true` if the test passed.  `false` if there was a problem.
+bool mvcSnapshotTest() {
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER start;
+   LARGE_INTEGER now;
+
+   QueryPerformanceFrequency( &frequency );
+
+   mvcTripleBufferInit( &sSnapshotTestTriple );
+   slSnapshotTestGo          = 0;
+   sl64SnapshotTestPublished = 0;
+
+   HANDLE hWriter = CreateThread( NULL, 0, mvcSnapshotTestWriter, NULL, 0, NULL );
+   if ( hWriter == NULL ) {
+      LOG_WARN_R( IDS_SNAPSHOT_TEST_FAILED_TO_START );  // "Failed to start the snapshot test thread.  Continuing."
+      return false;
+   }
+
+   UINT64 u64Reads     = 0;
+   UINT64 u64Fresh     = 0;
+   UINT64 u64Torn      = 0;
+   UINT64 u64Backwards = 0;
+   UINT64 u64Last      = 0;
+
+   QueryPerformanceCounter( &start );
+   InterlockedExchange( &slSnapshotTestGo, 1 );
+
+   do {
+      for ( int i = 0 ; i < 1000 ; i++ ) {
+         const mvcSnapshot_t* pSnapshot = mvcTripleBufferRead( &sSnapshotTestTriple );
+         u64Reads++;
+
+         if ( !mvcSnapshotTestCheck( pSnapshot ) ) {
+            u64Torn++;
+         }
+         if ( pSnapshot->u64Sequence < u64Last ) {
+            u64Backwards++;
+         } else if ( pSnapshot->u64Sequence > u64Last ) {
+            u64Fresh++;
+            u64Last = pSnapshot->u64Sequence;
+         }
+      }
+
+      QueryPerformanceCounter( &now );
+   } while ( ( now.QuadPart - start.QuadPart ) * 1000 / frequency.QuadPart < MVC_SNAPSHOT_TEST_MS );
+
+   InterlockedExchange( &slSnapshotTestGo, 2 );
+   WaitForSingleObject( hWriter, INFINITE );
+   CloseHandle( hWriter );
+
+   /// - The writer is done, so the next read must get its last snapshot
+   const mvcSnapshot_t* pFinal       = mvcTripleBufferRead( &sSnapshotTestTriple );
+   const UINT64         u64Published = (UINT64) sl64SnapshotTestPublished;
+
+   LOG_INFO_R( IDS_SNAPSHOT_TEST_RESULT,  // "Snapshot test:  Published: %llu   Reads: %llu   New snapshots read: %llu   Torn: %llu   Backwards: %llu"
+      u64Published, u64Reads, u64Fresh, u64Torn, u64Backwards );
+
+   if ( u64Torn != 0 || u64Backwards != 0 || pFinal->u64Sequence != u64Published || !mvcSnapshotTestCheck( pFinal ) ) {
+      LOG_WARN_R( IDS_SNAPSHOT_TEST_FAILED, pFinal->u64Sequence, u64Published );  // "The snapshot test failed.  The last read was snapshot %llu of %llu."
+      return false;
+   }
+
+   return true;
+}
@@ -0,0 +1,112 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Publish a complete, immutable snapshot of the model to the view with a
+/// lock-free triple buffer
+///
+/// @file    mvcSnapshot.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>      // For BOOL, LONG, Interlocked*, etc.
+
+#include "mvcModel.h"     // For NUMBER_OF_DTMF_TONES
+
+
+/// The result of one analysis (all 8 tones of one buffer).  Once it's
+/// published, nobody writes to it until the reader is done with it.
+typedef struct DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) {
+   UINT64 u64Sequence;                          ///< Counts up from `1` with each snapshot (`0` is the empty snapshot)
+   UINT64 u64QPCPosition;                       ///< When the newest frame of the buffer was recorded (in 100ns units)
+   float  fMagnitude[ NUMBER_OF_DTMF_TONES ];   ///< #dtmfTones_t.goertzelMagnitude of each tone
+   float  fEnergyRatio[ NUMBER_OF_DTMF_TONES ]; ///< #dtmfTones_t.energyRatio of each tone
+   bool   bDetected[ NUMBER_OF_DTMF_TONES ];    ///< #dtmfTones_t.detected of each tone
+   WCHAR  wcDigit;                              ///< The key (exactly one row and one column) or `L'\0'`
+} mvcSnapshot_t;
+
+
+/// The index bits of #mvcTripleBuffer_t.lMiddle
+#define MVC_TRIPLE_BUFFER_INDEX (0x3)
+
+/// Set in #mvcTripleBuffer_t.lMiddle when the writer publishes and cleared
+/// when the reader takes it
+#define MVC_TRIPLE_BUFFER_FRESH (0x4)
+
+
+/// A single-writer, single-reader triple buffer.  The writer fills its back
+/// buffer and swaps it with the middle one.  The reader swaps its front
+/// buffer with the middle one if there's something new.  Each swap is one
+/// `InterlockedExchange`, so neither side ever waits for the other and the
+/// reader always gets the latest complete snapshot.
+///
+/// The buffers only move between the sides through #lMiddle, so each of the
+/// three is always owned by exactly one of:  The writer, the reader or the
+/// middle.
+typedef struct {
+   mvcSnapshot_t buffers[ 3 ];  ///< The snapshots
+   volatile LONG lMiddle;       ///< The middle buffer's index and #MVC_TRIPLE_BUFFER_FRESH
+   LONG          lBack;         ///< The writer's buffer.  Only the writer touches this.
+   LONG          lFront;        ///< The reader's buffer.  Only the reader touches this.
+} mvcTripleBuffer_t;
+
+
+/// Start (or restart) a triple buffer.  Every buffer is the empty snapshot.
+/// Neither side may be using it.
+///
+/// @param pTriple The triple buffer
+__forceinline void mvcTripleBufferInit( _Out_ mvcTripleBuffer_t* pTriple ) {
+   ZeroMemory( pTriple->buffers, sizeof( pTriple->buffers ) );
+   pTriple->lMiddle = 1;
+   pTriple->lBack   = 0;
+   pTriple->lFront  = 2;
+}
+
+
+/// Get the writer's back buffer to fill in.  It's not visible to the reader
+/// until #mvcTripleBufferPublish.
+///
+/// @param pTriple The triple buffer
+/// @return The snapshot to write
+__forceinline mvcSnapshot_t* mvcTripleBufferBack( _Inout_ mvcTripleBuffer_t* pTriple ) {
+   return &pTriple->buffers[ pTriple->lBack ];
+}
+
+
+/// Publish the back buffer and take the old middle buffer as the new back
+/// buffer.  The exchange is a full fence, so the snapshot is complete
+/// before the reader can see it.
+///
+/// @param pTriple The triple buffer
+__forceinline void mvcTripleBufferPublish( _Inout_ mvcTripleBuffer_t* pTriple ) {
+   const LONG lOld = InterlockedExchange( &pTriple->lMiddle, pTriple->lBack | MVC_TRIPLE_BUFFER_FRESH );
+
+   pTriple->lBack = lOld & MVC_TRIPLE_BUFFER_INDEX;
+}
+
+
+/// Get the latest complete snapshot.  If nothing was published since the
+/// last read, it's the same snapshot as last time.  The snapshot is good
+/// until the reader's next call.
+///
+/// @param pTriple The triple buffer
+/// @return The latest snapshot
+__forceinline const mvcSnapshot_t* mvcTripleBufferRead( _Inout_ mvcTripleBuffer_t* pTriple ) {
+   if ( pTriple->lMiddle & MVC_TRIPLE_BUFFER_FRESH ) {  // Don't lock the bus when nothing's new
+      const LONG lOld = InterlockedExchange( &pTriple->lMiddle, pTriple->lFront );
+
+      pTriple->lFront = lOld & MVC_TRIPLE_BUFFER_INDEX;
+   }
+
+   return &pTriple->buffers[ pTriple->lFront ];
+}
+
+
+extern void mvcSnapshotReset();
+extern void mvcSnapshotPublish( _In_ const UINT64 u64QPCPosition );
+extern const mvcSnapshot_t* mvcSnapshotRead();
+extern bool mvcSnapshotTest();
@@ -28,6 +28,7 @@
 /// | `ID2D1RenderTarget::EndDraw`                | https://learn.microsoft.com/en-us/windows/win32/api/d2d1/nf-d2d1-id2d1rendertarget-enddraw                                                                                                                  |
 /// | `InvalidateRect`                            | https://learn.microsoft.com/en-us/windows/win32/api/winuser/nf-winuser-invalidaterect                                                                                                                       |
 /// | `IUnknown::Release`                         | https://learn.microsoft.com/en-us/windows/win32/api/unknwn/nf-unknwn-iunknown-release                                                                                                                       |
+/// | `SetTimer`                                  | https://learn.microsoft.com/en-us/windows/win32/api/winuser/nf-winuser-settimer                                                                                                                             |
 /// | `wcslen`                                    | https://en.cppreference.com/w/c/string/wide/wcslen                                                                                                                                                          |
 ///
 /// @file    mvcView.cpp
@@ -40,6 +41,9 @@
 
 #include "mvcView.h"      // For yo bad self
 #include "mvcModel.h"     // For viewing the state of the machine
+#include "mvcSnapshot.h"  // For mvcSnapshotRead
+#include "mvcHistory.h"   // For the meters and the spectrogram
+#include "perfCounters.h" // For timing the paints
 
 #pragma comment(lib, "d2d1")    // Link the Diect2D library (for drawing)
 #pragma comment(lib, "Dwrite")  // Link the DirectWrite library (for fonts and text)
@@ -55,9 +59,32 @@ static IDWriteFactory*        spDWriteFactory     = NULL;  ///< A DirectWrite fa
 static IDWriteTextFormat*     spDigitTextFormat   = NULL;  ///< The font for the digits
 static IDWriteTextFormat*     spLettersTextFormat = NULL;  ///< The font for the letters above the digits (and the `Hz` units)
 static IDWriteTextFormat*     spFreqTextFormat    = NULL;  ///< The font for the frequency
+static ID2D1Bitmap*           spKeypadAtlas       = NULL;  ///< The keypad's keys and labels, pre-rendered in both brushes (see #buildKeypadAtlas)
+static ID2D1Bitmap*           spSpectrogram       = NULL;  ///< The spectrogram.  Column `n` of the pyramid's level is in column `n % MVC_HISTORY_COLUMNS`.
+
+/// With `/paintdirectwrite` on the command line, every paint draws the
+/// keypad with DirectWrite (the way it used to) instead of from
+/// #spKeypadAtlas.  It's there to compare the two paths' paint times.
+static bool sbPaintDirectWrite = false;
+
+
+/// The level of the history pyramid the spectrogram draws.  Each column is
+/// the peak of `2^SPECTROGRAM_LEVEL` analyses (about 40ms), so the
+/// spectrogram covers about 10 seconds.
+#define SPECTROGRAM_LEVEL (2)
+
+static_assert( SPECTROGRAM_WIDTH == MVC_HISTORY_COLUMNS, "The spectrogram draws one pixel per column of history" );
+static_assert( SPECTROGRAM_LEVEL < MVC_HISTORY_LEVELS,   "The spectrogram must draw a level of the pyramid" );
+
+/// The number of columns of #SPECTROGRAM_LEVEL that are in #spSpectrogram
+static UINT64 su64SpectrogramColumns = 0;
+
+/// Scratch for the spectrogram's new columns (`B8G8R8A8` pixels, one row
+/// per tone)
+static UINT32 su32SpectrogramPixels[ NUMBER_OF_DTMF_TONES * MVC_HISTORY_COLUMNS ];
 
 const int giWindowWidth  = COL0 + ( BOX_WIDTH  * 4 ) + ( GAP_WIDTH  * 3 ) + BOX_WIDTH;
-const int giWindowHeight = ROW0 + ( BOX_HEIGHT * 4 ) + ( GAP_HEIGHT * 3 ) + BOX_HEIGHT + 50;  // The title is 25px and the menu is 25px
+const int giWindowHeight = HISTORY_TOP + HISTORY_HEIGHT + ( GAP_HEIGHT * 2 ) + 50;  // The title is 25px and the menu is 25px
 
 /// Holds the location and display data for each key (button) on the keypad
 ///
@@ -95,6 +122,304 @@ static keypad_t keypad[ 16 ] = {
 };
 
 
+/// One pre-rendered cell of #spKeypadAtlas.  The foreground cell is at
+/// (#lAtlasLeft, #lAtlasTop) and the highlighted cell is #ATLAS_BAND_HEIGHT
+/// below it.
+typedef struct {
+   RECT screen;      ///< Where the cell goes in the window
+   LONG lAtlasLeft;  ///< Where the cell is in the atlas
+   LONG lAtlasTop;   ///< Where the cell is in the atlas
+} atlasCell_t;
+
+#define ATLAS_CELL_KEYS    (0)   ///< The index of the first key's cell in #sAtlasCells
+#define ATLAS_CELL_ROWS    (16)  ///< The index of the first row label's cell in #sAtlasCells
+#define ATLAS_CELL_COLUMNS (20)  ///< The index of the first column label's cell in #sAtlasCells
+#define ATLAS_CELL_COUNT   (24)  ///< The number of cells in #sAtlasCells
+
+/// The atlas has 2 bands (foreground, then highlight).  Each band has a row
+/// of keys above a row of labels.
+#define ATLAS_BAND_HEIGHT  ( ( BOX_HEIGHT + 2 ) + ( BOX_HEIGHT + 4 ) )
+
+/// Wide enough for 16 keys or 4 row labels and 4 column labels
+#define ATLAS_WIDTH        ( 16 * ( BOX_WIDTH + 2 ) )
+
+static_assert( 4 * ( COL0 - 12 ) + 4 * ( 16 + 71 ) <= ATLAS_WIDTH, "The labels must fit in the atlas" );
+
+/// The cells of #spKeypadAtlas (laid out by #buildKeypadAtlas)
+static atlasCell_t sAtlasCells[ ATLAS_CELL_COUNT ];
+
+
+/// Blend from #BACKGROUND_COLOR to #HIGHLIGHT_COLOR
+///
+/// @param fScale `0.0` (background) to `1.0` (highlight) (from #mvcHistoryScale)
+/// @return A `B8G8R8A8` pixel
+static UINT32 spectrogramPixel( _In_ const float fScale ) {
+   UINT32 u32Pixel = 0xFF000000;  // Opaque
+
+   for ( int iShift = 0 ; iShift < 24 ; iShift += 8 ) {
+      const float fFrom = (float) ( ( BACKGROUND_COLOR >> iShift ) & 0xFF );
+      const float fTo   = (float) ( ( HIGHLIGHT_COLOR  >> iShift ) & 0xFF );
+
+      u32Pixel |= (UINT32) ( fFrom + ( fTo - fFrom ) * fScale + 0.5f ) << iShift;
+   }
+
+   return u32Pixel;
+}
+
+
+/// Render a frequency label (and its `Hz`) before a row.  Called by
+/// #renderCell.
+///
+/// @param pTarget The render target
+/// @param index   The row to render
+/// @param pBrush  The foreground or highlight brush
+static void renderRowFreq( _In_ ID2D1RenderTarget* pTarget, _In_ const size_t index, _In_ ID2D1SolidColorBrush* pBrush ) {
+   _ASSERTE( pTarget             != NULL );
+   _ASSERTE( pBrush              != NULL );
+   _ASSERTE( spLettersTextFormat != NULL );
+   _ASSERTE( spFreqTextFormat    != NULL );
+
+   const keypad_t* pKey  = &keypad[ ( 4 * index ) + index ];  // The diaganol DTMF digits 1, 5, 9 and D
+   const size_t    iFreq = pKey->row;
+
+   pTarget->DrawText(
+      gDtmfTones[ iFreq ].label,                    // Text to render
+      (UINT32) wcslen( gDtmfTones[ iFreq ].label ), // Text length
+      spFreqTextFormat,                             // Text format
+      D2D1::RectF( (FLOAT) ( COL0 - 78 ), (FLOAT) pKey->y, (FLOAT) ( COL0 - 32 ), (FLOAT) ( pKey->y + BOX_HEIGHT ) ),
+      pBrush                                        // The brush used to draw the text
+   );                                               // No return value for error checking
+
+   pTarget->DrawText(
+      L"Hz", 2,
+      spLettersTextFormat,
+      D2D1::RectF( (FLOAT) ( COL0 - 32 ), (FLOAT) ( pKey->y - 4 ), (FLOAT) ( COL0 - 12 ), (FLOAT) ( pKey->y + BOX_HEIGHT - 4 ) ),
+      pBrush
+   );  // No return value for error checking
+}
+
+
+/// Render a frequency label (and its `Hz`) above a column.  Called by
+/// #renderCell.
+///
+/// @param pTarget The render target
+/// @param index   The column to render
+/// @param pBrush  The foreground or highlight brush
+static void renderColFreq( _In_ ID2D1RenderTarget* pTarget, _In_ const size_t index, _In_ ID2D1SolidColorBrush* pBrush ) {
+   _ASSERTE( pTarget             != NULL );
+   _ASSERTE( pBrush              != NULL );
+   _ASSERTE( spLettersTextFormat != NULL );
+   _ASSERTE( spFreqTextFormat    != NULL );
+
+   const keypad_t* pKey  = &keypad[ ( 4 * index ) + index ];  // The diaganol DTMF digits 1, 5, 9 and D
+   const size_t    iFreq = pKey->column;
+
+   pTarget->DrawText(
+      gDtmfTones[ iFreq ].label,                    // Text to render
+      (UINT32) wcslen( gDtmfTones[ iFreq ].label ), // Text length
+      spFreqTextFormat,                             // Text format
+      D2D1::RectF( (FLOAT) ( pKey->x - 16 ), (FLOAT) ( ROW0 - 48 ), (FLOAT) ( pKey->x + BOX_WIDTH - 16 ), (FLOAT) ROW0 ),
+      pBrush                                        // The brush used to draw the text
+   );                                               // No return value for error checking
+
+   pTarget->DrawText(
+      L"Hz", 2,
+      spLettersTextFormat,
+      D2D1::RectF( (FLOAT) ( pKey->x + 47 ), (FLOAT) ( ROW0 - 36 ), (FLOAT) ( pKey->x + 71 ), (FLOAT) ( ROW0 - 20 ) ),
+      pBrush
+   );  // No return value for error checking
+}
+
+
+/// Render a key on the keypad... the rectangle, digit and letters above the
+/// digit.  Called by #renderCell.
+///
+/// @param pTarget The render target
+/// @param index   The key to render
+/// @param pBrush  The foreground or highlight brush
+static void renderKey( _In_ ID2D1RenderTarget* pTarget, _In_ const size_t index, _In_ ID2D1SolidColorBrush* pBrush ) {
+   _ASSERTE( pTarget             != NULL );
+   _ASSERTE( pBrush              != NULL );
+   _ASSERTE( spDigitTextFormat   != NULL );
+   _ASSERTE( spLettersTextFormat != NULL );
+
+   const keypad_t* pKey = &keypad[ index ];
+
+   /// Draw the box around the key
+   pTarget->DrawRoundedRectangle(
+      D2D1::RoundedRect( D2D1::RectF( (FLOAT) pKey->x, (FLOAT) pKey->y, (FLOAT) ( pKey->x + BOX_WIDTH ), (FLOAT) ( pKey->y + BOX_HEIGHT ) ), 8.0f, 8.0f ),
+      pBrush,     // Brush
+      2.f ) ;     // Stroke width
+      // No return value for error checking
+
+   /// Draw the large digit (label)
+   pTarget->DrawText(
+      pKey->digit,                     // Text to render
+      (UINT32) wcslen( pKey->digit ),  // Text length
+      spDigitTextFormat,               // Text format
+      D2D1::RectF( (FLOAT) pKey->x, (FLOAT) ( pKey->y + 24 ), (FLOAT) ( pKey->x + BOX_WIDTH ), (FLOAT) ( pKey->y + BOX_HEIGHT - 6 ) ),
+      pBrush                           // The brush used to draw the text
+   );                                  // No return value for error checking
+
+   /// Draw the letters above the digit
+   const UINT32 cTextLength = (UINT32) wcslen( pKey->letters );
+
+   if ( cTextLength > 0 ) {
+      pTarget->DrawText(
+         pKey->letters,        // Text to render
+         cTextLength,          // Text length
+         spLettersTextFormat,  // Text format
+         D2D1::RectF( (FLOAT) pKey->x, (FLOAT) ( pKey->y + 6 ), (FLOAT) ( pKey->x + BOX_WIDTH ), (FLOAT) ( pKey->y + 6 + 16 ) ),
+         pBrush                // The brush used to draw the text
+      );                       // No return value for error checking
+   }
+}
+
+
+/// Render one cell of the keypad (a key, a row label or a column label)
+/// where it goes in the window
+///
+/// #buildKeypadAtlas calls this to fill the atlas.  With `/paintdirectwrite`,
+/// #paintKeypadCell calls it on every paint.
+///
+/// @param pTarget The render target
+/// @param iCell   The cell's index in #sAtlasCells
+/// @param pBrush  The foreground or highlight brush
+static void renderCell( _In_ ID2D1RenderTarget* pTarget, _In_ const size_t iCell, _In_ ID2D1SolidColorBrush* pBrush ) {
+   if ( iCell < ATLAS_CELL_ROWS ) {
+      renderKey( pTarget, iCell - ATLAS_CELL_KEYS, pBrush );
+   } else if ( iCell < ATLAS_CELL_COLUMNS ) {
+      renderRowFreq( pTarget, iCell - ATLAS_CELL_ROWS, pBrush );
+   } else {
+      renderColFreq( pTarget, iCell - ATLAS_CELL_COLUMNS, pBrush );
+   }
+}
+
+
+/// Render every cell of the keypad into #spKeypadAtlas -- once with the
+/// foreground brush and once with the highlight brush.  After this, painting
+/// the keypad doesn't lay out any text.
+///
+/// The atlas is transparent, so cells that overlap (like a column's `Hz` and
+/// the next column's label) blend just like the text did when it was drawn
+/// directly.  ClearType needs an opaque background, so the atlas's text is
+/// anti-aliased in grayscale.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+static BOOL buildKeypadAtlas() {
+   HRESULT hr;  // HRESULT result
+
+   _ASSERTE( spRenderTarget    != NULL );
+   _ASSERTE( spBrushForeground != NULL );
+   _ASSERTE( spBrushHighlight  != NULL );
+
+   /// Lay out the cells:  The keys in one row, then the row labels and
+   /// column labels in the row below them
+   LONG lLeft = 0;
+
+   for ( size_t i = 0 ; i < 16 ; i++ ) {
+      atlasCell_t* pCell = &sAtlasCells[ ATLAS_CELL_KEYS + i ];
+
+      pCell->screen = { keypad[ i ].x - 1, keypad[ i ].y - 1, keypad[ i ].x + BOX_WIDTH + 1, keypad[ i ].y + BOX_HEIGHT + 1 };  // The stroke is 2px wide
+      pCell->lAtlasLeft = lLeft;
+      pCell->lAtlasTop  = 0;
+      lLeft += pCell->screen.right - pCell->screen.left;
+   }
+
+   lLeft = 0;
+
+   for ( size_t i = 0 ; i < 4 ; i++ ) {
+      atlasCell_t* pCell = &sAtlasCells[ ATLAS_CELL_ROWS + i ];
+      const LONG   lY    = keypad[ ( 4 * i ) + i ].y;
+
+      pCell->screen = { 0, lY - 4, COL0 - 12, lY + BOX_HEIGHT };  // Long labels spill to the left of COL0 - 78
+      pCell->lAtlasLeft = lLeft;
+      pCell->lAtlasTop  = BOX_HEIGHT + 2;
+      lLeft += pCell->screen.right - pCell->screen.left;
+   }
+
+   for ( size_t i = 0 ; i < 4 ; i++ ) {
+      atlasCell_t* pCell = &sAtlasCells[ ATLAS_CELL_COLUMNS + i ];
+      const LONG   lX    = keypad[ ( 4 * i ) + i ].x;
+
+      pCell->screen = { lX - 16, ROW0 - 48, lX + 71, ROW0 };
+      pCell->lAtlasLeft = lLeft;
+      pCell->lAtlasTop  = BOX_HEIGHT + 2;
+      lLeft += pCell->screen.right - pCell->screen.left;
+   }
+
+   /// Render the cells into an offscreen target that shares resources (like
+   /// the brushes) with #spRenderTarget
+   ID2D1BitmapRenderTarget* pAtlasTarget = NULL;
+
+   hr = spRenderTarget->CreateCompatibleRenderTarget( D2D1::SizeF( (FLOAT) ATLAS_WIDTH, (FLOAT) ( ATLAS_BAND_HEIGHT * 2 ) ), &pAtlasTarget );
+   CHECK_HR_R( IDS_VIEW_FAILED_TO_CREATE_KEYPAD_ATLAS );  // "Failed to create the keypad's bitmap"
+   _ASSERTE( pAtlasTarget != NULL );
+
+   pAtlasTarget->SetTextAntialiasMode( D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE );
+
+   pAtlasTarget->BeginDraw();  // No return value for error checking
+   pAtlasTarget->Clear( D2D1::ColorF( 0, 0.0f ) );  // Transparent
+
+   for ( int iBand = 0 ; iBand < 2 ; iBand++ ) {
+      ID2D1SolidColorBrush* pBrush = ( iBand == 0 ) ? spBrushForeground : spBrushHighlight;
+
+      for ( size_t i = 0 ; i < ATLAS_CELL_COUNT ; i++ ) {
+         const atlasCell_t* pCell = &sAtlasCells[ i ];
+
+         /// Draw each cell where it is on the screen, moved to its place in
+         /// the atlas and clipped to its box
+         pAtlasTarget->SetTransform( D2D1::Matrix3x2F::Translation(
+            (FLOAT) ( pCell->lAtlasLeft - pCell->screen.left ),
+            (FLOAT) ( pCell->lAtlasTop + iBand * ATLAS_BAND_HEIGHT - pCell->screen.top ) ) );
+
+         pAtlasTarget->PushAxisAlignedClip(
+            D2D1::RectF( (FLOAT) pCell->screen.left, (FLOAT) pCell->screen.top, (FLOAT) pCell->screen.right, (FLOAT) pCell->screen.bottom ),
+            D2D1_ANTIALIAS_MODE_ALIASED );
+
+         renderCell( pAtlasTarget, i, pBrush );
+
+         pAtlasTarget->PopAxisAlignedClip();
+      }
+   }
+
+   pAtlasTarget->SetTransform( D2D1::Matrix3x2F::Identity() );
+
+   hr = pAtlasTarget->EndDraw();
+   if ( SUCCEEDED( hr ) ) {
+      _ASSERTE( spKeypadAtlas == NULL );
+      hr = pAtlasTarget->GetBitmap( &spKeypadAtlas );
+   }
+
+   SAFE_RELEASE( pAtlasTarget );  // The atlas keeps its own reference
+
+   CHECK_HR_R( IDS_VIEW_FAILED_TO_CREATE_KEYPAD_ATLAS );  // "Failed to create the keypad's bitmap"
+   _ASSERTE( spKeypadAtlas != NULL );
+
+   return TRUE;
+}
+
+
+/// Look for `/paintdirectwrite` on the command line
+///
+/// @param pwszCmdLine The command line passed to #wWinMain
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL mvcViewParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine ) {
+   sbPaintDirectWrite = false;
+
+   if ( pwszCmdLine == NULL ) {
+      return TRUE;
+   }
+
+   if ( wcsstr( pwszCmdLine, L"/paintdirectwrite" ) != NULL ) {
+      sbPaintDirectWrite = true;
+      LOG_INFO_R( IDS_VIEW_PAINT_DIRECTWRITE );  // "The keypad is painted with DirectWrite on every paint (not from the pre-rendered bitmap)"
+   }
+
+   return TRUE;
+}
+
+
 /// Initialize all of the resources needed to draw the main window
 ///
 /// @return `TRUE` if successful.  `FALSE` if there was a problem.
@@ -234,6 +559,31 @@ BOOL mvcViewInit() {
    CHECK_HR_R( IDS_VIEW_FAILED_TO_CREATE_DIRECT2D_BRUSH );  // "Failed to create Direct2D Brush"
    _ASSERTE( spBrushBackground != NULL );
 
+
+   /// Create the spectrogram's bitmap (filled with the background color)
+   for ( size_t i = 0 ; i < _countof( su32SpectrogramPixels ) ; i++ ) {
+      su32SpectrogramPixels[ i ] = spectrogramPixel( 0.0f );
+   }
+
+   _ASSERTE( spSpectrogram == NULL );
+   hr = spRenderTarget->CreateBitmap(
+      D2D1::SizeU( MVC_HISTORY_COLUMNS, NUMBER_OF_DTMF_TONES ),
+      su32SpectrogramPixels,                    // The initial pixels
+      MVC_HISTORY_COLUMNS * sizeof( UINT32 ),   // The pitch (bytes per row)
+      D2D1::BitmapProperties( D2D1::PixelFormat( DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_IGNORE ) ),
+      &spSpectrogram
+   );
+   CHECK_HR_R( IDS_VIEW_FAILED_TO_CREATE_SPECTROGRAM );  // "Failed to create the spectrogram's bitmap"
+   _ASSERTE( spSpectrogram != NULL );
+
+   su64SpectrogramColumns = 0;
+
+
+   /// Pre-render the keypad
+   if ( !buildKeypadAtlas() ) {
+      return FALSE;  // buildKeypadAtlas has already logged the problem
+   }
+
    return TRUE;
 }
 
@@ -248,6 +598,8 @@ BOOL mvcViewCleanup() {
    SAFE_RELEASE( spBrushForeground );  // SAFE_RELEASE returns a reference
    SAFE_RELEASE( spBrushHighlight );   // count, but not an error code
    SAFE_RELEASE( spBrushBackground );
+   SAFE_RELEASE( spKeypadAtlas );
+   SAFE_RELEASE( spSpectrogram );
    SAFE_RELEASE( spRenderTarget );
    SAFE_RELEASE( spD2DFactory );
 
@@ -311,64 +663,63 @@ static __forceinline BOOL makeFloatRect(
 }
 
 
-/// Paint a frequency label before each row
-///
-/// If a DTMF tone is detected for this frequency, then paint it using the
-/// highlighted font.  Otherwise, use the normal foreground font.
+/// Paint one cell of the keypad.  Normally, it's blitted from
+/// #spKeypadAtlas.  With `/paintdirectwrite`, it's rendered with DirectWrite.
 ///
 /// This function won't update content that's outside pUpdateRect.
 ///
 /// Inlined for performance.
 ///
-/// @param index The row to update
+/// @param iCell       The cell's index in #sAtlasCells
+/// @param bHighlight  `true` to draw the highlighted cell
 /// @param pUpdateRect The rectangle to update (from WM_PAINT)
-static __forceinline void paintRowFreqs( _In_ const size_t index, _In_ const RECT* pUpdateRect ) {
-   _ASSERTE( spRenderTarget      != NULL );
-   _ASSERTE( spBrushHighlight    != NULL );
-   _ASSERTE( spBrushForeground   != NULL );
-   _ASSERTE( spLettersTextFormat != NULL );
-   _ASSERTE( spFreqTextFormat    != NULL );
-   _ASSERTE( pUpdateRect         != NULL );
+static __forceinline void paintKeypadCell( _In_ const size_t iCell, _In_ const bool bHighlight, _In_ const RECT* pUpdateRect ) {
+   _ASSERTE( spRenderTarget != NULL );
+   _ASSERTE( spKeypadAtlas  != NULL );
 
-   keypad_t* pKey  = &keypad[ ( 4 * index ) + index ];  // The diaganol DTMF digits 1, 5, 9 and D
-   size_t    iFreq = pKey->row;
+   const atlasCell_t* pCell = &sAtlasCells[ iCell ];
+   D2D1_RECT_F        drawingRect;
 
-   ID2D1SolidColorBrush* pBrush;
+   if ( !makeFloatRect( &drawingRect, pUpdateRect, pCell->screen.left, pCell->screen.top, pCell->screen.right, pCell->screen.bottom ) ) {
+      return;
+   }
 
-   if ( gDtmfTones[ iFreq ].detected == TRUE ) {
-      pBrush = spBrushHighlight;
-   } else {
-      pBrush = spBrushForeground;
+   if ( sbPaintDirectWrite ) {
+      renderCell( spRenderTarget, iCell, bHighlight ? spBrushHighlight : spBrushForeground );
+      return;
    }
 
-   D2D1_RECT_F freqTextRect;
-   UINT32      cTextLength;
+   const FLOAT fTop = (FLOAT) ( pCell->lAtlasTop + ( bHighlight ? ATLAS_BAND_HEIGHT : 0 ) );
 
-   if ( makeFloatRect( &freqTextRect, pUpdateRect, COL0 - 78, pKey->y, COL0 - 32, pKey->y + BOX_HEIGHT ) ) {
-      // Get text length
-      cTextLength = (UINT32) wcslen( gDtmfTones[ iFreq ].label );
+   spRenderTarget->DrawBitmap(
+      spKeypadAtlas,
+      drawingRect,
+      1.0f,                                            // Opacity
+      D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR, // Pixel for pixel
+      D2D1::RectF( (FLOAT) pCell->lAtlasLeft, fTop, (FLOAT) ( pCell->lAtlasLeft + pCell->screen.right - pCell->screen.left ), fTop + (FLOAT) ( pCell->screen.bottom - pCell->screen.top ) )
+   );  // No return value for error checking
+}
 
-      spRenderTarget->DrawText(
-         gDtmfTones[ iFreq ].label, // Text to render
-         cTextLength,               // Text length
-         spFreqTextFormat,          // Text format
-         freqTextRect,	            // The region of the window where the text will be rendered
-         pBrush                     // The brush used to draw the text
-      );                            // No return value for error checking
-   }
 
-   if ( makeFloatRect( &freqTextRect, pUpdateRect, COL0 - 32, pKey->y - 4, COL0 - 12, pKey->y + BOX_HEIGHT - 4 ) ) {
-      const wchar_t* wszText = L"Hz";		        // String to render
-      cTextLength = (UINT32) wcslen( wszText );	  // Get text length
+/// Paint a frequency label before each row
+///
+/// If a DTMF tone is detected for this frequency, then paint it using the
+/// highlighted font.  Otherwise, use the normal foreground font.
+///
+/// This function won't update content that's outside pUpdateRect.
+///
+/// Inlined for performance.
+///
+/// @param index The row to update
+/// @param pUpdateRect The rectangle to update (from WM_PAINT)
+/// @param pSnapshot   The model to draw (from #mvcSnapshotRead)
+static __forceinline void paintRowFreqs( _In_ const size_t index, _In_ const RECT* pUpdateRect, _In_ const mvcSnapshot_t* pSnapshot ) {
+   _ASSERTE( pUpdateRect != NULL );
+   _ASSERTE( pSnapshot   != NULL );
+
+   const size_t iFreq = keypad[ ( 4 * index ) + index ].row;
 
-      spRenderTarget->DrawText(
-         wszText,              // Text to render
-         cTextLength,          // Text length
-         spLettersTextFormat,  // Text format
-         freqTextRect,	       // The region of the window where the text will be rendered
-         pBrush                // The brush used to draw the text
-      );                       // No return value for error checking
-   }
+   paintKeypadCell( ATLAS_CELL_ROWS + index, pSnapshot->bDetected[ iFreq ], pUpdateRect );
 }
 
 
@@ -383,125 +734,167 @@ static __forceinline void paintRowFreqs( _In_ const size_t index, _In_ const REC
 ///
 /// @param index The column to update
 /// @param pUpdateRect The rectangle to update (from WM_PAINT)
-static __forceinline void paintColFreqs( _In_ const size_t index, _In_ const RECT* pUpdateRect ) {
-   _ASSERTE( spRenderTarget      != NULL );
-   _ASSERTE( spBrushHighlight    != NULL );
-   _ASSERTE( spBrushForeground   != NULL );
-   _ASSERTE( spLettersTextFormat != NULL );
-   _ASSERTE( spFreqTextFormat    != NULL );
-   _ASSERTE( pUpdateRect         != NULL );
+/// @param pSnapshot   The model to draw (from #mvcSnapshotRead)
+static __forceinline void paintColFreqs( _In_ const size_t index, _In_ const RECT* pUpdateRect, _In_ const mvcSnapshot_t* pSnapshot ) {
+   _ASSERTE( pUpdateRect != NULL );
+   _ASSERTE( pSnapshot   != NULL );
 
-   keypad_t* pKey  = &keypad[ ( 4 * index ) + index ];  // The diaganol DTMF digits 1, 5, 9 and D
-   size_t    iFreq = pKey->column;
+   const size_t iFreq = keypad[ ( 4 * index ) + index ].column;
 
-   ID2D1SolidColorBrush* pBrush;
+   paintKeypadCell( ATLAS_CELL_COLUMNS + index, pSnapshot->bDetected[ iFreq ], pUpdateRect );
+}
 
-   if ( gDtmfTones[ iFreq ].detected == TRUE ) {
-      pBrush = spBrushHighlight;
-   } else {
-      pBrush = spBrushForeground;
-   }
 
-   D2D1_RECT_F freqTextRect;
-   UINT32      cTextLength;
+/// Paint each key on the keypad... the rectangle, digit and letters above
+/// the digit.
+///
+/// If a DTMF tone is detected for this combination of frequencies, then paint
+/// it using the highlighted font.  Otherwise, use the normal foreground font.
+///
+/// This function won't update content that's outside pUpdateRect.
+///
+/// Inlined for performance.
+///
+/// @param index The key to repaint
+/// @param pUpdateRect The rectangle to update (from WM_PAINT)
+/// @param pSnapshot   The model to draw (from #mvcSnapshotRead)
+static __forceinline void paintKeys( _In_ const size_t index, _In_ const RECT* pUpdateRect, _In_ const mvcSnapshot_t* pSnapshot ) {
+   _ASSERTE( pUpdateRect != NULL );
+   _ASSERTE( pSnapshot   != NULL );
+
+   const bool bHighlight = pSnapshot->bDetected[ keypad[ index ].row ] && pSnapshot->bDetected[ keypad[ index ].column ];
+
+   paintKeypadCell( ATLAS_CELL_KEYS + index, bHighlight, pUpdateRect );
+}
 
-   if ( makeFloatRect( &freqTextRect, pUpdateRect, pKey->x - 16, ROW0 - 48, pKey->x + BOX_WIDTH - 16, ROW0 ) ) {
-      // Get text length
-      cTextLength = (UINT32) wcslen( gDtmfTones[ iFreq ].label );
 
-      spRenderTarget->DrawText(
-         gDtmfTones[ iFreq ].label, // Text to render
-         cTextLength,               // Text length
-         spFreqTextFormat,          // Text format
-         freqTextRect,	            // The region of the window where the text will be rendered
-         pBrush                     // The brush used to draw the text
-      );                            // No return value for error checking
+/// Paint a bar meter for each tone's latest magnitude (from the snapshot)
+/// with a mark at #GOERTZEL_MAGNITUDE_THRESHOLD.  Detected tones are
+/// highlighted.
+///
+/// This function won't update content that's outside pUpdateRect.
+///
+/// @param pUpdateRect The rectangle to update (from WM_PAINT)
+/// @param pSnapshot   The model to draw (from #mvcSnapshotRead)
+static void paintMeters( _In_ const RECT* pUpdateRect, _In_ const mvcSnapshot_t* pSnapshot ) {
+   _ASSERTE( spRenderTarget    != NULL );
+   _ASSERTE( spBrushHighlight  != NULL );
+   _ASSERTE( spBrushForeground != NULL );
+   _ASSERTE( pUpdateRect       != NULL );
+   _ASSERTE( pSnapshot         != NULL );
+
+   D2D1_RECT_F drawingRect;
+
+   if ( !makeFloatRect( &drawingRect, pUpdateRect, METER_LEFT, HISTORY_TOP, METER_LEFT + METER_WIDTH, HISTORY_TOP + HISTORY_HEIGHT ) ) {
+      return;
    }
 
-   if ( makeFloatRect( &freqTextRect, pUpdateRect, pKey->x + 47, ROW0 - 36, pKey->x + 71, ROW0 - 20 ) ) {
-      const wchar_t* wszText = L"Hz";		        // String to render
-      cTextLength = (UINT32) wcslen( wszText );	  // Get text length
+   for ( size_t i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+      const LONG lTop   = HISTORY_TOP + (LONG) i * HISTORY_ROW_HEIGHT;
+      const LONG lWidth = (LONG) ( mvcHistoryScale( pSnapshot->fMagnitude[ i ] ) * METER_WIDTH );
 
-      spRenderTarget->DrawText(
-         wszText,              // Text to render
-         cTextLength,          // Text length
-         spLettersTextFormat,  // Text format
-         freqTextRect,	       // The region of the window where the text will be rendered
-         pBrush                // The brush used to draw the text
-      );                       // No return value for error checking
+      if ( lWidth > 0 ) {
+         spRenderTarget->FillRectangle(
+            D2D1::RectF( (FLOAT) METER_LEFT, (FLOAT) ( lTop + 2 ), (FLOAT) ( METER_LEFT + lWidth ), (FLOAT) ( lTop + HISTORY_ROW_HEIGHT - 2 ) ),
+            pSnapshot->bDetected[ i ] ? spBrushHighlight : spBrushForeground
+         );  // No return value for error checking
+      }
    }
+
+   /// The threshold is in the middle of the scale
+   const FLOAT fThreshold = (FLOAT) ( METER_LEFT + METER_WIDTH / 2 );
+
+   spRenderTarget->DrawLine(
+      D2D1::Point2F( fThreshold, (FLOAT) HISTORY_TOP ),
+      D2D1::Point2F( fThreshold, (FLOAT) ( HISTORY_TOP + HISTORY_HEIGHT ) ),
+      spBrushForeground
+   );  // No return value for error checking
 }
 
 
-/// The detailed work to paint each key on the keypad... painting the rectangle,
-/// digit and letters above the digit.
+/// Paint the scrolling spectrogram:  One row per tone and one column per
+/// column of #SPECTROGRAM_LEVEL of the history pyramid, newest on the right.
 ///
-/// If a DTMF tone is detected for this combination of frequencies, then paint
-/// it using the highlighted font.  Otherwise, use the normal foreground font.
+/// #spSpectrogram is a ring of columns, so only the columns that are new
+/// since the last paint are copied into it.  Then, it's drawn in 2 pieces
+/// (oldest to the end of the bitmap, then the start of the bitmap to the
+/// newest).
 ///
 /// This function won't update content that's outside pUpdateRect.
 ///
-/// Inlined for performance.
-///
-/// @param index The key to repaint
 /// @param pUpdateRect The rectangle to update (from WM_PAINT)
-static __forceinline void paintKeys( _In_ const size_t index, _In_ const RECT* pUpdateRect ) {
-   _ASSERTE( spRenderTarget      != NULL );
-   _ASSERTE( spBrushHighlight    != NULL );
-   _ASSERTE( spBrushForeground   != NULL );
-   _ASSERTE( spDigitTextFormat   != NULL );
-   _ASSERTE( spLettersTextFormat != NULL );
-   _ASSERTE( pUpdateRect         != NULL );
+static void paintSpectrogram( _In_ const RECT* pUpdateRect ) {
+   _ASSERTE( spRenderTarget != NULL );
+   _ASSERTE( spSpectrogram  != NULL );
+   _ASSERTE( pUpdateRect    != NULL );
 
-   ID2D1SolidColorBrush* pBrush;
+   D2D1_RECT_F drawingRect;
 
-   if ( gDtmfTones[ keypad[ index ].row ].detected == TRUE && gDtmfTones[ keypad[ index ].column ].detected == TRUE ) {
-      pBrush = spBrushHighlight;
-   } else {
-      pBrush = spBrushForeground;
+   if ( !makeFloatRect( &drawingRect, pUpdateRect, SPECTROGRAM_LEFT, HISTORY_TOP, SPECTROGRAM_LEFT + SPECTROGRAM_WIDTH, HISTORY_TOP + HISTORY_HEIGHT ) ) {
+      return;
    }
 
-   D2D1_RECT_F drawingRect;
-   UINT32      cTextLength;
-
-   /// Draw the box around the keypad
-   if ( makeFloatRect( &drawingRect, pUpdateRect, keypad[ index ].x, keypad[ index ].y, keypad[ index ].x + BOX_WIDTH, keypad[ index ].y + BOX_HEIGHT ) ) {
-      spRenderTarget->DrawRoundedRectangle(
-         D2D1::RoundedRect( drawingRect, 8.0f, 8.0f ),  // const D2D1_ROUNDED_RECT
-         pBrush,     // Brush
-         2.f ) ;     // Stroke width
-         // No return value for error checking
-   }
+   const mvcHistoryPyramid_t* pPyramid   = mvcHistoryGetPyramid();
+   const UINT64               u64Columns = pPyramid->u64Columns[ SPECTROGRAM_LEVEL ];
 
+   if ( u64Columns < su64SpectrogramColumns ) {
+      su64SpectrogramColumns = 0;  // The history was reset
+   }
 
-   /// Draw the large digit (label)
-   if ( makeFloatRect( &drawingRect, pUpdateRect, keypad[ index ].x, keypad[ index ].y + 24, keypad[ index ].x + BOX_WIDTH, keypad[ index ].y + BOX_HEIGHT -6 ) ) {
-      // Get text length
-      cTextLength = (UINT32) wcslen( keypad[ index ].digit );
-
-      spRenderTarget->DrawText(
-         keypad[ index ].digit, // Text to render
-         cTextLength,           // Text length
-         spDigitTextFormat,     // Text format
-         drawingRect,	        // The region of the window where the text will be rendered
-         pBrush                 // The brush used to draw the text
-      );                        // No return value for error checking
+   /// Copy the new columns into the bitmap (at most one run to the end of
+   /// the bitmap and one from its start)
+   UINT64 u64From = su64SpectrogramColumns;
+   if ( u64Columns - u64From > MVC_HISTORY_COLUMNS ) {
+      u64From = u64Columns - MVC_HISTORY_COLUMNS;  // Older columns would be overwritten anyway
    }
 
+   while ( u64From < u64Columns ) {
+      const UINT32 u32Left  = (UINT32) ( u64From & ( MVC_HISTORY_COLUMNS - 1 ) );
+      const UINT64 u64Run   = u64Columns - u64From;
+      const UINT32 u32Count = ( u64Run < MVC_HISTORY_COLUMNS - u32Left ) ? (UINT32) u64Run : MVC_HISTORY_COLUMNS - u32Left;
+
+      for ( UINT32 c = 0 ; c < u32Count ; c++ ) {
+         const mvcHistoryEntry_t* pColumn = mvcHistoryPyramidColumn( pPyramid, SPECTROGRAM_LEVEL, u64From + c );
+         _ASSERTE( pColumn != NULL );
+
+         for ( size_t i = 0 ; i < NUMBER_OF_DTMF_TONES ; i++ ) {
+            su32SpectrogramPixels[ i * u32Count + c ] = spectrogramPixel( mvcHistoryScale( pColumn->fMagnitude[ i ] ) );
+         }
+      }
 
-   /// Draw the letters above the digits
-   if ( makeFloatRect( &drawingRect, pUpdateRect, keypad[ index ].x, keypad[ index ].y + 6, keypad[ index ].x + BOX_WIDTH, keypad[ index ].y + 6 + 16 ) ) {
-      cTextLength = (UINT32) wcslen( keypad[ index ].letters );	  // Get text length
+      const D2D1_RECT_U destination = D2D1::RectU( u32Left, 0, u32Left + u32Count, NUMBER_OF_DTMF_TONES );
 
-      if ( cTextLength > 0 ) {
-         spRenderTarget->DrawText(
-            keypad[ index ].letters,  // Text to render
-            cTextLength,              // Text length
-            spLettersTextFormat,      // Text format
-            drawingRect,              // The region of the window where the text will be rendered
-            pBrush                    // The brush used to draw the text
-         );                           // No return value for error checking
+      HRESULT hr = spSpectrogram->CopyFromMemory( &destination, su32SpectrogramPixels, u32Count * sizeof( UINT32 ) );
+      if ( FAILED( hr ) ) {
+         QUEUE_FATAL( IDS_VIEW_FAILED_TO_UPDATE_SPECTROGRAM );  // "Failed to update the spectrogram"
+         return;
       }
+
+      u64From += u32Count;
+   }
+
+   su64SpectrogramColumns = u64Columns;
+
+   /// Draw the oldest column on the left and the newest on the right
+   const UINT32 u32Oldest = (UINT32) ( u64Columns & ( MVC_HISTORY_COLUMNS - 1 ) );
+   const FLOAT  fSplit    = (FLOAT) ( SPECTROGRAM_LEFT + MVC_HISTORY_COLUMNS - u32Oldest );
+
+   spRenderTarget->DrawBitmap(
+      spSpectrogram,
+      D2D1::RectF( (FLOAT) SPECTROGRAM_LEFT, (FLOAT) HISTORY_TOP, fSplit, (FLOAT) ( HISTORY_TOP + HISTORY_HEIGHT ) ),
+      1.0f,                                            // Opacity
+      D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR, // Keep the rows sharp
+      D2D1::RectF( (FLOAT) u32Oldest, 0.0f, (FLOAT) MVC_HISTORY_COLUMNS, (FLOAT) NUMBER_OF_DTMF_TONES )
+   );  // No return value for error checking
+
+   if ( u32Oldest > 0 ) {
+      spRenderTarget->DrawBitmap(
+         spSpectrogram,
+         D2D1::RectF( fSplit, (FLOAT) HISTORY_TOP, (FLOAT) ( SPECTROGRAM_LEFT + SPECTROGRAM_WIDTH ), (FLOAT) ( HISTORY_TOP + HISTORY_HEIGHT ) ),
+         1.0f,
+         D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR,
+         D2D1::RectF( 0.0f, 0.0f, (FLOAT) u32Oldest, (FLOAT) NUMBER_OF_DTMF_TONES )
+      );  // No return value for error checking
    }
 }
 
@@ -520,6 +913,10 @@ BOOL mvcViewPaintWindow( _In_ const RECT* pUpdateRect ) {
 
    // LOG_TRACE_R( IDS_VIEW_UPDATE_REGION, pUpdateRect->left, pUpdateRect->top, pUpdateRect->right, pUpdateRect->bottom );  // "Update region:  (%d, %d) to (%d, %d)"
 
+   LARGE_INTEGER paintStart;
+   LARGE_INTEGER paintEnd;
+   QueryPerformanceCounter( &paintStart );
+
    spRenderTarget->BeginDraw();  // No return value for error checking
 
    /// Paint the background color into the update region.
@@ -537,6 +934,15 @@ BOOL mvcViewPaintWindow( _In_ const RECT* pUpdateRect ) {
       spBrushBackground     // The background brush
    );                       // No return value for error checking
 
+   /// Clip to the update region.  The atlas's cells are blended, so a cell
+   /// that hangs out of the update region must not be drawn over what's
+   /// already there.
+   spRenderTarget->PushAxisAlignedClip( updateRect_F, D2D1_ANTIALIAS_MODE_ALIASED );
+
+   /// Get the latest snapshot of the model with #mvcSnapshotRead.  Draw
+   /// everything from it, so every row, column and key agree with each other.
+   const mvcSnapshot_t* pSnapshot = mvcSnapshotRead();
+
    /// Draw the main window... starting with the column and row labels
    ///
    /// Loops are unrolled for performance.
@@ -545,27 +951,105 @@ BOOL mvcViewPaintWindow( _In_ const RECT* pUpdateRect ) {
    ///           the results of these drawing functions.  None of the methods these
    ///           functions call/use return any error messages, so (right now)
    ///           they return `void`.
-   paintColFreqs( 0, pUpdateRect );
-   paintColFreqs( 1, pUpdateRect );
-   paintColFreqs( 2, pUpdateRect );
-   paintColFreqs( 3, pUpdateRect );
-
-   paintRowFreqs( 0, pUpdateRect );
-   paintRowFreqs( 1, pUpdateRect );
-   paintRowFreqs( 2, pUpdateRect );
-   paintRowFreqs( 3, pUpdateRect );
-
-   paintKeys(  0, pUpdateRect );  paintKeys(  1, pUpdateRect );
-   paintKeys(  2, pUpdateRect );  paintKeys(  3, pUpdateRect );
-   paintKeys(  4, pUpdateRect );  paintKeys(  5, pUpdateRect );
-   paintKeys(  6, pUpdateRect );  paintKeys(  7, pUpdateRect );
-   paintKeys(  8, pUpdateRect );  paintKeys(  9, pUpdateRect );
-   paintKeys( 10, pUpdateRect );  paintKeys( 11, pUpdateRect );
-   paintKeys( 12, pUpdateRect );  paintKeys( 13, pUpdateRect );
-   paintKeys( 14, pUpdateRect );  paintKeys( 15, pUpdateRect );
+   paintColFreqs( 0, pUpdateRect, pSnapshot );
+   paintColFreqs( 1, pUpdateRect, pSnapshot );
+   paintColFreqs( 2, pUpdateRect, pSnapshot );
+   paintColFreqs( 3, pUpdateRect, pSnapshot );
+
+   paintRowFreqs( 0, pUpdateRect, pSnapshot );
+   paintRowFreqs( 1, pUpdateRect, pSnapshot );
+   paintRowFreqs( 2, pUpdateRect, pSnapshot );
+   paintRowFreqs( 3, pUpdateRect, pSnapshot );
+
+   paintKeys(  0, pUpdateRect, pSnapshot );  paintKeys(  1, pUpdateRect, pSnapshot );
+   paintKeys(  2, pUpdateRect, pSnapshot );  paintKeys(  3, pUpdateRect, pSnapshot );
+   paintKeys(  4, pUpdateRect, pSnapshot );  paintKeys(  5, pUpdateRect, pSnapshot );
+   paintKeys(  6, pUpdateRect, pSnapshot );  paintKeys(  7, pUpdateRect, pSnapshot );
+   paintKeys(  8, pUpdateRect, pSnapshot );  paintKeys(  9, pUpdateRect, pSnapshot );
+   paintKeys( 10, pUpdateRect, pSnapshot );  paintKeys( 11, pUpdateRect, pSnapshot );
+   paintKeys( 12, pUpdateRect, pSnapshot );  paintKeys( 13, pUpdateRect, pSnapshot );
+   paintKeys( 14, pUpdateRect, pSnapshot );  paintKeys( 15, pUpdateRect, pSnapshot );
+
+   paintMeters( pUpdateRect, pSnapshot );
+   paintSpectrogram( pUpdateRect );
+
+   spRenderTarget->PopAxisAlignedClip();
 
    hr = spRenderTarget->EndDraw();
    CHECK_HR_Q( IDS_VIEW_FAILED_TO_END_DRAW, 0 );  // "Failed to end drawing operations on render target"
 
+   /// Count the paint and its time in the performance counters
+   QueryPerformanceCounter( &paintEnd );
+   perfCountersAdd( PERF_COUNTER_PAINTS, 1 );
+   perfCountersAdd( PERF_COUNTER_PAINT_TICKS, (UINT64) ( paintEnd.QuadPart - paintStart.QuadPart ) );
+   perfCountersMax( PERF_MAX_PAINT_TICKS, (UINT64) ( paintEnd.QuadPart - paintStart.QuadPart ) );
+
+   return TRUE;
+}
+
+
+/// Start the UI tick that redraws the tones the Goertzel threads changed.
+/// The timer sends `WM_TIMER` with #IDT_VIEW_REFRESH to the window every
+/// #VIEW_REFRESH_MS.
+///
+/// @param hWnd The main window
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL mvcViewStartRefresh( _In_ const HWND hWnd ) {
+   _ASSERTE( hWnd != NULL );
+
+   if ( SetTimer( hWnd, IDT_VIEW_REFRESH, VIEW_REFRESH_MS, NULL ) == 0 ) {
+      LOG_FATAL_R( IDS_VIEW_FAILED_TO_SET_REFRESH_TIMER );  // "Failed to set the display's refresh timer.  Exiting."
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/// The UI tick.  Take every tone that changed since the last tick from
+/// #glMvcDirtyMask, drain the new analyses into the history and invalidate
+/// one rectangle that covers all of them.
+///
+/// This runs on the UI thread, so the Goertzel threads never call into the
+/// window manager.  However fast the tones toggle, the display is
+/// invalidated at most once per tick.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL mvcViewRefresh() {
+   _ASSERTE( ghMainWindow != NULL );
+
+   /// #### Function
+
+   LONG  lMask     = mvcModelTakeDirty( &glMvcDirtyMask );
+   INT64 i64Origin = 0;
+
+   /// - Take the origin that came with the tones' dirty bits (for the
+   ///   latency of #PERF_STAGE_VIEW_INVALIDATE)
+   if ( lMask != 0 ) {
+      i64Origin = mvcModelTakeDirtyOrigin();
+   }
+
+   /// - Move the new analyses into the history, so the meters and the
+   ///   spectrogram move
+   if ( mvcHistoryDrain() > 0 ) {
+      lMask |= MVC_DIRTY_HISTORY;
+   }
+
+   RECT rectToRedraw;
+   if ( !mvcModelDirtyRect( lMask, &rectToRedraw ) ) {
+      return TRUE;  // Nothing changed
+   }
+
+   /// - Invalidate the rows and columns with one call to `InvalidateRect`
+   BOOL br = InvalidateRect( ghMainWindow, &rectToRedraw, FALSE );
+   if ( !br ) {
+      QUEUE_FATAL( IDS_VIEW_FAILED_TO_INVALIDATE, (UINT) lMask );  // "Failed to invalidate the display (tones 0x%02x)"
+      return FALSE;
+   }
+
+   if ( lMask & ~MVC_DIRTY_HISTORY ) {
+      perfLatencyStampSince( PERF_STAGE_VIEW_INVALIDATE, i64Origin );  // A tone changed
+   }
+
    return TRUE;
 }
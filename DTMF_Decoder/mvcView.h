@@ -19,9 +19,22 @@
 #define HIGHLIGHT_COLOR   (0x75F0FF)   /**< A bright, light blue - courtesey of <a href="https://apps.apple.com/us/app/blue-box/id391832739">BlueBox</a> */
 #define BACKGROUND_COLOR  (0x181737)   /**< A dark blue - courtesey of <a href="https://apps.apple.com/us/app/blue-box/id391832739">BlueBox</a>          */
 
+extern BOOL mvcViewParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine );
 extern BOOL mvcViewInit();
 extern BOOL mvcViewCleanup();
 extern BOOL mvcViewPaintWindow(  _In_ const RECT*  pUpdateRect );
+extern BOOL mvcViewStartRefresh( _In_ const HWND hWnd );
+extern BOOL mvcViewRefresh();
+
+
+/// The timer for the UI tick that turns #glMvcDirtyMask into an
+/// invalidation.  It must be different from #IDT_PERF_COUNTERS.
+#define IDT_VIEW_REFRESH (2)
+
+/// How often the UI tick runs (in milliseconds).  This caps the display at
+/// about 60 frames per second (Windows rounds it up to the system timer's
+/// resolution).
+#define VIEW_REFRESH_MS  (16)
 
 extern const int giWindowWidth;   ///< The overall width of the main window,
                                   ///< computed based on button size and spacing
@@ -44,3 +57,13 @@ extern const int giWindowHeight;  ///< The overall height of the main window
 #define COL1 (COL0 + BOX_WIDTH + GAP_WIDTH)      /**< X-axis distance from the left for the 2nd column */
 #define COL2 (COL1 + BOX_WIDTH + GAP_WIDTH)      /**< X-axis distance from the left for the 3rd column */
 #define COL3 (COL2 + BOX_WIDTH + GAP_WIDTH)      /**< X-axis distance from the left for the 4th column */
+
+#define HISTORY_TOP        (ROW3 + BOX_HEIGHT + GAP_HEIGHT * 2)  /**< Y-axis distance from the top for the meters and the spectrogram */
+#define HISTORY_ROW_HEIGHT (12)                                  /**< Height of each tone's meter and spectrogram row               */
+#define HISTORY_HEIGHT     (HISTORY_ROW_HEIGHT * 8)              /**< Height of the meters and the spectrogram (one row per tone)   */
+
+#define SPECTROGRAM_WIDTH  (256)                                 /**< Width of the spectrogram (one pixel per column of history)    */
+#define SPECTROGRAM_LEFT   (COL3 + BOX_WIDTH - SPECTROGRAM_WIDTH) /**< X-axis distance from the left for the spectrogram            */
+
+#define METER_LEFT         (COL0 - 78)                           /**< X-axis distance from the left for the meters (under the row labels) */
+#define METER_WIDTH        (SPECTROGRAM_LEFT - GAP_WIDTH - METER_LEFT)  /**< Width of the meters (full scale)                  */
@@ -0,0 +1,490 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// NUMA placement for the decoding service's streams and workers
+///
+/// On a multi-socket server, memory on the other socket's node costs a trip
+/// over the interconnect.  The service's streams are each decoded by one
+/// worker at a time, so their state (the #goertzelContext_t with its window
+/// and coefficients) should live on the node of the worker that decodes
+/// them.  The placement layer:
+///
+///   - Finds the nodes that have CPUs in this process' affinity mask
+///     (#numaPlaceInit)
+///   - Deals the workers round-robin over the nodes (#numaPlaceWorkerNode)
+///     and pins each one to its node's CPUs (#numaPlacePin).  A worker can
+///     float between the CPUs of its node.
+///   - Allocates a node's streams with `VirtualAllocExNuma` and touches every
+///     page from a thread pinned to the node (#numaPlaceAlloc), so the pages
+///     are on the node whether or not Windows honors the preferred node
+///
+/// dtmfService.cpp gives each node its own stream pool and completion port
+/// and hands each new connection to the node with the fewest active
+/// streams.  dtmfShm.cpp gives each decoder thread its own slab of streams
+/// on the thread's node.
+///
+/// Placement is on by default.  `/nonuma` turns it off:  One pool, one port
+/// and nothing pinned, like a single-node machine.
+///
+/// #numaPlaceTest decodes streams on workers pinned to every node, first with
+/// every stream allocated by the main thread (no placement), then with each
+/// worker's streams on its own node.  It logs the throughput and how much
+/// of the traffic crossed nodes.  It runs with `/benchmark`.
+///
+/// ### APIs Used
+/// | API                           | Link                                                                                                      |
+/// |-------------------------------|-----------------------------------------------------------------------------------------------------------|
+/// | `GetNumaHighestNodeNumber`    | https://learn.microsoft.com/en-us/windows/win32/api/systemtopologyapi/nf-systemtopologyapi-getnumahighestnodenumber |
+/// | `GetNumaNodeProcessorMaskEx`  | https://learn.microsoft.com/en-us/windows/win32/api/systemtopologyapi/nf-systemtopologyapi-getnumanodeprocessormaskex |
+/// | `GetThreadGroupAffinity`      | https://learn.microsoft.com/en-us/windows/win32/api/processtopologyapi/nf-processtopologyapi-getthreadgroupaffinity |
+/// | `VirtualAllocExNuma`          | https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-virtualallocexnuma             |
+/// | `QueryWorkingSetEx`           | https://learn.microsoft.com/en-us/windows/win32/api/psapi/nf-psapi-queryworkingsetex                      |
+///
+/// @file    numaPlace.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <psapi.h>        // For QueryWorkingSetEx
+#include <wchar.h>        // For wcsstr
+
+#include "audio.h"        // For PCM_8_BIT_SILENCE
+#include "mvcModel.h"     // For dtmfTones_t
+#include "goertzel.h"     // For goertzelContext_t
+#include "numaPlace.h"    // For yo bad self
+
+
+/// The streams each #numaPlaceTest worker decodes
+#define NUMA_PLACE_TEST_STREAMS (64)
+
+/// How long each pass of #numaPlaceTest runs (in milliseconds)
+#define NUMA_PLACE_TEST_MS      (2000)
+
+/// The most #numaPlaceTest workers (one per CPU)
+#define NUMA_PLACE_TEST_WORKERS (64)
+
+
+/// A NUMA node with CPUs in this process' processor group
+typedef struct {
+   USHORT    usNode;  ///< The node's number
+   DWORD_PTR dwpMask; ///< The node's CPUs that are in this process' affinity mask
+   size_t    stCpus;  ///< The number of CPUs in #dwpMask
+} numaPlaceNode_t;
+
+
+static bool            sbEnabled = true;  ///< `false` with `/nonuma`
+static numaPlaceNode_t sNodes[ NUMA_PLACE_MAX_NODES ];  ///< The nodes #numaPlaceInit found
+static size_t          sstNodes = 0;      ///< The number of nodes in #sNodes
+static size_t          sstPageSize = 4096;  ///< The size of a page
+
+
+/// Look for `/nonuma` on the command line
+///
+/// @param pwszCmdLine The command line passed to #wWinMain
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL numaPlaceParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine ) {
+   sbEnabled = true;
+
+   if ( pwszCmdLine != NULL && wcsstr( pwszCmdLine, L"/nonuma" ) != NULL ) {
+      sbEnabled = false;
+      LOG_INFO_R( IDS_NUMA_PLACE_DISABLED );  // "NUMA placement is off"
+   }
+
+   return TRUE;
+}
+
+
+/// Find the NUMA nodes that have CPUs in this process' affinity mask.  If
+/// Windows can't say, everything is on one node.
+///
+/// The nodes are found even with `/nonuma`, so #numaPlaceTest can compare.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL numaPlaceInit() {
+   SYSTEM_INFO systemInfo;
+   GetSystemInfo( &systemInfo );
+   sstPageSize = systemInfo.dwPageSize;
+
+   sstNodes = 0;
+
+   DWORD_PTR dwpProcessMask = 0;
+   DWORD_PTR dwpSystemMask  = 0;
+
+   if ( !GetProcessAffinityMask( GetCurrentProcess(), &dwpProcessMask, &dwpSystemMask ) ) {
+      RETURN_FATAL( IDS_NUMA_PLACE_FAILED_TO_FIND_NODES, GetLastError() );  // "Failed to find the NUMA nodes (error %lu).  Exiting."
+   }
+
+   /// - Affinity masks only cover the thread's processor group, so only the
+   ///   nodes in it count
+   GROUP_AFFINITY threadAffinity;
+   ULONG          ulHighest = 0;
+
+   if ( GetThreadGroupAffinity( GetCurrentThread(), &threadAffinity ) && GetNumaHighestNodeNumber( &ulHighest ) ) {
+      for ( ULONG ul = 0 ; ul <= ulHighest && sstNodes < NUMA_PLACE_MAX_NODES ; ul++ ) {
+         GROUP_AFFINITY nodeAffinity;
+
+         if ( !GetNumaNodeProcessorMaskEx( (USHORT) ul, &nodeAffinity ) || nodeAffinity.Group != threadAffinity.Group ) {
+            continue;
+         }
+
+         const DWORD_PTR dwpMask = (DWORD_PTR) nodeAffinity.Mask & dwpProcessMask;
+         if ( dwpMask == 0 ) {
+            continue;  // A node with memory and no CPUs (or none we can use)
+         }
+
+         sNodes[ sstNodes ].usNode  = (USHORT) ul;
+         sNodes[ sstNodes ].dwpMask = dwpMask;
+         sNodes[ sstNodes ].stCpus  = 0;
+         for ( DWORD_PTR dwp = dwpMask ; dwp != 0 ; dwp &= dwp - 1 ) {
+            sNodes[ sstNodes ].stCpus++;
+         }
+         sstNodes++;
+      }
+   }
+
+   /// - If there's no topology, everything is on node 0
+   if ( sstNodes == 0 ) {
+      sNodes[ 0 ].usNode  = 0;
+      sNodes[ 0 ].dwpMask = dwpProcessMask;
+      sNodes[ 0 ].stCpus  = systemInfo.dwNumberOfProcessors;
+      sstNodes = 1;
+   }
+
+   if ( sbEnabled && sstNodes > 1 ) {
+      LOG_INFO_R( IDS_NUMA_PLACE_NODES, sstNodes );  // "Placing the service's streams and workers on %zu NUMA nodes"
+   }
+
+   return TRUE;
+}
+
+
+/// @return The number of nodes the streams and workers are spread over.
+///         `1` with `/nonuma` or on a single-node machine.
+size_t numaPlaceNodes() {
+   return sbEnabled ? sstNodes : 1;
+}
+
+
+/// @param stWorker A worker's number
+/// @return The node the worker belongs to.  Workers are dealt round-robin
+///         over the nodes.
+size_t numaPlaceWorkerNode( _In_ const size_t stWorker ) {
+   return stWorker % numaPlaceNodes();
+}
+
+
+/// Pin the calling thread to a node's CPUs
+///
+/// @param stNode   The node (`0` to #numaPlaceNodes `- 1`)
+/// @param bPlace   `false` to leave the thread alone
+/// @return The thread's old affinity, or `0` if it wasn't pinned
+static DWORD_PTR numaPlacePinTo( _In_ const size_t stNode, _In_ const bool bPlace ) {
+   _ASSERTE( stNode < sstNodes );
+
+   if ( !bPlace ) {
+      return 0;
+   }
+
+   const DWORD_PTR dwpOld = SetThreadAffinityMask( GetCurrentThread(), sNodes[ stNode ].dwpMask );
+   if ( dwpOld == 0 ) {
+      LOG_WARN_R( IDS_NUMA_PLACE_FAILED_TO_PIN, (UINT32) sNodes[ stNode ].usNode, GetLastError() );  // "Failed to pin a thread to NUMA node %u (error %lu).  Continuing."
+   }
+
+   return dwpOld;
+}
+
+
+/// Pin the calling thread to a node's CPUs.  It can still move between the
+/// CPUs of the node.  With `/nonuma` or on a single-node machine, nothing
+/// is pinned.
+///
+/// @param stNode The node (`0` to #numaPlaceNodes `- 1`)
+/// @return The thread's old affinity (to give back to
+///         `SetThreadAffinityMask`), or `0` if it wasn't pinned
+DWORD_PTR numaPlacePin( _In_ const size_t stNode ) {
+   return numaPlacePinTo( stNode, sbEnabled && sstNodes > 1 );
+}
+
+
+/// Allocate memory on a node
+///
+/// @param stNode  The node (`0` to #sstNodes `- 1`)
+/// @param stBytes The size of the memory
+/// @param bPlace  `false` to allocate and touch the memory from the calling
+///                thread, wherever it is
+/// @return The zeroed memory or `NULL` if it couldn't be allocated.  Free it
+///         with #numaPlaceFree.
+static void* numaPlaceAllocOn( _In_ const size_t stNode, _In_ const size_t stBytes, _In_ const bool bPlace ) {
+   _ASSERTE( stNode < sstNodes );
+
+   BYTE* pMemory = NULL;
+
+   /// - Prefer the node's memory.  If it's out, take any node's memory.
+   if ( bPlace ) {
+      pMemory = (BYTE*) VirtualAllocExNuma( GetCurrentProcess(), NULL, stBytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE, sNodes[ stNode ].usNode );
+      if ( pMemory == NULL ) {
+         LOG_WARN_R( IDS_NUMA_PLACE_FAILED_TO_ALLOCATE, stBytes, (UINT32) sNodes[ stNode ].usNode, GetLastError() );  // "Failed to allocate %zu bytes on NUMA node %u (error %lu).  Continuing without placement."
+      }
+   }
+
+   if ( pMemory == NULL ) {
+      pMemory = (BYTE*) VirtualAlloc( NULL, stBytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE );
+      if ( pMemory == NULL ) {
+         return NULL;
+      }
+   }
+
+   /// - First touch:  Fault every page in from a CPU on the node.  The pages
+   ///   are already zero, so writing `0` doesn't change them.
+   const DWORD_PTR dwpOld = numaPlacePinTo( stNode, bPlace );
+
+   for ( size_t i = 0 ; i < stBytes ; i += sstPageSize ) {
+      ( (volatile BYTE*) pMemory )[ i ] = 0;
+   }
+
+   if ( dwpOld != 0 ) {
+      SetThreadAffinityMask( GetCurrentThread(), dwpOld );
+   }
+
+   return pMemory;
+}
+
+
+/// Allocate a node's streams.  The memory comes from the node and every page
+/// is touched from one of the node's CPUs, so it's placed before a worker
+/// ever sees it.  With `/nonuma`, it's a plain `VirtualAlloc`.
+///
+/// @param stNode  The node (`0` to #numaPlaceNodes `- 1`)
+/// @param stBytes The size of the memory
+/// @return The zeroed memory or `NULL` if it couldn't be allocated.  Free it
+///         with #numaPlaceFree.
+void* numaPlaceAlloc( _In_ const size_t stNode, _In_ const size_t stBytes ) {
+   return numaPlaceAllocOn( stNode, stBytes, sbEnabled && sstNodes > 1 );
+}
+
+
+/// Free memory from #numaPlaceAlloc
+///
+/// @param pMemory The memory (or `NULL`)
+void numaPlaceFree( _In_opt_ void* pMemory ) {
+   if ( pMemory != NULL ) {
+      VirtualFree( pMemory, 0, MEM_RELEASE );
+   }
+}
+
+
+/// A #numaPlaceTest stream:  An 8kHz decoder and its window
+typedef struct {
+   goertzelContext_t context;                            ///< The decoder
+   BYTE              window[ GOERTZEL_CONTEXT_WINDOW( 8000 ) ];  ///< Its window
+} numaPlaceTestStream_t;
+
+
+/// The state shared by the #numaPlaceTest threads
+static volatile LONG          slTestGo = 0;   ///< `0` = wait, `1` = run, `2` = stop
+static numaPlaceTestStream_t* spTestStreams[ NUMA_PLACE_TEST_WORKERS ] = { NULL };  ///< Each worker's streams
+static UINT64             su64TestAnalyses[ NUMA_PLACE_TEST_WORKERS ];         ///< Each worker's analyses (written when it ends)
+static BYTE               sTestHop[ 80 ];  ///< 10ms of samples at 8kHz
+
+
+/// A #numaPlaceTest worker.  Pinned to its node, it writes a hop to each of
+/// its streams and analyzes it, over and over, until it's told to stop.
+///
+/// @param pParam The worker's number
+/// @return `0`
+static DWORD WINAPI numaPlaceTestWorker( _In_ LPVOID pParam ) {
+   const size_t stWorker = (size_t) (UINT_PTR) pParam;
+
+   const DWORD_PTR dwpOld = numaPlacePinTo( stWorker % sstNodes, true );
+
+   numaPlaceTestStream_t* pStreams    = spTestStreams[ stWorker ];
+   UINT64                 u64Analyses = 0;
+
+   while ( slTestGo == 0 ) {
+      YieldProcessor();
+   }
+
+   while ( slTestGo == 1 ) {
+      for ( size_t i = 0 ; i < NUMA_PLACE_TEST_STREAMS ; i++ ) {
+         goertzelContextWrite( &pStreams[ i ].context, G711_LINEAR, sTestHop, sizeof( sTestHop ) );
+         goertzelContextAnalyze( &pStreams[ i ].context );
+      }
+      u64Analyses += NUMA_PLACE_TEST_STREAMS;
+   }
+
+   su64TestAnalyses[ stWorker ] = u64Analyses;
+
+   if ( dwpOld != 0 ) {
+      SetThreadAffinityMask( GetCurrentThread(), dwpOld );
+   }
+
+   return 0;
+}
+
+
+/// Find the fraction of a worker's stream pages that are on another node
+///
+/// @param stWorker The worker
+/// @return The fraction of its pages (that are in the working set) that
+///         aren't on its node
+static double numaPlaceTestRemote( _In_ const size_t stWorker ) {
+   const BYTE*  pMemory = (const BYTE*) spTestStreams[ stWorker ];
+   const size_t stBytes = NUMA_PLACE_TEST_STREAMS * sizeof( numaPlaceTestStream_t );
+   const USHORT usNode  = sNodes[ stWorker % sstNodes ].usNode;
+
+   size_t stPages  = 0;
+   size_t stRemote = 0;
+
+   for ( size_t i = 0 ; i < stBytes ; i += sstPageSize ) {
+      PSAPI_WORKING_SET_EX_INFORMATION info;
+      info.VirtualAddress = (PVOID) ( pMemory + i );
+
+      if ( !QueryWorkingSetEx( GetCurrentProcess(), &info, sizeof( info ) ) || !info.VirtualAttributes.Valid ) {
+         continue;  // Not resident, so it's not anywhere
+      }
+
+      stPages++;
+      if ( info.VirtualAttributes.Node != usNode ) {
+         stRemote++;
+      }
+   }
+
+   return ( stPages > 0 ) ? (double) stRemote / (double) stPages : 0.0;
+}
+
+
+/// Run one pass of #numaPlaceTest and log it
+///
+/// @param bPlace    `true` to put each worker's streams on its node
+/// @param stWorkers The number of workers
+/// @param pdRemote  The fraction of the stream pages that were on another
+///                  node
+/// @return `true` if the pass ran.  `false` if there was a problem.
+static bool numaPlaceTestPass( _In_ const bool bPlace, _In_ const size_t stWorkers, _Out_ double* pdRemote ) {
+   HANDLE hThreads[ NUMA_PLACE_TEST_WORKERS ] = { NULL };
+   bool   bStarted = true;
+
+   *pdRemote = 0.0;
+   slTestGo  = 0;
+
+   /// - Allocate each worker's streams.  Without placement, the main thread
+   ///   allocates and touches them all (like the service did), so they land
+   ///   on its node.
+   for ( size_t i = 0 ; i < stWorkers && bStarted ; i++ ) {
+      su64TestAnalyses[ i ] = 0;
+      spTestStreams[ i ] = (numaPlaceTestStream_t*) numaPlaceAllocOn( i % sstNodes, NUMA_PLACE_TEST_STREAMS * sizeof( numaPlaceTestStream_t ), bPlace );
+      bStarted = spTestStreams[ i ] != NULL;
+
+      for ( size_t j = 0 ; j < NUMA_PLACE_TEST_STREAMS && bStarted ; j++ ) {
+         bStarted = goertzelContextInit( &spTestStreams[ i ][ j ].context, 8000, spTestStreams[ i ][ j ].window ) != FALSE;
+      }
+   }
+
+   for ( size_t i = 0 ; i < stWorkers && bStarted ; i++ ) {
+      hThreads[ i ] = CreateThread( NULL, 0, numaPlaceTestWorker, (LPVOID) (UINT_PTR) i, 0, NULL );
+      bStarted = hThreads[ i ] != NULL;
+   }
+
+   if ( bStarted ) {
+      InterlockedExchange( &slTestGo, 1 );
+      Sleep( NUMA_PLACE_TEST_MS );
+   } else {
+      LOG_WARN_R( IDS_NUMA_PLACE_TEST_FAILED_TO_START );  // "Failed to start the NUMA placement test.  Continuing."
+   }
+
+   InterlockedExchange( &slTestGo, 2 );
+
+   for ( size_t i = 0 ; i < stWorkers ; i++ ) {
+      if ( hThreads[ i ] != NULL ) {
+         WaitForSingleObject( hThreads[ i ], INFINITE );
+         CloseHandle( hThreads[ i ] );
+      }
+   }
+
+   /// - Add up the analyses and estimate the traffic that crossed nodes:
+   ///   Every analysis reads its stream's window and coefficients, so a
+   ///   worker moves `sizeof( numaPlaceTestStream_t )` per analysis and the
+   ///   remote part of that is the part of its pages on another node.
+   UINT64 u64Analyses   = 0;
+   double dRemoteBytes  = 0.0;
+   double dRemotePages  = 0.0;
+
+   for ( size_t i = 0 ; i < stWorkers ; i++ ) {
+      if ( spTestStreams[ i ] == NULL ) {
+         continue;
+      }
+
+      const double dRemote = numaPlaceTestRemote( i );
+
+      u64Analyses  += su64TestAnalyses[ i ];
+      dRemoteBytes += (double) su64TestAnalyses[ i ] * (double) sizeof( numaPlaceTestStream_t ) * dRemote;
+      dRemotePages += dRemote;
+
+      numaPlaceFree( spTestStreams[ i ] );
+      spTestStreams[ i ] = NULL;
+   }
+
+   if ( !bStarted || u64Analyses == 0 ) {
+      return false;
+   }
+
+   *pdRemote = dRemotePages / (double) stWorkers;
+
+   const double dSeconds = NUMA_PLACE_TEST_MS / 1000.0;
+
+   LOG_INFO_R( IDS_NUMA_PLACE_TEST_RESULT,  // "NUMA test (%s):  Nodes: %zu   Workers: %zu   Streams: %zu   Analyses/s: %.0f   Remote pages: %.1f%%   Cross-node: %.1f MB/s"
+      bPlace ? L"placement" : L"no placement",
+      sstNodes,
+      stWorkers,
+      stWorkers * NUMA_PLACE_TEST_STREAMS,
+      (double) u64Analyses / dSeconds,
+      *pdRemote * 100.0,
+      dRemoteBytes / dSeconds / 1.0e6 );
+
+   return true;
+}
+
+
+/// Measure what placement buys:  Decode #NUMA_PLACE_TEST_STREAMS streams on
+/// each of a worker per CPU (dealt over the nodes and pinned, like the
+/// service's workers) -- first with every stream allocated by the main
+/// thread, then with each worker's streams allocated on its node.
+///
+/// Logs the throughput, the share of the stream pages that were on the
+/// wrong node (from `QueryWorkingSetEx`) and an estimate of the traffic
+/// that crossed nodes for each pass.  On a single-node machine, both passes
+/// are the same.  It doesn't need a window or an audio device, so it runs
+/// with `/benchmark`.
+///
+/// @return `true` if both passes ran and placement didn't leave more pages
+///         on the wrong node.  `false` if there was a problem.
+bool numaPlaceTest() {
+   _ASSERTE( sstNodes > 0 );
+
+   for ( size_t i = 0 ; i < sizeof( sTestHop ) ; i++ ) {
+      sTestHop[ i ] = (BYTE) ( PCM_8_BIT_SILENCE - 32 + ( i * 37 ) % 64 );  // Something that isn't silence
+   }
+
+   size_t stWorkers = 0;
+   for ( size_t i = 0 ; i < sstNodes ; i++ ) {
+      stWorkers += sNodes[ i ].stCpus;
+   }
+   stWorkers = ( stWorkers < NUMA_PLACE_TEST_WORKERS ) ? stWorkers : NUMA_PLACE_TEST_WORKERS;
+   stWorkers = ( stWorkers > sstNodes ) ? stWorkers : sstNodes;  // At least one on every node
+
+   double dRemoteOff = 0.0;
+   double dRemoteOn  = 0.0;
+
+   bool bResult = numaPlaceTestPass( false, stWorkers, &dRemoteOff );
+   bResult = numaPlaceTestPass( true, stWorkers, &dRemoteOn ) && bResult;
+
+   if ( bResult && dRemoteOn > dRemoteOff ) {
+      LOG_WARN_R( IDS_NUMA_PLACE_TEST_REMOTE, dRemoteOn * 100.0, dRemoteOff * 100.0 );  // "With placement, %.1f%% of the stream pages were on another node (%.1f%% without it)"
+      bResult = false;
+   }
+
+   return bResult;
+}
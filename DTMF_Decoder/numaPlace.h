@@ -0,0 +1,30 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// NUMA placement for the decoding service's streams and workers
+///
+/// @file    numaPlace.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>      // For BOOL, DWORD_PTR, etc.
+
+
+/// The most NUMA nodes the placement layer uses.  Affinity masks only cover
+/// the process' processor group, so a group can't have more nodes than this.
+#define NUMA_PLACE_MAX_NODES (64)
+
+
+extern BOOL      numaPlaceParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine );
+extern BOOL      numaPlaceInit();
+extern size_t    numaPlaceNodes();
+extern size_t    numaPlaceWorkerNode( _In_ const size_t stWorker );
+extern DWORD_PTR numaPlacePin( _In_ const size_t stNode );
+extern void*     numaPlaceAlloc( _In_ const size_t stNode, _In_ const size_t stBytes );
+extern void      numaPlaceFree( _In_opt_ void* pMemory );
+extern bool      numaPlaceTest();
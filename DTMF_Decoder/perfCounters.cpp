@@ -0,0 +1,355 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Runtime performance counters for the audio/DSP pipeline.
+///
+/// Each thread that counts something claims a slot (the first time it counts)
+/// and only that thread writes to it.  The slots are cache-aligned, so
+/// counting is a plain add to a cache line nobody else is writing.  Readers
+/// add up all of the slots for a #perfCountersSnapshot_t.  The counters are
+/// read and written with `ReadNoFence64` and `WriteNoFence64`, which are
+/// whole 64-bit accesses on x64 and Win32, so a snapshot never sees a torn
+/// counter -- it may just be a buffer behind.
+///
+/// When a thread ends, it releases its slot with #perfCountersReleaseSlot.  The
+/// counts stay in the slot and the next thread to claim it keeps adding to
+/// them.  The counters only go up, so nothing is lost when the capture and
+/// DFT threads are restarted.
+///
+/// For unattended monitoring, start DTMF Decoder with:
+///
+///     DTMF_Decoder.exe /counters[:"C:\DTMF_Counters.txt"] [/counterinterval:10]
+///
+/// ...and every `/counterinterval` seconds the main window's timer writes a
+/// snapshot to the file as `name=value` lines.  The file is written to a
+/// temporary file and then renamed, so a scraper never sees half of it.
+///
+/// ### APIs Used
+/// << Print Module API Documentation >>
+///
+/// @file    perfCounters.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"     // Standard system include files
+#include <stdio.h>         // For sprintf_s()
+#include <stdlib.h>        // For _wtoi
+#include <wchar.h>         // For wcsstr
+
+#include "version.h"       // For FULL_VERSION
+#include "perfCounters.h"  // For yo bad self
+
+
+/// The counters file when `/counters` doesn't name one
+#define PERF_COUNTERS_DEFAULT_FILE L"DTMF_Counters.txt"
+
+/// The default time between writes of the counters file (in seconds)
+#define PERF_COUNTERS_DEFAULT_INTERVAL (10)
+
+/// The size of the buffer the counters file is written from
+#define PERF_COUNTERS_MAX_FILE (2048)
+
+
+__declspec( thread ) perfCounterSlot_t* gpPerfCounterSlot = NULL;
+
+static perfCounterSlot_t sSlots[ PERF_COUNTER_SLOTS ];  ///< The per-thread slots
+
+/// Used when all of #sSlots are taken.  Threads that share this slot may lose
+/// counts (they don't use interlocked operations), so we warn when this
+/// happens.
+static perfCounterSlot_t sOverflowSlot;
+
+static ULONGLONG su64StartMs = 0;                       ///< When #perfCountersInit ran (for the uptime)
+static LARGE_INTEGER sFrequency;                        ///< Performance counter ticks per second
+
+static bool   sbDumpEnabled = false;                    ///< `true` if the command line asked for the counters file
+static UINT32 suIntervalSeconds = PERF_COUNTERS_DEFAULT_INTERVAL;   ///< Seconds between writes of the counters file
+static WCHAR  swsFile[ MAX_PATH ] = PERF_COUNTERS_DEFAULT_FILE;     ///< The counters file
+static WCHAR  swsTempFile[ MAX_PATH + 4 ] = L"";                    ///< #swsFile + `.tmp`
+
+
+/// The names of the counters (as they appear in the counters file)
+static const char* sCounterNames[ PERF_COUNTER_COUNT ] = {
+   "buffers",
+   "frames",
+   "dft_passes",
+   "gated_buffers",
+   "silent_buffers",
+   "discontinuities",
+   "timestamp_errors",
+   "empty_buffers",
+   "out_of_order",
+   "dsp_ticks",
+   "paints",
+   "paint_ticks"
+};
+
+/// The names of the high-water marks (as they appear in the counters file)
+static const char* sMaximumNames[ PERF_MAX_COUNT ] = {
+   "max_frames_per_buffer",
+   "max_dsp_ticks",
+   "max_paint_ticks"
+};
+
+
+/// Initialize the counters module
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL perfCountersInit() {
+   su64StartMs = GetTickCount64();
+   QueryPerformanceFrequency( &sFrequency );  // This never fails on Windows XP or later
+
+   return TRUE;
+}
+
+
+/// Look for `/counters[:path]` and `/counterinterval:seconds` on the command
+/// line
+///
+/// @param pwszCmdLine The command line passed to #wWinMain
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL perfCountersParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine ) {
+   /// #### Function
+
+   sbDumpEnabled = false;
+
+   if ( pwszCmdLine == NULL ) {
+      return TRUE;
+   }
+
+   /// - `/counterinterval:` has to be checked first, because it starts
+   ///   with `/counter`
+   const WCHAR* pValue = wcsstr( pwszCmdLine, L"/counterinterval:" );
+   if ( pValue != NULL ) {
+      int iSeconds = _wtoi( pValue + wcslen( L"/counterinterval:" ) );
+      if ( iSeconds < 1 || iSeconds > 86400 ) {
+         RETURN_FATAL( IDS_PERF_COUNTERS_INVALID_INTERVAL );  // "The /counterinterval option is not valid.  Exiting."
+      }
+      suIntervalSeconds = (UINT32) iSeconds;
+   }
+
+   const WCHAR* pFound = wcsstr( pwszCmdLine, L"/counters" );
+   if ( pFound == NULL ) {
+      return TRUE;
+   }
+
+   sbDumpEnabled = true;
+
+   /// - If there's a `:`, then the rest of the option (which may be quoted)
+   ///   is the counters file
+   pValue = pFound + wcslen( L"/counters" );
+   if ( *pValue == L':' ) {
+      pValue++;
+
+      WCHAR wEnd = L' ';
+      if ( *pValue == L'"' ) {
+         wEnd = L'"';
+         pValue++;
+      }
+
+      size_t i = 0;
+      while ( *pValue != L'\0' && *pValue != wEnd && i < _countof( swsFile ) - 1 ) {
+         swsFile[ i++ ] = *pValue++;
+      }
+      swsFile[ i ] = L'\0';
+
+      if ( i == 0 ) {
+         RETURN_FATAL( IDS_PERF_COUNTERS_INVALID_FILE );  // "The /counters file is not valid.  Exiting."
+      }
+   }
+
+   swprintf_s( swsTempFile, _countof( swsTempFile ), L"%s.tmp", swsFile );
+
+   LOG_INFO_R( IDS_PERF_COUNTERS_ENABLED, swsFile, suIntervalSeconds );  // "Writing performance counters to [%s] every %u seconds"
+
+   return TRUE;
+}
+
+
+/// Start writing the counters file on a timer (if the command line asked for
+/// it).  The timer sends `WM_TIMER` with #IDT_PERF_COUNTERS to the window.
+///
+/// The decoder is more important than the monitoring, so a failure here is a
+/// warning.
+///
+/// @param hWnd The main window
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL perfCountersStartDump( _In_ const HWND hWnd ) {
+   _ASSERTE( hWnd != NULL );
+
+   if ( !sbDumpEnabled ) {
+      return TRUE;
+   }
+
+   if ( SetTimer( hWnd, IDT_PERF_COUNTERS, suIntervalSeconds * 1000, NULL ) == 0 ) {
+      LOG_WARN_R( IDS_PERF_COUNTERS_FAILED_TO_SET_TIMER );  // "Failed to set the performance counters timer.  Continuing."
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/// Claim a slot for the calling thread.  Called by #perfCountersAdd and
+/// #perfCountersMax the first time a thread counts something.
+///
+/// @return The thread's slot
+perfCounterSlot_t* perfCountersClaimSlot() {
+   _ASSERTE( gpPerfCounterSlot == NULL );
+
+   for ( size_t i = 0 ; i < PERF_COUNTER_SLOTS ; i++ ) {
+      if ( sSlots[ i ].lOwned == 0 && InterlockedCompareExchange( &sSlots[ i ].lOwned, 1, 0 ) == 0 ) {
+         gpPerfCounterSlot = &sSlots[ i ];
+         return gpPerfCounterSlot;
+      }
+   }
+
+   LOG_WARN_Q( IDS_PERF_COUNTERS_OUT_OF_SLOTS );  // "Out of performance counter slots.  Some counts may be lost.  Continuing."
+
+   gpPerfCounterSlot = &sOverflowSlot;
+   return gpPerfCounterSlot;
+}
+
+
+/// Release the calling thread's slot (if it has one).  Call this before a
+/// thread that counts things ends.  The slot keeps its counts.
+void perfCountersReleaseSlot() {
+   if ( gpPerfCounterSlot != NULL && gpPerfCounterSlot != &sOverflowSlot ) {
+      InterlockedExchange( &gpPerfCounterSlot->lOwned, 0 );
+   }
+
+   gpPerfCounterSlot = NULL;
+}
+
+
+/// Add up all of the slots
+///
+/// This is safe to call from any thread at any time.
+///
+/// @param pSnapshot The snapshot
+void perfCountersSnapshot( _Out_ perfCountersSnapshot_t* pSnapshot ) {
+   _ASSERTE( pSnapshot != NULL );
+
+   ZeroMemory( pSnapshot, sizeof( perfCountersSnapshot_t ) );
+
+   pSnapshot->u64UptimeMs = GetTickCount64() - su64StartMs;
+
+   for ( size_t i = 0 ; i <= PERF_COUNTER_SLOTS ; i++ ) {
+      const perfCounterSlot_t* pSlot = ( i < PERF_COUNTER_SLOTS ) ? &sSlots[ i ] : &sOverflowSlot;
+
+      for ( size_t c = 0 ; c < PERF_COUNTER_COUNT ; c++ ) {
+         pSnapshot->u64Counters[ c ] += perfCountersLoad( &pSlot->u64Counters[ c ] );
+      }
+      for ( size_t m = 0 ; m < PERF_MAX_COUNT ; m++ ) {
+         const UINT64 u64Maximum = perfCountersLoad( &pSlot->u64Maxima[ m ] );
+         if ( u64Maximum > pSnapshot->u64Maxima[ m ] ) {
+            pSnapshot->u64Maxima[ m ] = u64Maximum;
+         }
+      }
+   }
+
+   if ( sFrequency.QuadPart > 0 ) {
+      if ( pSnapshot->u64Counters[ PERF_COUNTER_BUFFERS ] > 0 ) {
+         pSnapshot->dspMeanUs = (double) pSnapshot->u64Counters[ PERF_COUNTER_DSP_TICKS ] * 1.0e6
+                              / (double) sFrequency.QuadPart
+                              / (double) pSnapshot->u64Counters[ PERF_COUNTER_BUFFERS ];
+      }
+      pSnapshot->dspMaxUs = (double) pSnapshot->u64Maxima[ PERF_MAX_DSP_TICKS ] * 1.0e6 / (double) sFrequency.QuadPart;
+
+      if ( pSnapshot->u64Counters[ PERF_COUNTER_PAINTS ] > 0 ) {
+         pSnapshot->paintMeanUs = (double) pSnapshot->u64Counters[ PERF_COUNTER_PAINT_TICKS ] * 1.0e6
+                                / (double) sFrequency.QuadPart
+                                / (double) pSnapshot->u64Counters[ PERF_COUNTER_PAINTS ];
+      }
+      pSnapshot->paintMaxUs = (double) pSnapshot->u64Maxima[ PERF_MAX_PAINT_TICKS ] * 1.0e6 / (double) sFrequency.QuadPart;
+   }
+}
+
+
+/// Write a snapshot to the counters file.  Called from `WM_TIMER`.
+///
+/// A failure to write the file is a warning, not a fatal error -- the
+/// decoder is more important than the monitoring.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL perfCountersWriteFile() {
+   if ( !sbDumpEnabled ) {
+      return TRUE;
+   }
+
+   /// #### Function
+
+   perfCountersSnapshot_t snapshot;
+   perfCountersSnapshot( &snapshot );
+
+   /// - Format the snapshot as `name=value` lines
+   char   sFile[ PERF_COUNTERS_MAX_FILE ];
+   size_t stUsed = 0;
+   int    iWritten;
+
+   iWritten = sprintf_s( sFile, _countof( sFile ), "version=%s\r\nuptime_ms=%llu\r\n", FULL_VERSION, snapshot.u64UptimeMs );
+   stUsed += ( iWritten > 0 ) ? (size_t) iWritten : 0;
+
+   for ( size_t c = 0 ; c < PERF_COUNTER_COUNT ; c++ ) {
+      iWritten = sprintf_s( sFile + stUsed, _countof( sFile ) - stUsed, "%s=%llu\r\n", sCounterNames[ c ], snapshot.u64Counters[ c ] );
+      stUsed += ( iWritten > 0 ) ? (size_t) iWritten : 0;
+   }
+   for ( size_t m = 0 ; m < PERF_MAX_COUNT ; m++ ) {
+      iWritten = sprintf_s( sFile + stUsed, _countof( sFile ) - stUsed, "%s=%llu\r\n", sMaximumNames[ m ], snapshot.u64Maxima[ m ] );
+      stUsed += ( iWritten > 0 ) ? (size_t) iWritten : 0;
+   }
+
+   iWritten = sprintf_s( sFile + stUsed, _countof( sFile ) - stUsed, "dsp_mean_us=%.1f\r\ndsp_max_us=%.1f\r\n", snapshot.dspMeanUs, snapshot.dspMaxUs );
+   stUsed += ( iWritten > 0 ) ? (size_t) iWritten : 0;
+
+   iWritten = sprintf_s( sFile + stUsed, _countof( sFile ) - stUsed, "paint_mean_us=%.1f\r\npaint_max_us=%.1f\r\n", snapshot.paintMeanUs, snapshot.paintMaxUs );
+   stUsed += ( iWritten > 0 ) ? (size_t) iWritten : 0;
+
+   /// - Write it to a temporary file, then replace the counters file with it
+   HANDLE hFile = CreateFileW( swsTempFile, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+   if ( hFile == INVALID_HANDLE_VALUE ) {
+      LOG_WARN_R( IDS_PERF_COUNTERS_FAILED_TO_WRITE_FILE, swsFile );  // "Failed to write the performance counters file [%s].  Continuing."
+      return FALSE;
+   }
+
+   DWORD dwWritten = 0;
+   BOOL  br = WriteFile( hFile, sFile, (DWORD) stUsed, &dwWritten, NULL );
+   CloseHandle( hFile );
+
+   if ( br && dwWritten == (DWORD) stUsed ) {
+      br = MoveFileExW( swsTempFile, swsFile, MOVEFILE_REPLACE_EXISTING );
+   } else {
+      br = FALSE;
+   }
+
+   if ( !br ) {
+      LOG_WARN_R( IDS_PERF_COUNTERS_FAILED_TO_WRITE_FILE, swsFile );  // "Failed to write the performance counters file [%s].  Continuing."
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/// Log a summary of the counters
+void perfCountersLog() {
+   perfCountersSnapshot_t snapshot;
+   perfCountersSnapshot( &snapshot );
+
+   LOG_INFO_R( IDS_PERF_COUNTERS_SUMMARY,
+      snapshot.u64Counters[ PERF_COUNTER_BUFFERS ],
+      snapshot.u64Counters[ PERF_COUNTER_FRAMES ],
+      snapshot.u64Counters[ PERF_COUNTER_GATED_BUFFERS ],
+      snapshot.u64Counters[ PERF_COUNTER_DISCONTINUITIES ],
+      snapshot.u64Counters[ PERF_COUNTER_OUT_OF_ORDER ],
+      snapshot.dspMeanUs,
+      snapshot.dspMaxUs );  // "Counters:  Buffers: %llu   Frames: %llu   Gated: %llu   Discontinuities: %llu   Out of order: %llu   DSP mean: %.1f us   DSP max: %.1f us"
+
+   LOG_INFO_R( IDS_PERF_COUNTERS_PAINT_SUMMARY,
+      snapshot.u64Counters[ PERF_COUNTER_PAINTS ],
+      snapshot.paintMeanUs,
+      snapshot.paintMaxUs );  // "Paint:  Paints: %llu   Paint mean: %.1f us   Paint max: %.1f us"
+}
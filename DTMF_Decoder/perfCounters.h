@@ -0,0 +1,148 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Runtime performance counters for the audio/DSP pipeline
+///
+/// @file    perfCounters.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>  // For BOOL, UINT64, etc.
+
+
+/// The ID of the timer that writes the counters file
+#define IDT_PERF_COUNTERS (1)
+
+/// The maximum number of threads that can hold a counter slot at once
+#define PERF_COUNTER_SLOTS (32)
+
+
+/// The counters.  Counters only go up (they are never reset), so a monitor
+/// can compute rates from 2 snapshots.
+enum perfCounter_t {
+   PERF_COUNTER_BUFFERS = 0,         ///< Buffers processed through the DFT
+   PERF_COUNTER_FRAMES,              ///< Frames processed through the DFT
+   PERF_COUNTER_DFT_PASSES,          ///< Goertzel passes (one per tone per buffer)
+   PERF_COUNTER_GATED_BUFFERS,       ///< Buffers that were thrown out because of their flags
+   PERF_COUNTER_SILENT,              ///< Buffers with `AUDCLNT_BUFFERFLAGS_SILENT`
+   PERF_COUNTER_DISCONTINUITIES,     ///< Buffers with `AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY`
+   PERF_COUNTER_TIMESTAMP_ERRORS,    ///< Buffers with `AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR`
+   PERF_COUNTER_EMPTY,               ///< `GetBuffer` returned `AUDCLNT_S_BUFFER_EMPTY`
+   PERF_COUNTER_OUT_OF_ORDER,        ///< `GetBuffer` returned `AUDCLNT_E_OUT_OF_ORDER` or a device position that went backwards
+   PERF_COUNTER_DSP_TICKS,           ///< Performance counter ticks spent converting and analyzing buffers
+   PERF_COUNTER_PAINTS,              ///< `WM_PAINT`s drawn by #mvcViewPaintWindow
+   PERF_COUNTER_PAINT_TICKS,         ///< Performance counter ticks spent in #mvcViewPaintWindow
+   PERF_COUNTER_COUNT                ///< The number of counters
+};
+
+
+/// The high-water marks
+enum perfMaximum_t {
+   PERF_MAX_FRAMES_PER_BUFFER = 0,   ///< The most frames in one buffer
+   PERF_MAX_DSP_TICKS,               ///< The longest time spent converting and analyzing one buffer
+   PERF_MAX_PAINT_TICKS,             ///< The longest time spent painting the window
+   PERF_MAX_COUNT                    ///< The number of high-water marks
+};
+
+
+/// One thread's counters.  Only the thread that owns the slot writes to it,
+/// so the counters don't need a locked add.  They are read and written with
+/// #perfCountersLoad and #perfCountersStore, which are whole 64-bit accesses
+/// on both x64 and Win32.  Readers add up all of the slots.  Each slot has
+/// its own cache lines, so threads don't share (and fight over) a cache line.
+typedef struct DECLSPEC_ALIGN( SYSTEM_CACHE_ALIGNMENT_SIZE ) {
+   volatile UINT64 u64Counters[ PERF_COUNTER_COUNT ];  ///< This thread's counters
+   volatile UINT64 u64Maxima[ PERF_MAX_COUNT ];        ///< This thread's high-water marks
+   volatile LONG   lOwned;                             ///< `1` if a thread holds this slot
+} perfCounterSlot_t;
+
+
+/// A point-in-time sum of all of the slots
+typedef struct {
+   UINT64 u64UptimeMs;                        ///< Milliseconds since #perfCountersInit
+   UINT64 u64Counters[ PERF_COUNTER_COUNT ];  ///< The counters
+   UINT64 u64Maxima[ PERF_MAX_COUNT ];        ///< The high-water marks
+   double dspMeanUs;                          ///< The mean time spent on a buffer
+   double dspMaxUs;                           ///< The longest time spent on a buffer
+   double paintMeanUs;                        ///< The mean time spent on a paint
+   double paintMaxUs;                         ///< The longest time spent on a paint
+} perfCountersSnapshot_t;
+
+
+extern BOOL perfCountersInit();
+extern BOOL perfCountersParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine );
+extern BOOL perfCountersStartDump( _In_ const HWND hWnd );
+extern BOOL perfCountersWriteFile();
+extern void perfCountersSnapshot( _Out_ perfCountersSnapshot_t* pSnapshot );
+extern void perfCountersLog();
+
+extern perfCounterSlot_t* perfCountersClaimSlot();
+extern void perfCountersReleaseSlot();
+
+
+/// The calling thread's slot (or `NULL` if it hasn't claimed one).
+/// Declared external to support inlining.
+extern __declspec( thread ) perfCounterSlot_t* gpPerfCounterSlot;
+
+
+/// Read a counter without tearing it.  On Win32, a plain 64-bit read is 2
+/// 32-bit reads and could see half of a write.
+///
+/// @param pu64Counter The counter
+/// @return The counter's value
+__forceinline UINT64 perfCountersLoad( _In_ const volatile UINT64* pu64Counter ) {
+   return (UINT64) ReadNoFence64( (const volatile LONG64*) pu64Counter );
+}
+
+
+/// Write a counter without tearing it.  Only the slot's owner writes, so
+/// this doesn't need a fence.
+///
+/// @param pu64Counter The counter
+/// @param u64Value    The new value
+__forceinline void perfCountersStore( _Out_ volatile UINT64* pu64Counter, _In_ const UINT64 u64Value ) {
+   WriteNoFence64( (volatile LONG64*) pu64Counter, (LONG64) u64Value );
+}
+
+
+/// Add to one of the calling thread's counters
+///
+/// Inlined for performance.
+///
+/// @param counter  The counter
+/// @param u64Value The amount to add
+__forceinline void perfCountersAdd( _In_ const perfCounter_t counter, _In_ const UINT64 u64Value ) {
+   _ASSERTE( counter < PERF_COUNTER_COUNT );
+
+   perfCounterSlot_t* pSlot = gpPerfCounterSlot;
+   if ( pSlot == NULL ) {
+      pSlot = perfCountersClaimSlot();
+   }
+
+   perfCountersStore( &pSlot->u64Counters[ counter ], perfCountersLoad( &pSlot->u64Counters[ counter ] ) + u64Value );
+}
+
+
+/// Raise one of the calling thread's high-water marks
+///
+/// Inlined for performance.
+///
+/// @param maximum  The high-water mark
+/// @param u64Value The new value
+__forceinline void perfCountersMax( _In_ const perfMaximum_t maximum, _In_ const UINT64 u64Value ) {
+   _ASSERTE( maximum < PERF_MAX_COUNT );
+
+   perfCounterSlot_t* pSlot = gpPerfCounterSlot;
+   if ( pSlot == NULL ) {
+      pSlot = perfCountersClaimSlot();
+   }
+
+   if ( u64Value > perfCountersLoad( &pSlot->u64Maxima[ maximum ] ) ) {
+      perfCountersStore( &pSlot->u64Maxima[ maximum ], u64Value );
+   }
+}
@@ -0,0 +1,154 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Low-overhead, end-to-end latency instrumentation for the audio pipeline.
+///
+/// Each buffer is timed from when its newest frame was recorded (using the
+/// QPC position `IAudioCaptureClient::GetBuffer` returns) through each stage
+/// of the pipeline:  Capture, conversion, DFT dispatch, model toggle, view
+/// invalidate and DFT done.  So, #PERF_STAGE_MODEL_TOGGLE is the latency from
+/// when a tone's samples arrived to when we detected it.
+///
+/// Each stage has a log-linear (HDR-style) histogram.  A value's bucket is
+/// its power of 2 plus its next #PERF_SUB_BUCKET_BITS bits, so the buckets
+/// cover 100ns to hours with a fixed relative error and a fixed amount of
+/// memory.  Recording is a performance counter read, a bit scan and a few
+/// interlocked adds -- no locks and no allocations -- so it's on all the time.
+///
+/// The histograms are reset in #audioStart and dumped to the log in
+/// #audioStop.  #perfLatencyGetSummary can query them at any time.
+///
+/// @file    perfLatency.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+
+#include "perfLatency.h"  // For yo bad self
+
+
+perfHistogram_t gPerfHistograms[ PERF_STAGE_COUNT ];
+INT64           gi64PerfOrigin     = 0;
+volatile LONG   glPerfStamped      = 0;
+double          gdPerfTicksTo100ns = 1.0;  ///< The performance counter usually runs at 10MHz.  Set in #perfLatencyReset.
+
+
+/// The names of the stages (for the log)
+static const PCWSTR swsStageNames[ PERF_STAGE_COUNT ] = {
+   L"Capture",
+   L"Convert",
+   L"DFT dispatch",
+   L"Model toggle",
+   L"View invalidate",
+   L"DFT done"
+};
+
+
+/// Clear all of the histograms and calibrate the performance counter
+///
+/// Call this when no buffers are moving through the pipeline (like in
+/// #audioStart).
+void perfLatencyReset() {
+   LARGE_INTEGER frequency;
+
+   QueryPerformanceFrequency( &frequency );  // This never fails on Windows XP or later
+   gdPerfTicksTo100ns = 10000000.0 / (double) frequency.QuadPart;
+
+   ZeroMemory( gPerfHistograms, sizeof( gPerfHistograms ) );
+   gi64PerfOrigin = 0;
+   glPerfStamped  = 0;
+}
+
+
+/// Get the (upper) value of a histogram bucket
+///
+/// @param stBucket The bucket
+/// @return The largest value (in 100ns units) that maps to the bucket
+static UINT64 perfBucketValue( _In_ const size_t stBucket ) {
+   if ( stBucket < PERF_SUB_BUCKETS ) {
+      return stBucket;
+   }
+
+   size_t stShift    = stBucket / PERF_SUB_BUCKETS - 1;
+   UINT64 u64Mantissa = PERF_SUB_BUCKETS + stBucket % PERF_SUB_BUCKETS;
+
+   return ( ( u64Mantissa + 1 ) << stShift ) - 1;
+}
+
+
+/// Find a percentile in a histogram
+///
+/// @param pHistogram The histogram
+/// @param u64Count   The number of values in the histogram
+/// @param fraction   The percentile (`0.5` is the median)
+/// @return The percentile in microseconds
+static double perfPercentile(
+   _In_ const perfHistogram_t* pHistogram,
+   _In_ const UINT64           u64Count,
+   _In_ const double           fraction ) {
+
+   UINT64 u64Target = (UINT64) ( fraction * (double) u64Count + 0.5 );
+   if ( u64Target == 0 ) {
+      u64Target = 1;
+   }
+
+   UINT64 u64Seen = 0;
+   for ( size_t i = 0 ; i < PERF_BUCKETS ; i++ ) {
+      u64Seen += (UINT64) pHistogram->l64Buckets[ i ];
+      if ( u64Seen >= u64Target ) {
+         UINT64 u64Value = perfBucketValue( i );
+         if ( u64Value > (UINT64) pHistogram->l64Max ) {
+            u64Value = (UINT64) pHistogram->l64Max;  // Don't report more than we've seen
+         }
+         return (double) u64Value / 10.0;
+      }
+   }
+
+   return (double) pHistogram->l64Max / 10.0;
+}
+
+
+/// Summarize a stage's histogram
+///
+/// This is safe to call while the pipeline is running.  The histogram may
+/// change while we're reading it, so the summary is approximate.
+///
+/// @param stage    The stage
+/// @param pSummary The summary
+void perfLatencyGetSummary(
+   _In_  const perfStage_t           stage,
+   _Out_       perfLatencySummary_t* pSummary ) {
+   _ASSERTE( stage < PERF_STAGE_COUNT );
+   _ASSERTE( pSummary != NULL );
+
+   const perfHistogram_t* pHistogram = &gPerfHistograms[ stage ];
+
+   ZeroMemory( pSummary, sizeof( perfLatencySummary_t ) );
+
+   pSummary->u64Count = (UINT64) pHistogram->l64Count;
+   if ( pSummary->u64Count == 0 ) {
+      return;
+   }
+
+   pSummary->meanUs = (double) pHistogram->l64Sum / (double) pSummary->u64Count / 10.0;
+   pSummary->p50Us  = perfPercentile( pHistogram, pSummary->u64Count, 0.50 );
+   pSummary->p90Us  = perfPercentile( pHistogram, pSummary->u64Count, 0.90 );
+   pSummary->p99Us  = perfPercentile( pHistogram, pSummary->u64Count, 0.99 );
+   pSummary->p999Us = perfPercentile( pHistogram, pSummary->u64Count, 0.999 );
+   pSummary->maxUs  = (double) pHistogram->l64Max / 10.0;
+}
+
+
+/// Log a summary of every stage
+void perfLatencyDump() {
+   perfLatencySummary_t summary;
+
+   for ( int i = 0 ; i < PERF_STAGE_COUNT ; i++ ) {
+      perfLatencyGetSummary( (perfStage_t) i, &summary );
+
+      LOG_INFO_R( IDS_PERF_LATENCY_SUMMARY, swsStageNames[ i ], summary.u64Count, summary.meanUs, summary.p50Us, summary.p90Us, summary.p99Us, summary.p999Us, summary.maxUs );  // "Latency:  %-15s  Count: %llu   Mean: %.0f us   p50: %.0f us   p90: %.0f us   p99: %.0f us   p99.9: %.0f us   Max: %.0f us"
+   }
+}
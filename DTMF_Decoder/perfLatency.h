@@ -0,0 +1,231 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Low-overhead, end-to-end latency instrumentation for the audio pipeline
+///
+/// @file    perfLatency.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>  // For BOOL, LARGE_INTEGER, Interlocked*, etc.
+#include <intrin.h>   // For _BitScanReverse64
+
+
+/// The stages of the pipeline a buffer goes through.  The latency of each
+/// stage is measured from when the newest frame in the buffer was recorded.
+enum perfStage_t {
+   PERF_STAGE_CAPTURE = 0,       ///< #audioCapture got the buffer from the audio source
+   PERF_STAGE_CONVERT,           ///< All of the frames are converted and in #gPcmQueue
+   PERF_STAGE_DFT_DISPATCH,      ///< The DFT threads are about to be signalled
+   PERF_STAGE_MODEL_TOGGLE,      ///< The first tone in the buffer changed its detected state
+   PERF_STAGE_VIEW_INVALIDATE,   ///< The UI tick invalidated the display for the buffer that changed a tone
+   PERF_STAGE_DFT_DONE,          ///< All of the DFT threads are done
+   PERF_STAGE_COUNT              ///< The number of stages
+};
+
+
+/// The number of bits of precision in each histogram bucket.  The relative
+/// error of a recorded value is at most `1 / 2^PERF_SUB_BUCKET_BITS` (6.25%).
+#define PERF_SUB_BUCKET_BITS  (4)
+
+/// The number of buckets in each power of 2
+#define PERF_SUB_BUCKETS      (1 << PERF_SUB_BUCKET_BITS)
+
+/// Values are in 100ns units.  Anything at or above `2^PERF_MAX_VALUE_BITS`
+/// (about 30 hours) goes in the last bucket.
+#define PERF_MAX_VALUE_BITS   (40)
+
+/// The number of buckets in each histogram
+#define PERF_BUCKETS          ( ( PERF_MAX_VALUE_BITS - PERF_SUB_BUCKET_BITS + 1 ) * PERF_SUB_BUCKETS )
+
+
+/// A log-linear (HDR-style) histogram of latencies in 100ns units.  Every
+/// member is updated with interlocked operations, so any thread can record
+/// into it without a lock.
+typedef struct {
+   volatile LONG64 l64Count;                    ///< The number of values recorded
+   volatile LONG64 l64Sum;                      ///< The sum of the values (for the mean)
+   volatile LONG64 l64Max;                      ///< The largest value
+   volatile LONG64 l64Buckets[ PERF_BUCKETS ];  ///< The counts
+} perfHistogram_t;
+
+
+/// A summary of one stage's histogram.  All of the times are in microseconds.
+typedef struct {
+   UINT64 u64Count;  ///< The number of buffers that reached this stage
+   double meanUs;    ///< The mean latency
+   double p50Us;     ///< The median latency
+   double p90Us;     ///< The 90th percentile latency
+   double p99Us;     ///< The 99th percentile latency
+   double p999Us;    ///< The 99.9th percentile latency
+   double maxUs;     ///< The worst latency
+} perfLatencySummary_t;
+
+
+extern void perfLatencyReset();
+extern void perfLatencyGetSummary( _In_ const perfStage_t stage, _Out_ perfLatencySummary_t* pSummary );
+extern void perfLatencyDump();
+
+
+/// The histogram of each stage.  Declared external to support inlining.
+extern perfHistogram_t gPerfHistograms[ PERF_STAGE_COUNT ];
+
+/// When the newest frame of the current buffer was recorded (in performance
+/// counter ticks).  Declared external to support inlining.
+extern INT64 gi64PerfOrigin;
+
+/// The stages that have already been stamped for the current buffer (1 bit
+/// per stage).  Declared external to support inlining.
+extern volatile LONG glPerfStamped;
+
+/// Converts performance counter ticks to 100ns units.  Declared external to
+/// support inlining.
+extern double gdPerfTicksTo100ns;
+
+
+/// Map a value (in 100ns units) to its histogram bucket
+///
+/// Inlined for performance.
+///
+/// @param u64Value The value
+/// @return The bucket
+__forceinline size_t perfBucket( _In_ UINT64 u64Value ) {
+   if ( u64Value < PERF_SUB_BUCKETS ) {
+      return (size_t) u64Value;  // Small values are exact
+   }
+
+   if ( u64Value >= ( 1ULL << PERF_MAX_VALUE_BITS ) ) {
+      return PERF_BUCKETS - 1;
+   }
+
+   unsigned long ulMsb;  // The most significant bit of u64Value
+   _BitScanReverse64( &ulMsb, u64Value );
+
+   size_t stShift = ulMsb - PERF_SUB_BUCKET_BITS;  // The mantissa is the top PERF_SUB_BUCKET_BITS + 1 bits
+
+   return ( stShift + 1 ) * PERF_SUB_BUCKETS + (size_t) ( ( u64Value >> stShift ) - PERF_SUB_BUCKETS );
+}
+
+
+/// Record a latency (in performance counter ticks) in a stage's histogram
+///
+/// Inlined for performance.
+///
+/// @param stage     The stage
+/// @param i64Ticks  The latency
+__forceinline void perfRecord( _In_ const perfStage_t stage, _In_ const INT64 i64Ticks ) {
+   _ASSERTE( stage < PERF_STAGE_COUNT );
+
+   if ( i64Ticks < 0 ) {
+      return;  // The device's clock was ahead of ours.  Don't record nonsense.
+   }
+
+   perfHistogram_t* pHistogram = &gPerfHistograms[ stage ];
+   LONG64           l64Value   = (LONG64) ( (double) i64Ticks * gdPerfTicksTo100ns );
+
+   InterlockedIncrement64( &pHistogram->l64Buckets[ perfBucket( (UINT64) l64Value ) ] );
+   InterlockedIncrement64( &pHistogram->l64Count );
+   InterlockedAdd64( &pHistogram->l64Sum, l64Value );
+
+   LONG64 l64Max = pHistogram->l64Max;
+   while ( l64Value > l64Max ) {
+      LONG64 l64Was = InterlockedCompareExchange64( &pHistogram->l64Max, l64Value, l64Max );
+      if ( l64Was == l64Max ) {
+         break;
+      }
+      l64Max = l64Was;
+   }
+}
+
+
+/// Start timing a new buffer and record #PERF_STAGE_CAPTURE
+///
+/// Called on the capture thread right after the audio source returns a
+/// buffer.
+///
+/// Inlined for performance.
+///
+/// @param u64QpcPosition When the first frame was recorded (in 100ns units,
+///                       as reported by `IAudioCaptureClient::GetBuffer`).
+///                       `0` if it's not known.
+/// @param u32Frames      The number of frames in the buffer
+/// @param u32SampleRate  Frames per second
+__forceinline void perfLatencyBeginBuffer(
+   _In_ const UINT64 u64QpcPosition,
+   _In_ const UINT32 u32Frames,
+   _In_ const UINT32 u32SampleRate ) {
+
+   LARGE_INTEGER now;
+   QueryPerformanceCounter( &now );
+
+   glPerfStamped = 1 << PERF_STAGE_CAPTURE;
+
+   if ( u64QpcPosition == 0 || u32SampleRate == 0 || u32Frames == 0 ) {
+      gi64PerfOrigin = now.QuadPart;  // We don't know when it was recorded, so start the clock now
+      return;
+   }
+
+   /// The newest frame was recorded `(frames - 1) / rate` after the first one
+   double newest100ns = (double) u64QpcPosition + (double) ( u32Frames - 1 ) * 10000000.0 / (double) u32SampleRate;
+
+   gi64PerfOrigin = (INT64) ( newest100ns / gdPerfTicksTo100ns );
+
+   perfRecord( PERF_STAGE_CAPTURE, now.QuadPart - gi64PerfOrigin );
+}
+
+
+/// Record that the current buffer reached a stage
+///
+/// Each stage is recorded once per buffer (the first time it's reached), so
+/// the DFT threads can all call this for the same buffer.  It's safe to call
+/// from any thread.
+///
+/// Inlined for performance.
+///
+/// @param stage The stage
+__forceinline void perfLatencyStamp( _In_ const perfStage_t stage ) {
+   _ASSERTE( stage < PERF_STAGE_COUNT );
+
+   const LONG lBit = 1 << stage;
+
+   if ( glPerfStamped & lBit ) {
+      return;  // Cheap check first...
+   }
+   if ( InterlockedOr( &glPerfStamped, lBit ) & lBit ) {
+      return;  // ...then claim it.  Another thread beat us to it.
+   }
+
+   LARGE_INTEGER now;
+   QueryPerformanceCounter( &now );
+
+   perfRecord( stage, now.QuadPart - gi64PerfOrigin );
+}
+
+
+/// Record that an earlier buffer reached a stage
+///
+/// Use this when the stage is reached on another thread after the current
+/// buffer may have moved on (like #PERF_STAGE_VIEW_INVALIDATE).  The caller
+/// carries the buffer's #gi64PerfOrigin to here.
+///
+/// Inlined for performance.
+///
+/// @param stage     The stage
+/// @param i64Origin The buffer's #gi64PerfOrigin.  `0` if it's not known.
+__forceinline void perfLatencyStampSince( _In_ const perfStage_t stage, _In_ const INT64 i64Origin ) {
+   _ASSERTE( stage < PERF_STAGE_COUNT );
+
+   if ( i64Origin == 0 ) {
+      return;
+   }
+
+   LARGE_INTEGER now;
+   QueryPerformanceCounter( &now );
+
+   perfRecord( stage, now.QuadPart - i64Origin );
+}
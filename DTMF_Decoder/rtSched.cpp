@@ -0,0 +1,763 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Real-time scheduling policy for the capture and DSP threads
+///
+/// The capture and DSP threads don't set their own priority.  Each one calls
+/// #rtSchedEnter with its role when it starts and #rtSchedLeave when it
+/// ends.  The policy is:
+///
+///   - Priority:  Join the MMCSS `Capture` task, so the thread runs in the
+///     real-time priority band (on by default, `/nortsched` turns it off)
+///   - Pinning:  Set the thread's affinity to the CPUs for its role.  DSP
+///     workers are dealt round-robin over the DSP CPUs.  Nothing is pinned
+///     unless it's asked for.
+///   - Memory:  Raise the working set's minimum and make it a hard limit, so
+///     the pipeline's pages aren't trimmed and faulted back in the middle of
+///     a buffer (Windows' answer to `mlockall`)
+///
+/// Builds without `_WIN32` use the Linux equivalents:
+///
+///   - Priority:  `SCHED_FIFO` at #RT_SCHED_FIFO_PRIORITY.  If the process
+///     isn't allowed to set it (it needs `CAP_SYS_NICE` or `RLIMIT_RTPRIO`),
+///     ask rtkit for it over D-Bus.  rtkit hands out `SCHED_RR` (the same as
+///     `SCHED_FIFO` for threads that don't share a CPU and a priority) and
+///     only to processes with an `RLIMIT_RTTIME`, which #rtSchedInit sets.
+///   - Pinning:  `pthread_setaffinity_np`
+///   - Memory:  `mlockall( MCL_CURRENT | MCL_FUTURE )`
+///
+/// The Linux backend links with `-lpthread -lsystemd` (for sd-bus).
+///
+/// Isolate some cores (for example, with `bcdedit /set numproc` in a VM or by
+/// keeping other work off of them) and start DTMF Decoder with:
+///
+///     DTMF_Decoder.exe [/capturecpu:2] [/dspcpus:4-11] [/lockmemory] [/nortsched]
+///
+/// #rtSchedJitterTest measures how late a DSP thread wakes up after it's
+/// signalled, with and without the policy, while every CPU is busy.  It
+/// runs with `/benchmark`.
+///
+/// ### APIs Used
+/// | API                               | Link                                                                                                                      |
+/// |-----------------------------------|---------------------------------------------------------------------------------------------------------------------------|
+/// | `AvSetMmThreadCharacteristicsW`   | https://learn.microsoft.com/en-us/windows/win32/api/avrt/nf-avrt-avsetmmthreadcharacteristicsw                            |
+/// | `AvRevertMmThreadCharacteristics` | https://learn.microsoft.com/en-us/windows/win32/api/avrt/nf-avrt-avrevertmmthreadcharacteristics                          |
+/// | `SetThreadAffinityMask`           | https://learn.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-setthreadaffinitymask                              |
+/// | `GetProcessAffinityMask`          | https://learn.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-getprocessaffinitymask                             |
+/// | `SetProcessWorkingSetSizeEx`      | https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-setprocessworkingsetsizeex                     |
+///
+/// ### Linux APIs Used
+/// | API                               | Link                                                                                                                      |
+/// |-----------------------------------|---------------------------------------------------------------------------------------------------------------------------|
+/// | `pthread_setschedparam`           | https://man7.org/linux/man-pages/man3/pthread_setschedparam.3.html                                                        |
+/// | `pthread_setaffinity_np`          | https://man7.org/linux/man-pages/man3/pthread_setaffinity_np.3.html                                                       |
+/// | `sched_getaffinity`               | https://man7.org/linux/man-pages/man2/sched_getaffinity.2.html                                                            |
+/// | `mlockall`                        | https://man7.org/linux/man-pages/man2/mlockall.2.html                                                                     |
+/// | `setrlimit`                       | https://man7.org/linux/man-pages/man2/setrlimit.2.html                                                                    |
+/// | `sd_bus_call_method`              | https://www.freedesktop.org/software/systemd/man/latest/sd_bus_call_method.html                                           |
+/// | rtkit `MakeThreadRealtime`        | https://gitlab.freedesktop.org/pipewire/rtkit                                                                             |
+///
+/// @file    rtSched.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+#include <stdlib.h>       // For _wtoi and qsort
+#include <wchar.h>        // For wcsstr
+
+#ifdef _WIN32
+   #include <avrt.h>      // For AvSetMmThreadCharacteristics
+
+   #pragma comment(lib, "avrt")  // Link the MMCSS library
+#else
+   #include <errno.h>             // For errno
+   #include <pthread.h>           // For pthread_setschedparam and pthread_setaffinity_np
+   #include <sys/mman.h>          // For mlockall
+   #include <sys/resource.h>      // For setrlimit
+   #include <sys/syscall.h>       // For SYS_gettid
+   #include <unistd.h>            // For syscall
+   #include <systemd/sd-bus.h>    // For talking to rtkit
+#endif
+
+#include "mvcModel.h"     // For gdwMmcssTaskIndex
+#include "rtSched.h"      // For yo bad self
+
+
+#ifdef _WIN32
+/// The MMCSS task the capture and DSP threads join
+#define RT_SCHED_MMCSS_TASK         L"Capture"
+#else
+/// The `SCHED_FIFO` priority of the capture and DSP threads (rtkit may
+/// lower it to its `MaxRealtimePriority`)
+#define RT_SCHED_FIFO_PRIORITY      (20)
+
+/// The most CPU time (in microseconds) a real-time thread may use without
+/// blocking.  rtkit won't make a thread real-time without it.  The threads
+/// block on every buffer, so they never get near it.
+#define RT_SCHED_RTTIME_US          (200000)
+
+#define RTKIT_SERVICE   "org.freedesktop.RealtimeKit1"   ///< rtkit's D-Bus name
+#define RTKIT_OBJECT    "/org/freedesktop/RealtimeKit1"  ///< rtkit's D-Bus object
+#define RTKIT_INTERFACE "org.freedesktop.RealtimeKit1"   ///< rtkit's D-Bus interface
+#endif
+
+/// The working set's minimum with `/lockmemory` (in MB)
+#define RT_SCHED_LOCK_MB            (64)
+
+/// How long each pass of #rtSchedJitterTest runs (in milliseconds)
+#define RT_SCHED_JITTER_TEST_MS     (2000)
+
+/// How long the #rtSchedJitterTest signaller waits between wakes (in
+/// microseconds).  It's short, so each pass gets thousands of wakes and a
+/// steady p99.9.
+#define RT_SCHED_JITTER_PERIOD_US   (500)
+
+/// The most wakes #rtSchedJitterTest keeps from each pass
+#define RT_SCHED_JITTER_MAX_SAMPLES (8192)
+
+/// The most load threads #rtSchedJitterTest starts (one per CPU)
+#define RT_SCHED_JITTER_MAX_LOAD    (64)
+
+
+static bool sbEnabled     = true;   ///< `false` with `/nortsched`
+static bool sbLockMemory  = false;  ///< `true` with `/lockmemory`
+
+/// The CPUs each role is pinned to:  The first and the last (inclusive).
+/// `-1` if the role isn't pinned.
+static int siFirstCpu[ RT_SCHED_ROLE_COUNT ] = { -1, -1 };
+static int siLastCpu[ RT_SCHED_ROLE_COUNT ]  = { -1, -1 };  ///< See #siFirstCpu
+
+
+/// Parse a CPU or a range of CPUs (like `4` or `4-11`) after an option
+///
+/// @param pwszValue The text after the option's `:`
+/// @param piFirst   The first CPU
+/// @param piLast    The last CPU (the same as the first if it's not a range)
+/// @return `true` if the CPUs are in this process' affinity mask.  `false`
+///         if they aren't.
+static bool rtSchedParseCpus( _In_z_ const WCHAR* pwszValue, _Out_ int* piFirst, _Out_ int* piLast ) {
+   *piFirst = -1;
+   *piLast  = -1;
+
+   if ( *pwszValue < L'0' || *pwszValue > L'9' ) {
+      return false;
+   }
+
+   int iFirst = _wtoi( pwszValue );
+   int iLast  = iFirst;
+
+   while ( *pwszValue >= L'0' && *pwszValue <= L'9' ) {
+      pwszValue++;
+   }
+
+   if ( *pwszValue == L'-' ) {
+      pwszValue++;
+      if ( *pwszValue < L'0' || *pwszValue > L'9' ) {
+         return false;
+      }
+      iLast = _wtoi( pwszValue );
+   }
+
+#ifdef _WIN32
+   /// The CPUs have to be in the process' affinity mask.  Affinity masks
+   /// only cover the process' processor group (64 CPUs).
+   DWORD_PTR dwpProcessMask = 0;
+   DWORD_PTR dwpSystemMask  = 0;
+
+   if ( !GetProcessAffinityMask( GetCurrentProcess(), &dwpProcessMask, &dwpSystemMask ) ) {
+      return false;
+   }
+
+   if ( iFirst < 0 || iLast < iFirst || iLast >= (int) ( sizeof( DWORD_PTR ) * 8 ) ) {
+      return false;
+   }
+
+   for ( int i = iFirst ; i <= iLast ; i++ ) {
+      if ( ( dwpProcessMask & ( (DWORD_PTR) 1 << i ) ) == 0 ) {
+         return false;
+      }
+   }
+#else
+   /// The CPUs have to be in the process' affinity mask
+   cpu_set_t processMask;
+   CPU_ZERO( &processMask );
+
+   if ( sched_getaffinity( 0, sizeof( processMask ), &processMask ) != 0 ) {
+      return false;
+   }
+
+   if ( iFirst < 0 || iLast < iFirst || iLast >= CPU_SETSIZE ) {
+      return false;
+   }
+
+   for ( int i = iFirst ; i <= iLast ; i++ ) {
+      if ( !CPU_ISSET( i, &processMask ) ) {
+         return false;
+      }
+   }
+#endif
+
+   *piFirst = iFirst;
+   *piLast  = iLast;
+
+   return true;
+}
+
+
+/// Look for `/capturecpu:n`, `/dspcpus:n[-m]`, `/lockmemory` and
+/// `/nortsched` on the command line
+///
+/// @param pwszCmdLine The command line passed to #wWinMain
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL rtSchedParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine ) {
+   /// #### Function
+
+   sbEnabled    = true;
+   sbLockMemory = false;
+
+   for ( size_t i = 0 ; i < RT_SCHED_ROLE_COUNT ; i++ ) {
+      siFirstCpu[ i ] = -1;
+      siLastCpu[ i ]  = -1;
+   }
+
+   if ( pwszCmdLine == NULL ) {
+      return TRUE;
+   }
+
+   if ( wcsstr( pwszCmdLine, L"/nortsched" ) != NULL ) {
+      sbEnabled = false;
+      LOG_INFO_R( IDS_RT_SCHED_DISABLED );  // "Real-time scheduling is off"
+   }
+
+   if ( wcsstr( pwszCmdLine, L"/lockmemory" ) != NULL ) {
+      sbLockMemory = true;
+   }
+
+   /// - `/capturecpu:` takes one CPU
+   const WCHAR* pValue = wcsstr( pwszCmdLine, L"/capturecpu:" );
+   if ( pValue != NULL ) {
+      if ( !rtSchedParseCpus( pValue + wcslen( L"/capturecpu:" ), &siFirstCpu[ RT_SCHED_ROLE_CAPTURE ], &siLastCpu[ RT_SCHED_ROLE_CAPTURE ] )
+        || siFirstCpu[ RT_SCHED_ROLE_CAPTURE ] != siLastCpu[ RT_SCHED_ROLE_CAPTURE ] ) {
+         RETURN_FATAL( IDS_RT_SCHED_INVALID_CPUS );  // "The /capturecpu or /dspcpus option is not valid.  Exiting."
+      }
+   }
+
+   /// - `/dspcpus:` takes a CPU or a range of CPUs
+   pValue = wcsstr( pwszCmdLine, L"/dspcpus:" );
+   if ( pValue != NULL ) {
+      if ( !rtSchedParseCpus( pValue + wcslen( L"/dspcpus:" ), &siFirstCpu[ RT_SCHED_ROLE_DSP ], &siLastCpu[ RT_SCHED_ROLE_DSP ] ) ) {
+         RETURN_FATAL( IDS_RT_SCHED_INVALID_CPUS );  // "The /capturecpu or /dspcpus option is not valid.  Exiting."
+      }
+   }
+
+   if ( sbEnabled && ( siFirstCpu[ RT_SCHED_ROLE_CAPTURE ] >= 0 || siFirstCpu[ RT_SCHED_ROLE_DSP ] >= 0 ) ) {
+      LOG_INFO_R( IDS_RT_SCHED_PINNING,  // "Pinning the capture thread to CPU %d and the DSP threads to CPUs %d to %d (-1 is not pinned)"
+         siFirstCpu[ RT_SCHED_ROLE_CAPTURE ], siFirstCpu[ RT_SCHED_ROLE_DSP ], siLastCpu[ RT_SCHED_ROLE_DSP ] );
+   }
+
+   return TRUE;
+}
+
+
+/// Apply the process-wide part of the policy:  With `/lockmemory`, raise
+/// the working set's minimum to #RT_SCHED_LOCK_MB and make it a hard limit.
+/// On Linux, set `RLIMIT_RTTIME` (for rtkit) and, with `/lockmemory`, lock
+/// all of the process' memory with `mlockall`.
+///
+/// The decoder runs without it, so a failure is a warning.
+///
+/// @return `TRUE` if successful.  `FALSE` if there was a problem.
+BOOL rtSchedInit() {
+#ifdef _WIN32
+   if ( !sbEnabled || !sbLockMemory ) {
+      return TRUE;
+   }
+
+   const SIZE_T stMinimum = (SIZE_T) RT_SCHED_LOCK_MB * 1024 * 1024;
+
+   if ( !SetProcessWorkingSetSizeEx( GetCurrentProcess(), stMinimum, stMinimum * 2, QUOTA_LIMITS_HARDWS_MIN_ENABLE | QUOTA_LIMITS_HARDWS_MAX_DISABLE ) ) {
+      LOG_WARN_R( IDS_RT_SCHED_FAILED_TO_LOCK_MEMORY, GetLastError() );  // "Failed to lock the working set in memory (error %lu).  Continuing."
+      return FALSE;
+   }
+
+   LOG_INFO_R( IDS_RT_SCHED_LOCKED_MEMORY, (UINT32) RT_SCHED_LOCK_MB );  // "Locked a working set of %u MB in memory"
+
+   return TRUE;
+#else
+   if ( !sbEnabled ) {
+      return TRUE;
+   }
+
+   /// #### Function
+
+   /// - rtkit only makes threads real-time in a process with an
+   ///   `RLIMIT_RTTIME`.  The limit can only go down, so keep the hard limit
+   ///   if it's already lower.  If this fails, rtkit says no and the threads
+   ///   run at normal priority.
+   struct rlimit rtTime;
+   if ( getrlimit( RLIMIT_RTTIME, &rtTime ) == 0 ) {
+      if ( rtTime.rlim_max == RLIM_INFINITY || rtTime.rlim_max > RT_SCHED_RTTIME_US ) {
+         rtTime.rlim_max = RT_SCHED_RTTIME_US;
+      }
+      rtTime.rlim_cur = rtTime.rlim_max;
+      setrlimit( RLIMIT_RTTIME, &rtTime );
+   }
+
+   if ( !sbLockMemory ) {
+      return TRUE;
+   }
+
+   /// - With `/lockmemory`, lock every page the process has now and every
+   ///   page it maps later
+   if ( mlockall( MCL_CURRENT | MCL_FUTURE ) != 0 ) {
+      LOG_WARN_R( IDS_RT_SCHED_FAILED_TO_LOCK_MEMORY, (unsigned long) errno );  // "Failed to lock the working set in memory (error %lu).  Continuing."
+      return FALSE;
+   }
+
+   LOG_INFO_R( IDS_RT_SCHED_LOCKED_ALL_MEMORY );  // "Locked all of the process' memory in RAM (mlockall)"
+
+   return TRUE;
+#endif
+}
+
+
+#ifndef _WIN32
+/// Ask rtkit to make the calling thread real-time.  rtkit does it for
+/// processes that can't set `SCHED_FIFO` themselves.
+///
+/// The bus isn't shared between threads, so each call opens its own.
+///
+/// @param iPriority The priority to ask for (rtkit may lower it)
+/// @return `true` if the thread is real-time.  `false` if rtkit said no (or
+///         isn't running).
+static bool rtSchedAskRtkit( _In_ const int iPriority ) {
+   sd_bus*      pBus  = NULL;
+   sd_bus_error error = SD_BUS_ERROR_NULL;
+   int32_t      iMax  = 0;
+
+   int r = sd_bus_open_system( &pBus );
+   if ( r < 0 ) {
+      return false;
+   }
+
+   r = sd_bus_get_property_trivial( pBus, RTKIT_SERVICE, RTKIT_OBJECT, RTKIT_INTERFACE, "MaxRealtimePriority", &error, 'i', &iMax );
+
+   if ( r >= 0 ) {
+      const uint32_t uPriority = (uint32_t) ( ( iPriority < iMax ) ? iPriority : iMax );
+
+      r = sd_bus_call_method( pBus, RTKIT_SERVICE, RTKIT_OBJECT, RTKIT_INTERFACE, "MakeThreadRealtime", &error, NULL,
+         "tu", (uint64_t) syscall( SYS_gettid ), uPriority );
+   }
+
+   sd_bus_error_free( &error );
+   sd_bus_unref( pBus );
+
+   return r >= 0;
+}
+#endif
+
+
+/// Put the calling thread under the policy, whether or not `/nortsched` is
+/// on the command line
+///
+/// @param role     What the thread does
+/// @param stWorker The thread's number within its role (for round-robin
+///                 pinning)
+/// @param pThread  Holds what #rtSchedLeave needs to undo the policy
+/// @return `TRUE` if the thread joined MMCSS (or got `SCHED_FIFO` on
+///         Linux).  `FALSE` if it didn't.
+static BOOL rtSchedApply( _In_ const rtSchedRole_t role, _In_ const size_t stWorker, _Out_ rtSchedThread_t* pThread ) {
+   _ASSERTE( role < RT_SCHED_ROLE_COUNT );
+   _ASSERTE( pThread != NULL );
+
+#ifdef _WIN32
+   pThread->hMmcss         = NULL;
+   pThread->dwpOldAffinity = 0;
+
+   /// #### Function
+
+   /// - Pin the thread, if its role has CPUs
+   if ( siFirstCpu[ role ] >= 0 ) {
+      const int iCpus = siLastCpu[ role ] - siFirstCpu[ role ] + 1;
+      const int iCpu  = siFirstCpu[ role ] + (int) ( stWorker % (size_t) iCpus );
+
+      pThread->dwpOldAffinity = SetThreadAffinityMask( GetCurrentThread(), (DWORD_PTR) 1 << iCpu );
+      if ( pThread->dwpOldAffinity == 0 ) {
+         LOG_WARN_R( IDS_RT_SCHED_FAILED_TO_PIN, iCpu );  // "Failed to pin a thread to CPU %d.  Continuing."
+      }
+   }
+
+   /// - Join the MMCSS task, which will set the CPU priority for this
+   ///   thread.  All of the threads share #gdwMmcssTaskIndex.
+   pThread->hMmcss = AvSetMmThreadCharacteristicsW( RT_SCHED_MMCSS_TASK, &gdwMmcssTaskIndex );
+
+   return pThread->hMmcss != NULL;
+#else
+   pThread->iOldPolicy   = -1;
+   pThread->iOldPriority = 0;
+   pThread->bPinned      = false;
+   CPU_ZERO( &pThread->oldAffinity );
+
+   /// #### Function
+
+   /// - Pin the thread, if its role has CPUs
+   if ( siFirstCpu[ role ] >= 0 ) {
+      const int iCpus = siLastCpu[ role ] - siFirstCpu[ role ] + 1;
+      const int iCpu  = siFirstCpu[ role ] + (int) ( stWorker % (size_t) iCpus );
+
+      cpu_set_t newAffinity;
+      CPU_ZERO( &newAffinity );
+      CPU_SET( iCpu, &newAffinity );
+
+      if ( pthread_getaffinity_np( pthread_self(), sizeof( pThread->oldAffinity ), &pThread->oldAffinity ) == 0
+        && pthread_setaffinity_np( pthread_self(), sizeof( newAffinity ), &newAffinity ) == 0 ) {
+         pThread->bPinned = true;
+      } else {
+         LOG_WARN_R( IDS_RT_SCHED_FAILED_TO_PIN, iCpu );  // "Failed to pin a thread to CPU %d.  Continuing."
+      }
+   }
+
+   /// - Remember the thread's policy, so #rtSchedLeave can put it back
+   int                iOldPolicy;
+   struct sched_param param;
+
+   if ( pthread_getschedparam( pthread_self(), &iOldPolicy, &param ) != 0 ) {
+      return FALSE;
+   }
+
+   /// - Set `SCHED_FIFO`.  If the process isn't allowed to, ask rtkit.
+   struct sched_param fifoParam;
+   fifoParam.sched_priority = RT_SCHED_FIFO_PRIORITY;
+
+   if ( pthread_setschedparam( pthread_self(), SCHED_FIFO, &fifoParam ) != 0
+     && !rtSchedAskRtkit( RT_SCHED_FIFO_PRIORITY ) ) {
+      return FALSE;
+   }
+
+   pThread->iOldPolicy   = iOldPolicy;
+   pThread->iOldPriority = param.sched_priority;
+
+   return TRUE;
+#endif
+}
+
+
+/// Put the calling thread under the real-time scheduling policy for its
+/// role.  Call it once at the top of the thread.
+///
+/// @param role     What the thread does
+/// @param stWorker The thread's number within its role (for round-robin
+///                 pinning)
+/// @param pThread  Holds what #rtSchedLeave needs to undo the policy
+/// @return `TRUE` if the policy is in place (or `/nortsched` is on).  `FALSE`
+///         if the thread couldn't join MMCSS (or get `SCHED_FIFO` on Linux)
+///         -- it still runs, just at normal priority.
+BOOL rtSchedEnter( _In_ const rtSchedRole_t role, _In_ const size_t stWorker, _Out_ rtSchedThread_t* pThread ) {
+   _ASSERTE( pThread != NULL );
+
+#ifdef _WIN32
+   pThread->hMmcss         = NULL;
+   pThread->dwpOldAffinity = 0;
+#else
+   pThread->iOldPolicy   = -1;
+   pThread->iOldPriority = 0;
+   pThread->bPinned      = false;
+#endif
+
+   if ( !sbEnabled ) {
+      return TRUE;
+   }
+
+   return rtSchedApply( role, stWorker, pThread );
+}
+
+
+/// Take the calling thread out of the policy it got from #rtSchedEnter
+///
+/// @param pThread From #rtSchedEnter
+/// @return `TRUE` if successful.  `FALSE` if MMCSS (or the Linux
+///         scheduling policy) couldn't be reverted.
+BOOL rtSchedLeave( _Inout_ rtSchedThread_t* pThread ) {
+   _ASSERTE( pThread != NULL );
+
+   BOOL br = TRUE;
+
+#ifdef _WIN32
+   if ( pThread->hMmcss != NULL ) {
+      br = AvRevertMmThreadCharacteristics( pThread->hMmcss );
+      pThread->hMmcss = NULL;
+   }
+
+   if ( pThread->dwpOldAffinity != 0 ) {
+      SetThreadAffinityMask( GetCurrentThread(), pThread->dwpOldAffinity );  // The thread is ending, so there's nothing to do if it fails
+      pThread->dwpOldAffinity = 0;
+   }
+#else
+   if ( pThread->iOldPolicy >= 0 ) {
+      struct sched_param param;
+      param.sched_priority = pThread->iOldPriority;
+
+      br = ( pthread_setschedparam( pthread_self(), pThread->iOldPolicy, &param ) == 0 );  // Lowering the policy is always allowed
+      pThread->iOldPolicy = -1;
+   }
+
+   if ( pThread->bPinned ) {
+      pthread_setaffinity_np( pthread_self(), sizeof( pThread->oldAffinity ), &pThread->oldAffinity );  // The thread is ending, so there's nothing to do if it fails
+      pThread->bPinned = false;
+   }
+#endif
+
+   return br;
+}
+
+
+#ifdef _WIN32
+/// The state shared by the #rtSchedJitterTest threads
+static volatile LONG   slJitterGo          = 0;     ///< `0` = wait, `1` = run, `2` = stop
+static volatile bool   sbJitterPolicy      = false; ///< `true` if the signaller and waiter use the policy
+static volatile LONG64 sl64JitterSignalled = 0;     ///< When the signaller set #shJitterWake (QPC)
+static HANDLE          shJitterWake        = NULL;  ///< Stands in for #ghStartDFTevent
+static HANDLE          shJitterDone        = NULL;  ///< Stands in for #ghDoneDFTevents
+static UINT64          su64JitterTicks[ RT_SCHED_JITTER_MAX_SAMPLES ];  ///< How late each wake was (QPC ticks)
+static size_t          sstJitterSamples    = 0;     ///< The number of wakes in #su64JitterTicks
+
+
+/// A #rtSchedJitterTest load thread.  Spins until it's told to stop, so
+/// every CPU is busy.
+///
+/// @param Context Not used
+/// @return `0`
+static DWORD WINAPI rtSchedJitterLoad( LPVOID Context ) {
+   UNREFERENCED_PARAMETER( Context );
+
+   while ( slJitterGo != 2 ) {
+      YieldProcessor();
+   }
+
+   return 0;
+}
+
+
+/// The #rtSchedJitterTest DSP thread.  Waits for #shJitterWake (like
+/// #goertzelWorkThread waits for #ghStartDFTevent) and records how long it
+/// took to wake up.
+///
+/// @param Context Not used
+/// @return `0`
+static DWORD WINAPI rtSchedJitterWaiter( LPVOID Context ) {
+   UNREFERENCED_PARAMETER( Context );
+
+   rtSchedThread_t thread = { NULL, 0 };
+   if ( sbJitterPolicy ) {
+      rtSchedApply( RT_SCHED_ROLE_DSP, 0, &thread );
+   }
+
+   LARGE_INTEGER now;
+
+   while ( true ) {
+      WaitForSingleObject( shJitterWake, INFINITE );
+      QueryPerformanceCounter( &now );
+
+      if ( slJitterGo == 2 ) {
+         break;
+      }
+
+      if ( sstJitterSamples < RT_SCHED_JITTER_MAX_SAMPLES ) {
+         su64JitterTicks[ sstJitterSamples++ ] = (UINT64) ( now.QuadPart - sl64JitterSignalled );
+      }
+
+      SetEvent( shJitterDone );
+   }
+
+   rtSchedLeave( &thread );
+
+   return 0;
+}
+
+
+/// The #rtSchedJitterTest capture thread.  Every #RT_SCHED_JITTER_PERIOD_US
+/// it stamps the time and wakes the waiter (like #audioCapture wakes the
+/// DFT threads), then waits for the waiter to finish.
+///
+/// @param Context The performance counter frequency
+/// @return `0`
+static DWORD WINAPI rtSchedJitterSignaller( LPVOID Context ) {
+   const LONG64 l64Period = ( (LARGE_INTEGER*) Context )->QuadPart * RT_SCHED_JITTER_PERIOD_US / 1000000;
+
+   rtSchedThread_t thread = { NULL, 0 };
+   if ( sbJitterPolicy ) {
+      rtSchedApply( RT_SCHED_ROLE_CAPTURE, 0, &thread );
+   }
+
+   LARGE_INTEGER now;
+
+   while ( slJitterGo == 0 ) {
+      YieldProcessor();
+   }
+
+   while ( slJitterGo == 1 ) {
+      LARGE_INTEGER start;
+      QueryPerformanceCounter( &start );
+
+      do {
+         YieldProcessor();
+         QueryPerformanceCounter( &now );
+      } while ( now.QuadPart - start.QuadPart < l64Period );
+
+      sl64JitterSignalled = now.QuadPart;  // A volatile write has release semantics in MSVC
+      SetEvent( shJitterWake );
+      WaitForSingleObject( shJitterDone, INFINITE );
+   }
+
+   SetEvent( shJitterWake );  // Let the waiter see the stop
+
+   rtSchedLeave( &thread );
+
+   return 0;
+}
+
+
+/// Compare two UINT64s for `qsort`
+///
+/// @param p1 The first UINT64
+/// @param p2 The second UINT64
+/// @return `< 0`, `0` or `> 0`
+static int __cdecl rtSchedCompareU64( _In_ const void* p1, _In_ const void* p2 ) {
+   UINT64 u1 = *(const UINT64*) p1;
+   UINT64 u2 = *(const UINT64*) p2;
+
+   return ( u1 < u2 ) ? -1 : ( u1 > u2 ) ? 1 : 0;
+}
+
+
+/// Run one pass of #rtSchedJitterTest and log it
+///
+/// @param bPolicy    `true` to run the signaller and waiter under the policy
+/// @param pFrequency The performance counter frequency
+/// @return `true` if the pass ran.  `false` if there was a problem.
+static bool rtSchedJitterPass( _In_ const bool bPolicy, _In_ LARGE_INTEGER* pFrequency ) {
+   HANDLE hThreads[ 2 + RT_SCHED_JITTER_MAX_LOAD ] = { NULL };
+   size_t stThreads = 0;
+   bool   bStarted  = true;
+
+   slJitterGo       = 0;
+   sbJitterPolicy   = bPolicy;
+   sstJitterSamples = 0;
+
+   /// - Load every CPU with a spinning thread at normal priority
+   SYSTEM_INFO systemInfo;
+   GetSystemInfo( &systemInfo );
+
+   DWORD dwLoadThreads = systemInfo.dwNumberOfProcessors;
+   if ( dwLoadThreads > RT_SCHED_JITTER_MAX_LOAD ) {
+      dwLoadThreads = RT_SCHED_JITTER_MAX_LOAD;
+   }
+
+   hThreads[ stThreads ] = CreateThread( NULL, 0, rtSchedJitterWaiter, NULL, 0, NULL );
+   bStarted = bStarted && hThreads[ stThreads++ ] != NULL;
+   hThreads[ stThreads ] = CreateThread( NULL, 0, rtSchedJitterSignaller, pFrequency, 0, NULL );
+   bStarted = bStarted && hThreads[ stThreads++ ] != NULL;
+
+   for ( DWORD i = 0 ; i < dwLoadThreads && bStarted ; i++ ) {
+      hThreads[ stThreads ] = CreateThread( NULL, 0, rtSchedJitterLoad, NULL, 0, NULL );
+      bStarted = bStarted && hThreads[ stThreads++ ] != NULL;
+   }
+
+   if ( bStarted ) {
+      InterlockedExchange( &slJitterGo, 1 );
+      Sleep( RT_SCHED_JITTER_TEST_MS );
+   } else {
+      LOG_WARN_R( IDS_RT_SCHED_JITTER_FAILED_TO_START );  // "Failed to start the jitter test threads.  Continuing."
+   }
+
+   /// - Stop everything.  The signaller wakes the waiter one last time.
+   InterlockedExchange( &slJitterGo, 2 );
+   SetEvent( shJitterDone );
+
+   for ( size_t i = 0 ; i < stThreads ; i++ ) {
+      if ( hThreads[ i ] != NULL ) {
+         if ( i == 0 && !bStarted ) {
+            SetEvent( shJitterWake );  // The signaller may not be there to wake the waiter
+         }
+         WaitForSingleObject( hThreads[ i ], INFINITE );
+         CloseHandle( hThreads[ i ] );
+      }
+   }
+
+   if ( !bStarted || sstJitterSamples == 0 ) {
+      return false;
+   }
+
+   /// - Sort the wakes and log the percentiles
+   qsort( su64JitterTicks, sstJitterSamples, sizeof( UINT64 ), rtSchedCompareU64 );
+
+   const double usPerTick = 1.0e6 / (double) pFrequency->QuadPart;
+
+   LOG_INFO_R( IDS_RT_SCHED_JITTER_RESULT,  // "Jitter test (%s):  Wakes: %zu   p50: %.1f us   p99: %.1f us   p99.9: %.1f us   Max: %.1f us   Load threads: %lu"
+      bPolicy ? L"policy" : L"no policy",
+      sstJitterSamples,
+      (double) su64JitterTicks[ ( sstJitterSamples - 1 ) / 2 ] * usPerTick,
+      (double) su64JitterTicks[ ( sstJitterSamples - 1 ) * 99 / 100 ] * usPerTick,
+      (double) su64JitterTicks[ ( sstJitterSamples - 1 ) * 999 / 1000 ] * usPerTick,
+      (double) su64JitterTicks[ sstJitterSamples - 1 ] * usPerTick,
+      dwLoadThreads );
+
+   return true;
+}
+
+
+/// Close the #rtSchedJitterTest events
+static void rtSchedJitterCloseEvents() {
+   if ( shJitterWake != NULL ) {
+      CloseHandle( shJitterWake );
+      shJitterWake = NULL;
+   }
+   if ( shJitterDone != NULL ) {
+      CloseHandle( shJitterDone );
+      shJitterDone = NULL;
+   }
+}
+
+
+/// Measure how late a DSP thread wakes up after it's signalled while every
+/// CPU is busy with a spinning thread -- first without the policy, then with
+/// it (MMCSS and any `/capturecpu` and `/dspcpus` pinning).
+///
+/// Logs the number of wakes and the p50, p99, p99.9 and max wake latency for
+/// each pass.  It doesn't need a window or an audio device, so it runs with
+/// `/benchmark`.
+///
+/// @return `true` if both passes ran.  `false` if there was a problem.
+bool rtSchedJitterTest() {
+   LARGE_INTEGER frequency;
+   QueryPerformanceFrequency( &frequency );
+
+   shJitterWake = CreateEventW( NULL, FALSE, FALSE, NULL );  // Auto-reset
+   shJitterDone = CreateEventW( NULL, FALSE, FALSE, NULL );
+   if ( shJitterWake == NULL || shJitterDone == NULL ) {
+      LOG_WARN_R( IDS_RT_SCHED_JITTER_FAILED_TO_START );  // "Failed to start the jitter test threads.  Continuing."
+      rtSchedJitterCloseEvents();
+      return false;
+   }
+
+   bool bResult = rtSchedJitterPass( false, &frequency );
+   bResult = rtSchedJitterPass( true, &frequency ) && bResult;
+
+   rtSchedJitterCloseEvents();
+
+   return bResult;
+}
+#else
+/// The jitter test is built on Win32 events and threads, so it only runs on
+/// Windows
+///
+/// @return `true` (skipping it isn't a failure)
+bool rtSchedJitterTest() {
+   LOG_INFO_R( IDS_RT_SCHED_JITTER_WINDOWS_ONLY );  // "The real-time jitter test only runs on Windows.  Skipping it."
+
+   return true;
+}
+#endif
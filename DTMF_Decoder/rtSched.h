@@ -0,0 +1,50 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// Real-time scheduling policy for the capture and DSP threads
+///
+/// @file    rtSched.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#ifdef _WIN32
+   #include <Windows.h>   // For BOOL, HANDLE, DWORD_PTR, etc.
+#else
+   #include <sched.h>     // For cpu_set_t
+#endif
+
+
+/// What a thread does in the pipeline.  Each role can be pinned to its own
+/// CPUs.
+typedef enum {
+   RT_SCHED_ROLE_CAPTURE = 0,  ///< #audioCaptureThread (and the other sources' capture threads)
+   RT_SCHED_ROLE_DSP,          ///< #goertzelWorkThread
+   RT_SCHED_ROLE_COUNT         ///< The number of roles
+} rtSchedRole_t;
+
+
+/// The policy a thread took with #rtSchedEnter.  It's local to the thread
+/// and hands back what #rtSchedLeave needs to undo it.
+typedef struct {
+#ifdef _WIN32
+   HANDLE    hMmcss;          ///< From `AvSetMmThreadCharacteristicsW` (or `NULL`)
+   DWORD_PTR dwpOldAffinity;  ///< The thread's affinity before it was pinned (or `0` if it wasn't pinned)
+#else
+   int       iOldPolicy;      ///< The thread's scheduling policy before it went real-time (or `-1` if it didn't)
+   int       iOldPriority;    ///< The thread's priority before it went real-time
+   bool      bPinned;         ///< `true` if the thread was pinned
+   cpu_set_t oldAffinity;     ///< The thread's affinity before it was pinned
+#endif
+} rtSchedThread_t;
+
+
+extern BOOL rtSchedParseCommandLine( _In_opt_z_ const PCWSTR pwszCmdLine );
+extern BOOL rtSchedInit();
+extern BOOL rtSchedEnter( _In_ const rtSchedRole_t role, _In_ const size_t stWorker, _Out_ rtSchedThread_t* pThread );
+extern BOOL rtSchedLeave( _Inout_ rtSchedThread_t* pThread );
+extern bool rtSchedJitterTest();
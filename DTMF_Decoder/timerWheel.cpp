@@ -0,0 +1,419 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// A hierarchical timer wheel for per-stream digit timeouts
+///
+/// Turning keys into digits takes timers on every stream:  A tone has to
+/// last a minimum time before it's a key, an entry ends when no key comes
+/// for the inter-digit timeout, and it ends anyway after the end-of-entry
+/// timeout.  With thousands of streams, checking every stream's deadlines
+/// on every tick is wasted work -- almost none of them are due.
+///
+/// The wheel keeps its timers in #TIMER_WHEEL_LEVELS levels of
+/// #TIMER_WHEEL_SLOTS slots.  Level 0 has a slot per tick, level 1 a slot
+/// per #TIMER_WHEEL_SLOTS ticks and so on.  A timer goes in the lowest
+/// level that reaches its expiry.
+///
+///   - #timerWheelArm and #timerWheelCancel are O(1):  Each slot is an
+///     intrusive, doubly-linked list, so a timer is linked in or out without
+///     searching.  Nothing is allocated.
+///   - #timerWheelAdvance moves the wheel forward a tick at a time.  At the
+///     start of each level 1 block, the level 1 slot for the block is
+///     emptied into level 0 (and so on up the levels).  Then everything in
+///     the tick's level 0 slot has expired, and it's handed to the owner in
+///     one batch.
+///
+/// The ticks are whatever the owner says they are.  dtmfPcap.cpp uses 10ms
+/// of capture time -- one hop of the analysis loop -- and advances its
+/// wheel as it plays each packet.
+///
+/// A wheel belongs to one thread, so it needs no locks.
+///
+/// #timerWheelTest keeps 100,000 timers running and compares the cost of a
+/// tick to checking every timer.  It runs with `/benchmark`.
+///
+/// @see Varghese and Lauck, _Hashed and Hierarchical Timing Wheels_ (SOSP '87)
+///
+/// @file    timerWheel.cpp
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#include "framework.h"    // Standard system include files
+
+#include "timerWheel.h"   // For yo bad self
+
+
+/// The ticks the wheel reaches
+#define TIMER_WHEEL_RANGE  ( 1ull << ( TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS ) )
+
+
+/// Start an empty wheel
+///
+/// @param pWheel The wheel
+/// @param u64Now The current tick
+void timerWheelInit( _Out_ timerWheel_t* pWheel, _In_ const UINT64 u64Now ) {
+   _ASSERTE( pWheel != NULL );
+
+   ZeroMemory( pWheel, sizeof( timerWheel_t ) );
+   pWheel->u64Now = u64Now;
+}
+
+
+/// Set up a timer that's not armed
+///
+/// @param pEntry  The timer
+/// @param u32Id   For the owner (see #timerWheelEntry_t.u32Id)
+/// @param u32Kind For the owner (see #timerWheelEntry_t.u32Kind)
+void timerWheelEntryInit( _Out_ timerWheelEntry_t* pEntry, _In_ const UINT32 u32Id, _In_ const UINT32 u32Kind ) {
+   _ASSERTE( pEntry != NULL );
+
+   pEntry->pNext     = NULL;
+   pEntry->ppPrev    = NULL;
+   pEntry->u64Expiry = 0;
+   pEntry->u32Id     = u32Id;
+   pEntry->u32Kind   = u32Kind;
+}
+
+
+/// Link a timer into the slot for a tick
+///
+/// @param pWheel  The wheel
+/// @param pEntry  The timer
+/// @param u64Tick The tick to file it under (not before #timerWheel_t.u64Now)
+static void timerWheelLink( _Inout_ timerWheel_t* pWheel, _Inout_ timerWheelEntry_t* pEntry, _In_ UINT64 u64Tick ) {
+   _ASSERTE( u64Tick >= pWheel->u64Now );
+
+   UINT64 u64Delta = u64Tick - pWheel->u64Now;
+
+   /// - Park a timer that's out of range at the far end of the top level.
+   ///   It's filed again when that slot comes around.
+   if ( u64Delta >= TIMER_WHEEL_RANGE ) {
+      u64Tick  = pWheel->u64Now + TIMER_WHEEL_RANGE - 1;
+      u64Delta = TIMER_WHEEL_RANGE - 1;
+   }
+
+   size_t stLevel = 0;
+   while ( u64Delta >= ( 1ull << ( TIMER_WHEEL_BITS * ( stLevel + 1 ) ) ) ) {
+      stLevel++;
+   }
+
+   timerWheelEntry_t** ppHead = &pWheel->slots[ stLevel ][ ( u64Tick >> ( TIMER_WHEEL_BITS * stLevel ) ) & ( TIMER_WHEEL_SLOTS - 1 ) ];
+
+   pEntry->pNext  = *ppHead;
+   pEntry->ppPrev = ppHead;
+   if ( *ppHead != NULL ) {
+      ( *ppHead )->ppPrev = &pEntry->pNext;
+   }
+   *ppHead = pEntry;
+}
+
+
+/// Arm a timer (or re-arm it, if it's already armed).  O(1).
+///
+/// @param pWheel    The wheel
+/// @param pEntry    The timer
+/// @param u64Expiry The tick it expires on.  If that's not after the
+///                  current tick, it expires on the next one.
+void timerWheelArm( _Inout_ timerWheel_t* pWheel, _Inout_ timerWheelEntry_t* pEntry, _In_ const UINT64 u64Expiry ) {
+   _ASSERTE( pWheel != NULL );
+   _ASSERTE( pEntry != NULL );
+
+   timerWheelCancel( pWheel, pEntry );
+
+   pEntry->u64Expiry = u64Expiry;
+   timerWheelLink( pWheel, pEntry, ( u64Expiry > pWheel->u64Now ) ? u64Expiry : pWheel->u64Now + 1 );
+
+   pWheel->stArmed++;
+}
+
+
+/// Cancel a timer.  O(1).
+///
+/// @param pWheel The wheel
+/// @param pEntry The timer
+/// @return `true` if it was armed
+bool timerWheelCancel( _Inout_ timerWheel_t* pWheel, _Inout_ timerWheelEntry_t* pEntry ) {
+   _ASSERTE( pWheel != NULL );
+   _ASSERTE( pEntry != NULL );
+
+   if ( pEntry->ppPrev == NULL ) {
+      return false;
+   }
+
+   *pEntry->ppPrev = pEntry->pNext;
+   if ( pEntry->pNext != NULL ) {
+      pEntry->pNext->ppPrev = pEntry->ppPrev;
+   }
+
+   pEntry->pNext  = NULL;
+   pEntry->ppPrev = NULL;
+
+   _ASSERTE( pWheel->stArmed > 0 );
+   pWheel->stArmed--;
+
+   return true;
+}
+
+
+/// Move a slot's timers down to the levels below it (or park them again)
+///
+/// @param pWheel  The wheel
+/// @param stLevel The slot's level (`1` or more)
+/// @param stSlot  The slot
+static void timerWheelCascade( _Inout_ timerWheel_t* pWheel, _In_ const size_t stLevel, _In_ const size_t stSlot ) {
+   timerWheelEntry_t* pEntry = pWheel->slots[ stLevel ][ stSlot ];
+   pWheel->slots[ stLevel ][ stSlot ] = NULL;
+
+   while ( pEntry != NULL ) {
+      timerWheelEntry_t* pNext = pEntry->pNext;
+
+      /// A timer that expires on this tick goes in this tick's level 0 slot,
+      /// which hasn't been emptied yet
+      timerWheelLink( pWheel, pEntry, ( pEntry->u64Expiry > pWheel->u64Now ) ? pEntry->u64Expiry : pWheel->u64Now );
+
+      pEntry = pNext;
+   }
+}
+
+
+/// Move the wheel forward to a tick.  Each tick's expired timers are handed
+/// to #pfnExpired in one batch.
+///
+/// A wheel with no timers jumps straight to the tick.  Otherwise, each tick
+/// costs a slot or two (more at the start of a higher level's block).
+///
+/// @param pWheel     The wheel
+/// @param u64Now     The new current tick.  If it's not after the current
+///                   tick, nothing happens.
+/// @param pfnExpired Called for each tick that has expired timers
+/// @param pContext   Passed to #pfnExpired
+/// @return The number of timers that expired
+size_t timerWheelAdvance( _Inout_ timerWheel_t* pWheel, _In_ const UINT64 u64Now, _In_ timerWheelExpired_t pfnExpired, _Inout_opt_ void* pContext ) {
+   _ASSERTE( pWheel != NULL );
+   _ASSERTE( pfnExpired != NULL );
+
+   size_t stExpired = 0;
+
+   while ( pWheel->u64Now < u64Now ) {
+      if ( pWheel->stArmed == 0 ) {
+         pWheel->u64Now = u64Now;
+         break;
+      }
+
+      const UINT64 u64Tick = ++pWheel->u64Now;
+
+      /// - At the start of a block, empty the higher levels' slots for it
+      ///   (from the top down)
+      size_t stLevels = 0;
+      while ( stLevels < TIMER_WHEEL_LEVELS - 1 && ( u64Tick & ( ( 1ull << ( TIMER_WHEEL_BITS * ( stLevels + 1 ) ) ) - 1 ) ) == 0 ) {
+         stLevels++;
+      }
+
+      for ( size_t l = stLevels ; l > 0 ; l-- ) {
+         timerWheelCascade( pWheel, l, (size_t) ( u64Tick >> ( TIMER_WHEEL_BITS * l ) ) & ( TIMER_WHEEL_SLOTS - 1 ) );
+      }
+
+      /// - Everything in the tick's level 0 slot has expired
+      timerWheelEntry_t** ppHead = &pWheel->slots[ 0 ][ u64Tick & ( TIMER_WHEEL_SLOTS - 1 ) ];
+      timerWheelEntry_t*  pList  = *ppHead;
+      if ( pList == NULL ) {
+         continue;
+      }
+      *ppHead = NULL;
+
+      size_t stBatch = 0;
+      for ( timerWheelEntry_t* pEntry = pList ; pEntry != NULL ; pEntry = pEntry->pNext ) {
+         _ASSERTE( pEntry->u64Expiry <= u64Tick );
+         pEntry->ppPrev = NULL;
+         stBatch++;
+      }
+
+      pWheel->stArmed -= stBatch;
+      stExpired       += stBatch;
+
+      pfnExpired( pContext, pList, u64Tick );
+   }
+
+   return stExpired;
+}
+
+
+/// The timers #timerWheelTest keeps running
+#define TIMER_WHEEL_TEST_TIMERS     (100000)
+
+/// The ticks #timerWheelTest runs (10 minutes of 10ms ticks)
+#define TIMER_WHEEL_TEST_TICKS      (60000)
+
+/// The longest #timerWheelTest timer (30 seconds, like an end-of-entry
+/// timeout)
+#define TIMER_WHEEL_TEST_MAX_DELAY  (3000)
+
+/// The timers #timerWheelTest cancels and re-arms every tick (a key on 1%
+/// of the streams)
+#define TIMER_WHEEL_TEST_RESTARTS   (1000)
+
+/// The ticks the polling comparison runs
+#define TIMER_WHEEL_TEST_POLL_TICKS (1000)
+
+
+/// The state shared with #timerWheelTestExpired
+static timerWheel_t sTestWheel;        ///< The wheel under test
+static UINT64       su64TestRandom;    ///< The random number generator's state
+static UINT64       su64TestExpired;   ///< Timers that expired
+static size_t       sstTestWrong;      ///< Timers that expired on the wrong tick
+
+
+/// A quick random number (xorshift64*)
+///
+/// @return The next random number
+static UINT32 timerWheelTestRandom() {
+   su64TestRandom ^= su64TestRandom >> 12;
+   su64TestRandom ^= su64TestRandom << 25;
+   su64TestRandom ^= su64TestRandom >> 27;
+
+   return (UINT32) ( ( su64TestRandom * 0x2545F4914F6CDD1D ) >> 32 );
+}
+
+
+/// Check each timer that expired and arm it again (so the wheel stays
+/// full)
+///
+/// @param pContext Not used
+/// @param pExpired The timers that expired
+/// @param u64Tick  The tick they expired on
+static void timerWheelTestExpired( _Inout_opt_ void* pContext, _In_ timerWheelEntry_t* pExpired, _In_ const UINT64 u64Tick ) {
+   UNREFERENCED_PARAMETER( pContext );
+
+   while ( pExpired != NULL ) {
+      timerWheelEntry_t* pNext = pExpired->pNext;
+
+      if ( pExpired->u64Expiry != u64Tick ) {
+         sstTestWrong++;
+      }
+      su64TestExpired++;
+
+      timerWheelArm( &sTestWheel, pExpired, u64Tick + 1 + timerWheelTestRandom() % TIMER_WHEEL_TEST_MAX_DELAY );
+
+      pExpired = pNext;
+   }
+}
+
+
+/// Keep #TIMER_WHEEL_TEST_TIMERS timers running for #TIMER_WHEEL_TEST_TICKS
+///
+/// Every tick, #TIMER_WHEEL_TEST_RESTARTS random timers are canceled and
+/// armed again, and every timer that expires is checked and armed again.
+/// Logs the cost of arming, of canceling and re-arming and of a tick, and
+/// compares a tick to checking every timer's deadline (what each stream
+/// would do without the wheel).  It doesn't need a window or an audio
+/// device, so it runs with `/benchmark`.
+///
+/// @return `true` if every timer expired on its tick.  `false` if there was
+///         a problem.
+bool timerWheelTest() {
+   timerWheelEntry_t* pEntries   = (timerWheelEntry_t*) VirtualAlloc( NULL, TIMER_WHEEL_TEST_TIMERS * sizeof( timerWheelEntry_t ), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE );
+   UINT64*            pDeadlines = (UINT64*)            VirtualAlloc( NULL, TIMER_WHEEL_TEST_TIMERS * sizeof( UINT64 ),            MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE );
+
+   if ( pEntries == NULL || pDeadlines == NULL ) {
+      LOG_WARN_R( IDS_TIMER_WHEEL_TEST_FAILED_TO_START );  // "Failed to allocate the timer wheel test's timers.  Continuing."
+      if ( pEntries != NULL ) VirtualFree( pEntries, 0, MEM_RELEASE );
+      if ( pDeadlines != NULL ) VirtualFree( pDeadlines, 0, MEM_RELEASE );
+      return false;
+   }
+
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER start;
+   LARGE_INTEGER end;
+   QueryPerformanceFrequency( &frequency );
+
+   su64TestRandom  = 0x9E3779B97F4A7C15;
+   su64TestExpired = 0;
+   sstTestWrong    = 0;
+
+   timerWheelInit( &sTestWheel, 0 );
+
+   /// - Arm every timer
+   QueryPerformanceCounter( &start );
+   for ( size_t i = 0 ; i < TIMER_WHEEL_TEST_TIMERS ; i++ ) {
+      timerWheelEntryInit( &pEntries[ i ], (UINT32) i, 0 );
+      timerWheelArm( &sTestWheel, &pEntries[ i ], 1 + timerWheelTestRandom() % TIMER_WHEEL_TEST_MAX_DELAY );
+   }
+   QueryPerformanceCounter( &end );
+
+   const double dArmTicks = (double) ( end.QuadPart - start.QuadPart );
+
+   /// - Run the wheel, restarting some timers every tick
+   LONGLONG llRestartTicks = 0;
+   LONGLONG llAdvanceTicks = 0;
+
+   for ( UINT64 u64Tick = 1 ; u64Tick <= TIMER_WHEEL_TEST_TICKS ; u64Tick++ ) {
+      QueryPerformanceCounter( &start );
+      for ( size_t i = 0 ; i < TIMER_WHEEL_TEST_RESTARTS ; i++ ) {
+         timerWheelEntry_t* pEntry = &pEntries[ timerWheelTestRandom() % TIMER_WHEEL_TEST_TIMERS ];
+         timerWheelCancel( &sTestWheel, pEntry );
+         timerWheelArm( &sTestWheel, pEntry, u64Tick + timerWheelTestRandom() % TIMER_WHEEL_TEST_MAX_DELAY );
+      }
+      QueryPerformanceCounter( &end );
+      llRestartTicks += end.QuadPart - start.QuadPart;
+
+      QueryPerformanceCounter( &start );
+      timerWheelAdvance( &sTestWheel, u64Tick, timerWheelTestExpired, NULL );
+      QueryPerformanceCounter( &end );
+      llAdvanceTicks += end.QuadPart - start.QuadPart;
+   }
+
+   /// - Every timer should still be armed and none should be overdue
+   size_t stMissed = 0;
+   for ( size_t i = 0 ; i < TIMER_WHEEL_TEST_TIMERS ; i++ ) {
+      if ( !timerWheelIsArmed( &pEntries[ i ] ) || pEntries[ i ].u64Expiry <= sTestWheel.u64Now ) {
+         stMissed++;
+      }
+      pDeadlines[ i ] = pEntries[ i ].u64Expiry;
+   }
+
+   if ( sTestWheel.stArmed != TIMER_WHEEL_TEST_TIMERS ) {
+      stMissed++;
+   }
+
+   /// - Compare checking every timer's deadline every tick
+   UINT64 u64Polled = 0;
+
+   QueryPerformanceCounter( &start );
+   for ( UINT64 u64Tick = sTestWheel.u64Now + 1 ; u64Tick <= sTestWheel.u64Now + TIMER_WHEEL_TEST_POLL_TICKS ; u64Tick++ ) {
+      for ( size_t i = 0 ; i < TIMER_WHEEL_TEST_TIMERS ; i++ ) {
+         if ( pDeadlines[ i ] == u64Tick ) {
+            pDeadlines[ i ] = u64Tick + 1 + timerWheelTestRandom() % TIMER_WHEEL_TEST_MAX_DELAY;
+            u64Polled++;
+         }
+      }
+   }
+   QueryPerformanceCounter( &end );
+
+   const double dPollTicks = (double) ( end.QuadPart - start.QuadPart );
+
+   VirtualFree( pEntries, 0, MEM_RELEASE );
+   VirtualFree( pDeadlines, 0, MEM_RELEASE );
+
+   const double dTicksPerUs = (double) frequency.QuadPart / 1.0e6;
+
+   LOG_INFO_R( IDS_TIMER_WHEEL_TEST_RESULT,  // "Timer wheel test:  %zu timers   Arm: %.1f ns   Cancel and re-arm: %.1f ns   Tick: %.2f us (checking every timer: %.2f us)   Expired: %llu (polling: %llu)   Wrong tick: %zu   Missed: %zu"
+      (size_t) TIMER_WHEEL_TEST_TIMERS,
+      dArmTicks / dTicksPerUs * 1000.0 / TIMER_WHEEL_TEST_TIMERS,
+      (double) llRestartTicks / dTicksPerUs * 1000.0 / ( (double) TIMER_WHEEL_TEST_TICKS * TIMER_WHEEL_TEST_RESTARTS ),
+      (double) llAdvanceTicks / dTicksPerUs / TIMER_WHEEL_TEST_TICKS,
+      dPollTicks / dTicksPerUs / TIMER_WHEEL_TEST_POLL_TICKS,
+      su64TestExpired,
+      u64Polled,
+      sstTestWrong,
+      stMissed );
+
+   if ( sstTestWrong > 0 || stMissed > 0 ) {
+      LOG_WARN_R( IDS_TIMER_WHEEL_TEST_FAILED, sstTestWrong + stMissed );  // "The timer wheel test failed:  %zu timers expired on the wrong tick or not at all.  Continuing."
+      return false;
+   }
+
+   return true;
+}
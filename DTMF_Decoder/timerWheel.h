@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////////////////////////////
+//          University of Hawaii, College of Engineering
+//          DTMF_Decoder - EE 469 - Fall 2022
+//
+//  A Windows Desktop C program that decodes DTMF tones
+//
+/// A hierarchical timer wheel for per-stream digit timeouts
+///
+/// @file    timerWheel.h
+/// @author  Mark Nelson <marknels@hawaii.edu>
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <Windows.h>      // For UINT64, etc.
+
+
+/// Each level of the wheel has `2^TIMER_WHEEL_BITS` slots
+#define TIMER_WHEEL_BITS   (6)
+
+/// The slots in each level of the wheel
+#define TIMER_WHEEL_SLOTS  ( 1 << TIMER_WHEEL_BITS )
+
+/// The levels of the wheel.  A timer can be up to
+/// `2^( TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS )` ticks away (about 46 hours
+/// of 10ms ticks).  One that's farther away is parked in the top level
+/// until it's in range.
+#define TIMER_WHEEL_LEVELS (4)
+
+
+/// A timer.  The owner embeds it in whatever the timer is for and sets
+/// #u32Id and #u32Kind so it can tell its timers apart when they expire.  A
+/// zeroed timer is not armed.
+typedef struct timerWheelEntry_t {
+   struct timerWheelEntry_t*  pNext;    ///< The next timer in its slot (or in the expired list)
+   struct timerWheelEntry_t** ppPrev;   ///< What points to this timer or `NULL` if it's not armed
+   UINT64                     u64Expiry;  ///< The tick it expires on
+   UINT32                     u32Id;    ///< For the owner (a stream's number, for instance)
+   UINT32                     u32Kind;  ///< For the owner (which of the stream's timers, for instance)
+} timerWheelEntry_t;
+
+
+/// Called once per tick with every timer that expired on it.  The timers are
+/// a list linked by #timerWheelEntry_t.pNext and they're no longer armed, so
+/// they can be armed again -- but read `pNext` first.
+///
+/// @param pContext What was passed to #timerWheelAdvance
+/// @param pExpired The first expired timer
+/// @param u64Tick  The tick they expired on
+typedef void ( *timerWheelExpired_t )( _Inout_opt_ void* pContext, _In_ timerWheelEntry_t* pExpired, _In_ const UINT64 u64Tick );
+
+
+/// A timer wheel.  It belongs to one thread:  Arming, canceling and
+/// advancing are not thread safe.
+typedef struct {
+   UINT64             u64Now;  ///< The current tick
+   size_t             stArmed; ///< The timers that are armed
+   timerWheelEntry_t* slots[ TIMER_WHEEL_LEVELS ][ TIMER_WHEEL_SLOTS ];  ///< Each level's slots
+} timerWheel_t;
+
+
+extern void   timerWheelInit( _Out_ timerWheel_t* pWheel, _In_ const UINT64 u64Now );
+extern void   timerWheelEntryInit( _Out_ timerWheelEntry_t* pEntry, _In_ const UINT32 u32Id, _In_ const UINT32 u32Kind );
+extern void   timerWheelArm( _Inout_ timerWheel_t* pWheel, _Inout_ timerWheelEntry_t* pEntry, _In_ const UINT64 u64Expiry );
+extern bool   timerWheelCancel( _Inout_ timerWheel_t* pWheel, _Inout_ timerWheelEntry_t* pEntry );
+extern size_t timerWheelAdvance( _Inout_ timerWheel_t* pWheel, _In_ const UINT64 u64Now, _In_ timerWheelExpired_t pfnExpired, _Inout_opt_ void* pContext );
+extern bool   timerWheelTest();
+
+
+/// @param pEntry A timer
+/// @return `true` if it's armed
+__forceinline bool timerWheelIsArmed( _In_ const timerWheelEntry_t* pEntry ) {
+   return pEntry->ppPrev != NULL;
+}
@@ -0,0 +1,125 @@
+#! python3
+
+# #############################################################################
+#          University of Hawaii, College of Engineering
+#          DTMF_Decoder - EE 469 - Fall 2022
+#
+#  A Windows Desktop C program that decodes DTMF tones
+#
+## Generate `logStrings_generated.h` from the string table in
+## `DTMF_Decoder.rc` and the IDs in `Resource.h`
+##
+## The header has the range of string IDs (so `logStrings.cpp` can index its
+## table at compile time), the size of the string arena and, for builds
+## without Windows resources, an embedded copy of every string.  The copy is
+## only compiled by `logStringsEmbedded.cpp`, which doesn't need any Windows
+## headers.
+##
+## Usage:  Run from the solution directory.  `pre_build_event.py` runs it
+##         before every build.
+##
+## @file    generate_strings.py
+## @author  Mark Nelson <marknels@hawaii.edu>
+###############################################################################
+
+import re
+
+## Path to the program's resource file
+RESOURCE_FILE   = "./DTMF_Decoder/DTMF_Decoder.rc"
+
+## Path to the resource IDs
+RESOURCE_HEADER = "./DTMF_Decoder/Resource.h"
+
+## Path to the generated header
+OUTPUT_FILE     = "./DTMF_Decoder/logStrings_generated.h"
+
+
+## Read the `#define` IDs from Resource.h
+def read_ids():
+    ids = {}
+    with open( RESOURCE_HEADER, "r", encoding="latin-1" ) as file:
+        for line in file:
+            match = re.match( r"#define\s+(\w+)\s+(\d+)\s*$", line )
+            if match:
+                ids[ match.group( 1 ) ] = int( match.group( 2 ) )
+    return ids
+
+
+## Read every `NAME "text"` entry in the rc file's `STRINGTABLE` blocks
+def read_strings():
+    with open( RESOURCE_FILE, "rb" ) as file:
+        text = file.read().decode( "utf-16" )
+
+    strings = []
+    for block in re.findall( r"STRINGTABLE\s*\r?\nBEGIN\r?\n(.*?)\r?\nEND", text, re.S ):
+        for match in re.finditer( r"^\s*(\w+)\s+\"((?:[^\"]|\"\")*)\"", block, re.M ):
+            strings.append( ( match.group( 1 ), match.group( 2 ).replace( '""', '"' ) ) )
+    return strings
+
+
+## Convert a resource string to a C wide string literal
+def c_literal( value ):
+    out = ""
+    for ch in value:
+        if ch == '"':
+            out += '\\"'
+        elif ord( ch ) > 126:
+            out += "\\x%04x\" L\"" % ord( ch )  # Split the literal, so the next character isn't part of the escape
+        else:
+            out += ch
+    return 'L"' + out + '"'
+
+
+## Write the header (only if it changed, so it doesn't trigger a rebuild)
+def main():
+    ids     = read_ids()
+    entries = sorted( ( ids[ name ], name, value ) for ( name, value ) in read_strings() if name in ids )
+
+    arena_chars = sum( len( value.encode( "utf-16-le" ) ) // 2 + 1 for ( _, _, value ) in entries )
+
+    lines = []
+    lines.append( "///////////////////////////////////////////////////////////////////////////////" )
+    lines.append( "//          University of Hawaii, College of Engineering" )
+    lines.append( "//          DTMF_Decoder - EE 469 - Fall 2022" )
+    lines.append( "//" )
+    lines.append( "//  A Windows Desktop C program that decodes DTMF tones" )
+    lines.append( "//" )
+    lines.append( "/// The string table from DTMF_Decoder.rc" )
+    lines.append( "///" )
+    lines.append( "/// **Generated by bin/generate_strings.py.  Do not edit.**" )
+    lines.append( "///" )
+    lines.append( "/// @file    logStrings_generated.h" )
+    lines.append( "/// @author  Mark Nelson <marknels@hawaii.edu>" )
+    lines.append( "///////////////////////////////////////////////////////////////////////////////" )
+    lines.append( "" )
+    lines.append( "#pragma once" )
+    lines.append( "" )
+    lines.append( "#define LOG_STRING_FIRST_ID    %d   ///< The lowest string ID" % entries[ 0 ][ 0 ] )
+    lines.append( "#define LOG_STRING_LAST_ID     %d   ///< The highest string ID" % entries[ -1 ][ 0 ] )
+    lines.append( "#define LOG_STRING_ARENA_CHARS %d  ///< The characters (with `\\0`s) in all of the strings" % arena_chars )
+    lines.append( "" )
+    lines.append( "#ifdef LOG_STRINGS_EMBEDDED" )
+    lines.append( "/// Every string in DTMF_Decoder.rc, sorted by ID (for builds without Windows" )
+    lines.append( "/// resources).  The IDs are numbers, so this doesn't need Resource.h." )
+    lines.append( "static const logStringDefinition_t sEmbeddedStrings[] = {" )
+    for ( id, name, value ) in entries:
+        lines.append( "   { %3d, %s },  // %s" % ( id, c_literal( value ), name ) )
+    lines.append( "};" )
+    lines.append( "#endif" )
+    lines.append( "" )
+
+    new_text = "\n".join( lines )
+
+    try:
+        with open( OUTPUT_FILE, "r", encoding="ascii" ) as file:
+            if file.read() == new_text:
+                return
+    except FileNotFoundError:
+        pass
+
+    with open( OUTPUT_FILE, "w", encoding="ascii", newline="\n" ) as file:
+        file.write( new_text )
+
+
+if __name__ == "__main__":
+    main()
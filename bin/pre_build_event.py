@@ -38,6 +38,8 @@ os.chdir( SolutionDir )
 
 os.system( "py " + SolutionDir + "bin/update_version.py" )
 
+os.system( "py " + SolutionDir + "bin/generate_strings.py" )
+
 if Configuration == "Release":
     print( "Copying PGO instrumentation files")
     for file in glob.glob( SolutionDir + "Optimizer/*" ):